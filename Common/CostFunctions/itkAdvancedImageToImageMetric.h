@@ -19,6 +19,8 @@
 #define itkAdvancedImageToImageMetric_h
 
 #include "itkImageToImageMetric.h"
+#include "itkEvaluationContextCostFunctionInterface.h"
+#include "itkFusedStepCostFunctionInterface.h"
 
 #include "itkImageSamplerBase.h"
 #include "itkGradientImageFilter.h"
@@ -36,9 +38,12 @@
 #include "itkAdvancedCombinationTransform.h"
 
 #include "itkPlatformMultiThreader.h"
+#include "elxFixedImagePreprocessingCache.h"
+#include "elxWorkStealingThreadPool.h"
 
 #include <cassert>
 #include <memory> // For unique_ptr.
+#include <string>
 #include <typeinfo>
 
 namespace itk
@@ -81,7 +86,10 @@ namespace itk
  */
 
 template <class TFixedImage, class TMovingImage>
-class ITK_TEMPLATE_EXPORT AdvancedImageToImageMetric : public ImageToImageMetric<TFixedImage, TMovingImage>
+class ITK_TEMPLATE_EXPORT AdvancedImageToImageMetric
+  : public ImageToImageMetric<TFixedImage, TMovingImage>
+  , public FusedStepCostFunctionInterface
+  , public EvaluationContextCostFunctionInterface
 {
 public:
   ITK_DISALLOW_COPY_AND_MOVE(AdvancedImageToImageMetric);
@@ -135,6 +143,17 @@ public:
   using DerivativeValueType = typename DerivativeType::ValueType;
   using typename Superclass::ParametersType;
 
+  /** The type of the derivatives that are accumulated by each thread. Single precision when elastix is built with
+   * ELASTIX_USE_SINGLE_PRECISION_METRIC_COMPUTATION, which halves the memory traffic of the accumulation. The
+   * derivatives of the threads are always summed in DerivativeValueType.
+   */
+#ifdef ELASTIX_USE_SINGLE_PRECISION_METRIC_COMPUTATION
+  using PerThreadDerivativeValueType = float;
+#else
+  using PerThreadDerivativeValueType = DerivativeValueType;
+#endif
+  using PerThreadDerivativeType = Array<PerThreadDerivativeValueType>;
+
   /** Some useful extra typedefs. */
   using FixedImagePixelType = typename FixedImageType::PixelType;
   using MovingImageRegionType = typename MovingImageType::RegionType;
@@ -267,6 +286,17 @@ public:
   itkGetConstMacro(UseFixedImageLimiter, bool);
   itkGetConstMacro(UseMovingImageLimiter, bool);
 
+  /** Set the cache of fixed image preprocessing results, which is shared with other registrations to the same
+   * fixed image, and the key under which this metric stores its results in the cache. With a cache, the
+   * extrema of the fixed image, needed by the fixed image limiter, are only computed once for each key.
+   */
+  void
+  SetFixedImagePreprocessingCache(elastix::FixedImagePreprocessingCache * const cache, const std::string & key)
+  {
+    m_FixedImagePreprocessingCache = cache;
+    m_FixedImagePreprocessingCacheKey = key;
+  }
+
   /** You may specify a scaling vector for the moving image derivatives.
    * If the UseMovingImageDerivativeScales is true, the moving image derivatives
    * are multiplied by the moving image derivative scales (element-wise)
@@ -309,6 +339,28 @@ public:
   itkGetConstReferenceMacro(UseMultiThread, bool);
   itkBooleanMacro(UseMultiThread);
 
+  /** Computes the value and derivative by GetValueAndDerivative. When the derivative is accumulated over
+   * the threads by AccumulateDerivativesThreaderCallback, the block function is called for each block of
+   * the derivative, right after that block is accumulated. Returns whether it did.
+   */
+  bool
+  GetValueAndDerivativeInBlocks(const ParametersType &              parameters,
+                                MeasureType &                       value,
+                                DerivativeType &                    derivative,
+                                const DerivativeBlockFunctionType & blockFunction) const override;
+
+  /** Creates an evaluation context of this metric: a metric of the same type, with the same settings, which shares
+   * the images, masks, interpolator and limiters of this metric, but has its own copy of the transform, of the
+   * current samples, and of the per-thread variables. Requires that this metric is initialized. Returns null when
+   * the metric, its transform, or its interpolator does not support evaluation contexts.
+   */
+  SingleValuedCostFunction::Pointer
+  CreateEvaluationContext() const override;
+
+  /** Updates the samples of the evaluation context to the current samples of this metric. */
+  void
+  UpdateEvaluationContext(SingleValuedCostFunction & evaluationContext) const override;
+
   /** Contains calls from GetValueAndDerivative that are thread-unsafe,
    * together with preparation for multi-threading.
    * Note that the only reason why this function is not protected, is
@@ -317,6 +369,16 @@ public:
   virtual void
   BeforeThreadedGetValueAndDerivative(const TransformParametersType & parameters) const;
 
+  /** Sets the mapped points of the current samples, under the current transform parameters, as computed once by a
+   * combination metric, for all its sub metrics that have equivalent samples. TransformPoints then copies these
+   * points, instead of transforming the samples again. The combination metric resets it to nullptr afterwards.
+   */
+  void
+  SetSharedMappedPoints(const std::vector<OutputPointType> * const sharedMappedPoints)
+  {
+    m_SharedMappedPoints = sharedMappedPoints;
+  }
+
 protected:
   /** Constructor. */
   AdvancedImageToImageMetric();
@@ -328,6 +390,25 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** Creates a metric of the same type, with the same settings and initialized state, which shares the images,
+   * masks, interpolator, limiters, transform, and image sampler of this metric. A metric that supports evaluation
+   * contexts overrides this function, to copy its own settings and state as well.
+   */
+  LightObject::Pointer
+  InternalClone() const override;
+
+  /** Returns whether this type of metric supports evaluation contexts. Default: false. */
+  virtual bool
+  EvaluationContextsSupported() const
+  {
+    return false;
+  }
+
+  /** Clones the specified transform, such that the parameters of the clone can be set independently, for example
+   * for an evaluation context. Returns null when it cannot be cloned. */
+  static typename AdvancedTransformType::Pointer
+  CloneTransform(AdvancedTransformType & transform);
+
   /** Protected Typedefs ******************/
 
   /** Typedefs for indices and points. */
@@ -416,10 +497,40 @@ protected:
   void
   LaunchGetValueAndDerivativeThreaderCallback() const;
 
-  /** AccumulateDerivatives threader callback function. */
+  /** AccumulateDerivatives threader callback function. Accumulates the derivative block by block, and
+   * passes each block to the block function of GetValueAndDerivativeInBlocks, if any. Metrics should only
+   * use it for the final accumulation of their derivative, without processing the derivative afterwards.
+   */
   static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
   AccumulateDerivativesThreaderCallback(void * arg);
 
+  /** Executes the threader callback for each work unit on the shared, persistent thread pool,
+   * instead of on threads that are created and joined for this call only.
+   */
+  void
+  LaunchThreaderCallback(ThreadFunctionType callback, void * userData) const;
+
+  /** Retrieves the next chunk of samples [pos_begin, pos_end) to be processed by the specified work
+   * unit, during a phase launched by LaunchThreaderCallback. Returns false when the work unit has no
+   * more chunks. Threaded functions loop over these chunks instead of processing one slice of the
+   * samples, so that the work is balanced when many samples are rejected in some parts of the
+   * sample container. The chunks are assigned to the work units statically, so that the per-thread
+   * sums, and thereby the results, are the same for each run. pos_begin and pos_end must be zero at
+   * the first call.
+   */
+  bool
+  GetNextSampleChunk(const size_t       numberOfSamples,
+                     const ThreadIdType threadId,
+                     size_t &           pos_begin,
+                     size_t &           pos_end) const
+  {
+    return elastix::ChunkedRange::GetNextChunkOfWorkUnit(
+      numberOfSamples, Self::GetNumberOfWorkUnits(), threadId, pos_begin, pos_end);
+  }
+
+  /** Mapped points shared by a combination metric, or nullptr. */
+  const std::vector<OutputPointType> * m_SharedMappedPoints{ nullptr };
+
   /** Variables for multi-threading. */
   bool m_UseMetricSingleThreaded{ true };
   bool m_UseMultiThread{ false };
@@ -438,6 +549,10 @@ protected:
   };
   mutable MultiThreaderParameterType m_ThreaderMetricParameters{};
 
+  /** The block function of the current GetValueAndDerivativeInBlocks call, or nullptr. */
+  mutable const DerivativeBlockFunctionType * m_DerivativeBlockFunction{ nullptr };
+  mutable bool                                m_DerivativeIsHandedOutInBlocks{ false };
+
   /** Most metrics will perform multi-threading by letting
    * each thread compute a part of the value and derivative.
    *
@@ -450,9 +565,13 @@ protected:
   // test per thread struct with padding and alignment
   struct GetValueAndDerivativePerThreadStruct
   {
-    SizeValueType  st_NumberOfPixelsCounted;
-    MeasureType    st_Value;
-    DerivativeType st_Derivative;
+    SizeValueType           st_NumberOfPixelsCounted;
+    MeasureType             st_Value;
+    PerThreadDerivativeType st_Derivative;
+
+    /** Buffers for the points that are transformed at once, which keep their capacity between calls. */
+    std::vector<FixedImagePointType>  st_FixedPoints;
+    std::vector<MovingImagePointType> st_MappedPoints;
   };
   itkPadStruct(ITK_CACHE_LINE_ALIGNMENT,
                GetValueAndDerivativePerThreadStruct,
@@ -469,6 +588,10 @@ protected:
   virtual void
   InitializeThreadingParameters() const;
 
+  /** Sets the derivative to the sum of the derivatives of all threads, multiplied by the specified factor. */
+  void
+  SumPerThreadDerivatives(DerivativeType & derivative, const DerivativeValueType factor) const;
+
   /** Protected methods ************** */
 
   /** Methods for image sampler support **********/
@@ -517,6 +640,11 @@ protected:
                                             MovingImageDerivativeType *  gradient,
                                             const ThreadIdType           threadId) const
   {
+    /** The per-thread buffers of the interpolator are shared by the evaluation contexts, so these do not use them. */
+    if (m_IsEvaluationContext)
+    {
+      return EvaluateMovingImageValueAndDerivativeWithOptionalThreadId(mappedPoint, movingImageValue, gradient);
+    }
     return EvaluateMovingImageValueAndDerivativeWithOptionalThreadId(mappedPoint, movingImageValue, gradient, threadId);
   }
 
@@ -546,6 +674,18 @@ protected:
   MovingImagePointType
   TransformPoint(const FixedImagePointType & fixedImagePoint) const;
 
+  /** Transform the fixed image points of the samples in the range [pos_begin, pos_end) from
+   * FixedImage domain to MovingImage domain, by a single call to the transform. Returns the mapped
+   * points, which are stored in the per-thread buffers of the specified thread, and remain valid until
+   * the next call by that thread. When mapped points are shared by a combination metric, it returns
+   * those instead. Requires InitializeThreadingParameters() to be called first.
+   */
+  const MovingImagePointType *
+  TransformPoints(const ImageSampleContainerType & sampleContainer,
+                  size_t                           pos_begin,
+                  size_t                           pos_end,
+                  ThreadIdType                     threadId) const;
+
   /** This function returns a reference to the transform Jacobians.
    * This is either a reference to the full TransformJacobian or
    * a reference to a sparse Jacobians.
@@ -590,6 +730,15 @@ private:
   BSplineInterpolatorFloatPointer   m_BSplineInterpolatorFloat{ nullptr };
   ReducedBSplineInterpolatorPointer m_ReducedBSplineInterpolator{ nullptr };
 
+  /** The cache of fixed image preprocessing results, shared with other registrations, and the key of this metric. */
+  SmartPointer<elastix::FixedImagePreprocessingCache> m_FixedImagePreprocessingCache{ nullptr };
+  std::string                                         m_FixedImagePreprocessingCacheKey{};
+
+  /** Whether this metric is an evaluation context, created by CreateEvaluationContext, and the update time of the
+   * samples that were last copied to it. */
+  bool             m_IsEvaluationContext{ false };
+  ModifiedTimeType m_EvaluationContextSamplesTime{ 0 };
+
   /** Other private member variables. */
   bool   m_UseImageSampler{ false };
   bool   m_UseFixedImageLimiter{ false };
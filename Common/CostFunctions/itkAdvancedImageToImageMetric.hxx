@@ -20,9 +20,11 @@
 
 #include "itkAdvancedImageToImageMetric.h"
 #include "elxDefaultConstruct.h"
+#include "elxProfiler.h"
 
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
 #include "itkComputeImageExtremaFilter.h"
+#include "itkSimpleDataObjectDecorator.h"
 
 #ifdef ELASTIX_USE_OPENMP
 #  include <omp.h>
@@ -30,6 +32,7 @@
 
 #include <algorithm> // For min.
 #include <cassert>
+#include <utility> // For pair.
 
 namespace itk
 {
@@ -161,12 +164,38 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::InitializeThreadingParame
     m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted = SizeValueType{};
     m_GetValueAndDerivativePerThreadVariables[i].st_Value = MeasureType{};
     m_GetValueAndDerivativePerThreadVariables[i].st_Derivative.SetSize(this->GetNumberOfParameters());
-    m_GetValueAndDerivativePerThreadVariables[i].st_Derivative.Fill(DerivativeValueType{});
+    m_GetValueAndDerivativePerThreadVariables[i].st_Derivative.Fill(PerThreadDerivativeValueType{});
   }
 
 } // end InitializeThreadingParameters()
 
 
+/**
+ * ****************** SumPerThreadDerivatives *****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::SumPerThreadDerivatives(DerivativeType &          derivative,
+                                                                               const DerivativeValueType factor) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+  const auto         numberOfParameters = this->GetNumberOfParameters();
+
+  derivative.SetSize(numberOfParameters);
+  for (unsigned int j = 0; j < numberOfParameters; ++j)
+  {
+    DerivativeValueType sum{};
+    for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+    {
+      sum += m_GetValueAndDerivativePerThreadVariables[i].st_Derivative[j];
+    }
+    derivative[j] = sum * factor;
+  }
+
+} // end SumPerThreadDerivatives()
+
+
 /**
  * ****************** InitializeLimiters *****************************
  */
@@ -183,13 +212,28 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::InitializeLimiters()
       itkExceptionMacro("No fixed image limiter has been set!");
     }
 
-    const auto computeFixedImageExtrema = ComputeImageExtremaFilter<FixedImageType>::New();
-    computeFixedImageExtrema->SetInput(this->GetFixedImage());
-    computeFixedImageExtrema->SetImageSpatialMask(this->GetFixedImageMask());
-    computeFixedImageExtrema->Update();
+    using ExtremaType = SimpleDataObjectDecorator<std::pair<FixedImagePixelType, FixedImagePixelType>>;
+
+    const auto computeFixedImageExtrema = [this] {
+      const auto computeImageExtrema = ComputeImageExtremaFilter<FixedImageType>::New();
+      computeImageExtrema->SetInput(this->GetFixedImage());
+      computeImageExtrema->SetImageSpatialMask(this->GetFixedImageMask());
+      computeImageExtrema->Update();
+
+      const auto extrema = ExtremaType::New();
+      extrema->Set({ computeImageExtrema->GetMinimum(), computeImageExtrema->GetMaximum() });
+      return extrema;
+    };
+
+    /** The extrema of the fixed image are the same for each registration to the fixed image. */
+    const std::string                        extremaKey = m_FixedImagePreprocessingCacheKey + "FixedImageExtrema";
+    const typename ExtremaType::ConstPointer extrema =
+      m_FixedImagePreprocessingCache
+        ? m_FixedImagePreprocessingCache->GetOrCreate<ExtremaType>(extremaKey, computeFixedImageExtrema)
+        : typename ExtremaType::ConstPointer(computeFixedImageExtrema());
 
-    m_FixedImageTrueMax = computeFixedImageExtrema->GetMaximum();
-    m_FixedImageTrueMin = computeFixedImageExtrema->GetMinimum();
+    m_FixedImageTrueMin = extrema->Get().first;
+    m_FixedImageTrueMax = extrema->Get().second;
 
     m_FixedImageMinLimit = static_cast<FixedImageLimiterOutputType>(
       m_FixedImageTrueMin - m_FixedLimitRangeRatio * (m_FixedImageTrueMax - m_FixedImageTrueMin));
@@ -590,6 +634,43 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::TransformPoint(const Fixe
 } // end TransformPoint()
 
 
+/**
+ * ********************** TransformPoints ************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::TransformPoints(const ImageSampleContainerType & sampleContainer,
+                                                                       const size_t                     pos_begin,
+                                                                       const size_t                     pos_end,
+                                                                       const ThreadIdType               threadId) const
+  -> const MovingImagePointType *
+{
+  /** Use the mapped points, when they are already computed for these samples by a combination metric. */
+  if ((m_SharedMappedPoints != nullptr) && (m_SharedMappedPoints->size() == sampleContainer.size()))
+  {
+    return m_SharedMappedPoints->data() + pos_begin;
+  }
+
+  /** Gather the fixed image points into the buffer of this thread, which keeps its capacity. */
+  auto &       perThreadVariable = m_GetValueAndDerivativePerThreadVariables[threadId];
+  auto &       fixedPoints = perThreadVariable.st_FixedPoints;
+  auto &       mappedPoints = perThreadVariable.st_MappedPoints;
+  const size_t numberOfPoints = pos_end - pos_begin;
+  const auto   beginOfSamples = sampleContainer.cbegin() + pos_begin;
+  fixedPoints.resize(numberOfPoints);
+  for (size_t i = 0; i < numberOfPoints; ++i)
+  {
+    fixedPoints[i] = beginOfSamples[i].m_ImageCoordinates;
+  }
+
+  mappedPoints.resize(numberOfPoints);
+  m_AdvancedTransform->TransformPoints(fixedPoints.data(), mappedPoints.data(), numberOfPoints);
+  return mappedPoints.data();
+
+} // end TransformPoints()
+
+
 /**
  * *************** EvaluateTransformJacobian ****************
  */
@@ -644,8 +725,11 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::BeforeThreadedGetValueAnd
   if (m_UseMetricSingleThreaded)
   {
     this->SetTransformParameters(parameters);
-    if (m_UseImageSampler)
+
+    /** An evaluation context does not update its samples itself, see UpdateEvaluationContext. */
+    if (m_UseImageSampler && !m_IsEvaluationContext)
     {
+      const elastix::Profiler::ScopedTimer profilerTimer("ImageSampler::Update");
       this->GetImageSampler()->Update();
     }
   }
@@ -671,6 +755,7 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetValueThreaderCallback(
   assert(userData.st_Metric);
   const Self & metric = *(userData.st_Metric);
 
+  const elastix::Profiler::ScopedTimer profilerTimer("Metric::ThreadedGetValue", threadID);
   metric.ThreadedGetValue(threadID);
 
   return ITK_THREAD_RETURN_DEFAULT_VALUE;
@@ -686,11 +771,7 @@ template <class TFixedImage, class TMovingImage>
 void
 AdvancedImageToImageMetric<TFixedImage, TMovingImage>::LaunchGetValueThreaderCallback() const
 {
-  /** Setup threader. */
-  Superclass::m_Threader->SetSingleMethod(this->GetValueThreaderCallback, &m_ThreaderMetricParameters);
-
-  /** Launch. */
-  Superclass::m_Threader->SingleMethodExecute();
+  this->LaunchThreaderCallback(this->GetValueThreaderCallback, &m_ThreaderMetricParameters);
 
 } // end LaunchGetValueThreaderCallback()
 
@@ -713,6 +794,7 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivativeThre
   assert(userData.st_Metric);
   const Self & metric = *(userData.st_Metric);
 
+  const elastix::Profiler::ScopedTimer profilerTimer("Metric::ThreadedGetValueAndDerivative", threadID);
   metric.ThreadedGetValueAndDerivative(threadID);
 
   return ITK_THREAD_RETURN_DEFAULT_VALUE;
@@ -728,15 +810,25 @@ template <class TFixedImage, class TMovingImage>
 void
 AdvancedImageToImageMetric<TFixedImage, TMovingImage>::LaunchGetValueAndDerivativeThreaderCallback() const
 {
-  /** Setup threader. */
-  Superclass::m_Threader->SetSingleMethod(this->GetValueAndDerivativeThreaderCallback, &m_ThreaderMetricParameters);
-
-  /** Launch. */
-  Superclass::m_Threader->SingleMethodExecute();
+  this->LaunchThreaderCallback(this->GetValueAndDerivativeThreaderCallback, &m_ThreaderMetricParameters);
 
 } // end LaunchGetValueAndDerivativeThreaderCallback()
 
 
+/**
+ * *********************** LaunchThreaderCallback ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::LaunchThreaderCallback(ThreadFunctionType callback,
+                                                                              void *             userData) const
+{
+  elastix::WorkStealingThreadPool::GetInstance().SingleMethodExecute(Self::GetNumberOfWorkUnits(), callback, userData);
+
+} // end LaunchThreaderCallback()
+
+
 /**
  *********** AccumulateDerivativesThreaderCallback *************
  */
@@ -756,6 +848,8 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::AccumulateDerivativesThre
   assert(userData.st_Metric);
   Self & metric = *(userData.st_Metric);
 
+  const elastix::Profiler::ScopedTimer profilerTimer("Metric::AccumulateDerivatives", threadID);
+
   const unsigned int numPar = metric.GetNumberOfParameters();
   const unsigned int subSize =
     static_cast<unsigned int>(std::ceil(static_cast<double>(numPar) / static_cast<double>(nrOfThreads)));
@@ -766,17 +860,37 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::AccumulateDerivativesThre
    * range [ jmin, jmax [. Additionally, the sub-derivatives are reset.
    */
   const DerivativeValueType normalization = 1.0 / userData.st_NormalizationFactor;
-  for (unsigned int j = jmin; j < jmax; ++j)
+  const auto * const        blockFunction = metric.m_DerivativeBlockFunction;
+
+  /** The range is processed in blocks that fit in cache, so that the block function processes
+   * the derivative of each block right after its accumulation.
+   */
+  constexpr unsigned int derivativeBlockSize{ 2048 };
+  for (unsigned int blockBegin = jmin; blockBegin < jmax; blockBegin += derivativeBlockSize)
   {
-    DerivativeValueType sum{};
-    for (ThreadIdType i = 0; i < nrOfThreads; ++i)
+    const unsigned int blockEnd = std::min(blockBegin + derivativeBlockSize, jmax);
+    for (unsigned int j = blockBegin; j < blockEnd; ++j)
     {
-      sum += metric.m_GetValueAndDerivativePerThreadVariables[i].st_Derivative[j];
+      DerivativeValueType sum{};
+      for (ThreadIdType i = 0; i < nrOfThreads; ++i)
+      {
+        sum += metric.m_GetValueAndDerivativePerThreadVariables[i].st_Derivative[j];
 
-      /** Reset this variable for the next iteration. */
-      metric.m_GetValueAndDerivativePerThreadVariables[i].st_Derivative[j] = 0.0;
+        /** Reset this variable for the next iteration. */
+        metric.m_GetValueAndDerivativePerThreadVariables[i].st_Derivative[j] = 0.0;
+      }
+      userData.st_DerivativePointer[j] = sum * normalization;
     }
-    userData.st_DerivativePointer[j] = sum * normalization;
+
+    if (blockFunction != nullptr)
+    {
+      (*blockFunction)(blockBegin, blockEnd);
+    }
+  }
+
+  if ((blockFunction != nullptr) && (threadID == 0))
+  {
+    metric.m_DerivativeIsHandedOutInBlocks = true;
   }
 
   return ITK_THREAD_RETURN_DEFAULT_VALUE;
@@ -784,6 +898,236 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::AccumulateDerivativesThre
 } // end AccumulateDerivativesThreaderCallback()
 
 
+/**
+ * ******************* GetValueAndDerivativeInBlocks *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+bool
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivativeInBlocks(
+  const ParametersType &              parameters,
+  MeasureType &                       value,
+  DerivativeType &                    derivative,
+  const DerivativeBlockFunctionType & blockFunction) const
+{
+  m_DerivativeBlockFunction = &blockFunction;
+  m_DerivativeIsHandedOutInBlocks = false;
+
+  try
+  {
+    this->GetValueAndDerivative(parameters, value, derivative);
+  }
+  catch (...)
+  {
+    m_DerivativeBlockFunction = nullptr;
+    throw;
+  }
+
+  m_DerivativeBlockFunction = nullptr;
+  return m_DerivativeIsHandedOutInBlocks;
+
+} // end GetValueAndDerivativeInBlocks()
+
+
+/**
+ * ******************* InternalClone *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+LightObject::Pointer
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::InternalClone() const
+{
+  LightObject::Pointer clonedObject = Superclass::InternalClone();
+  const auto           clone = dynamic_cast<Self *>(clonedObject.GetPointer());
+  if (clone == nullptr)
+  {
+    itkExceptionMacro("Downcast to type " << this->GetNameOfClass() << " failed.");
+  }
+
+  /** The components of the superclass. */
+  clone->SetFixedImage(this->GetFixedImage());
+  clone->SetMovingImage(this->GetMovingImage());
+  clone->SetFixedImageMask(this->GetFixedImageMask());
+  clone->SetMovingImageMask(this->GetMovingImageMask());
+  clone->SetFixedImageRegion(this->GetFixedImageRegion());
+  clone->SetInterpolator(Superclass::m_Interpolator);
+  clone->SetTransform(m_AdvancedTransform);
+  clone->SetComputeGradient(Superclass::m_ComputeGradient);
+  clone->Superclass::m_GradientImage = Superclass::m_GradientImage;
+  clone->SetNumberOfWorkUnits(Superclass::GetNumberOfWorkUnits());
+
+  /** The image sampler and the limiters. */
+  clone->m_ImageSampler = m_ImageSampler;
+  clone->m_UseImageSampler = m_UseImageSampler;
+  clone->m_RequiredRatioOfValidSamples = m_RequiredRatioOfValidSamples;
+  clone->m_FixedImageLimiter = m_FixedImageLimiter;
+  clone->m_MovingImageLimiter = m_MovingImageLimiter;
+  clone->m_UseFixedImageLimiter = m_UseFixedImageLimiter;
+  clone->m_UseMovingImageLimiter = m_UseMovingImageLimiter;
+  clone->m_FixedLimitRangeRatio = m_FixedLimitRangeRatio;
+  clone->m_MovingLimitRangeRatio = m_MovingLimitRangeRatio;
+  clone->m_FixedImageTrueMin = m_FixedImageTrueMin;
+  clone->m_FixedImageTrueMax = m_FixedImageTrueMax;
+  clone->m_MovingImageTrueMin = m_MovingImageTrueMin;
+  clone->m_MovingImageTrueMax = m_MovingImageTrueMax;
+  clone->m_FixedImageMinLimit = m_FixedImageMinLimit;
+  clone->m_FixedImageMaxLimit = m_FixedImageMaxLimit;
+  clone->m_MovingImageMinLimit = m_MovingImageMinLimit;
+  clone->m_MovingImageMaxLimit = m_MovingImageMaxLimit;
+
+  /** The state of the image derivative computation, as initialized by CheckForBSplineInterpolator. */
+  clone->m_LinearInterpolator = m_LinearInterpolator;
+  clone->m_BSplineInterpolator = m_BSplineInterpolator;
+  clone->m_BSplineInterpolatorFloat = m_BSplineInterpolatorFloat;
+  clone->m_ReducedBSplineInterpolator = m_ReducedBSplineInterpolator;
+  clone->m_UseMovingImageDerivativeScales = m_UseMovingImageDerivativeScales;
+  clone->m_ScaleGradientWithRespectToMovingImageOrientation = m_ScaleGradientWithRespectToMovingImageOrientation;
+  clone->m_MovingImageDerivativeScales = m_MovingImageDerivativeScales;
+
+  /** The other settings. */
+  clone->m_TransformIsBSpline = m_TransformIsBSpline;
+  clone->m_UseMetricSingleThreaded = m_UseMetricSingleThreaded;
+  clone->m_UseMultiThread = m_UseMultiThread;
+  clone->m_UseOpenMP = m_UseOpenMP;
+
+  return clonedObject;
+
+} // end InternalClone()
+
+
+/**
+ * ******************* CloneTransform *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::CloneTransform(AdvancedTransformType & transform)
+  -> typename AdvancedTransformType::Pointer
+{
+  /** A combination transform is not cloned as a whole, as its initial transform is not modified during the
+   * optimization, so it can be shared, whereas its current transform is cloned.
+   */
+  if (const auto combinationTransform = dynamic_cast<CombinationTransformType *>(&transform))
+  {
+    const auto clone = CombinationTransformType::New();
+    clone->SetUseComposition(combinationTransform->GetUseComposition());
+    clone->SetInitialTransform(combinationTransform->GetModifiableInitialTransform());
+
+    if (const auto currentTransform = combinationTransform->GetModifiableCurrentTransform())
+    {
+      const auto currentTransformClone = CloneTransform(*currentTransform);
+      if (currentTransformClone.IsNull())
+      {
+        return nullptr;
+      }
+      clone->SetCurrentTransform(currentTransformClone);
+    }
+    return clone.GetPointer();
+  }
+
+  const LightObject::Pointer clone = transform.Clone().GetPointer();
+  return dynamic_cast<AdvancedTransformType *>(clone.GetPointer());
+
+} // end CloneTransform()
+
+
+/**
+ * ******************* CreateEvaluationContext *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+SingleValuedCostFunction::Pointer
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::CreateEvaluationContext() const
+{
+  /** A ray cast interpolator uses a transform of its own, so it cannot be shared. */
+  using RayCastInterpolatorType =
+    AdvancedRayCastInterpolateImageFunction<MovingImageType, CoordinateRepresentationType>;
+
+  if (!this->EvaluationContextsSupported() || m_AdvancedTransform.IsNull() ||
+      dynamic_cast<const RayCastInterpolatorType *>(Superclass::m_Interpolator.GetPointer()) != nullptr)
+  {
+    return nullptr;
+  }
+
+  const auto transform = CloneTransform(*m_AdvancedTransform);
+  if (transform.IsNull())
+  {
+    return nullptr;
+  }
+
+  /** Check that the clone maps the corners of the fixed image region like the original transform does, as some
+   * transforms have settings that are not copied by Clone().
+   */
+  const FixedImageRegionType & fixedImageRegion = this->GetFixedImageRegion();
+  for (unsigned int corner = 0; corner < (1U << FixedImageDimension); ++corner)
+  {
+    FixedImageIndexType index = fixedImageRegion.GetIndex();
+    for (unsigned int d = 0; d < FixedImageDimension; ++d)
+    {
+      if ((corner >> d) & 1U)
+      {
+        index[d] += static_cast<FixedImageIndexValueType>(fixedImageRegion.GetSize(d)) - 1;
+      }
+    }
+    FixedImagePointType point;
+    this->GetFixedImage()->TransformIndexToPhysicalPoint(index, point);
+    if (transform->TransformPoint(point) != m_AdvancedTransform->TransformPoint(point))
+    {
+      return nullptr;
+    }
+  }
+
+  const LightObject::Pointer clonedObject = this->InternalClone();
+  Self &                     context = dynamic_cast<Self &>(*clonedObject);
+  context.SetTransform(transform);
+  context.m_IsEvaluationContext = true;
+
+  if (m_UseImageSampler)
+  {
+    /** The context gets its own sampler, which is never updated, but which contains a copy of the samples. */
+    context.m_ImageSampler = ImageSamplerType::New();
+    this->UpdateEvaluationContext(context);
+  }
+
+  if (m_UseMultiThread)
+  {
+    context.InitializeThreadingParameters();
+  }
+
+  return SingleValuedCostFunction::Pointer(&context);
+
+} // end CreateEvaluationContext()
+
+
+/**
+ * ******************* UpdateEvaluationContext *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::UpdateEvaluationContext(
+  SingleValuedCostFunction & evaluationContext) const
+{
+  const auto context = dynamic_cast<Self *>(&evaluationContext);
+  if (context == nullptr || !context->m_IsEvaluationContext || !m_UseImageSampler)
+  {
+    return;
+  }
+
+  /** Let the sampler select its samples now, instead of during the next evaluation of this metric, which may run
+   * concurrently with the evaluation of the context. */
+  m_ImageSampler->Update();
+
+  const ImageSampleContainerType & samples = *(m_ImageSampler->GetOutput());
+  if (samples.GetUpdateMTime() != context->m_EvaluationContextSamplesTime)
+  {
+    context->m_ImageSampler->GetOutput()->CastToSTLContainer() = samples.CastToSTLConstContainer();
+    context->m_EvaluationContextSamplesTime = samples.GetUpdateMTime();
+  }
+
+} // end UpdateEvaluationContext()
+
+
 /**
  * *********************** CheckNumberOfSamples ***********************
  */
@@ -793,6 +1137,9 @@ void
 AdvancedImageToImageMetric<TFixedImage, TMovingImage>::CheckNumberOfSamples(unsigned long wanted,
                                                                             unsigned long found) const
 {
+  elastix::Profiler::AddCount("Metric::NumberOfSamplesWanted", wanted);
+  elastix::Profiler::AddCount("Metric::NumberOfPixelsCounted", found);
+
   Superclass::m_NumberOfPixelsCounted = found;
   if (found < wanted * this->GetRequiredRatioOfValidSamples())
   {
@@ -0,0 +1,63 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkEvaluationContextCostFunctionInterface_h
+#define itkEvaluationContextCostFunctionInterface_h
+
+#include "itkSingleValuedCostFunction.h"
+
+namespace itk
+{
+
+/**
+ * \class EvaluationContextCostFunctionInterface
+ * \brief Interface of a cost function that can create evaluation contexts of itself.
+ *
+ * The GetValue and GetValueAndDerivative member functions of a cost function are usually not thread-safe,
+ * because they store the parameters and intermediate results in the cost function itself. An evaluation
+ * context is a cost function that computes the same value as the cost function that created it, but has
+ * its own copy of this mutable state, while sharing the large, immutable data, like the images. Different
+ * evaluation contexts may therefore be evaluated concurrently, at different parameters, for example by an
+ * optimizer that evaluates a number of parameter vectors in each iteration.
+ *
+ * \sa CMAEvolutionStrategyOptimizer, AdvancedImageToImageMetric
+ */
+class EvaluationContextCostFunctionInterface
+{
+public:
+  /** Creates an evaluation context of this cost function. Returns null when this cost function (with its
+   * current components) does not support evaluation contexts.
+   */
+  virtual SingleValuedCostFunction::Pointer
+  CreateEvaluationContext() const = 0;
+
+  /** Updates an evaluation context, created by CreateEvaluationContext, to the current state of this cost
+   * function, for example its current samples. Not thread-safe: neither this cost function nor the evaluation
+   * context may be evaluated during the update. Does nothing when the specified cost function is not an
+   * evaluation context of this type of cost function.
+   */
+  virtual void
+  UpdateEvaluationContext(SingleValuedCostFunction & evaluationContext) const = 0;
+
+protected:
+  EvaluationContextCostFunctionInterface() = default;
+  virtual ~EvaluationContextCostFunctionInterface() = default;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkEvaluationContextCostFunctionInterface_h
@@ -0,0 +1,68 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkFusedStepCostFunctionInterface_h
+#define itkFusedStepCostFunctionInterface_h
+
+#include "itkSingleValuedCostFunction.h"
+
+#include <functional>
+
+namespace itk
+{
+
+/**
+ * \class FusedStepCostFunctionInterface
+ * \brief Interface of a cost function that hands out the blocks of its derivative while it computes them.
+ *
+ * A multi-threaded metric accumulates its derivative over the sub-derivatives of its threads, in a
+ * separate sweep over all parameters. Afterwards, the cost function wrapper scales the derivative,
+ * and the optimizer takes its step, each in yet another sweep over all parameters. For transforms with
+ * millions of parameters, these sweeps are bound by memory bandwidth. A cost function that implements
+ * this interface calls a block function for each block [begin, end) of parameters, as soon as the
+ * derivative of that block is final, while the block is still in cache. The block function may then
+ * scale the derivative of the block, and take the step for the parameters of the block.
+ *
+ * The block function may be called concurrently, for disjoint blocks.
+ *
+ * \sa ScaledSingleValuedCostFunction, GradientDescentOptimizer2
+ */
+class FusedStepCostFunctionInterface
+{
+public:
+  /** The function that is called for each block [begin, end) of the final derivative. */
+  using DerivativeBlockFunctionType = std::function<void(unsigned int, unsigned int)>;
+
+  /** Computes the value and the derivative, like GetValueAndDerivative, and calls the block function for
+   * each block of the derivative, once it is final. Returns false when the derivative was computed in a
+   * way that does not support handing out its blocks. In that case, the block function is not called at
+   * all, and the caller should process the whole derivative itself.
+   */
+  virtual bool
+  GetValueAndDerivativeInBlocks(const SingleValuedCostFunction::ParametersType & parameters,
+                                SingleValuedCostFunction::MeasureType &          value,
+                                SingleValuedCostFunction::DerivativeType &       derivative,
+                                const DerivativeBlockFunctionType &              blockFunction) const = 0;
+
+protected:
+  FusedStepCostFunctionInterface() = default;
+  virtual ~FusedStepCostFunctionInterface() = default;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkFusedStepCostFunctionInterface_h
@@ -213,6 +213,24 @@ public:
   itkSetMacro(FiniteDifferencePerturbation, double);
   itkGetConstMacro(FiniteDifferencePerturbation, double);
 
+  /** Whether to cache the per-sample moving image evaluations of the (multi-threaded)
+   * PDF pass, so that a subsequent derivative pass over the same samples can replay them,
+   * instead of transforming and interpolating each sample again. Costs a few doubles of
+   * memory per sample. Only used by the low-memory analytic derivative; default: false.
+   */
+  itkSetMacro(UseSampleEvaluationCache, bool);
+  itkGetConstMacro(UseSampleEvaluationCache, bool);
+  itkBooleanMacro(UseSampleEvaluationCache);
+
+  /** The maximum number of bytes that the joint PDF derivatives of the additional threads may occupy together,
+   * when the explicit PDF derivatives are computed multi-threadedly. Each additional thread needs a joint PDF
+   * derivatives image of its own, of NumberOfParameters x NumberOfMovingHistogramBins x NumberOfFixedHistogramBins
+   * values. When these images would exceed this limit, the explicit PDF derivatives are computed single-threadedly,
+   * into the shared joint PDF derivatives image. Default: 512 MiB.
+   */
+  itkSetMacro(MaximumThreadPDFDerivativesMemory, SizeValueType);
+  itkGetConstMacro(MaximumThreadPDFDerivativesMemory, SizeValueType);
+
 protected:
   /** The constructor. */
   ParzenWindowHistogramImageToImageMetric();
@@ -224,6 +242,10 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** Copies the histogram settings to the clone, and initializes its histograms and kernels. */
+  LightObject::Pointer
+  InternalClone() const override;
+
   /** Protected Typedefs ******************/
 
   /** Typedefs inherited from superclass. */
@@ -294,6 +316,35 @@ protected:
   KernelFunctionPointer m_MovingKernel{ nullptr };
   KernelFunctionPointer m_DerivativeMovingKernel{ nullptr };
 
+  /** The evaluation of a single sample, as stored by ThreadedComputePDFs when the
+   * sample evaluation cache is filled. The image values are already limited, and
+   * the moving image derivative is scaled accordingly.
+   */
+  struct CachedSampleEvaluationType
+  {
+    RealType                  m_FixedImageValue;
+    RealType                  m_MovingImageValue;
+    MovingImageDerivativeType m_MovingImageDerivative;
+    bool                      m_SampleOk;
+  };
+  using CachedSampleEvaluationContainerType = std::vector<CachedSampleEvaluationType>;
+
+  /** When true, ThreadedComputePDFs also computes the moving image derivatives,
+   * and stores the evaluations of all samples in the cache. Inheriting classes
+   * set this flag for the duration of one GetValueAndDerivative call.
+   */
+  mutable bool m_FillSampleEvaluationCache{ false };
+
+  /** Get the sample evaluations cached during the last call of ComputePDFs. The
+   * evaluation of a sample is at the position of the sample in the sample container,
+   * so that any work unit may look up the evaluations of the samples it processes.
+   */
+  const CachedSampleEvaluationContainerType &
+  GetCachedSampleEvaluations() const
+  {
+    return m_CachedSampleEvaluations;
+  }
+
   /** Initialize threading related parameters. */
   void
   InitializeThreadingParameters() const override;
@@ -302,9 +353,12 @@ protected:
   void
   ThreadedComputePDFs(ThreadIdType threadId);
 
-  /** Single-threadedly accumulate results. */
+  /** Accumulate the results of all threads. The per-thread joint histograms (and,
+   * if requested, the per-thread joint histogram derivatives) are reduced
+   * multi-threadedly, each work unit summing a contiguous block of bins.
+   */
   void
-  AfterThreadedComputePDFs() const;
+  AfterThreadedComputePDFs(bool includeJointPDFDerivatives = false) const;
 
   /** Helper function to launch the threads. */
   static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
@@ -314,6 +368,25 @@ protected:
   void
   LaunchComputePDFsThreaderCallback() const;
 
+  /** Multi-threaded version of the ComputePDFsAndPDFDerivatives function. */
+  void
+  ThreadedComputePDFsAndPDFDerivatives(ThreadIdType threadId);
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  ComputePDFsAndPDFDerivativesThreaderCallback(void * arg);
+
+  /** Reduce the block of bins of the given work unit: sums the per-thread
+   * joint histograms into m_JointPDF and, optionally, adds the per-thread
+   * joint histogram derivatives to m_JointPDFDerivatives.
+   */
+  void
+  ThreadedReduceJointPDFs(ThreadIdType workUnitId, ThreadIdType numberOfWorkUnits) const;
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  ReduceJointPDFsThreaderCallback(void * arg);
+
   /** Compute the Parzen values given an image value and a starting histogram index
    * Compute the values at (parzenWindowIndex - parzenWindowTerm + k) for
    * k = 0 ... kernelsize-1
@@ -326,14 +399,17 @@ protected:
                        PDFValueType *             parzenValues);
 
   /** Update the joint PDF with a pixel pair; on demand also updates the
-   * pdf derivatives (if the Jacobian pointers are nonzero).
+   * pdf derivatives (if the Jacobian pointers are nonzero). The pdf derivatives
+   * are stored in jointPDFDerivatives, or in m_JointPDFDerivatives when that
+   * argument is null.
    */
   virtual void
   UpdateJointPDFAndDerivatives(const RealType                     fixedImageValue,
                                const RealType                     movingImageValue,
                                const DerivativeType *             imageJacobian,
                                const NonZeroJacobianIndicesType * nzji,
-                               JointPDFType *                     jointPDF) const;
+                               JointPDFType *                     jointPDF,
+                               JointPDFDerivativesType *          jointPDFDerivatives = nullptr) const;
 
   /** Update the joint PDF and the incremental pdfs.
    * The input is a pixel pair (fixed, moving, moving mask) and
@@ -364,7 +440,8 @@ protected:
   UpdateJointPDFDerivatives(const JointPDFIndexType &          pdfIndex,
                             double                             factor,
                             const DerivativeType &             imageJacobian,
-                            const NonZeroJacobianIndicesType & nzji) const;
+                            const NonZeroJacobianIndicesType & nzji,
+                            JointPDFDerivativesType &          jointPDFDerivatives) const;
 
   /** Multiply the pdf entries by the given normalization factor. */
   void
@@ -397,10 +474,18 @@ protected:
    * So, the JointPDF is more like a histogram than a true pdf...
    * The histograms are left unnormalized since it may be faster to
    * not do this explicitly.
+   * When m_UseMultiThread is true, each thread accumulates its samples in
+   * its own joint histogram and joint histogram derivatives, which are
+   * added together afterwards. Note that this requires one additional
+   * joint histogram derivative buffer per extra thread.
    */
   virtual void
   ComputePDFsAndPDFDerivatives(const ParametersType & parameters) const;
 
+  /** Single-threaded version of ComputePDFsAndPDFDerivatives. */
+  virtual void
+  ComputePDFsAndPDFDerivativesSingleThreaded(const ParametersType & parameters) const;
+
   /** Compute PDFs and incremental pdfs (which you can use to compute finite
    * difference estimate of the derivative).
    * Loops over the fixed image samples and constructs the m_JointPDF,
@@ -469,8 +554,11 @@ protected:
   {}
 
 private:
-  /** Threading related parameters. */
-  mutable std::vector<JointPDFPointer> m_ThreaderJointPDFs{};
+  /** Threading related parameters. The per-thread joint histograms share one
+   * contiguous arena, in which each histogram starts at a cache line boundary.
+   */
+  mutable std::vector<PDFValueType> m_ThreaderJointPDFsArena{};
+  mutable SizeValueType             m_ThreaderJointPDFsStride{ 0 };
 
   /** Helper structs that multi-threads the computation of
    * the metric derivative using ITK threads.
@@ -478,13 +566,15 @@ private:
   struct ParzenWindowHistogramMultiThreaderParameterType // can't we use the one from AdvancedImageToImageMetric ?
   {
     Self * m_Metric;
+    bool   m_IncludeJointPDFDerivatives;
   };
-  ParzenWindowHistogramMultiThreaderParameterType m_ParzenWindowHistogramThreaderParameters{};
+  mutable ParzenWindowHistogramMultiThreaderParameterType m_ParzenWindowHistogramThreaderParameters{};
 
   struct ParzenWindowHistogramGetValueAndDerivativePerThreadStruct
   {
-    SizeValueType   st_NumberOfPixelsCounted;
-    JointPDFPointer st_JointPDF;
+    SizeValueType              st_NumberOfPixelsCounted;
+    JointPDFPointer            st_JointPDF;
+    JointPDFDerivativesPointer st_JointPDFDerivatives;
   };
   itkPadStruct(ITK_CACHE_LINE_ALIGNMENT,
                ParzenWindowHistogramGetValueAndDerivativePerThreadStruct,
@@ -495,6 +585,13 @@ private:
   mutable std::vector<AlignedParzenWindowHistogramGetValueAndDerivativePerThreadStruct>
     m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables;
 
+  /** The sample evaluations, cached by ThreadedComputePDFs. */
+  mutable CachedSampleEvaluationContainerType m_CachedSampleEvaluations{};
+
+  /** Whether the explicit PDF derivatives are computed multi-threadedly, as determined by
+   * InitializeThreadingParameters(), based on MaximumThreadPDFDerivativesMemory. */
+  mutable bool m_UseThreadedPDFDerivatives{ false };
+
   /** Variables that can/should be accessed by their Set/Get functions. */
   unsigned long m_NumberOfFixedHistogramBins{ 32 };
   unsigned long m_NumberOfMovingHistogramBins{ 32 };
@@ -504,6 +601,8 @@ private:
   bool          m_UseExplicitPDFDerivatives{ true };
   bool          m_UseFiniteDifferenceDerivative{ false };
   double        m_FiniteDifferencePerturbation{ 1.0 };
+  bool          m_UseSampleEvaluationCache{ false };
+  SizeValueType m_MaximumThreadPDFDerivativesMemory{ SizeValueType{ 512 } * 1024 * 1024 };
 };
 
 } // end namespace itk
@@ -19,13 +19,16 @@
 #define itkParzenWindowHistogramImageToImageMetric_hxx
 
 #include "itkParzenWindowHistogramImageToImageMetric.h"
+#include "elxProfiler.h"
 
 #include "itkBSplineKernelFunction2.h"
 #include "itkBSplineDerivativeKernelFunction2.h"
 #include "itkImageLinearIteratorWithIndex.h"
 #include "itkImageScanlineIterator.h"
 #include <vnl/vnl_math.h>
+#include <algorithm> // For copy.
 #include <cassert>
+#include <memory> // For align.
 
 namespace itk
 {
@@ -43,6 +46,7 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ParzenWindow
 
   /** Initialize the m_ParzenWindowHistogramThreaderParameters */
   this->m_ParzenWindowHistogramThreaderParameters.m_Metric = this;
+  this->m_ParzenWindowHistogramThreaderParameters.m_IncludeJointPDFDerivatives = false;
 
 } // end Constructor
 
@@ -80,6 +84,38 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::PrintSelf(st
 } // end PrintSelf()
 
 
+/**
+ * ********************* InternalClone ******************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+LightObject::Pointer
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::InternalClone() const
+{
+  LightObject::Pointer clonedObject = Superclass::InternalClone();
+  Self &               clone = dynamic_cast<Self &>(*clonedObject);
+
+  clone.m_NumberOfFixedHistogramBins = this->m_NumberOfFixedHistogramBins;
+  clone.m_NumberOfMovingHistogramBins = this->m_NumberOfMovingHistogramBins;
+  clone.m_FixedKernelBSplineOrder = this->m_FixedKernelBSplineOrder;
+  clone.m_MovingKernelBSplineOrder = this->m_MovingKernelBSplineOrder;
+  clone.m_UseDerivative = this->m_UseDerivative;
+  clone.m_UseExplicitPDFDerivatives = this->m_UseExplicitPDFDerivatives;
+  clone.m_UseFiniteDifferenceDerivative = this->m_UseFiniteDifferenceDerivative;
+  clone.m_FiniteDifferencePerturbation = this->m_FiniteDifferencePerturbation;
+  clone.m_UseSampleEvaluationCache = this->m_UseSampleEvaluationCache;
+
+  /** Do what Initialize() does, after the initialization of the superclass, which is copied already. */
+  clone.InitializeHistograms();
+  clone.InitializeKernels();
+  clone.m_PerturbedAlphaRight.SetSize(this->m_PerturbedAlphaRight.GetSize());
+  clone.m_PerturbedAlphaLeft.SetSize(this->m_PerturbedAlphaLeft.GetSize());
+
+  return clonedObject;
+
+} // end InternalClone()
+
+
 /**
  * ********************* Initialize *****************************
  */
@@ -423,21 +459,74 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::InitializeTh
   /** Only resize the array of structs when needed. */
   m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables.resize(numberOfThreads);
 
+  /** All per-thread joint histograms are stored in a single arena. The stride between
+   * two histograms is rounded up to a whole number of cache lines, and the first one
+   * starts at a cache line boundary, so that two threads never write to the same line.
+   */
+  const SizeValueType numberOfBins = jointPDFRegion.GetNumberOfPixels();
+  const SizeValueType valuesPerCacheLine = std::max<SizeValueType>(ITK_CACHE_LINE_ALIGNMENT / sizeof(PDFValueType), 1);
+  this->m_ThreaderJointPDFsStride = ((numberOfBins + valuesPerCacheLine - 1) / valuesPerCacheLine) * valuesPerCacheLine;
+  const SizeValueType arenaSize = this->m_ThreaderJointPDFsStride * numberOfThreads;
+  this->m_ThreaderJointPDFsArena.resize(arenaSize + valuesPerCacheLine);
+
+  void *      arenaBegin = this->m_ThreaderJointPDFsArena.data();
+  std::size_t arenaSpace = this->m_ThreaderJointPDFsArena.size() * sizeof(PDFValueType);
+  std::align(ITK_CACHE_LINE_ALIGNMENT, arenaSize * sizeof(PDFValueType), arenaBegin, arenaSpace);
+  PDFValueType * arenaPointer = static_cast<PDFValueType *>(arenaBegin);
+
+  /** The explicit joint histogram derivatives are accumulated per thread as well. Thread 0
+   * writes directly into m_JointPDFDerivatives, so only the other threads need a buffer.
+   * When these buffers would take too much memory, the derivatives are computed single-threadedly.
+   */
+  JointPDFDerivativesRegionType jointPDFDerivativesRegion;
+  JointPDFDerivativesSizeType   jointPDFDerivativesSize;
+  jointPDFDerivativesSize[0] = this->GetNumberOfParameters();
+  jointPDFDerivativesSize[1] = this->m_NumberOfMovingHistogramBins;
+  jointPDFDerivativesSize[2] = this->m_NumberOfFixedHistogramBins;
+  jointPDFDerivativesRegion.SetSize(jointPDFDerivativesSize);
+
+  const double threadPDFDerivativesMemory = static_cast<double>(numberOfThreads - 1) *
+                                            static_cast<double>(jointPDFDerivativesRegion.GetNumberOfPixels()) *
+                                            sizeof(PDFDerivativeValueType);
+  const bool useThreadedPDFDerivatives =
+    this->GetUseDerivative() && this->m_UseExplicitPDFDerivatives && !this->GetUseFiniteDifferenceDerivative() &&
+    threadPDFDerivativesMemory <= static_cast<double>(this->m_MaximumThreadPDFDerivativesMemory);
+  this->m_UseThreadedPDFDerivatives = useThreadedPDFDerivatives;
+
   /** Some initialization. */
-  for (auto & perThreadVariable : m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables)
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
   {
+    auto & perThreadVariable = m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[i];
     perThreadVariable.st_NumberOfPixelsCounted = SizeValueType{};
 
-    // Initialize the joint pdf
+    // Initialize the joint pdf, as a view on its slice of the arena
     JointPDFPointer & jointPDF = perThreadVariable.st_JointPDF;
     if (jointPDF.IsNull())
     {
       jointPDF = JointPDFType::New();
     }
-    if (jointPDF->GetLargestPossibleRegion() != jointPDFRegion)
+    jointPDF->SetRegions(jointPDFRegion);
+    auto pixelContainer = JointPDFType::PixelContainer::New();
+    pixelContainer->SetImportPointer(arenaPointer + i * this->m_ThreaderJointPDFsStride, numberOfBins, false);
+    jointPDF->SetPixelContainer(pixelContainer);
+
+    // Initialize the joint pdf derivatives
+    JointPDFDerivativesPointer & jointPDFDerivatives = perThreadVariable.st_JointPDFDerivatives;
+    if (useThreadedPDFDerivatives && i > 0)
+    {
+      if (jointPDFDerivatives.IsNull())
+      {
+        jointPDFDerivatives = JointPDFDerivativesType::New();
+      }
+      if (jointPDFDerivatives->GetLargestPossibleRegion() != jointPDFDerivativesRegion)
+      {
+        jointPDFDerivatives->SetRegions(jointPDFDerivativesRegion);
+        jointPDFDerivatives->Allocate();
+      }
+    }
+    else
     {
-      jointPDF->SetRegions(jointPDFRegion);
-      jointPDF->Allocate();
+      jointPDFDerivatives = nullptr;
     }
   }
 
@@ -511,7 +600,8 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::UpdateJointP
   const RealType                     movingImageValue,
   const DerivativeType *             imageJacobian,
   const NonZeroJacobianIndicesType * nzji,
-  JointPDFType *                     jointPDF) const
+  JointPDFType *                     jointPDF,
+  JointPDFDerivativesType *          jointPDFDerivatives) const
 {
   using PDFIteratorType = ImageScanlineIterator<JointPDFType>;
 
@@ -579,6 +669,9 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::UpdateJointP
 
     const double et = static_cast<double>(this->m_MovingImageBinSize);
 
+    JointPDFDerivativesType & derivatives =
+      jointPDFDerivatives ? *jointPDFDerivatives : *this->m_JointPDFDerivatives;
+
     /** Loop over the Parzen window region and increment the values
      * Also update the pdf derivatives.
      */
@@ -589,7 +682,8 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::UpdateJointP
       for (unsigned int m = 0; m < numberOfMovingParzenValues; ++m)
       {
         it.Value() += static_cast<PDFValueType>(fv * movingParzenValues[m]);
-        this->UpdateJointPDFDerivatives(it.GetIndex(), fv_et * derivativeMovingParzenValues[m], *imageJacobian, *nzji);
+        this->UpdateJointPDFDerivatives(
+          it.GetIndex(), fv_et * derivativeMovingParzenValues[m], *imageJacobian, *nzji, derivatives);
         ++it;
       }
       it.NextLine();
@@ -609,12 +703,13 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::UpdateJointP
   const JointPDFIndexType &          pdfIndex,
   double                             factor,
   const DerivativeType &             imageJacobian,
-  const NonZeroJacobianIndicesType & nzji) const
+  const NonZeroJacobianIndicesType & nzji,
+  JointPDFDerivativesType &          jointPDFDerivatives) const
 {
   /** Get the pointer to the element with index [0, pdfIndex[0], pdfIndex[1]]. */
-  PDFDerivativeValueType * derivPtr = this->m_JointPDFDerivatives->GetBufferPointer() +
-                                      (pdfIndex[0] * this->m_JointPDFDerivatives->GetOffsetTable()[1]) +
-                                      (pdfIndex[1] * this->m_JointPDFDerivatives->GetOffsetTable()[2]);
+  PDFDerivativeValueType * derivPtr = jointPDFDerivatives.GetBufferPointer() +
+                                      (pdfIndex[0] * jointPDFDerivatives.GetOffsetTable()[1]) +
+                                      (pdfIndex[1] * jointPDFDerivatives.GetOffsetTable()[2]);
 
   const auto numberOfParameters = this->GetNumberOfParameters();
 
@@ -1065,6 +1160,12 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ComputePDFs(
    */
   this->BeforeThreadedGetValueAndDerivative(parameters);
 
+  /** The work units cache the evaluation of the samples that they process at the positions of these samples. */
+  if (this->m_FillSampleEvaluationCache)
+  {
+    this->m_CachedSampleEvaluations.resize(this->GetImageSampler()->GetOutput()->Size());
+  }
+
   /** Launch multi-threading JointPDF computation. */
   this->LaunchComputePDFsThreaderCallback();
 
@@ -1094,57 +1195,84 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ThreadedComp
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   const unsigned long         sampleContainerSize = sampleContainer->Size();
 
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  const auto pos_begin = std::min<size_t>(nrOfSamplesPerThreads * threadId, sampleContainerSize);
-  const auto pos_end = std::min<size_t>(nrOfSamplesPerThreads * (threadId + 1), sampleContainerSize);
-
   /** Create iterator over the sample container. */
   const auto beginOfSampleContainer = sampleContainer->cbegin();
-  const auto fbegin = beginOfSampleContainer + pos_begin;
-  const auto fend = beginOfSampleContainer + pos_end;
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
 
-  /** Loop over sample container and compute contribution of each sample to pdfs. */
-  for (auto fiter = fbegin; fiter != fend; ++fiter)
+  /** Optionally store the evaluation of each sample, for the derivative pass. The cache is
+   * indexed by the position of the sample, and is already resized by ComputePDFs().
+   */
+  const bool fillCache = this->m_FillSampleEvaluationCache;
+  assert(!fillCache || (this->m_CachedSampleEvaluations.size() == sampleContainerSize));
+
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = fiter->m_ImageCoordinates;
-    RealType                    movingImageValue;
+    const auto fbegin = beginOfSampleContainer + pos_begin;
+    const auto fend = beginOfSampleContainer + pos_end;
 
-    /** Transform point. */
-    const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
+    /** Transform all fixed image points of the chunk at once. */
+    const MovingImagePointType * const mappedPoints =
+      this->TransformPoints(*sampleContainer, pos_begin, pos_end, threadId);
 
-    /** Check if the point is inside the moving mask. */
-    bool sampleOk = this->IsInsideMovingMask(mappedPoint);
+    auto cacheIter = this->m_CachedSampleEvaluations.begin() + (fillCache ? pos_begin : 0);
 
-    /** Compute the moving image value and check if the point is
-     * inside the moving image buffer.
-     */
-    if (sampleOk)
+    /** Loop over sample container and compute contribution of each sample to pdfs. */
+    for (auto fiter = fbegin; fiter != fend; ++fiter)
     {
-      sampleOk = this->FastEvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr, threadId);
-    }
+      /** Initialize some variables. */
+      RealType                  movingImageValue;
+      MovingImageDerivativeType movingImageDerivative;
 
-    if (sampleOk)
-    {
-      ++numberOfPixelsCounted;
+      /** Get the transformed point. */
+      const MovingImagePointType & mappedPoint = mappedPoints[fiter - fbegin];
 
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast<RealType>(fiter->m_ImageValue);
+      /** Check if the point is inside the moving mask. */
+      bool sampleOk = this->IsInsideMovingMask(mappedPoint);
 
-      /** Make sure the values fall within the histogram range. */
-      fixedImageValue = this->GetFixedImageLimiter()->Evaluate(fixedImageValue);
-      movingImageValue = this->GetMovingImageLimiter()->Evaluate(movingImageValue);
+      /** Compute the moving image value (and its derivative, when it is to be cached)
+       * and check if the point is inside the moving image buffer.
+       */
+      if (sampleOk)
+      {
+        sampleOk = this->FastEvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, fillCache ? &movingImageDerivative : nullptr, threadId);
+      }
 
-      /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateJointPDFAndDerivatives(fixedImageValue, movingImageValue, nullptr, nullptr, jointPDF.GetPointer());
-    }
-  } // end iterating over fixed image spatial sample container for loop
+      if (sampleOk)
+      {
+        ++numberOfPixelsCounted;
+
+        /** Get the fixed image value. */
+        RealType fixedImageValue = static_cast<RealType>(fiter->m_ImageValue);
+
+        /** Make sure the values fall within the histogram range. */
+        fixedImageValue = this->GetFixedImageLimiter()->Evaluate(fixedImageValue);
+        movingImageValue = fillCache ? this->GetMovingImageLimiter()->Evaluate(movingImageValue, movingImageDerivative)
+                                     : this->GetMovingImageLimiter()->Evaluate(movingImageValue);
+
+        /** Compute this sample's contribution to the joint distributions. */
+        this->UpdateJointPDFAndDerivatives(fixedImageValue, movingImageValue, nullptr, nullptr, jointPDF.GetPointer());
+
+        if (fillCache)
+        {
+          cacheIter->m_FixedImageValue = fixedImageValue;
+          cacheIter->m_MovingImageValue = movingImageValue;
+          cacheIter->m_MovingImageDerivative = movingImageDerivative;
+        }
+      }
+
+      if (fillCache)
+      {
+        cacheIter->m_SampleOk = sampleOk;
+        ++cacheIter;
+      }
+    } // end iterating over fixed image spatial sample container for loop
+  }
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted =
@@ -1159,7 +1287,8 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ThreadedComp
 
 template <class TFixedImage, class TMovingImage>
 void
-ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::AfterThreadedComputePDFs() const
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::AfterThreadedComputePDFs(
+  bool includeJointPDFDerivatives) const
 {
   const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
 
@@ -1177,41 +1306,112 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::AfterThreade
   this->CheckNumberOfSamples(sampleContainer->Size(), Superclass::m_NumberOfPixelsCounted);
 
   /** Compute alpha. */
-  this->m_Alpha = 1.0 / static_cast<double>(Superclass::m_NumberOfPixelsCounted);
+  this->m_Alpha = 0.0;
+  if (Superclass::m_NumberOfPixelsCounted > 0)
+  {
+    this->m_Alpha = 1.0 / static_cast<double>(Superclass::m_NumberOfPixelsCounted);
+  }
 
-  /** Accumulate joint histogram. */
-  // could be multi-threaded too, by each thread updating only a part of the JointPDF.
-  using JointPDFIteratorType = ImageScanlineIterator<JointPDFType>;
-  JointPDFIteratorType              it(this->m_JointPDF, this->m_JointPDF->GetBufferedRegion());
-  std::vector<JointPDFIteratorType> itT(numberOfThreads);
-  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+  /** Accumulate the joint histogram (and derivatives) multi-threadedly,
+   * each thread reducing a different block of bins.
+   */
+  this->m_ParzenWindowHistogramThreaderParameters.m_IncludeJointPDFDerivatives = includeJointPDFDerivatives;
+  this->LaunchThreaderCallback(this->ReduceJointPDFsThreaderCallback, &this->m_ParzenWindowHistogramThreaderParameters);
+
+} // end AfterThreadedComputePDFs()
+
+
+/**
+ * ******************* ThreadedReduceJointPDFs *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ThreadedReduceJointPDFs(
+  ThreadIdType workUnitId,
+  ThreadIdType numberOfWorkUnits) const
+{
+  const auto & perThreadVariables = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables;
+  const auto   numberOfThreads = static_cast<ThreadIdType>(perThreadVariables.size());
+
+  /** Determine the block of bins of this work unit. The block size is rounded up
+   * to a whole number of cache lines, to prevent false sharing.
+   */
+  const SizeValueType numberOfBins = this->m_JointPDF->GetBufferedRegion().GetNumberOfPixels();
+  const SizeValueType valuesPerCacheLine = std::max<SizeValueType>(ITK_CACHE_LINE_ALIGNMENT / sizeof(PDFValueType), 1);
+  const SizeValueType binsPerWorkUnit =
+    ((numberOfBins + numberOfWorkUnits - 1) / numberOfWorkUnits + valuesPerCacheLine - 1) / valuesPerCacheLine *
+    valuesPerCacheLine;
+  const SizeValueType bin_begin = std::min<SizeValueType>(binsPerWorkUnit * workUnitId, numberOfBins);
+  const SizeValueType bin_end = std::min<SizeValueType>(binsPerWorkUnit * (workUnitId + 1), numberOfBins);
+  if (bin_begin == bin_end)
   {
-    itT[i] = JointPDFIteratorType(this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[i].st_JointPDF,
-                                  this->m_JointPDF->GetBufferedRegion());
+    return;
   }
 
-  PDFValueType sum;
-  while (!it.IsAtEnd())
+  /** Sum the joint histograms of all threads. */
+  PDFValueType * const jointPDFPointer = this->m_JointPDF->GetBufferPointer();
+  std::copy(perThreadVariables[0].st_JointPDF->GetBufferPointer() + bin_begin,
+            perThreadVariables[0].st_JointPDF->GetBufferPointer() + bin_end,
+            jointPDFPointer + bin_begin);
+  for (ThreadIdType i = 1; i < numberOfThreads; ++i)
   {
-    while (!it.IsAtEndOfLine())
+    const PDFValueType * const threadJointPDFPointer = perThreadVariables[i].st_JointPDF->GetBufferPointer();
+    for (SizeValueType bin = bin_begin; bin < bin_end; ++bin)
     {
-      sum = PDFValueType{};
-      for (ThreadIdType i = 0; i < numberOfThreads; ++i)
-      {
-        sum += itT[i].Value();
-        ++itT[i];
-      }
-      it.Set(sum);
-      ++it;
+      jointPDFPointer[bin] += threadJointPDFPointer[bin];
     }
-    it.NextLine();
-    for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+  }
+
+  if (!this->m_ParzenWindowHistogramThreaderParameters.m_IncludeJointPDFDerivatives)
+  {
+    return;
+  }
+
+  /** Add the joint histogram derivatives of the other threads to the ones of thread 0,
+   * which are already stored in m_JointPDFDerivatives. The parameters are the fastest
+   * running dimension, so a block of bins is a contiguous block of derivatives.
+   */
+  const SizeValueType numberOfParameters = this->GetNumberOfParameters();
+  const SizeValueType deriv_begin = bin_begin * numberOfParameters;
+  const SizeValueType deriv_end = bin_end * numberOfParameters;
+
+  PDFDerivativeValueType * const jointPDFDerivativesPointer = this->m_JointPDFDerivatives->GetBufferPointer();
+  for (ThreadIdType i = 1; i < numberOfThreads; ++i)
+  {
+    const PDFDerivativeValueType * const threadJointPDFDerivativesPointer =
+      perThreadVariables[i].st_JointPDFDerivatives->GetBufferPointer();
+    for (SizeValueType j = deriv_begin; j < deriv_end; ++j)
     {
-      itT[i].NextLine();
+      jointPDFDerivativesPointer[j] += threadJointPDFDerivativesPointer[j];
     }
   }
 
-} // end AfterThreadedComputePDFs()
+} // end ThreadedReduceJointPDFs()
+
+
+/**
+ * **************** ReduceJointPDFsThreaderCallback *******
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ReduceJointPDFsThreaderCallback(void * arg)
+{
+  assert(arg);
+  const auto & infoStruct = *static_cast<ThreadInfoType *>(arg);
+  ThreadIdType workUnitId = infoStruct.WorkUnitID;
+  ThreadIdType numberOfWorkUnits = infoStruct.NumberOfWorkUnits;
+
+  assert(infoStruct.UserData);
+  const auto & userData = *static_cast<ParzenWindowHistogramMultiThreaderParameterType *>(infoStruct.UserData);
+
+  const elastix::Profiler::ScopedTimer profilerTimer("Metric::ThreadedReduceJointPDFs", workUnitId);
+  userData.m_Metric->ThreadedReduceJointPDFs(workUnitId, numberOfWorkUnits);
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ReduceJointPDFsThreaderCallback()
 
 
 /**
@@ -1229,6 +1429,7 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ComputePDFsT
   assert(infoStruct.UserData);
   const auto & userData = *static_cast<ParzenWindowHistogramMultiThreaderParameterType *>(infoStruct.UserData);
 
+  const elastix::Profiler::ScopedTimer profilerTimer("Metric::ThreadedComputePDFs", threadId);
   userData.m_Metric->ThreadedComputePDFs(threadId);
 
   return ITK_THREAD_RETURN_DEFAULT_VALUE;
@@ -1244,13 +1445,7 @@ template <class TFixedImage, class TMovingImage>
 void
 ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::LaunchComputePDFsThreaderCallback() const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod(
-    this->ComputePDFsThreaderCallback,
-    const_cast<void *>(static_cast<const void *>(&this->m_ParzenWindowHistogramThreaderParameters)));
-
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
+  this->LaunchThreaderCallback(this->ComputePDFsThreaderCallback, &this->m_ParzenWindowHistogramThreaderParameters);
 
 } // end LaunchComputePDFsThreaderCallback()
 
@@ -1263,6 +1458,161 @@ template <class TFixedImage, class TMovingImage>
 void
 ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ComputePDFsAndPDFDerivatives(
   const ParametersType & parameters) const
+{
+  /** Option for now to still use the single threaded code. The single threaded code is also used
+   * when the per-thread joint PDF derivatives would exceed MaximumThreadPDFDerivativesMemory.
+   */
+  if (!Superclass::m_UseMultiThread || !this->m_UseThreadedPDFDerivatives)
+  {
+    return this->ComputePDFsAndPDFDerivativesSingleThreaded(parameters);
+  }
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * See ComputePDFs() for details.
+   */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Launch multi-threading JointPDF and JointPDFDerivatives computation. */
+  this->LaunchThreaderCallback(this->ComputePDFsAndPDFDerivativesThreaderCallback,
+                               &this->m_ParzenWindowHistogramThreaderParameters);
+
+  /** Gather the results from all threads. */
+  this->AfterThreadedComputePDFs(true);
+
+} // end ComputePDFsAndPDFDerivatives()
+
+
+/**
+ * ******************* ThreadedComputePDFsAndPDFDerivatives *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ThreadedComputePDFsAndPDFDerivatives(
+  ThreadIdType threadId)
+{
+  /** Get a handle to the pre-allocated joint PDF and joint PDF derivatives for the
+   * current thread. Thread 0 stores its derivatives directly in m_JointPDFDerivatives.
+   * The initialization is performed here, so that it is done multi-threadedly.
+   */
+  auto &            perThreadVariable = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[threadId];
+  JointPDFPointer & jointPDF = perThreadVariable.st_JointPDF;
+  JointPDFDerivativesType * jointPDFDerivatives =
+    threadId == 0 ? this->m_JointPDFDerivatives.GetPointer() : perThreadVariable.st_JointPDFDerivatives.GetPointer();
+  jointPDF->FillBuffer(PDFValueType{});
+  jointPDFDerivatives->FillBuffer(PDFDerivativeValueType{});
+
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** Create iterator over the sample container. */
+  const auto beginOfSampleContainer = sampleContainer->cbegin();
+
+  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
+  NonZeroJacobianIndicesType nzji(Superclass::m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices());
+  DerivativeType             imageJacobian(nzji.size());
+
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
+  {
+    const auto fbegin = beginOfSampleContainer + pos_begin;
+    const auto fend = beginOfSampleContainer + pos_end;
+
+    /** Transform all fixed image points of the chunk at once. */
+    const MovingImagePointType * const mappedPoints =
+      this->TransformPoints(*sampleContainer, pos_begin, pos_end, threadId);
+
+    /** Loop over sample container and compute contribution of each sample to pdfs. */
+    for (auto fiter = fbegin; fiter != fend; ++fiter)
+    {
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = fiter->m_ImageCoordinates;
+      RealType                    movingImageValue;
+      MovingImageDerivativeType   movingImageDerivative;
+
+      /** Get the transformed point. */
+      const MovingImagePointType & mappedPoint = mappedPoints[fiter - fbegin];
+
+      /** Check if the point is inside the moving mask. */
+      bool sampleOk = this->IsInsideMovingMask(mappedPoint);
+
+      /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+       * the point is inside the moving image buffer.
+       */
+      if (sampleOk)
+      {
+        sampleOk = this->FastEvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, &movingImageDerivative, threadId);
+      }
+
+      if (sampleOk)
+      {
+        ++numberOfPixelsCounted;
+
+        /** Get the fixed image value. */
+        RealType fixedImageValue = static_cast<RealType>(fiter->m_ImageValue);
+
+        /** Make sure the values fall within the histogram range. */
+        fixedImageValue = this->GetFixedImageLimiter()->Evaluate(fixedImageValue);
+        movingImageValue = this->GetMovingImageLimiter()->Evaluate(movingImageValue, movingImageDerivative);
+
+        /** Compute the inner product (dM/dx)^T (dT/dmu). */
+        Superclass::m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+          fixedPoint, movingImageDerivative, imageJacobian, nzji);
+
+        /** Update the joint pdf and the joint pdf derivatives. */
+        this->UpdateJointPDFAndDerivatives(
+          fixedImageValue, movingImageValue, &imageJacobian, &nzji, jointPDF.GetPointer(), jointPDFDerivatives);
+      }
+    } // end iterating over fixed image spatial sample container for loop
+  }
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  perThreadVariable.st_NumberOfPixelsCounted = numberOfPixelsCounted;
+
+} // end ThreadedComputePDFsAndPDFDerivatives()
+
+
+/**
+ * **************** ComputePDFsAndPDFDerivativesThreaderCallback *******
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ComputePDFsAndPDFDerivativesThreaderCallback(
+  void * arg)
+{
+  assert(arg);
+  const auto & infoStruct = *static_cast<ThreadInfoType *>(arg);
+  ThreadIdType threadId = infoStruct.WorkUnitID;
+
+  assert(infoStruct.UserData);
+  const auto & userData = *static_cast<ParzenWindowHistogramMultiThreaderParameterType *>(infoStruct.UserData);
+
+  const elastix::Profiler::ScopedTimer profilerTimer("Metric::ThreadedComputePDFsAndPDFDerivatives", threadId);
+  userData.m_Metric->ThreadedComputePDFsAndPDFDerivatives(threadId);
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputePDFsAndPDFDerivativesThreaderCallback()
+
+
+/**
+ * ************************ ComputePDFsAndPDFDerivativesSingleThreaded *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ComputePDFsAndPDFDerivativesSingleThreaded(
+  const ParametersType & parameters) const
 {
   /** Initialize some variables. */
   this->m_JointPDF->FillBuffer(0.0);
@@ -1350,7 +1700,7 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ComputePDFsA
     this->m_Alpha = 1.0 / static_cast<double>(Superclass::m_NumberOfPixelsCounted);
   }
 
-} // end ComputePDFsAndPDFDerivatives()
+} // end ComputePDFsAndPDFDerivativesSingleThreaded()
 
 
 /**
@@ -17,6 +17,7 @@
  *=========================================================================*/
 
 #include "itkScaledSingleValuedCostFunction.h"
+#include "elxProfiler.h"
 #include <vnl/vnl_math.h>
 
 namespace itk
@@ -35,6 +36,8 @@ ScaledSingleValuedCostFunction::ScaledSingleValuedCostFunction() = default;
 ScaledSingleValuedCostFunction::MeasureType
 ScaledSingleValuedCostFunction::GetValue(const ParametersType & parameters) const
 {
+  const elastix::Profiler::ScopedTimer profilerTimer("CostFunction::GetValue");
+
   /** F(y)= f(y/s) */
 
   /** This function also checks if the UnscaledCostFunction has been set */
@@ -73,6 +76,8 @@ ScaledSingleValuedCostFunction::GetValue(const ParametersType & parameters) cons
 void
 ScaledSingleValuedCostFunction::GetDerivative(const ParametersType & parameters, DerivativeType & derivative) const
 {
+  const elastix::Profiler::ScopedTimer profilerTimer("CostFunction::GetDerivative");
+
   /** dF/dy(y)= 1/s * df/dx(y/s) */
 
   /** This function also checks if the UnscaledCostFunction has been set */
@@ -116,6 +121,8 @@ ScaledSingleValuedCostFunction::GetValueAndDerivative(const ParametersType & par
                                                       MeasureType &          value,
                                                       DerivativeType &       derivative) const
 {
+  const elastix::Profiler::ScopedTimer profilerTimer("CostFunction::GetValueAndDerivative");
+
   /** F(y)= f(y/s) */
   /** dF/dy(y)= 1/s * df/dx(y/s) */
 
@@ -153,6 +160,99 @@ ScaledSingleValuedCostFunction::GetValueAndDerivative(const ParametersType & par
 } // end GetValueAndDerivative()
 
 
+/**
+ * **************** GetValueAndDerivativeInBlocks ************************
+ */
+
+bool
+ScaledSingleValuedCostFunction::GetValueAndDerivativeInBlocks(const ParametersType &              parameters,
+                                                              MeasureType &                       value,
+                                                              DerivativeType &                    derivative,
+                                                              const DerivativeBlockFunctionType & blockFunction) const
+{
+  const auto * const unscaledCostFunction =
+    dynamic_cast<const FusedStepCostFunctionInterface *>(this->m_UnscaledCostFunction.GetPointer());
+
+  /** Without support of the unscaled cost function, just compute the whole derivative. */
+  if (unscaledCostFunction == nullptr)
+  {
+    this->GetValueAndDerivative(parameters, value, derivative);
+    return false;
+  }
+
+  const elastix::Profiler::ScopedTimer profilerTimer("CostFunction::GetValueAndDerivative");
+
+  /** This function also checks if the UnscaledCostFunction has been set */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  if (parameters.GetSize() != numberOfParameters)
+  {
+    itkExceptionMacro("Number of parameters is not like the unscaled cost function expects.");
+  }
+
+  const bool         useScales = this->m_UseScales;
+  const bool         negateCostFunction = this->GetNegateCostFunction();
+  const ScalesType & scales = this->GetScales();
+
+  /** Scales the derivative of the block, like GetValueAndDerivative does for the whole derivative,
+   * and passes the block on to the block function of the caller. */
+  const auto scaledBlockFunction = [useScales, negateCostFunction, &scales, &derivative, &blockFunction](
+                                     const unsigned int begin, const unsigned int end) {
+    if (useScales)
+    {
+      for (unsigned int i = begin; i < end; ++i)
+      {
+        derivative[i] /= scales[i];
+      }
+    }
+    if (negateCostFunction)
+    {
+      for (unsigned int i = begin; i < end; ++i)
+      {
+        derivative[i] = -derivative[i];
+      }
+    }
+    blockFunction(begin, end);
+  };
+
+  bool isDerivativeHandedOutInBlocks{ false };
+  if (useScales)
+  {
+    ParametersType scaledParameters = parameters;
+    this->ConvertScaledToUnscaledParameters(scaledParameters);
+    isDerivativeHandedOutInBlocks =
+      unscaledCostFunction->GetValueAndDerivativeInBlocks(scaledParameters, value, derivative, scaledBlockFunction);
+  }
+  else
+  {
+    isDerivativeHandedOutInBlocks =
+      unscaledCostFunction->GetValueAndDerivativeInBlocks(parameters, value, derivative, scaledBlockFunction);
+  }
+
+  /** When the blocks were not handed out, scale the whole derivative afterwards. */
+  if (!isDerivativeHandedOutInBlocks)
+  {
+    if (useScales)
+    {
+      for (unsigned int i = 0; i < numberOfParameters; ++i)
+      {
+        derivative[i] /= scales[i];
+      }
+    }
+    if (negateCostFunction)
+    {
+      derivative = -derivative;
+    }
+  }
+
+  if (negateCostFunction)
+  {
+    value = -value;
+  }
+  return isDerivativeHandedOutInBlocks;
+
+} // end GetValueAndDerivativeInBlocks()
+
+
 /**
  * **************** GetNumberOfParameters ************************
  */
@@ -20,6 +20,7 @@
 #define itkScaledSingleValuedCostFunction_h
 
 #include "itkSingleValuedCostFunction.h"
+#include "itkFusedStepCostFunctionInterface.h"
 #include "itkIntTypes.h" //temp, needed for IdentifierType
 
 namespace itk
@@ -33,10 +34,16 @@ namespace itk
  * By default it does not apply any scaling. Use the method SetUseScales(true)
  * to enable the use of scales.
  *
+ * When the unscaled cost function implements the FusedStepCostFunctionInterface,
+ * GetValueAndDerivativeInBlocks scales (and negates) each block of the derivative
+ * before it passes the block on to the block function of the caller.
+ *
  * \ingroup Numerics
  */
 
-class ScaledSingleValuedCostFunction : public SingleValuedCostFunction
+class ScaledSingleValuedCostFunction
+  : public SingleValuedCostFunction
+  , public FusedStepCostFunctionInterface
 {
 public:
   ITK_DISALLOW_COPY_AND_MOVE(ScaledSingleValuedCostFunction);
@@ -83,6 +90,14 @@ public:
                         MeasureType &          value,
                         DerivativeType &       derivative) const override;
 
+  /** Same procedure as in GetValueAndDerivative, but scales the derivative block by block, when the
+   * unscaled cost function hands out its derivative in blocks. */
+  bool
+  GetValueAndDerivativeInBlocks(const ParametersType &              parameters,
+                                MeasureType &                       value,
+                                DerivativeType &                    derivative,
+                                const DerivativeBlockFunctionType & blockFunction) const override;
+
   /** Ask the UnscaledCostFunction how many parameters it has. */
   NumberOfParametersType
   GetNumberOfParameters() const override;
@@ -0,0 +1,153 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "elxBSplineCoefficientCache.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
+#include "../Core/Main/GTesting/elxCoreMainGTestUtilities.h"
+
+#include <itkBSplineInterpolateImageFunction.h>
+#include <itkImage.h>
+#include <itkImageBufferRange.h>
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+// Using-declaration:
+using elx::CoreMainGTestUtilities::CheckNew;
+using elx::CoreMainGTestUtilities::CreateImage;
+
+namespace
+{
+using ImageType = itk::Image<float, 2>;
+using CoefficientImageType = itk::Image<double, 2>;
+using CacheType = elastix::BSplineCoefficientCache<ImageType, CoefficientImageType>;
+
+auto
+CreateRandomImage()
+{
+  const auto   image = CreateImage<float>(itk::Size<2>{ { 9, 7 } });
+  std::mt19937 randomNumberEngine{};
+  for (auto & pixel : itk::ImageBufferRange<ImageType>{ *image })
+  {
+    pixel = std::uniform_real_distribution<float>{ -100.0f, 100.0f }(randomNumberEngine);
+  }
+  return image;
+}
+} // namespace
+
+
+GTEST_TEST(BSplineCoefficientCache, ComputesCoefficientsOncePerImageAndSplineOrder)
+{
+  CacheType::Clear();
+
+  const auto image = CreateRandomImage();
+
+  auto coefficients = CacheType::GetCoefficients(*image, CacheType::SplineOrderArrayType::Filled(3));
+  ASSERT_NE(coefficients, nullptr);
+  EXPECT_EQ(CacheType::GetCoefficients(*image, CacheType::SplineOrderArrayType::Filled(3)), coefficients);
+  EXPECT_EQ(CacheType::GetNumberOfEntries(), 1U);
+
+  // Other spline orders have other coefficients.
+  EXPECT_NE(CacheType::GetCoefficients(*image, CacheType::SplineOrderArrayType::Filled(2)), coefficients);
+  EXPECT_EQ(CacheType::GetNumberOfEntries(), 2U);
+
+  // A modified image has other coefficients.
+  image->Modified();
+  EXPECT_NE(CacheType::GetCoefficients(*image, CacheType::SplineOrderArrayType::Filled(3)), coefficients);
+
+  // Only the coefficients that are still referenced outside the cache are kept.
+  CacheType::ReleaseUnusedCoefficients();
+  EXPECT_EQ(CacheType::GetNumberOfEntries(), 1U);
+  coefficients = nullptr;
+  CacheType::ReleaseUnusedCoefficients();
+  EXPECT_EQ(CacheType::GetNumberOfEntries(), 0U);
+}
+
+
+GTEST_TEST(BSplineCoefficientCache, MaximumNumberOfEntriesZeroDisablesCache)
+{
+  CacheType::Clear();
+  const auto maximumNumberOfEntries = CacheType::GetMaximumNumberOfEntries();
+  CacheType::SetMaximumNumberOfEntries(0);
+
+  const auto image = CreateRandomImage();
+  const auto coefficients = CacheType::GetCoefficients(*image, CacheType::SplineOrderArrayType::Filled(3));
+  ASSERT_NE(coefficients, nullptr);
+  EXPECT_NE(CacheType::GetCoefficients(*image, CacheType::SplineOrderArrayType::Filled(3)), coefficients);
+  EXPECT_EQ(CacheType::GetNumberOfEntries(), 0U);
+
+  CacheType::SetMaximumNumberOfEntries(maximumNumberOfEntries);
+}
+
+
+// Tests that CachedBSplineInterpolateImageFunction interpolates like the BSplineInterpolateImageFunction of ITK, with
+// and without using the cache, and that interpolators that use the cache share their coefficients.
+GTEST_TEST(CachedBSplineInterpolateImageFunction, SameValuesAsBSplineInterpolateImageFunction)
+{
+  using InterpolatorType = itk::CachedBSplineInterpolateImageFunction<ImageType>;
+
+  CacheType::Clear();
+
+  const auto image = CreateRandomImage();
+
+  const auto expectedInterpolator = CheckNew<itk::BSplineInterpolateImageFunction<ImageType>>();
+  expectedInterpolator->SetSplineOrder(3);
+  expectedInterpolator->SetInputImage(image);
+
+  for (const bool useCoefficientCache : { false, true })
+  {
+    const auto interpolator = CheckNew<InterpolatorType>();
+    interpolator->SetUseCoefficientCache(useCoefficientCache);
+    interpolator->SetSplineOrder(3);
+    interpolator->SetInputImage(image);
+    EXPECT_EQ(CacheType::GetNumberOfEntries(), useCoefficientCache ? 1U : 0U);
+
+    for (const double x : { 0.0, 1.25, 4.5, 8.0 })
+    {
+      for (const double y : { 0.0, 2.75, 6.0 })
+      {
+        itk::ContinuousIndex<double, 2> index;
+        index[0] = x;
+        index[1] = y;
+        EXPECT_NEAR(interpolator->EvaluateAtContinuousIndex(index),
+                    expectedInterpolator->EvaluateAtContinuousIndex(index),
+                    1e-8);
+      }
+    }
+  }
+
+  // The cache entry is released when the last interpolator that uses it is destructed.
+  EXPECT_EQ(CacheType::GetNumberOfEntries(), 0U);
+
+  {
+    std::vector<InterpolatorType::Pointer> interpolators{ CheckNew<InterpolatorType>(), CheckNew<InterpolatorType>() };
+    for (const auto & interpolator : interpolators)
+    {
+      interpolator->UseCoefficientCacheOn();
+      interpolator->SetSplineOrder(3);
+      interpolator->SetInputImage(image);
+    }
+    EXPECT_EQ(CacheType::GetNumberOfEntries(), 1U);
+    interpolators.pop_back();
+    EXPECT_EQ(CacheType::GetNumberOfEntries(), 1U);
+  }
+  EXPECT_EQ(CacheType::GetNumberOfEntries(), 0U);
+}
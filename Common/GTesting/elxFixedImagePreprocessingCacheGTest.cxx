@@ -0,0 +1,105 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "elxFixedImagePreprocessingCache.h"
+#include "elxWorkStealingThreadPool.h"
+#include <gtest/gtest.h>
+
+#include <itkImage.h>
+#include <itkSimpleDataObjectDecorator.h>
+
+#include <atomic>
+#include <stdexcept> // For runtime_error.
+
+// The class to be tested:
+using elastix::FixedImagePreprocessingCache;
+
+
+GTEST_TEST(FixedImagePreprocessingCache, CreatesObjectOncePerKey)
+{
+  using ImageType = itk::Image<float, 2>;
+
+  const auto                cache = FixedImagePreprocessingCache::New();
+  std::atomic<unsigned int> numberOfCreateCalls{ 0 };
+
+  const auto createImage = [&numberOfCreateCalls] {
+    ++numberOfCreateCalls;
+    return ImageType::New();
+  };
+
+  const auto image = cache->GetOrCreate<ImageType>("key", createImage);
+  ASSERT_NE(image, nullptr);
+  EXPECT_EQ(cache->GetOrCreate<ImageType>("key", createImage), image);
+  EXPECT_EQ(numberOfCreateCalls, 1U);
+  EXPECT_EQ(cache->GetNumberOfObjects(), 1U);
+
+  EXPECT_NE(cache->GetOrCreate<ImageType>("other key", createImage), image);
+  EXPECT_EQ(numberOfCreateCalls, 2U);
+  EXPECT_EQ(cache->GetNumberOfObjects(), 2U);
+}
+
+
+GTEST_TEST(FixedImagePreprocessingCache, CreatesObjectOnceForConcurrentCalls)
+{
+  using DecoratorType = itk::SimpleDataObjectDecorator<double>;
+
+  const auto                cache = FixedImagePreprocessingCache::New();
+  std::atomic<unsigned int> numberOfCreateCalls{ 0 };
+
+  elastix::WorkStealingThreadPool::GetInstance().ForkJoin(16, [&cache, &numberOfCreateCalls](unsigned int) {
+    const auto decorator = cache->GetOrCreate<DecoratorType>("key", [&numberOfCreateCalls] {
+      ++numberOfCreateCalls;
+      const auto newDecorator = DecoratorType::New();
+      newDecorator->Set(42.0);
+      return newDecorator;
+    });
+    EXPECT_EQ(decorator->Get(), 42.0);
+  });
+
+  EXPECT_EQ(numberOfCreateCalls, 1U);
+}
+
+
+GTEST_TEST(FixedImagePreprocessingCache, StoresNothingWhenCreateFunctionThrows)
+{
+  using ImageType = itk::Image<float, 2>;
+
+  const auto cache = FixedImagePreprocessingCache::New();
+
+  EXPECT_THROW(cache->GetOrCreate<ImageType>(
+                 "key", []() -> ImageType::Pointer { throw std::runtime_error("Preprocessing failed"); }),
+               std::runtime_error);
+  EXPECT_EQ(cache->GetNumberOfObjects(), 0U);
+
+  EXPECT_NE(cache->GetOrCreate<ImageType>("key", [] { return ImageType::New(); }), nullptr);
+  EXPECT_EQ(cache->GetNumberOfObjects(), 1U);
+}
+
+
+GTEST_TEST(FixedImagePreprocessingCache, ThrowsWhenStoredObjectHasOtherType)
+{
+  using ImageType = itk::Image<float, 2>;
+  using OtherImageType = itk::Image<short, 2>;
+
+  const auto cache = FixedImagePreprocessingCache::New();
+
+  cache->GetOrCreate<ImageType>("key", [] { return ImageType::New(); });
+  EXPECT_THROW(cache->GetOrCreate<OtherImageType>("key", [] { return OtherImageType::New(); }),
+               itk::ExceptionObject);
+}
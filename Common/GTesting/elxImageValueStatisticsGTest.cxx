@@ -0,0 +1,101 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "elxImageValueStatistics.h"
+#include <gtest/gtest.h>
+
+#include <itkMacro.h> // For ExceptionObject.
+
+#include <cmath> // For isnan.
+#include <vector>
+
+// The class to be tested:
+using elastix::ImageValueStatistics;
+
+
+GTEST_TEST(ImageValueStatistics, IsEmptyByDefault)
+{
+  const ImageValueStatistics statistics(0.0, 2.0, 4);
+
+  EXPECT_EQ(statistics.GetNumberOfValues(), 0U);
+  EXPECT_TRUE(std::isnan(statistics.GetMean()));
+  EXPECT_EQ(statistics.GetFractionOfNonPositiveValues(), 0.0);
+  EXPECT_EQ(statistics.GetHistogram(), std::vector<std::uint64_t>(4));
+}
+
+
+GTEST_TEST(ImageValueStatistics, Add)
+{
+  ImageValueStatistics statistics(0.0, 2.0, 4);
+
+  for (const double value : { -1.0, 0.0, 0.25, 0.75, 1.0, 1.5, 3.0 })
+  {
+    statistics.Add(value);
+  }
+
+  EXPECT_EQ(statistics.GetNumberOfValues(), 7U);
+  EXPECT_EQ(statistics.GetMinimum(), -1.0);
+  EXPECT_EQ(statistics.GetMaximum(), 3.0);
+  EXPECT_EQ(statistics.GetMean(), 5.5 / 7.0);
+  EXPECT_EQ(statistics.GetNumberOfNonPositiveValues(), 2U);
+  EXPECT_EQ(statistics.GetFractionOfNonPositiveValues(), 2.0 / 7.0);
+  EXPECT_EQ(statistics.GetNumberOfValuesBelowHistogram(), 1U);
+  EXPECT_EQ(statistics.GetNumberOfValuesAboveHistogram(), 1U);
+  EXPECT_EQ(statistics.GetHistogram(), (std::vector<std::uint64_t>{ 2, 1, 1, 1 }));
+}
+
+
+GTEST_TEST(ImageValueStatistics, IgnoresNaN)
+{
+  ImageValueStatistics statistics(0.0, 1.0, 2);
+  statistics.Add(std::nan(""));
+  EXPECT_EQ(statistics.GetNumberOfValues(), 0U);
+}
+
+
+GTEST_TEST(ImageValueStatistics, MergeEqualsAddingAllValues)
+{
+  const std::vector<double> values{ -0.5, 0.1, 0.2, 0.9, 1.1, 1.9, 2.5 };
+
+  ImageValueStatistics all(0.0, 2.0, 8);
+  ImageValueStatistics first(0.0, 2.0, 8);
+  ImageValueStatistics second(0.0, 2.0, 8);
+
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    all.Add(values[i]);
+    (i % 2 == 0 ? first : second).Add(values[i]);
+  }
+  first.Merge(second);
+
+  EXPECT_EQ(first.GetNumberOfValues(), all.GetNumberOfValues());
+  EXPECT_EQ(first.GetMinimum(), all.GetMinimum());
+  EXPECT_EQ(first.GetMaximum(), all.GetMaximum());
+  EXPECT_DOUBLE_EQ(first.GetMean(), all.GetMean());
+  EXPECT_EQ(first.GetNumberOfNonPositiveValues(), all.GetNumberOfNonPositiveValues());
+  EXPECT_EQ(first.GetHistogram(), all.GetHistogram());
+}
+
+
+GTEST_TEST(ImageValueStatistics, ThrowsOnInvalidHistogram)
+{
+  EXPECT_THROW(ImageValueStatistics(1.0, 1.0, 4), itk::ExceptionObject);
+  EXPECT_THROW(ImageValueStatistics(0.0, 1.0, 0), itk::ExceptionObject);
+  EXPECT_THROW(ImageValueStatistics(0.0, 1.0, 4).Merge(ImageValueStatistics(0.0, 2.0, 4)), itk::ExceptionObject);
+}
@@ -0,0 +1,165 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "elxProfiler.h"
+#include "elxWorkStealingThreadPool.h"
+#include <gtest/gtest.h>
+
+#include <stdexcept> // For runtime_error.
+#include <thread>
+
+// The class to be tested:
+using elastix::Profiler;
+
+
+GTEST_TEST(Profiler, IsDisabledByDefault)
+{
+  EXPECT_FALSE(Profiler::IsEnabled());
+  EXPECT_EQ(Profiler::GetCurrent(), nullptr);
+}
+
+
+GTEST_TEST(Profiler, RecordsNothingWhenDisabled)
+{
+  Profiler profiler;
+
+  Profiler::AddTime("Timer", 1.0);
+  Profiler::AddCount("Counter", 1);
+  {
+    const Profiler::ScopedTimer scopedTimer("ScopedTimer");
+  }
+  {
+    // A scope with a null profiler disables the profiler of an enclosing scope.
+    const Profiler::Scope enclosingScope(&profiler);
+    const Profiler::Scope scope(nullptr);
+    EXPECT_FALSE(Profiler::IsEnabled());
+    Profiler::AddTime("Timer", 1.0);
+  }
+  EXPECT_EQ(profiler.ToJson().find("Timer"), std::string::npos);
+  EXPECT_EQ(profiler.ToJson().find("Counter"), std::string::npos);
+}
+
+
+GTEST_TEST(Profiler, ToJsonGroupsMeasurementsByResolution)
+{
+  Profiler profiler;
+  {
+    const Profiler::Scope scope(&profiler);
+
+    Profiler::AddTime("ReadImages", 0.5);
+    Profiler::SetCurrentResolution(0);
+    Profiler::AddTime("Iteration", 0.25, 1);
+    Profiler::AddTime("Iteration", 0.75, 1);
+    Profiler::AddCount("Samples", 3);
+    Profiler::AddCount("Samples", 4);
+    {
+      const Profiler::ScopedTimer scopedTimer("ScopedTimer");
+    }
+  }
+  EXPECT_FALSE(Profiler::IsEnabled());
+
+  const std::string json = profiler.ToJson();
+
+  EXPECT_NE(json.find("\"resolution\": 0"), std::string::npos);
+  EXPECT_NE(json.find("\"resolution\": null"), std::string::npos);
+  EXPECT_NE(json.find("{ \"name\": \"ReadImages\", \"workUnit\": 0, \"count\": 1, \"totalSeconds\": 0.5"),
+            std::string::npos);
+  EXPECT_NE(json.find("{ \"name\": \"Iteration\", \"workUnit\": 1, \"count\": 2, \"totalSeconds\": 1, "
+                      "\"minSeconds\": 0.25, \"maxSeconds\": 0.75 }"),
+            std::string::npos);
+  EXPECT_NE(json.find("{ \"name\": \"Samples\", \"workUnit\": 0, \"value\": 7 }"), std::string::npos);
+  EXPECT_NE(json.find("\"name\": \"ScopedTimer\""), std::string::npos);
+
+  /** Measurements without a resolution are listed last. */
+  EXPECT_LT(json.find("\"resolution\": 0"), json.find("\"resolution\": null"));
+
+  profiler.Reset();
+  EXPECT_EQ(profiler.ToJson().find("ReadImages"), std::string::npos);
+}
+
+
+GTEST_TEST(Profiler, ScopeRestoresPreviousProfilerWhenExceptionIsThrown)
+{
+  Profiler outerProfiler;
+  Profiler innerProfiler;
+
+  const Profiler::Scope outerScope(&outerProfiler);
+  try
+  {
+    const Profiler::Scope innerScope(&innerProfiler);
+    EXPECT_EQ(Profiler::GetCurrent(), &innerProfiler);
+    throw std::runtime_error("Registration failed");
+  }
+  catch (const std::runtime_error &)
+  {
+    EXPECT_EQ(Profiler::GetCurrent(), &outerProfiler);
+  }
+}
+
+
+// Tests that the profilers of concurrent registrations do not affect each other.
+GTEST_TEST(Profiler, ProfilersOfConcurrentThreadsAreIndependent)
+{
+  Profiler profilers[2];
+
+  const auto profile = [&profilers](const unsigned int index) {
+    const Profiler::Scope scope(&profilers[index]);
+    Profiler::SetCurrentResolution(index);
+    for (int i = 0; i < 1000; ++i)
+    {
+      Profiler::AddCount(index == 0 ? "First" : "Second", 1);
+    }
+  };
+
+  std::thread thread(profile, 1U);
+  profile(0);
+  thread.join();
+
+  const std::string firstJson = profilers[0].ToJson();
+  const std::string secondJson = profilers[1].ToJson();
+
+  EXPECT_NE(firstJson.find("{ \"name\": \"First\", \"workUnit\": 0, \"value\": 1000 }"), std::string::npos);
+  EXPECT_NE(secondJson.find("{ \"name\": \"Second\", \"workUnit\": 0, \"value\": 1000 }"), std::string::npos);
+  EXPECT_EQ(firstJson.find("Second"), std::string::npos);
+  EXPECT_EQ(secondJson.find("First"), std::string::npos);
+  EXPECT_NE(firstJson.find("\"resolution\": 0"), std::string::npos);
+  EXPECT_NE(secondJson.find("\"resolution\": 1"), std::string::npos);
+}
+
+
+// Tests that the work units of ForkJoin record their measurements in the profiler of the calling thread.
+GTEST_TEST(Profiler, ForkJoinWorkUnitsUseProfilerOfCallingThread)
+{
+  constexpr unsigned int numberOfWorkUnits{ 8 };
+
+  Profiler profiler;
+  {
+    const Profiler::Scope scope(&profiler);
+    elastix::WorkStealingThreadPool::GetInstance().ForkJoin(
+      numberOfWorkUnits, [](const unsigned int workUnit) { Profiler::AddCount("WorkUnit", 1, workUnit); });
+  }
+
+  const std::string json = profiler.ToJson();
+
+  for (unsigned int workUnit = 0; workUnit < numberOfWorkUnits; ++workUnit)
+  {
+    EXPECT_NE(json.find("{ \"name\": \"WorkUnit\", \"workUnit\": " + std::to_string(workUnit) + ", \"value\": 1 }"),
+              std::string::npos);
+  }
+}
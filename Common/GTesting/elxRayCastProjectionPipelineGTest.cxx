@@ -0,0 +1,138 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "elxRayCastProjectionPipeline.h"
+#include "elxWorkStealingThreadPool.h"
+#include "../Core/Main/GTesting/elxCoreMainGTestUtilities.h"
+
+#include <itkEuler3DTransform.h>
+#include <itkImage.h>
+#include <itkImageBufferRange.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm> // For equal.
+#include <memory>    // For unique_ptr.
+#include <random>
+#include <vector>
+
+// Using-declaration:
+using elx::CoreMainGTestUtilities::CreateImage;
+
+namespace
+{
+using VolumeType = itk::Image<float, 3>;
+using ProjectionType = itk::Image<float, 3>;
+using RayCasterType = itk::AdvancedRayCastInterpolateImageFunction<VolumeType>;
+using FilterType = itk::AdvancedRayCastProjectionImageFilter<VolumeType, ProjectionType>;
+using PipelineType = elastix::RayCastProjectionPipeline<FilterType>;
+using TransformType = itk::Euler3DTransform<double>;
+
+struct ProjectionSetup
+{
+  TransformType::Pointer transform{ TransformType::New() };
+  RayCasterType::Pointer rayCaster{ RayCasterType::New() };
+  FilterType::Pointer    filter{ FilterType::New() };
+};
+
+/** Sets up a projection of a volume with random values, like the 2D/3D metrics do. */
+ProjectionSetup
+CreateProjectionSetup()
+{
+  const auto   volume = CreateImage<float>(itk::Size<3>{ { 20, 18, 16 } });
+  std::mt19937 randomNumberEngine{};
+  for (auto & pixel : itk::ImageBufferRange<VolumeType>{ *volume })
+  {
+    pixel = std::uniform_real_distribution<float>{ 0.0f, 10.0f }(randomNumberEngine);
+  }
+
+  ProjectionSetup setup;
+  setup.transform->SetRotation(0.1, -0.2, 0.05);
+  setup.transform->SetTranslation(itk::MakeVector(1.5, -2.0, 0.5));
+
+  setup.rayCaster->SetTransform(setup.transform);
+  setup.rayCaster->SetFocalPoint(itk::MakePoint(0.0, 0.0, -400.0));
+  setup.rayCaster->SetThreshold(2.0);
+
+  setup.filter->SetInput(volume);
+  setup.filter->SetInterpolator(setup.rayCaster);
+  setup.filter->SetTransform(setup.transform);
+  setup.filter->SetSize(itk::Size<3>{ { 16, 12, 1 } });
+  setup.filter->SetOutputOrigin(itk::MakePoint(-15.0, -11.0, 100.0));
+  setup.filter->SetOutputSpacing(itk::MakeVector(2.0, 2.0, 1.0));
+  setup.filter->Update();
+  return setup;
+}
+} // namespace
+
+
+GTEST_TEST(RayCastProjectionPipeline, ProjectsConcurrentlyLikeOriginalFilter)
+{
+  const ProjectionSetup setup = CreateProjectionSetup();
+  const auto            originalParameters = setup.transform->GetParameters();
+
+  constexpr unsigned int                     numberOfPipelines{ 6 };
+  std::vector<std::unique_ptr<PipelineType>> pipelines;
+  std::vector<TransformType::ParametersType> parametersOfPipelines;
+
+  for (unsigned int i = 0; i < numberOfPipelines; ++i)
+  {
+    const auto transformClone = setup.transform->Clone();
+    pipelines.push_back(PipelineType::Create(*setup.filter, transformClone));
+    ASSERT_NE(pipelines.back(), nullptr);
+
+    auto parameters = originalParameters;
+    parameters[i] += (i < 3) ? 0.01 : 0.5;
+    parametersOfPipelines.push_back(parameters);
+  }
+
+  // The threshold of the original ray caster is copied by SetTransformParameters.
+  setup.rayCaster->SetThreshold(1.0);
+
+  elastix::WorkStealingThreadPool::GetInstance().ForkJoin(numberOfPipelines, [&](const unsigned int workUnit) {
+    pipelines[workUnit]->SetTransformParameters(parametersOfPipelines[workUnit]);
+    pipelines[workUnit]->GetOutput()->UpdateLargestPossibleRegion();
+  });
+
+  for (unsigned int i = 0; i < numberOfPipelines; ++i)
+  {
+    setup.transform->SetParameters(parametersOfPipelines[i]);
+    setup.filter->Modified();
+    setup.filter->Update();
+
+    const itk::ImageBufferRange<const ProjectionType> expected(*setup.filter->GetOutput());
+    const itk::ImageBufferRange<const ProjectionType> actual(*pipelines[i]->GetOutput());
+    ASSERT_EQ(actual.size(), expected.size());
+    EXPECT_TRUE(std::equal(actual.cbegin(), actual.cend(), expected.cbegin()));
+  }
+}
+
+
+GTEST_TEST(RayCastProjectionPipeline, CreateReturnsNullForDifferentClone)
+{
+  const ProjectionSetup setup = CreateProjectionSetup();
+
+  const auto transformClone = TransformType::New();
+  transformClone->SetParameters(setup.transform->GetParameters());
+  EXPECT_NE(PipelineType::Create(*setup.filter, transformClone), nullptr);
+
+  transformClone->SetTranslation(itk::MakeVector(0.0, 0.0, 0.0));
+  EXPECT_EQ(PipelineType::Create(*setup.filter, transformClone), nullptr);
+  EXPECT_EQ(PipelineType::Create(*setup.filter, nullptr), nullptr);
+}
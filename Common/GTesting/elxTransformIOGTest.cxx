@@ -61,6 +61,7 @@
 #include <cmath> // For M_PI_4.
 #include <typeinfo>
 #include <type_traits> // For extent, is_base_of and is_same
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -592,6 +593,9 @@ Expect_elx_TransformPoint_yields_same_point_as_ITK(const TITKTransform & itkTran
 
   static constexpr auto numberOfTestInputValues = std::extent_v<decltype(testInputValues)>;
 
+  std::vector<itk::Point<double, Dimension>> inputPoints;
+  std::vector<itk::Point<double, Dimension>> actualOutputPoints;
+
   // Use the test input values as coordinates.
   for (const auto index : itk::ZeroBasedIndexRange<Dimension>(itk::Size<Dimension>::Filled(numberOfTestInputValues)))
   {
@@ -606,6 +610,9 @@ Expect_elx_TransformPoint_yields_same_point_as_ITK(const TITKTransform & itkTran
     static_assert(std::is_same_v<decltype(actualOutputPoint), decltype(expectedOutputPoint)>,
                   "elxTransform->TransformPoint must have the expected return type!");
 
+    inputPoints.push_back(inputPoint);
+    actualOutputPoints.push_back(actualOutputPoint);
+
     if (expectedOutputPoint != inputPoint)
     {
       ++numberOfTimesOutputDiffersFromInput;
@@ -628,6 +635,19 @@ Expect_elx_TransformPoint_yields_same_point_as_ITK(const TITKTransform & itkTran
     }
   }
 
+  // The batched TransformPoints must yield the very same points as TransformPoint, one by one.
+  std::vector<itk::Point<double, Dimension>> batchedOutputPoints(inputPoints.size());
+  elxTransform->TransformPoints(inputPoints.data(), batchedOutputPoints.data(), inputPoints.size());
+
+  for (std::size_t i{}; i < inputPoints.size(); ++i)
+  {
+    std::ostringstream actualStream;
+    std::ostringstream batchedStream;
+    actualStream << actualOutputPoints[i];
+    batchedStream << batchedOutputPoints[i];
+    EXPECT_EQ(batchedStream.str(), actualStream.str()) << " inputPoint = " << inputPoints[i];
+  }
+
   // If the output point would always equal the input point, either the test
   // or the transform might not make much sense.
   EXPECT_GT(numberOfTimesOutputDiffersFromInput, 0U);
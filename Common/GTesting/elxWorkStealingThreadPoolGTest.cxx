@@ -0,0 +1,183 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "elxWorkStealingThreadPool.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept> // For runtime_error.
+#include <vector>
+
+// The classes to be tested:
+using elastix::ChunkedRange;
+using elastix::WorkStealingThreadPool;
+
+
+GTEST_TEST(WorkStealingThreadPool, ForkJoinCallsEachWorkUnitOnce)
+{
+  for (const unsigned int numberOfWorkUnits : { 0U, 1U, 2U, 5U, 64U })
+  {
+    std::vector<std::atomic<unsigned int>> numberOfCalls(numberOfWorkUnits);
+
+    WorkStealingThreadPool::GetInstance().ForkJoin(
+      numberOfWorkUnits, [&numberOfCalls](const unsigned int workUnit) { ++numberOfCalls[workUnit]; });
+
+    for (const auto & numberOfCallsOfWorkUnit : numberOfCalls)
+    {
+      EXPECT_EQ(numberOfCallsOfWorkUnit, 1U);
+    }
+  }
+}
+
+
+GTEST_TEST(WorkStealingThreadPool, SupportsNestedForkJoin)
+{
+  constexpr unsigned int outerNumberOfWorkUnits{ 4 };
+  constexpr unsigned int innerNumberOfWorkUnits{ 8 };
+
+  std::atomic<unsigned int> numberOfInnerCalls{ 0 };
+  auto &                    threadPool = WorkStealingThreadPool::GetInstance();
+
+  threadPool.ForkJoin(outerNumberOfWorkUnits, [&threadPool, &numberOfInnerCalls](unsigned int) {
+    threadPool.ForkJoin(innerNumberOfWorkUnits, [&numberOfInnerCalls](unsigned int) { ++numberOfInnerCalls; });
+  });
+
+  EXPECT_EQ(numberOfInnerCalls, outerNumberOfWorkUnits * innerNumberOfWorkUnits);
+}
+
+
+GTEST_TEST(WorkStealingThreadPool, ForkJoinRethrowsExceptionOfWorkUnit)
+{
+  std::atomic<unsigned int> numberOfCalls{ 0 };
+
+  EXPECT_THROW(WorkStealingThreadPool::GetInstance().ForkJoin(4,
+                                                              [&numberOfCalls](const unsigned int workUnit) {
+                                                                ++numberOfCalls;
+                                                                if (workUnit == 3)
+                                                                {
+                                                                  throw std::runtime_error("Work unit failed");
+                                                                }
+                                                              }),
+               std::runtime_error);
+
+  /** The exception is only rethrown after all work units are finished. */
+  EXPECT_EQ(numberOfCalls, 4U);
+}
+
+
+GTEST_TEST(ChunkedRange, CoversRangeExactlyOnce)
+{
+  constexpr unsigned int numberOfWorkUnits{ 3 };
+
+  for (const std::size_t rangeSize : { 0, 1, 63, 64, 65, 1000, 12345 })
+  {
+    std::vector<std::atomic<unsigned int>> numberOfVisits(rangeSize);
+    ChunkedRange                           chunkedRange;
+    chunkedRange.Reset();
+
+    WorkStealingThreadPool::GetInstance().ForkJoin(numberOfWorkUnits, [&](unsigned int) {
+      std::size_t chunkBegin{};
+      std::size_t chunkEnd{};
+      while (chunkedRange.GetNextChunk(rangeSize, numberOfWorkUnits, chunkBegin, chunkEnd))
+      {
+        EXPECT_LT(chunkBegin, chunkEnd);
+        for (std::size_t i = chunkBegin; i < chunkEnd; ++i)
+        {
+          ++numberOfVisits[i];
+        }
+      }
+    });
+
+    for (const auto & numberOfVisitsOfIndex : numberOfVisits)
+    {
+      EXPECT_EQ(numberOfVisitsOfIndex, 1U);
+    }
+  }
+}
+
+
+GTEST_TEST(ChunkedRange, AssignsEachChunkToOneWorkUnitStatically)
+{
+  constexpr unsigned int numberOfWorkUnits{ 3 };
+
+  for (const std::size_t rangeSize : { 0, 1, 63, 64, 65, 1000, 12345 })
+  {
+    std::vector<std::atomic<unsigned int>> numberOfVisits(rangeSize);
+    std::vector<std::vector<std::size_t>>  chunkBeginsOfWorkUnits(numberOfWorkUnits);
+
+    WorkStealingThreadPool::GetInstance().ForkJoin(numberOfWorkUnits, [&](const unsigned int workUnit) {
+      std::size_t chunkBegin{};
+      std::size_t chunkEnd{};
+      while (ChunkedRange::GetNextChunkOfWorkUnit(rangeSize, numberOfWorkUnits, workUnit, chunkBegin, chunkEnd))
+      {
+        EXPECT_LT(chunkBegin, chunkEnd);
+        chunkBeginsOfWorkUnits[workUnit].push_back(chunkBegin);
+        for (std::size_t i = chunkBegin; i < chunkEnd; ++i)
+        {
+          ++numberOfVisits[i];
+        }
+      }
+    });
+
+    for (const auto & numberOfVisitsOfIndex : numberOfVisits)
+    {
+      EXPECT_EQ(numberOfVisitsOfIndex, 1U);
+    }
+
+    /** The chunks of each work unit do not depend on the timing of the threads: a serial run gets the same. */
+    for (unsigned int workUnit = 0; workUnit < numberOfWorkUnits; ++workUnit)
+    {
+      std::vector<std::size_t> expectedChunkBegins;
+      std::size_t              chunkBegin{};
+      std::size_t              chunkEnd{};
+      while (ChunkedRange::GetNextChunkOfWorkUnit(rangeSize, numberOfWorkUnits, workUnit, chunkBegin, chunkEnd))
+      {
+        expectedChunkBegins.push_back(chunkBegin);
+      }
+      EXPECT_EQ(chunkBeginsOfWorkUnits[workUnit], expectedChunkBegins);
+    }
+  }
+}
+
+
+GTEST_TEST(WorkStealingThreadPool, GrowsWithGlobalDefaultNumberOfThreads)
+{
+  const auto originalNumberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  const auto numberOfThreads = WorkStealingThreadPool::GetInstance().GetNumberOfThreads();
+
+  if (numberOfThreads < itk::MultiThreaderBase::GetGlobalMaximumNumberOfThreads())
+  {
+    itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads(numberOfThreads + 1);
+    EXPECT_EQ(WorkStealingThreadPool::GetInstance().GetNumberOfThreads(), numberOfThreads + 1);
+
+    /** The grown pool still calls each work unit once. */
+    std::vector<std::atomic<unsigned int>> numberOfCalls(2 * (numberOfThreads + 1));
+    WorkStealingThreadPool::GetInstance().ForkJoin(
+      static_cast<unsigned int>(numberOfCalls.size()),
+      [&numberOfCalls](const unsigned int workUnit) { ++numberOfCalls[workUnit]; });
+    for (const auto & numberOfCallsOfWorkUnit : numberOfCalls)
+    {
+      EXPECT_EQ(numberOfCallsOfWorkUnit, 1U);
+    }
+    itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads(originalNumberOfThreads);
+  }
+
+  /** The pool does not shrink. */
+  EXPECT_GE(WorkStealingThreadPool::GetInstance().GetNumberOfThreads(), numberOfThreads);
+}
@@ -18,11 +18,19 @@
 
 // First include the header file to be tested:
 #include "itkAdvancedImageToImageMetric.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageFullSampler.h"
 #include "GTesting/elxCoreMainGTestUtilities.h"
+#include "elxGTestUtilities.h"
 #include "elxDefaultConstruct.h"
 #include <itkImage.h>
+#include <itkImageBufferRange.h>
 #include <gtest/gtest.h>
 
+#include <random>
+#include <type_traits> // For is_same_v.
+
 // The template to be tested.
 using itk::AdvancedImageToImageMetric;
 
@@ -206,3 +214,93 @@ GTEST_TEST(AdvancedImageToImageMetric, DefaultConstruct)
     // - GetThreaderTransform(), as it is non-const.
   }
 }
+
+
+// Checks the precision of the derivatives that are accumulated by each thread.
+GTEST_TEST(AdvancedImageToImageMetric, PerThreadDerivativeValueType)
+{
+  using ImageType = itk::Image<float, 2>;
+  using MetricType = AdvancedImageToImageMetric<ImageType, ImageType>;
+
+#ifdef ELASTIX_USE_SINGLE_PRECISION_METRIC_COMPUTATION
+  static_assert(std::is_same_v<MetricType::PerThreadDerivativeValueType, float>);
+#else
+  static_assert(std::is_same_v<MetricType::PerThreadDerivativeValueType, MetricType::DerivativeValueType>);
+#endif
+  static_assert(
+    std::is_same_v<MetricType::PerThreadDerivativeType::ValueType, MetricType::PerThreadDerivativeValueType>);
+}
+
+
+// Checks that the derivative accumulated by each thread, in PerThreadDerivativeValueType, is near the derivative that
+// is accumulated single-threaded, in DerivativeValueType (double). When elastix is built with
+// ELASTIX_USE_SINGLE_PRECISION_METRIC_COMPUTATION, this tests the precision loss of the float accumulation.
+GTEST_TEST(AdvancedImageToImageMetric, PerThreadDerivativeIsNearSingleThreadedDerivative)
+{
+  static constexpr auto         imageDimension = 2U;
+  static constexpr unsigned int splineOrder = 3;
+  using PixelType = float;
+  using ImageType = itk::Image<PixelType, imageDimension>;
+  using MetricType = itk::AdvancedMeanSquaresImageToImageMetric<ImageType, ImageType>;
+  using elx::GTestUtilities::ValueAndDerivative;
+
+  // The tolerance, relative to the largest element of the double-precision derivative. A float has about seven
+  // significant decimal digits, of which some are lost by accumulating the contributions of a few hundred samples.
+  constexpr double relativeTolerance{ std::is_same_v<MetricType::PerThreadDerivativeValueType, float> ? 1e-4
+                                                                                                      : 1e-12 };
+
+  std::mt19937 randomNumberEngine{};
+
+  const auto createRandomImage = [&randomNumberEngine] {
+    const auto image = elx::CoreMainGTestUtilities::CreateImage<PixelType>(itk::Size<imageDimension>::Filled(32));
+    for (auto & pixel : itk::ImageBufferRange<ImageType>{ *image })
+    {
+      pixel = std::uniform_real_distribution<PixelType>{ 0.0f, 100.0f }(randomNumberEngine);
+    }
+    return image;
+  };
+
+  const auto fixedImage = createRandomImage();
+  const auto movingImage = createRandomImage();
+
+  elx::DefaultConstruct<itk::AdvancedBSplineDeformableTransform<double, imageDimension, splineOrder>> transform{};
+  transform.SetGridRegion(itk::ImageRegion<imageDimension>(itk::Size<imageDimension>::Filled(8)));
+  transform.SetGridSpacing(itk::MakeFilled<itk::Vector<double, imageDimension>>(8.0));
+  transform.SetGridOrigin(itk::MakeFilled<itk::Point<double, imageDimension>>(-8.0));
+
+  // Note that transform.GetNumberOfParameters() must be called after SetGridRegion, because GetNumberOfParameters()
+  // internally uses the size of the grid region.
+  itk::OptimizerParameters parameters(transform.GetNumberOfParameters());
+  for (auto & parameter : parameters)
+  {
+    parameter = std::uniform_real_distribution<>{ -1.0, 1.0 }(randomNumberEngine);
+  }
+  transform.SetParameters(parameters);
+
+  const auto getValueAndDerivative = [&fixedImage, &movingImage, &transform, &parameters](const bool useMultiThread) {
+    elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                       imageSampler{};
+    elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>> interpolator{};
+    elx::DefaultConstruct<MetricType>                                             metric{};
+
+    metric.SetUseMultiThread(useMultiThread);
+    metric.SetNumberOfWorkUnits(4);
+    elx::GTestUtilities::InitializeMetric(
+      metric, *fixedImage, *movingImage, imageSampler, transform, interpolator, fixedImage->GetBufferedRegion());
+    return ValueAndDerivative::FromCostFunction(metric, parameters);
+  };
+
+  const ValueAndDerivative expected = getValueAndDerivative(false);
+  const ValueAndDerivative actual = getValueAndDerivative(true);
+
+  const double maximumDerivativeMagnitude = expected.derivative.inf_norm();
+  EXPECT_GT(maximumDerivativeMagnitude, 0.0);
+
+  // The value is accumulated in MeasureType by each thread, whatever PerThreadDerivativeValueType is.
+  EXPECT_NEAR(actual.value, expected.value, 1e-12 * expected.value);
+  ASSERT_EQ(actual.derivative.size(), expected.derivative.size());
+
+  for (unsigned int i = 0; i < expected.derivative.size(); ++i)
+  {
+    EXPECT_NEAR(actual.derivative[i], expected.derivative[i], relativeTolerance * maximumDerivativeMagnitude);
+  }
+}
@@ -378,3 +378,45 @@ GTEST_TEST(AdvancedMeanSquaresImageToImageMetric, DerivativeTranslation)
     }
   }
 }
+
+
+// Tests that an evaluation context of the metric yields the same value as the metric itself, at other parameters than
+// the current parameters of the metric, and that it does not modify the transform of the metric.
+GTEST_TEST(AdvancedMeanSquaresImageToImageMetric, EvaluationContextYieldsSameValue)
+{
+  std::mt19937 randomNumberEngine{};
+
+  static constexpr auto imageDimension = 2U;
+  using PixelType = float;
+  using ImageType = itk::Image<PixelType, imageDimension>;
+
+  const auto imageSize = itk::Size<imageDimension>::Filled(minimumImageSizeValue);
+  const auto fixedImage = CreateImage<PixelType>(imageSize);
+  const auto movingImage = CreateImage<PixelType>(imageSize);
+
+  RandomizePixelValues(*fixedImage, randomNumberEngine);
+  RandomizePixelValues(*movingImage, randomNumberEngine);
+
+  for (const auto interpolator : { CreateInterpolator<itk::AdvancedLinearInterpolateImageFunction<ImageType>>(),
+                                   CreateInterpolator<itk::BSplineInterpolateImageFunction<ImageType>>(),
+                                   CreateInterpolator<itk::NearestNeighborInterpolateImageFunction<ImageType>>() })
+  {
+    elx::DefaultConstruct<itk::AdvancedTranslationTransform<double, imageDimension>>   transform{};
+    elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                            imageSampler{};
+    elx::DefaultConstruct<AdvancedMeanSquaresImageToImageMetric<ImageType, ImageType>> metric{};
+
+    InitializeMetric(
+      metric, *fixedImage, *movingImage, imageSampler, transform, *interpolator, fixedImage->GetBufferedRegion());
+
+    const auto evaluationContext = metric.CreateEvaluationContext();
+    ASSERT_NE(evaluationContext, nullptr);
+    metric.UpdateEvaluationContext(*evaluationContext);
+
+    const auto                     initialParameters = transform.GetParameters();
+    const itk::OptimizerParameters parameters(imageDimension, 0.5);
+
+    const auto value = evaluationContext->GetValue(parameters);
+    EXPECT_EQ(transform.GetParameters(), initialParameters);
+    EXPECT_EQ(value, metric.GetValue(parameters));
+  }
+}
@@ -0,0 +1,168 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "itkAdvancedRayCastProjectionImageFilter.h"
+#include "../Core/Main/GTesting/elxCoreMainGTestUtilities.h"
+
+#include <itkEuler3DTransform.h>
+#include <itkIdentityTransform.h>
+#include <itkImage.h>
+#include <itkImageBufferRange.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+// Using-declaration:
+using elx::CoreMainGTestUtilities::CheckNew;
+using elx::CoreMainGTestUtilities::CreateImage;
+
+namespace
+{
+using VolumeType = itk::Image<float, 3>;
+using ProjectionType = itk::Image<float, 3>;
+using RayCasterType = itk::AdvancedRayCastInterpolateImageFunction<VolumeType>;
+using FilterType = itk::AdvancedRayCastProjectionImageFilter<VolumeType, ProjectionType>;
+using PointType = RayCasterType::PointType;
+
+/** A volume with random values in [0, 1), and a block of random values in [5, 10). */
+auto
+CreateVolumeWithBlock()
+{
+  const auto   volume = CreateImage<float>(itk::Size<3>{ { 20, 18, 16 } });
+  std::mt19937 randomNumberEngine{};
+
+  for (auto & pixel : itk::ImageBufferRange<VolumeType>{ *volume })
+  {
+    pixel = std::uniform_real_distribution<float>{ 0.0f, 1.0f }(randomNumberEngine);
+  }
+  for (itk::ImageRegionIteratorWithIndex<VolumeType> it(volume, volume->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+  {
+    const auto & index = it.GetIndex();
+    if (index[0] >= 6 && index[0] < 12 && index[1] >= 4 && index[1] < 9 && index[2] >= 7 && index[2] < 13)
+    {
+      it.Set(std::uniform_real_distribution<float>{ 5.0f, 10.0f }(randomNumberEngine));
+    }
+  }
+  return volume;
+}
+} // namespace
+
+
+GTEST_TEST(AdvancedRayCastInterpolateImageFunction, IntegratesConstantVolumeAlongAxis)
+{
+  const auto volume = CreateImage<float>(itk::Size<3>{ { 8, 6, 5 } });
+  volume->FillBuffer(2.0f);
+  volume->SetSpacing(itk::MakeVector(0.5, 1.0, 2.0));
+
+  const auto rayCaster = CheckNew<RayCasterType>();
+  rayCaster->SetInputImage(volume);
+  rayCaster->SetTransform(itk::IdentityTransform<double, 3>::New());
+
+  // The ray along the x-axis traverses all 8 voxels of 0.5 mm.
+  const auto point = itk::MakePoint(0.0, 0.0, 0.0);
+  const auto focalPoint = itk::MakePoint(100.0, 0.0, 0.0);
+  EXPECT_DOUBLE_EQ(rayCaster->IntegrateRay(point, focalPoint), 8.0);
+
+  rayCaster->SetThreshold(1.5);
+  EXPECT_DOUBLE_EQ(rayCaster->IntegrateRay(point, focalPoint), 2.0);
+
+  // A ray that passes beside the volume.
+  EXPECT_EQ(rayCaster->IntegrateRay(itk::MakePoint(0.0, 10.0, 0.0), itk::MakePoint(100.0, 10.0, 0.0)), 0.0);
+}
+
+
+GTEST_TEST(AdvancedRayCastInterpolateImageFunction, EarlyExitOnThresholdDoesNotChangeIntegral)
+{
+  const auto volume = CreateVolumeWithBlock();
+
+  const auto rayCaster = CheckNew<RayCasterType>();
+  rayCaster->SetInputImage(volume);
+  rayCaster->SetThreshold(2.0);
+
+  const auto   earlyExitingRayCaster = CheckNew<RayCasterType>();
+  earlyExitingRayCaster->SetInputImage(volume);
+  earlyExitingRayCaster->SetThreshold(2.0);
+  earlyExitingRayCaster->EarlyExitOnThresholdOn();
+
+  std::mt19937 randomNumberEngine{};
+  const auto   randomPoint = [&randomNumberEngine](const double radius) {
+    std::uniform_real_distribution<double> distribution{ -radius, radius };
+    return itk::MakePoint(distribution(randomNumberEngine),
+                          distribution(randomNumberEngine),
+                          distribution(randomNumberEngine));
+  };
+
+  unsigned int numberOfNonZeroIntegrals = 0;
+  for (unsigned int i = 0; i < 1000; ++i)
+  {
+    const PointType point = randomPoint(12.0);
+    const PointType focalPoint = randomPoint(200.0);
+    const double    integral = rayCaster->IntegrateRay(point, focalPoint);
+    EXPECT_EQ(earlyExitingRayCaster->IntegrateRay(point, focalPoint), integral);
+    numberOfNonZeroIntegrals += (integral > 0.0) ? 1 : 0;
+  }
+  EXPECT_GT(numberOfNonZeroIntegrals, 0U);
+
+  // Without voxels above the threshold, all integrals are zero.
+  earlyExitingRayCaster->SetThreshold(10.0);
+  EXPECT_EQ(earlyExitingRayCaster->IntegrateRay(itk::MakePoint(0.0, 0.0, 0.0), itk::MakePoint(0.0, 0.0, 100.0)), 0.0);
+}
+
+
+GTEST_TEST(AdvancedRayCastProjectionImageFilter, EqualsEvaluateOfRayCastInterpolator)
+{
+  const auto volume = CreateVolumeWithBlock();
+
+  const auto transform = itk::Euler3DTransform<double>::New();
+  transform->SetRotation(0.1, -0.2, 0.05);
+  transform->SetTranslation(itk::MakeVector(1.5, -2.0, 0.5));
+
+  const auto rayCaster = CheckNew<RayCasterType>();
+  rayCaster->SetTransform(transform);
+  rayCaster->SetFocalPoint(itk::MakePoint(0.0, 0.0, -400.0));
+  rayCaster->SetThreshold(0.5);
+
+  // The positions of the pixels of the projection are integer, so that they are computed exactly.
+  const auto filter = CheckNew<FilterType>();
+  filter->SetInput(volume);
+  filter->SetInterpolator(rayCaster);
+  filter->SetTransform(transform);
+  filter->SetSize(itk::Size<3>{ { 16, 12, 1 } });
+  filter->SetOutputOrigin(itk::MakePoint(-15.0, -11.0, 100.0));
+  filter->SetOutputSpacing(itk::MakeVector(2.0, 2.0, 1.0));
+  filter->Update();
+
+  const ProjectionType & projection = *(filter->GetOutput());
+  EXPECT_EQ(projection.GetBufferedRegion().GetSize(), filter->GetSize());
+
+  unsigned int numberOfNonZeroPixels = 0;
+  for (itk::ImageRegionConstIteratorWithIndex<ProjectionType> it(&projection, projection.GetBufferedRegion());
+       !it.IsAtEnd();
+       ++it)
+  {
+    PointType point;
+    projection.TransformIndexToPhysicalPoint(it.GetIndex(), point);
+    EXPECT_EQ(it.Get(), static_cast<float>(rayCaster->Evaluate(transform->TransformPoint(point))));
+    numberOfNonZeroPixels += (it.Get() > 0.0f) ? 1 : 0;
+  }
+  EXPECT_GT(numberOfNonZeroPixels, 0U);
+}
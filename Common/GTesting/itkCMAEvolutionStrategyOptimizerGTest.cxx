@@ -0,0 +1,145 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "CMAEvolutionStrategy/itkCMAEvolutionStrategyOptimizer.h"
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+#include <itkSingleValuedCostFunction.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+// The class to be tested.
+using itk::CMAEvolutionStrategyOptimizer;
+
+namespace
+{
+// A cost function whose minimum is at (1, 2, 3, 4), which counts its evaluations.
+class QuadraticCostFunction : public itk::SingleValuedCostFunction
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(QuadraticCostFunction);
+
+  using Self = QuadraticCostFunction;
+  using Superclass = itk::SingleValuedCostFunction;
+  using Pointer = itk::SmartPointer<Self>;
+  itkNewMacro(Self);
+
+  static constexpr unsigned int numberOfParameters{ 4 };
+
+  MeasureType
+  GetValue(const ParametersType & parameters) const override
+  {
+    ++m_NumberOfEvaluations;
+
+    MeasureType value{};
+    for (unsigned int i = 0; i < numberOfParameters; ++i)
+    {
+      const double difference = parameters[i] - (i + 1.0);
+      value += (i + 1.0) * difference * difference;
+    }
+    return value;
+  }
+
+  void
+  GetDerivative(const ParametersType &, DerivativeType &) const override
+  {
+    itkExceptionMacro("The derivative should not be needed by the optimizer.");
+  }
+
+  unsigned int
+  GetNumberOfParameters() const override
+  {
+    return numberOfParameters;
+  }
+
+  unsigned int
+  GetNumberOfEvaluations() const
+  {
+    return m_NumberOfEvaluations;
+  }
+
+protected:
+  QuadraticCostFunction() = default;
+  ~QuadraticCostFunction() override = default;
+
+private:
+  mutable std::atomic<unsigned int> m_NumberOfEvaluations{ 0 };
+};
+
+
+struct OptimizationResult
+{
+  CMAEvolutionStrategyOptimizer::ParametersType position;
+  double                                        value;
+  unsigned long                                 numberOfIterations;
+};
+
+} // namespace
+
+
+// Tests that evaluating the offspring concurrently, by a number of independent cost functions, yields the same
+// optimization result as evaluating them sequentially. The cost function does not draw any random numbers, so both
+// modes draw the very same search directions.
+GTEST_TEST(CMAEvolutionStrategyOptimizer, ConcurrentEvaluationOfPopulationDoesNotChangeResult)
+{
+  const auto optimize = [](const unsigned int numberOfPopulationCostFunctions) {
+    const auto costFunction = QuadraticCostFunction::New();
+    const auto optimizer = CMAEvolutionStrategyOptimizer::New();
+    optimizer->SetCostFunction(costFunction);
+    optimizer->SetInitialPosition(
+      CMAEvolutionStrategyOptimizer::ParametersType(QuadraticCostFunction::numberOfParameters, 0.0));
+    optimizer->SetMaximumNumberOfIterations(30);
+    optimizer->SetPopulationSize(12);
+    optimizer->SetInitialSigma(1.0);
+
+    std::vector<QuadraticCostFunction::Pointer> populationCostFunctions;
+    for (unsigned int i = 0; i < numberOfPopulationCostFunctions; ++i)
+    {
+      populationCostFunctions.push_back(QuadraticCostFunction::New());
+      optimizer->AddPopulationCostFunction(populationCostFunctions.back());
+    }
+    optimizer->SetEvaluatePopulationConcurrently(numberOfPopulationCostFunctions > 0);
+
+    itk::Statistics::MersenneTwisterRandomVariateGenerator::GetInstance()->SetSeed(42);
+    optimizer->StartOptimization();
+
+    for (const auto & populationCostFunction : populationCostFunctions)
+    {
+      // Each additional cost function should have evaluated offspring.
+      EXPECT_GT(populationCostFunction->GetNumberOfEvaluations(), 0U);
+    }
+    return OptimizationResult{ optimizer->GetCurrentPosition(),
+                               optimizer->GetCurrentValue(),
+                               optimizer->GetCurrentIteration() };
+  };
+
+  const auto sequentialResult = optimize(0);
+
+  // Sanity check: the optimization should have approached the minimum.
+  EXPECT_LT(sequentialResult.value, 1.0);
+
+  for (const unsigned int numberOfPopulationCostFunctions : { 1U, 3U })
+  {
+    const auto concurrentResult = optimize(numberOfPopulationCostFunctions);
+    EXPECT_EQ(concurrentResult.position, sequentialResult.position);
+    EXPECT_EQ(concurrentResult.value, sequentialResult.value);
+    EXPECT_EQ(concurrentResult.numberOfIterations, sequentialResult.numberOfIterations);
+  }
+}
@@ -0,0 +1,143 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "MultiMetricMultiResolutionRegistration/itkCombinationImageToImageMetric.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedNormalizedCorrelation/itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkImageFullSampler.h"
+#include "GTesting/elxCoreMainGTestUtilities.h"
+#include "elxGTestUtilities.h"
+#include "elxDefaultConstruct.h"
+#include <itkImage.h>
+#include <itkImageBufferRange.h>
+#include <gtest/gtest.h>
+
+#include <cmath> // For abs.
+#include <random>
+#include <vector>
+
+// The template to be tested.
+using itk::CombinationImageToImageMetric;
+
+using elx::CoreMainGTestUtilities::CreateImage;
+using elx::GTestUtilities::ValueAndDerivative;
+
+namespace
+{
+constexpr auto imageDimension = 3U;
+using PixelType = float;
+using ImageType = itk::Image<PixelType, imageDimension>;
+using CombinationMetricType = CombinationImageToImageMetric<ImageType, ImageType>;
+
+
+itk::SmartPointer<ImageType>
+CreateRandomImage(std::mt19937 & randomNumberEngine)
+{
+  const auto image = CreateImage<PixelType>(itk::Size<imageDimension>{ { 9, 8, 6 } });
+  for (auto & pixel : itk::ImageBufferRange<ImageType>{ *image })
+  {
+    pixel = std::uniform_real_distribution<PixelType>{ 0.0f, 100.0f }(randomNumberEngine);
+  }
+  return image;
+}
+
+
+// Expects the actual value and derivative to be near the expected ones, relative to the expected value, and to the
+// largest derivative element.
+void
+ExpectNear(const ValueAndDerivative & actual, const ValueAndDerivative & expected, const double relativeTolerance)
+{
+  EXPECT_NE(expected.value, 0.0);
+  EXPECT_NEAR(actual.value, expected.value, relativeTolerance * std::abs(expected.value));
+  ASSERT_EQ(actual.derivative.size(), expected.derivative.size());
+  const double maximumDerivativeMagnitude = expected.derivative.inf_norm();
+  EXPECT_GT(maximumDerivativeMagnitude, 0.0);
+  for (unsigned int i = 0; i < expected.derivative.size(); ++i)
+  {
+    EXPECT_NEAR(actual.derivative[i], expected.derivative[i], relativeTolerance * maximumDerivativeMagnitude);
+  }
+}
+
+} // namespace
+
+
+// Tests that sharing the mapped points between the sub metrics does not change the combined value and derivative. The
+// two sub metrics have the same transform, and their own full samplers, which yield equivalent samples, so that they
+// share their mapped points. The combination is evaluated at two different translations, so that the second
+// evaluation reuses the grouping of the sub metrics of the first one, while it must recompute the mapped points.
+GTEST_TEST(CombinationImageToImageMetric, SharingMappedPointsDoesNotChangeResult)
+{
+  std::mt19937 randomNumberEngine{};
+  const auto   fixedImage = CreateRandomImage(randomNumberEngine);
+  const auto   movingImage = CreateRandomImage(randomNumberEngine);
+
+  const auto getValuesAndDerivatives = [&fixedImage, &movingImage](const bool shareMappedPoints) {
+    using MeanSquaresMetricType = itk::AdvancedMeanSquaresImageToImageMetric<ImageType, ImageType>;
+    using NormalizedCorrelationMetricType = itk::AdvancedNormalizedCorrelationImageToImageMetric<ImageType, ImageType>;
+
+    elx::DefaultConstruct<itk::AdvancedTranslationTransform<double, imageDimension>> transform{};
+    elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>>   interpolator{};
+    elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                          meanSquaresSampler{};
+    elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                          normalizedCorrelationSampler{};
+    elx::DefaultConstruct<MeanSquaresMetricType>                                     meanSquaresMetric{};
+    elx::DefaultConstruct<NormalizedCorrelationMetricType>                           normalizedCorrelationMetric{};
+    elx::DefaultConstruct<CombinationMetricType>                                     combinationMetric{};
+
+    meanSquaresMetric.SetImageSampler(&meanSquaresSampler);
+    normalizedCorrelationMetric.SetImageSampler(&normalizedCorrelationSampler);
+
+    combinationMetric.SetNumberOfMetrics(2);
+    combinationMetric.SetMetric(&meanSquaresMetric, 0);
+    combinationMetric.SetMetric(&normalizedCorrelationMetric, 1);
+    combinationMetric.SetMetricWeight(1.0, 0);
+    combinationMetric.SetMetricWeight(1000.0, 1);
+    combinationMetric.SetFixedImage(fixedImage);
+    combinationMetric.SetMovingImage(movingImage);
+    combinationMetric.SetTransform(&transform);
+    combinationMetric.SetInterpolator(&interpolator);
+    combinationMetric.SetFixedImageRegion(fixedImage->GetBufferedRegion());
+
+    meanSquaresMetric.SetUseMultiThread(true);
+    normalizedCorrelationMetric.SetUseMultiThread(true);
+    combinationMetric.SetUseMultiThread(true);
+    combinationMetric.SetShareMappedPoints(shareMappedPoints);
+    combinationMetric.Initialize();
+
+    std::vector<ValueAndDerivative> valuesAndDerivatives;
+
+    for (const double translation : { 0.75, -1.25 })
+    {
+      auto parameters = transform.GetParameters();
+      parameters.Fill(translation);
+      valuesAndDerivatives.push_back(ValueAndDerivative::FromCostFunction(combinationMetric, parameters));
+    }
+    return valuesAndDerivatives;
+  };
+
+  const auto expectedValuesAndDerivatives = getValuesAndDerivatives(false);
+  const auto actualValuesAndDerivatives = getValuesAndDerivatives(true);
+
+  ASSERT_EQ(actualValuesAndDerivatives.size(), expectedValuesAndDerivatives.size());
+
+  for (std::size_t i = 0; i < expectedValuesAndDerivatives.size(); ++i)
+  {
+    ExpectNear(actualValuesAndDerivatives[i], expectedValuesAndDerivatives[i], 1e-12);
+  }
+}
@@ -0,0 +1,114 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "itkComputeJacobianTerms.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "GTesting/elxCoreMainGTestUtilities.h"
+#include "elxDefaultConstruct.h"
+#include <itkImage.h>
+#include <gtest/gtest.h>
+
+#include <cmath> // For abs.
+
+// The template to be tested.
+using itk::ComputeJacobianTerms;
+
+using elx::CoreMainGTestUtilities::CreateImage;
+
+namespace
+{
+constexpr auto imageDimension = 2U;
+using ImageType = itk::Image<float, imageDimension>;
+using TransformType = itk::AdvancedTransform<double, imageDimension, imageDimension>;
+using ComputeJacobianTermsType = ComputeJacobianTerms<ImageType, TransformType>;
+
+struct JacobianTerms
+{
+  double TrC{};
+  double TrCC{};
+  double maxJJ{};
+  double maxJCJ{};
+};
+
+} // namespace
+
+
+// Tests that the multi-threaded computation yields the same Jacobian terms as the single-threaded one, both with the
+// default limit of the memory of the per-thread accumulators, and with a limit that only allows a single accumulator.
+GTEST_TEST(ComputeJacobianTerms, MultiThreadedEqualsSingleThreaded)
+{
+  static constexpr unsigned int splineOrder = 3;
+
+  const auto fixedImage = CreateImage<float>(itk::Size<imageDimension>::Filled(16));
+
+  elx::DefaultConstruct<itk::AdvancedBSplineDeformableTransform<double, imageDimension, splineOrder>> transform{};
+  transform.SetGridRegion(itk::ImageRegion<imageDimension>(itk::Size<imageDimension>::Filled(8)));
+  transform.SetGridSpacing(itk::MakeFilled<itk::Vector<double, imageDimension>>(4.0));
+  transform.SetGridOrigin(itk::MakeFilled<itk::Point<double, imageDimension>>(-4.0));
+
+  // Note that transform.GetNumberOfParameters() must be called after SetGridRegion, because GetNumberOfParameters()
+  // internally uses the size of the grid region.
+  const itk::OptimizerParameters parameters(transform.GetNumberOfParameters(), 0.0);
+  transform.SetParameters(parameters);
+
+  const auto computeJacobianTerms = [&fixedImage, &transform](const bool               useMultiThread,
+                                                              const itk::SizeValueType maximumThreadMemory) {
+    elx::DefaultConstruct<ComputeJacobianTermsType> computer{};
+
+    EXPECT_GT(computer.GetMaximumThreadAccumulatorMemory(), 0);
+
+    computer.SetFixedImage(fixedImage);
+    computer.SetFixedImageRegion(fixedImage->GetBufferedRegion());
+    computer.SetTransform(&transform);
+    computer.SetMaxBandCovSize(192);
+    computer.SetNumberOfBandStructureSamples(10);
+    computer.SetNumberOfJacobianMeasurements(200);
+    computer.SetUseMultiThread(useMultiThread);
+    computer.SetNumberOfWorkUnits(4);
+    computer.SetMaximumThreadAccumulatorMemory(maximumThreadMemory);
+
+    JacobianTerms terms{};
+    computer.Compute(terms.TrC, terms.TrCC, terms.maxJJ, terms.maxJCJ);
+    return terms;
+  };
+
+  const itk::SizeValueType defaultMaximumThreadMemory =
+    elx::DefaultConstruct<ComputeJacobianTermsType>{}.GetMaximumThreadAccumulatorMemory();
+
+  const JacobianTerms expected = computeJacobianTerms(false, defaultMaximumThreadMemory);
+
+  EXPECT_GT(expected.TrC, 0.0);
+  EXPECT_GT(expected.TrCC, 0.0);
+  EXPECT_GT(expected.maxJJ, 0.0);
+  EXPECT_GT(expected.maxJCJ, 0.0);
+
+  // The accumulators are merged in a different order than the samples are accumulated by the single-threaded
+  // computation, so only the rounding errors may differ.
+  constexpr double relativeTolerance{ 1e-12 };
+
+  for (const itk::SizeValueType maximumThreadMemory : { defaultMaximumThreadMemory, itk::SizeValueType{ 0 } })
+  {
+    const JacobianTerms actual = computeJacobianTerms(true, maximumThreadMemory);
+
+    EXPECT_NEAR(actual.TrC, expected.TrC, relativeTolerance * std::abs(expected.TrC));
+    EXPECT_NEAR(actual.TrCC, expected.TrCC, relativeTolerance * std::abs(expected.TrCC));
+    EXPECT_NEAR(actual.maxJJ, expected.maxJJ, relativeTolerance * std::abs(expected.maxJJ));
+    EXPECT_NEAR(actual.maxJCJ, expected.maxJCJ, relativeTolerance * std::abs(expected.maxJCJ));
+  }
+}
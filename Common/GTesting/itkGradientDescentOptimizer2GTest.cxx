@@ -0,0 +1,310 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "StandardGradientDescent/itkGradientDescentOptimizer2.h"
+#include "StandardGradientDescent/itkStandardGradientDescentOptimizer.h"
+#include "AdaptiveStochasticGradientDescent/itkAdaptiveStochasticGradientDescentOptimizer.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "MultiMetricMultiResolutionRegistration/itkCombinationImageToImageMetric.h"
+#include "SumOfPairwiseCorrelationsMetric/itkSumOfPairwiseCorrelationCoefficientsMetric.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkImageFullSampler.h"
+#include "GTesting/elxCoreMainGTestUtilities.h"
+#include "elxGTestUtilities.h"
+#include "elxDefaultConstruct.h"
+#include <itkImage.h>
+#include <itkImageBufferRange.h>
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <random>
+#include <vector>
+
+using elx::CoreMainGTestUtilities::CreateImage;
+using elx::GTestUtilities::InitializeMetric;
+
+namespace
+{
+constexpr auto imageDimension = 3U;
+using PixelType = float;
+using ImageType = itk::Image<PixelType, imageDimension>;
+using ParametersType = itk::OptimizerParameters<double>;
+
+
+itk::SmartPointer<ImageType>
+CreateRandomImage(const itk::Size<imageDimension> & imageSize, std::mt19937 & randomNumberEngine)
+{
+  const auto image = CreateImage<PixelType>(imageSize);
+  for (auto & pixel : itk::ImageBufferRange<ImageType>{ *image })
+  {
+    pixel = std::uniform_real_distribution<PixelType>{ 0.0f, 100.0f }(randomNumberEngine);
+  }
+  return image;
+}
+
+
+// Records for each iteration whether the step was already taken while the derivative was computed.
+template <typename TOptimizer>
+class StepRecordingOptimizer : public TOptimizer
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(StepRecordingOptimizer);
+
+  void
+  AdvanceOneStep() override
+  {
+    m_StepsTakenWithDerivative.push_back(this->m_StepIsTakenWithDerivative);
+    TOptimizer::AdvanceOneStep();
+  }
+
+  std::vector<bool> m_StepsTakenWithDerivative{};
+
+protected:
+  StepRecordingOptimizer() = default;
+  ~StepRecordingOptimizer() override = default;
+};
+
+
+// The settings of the optimizer, which the fused step must take into account.
+struct OptimizerSettings
+{
+  bool useScales;
+  bool maximize;
+};
+
+
+// The final position and value of an optimization, and whether each step was fused with the derivative computation.
+struct OptimizationResult
+{
+  ParametersType    position;
+  double            value;
+  std::vector<bool> stepsTakenWithDerivative;
+};
+
+
+// Runs a few iterations of the specified optimizer on the cost function, starting at the initial position.
+template <typename TOptimizer>
+OptimizationResult
+Optimize(itk::SingleValuedCostFunction & costFunction,
+         const ParametersType &          initialPosition,
+         const OptimizerSettings &       settings,
+         const bool                      useFusedStep)
+{
+  elx::DefaultConstruct<StepRecordingOptimizer<TOptimizer>> optimizer{};
+
+  optimizer.SetCostFunction(&costFunction);
+  optimizer.SetInitialPosition(initialPosition);
+  optimizer.SetNumberOfIterations(4);
+  optimizer.SetParam_a(1e-4);
+  optimizer.SetMaximize(settings.maximize);
+  optimizer.SetUseFusedStep(useFusedStep);
+
+  if (settings.useScales)
+  {
+    // Different scales for neighbouring parameters, so that a mix-up of the scales of a block would be noticed.
+    typename TOptimizer::ScalesType scales(initialPosition.size());
+    for (unsigned int i = 0; i < scales.size(); ++i)
+    {
+      scales[i] = 1.0 + (i % 5);
+    }
+    optimizer.SetScales(scales);
+    optimizer.SetUseScales(true);
+  }
+
+  optimizer.StartOptimization();
+  return { optimizer.GetCurrentPosition(), optimizer.GetValue(), optimizer.m_StepsTakenWithDerivative };
+}
+
+
+// A function that creates a cost function, and passes it to the specified function, which uses it.
+using WithCostFunctionType = std::function<void(const std::function<void(itk::SingleValuedCostFunction &)> &)>;
+
+
+// Expects that the fused step yields exactly the same position and value as the separate step, for each optimizer,
+// with and without scales, both when minimizing and when maximizing. The cost function is created by the specified
+// function, for each optimization, and set to the specified initial position. The fused step is expected to be taken
+// while the derivative is computed, only when the cost function is expected to hand out its derivative in blocks.
+void
+ExpectFusedStepEqualsSeparateStep(const WithCostFunctionType & withCostFunction,
+                                  const ParametersType &       initialPosition,
+                                  const bool                   isDerivativeHandedOutInBlocks)
+{
+  const auto expectFusedStepEqualsSeparateStep = [&](auto optimize) {
+    for (const bool useScales : { false, true })
+    {
+      for (const bool maximize : { false, true })
+      {
+        const OptimizerSettings settings{ useScales, maximize };
+        OptimizationResult      expected{};
+        OptimizationResult      actual{};
+
+        withCostFunction([&](itk::SingleValuedCostFunction & costFunction) {
+          expected = optimize(costFunction, initialPosition, settings, false);
+        });
+        withCostFunction([&](itk::SingleValuedCostFunction & costFunction) {
+          actual = optimize(costFunction, initialPosition, settings, true);
+        });
+
+        EXPECT_NE(expected.position, initialPosition);
+        EXPECT_EQ(actual.position, expected.position);
+        EXPECT_EQ(actual.value, expected.value);
+        EXPECT_EQ(expected.stepsTakenWithDerivative, std::vector<bool>(4, false));
+        EXPECT_EQ(actual.stepsTakenWithDerivative, std::vector<bool>(4, isDerivativeHandedOutInBlocks));
+      }
+    }
+  };
+
+  expectFusedStepEqualsSeparateStep(Optimize<itk::StandardGradientDescentOptimizer>);
+  expectFusedStepEqualsSeparateStep(Optimize<itk::AdaptiveStochasticGradientDescentOptimizer>);
+}
+
+} // namespace
+
+
+// Tests the fused step with a metric that hands out its derivative in blocks. The B-spline transform has so many
+// parameters that each of the two work units of the metric accumulates more than one block of the derivative.
+GTEST_TEST(GradientDescentOptimizer2, FusedStepEqualsSeparateStep)
+{
+  constexpr unsigned int splineOrder{ 3 };
+  using TransformType = itk::AdvancedBSplineDeformableTransform<double, imageDimension, splineOrder>;
+  using MetricType = itk::AdvancedMeanSquaresImageToImageMetric<ImageType, ImageType>;
+
+  std::mt19937 randomNumberEngine{};
+  const auto   imageSize = itk::Size<imageDimension>::Filled(16);
+  const auto   fixedImage = CreateRandomImage(imageSize, randomNumberEngine);
+  const auto   movingImage = CreateRandomImage(imageSize, randomNumberEngine);
+
+  elx::DefaultConstruct<TransformType> transform{};
+  transform.SetGridRegion(itk::ImageRegion<imageDimension>(itk::Size<imageDimension>::Filled(12)));
+  transform.SetGridSpacing(itk::MakeFilled<itk::Vector<double, imageDimension>>(2.0));
+  transform.SetGridOrigin(itk::MakeFilled<itk::Point<double, imageDimension>>(-4.0));
+
+  // Note that transform.GetNumberOfParameters() must be called after SetGridRegion.
+  ParametersType initialPosition(transform.GetNumberOfParameters());
+  for (auto & parameter : initialPosition)
+  {
+    parameter = std::uniform_real_distribution<>{ -0.5, 0.5 }(randomNumberEngine);
+  }
+  ASSERT_GT(initialPosition.size(), 2U * 2048U);
+
+  ExpectFusedStepEqualsSeparateStep(
+    [&](const auto & useCostFunction) {
+      elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                       imageSampler{};
+      elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>> interpolator{};
+      elx::DefaultConstruct<MetricType>                                             metric{};
+
+      // The B-spline transform refers to the parameters it gets, so let it refer to the initial position, instead of
+      // to the parameters of the optimization before.
+      transform.SetParameters(initialPosition);
+
+      metric.SetUseMultiThread(true);
+      metric.SetNumberOfWorkUnits(2);
+      InitializeMetric(
+        metric, *fixedImage, *movingImage, imageSampler, transform, interpolator, fixedImage->GetBufferedRegion());
+      useCostFunction(metric);
+    },
+    initialPosition,
+    true);
+}
+
+
+// Tests that a metric that processes its derivative after the accumulation, because it subtracts the mean, falls back
+// to the separate step, while it still uses the fused step when it does not subtract the mean.
+GTEST_TEST(GradientDescentOptimizer2, FusedStepFallsBackWhenSubtractingMean)
+{
+  using MetricType = itk::SumOfPairwiseCorrelationCoefficientsMetric<ImageType, ImageType>;
+
+  std::mt19937 randomNumberEngine{};
+  const auto   image = CreateRandomImage(itk::Size<imageDimension>{ { 9, 8, 6 } }, randomNumberEngine);
+
+  elx::DefaultConstruct<itk::AdvancedTranslationTransform<double, imageDimension>> transform{};
+
+  ParametersType initialPosition(transform.GetNumberOfParameters());
+  initialPosition[0] = 0.75;
+  initialPosition[1] = -1.25;
+  initialPosition[2] = 0.0;
+
+  for (const bool subtractMean : { false, true })
+  {
+    ExpectFusedStepEqualsSeparateStep(
+      [&](const auto & useCostFunction) {
+        elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                       imageSampler{};
+        elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>> interpolator{};
+        elx::DefaultConstruct<MetricType>                                             metric{};
+
+        metric.SetUseMultiThread(true);
+        metric.SetSubtractMean(subtractMean);
+        InitializeMetric(metric, *image, *image, imageSampler, transform, interpolator, image->GetBufferedRegion());
+        useCostFunction(metric);
+      },
+      initialPosition,
+      !subtractMean);
+  }
+}
+
+
+// Tests that the combination of metrics, which combines the derivatives of its sub metrics, falls back to the separate
+// step.
+GTEST_TEST(GradientDescentOptimizer2, FusedStepFallsBackForCombinationMetric)
+{
+  using MeanSquaresMetricType = itk::AdvancedMeanSquaresImageToImageMetric<ImageType, ImageType>;
+
+  std::mt19937 randomNumberEngine{};
+  const auto   imageSize = itk::Size<imageDimension>{ { 9, 8, 6 } };
+  const auto   fixedImage = CreateRandomImage(imageSize, randomNumberEngine);
+  const auto   movingImage = CreateRandomImage(imageSize, randomNumberEngine);
+
+  elx::DefaultConstruct<itk::AdvancedTranslationTransform<double, imageDimension>> transform{};
+
+  ParametersType initialPosition(transform.GetNumberOfParameters());
+  initialPosition.Fill(0.25);
+
+  ExpectFusedStepEqualsSeparateStep(
+    [&](const auto & useCostFunction) {
+      elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>>    interpolator{};
+      elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                          imageSampler0{};
+      elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                          imageSampler1{};
+      elx::DefaultConstruct<MeanSquaresMetricType>                                     metric0{};
+      elx::DefaultConstruct<MeanSquaresMetricType>                                     metric1{};
+      elx::DefaultConstruct<itk::CombinationImageToImageMetric<ImageType, ImageType>> combinationMetric{};
+
+      metric0.SetImageSampler(&imageSampler0);
+      metric1.SetImageSampler(&imageSampler1);
+      metric0.SetUseMultiThread(true);
+      metric1.SetUseMultiThread(true);
+
+      combinationMetric.SetNumberOfMetrics(2);
+      combinationMetric.SetMetric(&metric0, 0);
+      combinationMetric.SetMetric(&metric1, 1);
+      combinationMetric.SetMetricWeight(1.0, 0);
+      combinationMetric.SetMetricWeight(0.5, 1);
+      combinationMetric.SetFixedImage(fixedImage);
+      combinationMetric.SetMovingImage(movingImage);
+      combinationMetric.SetTransform(&transform);
+      combinationMetric.SetInterpolator(&interpolator);
+      combinationMetric.SetFixedImageRegion(fixedImage->GetBufferedRegion());
+      combinationMetric.SetUseMultiThread(true);
+      combinationMetric.Initialize();
+      useCostFunction(combinationMetric);
+    },
+    initialPosition,
+    false);
+}
@@ -27,12 +27,16 @@
 
 #include <gtest/gtest.h>
 #include <array>
+#include <itkImageMaskSpatialObject.h>
 
 // Using-declarations:
 using elx::CoreMainGTestUtilities::DerefRawPointer;
 using elx::CoreMainGTestUtilities::DerefSmartPointer;
 using elx::CoreMainGTestUtilities::minimumImageSizeValue;
+using elx::CoreMainGTestUtilities::CreateImage;
 using elx::CoreMainGTestUtilities::CreateImageFilledWithSequenceOfNaturalNumbers;
+using elx::CoreMainGTestUtilities::FillImageRegion;
+using elx::CoreMainGTestUtilities::ImageDomain;
 using itk::Statistics::MersenneTwisterRandomVariateGenerator;
 
 
@@ -124,3 +128,147 @@ GTEST_TEST(ImageRandomCoordinateSampler, HasSameOutputWhenUsingMultiThread)
 
   EXPECT_EQ(generateSamples(true), generateSamples(false));
 }
+
+
+// Tests that with a mask, the sampler produces the same output with and without UseMultiThread, as long as
+// UseMultiThreadWithMask is not enabled, both with and without UseMaskSpans.
+GTEST_TEST(ImageRandomCoordinateSampler, MaskedHasSameOutputWhenUsingMultiThreadByDefault)
+{
+  using PixelType = int;
+  static constexpr auto Dimension = 2;
+  using ImageType = itk::Image<PixelType, Dimension>;
+  using SamplerType = itk::ImageRandomCoordinateSampler<ImageType>;
+  using MaskSpatialObjectType = itk::ImageMaskSpatialObject<Dimension>;
+
+  const auto image = CreateImageFilledWithSequenceOfNaturalNumbers<PixelType>(ImageType::SizeType::Filled(8));
+
+  const auto maskImage = CreateImage<MaskSpatialObjectType::PixelType>(ImageDomain(*image));
+  FillImageRegion(*maskImage, itk::Index<Dimension>{ { 2, 3 } }, ImageType::SizeType{ { 3, 2 } });
+
+  const auto maskSpatialObject = MaskSpatialObjectType::New();
+  maskSpatialObject->SetImage(maskImage);
+  maskSpatialObject->Update();
+
+  for (const bool useMaskSpans : { false, true })
+  {
+    const auto generateSamples = [image, maskSpatialObject, useMaskSpans](const bool useMultiThread) {
+      DerefSmartPointer(MersenneTwisterRandomVariateGenerator::GetInstance()).SetSeed(1);
+
+      elx::DefaultConstruct<SamplerType> sampler{};
+      EXPECT_FALSE(sampler.GetUseMultiThreadWithMask());
+      sampler.SetUseMultiThread(useMultiThread);
+      sampler.SetUseMaskSpans(useMaskSpans);
+      sampler.SetNumberOfSamples(100);
+      sampler.SetInput(image);
+      sampler.SetMask(maskSpatialObject);
+      sampler.Update();
+      return std::move(DerefRawPointer(sampler.GetOutput()).CastToSTLContainer());
+    };
+
+    const auto samples = generateSamples(false);
+    EXPECT_FALSE(samples.empty());
+    EXPECT_EQ(generateSamples(true), samples);
+  }
+}
+
+
+// Tests that with a mask, both with and without UseMaskSpans, the multi-threaded sampler produces the same output for
+// the same seed, and only produces samples inside the mask.
+GTEST_TEST(ImageRandomCoordinateSampler, MaskedMultiThreadIsDeterministicAndInsideMask)
+{
+  using PixelType = int;
+  static constexpr auto Dimension = 2;
+  using ImageType = itk::Image<PixelType, Dimension>;
+  using SamplerType = itk::ImageRandomCoordinateSampler<ImageType>;
+  using MaskSpatialObjectType = itk::ImageMaskSpatialObject<Dimension>;
+
+  const auto image = CreateImageFilledWithSequenceOfNaturalNumbers<PixelType>(ImageType::SizeType::Filled(8));
+
+  const auto maskImage = CreateImage<MaskSpatialObjectType::PixelType>(ImageDomain(*image));
+  FillImageRegion(*maskImage, itk::Index<Dimension>{ { 2, 3 } }, ImageType::SizeType{ { 3, 2 } });
+
+  const auto maskSpatialObject = MaskSpatialObjectType::New();
+  maskSpatialObject->SetImage(maskImage);
+  maskSpatialObject->Update();
+
+  const size_t numberOfSamples{ 100 };
+
+  for (const bool useMaskSpans : { false, true })
+  {
+    const auto generateSamples = [image, maskSpatialObject, useMaskSpans, numberOfSamples] {
+      DerefSmartPointer(MersenneTwisterRandomVariateGenerator::GetInstance()).SetSeed(1);
+
+      elx::DefaultConstruct<SamplerType> sampler{};
+      sampler.SetUseMultiThread(true);
+      sampler.SetUseMultiThreadWithMask(true);
+      sampler.SetUseMaskSpans(useMaskSpans);
+      sampler.SetNumberOfSamples(numberOfSamples);
+      sampler.SetInput(image);
+      sampler.SetMask(maskSpatialObject);
+      sampler.Update();
+      return std::move(DerefRawPointer(sampler.GetOutput()).CastToSTLContainer());
+    };
+
+    const auto samples = generateSamples();
+
+    ASSERT_EQ(samples.size(), numberOfSamples);
+    EXPECT_EQ(generateSamples(), samples);
+
+    for (const auto & sample : samples)
+    {
+      EXPECT_TRUE(maskSpatialObject->IsInsideInWorldSpace(sample.m_ImageCoordinates));
+    }
+  }
+}
+
+
+// Tests that with a mask, the multi-threaded sampler produces the same output for the same seed, whatever the number
+// of work units, both with and without UseMaskSpans.
+GTEST_TEST(ImageRandomCoordinateSampler, MaskedMultiThreadIsIndependentOfNumberOfWorkUnits)
+{
+  using PixelType = int;
+  static constexpr auto Dimension = 2;
+  using ImageType = itk::Image<PixelType, Dimension>;
+  using SamplerType = itk::ImageRandomCoordinateSampler<ImageType>;
+  using MaskSpatialObjectType = itk::ImageMaskSpatialObject<Dimension>;
+
+  const auto image = CreateImageFilledWithSequenceOfNaturalNumbers<PixelType>(ImageType::SizeType::Filled(8));
+
+  const auto maskImage = CreateImage<MaskSpatialObjectType::PixelType>(ImageDomain(*image));
+  FillImageRegion(*maskImage, itk::Index<Dimension>{ { 2, 3 } }, ImageType::SizeType{ { 3, 2 } });
+
+  const auto maskSpatialObject = MaskSpatialObjectType::New();
+  maskSpatialObject->SetImage(maskImage);
+  maskSpatialObject->Update();
+
+  // More samples than fit in a single block of samples, which is drawn by a random number generator of its own.
+  const size_t numberOfSamples{ 2000 };
+
+  for (const bool useMaskSpans : { false, true })
+  {
+    const auto generateSamples = [image, maskSpatialObject, useMaskSpans, numberOfSamples](
+                                   const itk::ThreadIdType numberOfWorkUnits) {
+      DerefSmartPointer(MersenneTwisterRandomVariateGenerator::GetInstance()).SetSeed(1);
+
+      elx::DefaultConstruct<SamplerType> sampler{};
+      sampler.SetUseMultiThread(true);
+      sampler.SetUseMultiThreadWithMask(true);
+      sampler.SetNumberOfWorkUnits(numberOfWorkUnits);
+      sampler.GetMultiThreader()->SetNumberOfWorkUnits(numberOfWorkUnits);
+      sampler.SetUseMaskSpans(useMaskSpans);
+      sampler.SetNumberOfSamples(numberOfSamples);
+      sampler.SetInput(image);
+      sampler.SetMask(maskSpatialObject);
+      sampler.Update();
+      return std::move(DerefRawPointer(sampler.GetOutput()).CastToSTLContainer());
+    };
+
+    const auto samples = generateSamples(1);
+    ASSERT_EQ(samples.size(), numberOfSamples);
+
+    for (const itk::ThreadIdType numberOfWorkUnits : { 2, 3, 8 })
+    {
+      EXPECT_EQ(generateSamples(numberOfWorkUnits), samples);
+    }
+  }
+}
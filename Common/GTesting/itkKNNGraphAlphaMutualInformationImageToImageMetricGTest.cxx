@@ -0,0 +1,147 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "KNNGraphAlphaMutualInformation/itkKNNGraphAlphaMutualInformationImageToImageMetric.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkImageFullSampler.h"
+#include "GTesting/elxCoreMainGTestUtilities.h"
+#include "elxGTestUtilities.h"
+#include "elxDefaultConstruct.h"
+#include <itkBSplineInterpolateImageFunction.h>
+#include <itkImage.h>
+#include <itkImageBufferRange.h>
+#include <gtest/gtest.h>
+
+#include <cmath> // For abs.
+#include <functional>
+#include <random>
+#include <vector>
+
+// The template to be tested.
+using itk::KNNGraphAlphaMutualInformationImageToImageMetric;
+
+using elx::CoreMainGTestUtilities::CreateImage;
+using elx::GTestUtilities::InitializeMetric;
+using elx::GTestUtilities::ValueAndDerivative;
+
+namespace
+{
+constexpr auto imageDimension = 2U;
+using PixelType = float;
+using ImageType = itk::Image<PixelType, imageDimension>;
+using KNNMetricType = KNNGraphAlphaMutualInformationImageToImageMetric<ImageType, ImageType>;
+
+
+itk::SmartPointer<ImageType>
+CreateRandomImage(std::mt19937 & randomNumberEngine)
+{
+  // 1200 pixels, so that each of the four work units searches the neighbours of more than one batch of query points.
+  const auto image = CreateImage<PixelType>(itk::Size<imageDimension>{ { 40, 30 } });
+  for (auto & pixel : itk::ImageBufferRange<ImageType>{ *image })
+  {
+    pixel = std::uniform_real_distribution<PixelType>{ 0.0f, 100.0f }(randomNumberEngine);
+  }
+  return image;
+}
+
+} // namespace
+
+
+// Tests that the multi-threaded GetValue and GetValueAndDerivative yield the same results as the single-threaded ones,
+// for each kind of tree and each kind of tree searcher. When multi-threading is on, the three kNN trees are generated
+// concurrently, and the query points are searched in batches, by multiple work units. The work units have their own
+// sums, which are added afterwards, so only the rounding errors may differ.
+GTEST_TEST(KNNGraphAlphaMutualInformationImageToImageMetric, MultiThreadedEqualsSingleThreaded)
+{
+  std::mt19937 randomNumberEngine{};
+  const auto   fixedImage = CreateRandomImage(randomNumberEngine);
+  const auto   movingImage = CreateRandomImage(randomNumberEngine);
+
+  const std::vector<std::function<void(KNNMetricType &)>> setTrees{
+    [](KNNMetricType & metric) { metric.SetANNkDTree(50, "ANN_KD_SL_MIDPT"); },
+    [](KNNMetricType & metric) { metric.SetANNbdTree(50, "ANN_KD_SL_MIDPT", "ANN_BD_SIMPLE"); }
+  };
+  const std::vector<std::function<void(KNNMetricType &)>> setTreeSearchers{
+    [](KNNMetricType & metric) { metric.SetANNStandardTreeSearch(20, 0.0); },
+    [](KNNMetricType & metric) { metric.SetANNPriorityTreeSearch(20, 0.0); },
+    // The squared radius exceeds the squared distance between any two feature vectors, so that each query point has
+    // k neighbours within the radius.
+    [](KNNMetricType & metric) { metric.SetANNFixedRadiusTreeSearch(20, 0.0, 1e6); }
+  };
+
+  const auto getValuesAndDerivatives = [&fixedImage, &movingImage](const bool   useMultiThread,
+                                                                   const auto & setTree,
+                                                                   const auto & setTreeSearcher) {
+    elx::DefaultConstruct<itk::AdvancedTranslationTransform<double, imageDimension>>       transform{};
+    elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                                imageSampler{};
+    elx::DefaultConstruct<itk::BSplineInterpolateImageFunction<ImageType, double, double>> interpolator{};
+    elx::DefaultConstruct<KNNMetricType>                                                   metric{};
+
+    metric.SetAlpha(0.5);
+    setTree(metric);
+    setTreeSearcher(metric);
+    metric.SetUseMultiThread(useMultiThread);
+    metric.SetNumberOfWorkUnits(4);
+    InitializeMetric(
+      metric, *fixedImage, *movingImage, imageSampler, transform, interpolator, fixedImage->GetBufferedRegion());
+
+    std::vector<ValueAndDerivative> valuesAndDerivatives;
+
+    // Evaluate the metric at two different translations, so that the second evaluation reuses the list samples and the
+    // trees of the first one.
+    for (const double translation : { 0.25, -0.75 })
+    {
+      auto parameters = transform.GetParameters();
+      parameters.Fill(translation);
+      const double value = metric.GetValue(parameters);
+      valuesAndDerivatives.push_back(ValueAndDerivative::FromCostFunction(metric, parameters));
+      EXPECT_NEAR(value, valuesAndDerivatives.back().value, 1e-12 * std::abs(value));
+    }
+    return valuesAndDerivatives;
+  };
+
+  constexpr double relativeTolerance{ 1e-10 };
+
+  for (const auto & setTree : setTrees)
+  {
+    for (const auto & setTreeSearcher : setTreeSearchers)
+    {
+      const auto expectedValuesAndDerivatives = getValuesAndDerivatives(false, setTree, setTreeSearcher);
+      const auto actualValuesAndDerivatives = getValuesAndDerivatives(true, setTree, setTreeSearcher);
+
+      ASSERT_EQ(actualValuesAndDerivatives.size(), expectedValuesAndDerivatives.size());
+
+      for (std::size_t i = 0; i < expectedValuesAndDerivatives.size(); ++i)
+      {
+        const ValueAndDerivative & actual = actualValuesAndDerivatives[i];
+        const ValueAndDerivative & expected = expectedValuesAndDerivatives[i];
+
+        EXPECT_NE(expected.value, 0.0);
+        EXPECT_NEAR(actual.value, expected.value, relativeTolerance * std::abs(expected.value));
+        ASSERT_EQ(actual.derivative.size(), expected.derivative.size());
+        const double maximumDerivativeMagnitude = expected.derivative.inf_norm();
+        EXPECT_GT(maximumDerivativeMagnitude, 0.0);
+        for (unsigned int j = 0; j < expected.derivative.size(); ++j)
+        {
+          EXPECT_NEAR(actual.derivative[j], expected.derivative[j], relativeTolerance * maximumDerivativeMagnitude);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,125 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "itkMultiOrderBSplineDecompositionImageFilter.h"
+#include "../Core/Main/GTesting/elxCoreMainGTestUtilities.h"
+
+#include <itkBSplineDecompositionImageFilter.h>
+#include <itkImage.h>
+#include <itkImageBufferRange.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm> // For copy_n.
+#include <random>
+
+// Using-declaration:
+using elx::CoreMainGTestUtilities::CheckNew;
+using elx::CoreMainGTestUtilities::CreateImage;
+
+
+// Tests that the coefficients are the same as those of the (single-threaded) decomposition filter of ITK, for each
+// spline order. The image is large enough along its first dimension to let the causal initialization use its
+// accelerated loop, and has a dimension of size one, which is left unchanged.
+GTEST_TEST(MultiOrderBSplineDecompositionImageFilter, SameCoefficientsAsITKDecomposition)
+{
+  constexpr unsigned int ImageDimension = 3;
+  using InputImageType = itk::Image<float, ImageDimension>;
+  using CoefficientImageType = itk::Image<double, ImageDimension>;
+  using FilterType = itk::MultiOrderBSplineDecompositionImageFilter<InputImageType, CoefficientImageType>;
+  using ExpectedFilterType = itk::BSplineDecompositionImageFilter<InputImageType, CoefficientImageType>;
+
+  const auto image = CreateImage<float>(itk::Size<ImageDimension>{ { 37, 5, 1 } });
+
+  std::mt19937 randomNumberEngine{};
+  for (auto & pixel : itk::ImageBufferRange<InputImageType>{ *image })
+  {
+    pixel = std::uniform_real_distribution<float>{ -100.0f, 100.0f }(randomNumberEngine);
+  }
+
+  for (unsigned int splineOrder = 0; splineOrder <= 5; ++splineOrder)
+  {
+    const auto filter = CheckNew<FilterType>();
+    filter->SetSplineOrder(splineOrder);
+    filter->SetInput(image);
+    filter->Update();
+
+    const auto expectedFilter = CheckNew<ExpectedFilterType>();
+    expectedFilter->SetSplineOrder(splineOrder);
+    expectedFilter->SetInput(image);
+    expectedFilter->Update();
+
+    const itk::ImageBufferRange<const CoefficientImageType> actual{ *filter->GetOutput() };
+    const itk::ImageBufferRange<const CoefficientImageType> expected{ *expectedFilter->GetOutput() };
+    ASSERT_EQ(actual.size(), expected.size());
+
+    for (std::size_t i = 0; i < actual.size(); ++i)
+    {
+      EXPECT_NEAR(actual[i], expected[i], 1e-8);
+    }
+  }
+}
+
+
+// Tests that a spline order of zero for the last dimension makes the decomposition operate on each slice separately.
+GTEST_TEST(MultiOrderBSplineDecompositionImageFilter, ZeroOrderOfLastDimensionDecomposesEachSlice)
+{
+  using InputImageType = itk::Image<float, 3>;
+  using CoefficientImageType = itk::Image<double, 3>;
+  using SliceType = itk::Image<float, 2>;
+  using SliceCoefficientImageType = itk::Image<double, 2>;
+
+  constexpr unsigned int numberOfSlices = 3;
+  const auto             image = CreateImage<float>(itk::Size<3>{ { 11, 6, numberOfSlices } });
+  const auto             slice = CreateImage<float>(itk::Size<2>{ { 11, 6 } });
+
+  std::mt19937 randomNumberEngine{};
+  for (auto & pixel : itk::ImageBufferRange<InputImageType>{ *image })
+  {
+    pixel = std::uniform_real_distribution<float>{ -100.0f, 100.0f }(randomNumberEngine);
+  }
+
+  const auto filter = CheckNew<itk::MultiOrderBSplineDecompositionImageFilter<InputImageType, CoefficientImageType>>();
+  filter->SetSplineOrder(3);
+  filter->SetSplineOrder(2, 0);
+  filter->SetInput(image);
+  filter->Update();
+
+  const itk::ImageBufferRange<const CoefficientImageType> actual{ *filter->GetOutput() };
+  const itk::ImageBufferRange<const InputImageType>       values{ *image };
+  const itk::ImageBufferRange<SliceType>                  sliceValues{ *slice };
+  const std::size_t                                       sliceSize = sliceValues.size();
+
+  for (unsigned int sliceIndex = 0; sliceIndex < numberOfSlices; ++sliceIndex)
+  {
+    std::copy_n(values.cbegin() + sliceIndex * sliceSize, sliceSize, sliceValues.begin());
+    slice->Modified();
+
+    const auto sliceFilter = CheckNew<itk::BSplineDecompositionImageFilter<SliceType, SliceCoefficientImageType>>();
+    sliceFilter->SetSplineOrder(3);
+    sliceFilter->SetInput(slice);
+    sliceFilter->Update();
+
+    const itk::ImageBufferRange<const SliceCoefficientImageType> expected{ *sliceFilter->GetOutput() };
+    for (std::size_t i = 0; i < sliceSize; ++i)
+    {
+      EXPECT_NEAR(actual[sliceIndex * sliceSize + i], expected[i], 1e-8);
+    }
+  }
+}
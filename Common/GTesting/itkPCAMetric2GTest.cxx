@@ -0,0 +1,160 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "PCAMetric2/itkPCAMetric2.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "GTesting/elxCoreMainGTestUtilities.h"
+#include "elxGTestUtilities.h"
+#include "elxDefaultConstruct.h"
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <gtest/gtest.h>
+
+#include <cmath> // For abs, cos and pow.
+#include <random>
+#include <vector>
+
+// The template to be tested.
+using itk::PCAMetric2;
+
+using elx::CoreMainGTestUtilities::CreateImage;
+using elx::GTestUtilities::InitializeMetric;
+using elx::GTestUtilities::ValueAndDerivative;
+
+namespace
+{
+constexpr auto imageDimension = 3U;
+using PixelType = float;
+using ImageType = itk::Image<PixelType, imageDimension>;
+using PCAMetric2Type = PCAMetric2<ImageType, ImageType>;
+
+// The number of images of the stack, along the last dimension.
+constexpr unsigned int numberOfStackImages{ 8 };
+
+
+// Creates a stack of images, each of which is a weighted sum of random patterns. The weights of the patterns are
+// orthogonal cosines along the stack, and their scales halve from one pattern to the next, so that the correlation
+// matrix of the stack has well separated eigenvalues. PCAMetric2 uses all eigenvectors, so this keeps its derivative
+// well-conditioned.
+itk::SmartPointer<ImageType>
+CreateStackOfPatterns(std::mt19937 & randomNumberEngine)
+{
+  const auto image = CreateImage<PixelType>(itk::Size<imageDimension>{ { 8, 8, numberOfStackImages } });
+
+  std::vector<std::vector<double>> patterns(numberOfStackImages - 1, std::vector<double>(8 * 8));
+  for (auto & pattern : patterns)
+  {
+    for (double & value : pattern)
+    {
+      value = std::uniform_real_distribution<>{ -1.0, 1.0 }(randomNumberEngine);
+    }
+  }
+
+  for (itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+  {
+    const auto   index = it.GetIndex();
+    const auto   stackIndex = static_cast<unsigned int>(index[2]);
+    const auto   patternIndex = static_cast<std::size_t>(index[0] + 8 * index[1]);
+    double       value{ 100.0 };
+    unsigned int p{ 0 };
+    for (const auto & pattern : patterns)
+    {
+      const double weight =
+        std::cos(M_PI * (p + 1) * (stackIndex + 0.5) / numberOfStackImages) * std::pow(2.0, numberOfStackImages - p);
+      value += weight * pattern[patternIndex];
+      ++p;
+    }
+    it.Set(static_cast<PixelType>(value));
+  }
+  return image;
+}
+
+} // namespace
+
+
+// Tests that the multi-threaded GetValue and GetValueAndDerivative yield the same results as the single-threaded ones.
+// The work units compute the means and centered Gram matrices of their own samples, which are combined afterwards, so
+// only the rounding errors may differ.
+GTEST_TEST(PCAMetric2, MultiThreadedEqualsSingleThreaded)
+{
+  std::mt19937 randomNumberEngine{};
+  const auto   image = CreateStackOfPatterns(randomNumberEngine);
+
+  elx::DefaultConstruct<itk::AdvancedBSplineDeformableTransform<double, imageDimension, 3>> transform{};
+  transform.SetGridRegion(itk::ImageRegion<imageDimension>(itk::Size<imageDimension>{ { 5, 5, 5 } }));
+  transform.SetGridSpacing(itk::MakeFilled<itk::Vector<double, imageDimension>>(4.0));
+  transform.SetGridOrigin(itk::MakeFilled<itk::Point<double, imageDimension>>(-4.0));
+
+  // Note that transform.GetNumberOfParameters() must be called after SetGridRegion, because GetNumberOfParameters()
+  // internally uses the size of the grid region.
+  std::vector<itk::OptimizerParameters<double>> parameterSets(
+    2, itk::OptimizerParameters<double>(transform.GetNumberOfParameters()));
+  for (auto & parameters : parameterSets)
+  {
+    for (double & parameter : parameters)
+    {
+      parameter = std::uniform_real_distribution<>{ -0.25, 0.25 }(randomNumberEngine);
+    }
+  }
+  transform.SetParameters(parameterSets.front());
+
+  const auto getValuesAndDerivatives = [&image, &transform, &parameterSets](const bool useMultiThread) {
+    elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                       imageSampler{};
+    elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>> interpolator{};
+    elx::DefaultConstruct<PCAMetric2Type>                                         metric{};
+
+    metric.SetUseMultiThread(useMultiThread);
+    metric.SetNumberOfWorkUnits(4);
+    InitializeMetric(metric, *image, *image, imageSampler, transform, interpolator, image->GetBufferedRegion());
+
+    std::vector<ValueAndDerivative> valuesAndDerivatives;
+    for (const auto & parameters : parameterSets)
+    {
+      const double value = metric.GetValue(parameters);
+      valuesAndDerivatives.push_back(ValueAndDerivative::FromCostFunction(metric, parameters));
+      EXPECT_NEAR(value, valuesAndDerivatives.back().value, 1e-12 * std::abs(value));
+    }
+    return valuesAndDerivatives;
+  };
+
+  const auto expectedValuesAndDerivatives = getValuesAndDerivatives(false);
+  const auto actualValuesAndDerivatives = getValuesAndDerivatives(true);
+
+  ASSERT_EQ(actualValuesAndDerivatives.size(), expectedValuesAndDerivatives.size());
+
+  constexpr double relativeTolerance{ 1e-10 };
+
+  for (std::size_t i = 0; i < expectedValuesAndDerivatives.size(); ++i)
+  {
+    const ValueAndDerivative & actual = actualValuesAndDerivatives[i];
+    const ValueAndDerivative & expected = expectedValuesAndDerivatives[i];
+
+    EXPECT_NE(expected.value, 0.0);
+    EXPECT_NEAR(actual.value, expected.value, relativeTolerance * std::abs(expected.value));
+    ASSERT_EQ(actual.derivative.size(), expected.derivative.size());
+    const double maximumDerivativeMagnitude = expected.derivative.inf_norm();
+    EXPECT_GT(maximumDerivativeMagnitude, 0.0);
+    for (unsigned int j = 0; j < expected.derivative.size(); ++j)
+    {
+      EXPECT_NEAR(actual.derivative[j], expected.derivative[j], relativeTolerance * maximumDerivativeMagnitude);
+    }
+  }
+}
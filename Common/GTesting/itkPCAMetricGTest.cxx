@@ -0,0 +1,278 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "PCAMetric/itkPCAMetric_F_multithreaded.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkImageFullSampler.h"
+#include "GTesting/elxCoreMainGTestUtilities.h"
+#include "elxGTestUtilities.h"
+#include "elxDefaultConstruct.h"
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <vnl/algo/vnl_symmetric_eigensystem.h>
+#include <vnl/vnl_diag_matrix.h>
+#include <gtest/gtest.h>
+
+#include <cmath> // For abs, cos and pow.
+#include <random>
+#include <vector>
+
+// The template to be tested.
+using itk::PCAMetric;
+
+using elx::CoreMainGTestUtilities::CreateImage;
+using elx::GTestUtilities::InitializeMetric;
+using elx::GTestUtilities::ValueAndDerivative;
+
+namespace
+{
+constexpr auto imageDimension = 3U;
+using PixelType = float;
+using ImageType = itk::Image<PixelType, imageDimension>;
+using PCAMetricType = PCAMetric<ImageType, ImageType>;
+
+// The number of images of the stack, along the last dimension.
+constexpr unsigned int numberOfStackImages{ 8 };
+
+// The number of eigenvalues used by the metric. Its leading-eigenpairs mode iterates on a subspace of twice this
+// size, which must be smaller than the number of images of the stack.
+constexpr unsigned int numberOfEigenValues{ 2 };
+
+
+// Exposes the protected member function ComputeEigenPairs of the metric.
+class PCAMetricWithPublicEigenPairs : public PCAMetricType
+{
+public:
+  using PCAMetricType::ComputeEigenPairs;
+};
+
+
+// Creates a stack of images, each of which is a weighted sum of random patterns. The weights of the patterns are
+// orthogonal cosines along the stack, and their scales halve from one pattern to the next, so that the correlation
+// matrix of the stack has well separated eigenvalues.
+itk::SmartPointer<ImageType>
+CreateStackOfPatterns(std::mt19937 & randomNumberEngine)
+{
+  const auto image = CreateImage<PixelType>(itk::Size<imageDimension>{ { 8, 8, numberOfStackImages } });
+
+  std::vector<std::vector<double>> patterns(numberOfStackImages - 1, std::vector<double>(8 * 8));
+  for (auto & pattern : patterns)
+  {
+    for (double & value : pattern)
+    {
+      value = std::uniform_real_distribution<>{ -1.0, 1.0 }(randomNumberEngine);
+    }
+  }
+
+  for (itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+  {
+    const auto   index = it.GetIndex();
+    const auto   stackIndex = static_cast<unsigned int>(index[2]);
+    const auto   patternIndex = static_cast<std::size_t>(index[0] + 8 * index[1]);
+    double       value{ 100.0 };
+    unsigned int p{ 0 };
+    for (const auto & pattern : patterns)
+    {
+      const double weight =
+        std::cos(M_PI * (p + 1) * (stackIndex + 0.5) / numberOfStackImages) * std::pow(2.0, numberOfStackImages - p);
+      value += weight * pattern[patternIndex];
+      ++p;
+    }
+    it.Set(static_cast<PixelType>(value));
+  }
+  return image;
+}
+
+
+// Creates a B-spline transform whose grid covers the stack, and two sets of random parameters.
+template <typename TTransform>
+std::vector<itk::OptimizerParameters<double>>
+InitializeBSplineTransform(TTransform & transform, std::mt19937 & randomNumberEngine)
+{
+  transform.SetGridRegion(itk::ImageRegion<imageDimension>(itk::Size<imageDimension>{ { 5, 5, 5 } }));
+  transform.SetGridSpacing(itk::MakeFilled<itk::Vector<double, imageDimension>>(4.0));
+  transform.SetGridOrigin(itk::MakeFilled<itk::Point<double, imageDimension>>(-4.0));
+
+  // Note that transform.GetNumberOfParameters() must be called after SetGridRegion, because GetNumberOfParameters()
+  // internally uses the size of the grid region.
+  std::vector<itk::OptimizerParameters<double>> parameterSets(
+    2, itk::OptimizerParameters<double>(transform.GetNumberOfParameters()));
+  for (auto & parameters : parameterSets)
+  {
+    for (double & parameter : parameters)
+    {
+      parameter = std::uniform_real_distribution<>{ -0.25, 0.25 }(randomNumberEngine);
+    }
+  }
+  transform.SetParameters(parameterSets.front());
+  return parameterSets;
+}
+
+
+// Returns the tolerance of the results of the metric, relative to the expected results. The subspace iteration
+// converges to a residual of about 1e-8 times the highest eigenvalue, so the results of the leading-eigenpairs mode
+// are less accurate than the rounding errors of the threaded accumulation.
+double
+GetRelativeTolerance(const bool computeLeadingEigenPairsOnly)
+{
+  return computeLeadingEigenPairsOnly ? 1e-6 : 1e-10;
+}
+
+
+// Expects the actual value and derivative to be near the expected ones, relative to the expected value, and to the
+// largest derivative element.
+void
+ExpectNear(const ValueAndDerivative & actual, const ValueAndDerivative & expected, const double relativeTolerance)
+{
+  EXPECT_NE(expected.value, 0.0);
+  EXPECT_NEAR(actual.value, expected.value, relativeTolerance * std::abs(expected.value));
+  ASSERT_EQ(actual.derivative.size(), expected.derivative.size());
+  const double maximumDerivativeMagnitude = expected.derivative.inf_norm();
+  EXPECT_GT(maximumDerivativeMagnitude, 0.0);
+  for (unsigned int i = 0; i < expected.derivative.size(); ++i)
+  {
+    EXPECT_NEAR(actual.derivative[i], expected.derivative[i], relativeTolerance * maximumDerivativeMagnitude);
+  }
+}
+
+} // namespace
+
+
+// Tests that the multi-threaded GetValue and GetValueAndDerivative yield the same results as the single-threaded
+// ones, with and without ComputeLeadingEigenPairsOnly. The metric is evaluated at two sets of parameters, so that in
+// the leading-eigenpairs mode, the later evaluations start the subspace iteration from the eigenvectors of the
+// earlier ones.
+GTEST_TEST(PCAMetric, MultiThreadedEqualsSingleThreaded)
+{
+  std::mt19937 randomNumberEngine{};
+  const auto   image = CreateStackOfPatterns(randomNumberEngine);
+
+  elx::DefaultConstruct<itk::AdvancedBSplineDeformableTransform<double, imageDimension, 3>> transform{};
+  const auto parameterSets = InitializeBSplineTransform(transform, randomNumberEngine);
+
+  const auto getValuesAndDerivatives = [&image, &transform, &parameterSets](const bool useMultiThread,
+                                                                            const bool computeLeadingEigenPairsOnly) {
+    elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                       imageSampler{};
+    elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>> interpolator{};
+    elx::DefaultConstruct<PCAMetricType>                                          metric{};
+
+    metric.SetNumEigenValues(numberOfEigenValues);
+    metric.SetComputeLeadingEigenPairsOnly(computeLeadingEigenPairsOnly);
+    metric.SetUseMultiThread(useMultiThread);
+    metric.SetNumberOfWorkUnits(4);
+    InitializeMetric(metric, *image, *image, imageSampler, transform, interpolator, image->GetBufferedRegion());
+
+    std::vector<ValueAndDerivative> valuesAndDerivatives;
+    for (const auto & parameters : parameterSets)
+    {
+      const double value = metric.GetValue(parameters);
+      valuesAndDerivatives.push_back(ValueAndDerivative::FromCostFunction(metric, parameters));
+      EXPECT_NEAR(value,
+                  valuesAndDerivatives.back().value,
+                  GetRelativeTolerance(computeLeadingEigenPairsOnly) * std::abs(value));
+    }
+    return valuesAndDerivatives;
+  };
+
+  const auto expectedValuesAndDerivatives = getValuesAndDerivatives(false, false);
+
+  for (const bool computeLeadingEigenPairsOnly : { false, true })
+  {
+    const double relativeTolerance = GetRelativeTolerance(computeLeadingEigenPairsOnly);
+
+    for (const bool useMultiThread : { false, true })
+    {
+      const auto actualValuesAndDerivatives = getValuesAndDerivatives(useMultiThread, computeLeadingEigenPairsOnly);
+      ASSERT_EQ(actualValuesAndDerivatives.size(), expectedValuesAndDerivatives.size());
+
+      for (std::size_t i = 0; i < expectedValuesAndDerivatives.size(); ++i)
+      {
+        ExpectNear(actualValuesAndDerivatives[i], expectedValuesAndDerivatives[i], relativeTolerance);
+      }
+    }
+  }
+}
+
+
+// Tests that ComputeLeadingEigenPairsOnly yields the leading eigenvalues and eigenvectors of the full eigensystem, as
+// computed by vnl_symmetric_eigensystem. The first call computes the full eigensystem, the second one starts the
+// subspace iteration from its eigenvectors, for a slightly different matrix.
+GTEST_TEST(PCAMetric, LeadingEigenPairsEqualThoseOfFullEigensystem)
+{
+  using MatrixType = PCAMetricType::MatrixType;
+
+  std::mt19937 randomNumberEngine{};
+  const auto   image = CreateStackOfPatterns(randomNumberEngine);
+
+  elx::DefaultConstruct<itk::AdvancedTranslationTransform<double, imageDimension>> transform{};
+  elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                          imageSampler{};
+  elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>>    interpolator{};
+  elx::DefaultConstruct<PCAMetricWithPublicEigenPairs>                             metric{};
+
+  metric.SetNumEigenValues(numberOfEigenValues);
+  metric.SetComputeLeadingEigenPairsOnly(true);
+  InitializeMetric(metric, *image, *image, imageSampler, transform, interpolator, image->GetBufferedRegion());
+
+  // Create a random symmetric matrix, and a matrix with its (orthonormal) eigenvectors, and with eigenvalues that halve
+  // from one to the next.
+  MatrixType randomMatrix(numberOfStackImages, numberOfStackImages);
+  for (unsigned int i = 0; i < numberOfStackImages; ++i)
+  {
+    for (unsigned int j = 0; j < numberOfStackImages; ++j)
+    {
+      randomMatrix(i, j) = std::uniform_real_distribution<>{ -1.0, 1.0 }(randomNumberEngine);
+    }
+  }
+  const MatrixType                        symmetricMatrix = randomMatrix + randomMatrix.transpose();
+  const vnl_symmetric_eigensystem<double> randomEigensystem(symmetricMatrix);
+  vnl_diag_matrix<double>                 eigenValueMatrix(numberOfStackImages);
+  for (unsigned int i = 0; i < numberOfStackImages; ++i)
+  {
+    eigenValueMatrix(i, i) = std::pow(0.5, i);
+  }
+  const MatrixType matrix = randomEigensystem.V * eigenValueMatrix * randomEigensystem.V.transpose();
+
+  for (const MatrixType & K : { matrix, MatrixType(matrix + 1e-3 * symmetricMatrix) })
+  {
+    vnl_vector<double> eigenValues;
+    MatrixType         eigenVectors;
+    metric.ComputeEigenPairs(K, eigenValues, eigenVectors);
+
+    ASSERT_EQ(eigenValues.size(), numberOfEigenValues);
+    ASSERT_EQ(eigenVectors.rows(), numberOfStackImages);
+    ASSERT_EQ(eigenVectors.cols(), numberOfEigenValues);
+
+    // The eigenvalues of vnl_symmetric_eigensystem are in ascending order.
+    const vnl_symmetric_eigensystem<double> expectedEigensystem(K);
+
+    const double highestEigenValue = expectedEigensystem.get_eigenvalue(numberOfStackImages - 1);
+
+    for (unsigned int i = 0; i < numberOfEigenValues; ++i)
+    {
+      const unsigned int expectedIndex = numberOfStackImages - 1 - i;
+      EXPECT_NEAR(eigenValues[i], expectedEigensystem.get_eigenvalue(expectedIndex), 1e-6 * highestEigenValue);
+
+      // An eigenvector is only determined up to its sign.
+      const vnl_vector<double> expectedEigenVector = expectedEigensystem.get_eigenvector(expectedIndex);
+      EXPECT_NEAR(std::abs(dot_product(eigenVectors.get_column(i), expectedEigenVector)), 1.0, 1e-6);
+    }
+  }
+}
@@ -0,0 +1,196 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkImageFullSampler.h"
+#include "GTesting/elxCoreMainGTestUtilities.h"
+#include "elxGTestUtilities.h"
+#include "elxDefaultConstruct.h"
+#include <itkImage.h>
+#include <itkImageBufferRange.h>
+#include <gtest/gtest.h>
+
+#include <cmath> // For abs.
+#include <random>
+
+// The template to be tested.
+using itk::ParzenWindowMutualInformationImageToImageMetric;
+
+using elx::CoreMainGTestUtilities::CreateImage;
+using elx::GTestUtilities::InitializeMetric;
+using elx::GTestUtilities::ValueAndDerivative;
+
+namespace
+{
+constexpr auto imageDimension = 3U;
+using PixelType = float;
+using ImageType = itk::Image<PixelType, imageDimension>;
+using MetricType = ParzenWindowMutualInformationImageToImageMetric<ImageType, ImageType>;
+
+
+itk::SmartPointer<ImageType>
+CreateRandomImage(std::mt19937 & randomNumberEngine)
+{
+  const auto image = CreateImage<PixelType>(itk::Size<imageDimension>{ { 9, 8, 6 } });
+  for (auto & pixel : itk::ImageBufferRange<ImageType>{ *image })
+  {
+    pixel = std::uniform_real_distribution<PixelType>{ 0.0f, 100.0f }(randomNumberEngine);
+  }
+  return image;
+}
+
+
+// Computes the value and derivative of a metric that is configured by the specified function, at a translation that
+// maps some of the samples outside the moving image.
+template <typename TConfigureMetric>
+ValueAndDerivative
+GetValueAndDerivative(const ImageType & fixedImage, const ImageType & movingImage, TConfigureMetric && configureMetric)
+{
+  elx::DefaultConstruct<itk::AdvancedTranslationTransform<double, imageDimension>> transform{};
+  elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>>   interpolator{};
+  elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                          imageSampler{};
+  elx::DefaultConstruct<MetricType>                                                metric{};
+
+  metric.SetUseDerivative(true);
+  configureMetric(metric);
+  InitializeMetric(
+    metric, fixedImage, movingImage, imageSampler, transform, interpolator, fixedImage.GetBufferedRegion());
+
+  auto parameters = transform.GetParameters();
+  parameters[0] = 0.75;
+  parameters[1] = -1.25;
+  return ValueAndDerivative::FromCostFunction(metric, parameters);
+}
+
+
+// Expects the actual value and derivative to be near the expected ones. The tolerance of each derivative element is
+// relative to the element itself, and to the largest element, as small elements may be the result of cancellation.
+void
+ExpectNear(const ValueAndDerivative & actual, const ValueAndDerivative & expected, const double relativeTolerance)
+{
+  EXPECT_NE(expected.value, 0.0);
+  EXPECT_NEAR(actual.value, expected.value, relativeTolerance * std::abs(expected.value));
+  ASSERT_EQ(actual.derivative.size(), expected.derivative.size());
+  const double maximumDerivativeMagnitude = expected.derivative.inf_norm();
+  EXPECT_GT(maximumDerivativeMagnitude, 0.0);
+  for (unsigned int i = 0; i < expected.derivative.size(); ++i)
+  {
+    EXPECT_NEAR(actual.derivative[i],
+                expected.derivative[i],
+                relativeTolerance * (std::abs(expected.derivative[i]) + maximumDerivativeMagnitude));
+  }
+}
+
+} // namespace
+
+
+// Tests that the sample evaluation cache of the low-memory analytic derivative does not change the result (value and
+// derivative). The cache only stores the evaluations of the PDF pass, which the derivative pass would otherwise repeat
+// by the very same computations, so the results are expected to be equal up to the last bits.
+GTEST_TEST(ParzenWindowMutualInformationImageToImageMetric, SampleEvaluationCacheDoesNotChangeResult)
+{
+  std::mt19937 randomNumberEngine{};
+  const auto   fixedImage = CreateRandomImage(randomNumberEngine);
+  const auto   movingImage = CreateRandomImage(randomNumberEngine);
+
+  const auto getValueAndDerivative = [&fixedImage, &movingImage](const bool useSampleEvaluationCache) {
+    return GetValueAndDerivative(*fixedImage, *movingImage, [useSampleEvaluationCache](MetricType & metric) {
+      metric.SetUseMultiThread(true);
+      metric.SetUseExplicitPDFDerivatives(false);
+      metric.SetUseSampleEvaluationCache(useSampleEvaluationCache);
+    });
+  };
+
+  ExpectNear(getValueAndDerivative(true), getValueAndDerivative(false), 1e-12);
+}
+
+
+// Tests that the flag to fill the sample evaluation cache is reset when the low-memory analytic derivative throws an
+// exception, because too many samples map outside the moving image, as well as after a successful call.
+GTEST_TEST(ParzenWindowMutualInformationImageToImageMetric, SampleEvaluationCacheFlagIsResetAfterException)
+{
+  // Exposes the protected flag to the test.
+  class MetricWithPublicCacheFlag : public MetricType
+  {
+  public:
+    using MetricType::m_FillSampleEvaluationCache;
+  };
+
+  std::mt19937 randomNumberEngine{};
+  const auto   fixedImage = CreateRandomImage(randomNumberEngine);
+  const auto   movingImage = CreateRandomImage(randomNumberEngine);
+
+  elx::DefaultConstruct<itk::AdvancedTranslationTransform<double, imageDimension>> transform{};
+  elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>>   interpolator{};
+  elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                          imageSampler{};
+  elx::DefaultConstruct<MetricWithPublicCacheFlag>                                 metric{};
+
+  metric.SetUseDerivative(true);
+  metric.SetUseMultiThread(true);
+  metric.SetUseExplicitPDFDerivatives(false);
+  metric.SetUseSampleEvaluationCache(true);
+  InitializeMetric(
+    metric, *fixedImage, *movingImage, imageSampler, transform, interpolator, fixedImage->GetBufferedRegion());
+
+  MetricType::MeasureType    value{};
+  MetricType::DerivativeType derivative{};
+
+  // A translation that maps all samples outside the moving image.
+  auto parameters = transform.GetParameters();
+  parameters.Fill(100.0);
+  EXPECT_THROW(metric.GetValueAndDerivative(parameters, value, derivative), itk::ExceptionObject);
+  EXPECT_FALSE(metric.m_FillSampleEvaluationCache);
+
+  parameters.Fill(0.5);
+  metric.GetValueAndDerivative(parameters, value, derivative);
+  EXPECT_FALSE(metric.m_FillSampleEvaluationCache);
+}
+
+
+// Tests that the multi-threaded computation of the explicit joint PDF derivatives yields the same result (value and
+// derivative) as the single-threaded one, both when the per-thread joint PDF derivatives fit in the memory limit, and
+// when they do not, so that the metric falls back to the single-threaded computation. The threads sum the
+// contributions of the samples in a different order, so the results may differ by rounding.
+GTEST_TEST(ParzenWindowMutualInformationImageToImageMetric, ThreadedExplicitPDFDerivativesEqualSingleThreaded)
+{
+  std::mt19937 randomNumberEngine{};
+  const auto   fixedImage = CreateRandomImage(randomNumberEngine);
+  const auto   movingImage = CreateRandomImage(randomNumberEngine);
+
+  const auto getValueAndDerivative = [&fixedImage, &movingImage](const bool                useMultiThread,
+                                                                  const itk::SizeValueType maximumMemory) {
+    return GetValueAndDerivative(*fixedImage, *movingImage, [useMultiThread, maximumMemory](MetricType & metric) {
+      metric.SetUseMultiThread(useMultiThread);
+      metric.SetNumberOfWorkUnits(4);
+      metric.SetUseExplicitPDFDerivatives(true);
+      metric.SetMaximumThreadPDFDerivativesMemory(maximumMemory);
+    });
+  };
+
+  const auto defaultMaximumMemory = elx::DefaultConstruct<MetricType>{}.GetMaximumThreadPDFDerivativesMemory();
+  EXPECT_GT(defaultMaximumMemory, 0U);
+
+  const auto singleThreadResult = getValueAndDerivative(false, defaultMaximumMemory);
+
+  for (const itk::SizeValueType maximumMemory : { defaultMaximumMemory, itk::SizeValueType{ 0 } })
+  {
+    ExpectNear(getValueAndDerivative(true, maximumMemory), singleThreadResult, 1e-9);
+  }
+}
@@ -0,0 +1,89 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "SumOfPairwiseCorrelationsMetric/itkSumOfPairwiseCorrelationCoefficientsMetric.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkImageFullSampler.h"
+#include "GTesting/elxCoreMainGTestUtilities.h"
+#include "elxGTestUtilities.h"
+#include "elxDefaultConstruct.h"
+#include <itkImage.h>
+#include <itkImageBufferRange.h>
+#include <gtest/gtest.h>
+
+#include <cmath> // For abs.
+#include <random>
+
+// The template to be tested.
+using itk::SumOfPairwiseCorrelationCoefficientsMetric;
+
+using elx::CoreMainGTestUtilities::CreateImage;
+using elx::GTestUtilities::InitializeMetric;
+using elx::GTestUtilities::ValueAndDerivative;
+
+
+// Tests that metric.SetUseMultiThread(false) and metric.SetUseMultiThread(true) both yield the same result (value and
+// derivative), both when the mean is subtracted from the derivative, and when it is not.
+GTEST_TEST(SumOfPairwiseCorrelationCoefficientsMetric, MultiThreadResultEqualsSingleThreadResult)
+{
+  static constexpr auto imageDimension = 3U;
+  using PixelType = float;
+  using ImageType = itk::Image<PixelType, imageDimension>;
+
+  const auto   image = CreateImage<PixelType>(itk::Size<imageDimension>{ { 9, 8, 6 } });
+  std::mt19937 randomNumberEngine{};
+  for (auto & pixel : itk::ImageBufferRange<ImageType>{ *image })
+  {
+    pixel = std::uniform_real_distribution<PixelType>{ 0.0f, 100.0f }(randomNumberEngine);
+  }
+
+  elx::DefaultConstruct<itk::AdvancedTranslationTransform<double, imageDimension>> transform{};
+  elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>>   interpolator{};
+  elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                          imageSampler{};
+
+  /** A translation that maps some of the samples outside the moving image. */
+  auto parameters = transform.GetParameters();
+  parameters[0] = 0.75;
+  parameters[1] = -1.25;
+
+  for (const bool subtractMean : { false, true })
+  {
+    const auto getValueAndDerivative = [&](const bool useMultiThread) {
+      elx::DefaultConstruct<SumOfPairwiseCorrelationCoefficientsMetric<ImageType, ImageType>> metric{};
+      metric.SetUseMultiThread(useMultiThread);
+      metric.SetSubtractMean(subtractMean);
+      InitializeMetric(metric, *image, *image, imageSampler, transform, interpolator, image->GetBufferedRegion());
+      return ValueAndDerivative::FromCostFunction(metric, parameters);
+    };
+
+    const auto singleThreadResult = getValueAndDerivative(false);
+    const auto multiThreadResult = getValueAndDerivative(true);
+
+    /** The threads sum the contributions of the samples in a different order. */
+    EXPECT_GT(singleThreadResult.value, 0.0);
+    EXPECT_NEAR(multiThreadResult.value, singleThreadResult.value, 1e-5 * singleThreadResult.value);
+    ASSERT_EQ(multiThreadResult.derivative.size(), singleThreadResult.derivative.size());
+    for (unsigned int i = 0; i < singleThreadResult.derivative.size(); ++i)
+    {
+      EXPECT_NEAR(multiThreadResult.derivative[i],
+                  singleThreadResult.derivative[i],
+                  1e-5 * std::abs(singleThreadResult.derivative[i]) + 1e-9);
+    }
+  }
+}
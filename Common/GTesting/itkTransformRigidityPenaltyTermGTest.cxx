@@ -0,0 +1,411 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "RigidityPenalty/itkTransformRigidityPenaltyTerm.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "GTesting/elxCoreMainGTestUtilities.h"
+#include "elxGTestUtilities.h"
+#include "elxDefaultConstruct.h"
+#include <itkImage.h>
+#include <gtest/gtest.h>
+
+#include <algorithm> // For clamp.
+#include <array>
+#include <cmath> // For abs and sqrt.
+#include <random>
+#include <vector>
+
+// The template to be tested.
+using itk::TransformRigidityPenaltyTerm;
+
+using elx::CoreMainGTestUtilities::CreateImage;
+using elx::GTestUtilities::InitializeMetric;
+using elx::GTestUtilities::ValueAndDerivative;
+
+namespace
+{
+constexpr auto imageDimension = 2U;
+using ImageType = itk::Image<float, imageDimension>;
+using RigidityPenaltyTermType = TransformRigidityPenaltyTerm<ImageType, double>;
+
+// The size and spacing of the B-spline grid. The spacing differs per dimension, to distinguish the operators of the
+// two dimensions.
+constexpr int                   gridSizeX{ 7 };
+constexpr int                   gridSizeY{ 6 };
+constexpr int                   numberOfCoefficients{ gridSizeX * gridSizeY };
+constexpr std::array<double, 2> gridSpacing{ 4.0, 3.0 };
+
+using Kernel = std::array<double, 3>;
+using Operator = std::array<double, 9>;
+using CoefficientImage = std::vector<double>;
+
+// Specifies how a condition is included by the penalty term.
+enum class ConditionMode
+{
+  NotCalculated,
+  CalculatedOnly,
+  Used
+};
+
+struct ConditionResults
+{
+  double value{};
+  double gradientMagnitude{};
+};
+
+struct ReferenceResults
+{
+  ValueAndDerivative valueAndDerivative{ 0.0, itk::Array<double>(imageDimension * numberOfCoefficients, 0.0) };
+  ConditionResults   linearity{};
+  ConditionResults   orthonormality{};
+  ConditionResults   properness{};
+};
+
+
+// Returns the coefficient at the specified grid position, clamped to the grid, like the zero-flux Neumann boundary
+// condition of the filters and the neighborhood iterators of the penalty term.
+double
+GetClamped(const CoefficientImage & image, const int x, const int y)
+{
+  return image[std::clamp(x, 0, gridSizeX - 1) + gridSizeX * std::clamp(y, 0, gridSizeY - 1)];
+}
+
+
+// Filters the image by the separable operator, first along x, then along y, as the chains of 1D filters do.
+CoefficientImage
+FilterSeparable(const CoefficientImage & image, const Kernel & kernelX, const Kernel & kernelY)
+{
+  CoefficientImage filteredAlongX(numberOfCoefficients);
+  for (int y = 0; y < gridSizeY; ++y)
+  {
+    for (int x = 0; x < gridSizeX; ++x)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        filteredAlongX[x + gridSizeX * y] += kernelX[j] * GetClamped(image, x + j - 1, y);
+      }
+    }
+  }
+  CoefficientImage filtered(numberOfCoefficients);
+  for (int y = 0; y < gridSizeY; ++y)
+  {
+    for (int x = 0; x < gridSizeX; ++x)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        filtered[x + gridSizeX * y] += kernelY[j] * GetClamped(filteredAlongX, x, y + j - 1);
+      }
+    }
+  }
+  return filtered;
+}
+
+
+// Adds the inner product of the 3x3 operator and the neighborhood of each coefficient to the filtered image. The
+// rigidity coefficients are all one.
+void
+AddFilteredByOperator(CoefficientImage & filtered, const CoefficientImage & image, const Operator & op)
+{
+  for (int y = 0; y < gridSizeY; ++y)
+  {
+    for (int x = 0; x < gridSizeX; ++x)
+    {
+      for (int k = 0; k < 9; ++k)
+      {
+        filtered[x + gridSizeX * y] += op[k] * GetClamped(image, x + k % 3 - 1, y + k / 3 - 1);
+      }
+    }
+  }
+}
+
+
+// Computes the value and derivative of the rigidity penalty term of a 2D B-spline transform, without rigidity images,
+// the way the original single-threaded implementation of TransformRigidityPenaltyTerm::GetValueAndDerivative did.
+ReferenceResults
+ComputeReferenceResults(const itk::OptimizerParameters<double> & parameters,
+                        const std::array<ConditionMode, 3> &     modes,
+                        const std::array<double, 3> &            weights)
+{
+  const double s0 = gridSpacing[0];
+  const double s1 = gridSpacing[1];
+
+  const auto [linearityMode, orthonormalityMode, propernessMode] = modes;
+  const auto [linearityWeight, orthonormalityWeight, propernessWeight] = weights;
+
+  // The 1D operators of Create1DOperator.
+  const Kernel derivativeX{ -0.5 / s0, 0.0, 0.5 / s0 };
+  const Kernel derivativeY{ -0.5 / s1, 0.0, 0.5 / s1 };
+  const Kernel bSpline{ 1.0 / 6.0, 4.0 / 6.0, 1.0 / 6.0 };
+  const Kernel secondDerivativeX{ 0.5 / (s0 * s0), -1.0 / (s0 * s0), 0.5 / (s0 * s0) };
+  const Kernel secondDerivativeY{ 0.5 / (s1 * s1), -1.0 / (s1 * s1), 0.5 / (s1 * s1) };
+  const Kernel mixedDerivative{ -0.5 / (s0 * s1), 0.0, 0.5 / (s0 * s1) };
+
+  // The ND operators of CreateNDOperator, one row of the 3x3 neighborhood per line.
+  const double   sp0 = s0 * s0;
+  const double   sp1 = s1 * s1;
+  const double   sp01 = s0 * s1;
+  const Operator FA{ 1.0 / 12.0 / s0, 0.0, -1.0 / 12.0 / s0, // row y - 1
+                     1.0 / 3.0 / s0,  0.0, -1.0 / 3.0 / s0,  // row y
+                     1.0 / 12.0 / s0, 0.0, -1.0 / 12.0 / s0 };
+  const Operator FB{ 1.0 / 12.0 / s1,  1.0 / 3.0 / s1,  1.0 / 12.0 / s1, // row y - 1
+                     0.0,              0.0,             0.0,             // row y
+                     -1.0 / 12.0 / s1, -1.0 / 3.0 / s1, -1.0 / 12.0 / s1 };
+  const Operator FD{ 1.0 / 12.0 / sp0, -1.0 / 6.0 / sp0, 1.0 / 12.0 / sp0, // row y - 1
+                     1.0 / 3.0 / sp0,  -2.0 / 3.0 / sp0, 1.0 / 3.0 / sp0,  // row y
+                     1.0 / 12.0 / sp0, -1.0 / 6.0 / sp0, 1.0 / 12.0 / sp0 };
+  const Operator FE{ 1.0 / 12.0 / sp1, 1.0 / 3.0 / sp1,  1.0 / 12.0 / sp1, // row y - 1
+                     -1.0 / 6.0 / sp1, -2.0 / 3.0 / sp1, -1.0 / 6.0 / sp1, // row y
+                     1.0 / 12.0 / sp1, 1.0 / 3.0 / sp1,  1.0 / 12.0 / sp1 };
+  const Operator FG{ 1.0 / 4.0 / sp01,  0.0, -1.0 / 4.0 / sp01, // row y - 1
+                     0.0,               0.0, 0.0,               // row y
+                     -1.0 / 4.0 / sp01, 0.0, 1.0 / 4.0 / sp01 };
+
+  // The B-spline coefficient images.
+  std::array<CoefficientImage, imageDimension> u;
+  for (unsigned int i = 0; i < imageDimension; ++i)
+  {
+    u[i].assign(parameters.begin() + i * numberOfCoefficients, parameters.begin() + (i + 1) * numberOfCoefficients);
+  }
+
+  // The filtered coefficient images.
+  std::array<CoefficientImage, imageDimension> A, B, D, E, G;
+  for (unsigned int i = 0; i < imageDimension; ++i)
+  {
+    A[i] = FilterSeparable(u[i], derivativeX, bSpline);
+    B[i] = FilterSeparable(u[i], bSpline, derivativeY);
+    D[i] = FilterSeparable(u[i], secondDerivativeX, bSpline);
+    E[i] = FilterSeparable(u[i], bSpline, secondDerivativeY);
+    G[i] = FilterSeparable(u[i], mixedDerivative, mixedDerivative);
+  }
+
+  // The values of the conditions, and the subparts of their derivatives: OCp[i][j] is subpart j of dimension i.
+  ReferenceResults results{};
+  std::array<std::array<CoefficientImage, 2>, imageDimension> OCp, PCp;
+  std::array<std::array<CoefficientImage, 3>, imageDimension> LCp;
+  for (unsigned int i = 0; i < imageDimension; ++i)
+  {
+    for (auto & part : OCp[i])
+    {
+      part.resize(numberOfCoefficients);
+    }
+    for (auto & part : PCp[i])
+    {
+      part.resize(numberOfCoefficients);
+    }
+    for (auto & part : LCp[i])
+    {
+      part.resize(numberOfCoefficients);
+    }
+  }
+
+  for (int k = 0; k < numberOfCoefficients; ++k)
+  {
+    const double mu1_A = A[0][k];
+    const double mu2_A = A[1][k];
+    const double mu1_B = B[0][k];
+    const double mu2_B = B[1][k];
+
+    results.orthonormality.value += std::pow(+(1.0 + mu1_A) * (1.0 + mu1_A) + mu2_A * mu2_A - 1.0, 2.0) +
+                                    std::pow(+mu1_B * mu1_B + (1.0 + mu2_B) * (1.0 + mu2_B) - 1.0, 2.0) +
+                                    std::pow(+(1.0 + mu1_A) * mu1_B + mu2_A * (1.0 + mu2_B), 2.0);
+
+    OCp[0][0][k] = 2.0 * (+2.0 * (1.0 + mu1_A) * (1.0 + mu1_A) * (1.0 + mu1_A) + 2.0 * mu2_A * mu2_A * (1.0 + mu1_A) -
+                          2.0 * (1.0 + mu1_A) + mu1_B * mu1_B * (1.0 + mu1_A) + mu2_A * (1.0 + mu2_B) * mu1_B);
+    OCp[0][1][k] = 2.0 * (+mu1_B * (1.0 + mu1_A) * (1.0 + mu1_A) + mu2_A * (1.0 + mu2_B) * (1.0 + mu1_A) +
+                          2.0 * mu1_B * mu1_B * mu1_B + 2.0 * mu1_B * (1.0 + mu2_B) * (1.0 + mu2_B) - 2.0 * mu1_B);
+    OCp[1][0][k] = 2.0 * (+2.0 * mu2_A * mu2_A * mu2_A + 2.0 * mu2_A * (1.0 + mu1_A) * (1.0 + mu1_A) - 2.0 * mu2_A +
+                          mu2_A * (1.0 + mu2_B) * (1.0 + mu2_B) + mu1_B * (1.0 + mu1_A) * (1.0 + mu2_B));
+    OCp[1][1][k] = 2.0 * (+mu2_A * mu2_A * (1.0 + mu2_B) + mu1_B * (1.0 + mu1_A) * mu2_A +
+                          2.0 * (1.0 + mu2_B) * (1.0 + mu2_B) * (1.0 + mu2_B) + 2.0 * mu1_B * mu1_B * (1.0 + mu2_B) -
+                          2.0 * (1.0 + mu2_B));
+
+    results.properness.value += std::pow(+(1.0 + mu1_A) * (1.0 + mu2_B) - mu2_A * mu1_B - 1.0, 2.0);
+
+    PCp[0][0][k] =
+      2.0 * (+(1.0 + mu2_B) * (1.0 + mu2_B) * (1.0 + mu1_A) - mu2_A * (1.0 + mu2_B) * mu1_B - (1.0 + mu2_B));
+    PCp[0][1][k] = 2.0 * (+mu2_A + mu2_A * mu2_A * mu1_B - mu2_A * (1.0 + mu2_B) * (1.0 + mu1_A));
+    PCp[1][0][k] = 2.0 * (+mu1_B * mu1_B * mu2_A - mu1_B * (1.0 + mu1_A) * (1.0 + mu2_B) + mu1_B);
+    PCp[1][1][k] =
+      2.0 * (-(1.0 + mu1_A) + (1.0 + mu1_A) * (1.0 + mu1_A) * (1.0 + mu2_B) - mu1_B * (1.0 + mu1_A) * mu2_A);
+
+    for (unsigned int i = 0; i < imageDimension; ++i)
+    {
+      results.linearity.value += D[i][k] * D[i][k] + E[i][k] * E[i][k] + G[i][k] * G[i][k];
+      LCp[i][0][k] = 2.0 * D[i][k];
+      LCp[i][1][k] = 2.0 * E[i][k];
+      LCp[i][2][k] = 2.0 * G[i][k];
+    }
+  }
+
+  // The rigidity coefficients are all one, so their sum is the number of coefficients.
+  const double rigidityCoefficientSum = numberOfCoefficients;
+
+  const auto finishCondition = [&results, rigidityCoefficientSum](ConditionResults &  condition,
+                                                                  const ConditionMode mode,
+                                                                  const double        weight,
+                                                                  const auto &        filteredParts) {
+    if (mode == ConditionMode::NotCalculated)
+    {
+      condition = {};
+      return;
+    }
+    condition.value /= rigidityCoefficientSum;
+
+    double squaredGradientMagnitude{};
+    for (unsigned int i = 0; i < imageDimension; ++i)
+    {
+      for (int k = 0; k < numberOfCoefficients; ++k)
+      {
+        const double weighted = weight * filteredParts[i][k];
+        squaredGradientMagnitude += weighted * weighted / (rigidityCoefficientSum * rigidityCoefficientSum);
+        if (mode == ConditionMode::Used)
+        {
+          results.valueAndDerivative.derivative[i * numberOfCoefficients + k] += weighted / rigidityCoefficientSum;
+        }
+      }
+    }
+    condition.gradientMagnitude = std::sqrt(squaredGradientMagnitude);
+
+    if (mode == ConditionMode::Used)
+    {
+      results.valueAndDerivative.value += weight * condition.value;
+    }
+  };
+
+  // The filtered versions of the subparts.
+  std::array<CoefficientImage, imageDimension> OCpf, PCpf, LCpf;
+  for (unsigned int i = 0; i < imageDimension; ++i)
+  {
+    OCpf[i].assign(numberOfCoefficients, 0.0);
+    AddFilteredByOperator(OCpf[i], OCp[i][0], FA);
+    AddFilteredByOperator(OCpf[i], OCp[i][1], FB);
+    PCpf[i].assign(numberOfCoefficients, 0.0);
+    AddFilteredByOperator(PCpf[i], PCp[i][0], FA);
+    AddFilteredByOperator(PCpf[i], PCp[i][1], FB);
+    LCpf[i].assign(numberOfCoefficients, 0.0);
+    AddFilteredByOperator(LCpf[i], LCp[i][0], FD);
+    AddFilteredByOperator(LCpf[i], LCp[i][1], FE);
+    AddFilteredByOperator(LCpf[i], LCp[i][2], FG);
+  }
+
+  finishCondition(results.linearity, linearityMode, linearityWeight, LCpf);
+  finishCondition(results.orthonormality, orthonormalityMode, orthonormalityWeight, OCpf);
+  finishCondition(results.properness, propernessMode, propernessWeight, PCpf);
+  return results;
+}
+
+} // namespace
+
+
+// Tests that the value, the derivative, and the values and gradient magnitudes of the separate conditions are equal to
+// those of the original implementation, both single-threaded and multi-threaded, for each combination of the
+// linearity, orthonormality and properness conditions being not calculated, calculated only, or used.
+GTEST_TEST(TransformRigidityPenaltyTerm, EqualsOriginalImplementationForEachCombinationOfConditions)
+{
+  const auto fixedImage = CreateImage<float>(itk::Size<imageDimension>::Filled(24));
+  const auto movingImage = CreateImage<float>(itk::Size<imageDimension>::Filled(24));
+
+  elx::DefaultConstruct<itk::AdvancedBSplineDeformableTransform<double, imageDimension, 3>> transform{};
+  transform.SetGridRegion(itk::ImageRegion<imageDimension>(itk::Size<imageDimension>{ { gridSizeX, gridSizeY } }));
+  transform.SetGridSpacing(itk::Vector<double, imageDimension>(gridSpacing.data()));
+  transform.SetGridOrigin(itk::MakeFilled<itk::Point<double, imageDimension>>(-4.0));
+
+  // Note that transform.GetNumberOfParameters() must be called after SetGridRegion, because GetNumberOfParameters()
+  // internally uses the size of the grid region.
+  itk::OptimizerParameters<double> parameters(transform.GetNumberOfParameters());
+  ASSERT_EQ(parameters.size(), imageDimension * numberOfCoefficients);
+
+  std::mt19937 randomNumberEngine{};
+  for (double & parameter : parameters)
+  {
+    parameter = std::uniform_real_distribution<>{ -1.0, 1.0 }(randomNumberEngine);
+  }
+  transform.SetParameters(parameters);
+
+  constexpr std::array<double, 3> weights{ 2.0, 3.0, 5.0 };
+  constexpr double                tolerance{ 1e-12 };
+
+  for (const auto linearityMode : { ConditionMode::NotCalculated, ConditionMode::CalculatedOnly, ConditionMode::Used })
+  {
+    for (const auto orthonormalityMode :
+         { ConditionMode::NotCalculated, ConditionMode::CalculatedOnly, ConditionMode::Used })
+    {
+      for (const auto propernessMode :
+           { ConditionMode::NotCalculated, ConditionMode::CalculatedOnly, ConditionMode::Used })
+      {
+        const std::array<ConditionMode, 3> modes{ linearityMode, orthonormalityMode, propernessMode };
+        const ReferenceResults             expected = ComputeReferenceResults(parameters, modes, weights);
+
+        for (const bool useMultiThread : { false, true })
+        {
+          elx::DefaultConstruct<itk::ImageFullSampler<ImageType>>                        imageSampler{};
+          elx::DefaultConstruct<itk::AdvancedLinearInterpolateImageFunction<ImageType>> interpolator{};
+          elx::DefaultConstruct<RigidityPenaltyTermType>                                 metric{};
+
+          metric.SetLinearityConditionWeight(weights[0]);
+          metric.SetOrthonormalityConditionWeight(weights[1]);
+          metric.SetPropernessConditionWeight(weights[2]);
+          metric.SetUseLinearityCondition(linearityMode == ConditionMode::Used);
+          metric.SetUseOrthonormalityCondition(orthonormalityMode == ConditionMode::Used);
+          metric.SetUsePropernessCondition(propernessMode == ConditionMode::Used);
+          metric.SetCalculateLinearityCondition(linearityMode != ConditionMode::NotCalculated);
+          metric.SetCalculateOrthonormalityCondition(orthonormalityMode != ConditionMode::NotCalculated);
+          metric.SetCalculatePropernessCondition(propernessMode != ConditionMode::NotCalculated);
+          metric.SetUseMultiThread(useMultiThread);
+          metric.SetNumberOfWorkUnits(4);
+
+          InitializeMetric(
+            metric, *fixedImage, *movingImage, imageSampler, transform, interpolator, fixedImage->GetBufferedRegion());
+
+          const auto actual = ValueAndDerivative::FromCostFunction(metric, parameters);
+
+          const double expectedValue = expected.valueAndDerivative.value;
+          EXPECT_NEAR(actual.value, expectedValue, tolerance * (1.0 + std::abs(expectedValue)));
+
+          ASSERT_EQ(actual.derivative.size(), expected.valueAndDerivative.derivative.size());
+          const double derivativeTolerance = tolerance * (1.0 + expected.valueAndDerivative.derivative.inf_norm());
+          for (unsigned int i = 0; i < actual.derivative.size(); ++i)
+          {
+            EXPECT_NEAR(actual.derivative[i], expected.valueAndDerivative.derivative[i], derivativeTolerance);
+          }
+
+          const auto expectNearConditionResults = [tolerance](const double             actualValue,
+                                                              const double             actualGradientMagnitude,
+                                                              const ConditionResults & expectedResults) {
+            EXPECT_NEAR(actualValue, expectedResults.value, tolerance * (1.0 + std::abs(expectedResults.value)));
+            EXPECT_NEAR(actualGradientMagnitude,
+                        expectedResults.gradientMagnitude,
+                        tolerance * (1.0 + expectedResults.gradientMagnitude));
+          };
+          expectNearConditionResults(metric.GetLinearityConditionValue(),
+                                     metric.GetLinearityConditionGradientMagnitude(),
+                                     expected.linearity);
+          expectNearConditionResults(metric.GetOrthonormalityConditionValue(),
+                                     metric.GetOrthonormalityConditionGradientMagnitude(),
+                                     expected.orthonormality);
+          expectNearConditionResults(metric.GetPropernessConditionValue(),
+                                     metric.GetPropernessConditionGradientMagnitude(),
+                                     expected.properness);
+        }
+      }
+    }
+  }
+}
@@ -171,19 +171,24 @@ ImageFullSampler<TInputImage>::GenerateData()
 
   const auto croppedInputImageRegion = this->GetCroppedInputImageRegion();
 
-  if (Superclass::m_UseMultiThread)
-  {
-    MultiThreadedGenerateData(elastix::Deref(this->ProcessObject::GetMultiThreader()),
-                              ProcessObject::GetNumberOfWorkUnits(),
-                              inputImage,
-                              mask,
-                              croppedInputImageRegion,
-                              sampleVector);
-  }
-  else
-  {
-    SingleThreadedGenerateData(inputImage, mask, croppedInputImageRegion, sampleVector);
-  }
+  const auto generateSamples = [this, &inputImage, mask, &croppedInputImageRegion](auto & samples) {
+    if (Superclass::m_UseMultiThread)
+    {
+      MultiThreadedGenerateData(elastix::Deref(this->ProcessObject::GetMultiThreader()),
+                                ProcessObject::GetNumberOfWorkUnits(),
+                                inputImage,
+                                mask,
+                                croppedInputImageRegion,
+                                samples);
+    }
+    else
+    {
+      SingleThreadedGenerateData(inputImage, mask, croppedInputImageRegion, samples);
+    }
+  };
+
+  /** The samples only depend on the input image, the mask, and the input region. */
+  this->GenerateSamplesUsingFixedImagePreprocessingCache("Samples", sampleVector, generateSamples);
   // Move the samples from the vector into the output container.
   sampleContainer.swap(sampleVector);
 
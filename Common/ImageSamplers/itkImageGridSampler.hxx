@@ -25,6 +25,7 @@
 
 #include <algorithm> // For accumulate.
 #include <cassert>
+#include <sstream> // For ostringstream.
 
 namespace itk
 {
@@ -284,20 +285,27 @@ ImageGridSampler<TInputImage>::GenerateData()
 
   const auto croppedInputImageRegion = this->GetCroppedInputImageRegion();
 
-  if (Superclass::m_UseMultiThread)
-  {
-    MultiThreadedGenerateData(elastix::Deref(this->ProcessObject::GetMultiThreader()),
-                              ProcessObject::GetNumberOfWorkUnits(),
-                              inputImage,
-                              mask,
-                              croppedInputImageRegion,
-                              m_SampleGridSpacing,
-                              sampleVector);
-  }
-  else
-  {
-    SingleThreadedGenerateData(inputImage, mask, croppedInputImageRegion, m_SampleGridSpacing, sampleVector);
-  }
+  const auto generateSamples = [this, &inputImage, mask, &croppedInputImageRegion](auto & samples) {
+    if (Superclass::m_UseMultiThread)
+    {
+      MultiThreadedGenerateData(elastix::Deref(this->ProcessObject::GetMultiThreader()),
+                                ProcessObject::GetNumberOfWorkUnits(),
+                                inputImage,
+                                mask,
+                                croppedInputImageRegion,
+                                m_SampleGridSpacing,
+                                samples);
+    }
+    else
+    {
+      SingleThreadedGenerateData(inputImage, mask, croppedInputImageRegion, m_SampleGridSpacing, samples);
+    }
+  };
+
+  /** The samples only depend on the input image, the mask, the input region, and the grid spacing. */
+  std::ostringstream resultName;
+  resultName << "SamplesWithGridSpacing" << m_SampleGridSpacing;
+  this->GenerateSamplesUsingFixedImagePreprocessingCache(resultName.str(), sampleVector, generateSamples);
   // Move the samples from the vector into the output container.
   sampleContainer.swap(sampleVector);
 
@@ -22,6 +22,8 @@
 #include "itkInterpolateImageFunction.h"
 #include "itkBSplineInterpolateImageFunction.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "elxRandomGenerator.h"
+#include <atomic>
 
 namespace itk
 {
@@ -33,6 +35,14 @@ namespace itk
  * This image sampler generates not only samples that correspond with
  * pixel locations, but selects points in physical space.
  *
+ * When a mask is supplied, the samples are drawn single-threadedly by default, in
+ * the original order. When both multi-threading and UseMultiThreadWithMask are enabled,
+ * the samples are drawn in blocks of a fixed size, which are distributed over the work
+ * units. Each block is drawn by a random number generator of its own. The seeds of these
+ * generators are drawn from the RandomGenerator, so the output is reproducible for a given
+ * seed, independent of the number of work units. It does differ from the output of the
+ * single-threaded sampling.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -73,6 +83,7 @@ public:
   using typename Superclass::InputImagePointType;
   using typename Superclass::InputImagePointValueType;
   using typename Superclass::ImageSampleValueType;
+  using typename Superclass::SeedIntegerType;
 
   /** The input image dimension. */
   itkStaticConstMacro(InputImageDimension, unsigned int, Superclass::InputImageDimension);
@@ -102,6 +113,22 @@ public:
   itkGetConstMacro(UseRandomSampleRegion, bool);
   itkSetMacro(UseRandomSampleRegion, bool);
 
+  /** Set/Get whether to draw the candidate samples only from the run-length encoded spans of
+   * voxels near the mask, instead of from the whole (cropped) input image region. This removes
+   * most of the rejected candidates for sparse masks. The spans are computed once, and recomputed
+   * only when the mask, the input image or the cropped region changes. They are slightly dilated,
+   * so that the output is still uniformly distributed within the mask, as long as the mask is not
+   * much finer than the input image grid. Only used when a mask is supplied. Default: false. */
+  itkGetConstMacro(UseMaskSpans, bool);
+  itkSetMacro(UseMaskSpans, bool);
+
+  /** Set/Get whether to draw the samples multi-threadedly when a mask is supplied, in blocks that each
+   * have a random number generator of their own. This yields other samples than the single-threaded
+   * drawing, for the same seed. Only used when a mask is supplied and UseMultiThread is true.
+   * Default: false. */
+  itkGetConstMacro(UseMultiThreadWithMask, bool);
+  itkSetMacro(UseMultiThreadWithMask, bool);
+
 protected:
   using InputImageContinuousIndexType = typename InterpolatorType::ContinuousIndexType;
 
@@ -131,7 +158,7 @@ protected:
     return interpolator;
   }();
 
-  RandomGeneratorPointer m_RandomGenerator{ RandomGeneratorType::GetInstance() };
+  RandomGeneratorPointer m_RandomGenerator{ elastix::RandomGenerator::GetCurrent() };
   InputImageSpacingType  m_SampleRegionSize{ itk::MakeFilled<InputImageSpacingType>(1.0) };
 
   /** Generate the two corners of a sampling region, given the two corners
@@ -146,6 +173,15 @@ protected:
                        InputImageContinuousIndexType &       largestContIndex);
 
 private:
+  /** A run of consecutive voxels along the first image dimension, as stored in m_MaskSpans. */
+  struct MaskSpan
+  {
+    InputImageIndexType m_StartIndex;
+
+    /** The total number of voxels of this span and all the spans before it. */
+    SizeValueType m_CumulativeLength;
+  };
+
   struct UserData
   {
     ITK_DISALLOW_COPY_AND_MOVE(UserData);
@@ -156,12 +192,54 @@ private:
     std::vector<ImageSampleType> &                     m_Samples;
   };
 
+  /** The number of samples of each block that is drawn by a random number generator of its own,
+   * when sampling multi-threadedly within a mask. */
+  static constexpr size_t MaskedSampleBlockSize{ 512 };
+
+  struct MaskedUserData
+  {
+    ITK_DISALLOW_COPY_AND_MOVE(MaskedUserData);
+
+    const InputImageType &                m_InputImage;
+    const InterpolatorType &              m_Interpolator;
+    const MaskType &                      m_Mask;
+    const std::vector<MaskSpan> * const   m_MaskSpans;
+    const InputImageContinuousIndexType & m_SmallestContIndex;
+    const InputImageContinuousIndexType & m_LargestContIndex;
+    const std::vector<SeedIntegerType> &  m_Seeds;
+    std::vector<ImageSampleType> &        m_Samples;
+    std::atomic<bool> &                   m_Failed;
+  };
+
   std::vector<InputImageContinuousIndexType> m_RandomCoordinates{};
 
   static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
   ThreaderCallback(void * arg);
 
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  MaskedThreaderCallback(void * arg);
+
+  /** Recomputes m_MaskSpans, if the mask, the input image or the region has changed. */
+  void
+  UpdateMaskSpans(const InputImageType & inputImage, const MaskType & mask, const InputImageRegionType & region);
+
+  /** Generate a candidate point uniformly within the voxels of the mask spans. Returns false
+   * when the candidate lies outside the bounding box given by the two corners. */
+  static bool
+  GenerateRandomCoordinateInMaskSpans(RandomGeneratorType &                 randomGenerator,
+                                      const std::vector<MaskSpan> &         maskSpans,
+                                      const InputImageContinuousIndexType & smallestContIndex,
+                                      const InputImageContinuousIndexType & largestContIndex,
+                                      InputImageContinuousIndexType &       randomContIndex);
+
   bool m_UseRandomSampleRegion{ false };
+  bool m_UseMaskSpans{ false };
+  bool m_UseMultiThreadWithMask{ false };
+
+  std::vector<MaskSpan> m_MaskSpans{};
+  const MaskType *      m_MaskSpansMask{ nullptr };
+  ModifiedTimeType      m_MaskSpansMTime{ 0 };
+  InputImageRegionType  m_MaskSpansRegion{};
 };
 
 } // end namespace itk
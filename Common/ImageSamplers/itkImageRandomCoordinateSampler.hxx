@@ -20,7 +20,10 @@
 
 #include "itkImageRandomCoordinateSampler.h"
 #include "elxDeref.h"
+#include <itkImageRegionConstIteratorWithIndex.h>
 #include <vnl/vnl_math.h>
+#include <algorithm> // For upper_bound.
+#include <atomic>
 #include <cassert>
 
 namespace itk
@@ -56,7 +59,8 @@ ImageRandomCoordinateSampler<TInputImage>::GenerateData()
 
   samples.resize(this->Superclass::m_NumberOfSamples);
 
-  /** Get a handle to the mask. If there was no mask supplied we exercise a multi-threaded version. */
+  /** Get a handle to the mask. Without a mask, the random coordinates are generated beforehand,
+   * and only the interpolation is multi-threaded. */
   const MaskType * const mask = this->Superclass::GetMask();
   if (mask == nullptr && Superclass::m_UseMultiThread)
   {
@@ -81,6 +85,56 @@ ImageRandomCoordinateSampler<TInputImage>::GenerateData()
     return;
   }
 
+  if (mask != nullptr)
+  {
+    /** Update the mask. */
+    mask->UpdateSource();
+
+    if (m_UseMaskSpans)
+    {
+      this->UpdateMaskSpans(inputImage, *mask, croppedInputImageRegion);
+      if (m_MaskSpans.empty())
+      {
+        samples.clear();
+        itkExceptionMacro("Could not find any image samples within the mask. Probably the mask is empty");
+      }
+    }
+  }
+
+  if (mask != nullptr && Superclass::m_UseMultiThread && m_UseMultiThreadWithMask)
+  {
+    MultiThreaderBase & multiThreader = elastix::Deref(this->ProcessObject::GetMultiThreader());
+
+    /** Draw one seed per block of samples. The number of blocks does not depend on the number of work
+     * units, so that the output is reproducible for a given seed, whatever the number of work units. */
+    std::vector<SeedIntegerType> seeds((samples.size() + MaskedSampleBlockSize - 1) / MaskedSampleBlockSize);
+    for (auto & seed : seeds)
+    {
+      seed = m_RandomGenerator->GetIntegerVariate();
+    }
+    std::atomic<bool> failed{ false };
+
+    MaskedUserData userData{ inputImage,
+                             *interpolator,
+                             *mask,
+                             m_UseMaskSpans ? &m_MaskSpans : nullptr,
+                             smallestContIndex,
+                             largestContIndex,
+                             seeds,
+                             samples,
+                             failed };
+
+    multiThreader.SetSingleMethod(&Self::MaskedThreaderCallback, &userData);
+    multiThreader.SingleMethodExecute();
+
+    if (failed)
+    {
+      samples.clear();
+      itkExceptionMacro("Could not find enough image samples within reasonable time. Probably the mask is too small");
+    }
+    return;
+  }
+
   InputImageContinuousIndexType sampleContIndex;
   /** Fill the sample container. */
   if (mask == nullptr)
@@ -105,9 +159,6 @@ ImageRandomCoordinateSampler<TInputImage>::GenerateData()
   }   // end if no mask
   else
   {
-    /** Update the mask. */
-    mask->UpdateSource();
-
     /** Set up some variable that are used to make sure we are not forever
      * walking around on this image, trying to look for valid samples. */
     unsigned long numberOfSamplesTried = 0;
@@ -121,6 +172,7 @@ ImageRandomCoordinateSampler<TInputImage>::GenerateData()
       ImageSampleValueType & sampleValue = sample.m_ImageValue;
 
       /** Walk over the image until we find a valid point */
+      bool isCandidate = true;
       do
       {
         /** Check if we are not trying eternally to find a valid point. */
@@ -134,10 +186,19 @@ ImageRandomCoordinateSampler<TInputImage>::GenerateData()
         }
 
         /** Generate a point in the input image region. */
-        this->GenerateRandomCoordinate(smallestContIndex, largestContIndex, sampleContIndex);
+        if (m_UseMaskSpans)
+        {
+          isCandidate = GenerateRandomCoordinateInMaskSpans(
+            *m_RandomGenerator, m_MaskSpans, smallestContIndex, largestContIndex, sampleContIndex);
+        }
+        else
+        {
+          this->GenerateRandomCoordinate(smallestContIndex, largestContIndex, sampleContIndex);
+        }
         inputImage.TransformContinuousIndexToPhysicalPoint(sampleContIndex, samplePoint);
 
-      } while (!interpolator->IsInsideBuffer(sampleContIndex) || !mask->IsInsideInWorldSpace(samplePoint));
+      } while (!isCandidate || !interpolator->IsInsideBuffer(sampleContIndex) ||
+               !mask->IsInsideInWorldSpace(samplePoint));
 
       /** Compute the value at the point. */
       sampleValue = static_cast<ImageSampleValueType>(this->m_Interpolator->EvaluateAtContinuousIndex(sampleContIndex));
@@ -198,6 +259,233 @@ ImageRandomCoordinateSampler<TInputImage>::ThreaderCallback(void * const arg)
 }
 
 
+/**
+ * ******************* MaskedThreaderCallback *******************
+ */
+
+template <class TInputImage>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ImageRandomCoordinateSampler<TInputImage>::MaskedThreaderCallback(void * const arg)
+{
+  assert(arg);
+  const auto & info = *static_cast<const MultiThreaderBase::WorkUnitInfo *>(arg);
+
+  assert(info.UserData);
+  auto & userData = *static_cast<MaskedUserData *>(info.UserData);
+
+  const auto & seeds = userData.m_Seeds;
+
+  auto &       samples = userData.m_Samples;
+  const auto & inputImage = userData.m_InputImage;
+  const auto & interpolator = userData.m_Interpolator;
+  const auto & mask = userData.m_Mask;
+  const auto & smallestContIndex = userData.m_SmallestContIndex;
+  const auto & largestContIndex = userData.m_LargestContIndex;
+
+  const auto randomGenerator = RandomGeneratorType::New();
+
+  /** The work units take the blocks of samples round-robin. Each block is drawn by a random number
+   * generator of its own, seeded by the seed of the block, so the samples of a block do not depend
+   * on the work unit that draws them. */
+  for (size_t block = info.WorkUnitID; block < seeds.size(); block += info.NumberOfWorkUnits)
+  {
+    const auto beginOfSamples = samples.data() + block * MaskedSampleBlockSize;
+    const auto n = std::min<size_t>(MaskedSampleBlockSize, samples.size() - block * MaskedSampleBlockSize);
+
+    randomGenerator->SetSeed(seeds[block]);
+
+    /** Make sure we are not forever walking around on this image, trying to look for valid samples. */
+    const size_t maximumNumberOfSamplesToTry = 10 * n;
+    size_t       numberOfSamplesTried = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+      auto &                        sample = beginOfSamples[i];
+      InputImageContinuousIndexType sampleContIndex;
+      bool                          isCandidate = true;
+
+      /** Walk over the image until we find a valid point */
+      do
+      {
+        ++numberOfSamplesTried;
+        if (numberOfSamplesTried > maximumNumberOfSamplesToTry || userData.m_Failed)
+        {
+          userData.m_Failed = true;
+          return ITK_THREAD_RETURN_DEFAULT_VALUE;
+        }
+
+        if (userData.m_MaskSpans)
+        {
+          isCandidate = GenerateRandomCoordinateInMaskSpans(
+            *randomGenerator, *userData.m_MaskSpans, smallestContIndex, largestContIndex, sampleContIndex);
+        }
+        else
+        {
+          for (unsigned int d = 0; d < InputImageDimension; ++d)
+          {
+            sampleContIndex[d] = static_cast<InputImagePointValueType>(
+              randomGenerator->GetUniformVariate(smallestContIndex[d], largestContIndex[d]));
+          }
+        }
+        inputImage.TransformContinuousIndexToPhysicalPoint(sampleContIndex, sample.m_ImageCoordinates);
+
+      } while (!isCandidate || !interpolator.IsInsideBuffer(sampleContIndex) ||
+               !mask.IsInsideInWorldSpace(sample.m_ImageCoordinates));
+
+      /** Compute the value at the continuous index. */
+      sample.m_ImageValue = static_cast<ImageSampleValueType>(interpolator.EvaluateAtContinuousIndex(sampleContIndex));
+
+    } // end for loop over the samples of the block
+  }   // end for loop over the blocks
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+/**
+ * ******************* UpdateMaskSpans *******************
+ */
+
+template <class TInputImage>
+void
+ImageRandomCoordinateSampler<TInputImage>::UpdateMaskSpans(const InputImageType &       inputImage,
+                                                          const MaskType &             mask,
+                                                          const InputImageRegionType & region)
+{
+  const ModifiedTimeType mtime = std::max(mask.GetMTime(), inputImage.GetMTime());
+  if (&mask == m_MaskSpansMask && mtime == m_MaskSpansMTime && region == m_MaskSpansRegion)
+  {
+    return;
+  }
+
+  m_MaskSpans.clear();
+  m_MaskSpansMask = &mask;
+  m_MaskSpansMTime = mtime;
+  m_MaskSpansRegion = region;
+
+  const auto regionSize = region.GetSize();
+  const auto numberOfPixels = region.GetNumberOfPixels();
+  if (numberOfPixels == 0)
+  {
+    return;
+  }
+
+  /** Flag the voxels whose center lies inside the mask. */
+  std::vector<unsigned char> flags(numberOfPixels);
+  {
+    auto flagIt = flags.begin();
+    for (ImageRegionConstIteratorWithIndex<InputImageType> it(&inputImage, region); !it.IsAtEnd(); ++it, ++flagIt)
+    {
+      InputImagePointType point;
+      inputImage.TransformIndexToPhysicalPoint(it.GetIndex(), point);
+      *flagIt = mask.IsInsideInWorldSpace(point) ? 1 : 0;
+    }
+  }
+
+  /** Dilate the flags by one voxel in each direction, so that the voxels of the spans
+   * also cover the parts of the mask that lie in between the voxel centers.
+   */
+  std::vector<unsigned char> dilatedFlags(numberOfPixels);
+  SizeValueType              stride = 1;
+  for (unsigned int d = 0; d < InputImageDimension; ++d)
+  {
+    for (SizeValueType i = 0; i < numberOfPixels; ++i)
+    {
+      const SizeValueType position = (i / stride) % regionSize[d];
+      dilatedFlags[i] = flags[i] | (position > 0 ? flags[i - stride] : 0) |
+                        (position + 1 < regionSize[d] ? flags[i + stride] : 0);
+    }
+    flags.swap(dilatedFlags);
+    stride *= regionSize[d];
+  }
+
+  /** Run-length encode the flags along the first dimension. */
+  const InputImageIndexType regionIndex = region.GetIndex();
+  SizeValueType             cumulativeLength = 0;
+  for (SizeValueType rowStart = 0; rowStart < numberOfPixels; rowStart += regionSize[0])
+  {
+    InputImageIndexType rowIndex = regionIndex;
+    SizeValueType       remainder = rowStart / regionSize[0];
+    for (unsigned int d = 1; d < InputImageDimension; ++d)
+    {
+      rowIndex[d] += static_cast<IndexValueType>(remainder % regionSize[d]);
+      remainder /= regionSize[d];
+    }
+
+    for (SizeValueType x = 0; x < regionSize[0];)
+    {
+      if (flags[rowStart + x] == 0)
+      {
+        ++x;
+        continue;
+      }
+      MaskSpan span;
+      span.m_StartIndex = rowIndex;
+      span.m_StartIndex[0] += static_cast<IndexValueType>(x);
+      while (x < regionSize[0] && flags[rowStart + x] != 0)
+      {
+        ++x;
+        ++cumulativeLength;
+      }
+      span.m_CumulativeLength = cumulativeLength;
+      m_MaskSpans.push_back(span);
+    }
+  }
+
+} // end UpdateMaskSpans()
+
+
+/**
+ * ******************* GenerateRandomCoordinateInMaskSpans *******************
+ */
+
+template <class TInputImage>
+bool
+ImageRandomCoordinateSampler<TInputImage>::GenerateRandomCoordinateInMaskSpans(
+  RandomGeneratorType &                 randomGenerator,
+  const std::vector<MaskSpan> &         maskSpans,
+  const InputImageContinuousIndexType & smallestContIndex,
+  const InputImageContinuousIndexType & largestContIndex,
+  InputImageContinuousIndexType &       randomContIndex)
+{
+  assert(!maskSpans.empty());
+
+  /** Select a voxel of the spans, uniformly, and a position within the span along the first dimension. */
+  const auto   totalLength = static_cast<double>(maskSpans.back().m_CumulativeLength);
+  const double position = randomGenerator.GetUniformVariate(0.0, totalLength);
+  auto         spanIt = std::upper_bound(
+    maskSpans.cbegin(), maskSpans.cend(), position, [](const double value, const MaskSpan & span) {
+      return value < static_cast<double>(span.m_CumulativeLength);
+    });
+  if (spanIt == maskSpans.cend())
+  {
+    --spanIt;
+  }
+  const double lengthBefore =
+    (spanIt == maskSpans.cbegin()) ? 0.0 : static_cast<double>((spanIt - 1)->m_CumulativeLength);
+
+  /** Select a position within the voxel along the other dimensions. */
+  randomContIndex[0] =
+    static_cast<InputImagePointValueType>(spanIt->m_StartIndex[0] + (position - lengthBefore) - 0.5);
+  for (unsigned int d = 1; d < InputImageDimension; ++d)
+  {
+    randomContIndex[d] =
+      static_cast<InputImagePointValueType>(spanIt->m_StartIndex[d] + randomGenerator.GetUniformVariate(-0.5, 0.5));
+  }
+
+  /** Reject the candidate when it lies outside the box between the two corners. */
+  for (unsigned int d = 0; d < InputImageDimension; ++d)
+  {
+    if (randomContIndex[d] < smallestContIndex[d] || randomContIndex[d] > largestContIndex[d])
+    {
+      return false;
+    }
+  }
+  return true;
+
+} // end GenerateRandomCoordinateInMaskSpans()
+
+
 /**
  * ******************* GenerateRandomCoordinate *******************
  */
@@ -271,6 +559,7 @@ ImageRandomCoordinateSampler<TInputImage>::PrintSelf(std::ostream & os, Indent i
 
   os << indent << "Interpolator: " << this->m_Interpolator.GetPointer() << std::endl;
   os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
+  os << indent << "UseMaskSpans: " << this->m_UseMaskSpans << std::endl;
 
 } // end PrintSelf()
 
@@ -20,6 +20,7 @@
 
 #include "itkImageRandomSamplerBase.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "elxRandomGenerator.h"
 #include "itkImageFullSampler.h"
 
 namespace itk
@@ -94,7 +95,7 @@ protected:
   void
   GenerateData() override;
 
-  RandomGeneratorPointer     m_RandomGenerator{ RandomGeneratorType::GetInstance() };
+  RandomGeneratorPointer     m_RandomGenerator{ elastix::RandomGenerator::GetCurrent() };
   InternalFullSamplerPointer m_InternalFullSampler{ InternalFullSamplerType::New() };
 
 private:
@@ -22,6 +22,10 @@
 #include "itkImageSample.h"
 #include "itkVectorDataContainer.h"
 #include "itkImageMaskSpatialObject.h"
+#include "elxFixedImagePreprocessingCache.h"
+
+#include <string>
+#include <vector>
 
 namespace itk
 {
@@ -209,6 +213,17 @@ public:
   /** Allows disabling the use of multi-threading, by `SetUseMultiThread(false)`. */
   itkSetMacro(UseMultiThread, bool);
 
+  /** Set the cache of fixed image preprocessing results, which is shared with other registrations to the same
+   * fixed image, and the key under which this sampler stores its results in the cache. Only used by samplers
+   * whose samples just depend on the input image, the masks, and the settings of the sampler.
+   */
+  void
+  SetFixedImagePreprocessingCache(elastix::FixedImagePreprocessingCache * const cache, const std::string & key)
+  {
+    m_FixedImagePreprocessingCache = cache;
+    m_FixedImagePreprocessingCacheKey = key;
+  }
+
 protected:
   /** The constructor. */
   ImageSamplerBase();
@@ -246,6 +261,16 @@ protected:
   static std::vector<InputImageRegionType>
   SplitRegion(const InputImageRegionType & inputRegion, const size_t requestedNumberOfSubregions);
 
+  /** Generates the samples by the specified function, or, when there is a fixed image preprocessing cache that
+   * has the samples already, copies them from the cache. The result name should identify the settings that
+   * affect the samples, other than the input image and the masks.
+   */
+  template <typename TGenerateSamplesFunction>
+  void
+  GenerateSamplesUsingFixedImagePreprocessingCache(const std::string &              resultName,
+                                                   std::vector<ImageSampleType> &   samples,
+                                                   const TGenerateSamplesFunction & generateSamples) const;
+
   /***/
   unsigned long m_NumberOfSamples{ 0 };
 
@@ -264,6 +289,10 @@ private:
 
   InputImageRegionType m_CroppedInputImageRegion{};
   InputImageRegionType m_DummyInputImageRegion{};
+
+  /** The cache of fixed image preprocessing results, shared with other registrations, and the key of this sampler. */
+  SmartPointer<elastix::FixedImagePreprocessingCache> m_FixedImagePreprocessingCache{ nullptr };
+  std::string                                         m_FixedImagePreprocessingCacheKey{};
 };
 
 } // end namespace itk
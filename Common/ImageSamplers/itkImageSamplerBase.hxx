@@ -548,6 +548,37 @@ ImageSamplerBase<TInputImage>::SplitRegion(const InputImageRegionType & inputReg
 }
 
 
+/**
+ * ******************* GenerateSamplesUsingFixedImagePreprocessingCache *******************
+ */
+
+template <class TInputImage>
+template <typename TGenerateSamplesFunction>
+void
+ImageSamplerBase<TInputImage>::GenerateSamplesUsingFixedImagePreprocessingCache(
+  const std::string &              resultName,
+  std::vector<ImageSampleType> &   samples,
+  const TGenerateSamplesFunction & generateSamples) const
+{
+  if (m_FixedImagePreprocessingCache.IsNull())
+  {
+    generateSamples(samples);
+    return;
+  }
+
+  const auto cachedSampleContainer = m_FixedImagePreprocessingCache->GetOrCreate<ImageSampleContainerType>(
+    m_FixedImagePreprocessingCacheKey + resultName, [&generateSamples] {
+      const auto sampleContainer = ImageSampleContainerType::New();
+      generateSamples(sampleContainer->CastToSTLContainer());
+      return sampleContainer;
+    });
+
+  /** Copy the samples, as the output of this sampler may be modified, while the cached samples are shared. */
+  samples = cachedSampleContainer->CastToSTLConstContainer();
+
+} // end GenerateSamplesUsingFixedImagePreprocessingCache()
+
+
 } // end namespace itk
 
 #endif // end #ifndef itkImageSamplerBase_hxx
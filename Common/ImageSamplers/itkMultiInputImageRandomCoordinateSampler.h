@@ -22,6 +22,7 @@
 #include "itkInterpolateImageFunction.h"
 #include "itkBSplineInterpolateImageFunction.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "elxRandomGenerator.h"
 
 namespace itk
 {
@@ -133,7 +134,7 @@ protected:
     return interpolator;
   }();
 
-  RandomGeneratorPointer m_RandomGenerator{ RandomGeneratorType::GetInstance() };
+  RandomGeneratorPointer m_RandomGenerator{ elastix::RandomGenerator::GetCurrent() };
   InputImageSpacingType  m_SampleRegionSize{ itk::MakeFilled<InputImageSpacingType>(1.0) };
 
   /** Generate the two corners of a sampling region. */
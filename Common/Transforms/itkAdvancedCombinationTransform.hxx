@@ -1404,6 +1404,44 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::TransformPoint(const Inp
 } // end TransformPoint()
 
 
+/**
+ * ****************** TransformPoints ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>::TransformPoints(const InputPointType * inputPoints,
+                                                                        OutputPointType *      outputPoints,
+                                                                        SizeValueType          numberOfPoints) const
+{
+  if (m_CurrentTransform.IsNull())
+  {
+    itkExceptionMacro(<< NoCurrentTransformSet);
+  }
+
+  if (m_InitialTransform.IsNull())
+  {
+    /** CURRENT ONLY: T(x) = T_1(x) */
+    m_CurrentTransform->TransformPoints(inputPoints, outputPoints, numberOfPoints);
+  }
+  else if (m_UseAddition)
+  {
+    /** ADDITION: T(x) = T_0(x) + T_1(x) - x */
+    for (SizeValueType i = 0; i < numberOfPoints; ++i)
+    {
+      outputPoints[i] = this->TransformPointUseAddition(inputPoints[i]);
+    }
+  }
+  else
+  {
+    /** COMPOSITION: T(x) = T_1( T_0(x) ) */
+    m_InitialTransform->TransformPoints(inputPoints, outputPoints, numberOfPoints);
+    m_CurrentTransform->TransformPoints(outputPoints, outputPoints, numberOfPoints);
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ****************** GetJacobian ****************************
  */
@@ -151,6 +151,15 @@ public:
   virtual NumberOfParametersType
   GetNumberOfNonZeroJacobianIndices() const;
 
+  /** Transform a contiguous range of points, in one call. The result is the same as calling
+   * TransformPoint() for each of the points, but subclasses may override this function to
+   * avoid the per-point overhead. The output range may be the same as the input range.
+   */
+  virtual void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  SizeValueType          numberOfPoints) const;
+
   /** Whether the advanced transform has nonzero matrices. */
   itkGetConstMacro(HasNonZeroSpatialHessian, bool);
   itkGetConstMacro(HasNonZeroJacobianOfSpatialHessian, bool);
@@ -121,6 +121,15 @@ public:
   OutputPointType
   TransformPoint(const InputPointType & point) const override;
 
+  /** Transform a range of points. The points are processed in blocks: first the
+   * interpolation weights and coefficient offsets are computed for all points of
+   * a block, then the coefficients are gathered and the displacements are computed.
+   */
+  void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  SizeValueType          numberOfPoints) const override;
+
   /** Compute the Jacobian of the transformation. */
   void
   GetJacobian(const InputPointType &       inputPoint,
@@ -20,7 +20,8 @@
 
 #include "itkRecursiveBSplineTransform.h"
 
-#include <numeric> // For iota.
+#include <algorithm> // For copy_n and min.
+#include <numeric>   // For iota.
 
 namespace itk
 {
@@ -85,6 +86,101 @@ RecursiveBSplineTransform<TScalar, NDimensions, VSplineOrder>::TransformPoint(co
 } // end TransformPoint()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template <typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+RecursiveBSplineTransform<TScalar, NDimensions, VSplineOrder>::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType *      outputPoints,
+  SizeValueType          numberOfPoints) const
+{
+  /** Check if the coefficient image has been set. */
+  if (!this->m_CoefficientImages[0])
+  {
+    itkWarningMacro("B-spline coefficients have not been set");
+    std::copy_n(inputPoints, numberOfPoints, outputPoints);
+    return;
+  }
+
+  /** Initialize (helper) variables. */
+  const OffsetValueType * bsplineOffsetTable = this->m_CoefficientImages[0]->GetOffsetTable();
+  ScalarType *            coefficientBuffers[SpaceDimension];
+  for (unsigned int j = 0; j < SpaceDimension; ++j)
+  {
+    coefficientBuffers[j] = this->m_CoefficientImages[j]->GetBufferPointer();
+  }
+
+  /** The number of points per block, limited to keep the weights of a block in the L1 cache. */
+  constexpr SizeValueType blockSize = 32;
+
+  InputPointType  blockPoints[blockSize];
+  WeightsType     blockWeights1D[blockSize];
+  OffsetValueType blockOffsets[blockSize];
+  bool            blockInside[blockSize];
+
+  for (SizeValueType blockBegin = 0; blockBegin < numberOfPoints; blockBegin += blockSize)
+  {
+    const SizeValueType n = std::min(blockSize, numberOfPoints - blockBegin);
+
+    /** Compute the weights and the offsets to the support regions of all points of the block.
+     * The input points are copied first, as the output range may be the same as the input range.
+     */
+    for (SizeValueType i = 0; i < n; ++i)
+    {
+      blockPoints[i] = inputPoints[blockBegin + i];
+      const ContinuousIndexType cindex = this->TransformPointToContinuousGridIndex(blockPoints[i]);
+
+      // NOTE: if the support region does not lie totally within the grid
+      // we assume zero displacement and return the input point
+      blockInside[i] = this->InsideValidRegion(cindex);
+      if (blockInside[i])
+      {
+        IndexType supportIndex;
+        blockWeights1D[i] = this->m_RecursiveBSplineWeightFunction.Evaluate(cindex, supportIndex);
+
+        OffsetValueType totalOffsetToSupportIndex = 0;
+        for (unsigned int j = 0; j < SpaceDimension; ++j)
+        {
+          totalOffsetToSupportIndex += supportIndex[j] * bsplineOffsetTable[j];
+        }
+        blockOffsets[i] = totalOffsetToSupportIndex;
+      }
+    }
+
+    /** Gather the coefficients and compute the displacements of all points of the block. */
+    for (SizeValueType i = 0; i < n; ++i)
+    {
+      OutputPointType & outputPoint = outputPoints[blockBegin + i];
+      if (!blockInside[i])
+      {
+        outputPoint = blockPoints[i];
+        continue;
+      }
+
+      ScalarType * mu[SpaceDimension];
+      for (unsigned int j = 0; j < SpaceDimension; ++j)
+      {
+        mu[j] = coefficientBuffers[j] + blockOffsets[i];
+      }
+
+      /** Call the recursive TransformPoint function. */
+      ScalarType displacement[SpaceDimension];
+      ImplementationType::TransformPoint(displacement, mu, bsplineOffsetTable, blockWeights1D[i].data());
+
+      // The output point is the start point + displacement.
+      for (unsigned int j = 0; j < SpaceDimension; ++j)
+      {
+        outputPoint[j] = displacement[j] + blockPoints[i][j];
+      }
+    }
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ********************* GetJacobian ****************************
  */
@@ -0,0 +1,211 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxBSplineCoefficientCache_h
+#define elxBSplineCoefficientCache_h
+
+#include "itkMultiOrderBSplineDecompositionImageFilter.h"
+
+#include <itkFixedArray.h>
+
+#include <cstddef> // For size_t.
+#include <list>
+#include <mutex>
+#include <utility> // For pair.
+
+namespace elastix
+{
+/**
+ * \class BSplineCoefficientCache
+ *
+ * \brief A process-wide cache of the B-spline coefficients of images.
+ *
+ * The coefficients of an image are computed by the (multi-threaded) MultiOrderBSplineDecompositionImageFilter.
+ * The cache allows B-spline interpolators that are set to the same image, with the same spline orders, to share the
+ * coefficients, instead of computing them again. For example, when the result image is resampled after each
+ * resolution, or when transformix resamples the same moving image for different transforms.
+ *
+ * An entry is identified by a CoefficientKey: the address, the modification time, the buffer and the buffered region
+ * of the image, and the spline orders. The cache does not keep the images alive. It does hold a reference to the
+ * coefficients of each entry, but ReleaseUnusedCoefficients removes the entries whose coefficients are not referenced
+ * anywhere else, so that the interpolators that use the cache can release the memory of their coefficients when they
+ * are destructed. Like for any other ITK filter, a modification of the pixel values of an image that is not
+ * followed by a call to its Modified() member function is not detected.
+ *
+ * All member functions are thread-safe. The coefficients are computed outside of the lock of the cache.
+ */
+template <class TInputImage, class TCoefficientImage>
+class BSplineCoefficientCache
+{
+public:
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+
+  using SplineOrderArrayType = itk::FixedArray<unsigned int, ImageDimension>;
+  using CoefficientImageConstPointer = typename TCoefficientImage::ConstPointer;
+  using DecompositionFilterType = itk::MultiOrderBSplineDecompositionImageFilter<TInputImage, TCoefficientImage>;
+
+  /** Identifies the coefficients of an image, for specific spline orders. */
+  struct CoefficientKey
+  {
+    const TInputImage *              m_Image{ nullptr };
+    itk::ModifiedTimeType            m_ModifiedTime{ 0 };
+    const void *                     m_Buffer{ nullptr };
+    typename TInputImage::RegionType m_BufferedRegion{};
+    SplineOrderArrayType             m_SplineOrders{};
+
+    CoefficientKey() = default;
+
+    CoefficientKey(const TInputImage & image, const SplineOrderArrayType & splineOrders)
+      : m_Image(&image)
+      , m_ModifiedTime(image.GetMTime())
+      , m_Buffer(image.GetBufferPointer())
+      , m_BufferedRegion(image.GetBufferedRegion())
+      , m_SplineOrders(splineOrders)
+    {}
+
+    bool
+    operator==(const CoefficientKey & other) const
+    {
+      return m_Image == other.m_Image && m_ModifiedTime == other.m_ModifiedTime && m_Buffer == other.m_Buffer &&
+             m_BufferedRegion == other.m_BufferedRegion && m_SplineOrders == other.m_SplineOrders;
+    }
+  };
+
+  /** Computes the coefficients of the image, for the specified spline orders, without using the cache. */
+  static CoefficientImageConstPointer
+  ComputeCoefficients(const TInputImage & image, const SplineOrderArrayType & splineOrders)
+  {
+    const auto filter = DecompositionFilterType::New();
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      filter->SetSplineOrder(d, splineOrders[d]);
+    }
+    filter->SetInput(&image);
+    filter->Update();
+
+    const typename TCoefficientImage::Pointer coefficients = filter->GetOutput();
+    coefficients->DisconnectPipeline();
+    return coefficients.GetPointer();
+  }
+
+  /** Returns the coefficients of the image, for the specified spline orders, from the cache when they are there.
+   * Otherwise computes them, and adds them to the cache, as its most recently used entry. */
+  static CoefficientImageConstPointer
+  GetCoefficients(const TInputImage & image, const SplineOrderArrayType & splineOrders)
+  {
+    State & state = GetState();
+    {
+      const CoefficientKey              key(image, splineOrders);
+      const std::lock_guard<std::mutex> lock(state.m_Mutex);
+      for (auto it = state.m_Entries.begin(); it != state.m_Entries.end(); ++it)
+      {
+        if (it->first == key)
+        {
+          state.m_Entries.splice(state.m_Entries.begin(), state.m_Entries, it);
+          return state.m_Entries.front().second;
+        }
+      }
+    }
+
+    const CoefficientImageConstPointer coefficients = ComputeCoefficients(image, splineOrders);
+
+    /** The key of the new entry is determined afterwards, as the computation may have updated the image. Another
+     * thread may have added the same entry in the meantime. */
+    const CoefficientKey              key(image, splineOrders);
+    const std::lock_guard<std::mutex> lock(state.m_Mutex);
+    state.m_Entries.remove_if([&key](const EntryType & entry) { return entry.first == key; });
+    if (state.m_MaximumNumberOfEntries > 0)
+    {
+      state.m_Entries.emplace_front(key, coefficients);
+      while (state.m_Entries.size() > state.m_MaximumNumberOfEntries)
+      {
+        state.m_Entries.pop_back();
+      }
+    }
+    return coefficients;
+  }
+
+  /** Removes the entries whose coefficients are only referenced by the cache itself. */
+  static void
+  ReleaseUnusedCoefficients()
+  {
+    State &                           state = GetState();
+    const std::lock_guard<std::mutex> lock(state.m_Mutex);
+    state.m_Entries.remove_if([](const EntryType & entry) { return entry.second->GetReferenceCount() <= 1; });
+  }
+
+  /** Removes all entries. */
+  static void
+  Clear()
+  {
+    State &                           state = GetState();
+    const std::lock_guard<std::mutex> lock(state.m_Mutex);
+    state.m_Entries.clear();
+  }
+
+  /** Set/Get the maximum number of entries. Zero disables the cache. Default: 4. */
+  static void
+  SetMaximumNumberOfEntries(const std::size_t maximumNumberOfEntries)
+  {
+    State &                           state = GetState();
+    const std::lock_guard<std::mutex> lock(state.m_Mutex);
+    state.m_MaximumNumberOfEntries = maximumNumberOfEntries;
+    while (state.m_Entries.size() > maximumNumberOfEntries)
+    {
+      state.m_Entries.pop_back();
+    }
+  }
+
+  static std::size_t
+  GetMaximumNumberOfEntries()
+  {
+    State &                           state = GetState();
+    const std::lock_guard<std::mutex> lock(state.m_Mutex);
+    return state.m_MaximumNumberOfEntries;
+  }
+
+  /** The number of entries that are currently in the cache. */
+  static std::size_t
+  GetNumberOfEntries()
+  {
+    State &                           state = GetState();
+    const std::lock_guard<std::mutex> lock(state.m_Mutex);
+    return state.m_Entries.size();
+  }
+
+private:
+  using EntryType = std::pair<CoefficientKey, CoefficientImageConstPointer>;
+
+  /** The entries, the most recently used one first. */
+  struct State
+  {
+    std::mutex           m_Mutex{};
+    std::list<EntryType> m_Entries{};
+    std::size_t          m_MaximumNumberOfEntries{ 4 };
+  };
+
+  static State &
+  GetState()
+  {
+    static State state;
+    return state;
+  }
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef elxBSplineCoefficientCache_h
@@ -0,0 +1,51 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "elxFixedImagePreprocessingCache.h"
+
+namespace elastix
+{
+
+/**
+ * ********************* GetOrCreateObject ****************************
+ */
+
+itk::Object::ConstPointer
+FixedImagePreprocessingCache::GetOrCreateObject(const std::string & key, const CreateFunctionType & createFunction)
+{
+  Entry * entry{};
+  {
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+    entry = &m_Entries[key];
+  }
+
+  /** Only lock the entry while creating its object, so that other keys can be created concurrently. */
+  const std::lock_guard<std::mutex> lock(entry->m_Mutex);
+  if (entry->m_Object.IsNull())
+  {
+    entry->m_Object = createFunction();
+    if (entry->m_Object.IsNotNull())
+    {
+      ++m_NumberOfObjects;
+    }
+  }
+  return entry->m_Object;
+
+} // end GetOrCreateObject()
+
+} // end namespace elastix
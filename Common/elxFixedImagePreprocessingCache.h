@@ -0,0 +1,122 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxFixedImagePreprocessingCache_h
+#define elxFixedImagePreprocessingCache_h
+
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+
+#include <atomic>
+#include <cstddef> // For size_t.
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace elastix
+{
+/**
+ * \class FixedImagePreprocessingCache
+ *
+ * \brief Stores the results of the preprocessing of a fixed image, to share them between registrations.
+ *
+ * When many moving images are registered to the same fixed image, with the same parameters, the
+ * preprocessing of the fixed image (its pyramid, its extrema, and its samples, when the sampler is
+ * deterministic) yields the same results for each of the registrations. The components store these
+ * results in this cache, under a key that identifies the component and the resolution, and retrieve
+ * them from the cache in the next registrations. The stored objects are shared between the
+ * registrations, so they must not be modified anymore, once they are stored.
+ *
+ * The cache may be used by concurrent registrations. GetOrCreate calls the create function only once
+ * for each key: concurrent calls for the same key wait for the first one, while calls for different
+ * keys do not wait for each other.
+ *
+ * \sa ElastixBatchRegistrationMethod
+ */
+class FixedImagePreprocessingCache : public itk::Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(FixedImagePreprocessingCache);
+
+  /** Standard ITK typedefs. */
+  using Self = FixedImagePreprocessingCache;
+  using Superclass = itk::Object;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(FixedImagePreprocessingCache, Object);
+
+  using CreateFunctionType = std::function<itk::Object::ConstPointer()>;
+
+  /** Returns the object that is stored under the specified key. When there is none yet, it calls the create
+   * function, and stores its result under the key. When the create function throws an exception, nothing is
+   * stored, so that a next call for the same key calls its create function again.
+   */
+  itk::Object::ConstPointer
+  GetOrCreateObject(const std::string & key, const CreateFunctionType & createFunction);
+
+  /** Like GetOrCreateObject, but returns the object as the specified type. Throws an exception when the stored
+   * object is not of that type.
+   */
+  template <typename TObject, typename TCreateFunction>
+  itk::SmartPointer<const TObject>
+  GetOrCreate(const std::string & key, const TCreateFunction & createFunction)
+  {
+    const itk::Object::ConstPointer object =
+      this->GetOrCreateObject(key, [&createFunction]() -> itk::Object::ConstPointer { return createFunction(); });
+    const auto * const typedObject = dynamic_cast<const TObject *>(object.GetPointer());
+
+    if (typedObject == nullptr)
+    {
+      itkExceptionMacro("The object that is stored under the key \"" << key << "\" is not of the expected type.");
+    }
+    return typedObject;
+  }
+
+  /** The number of objects that are stored in the cache. */
+  std::size_t
+  GetNumberOfObjects() const
+  {
+    return m_NumberOfObjects;
+  }
+
+protected:
+  FixedImagePreprocessingCache() = default;
+  ~FixedImagePreprocessingCache() override = default;
+
+private:
+  /** An entry is created for each requested key. Its mutex makes concurrent requests for its key wait. */
+  struct Entry
+  {
+    std::mutex                m_Mutex{};
+    itk::Object::ConstPointer m_Object{};
+  };
+
+  /** Entries are never removed from the map, so references to them remain valid. */
+  std::mutex                   m_Mutex{};
+  std::map<std::string, Entry> m_Entries{};
+  std::atomic<std::size_t>     m_NumberOfObjects{ 0 };
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef elxFixedImagePreprocessingCache_h
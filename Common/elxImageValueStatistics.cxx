@@ -0,0 +1,105 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "elxImageValueStatistics.h"
+
+#include <itkMacro.h> // For itkGenericExceptionMacro.
+
+#include <algorithm> // For min and max.
+
+namespace elastix
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+ImageValueStatistics::ImageValueStatistics(const double       histogramMinimum,
+                                           const double       histogramMaximum,
+                                           const unsigned int numberOfHistogramBins)
+  : m_HistogramMinimum(histogramMinimum)
+  , m_HistogramMaximum(histogramMaximum)
+  , m_InverseBinWidth(numberOfHistogramBins / (histogramMaximum - histogramMinimum))
+  , m_Histogram(numberOfHistogramBins)
+{
+  if (!(histogramMinimum < histogramMaximum) || numberOfHistogramBins == 0)
+  {
+    itkGenericExceptionMacro("Invalid histogram: the range [" << histogramMinimum << ", " << histogramMaximum
+                                                              << ") should not be empty, and the number of bins ("
+                                                              << numberOfHistogramBins << ") should not be zero.");
+  }
+
+} // end Constructor
+
+
+/**
+ * ********************* Merge ****************************
+ */
+
+void
+ImageValueStatistics::Merge(const ImageValueStatistics & other)
+{
+  if (other.m_HistogramMinimum != m_HistogramMinimum || other.m_HistogramMaximum != m_HistogramMaximum ||
+      other.m_Histogram.size() != m_Histogram.size())
+  {
+    itkGenericExceptionMacro("Statistics with different histograms cannot be merged.");
+  }
+
+  m_NumberOfValues += other.m_NumberOfValues;
+  m_NumberOfNonPositiveValues += other.m_NumberOfNonPositiveValues;
+  m_NumberOfValuesBelowHistogram += other.m_NumberOfValuesBelowHistogram;
+  m_NumberOfValuesAboveHistogram += other.m_NumberOfValuesAboveHistogram;
+  m_Sum += other.m_Sum;
+  m_Minimum = std::min(m_Minimum, other.m_Minimum);
+  m_Maximum = std::max(m_Maximum, other.m_Maximum);
+
+  for (std::size_t i = 0; i < m_Histogram.size(); ++i)
+  {
+    m_Histogram[i] += other.m_Histogram[i];
+  }
+
+} // end Merge()
+
+
+/**
+ * ********************* Print ****************************
+ */
+
+void
+ImageValueStatistics::Print(std::ostream & os) const
+{
+  os << "NumberOfValues: " << m_NumberOfValues << '\n'
+     << "Minimum: " << m_Minimum << '\n'
+     << "Maximum: " << m_Maximum << '\n'
+     << "Mean: " << this->GetMean() << '\n'
+     << "NumberOfNonPositiveValues: " << m_NumberOfNonPositiveValues << '\n'
+     << "FractionOfNonPositiveValues: " << this->GetFractionOfNonPositiveValues() << '\n'
+     << "NumberOfValuesBelowHistogram: " << m_NumberOfValuesBelowHistogram << '\n'
+     << "NumberOfValuesAboveHistogram: " << m_NumberOfValuesAboveHistogram << '\n'
+     << "Histogram (bin minimum, bin maximum, number of values):\n";
+
+  const double binWidth = 1.0 / m_InverseBinWidth;
+  for (std::size_t i = 0; i < m_Histogram.size(); ++i)
+  {
+    os << m_HistogramMinimum + static_cast<double>(i) * binWidth << ' '
+       << m_HistogramMinimum + static_cast<double>(i + 1) * binWidth << ' ' << m_Histogram[i] << '\n';
+  }
+
+} // end Print()
+
+} // end namespace elastix
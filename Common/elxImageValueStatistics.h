@@ -0,0 +1,184 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxImageValueStatistics_h
+#define elxImageValueStatistics_h
+
+#include <cmath>   // For isnan.
+#include <cstddef> // For size_t.
+#include <cstdint> // For uint64_t.
+#include <limits>
+#include <ostream>
+#include <vector>
+
+namespace elastix
+{
+/**
+ * \class ImageValueStatistics
+ *
+ * \brief Accumulates summary statistics of the values of an image, without storing the values.
+ *
+ * The statistics are the number of values, their minimum, maximum and mean, the number of non-positive
+ * values, and a histogram with equally sized bins over a fixed range. Values outside the range are counted
+ * separately. As the values are not stored, the statistics of a large image can be accumulated region by
+ * region, by different threads, each with its own ImageValueStatistics, which are merged at the end.
+ *
+ * For an image of spatial Jacobian determinants, the non-positive values are the voxels at which the
+ * transformation folds.
+ */
+class ImageValueStatistics
+{
+public:
+  /** Constructs empty statistics, with the specified histogram. */
+  ImageValueStatistics(const double       histogramMinimum,
+                       const double       histogramMaximum,
+                       const unsigned int numberOfHistogramBins);
+
+  /** Adds a value to the statistics. NaN values are ignored. */
+  void
+  Add(const double value)
+  {
+    if (std::isnan(value))
+    {
+      return;
+    }
+
+    ++m_NumberOfValues;
+    m_Sum += value;
+    m_Minimum = (value < m_Minimum) ? value : m_Minimum;
+    m_Maximum = (value > m_Maximum) ? value : m_Maximum;
+
+    if (value <= 0.0)
+    {
+      ++m_NumberOfNonPositiveValues;
+    }
+
+    if (value < m_HistogramMinimum)
+    {
+      ++m_NumberOfValuesBelowHistogram;
+    }
+    else if (value >= m_HistogramMaximum)
+    {
+      ++m_NumberOfValuesAboveHistogram;
+    }
+    else
+    {
+      const auto bin = static_cast<std::size_t>((value - m_HistogramMinimum) * m_InverseBinWidth);
+      ++m_Histogram[(bin < m_Histogram.size()) ? bin : (m_Histogram.size() - 1)];
+    }
+  }
+
+  /** Adds the values of the other statistics, which must have the same histogram range and number of bins. */
+  void
+  Merge(const ImageValueStatistics & other);
+
+  std::uint64_t
+  GetNumberOfValues() const
+  {
+    return m_NumberOfValues;
+  }
+
+  /** The minimum value, or +infinity when there are no values. */
+  double
+  GetMinimum() const
+  {
+    return m_Minimum;
+  }
+
+  /** The maximum value, or -infinity when there are no values. */
+  double
+  GetMaximum() const
+  {
+    return m_Maximum;
+  }
+
+  /** The mean value, or NaN when there are no values. */
+  double
+  GetMean() const
+  {
+    return (m_NumberOfValues > 0) ? (m_Sum / static_cast<double>(m_NumberOfValues))
+                                  : std::numeric_limits<double>::quiet_NaN();
+  }
+
+  std::uint64_t
+  GetNumberOfNonPositiveValues() const
+  {
+    return m_NumberOfNonPositiveValues;
+  }
+
+  /** The fraction of the values that are non-positive, or zero when there are no values. */
+  double
+  GetFractionOfNonPositiveValues() const
+  {
+    return (m_NumberOfValues > 0)
+             ? (static_cast<double>(m_NumberOfNonPositiveValues) / static_cast<double>(m_NumberOfValues))
+             : 0.0;
+  }
+
+  double
+  GetHistogramMinimum() const
+  {
+    return m_HistogramMinimum;
+  }
+
+  double
+  GetHistogramMaximum() const
+  {
+    return m_HistogramMaximum;
+  }
+
+  /** The number of values in each bin of the histogram. Bin i has the range [min + i * width, min + (i+1) * width). */
+  const std::vector<std::uint64_t> &
+  GetHistogram() const
+  {
+    return m_Histogram;
+  }
+
+  std::uint64_t
+  GetNumberOfValuesBelowHistogram() const
+  {
+    return m_NumberOfValuesBelowHistogram;
+  }
+
+  std::uint64_t
+  GetNumberOfValuesAboveHistogram() const
+  {
+    return m_NumberOfValuesAboveHistogram;
+  }
+
+  /** Prints the statistics as "Name: value" lines, followed by a line for each histogram bin. */
+  void
+  Print(std::ostream & os) const;
+
+private:
+  double                     m_HistogramMinimum;
+  double                     m_HistogramMaximum;
+  double                     m_InverseBinWidth;
+  std::vector<std::uint64_t> m_Histogram;
+
+  std::uint64_t m_NumberOfValues{ 0 };
+  std::uint64_t m_NumberOfNonPositiveValues{ 0 };
+  std::uint64_t m_NumberOfValuesBelowHistogram{ 0 };
+  std::uint64_t m_NumberOfValuesAboveHistogram{ 0 };
+  double        m_Sum{ 0.0 };
+  double        m_Minimum{ std::numeric_limits<double>::infinity() };
+  double        m_Maximum{ -std::numeric_limits<double>::infinity() };
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef elxImageValueStatistics_h
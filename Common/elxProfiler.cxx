@@ -0,0 +1,230 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "elxProfiler.h"
+
+#include <algorithm> // For min and max.
+#include <fstream>
+#include <iomanip> // For setprecision.
+#include <set>
+#include <sstream>
+
+namespace elastix
+{
+namespace
+{
+/** The current profiler of each thread. */
+thread_local Profiler * currentProfiler{ nullptr };
+
+
+/** Writes the begin of a JSON object that has the name, and the work unit of a measurement. */
+template <typename TKey>
+void
+WriteNameAndWorkUnit(std::ostream & stream, const TKey & key)
+{
+  stream << "        { \"name\": \"" << std::get<1>(key) << "\", \"workUnit\": " << std::get<2>(key);
+}
+
+} // namespace
+
+
+/**
+ * ********************* Scope ****************************
+ */
+
+Profiler::Scope::Scope(Profiler * const profiler)
+  : m_PreviousProfiler(currentProfiler)
+{
+  currentProfiler = profiler;
+}
+
+
+Profiler::Scope::~Scope()
+{
+  currentProfiler = m_PreviousProfiler;
+}
+
+
+/**
+ * ********************* GetCurrent ****************************
+ */
+
+Profiler *
+Profiler::GetCurrent()
+{
+  return currentProfiler;
+}
+
+
+/**
+ * ********************* SetCurrentResolution ****************************
+ */
+
+void
+Profiler::SetCurrentResolution(const unsigned int resolution)
+{
+  if (Profiler * const profiler = currentProfiler)
+  {
+    const std::lock_guard<std::mutex> lock(profiler->m_Mutex);
+    profiler->m_CurrentResolution = resolution;
+  }
+}
+
+
+/**
+ * ********************* AddTime ****************************
+ */
+
+void
+Profiler::AddTime(const char * const name, const double seconds, const unsigned int workUnit)
+{
+  if (Profiler * const profiler = currentProfiler)
+  {
+    const std::lock_guard<std::mutex> lock(profiler->m_Mutex);
+
+    TimerMeasurement & measurement = profiler->m_Timers[KeyType(profiler->m_CurrentResolution, name, workUnit)];
+    ++measurement.count;
+    measurement.totalSeconds += seconds;
+    measurement.minSeconds = std::min(measurement.minSeconds, seconds);
+    measurement.maxSeconds = std::max(measurement.maxSeconds, seconds);
+  }
+}
+
+
+/**
+ * ********************* AddCount ****************************
+ */
+
+void
+Profiler::AddCount(const char * const name, const std::uint64_t count, const unsigned int workUnit)
+{
+  if (Profiler * const profiler = currentProfiler)
+  {
+    const std::lock_guard<std::mutex> lock(profiler->m_Mutex);
+    profiler->m_Counters[KeyType(profiler->m_CurrentResolution, name, workUnit)] += count;
+  }
+}
+
+
+/**
+ * ********************* Reset ****************************
+ */
+
+void
+Profiler::Reset()
+{
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+
+  m_Timers.clear();
+  m_Counters.clear();
+  m_CurrentResolution = NoResolution;
+}
+
+
+/**
+ * ********************* ToJson ****************************
+ */
+
+std::string
+Profiler::ToJson() const
+{
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+
+  /** The measurements are grouped by resolution. NoResolution comes last, as it is the largest value. */
+  std::set<unsigned int> resolutions;
+  for (const auto & timer : m_Timers)
+  {
+    resolutions.insert(std::get<0>(timer.first));
+  }
+  for (const auto & counter : m_Counters)
+  {
+    resolutions.insert(std::get<0>(counter.first));
+  }
+
+  std::ostringstream stream;
+  stream << std::setprecision(9);
+  stream << "{\n  \"resolutions\": [";
+
+  const char * resolutionSeparator = "\n";
+  for (const unsigned int resolution : resolutions)
+  {
+    stream << resolutionSeparator << "    {\n      \"resolution\": ";
+    if (resolution == NoResolution)
+    {
+      stream << "null";
+    }
+    else
+    {
+      stream << resolution;
+    }
+
+    stream << ",\n      \"timers\": [";
+    const char * separator = "\n";
+    for (const auto & timer : m_Timers)
+    {
+      if (std::get<0>(timer.first) == resolution)
+      {
+        const TimerMeasurement & measurement = timer.second;
+        stream << separator;
+        WriteNameAndWorkUnit(stream, timer.first);
+        stream << ", \"count\": " << measurement.count << ", \"totalSeconds\": " << measurement.totalSeconds
+               << ", \"minSeconds\": " << measurement.minSeconds << ", \"maxSeconds\": " << measurement.maxSeconds
+               << " }";
+        separator = ",\n";
+      }
+    }
+
+    stream << "\n      ],\n      \"counters\": [";
+    separator = "\n";
+    for (const auto & counter : m_Counters)
+    {
+      if (std::get<0>(counter.first) == resolution)
+      {
+        stream << separator;
+        WriteNameAndWorkUnit(stream, counter.first);
+        stream << ", \"value\": " << counter.second << " }";
+        separator = ",\n";
+      }
+    }
+    stream << "\n      ]\n    }";
+    resolutionSeparator = ",\n";
+  }
+
+  stream << "\n  ]\n}\n";
+  return stream.str();
+}
+
+
+/**
+ * ********************* WriteJson ****************************
+ */
+
+bool
+Profiler::WriteJson(const std::string & fileName) const
+{
+  std::ofstream outputFileStream(fileName);
+
+  if (!outputFileStream.is_open())
+  {
+    return false;
+  }
+  outputFileStream << ToJson();
+  return static_cast<bool>(outputFileStream);
+}
+
+} // end namespace elastix
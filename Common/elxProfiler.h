@@ -0,0 +1,163 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxProfiler_h
+#define elxProfiler_h
+
+#include <itkMacro.h> // For ITK_DISALLOW_COPY_AND_MOVE.
+
+#include <chrono>
+#include <cstdint> // For uint64_t.
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+namespace elastix
+{
+/**
+ * \class Profiler
+ *
+ * \brief Collects the timings and counters of the hot paths of a registration.
+ *
+ * The measurements are aggregated per resolution, per name, and per work unit, and can be exported
+ * as JSON. Each registration has its own profiler. The measurements are recorded by the static member
+ * functions, which pass them to the current profiler of the calling thread. A profiler is made current
+ * by a Profiler::Scope, for the lifetime of that scope, so that it is not current anymore when an exception
+ * leaves the registration. The work units of WorkStealingThreadPool::ForkJoin take over the current profiler
+ * of the thread that called ForkJoin.
+ *
+ * While a thread has no current profiler, a ScopedTimer only checks a thread-local pointer. Otherwise, each
+ * measurement takes a (mostly uncontended) lock, so timers should be placed around coarse-grained phases,
+ * like a threaded callback or a sampler update, never inside a loop over samples.
+ *
+ * Elastix records the profile of a registration by <tt>(WriteProfile "true")</tt>, in which case the
+ * measurements are written to "elastix_profile.<ElastixLevel>.json" in the output directory.
+ */
+class Profiler
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(Profiler);
+
+  Profiler() = default;
+  ~Profiler() = default;
+
+  /** The resolution of the measurements that are made outside of any resolution, e.g., image I/O. */
+  static constexpr unsigned int NoResolution{ std::numeric_limits<unsigned int>::max() };
+
+  /** Makes the specified profiler (which may be null) the current one of the calling thread, from its
+   * construction until its destruction, and then restores the previous one. */
+  class Scope
+  {
+  public:
+    ITK_DISALLOW_COPY_AND_MOVE(Scope);
+
+    explicit Scope(Profiler * const profiler);
+    ~Scope();
+
+  private:
+    Profiler * const m_PreviousProfiler;
+  };
+
+  /** Returns the current profiler of the calling thread, or null when it has none. */
+  static Profiler *
+  GetCurrent();
+
+  /** Tells whether the calling thread has a current profiler, so whether its measurements are recorded. */
+  static bool
+  IsEnabled()
+  {
+    return GetCurrent() != nullptr;
+  }
+
+  /** Sets the resolution to which subsequent measurements of the current profiler are assigned. */
+  static void
+  SetCurrentResolution(const unsigned int resolution);
+
+  /** Adds a duration to the timer with the specified name. The name must not contain double quotes. */
+  static void
+  AddTime(const char * const name, const double seconds, const unsigned int workUnit = 0);
+
+  /** Adds to the counter with the specified name. The name must not contain double quotes. */
+  static void
+  AddCount(const char * const name, const std::uint64_t count, const unsigned int workUnit = 0);
+
+  /** Discards all measurements, and sets the resolution to NoResolution. */
+  void
+  Reset();
+
+  /** Returns all measurements as a JSON document. */
+  std::string
+  ToJson() const;
+
+  /** Writes all measurements as a JSON document to the specified file. Returns false on failure. */
+  bool
+  WriteJson(const std::string & fileName) const;
+
+  /** Measures the time from its construction until its destruction, when the profiler is enabled. */
+  class ScopedTimer
+  {
+  public:
+    ITK_DISALLOW_COPY_AND_MOVE(ScopedTimer);
+
+    explicit ScopedTimer(const char * const name, const unsigned int workUnit = 0)
+      : m_Name(Profiler::IsEnabled() ? name : nullptr)
+      , m_WorkUnit(workUnit)
+    {
+      if (m_Name != nullptr)
+      {
+        m_Start = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~ScopedTimer()
+    {
+      if (m_Name != nullptr)
+      {
+        const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - m_Start;
+        Profiler::AddTime(m_Name, duration.count(), m_WorkUnit);
+      }
+    }
+
+  private:
+    const char * const                    m_Name;
+    const unsigned int                    m_WorkUnit;
+    std::chrono::steady_clock::time_point m_Start{};
+  };
+
+private:
+  /** Resolution, name, and work unit of a measurement. */
+  using KeyType = std::tuple<unsigned int, std::string, unsigned int>;
+
+  struct TimerMeasurement
+  {
+    std::uint64_t count{ 0 };
+    double        totalSeconds{ 0.0 };
+    double        minSeconds{ std::numeric_limits<double>::max() };
+    double        maxSeconds{ 0.0 };
+  };
+
+  mutable std::mutex                  m_Mutex{};
+  std::map<KeyType, TimerMeasurement> m_Timers{};
+  std::map<KeyType, std::uint64_t>    m_Counters{};
+  unsigned int                        m_CurrentResolution{ NoResolution };
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef elxProfiler_h
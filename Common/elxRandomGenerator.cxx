@@ -0,0 +1,73 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "elxRandomGenerator.h"
+
+namespace elastix
+{
+namespace
+{
+/** The current random generator of each thread. */
+thread_local RandomGenerator::GeneratorType * currentGenerator{ nullptr };
+
+} // namespace
+
+
+/**
+ * ********************* Scope ****************************
+ */
+
+RandomGenerator::Scope::Scope(GeneratorType * const generator)
+  : m_PreviousGenerator(currentGenerator)
+{
+  currentGenerator = generator;
+}
+
+
+RandomGenerator::Scope::~Scope()
+{
+  currentGenerator = m_PreviousGenerator;
+}
+
+
+/**
+ * ********************* GetCurrent ****************************
+ */
+
+RandomGenerator::GeneratorType::Pointer
+RandomGenerator::GetCurrent()
+{
+  if (currentGenerator != nullptr)
+  {
+    return currentGenerator;
+  }
+  return GeneratorType::GetInstance();
+}
+
+
+/**
+ * ********************* GetCurrentOrNull ****************************
+ */
+
+RandomGenerator::GeneratorType *
+RandomGenerator::GetCurrentOrNull()
+{
+  return currentGenerator;
+}
+
+} // end namespace elastix
@@ -0,0 +1,71 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxRandomGenerator_h
+#define elxRandomGenerator_h
+
+#include <itkMacro.h> // For ITK_DISALLOW_COPY_AND_MOVE.
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+namespace elastix
+{
+/**
+ * \class RandomGenerator
+ *
+ * \brief Provides the random generator of the registration that runs on the calling thread.
+ *
+ * Each registration has its own generator, seeded by its RandomSeed parameter, so that registrations
+ * that run concurrently (for example, by ElastixBatchRegistrationMethod) do not share the state of
+ * a generator, and each of them draws the same random numbers as when it would run on its own. A
+ * generator is made current by a RandomGenerator::Scope, for the lifetime of that scope. The work units
+ * of WorkStealingThreadPool::ForkJoin take over the current generator of the thread that called ForkJoin.
+ *
+ * While a thread has no current generator, GetCurrent returns the process-wide instance of the
+ * MersenneTwisterRandomVariateGenerator, so that components that are used outside of a registration
+ * behave as before.
+ */
+class RandomGenerator
+{
+public:
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+
+  /** Makes the specified generator (which may be null) the current one of the calling thread, from its
+   * construction until its destruction, and then restores the previous one. */
+  class Scope
+  {
+  public:
+    ITK_DISALLOW_COPY_AND_MOVE(Scope);
+
+    explicit Scope(GeneratorType * const generator);
+    ~Scope();
+
+  private:
+    GeneratorType * const m_PreviousGenerator;
+  };
+
+  /** Returns the current generator of the calling thread, or the process-wide instance when it has none. */
+  static GeneratorType::Pointer
+  GetCurrent();
+
+  /** Returns the current generator of the calling thread, or null when it has none. */
+  static GeneratorType *
+  GetCurrentOrNull();
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef elxRandomGenerator_h
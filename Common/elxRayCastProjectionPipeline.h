@@ -0,0 +1,137 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxRayCastProjectionPipeline_h
+#define elxRayCastProjectionPipeline_h
+
+#include "itkAdvancedRayCastProjectionImageFilter.h"
+
+#include <memory> // For unique_ptr.
+
+namespace elastix
+{
+/**
+ * \class RayCastProjectionPipeline
+ *
+ * \brief A copy of the projection of an AdvancedRayCastProjectionImageFilter, with a transform of its own.
+ *
+ * The pipeline has its own clone of the transform of the original filter, its own ray cast interpolator and its own
+ * projection filter, so that it can project the volume at other transform parameters, concurrently with the original
+ * filter and with other pipelines. The volume itself is shared: the input of the projection filter of the pipeline
+ * is a graft of the input of the original filter. A graft has no source, so updating the pipeline does not visit
+ * the (non-thread-safe) upstream pipeline of the original input.
+ *
+ * The metrics that estimate their derivative by central differences use a pipeline for each thread, to compute the
+ * values at the test points concurrently.
+ */
+template <class TProjectionFilter>
+class RayCastProjectionPipeline
+{
+public:
+  using ProjectionFilterType = TProjectionFilter;
+  using InputImageType = typename ProjectionFilterType::InputImageType;
+  using OutputImageType = typename ProjectionFilterType::OutputImageType;
+  using RayCastInterpolatorType = typename ProjectionFilterType::RayCastInterpolatorType;
+  using TransformType = typename RayCastInterpolatorType::TransformType;
+  using ParametersType = typename TransformType::ParametersType;
+
+  /** Creates a pipeline that projects like the specified filter, whose transform must be the transform of its ray
+   * cast interpolator, using the specified clone of this transform. Returns null when the filter is not set up like
+   * this, or when the clone does not map the focal point and the output origin like the original transform, as
+   * some transforms have settings that are not copied by Clone().
+   */
+  static std::unique_ptr<RayCastProjectionPipeline>
+  Create(const ProjectionFilterType & filter, TransformType * const transformClone)
+  {
+    const auto * const rayCaster = dynamic_cast<const RayCastInterpolatorType *>(filter.GetInterpolator());
+    const InputImageType * const input = filter.GetInput();
+
+    if (rayCaster == nullptr || input == nullptr || transformClone == nullptr ||
+        rayCaster->GetTransform() == nullptr || filter.GetTransform() != rayCaster->GetTransform())
+    {
+      return nullptr;
+    }
+
+    const auto & focalPoint = rayCaster->GetFocalPoint();
+    const auto & origin = filter.GetOutputOrigin();
+    if (transformClone->TransformPoint(focalPoint) != rayCaster->GetTransform()->TransformPoint(focalPoint) ||
+        transformClone->TransformPoint(origin) != rayCaster->GetTransform()->TransformPoint(origin))
+    {
+      return nullptr;
+    }
+
+    std::unique_ptr<RayCastProjectionPipeline> pipeline(new RayCastProjectionPipeline(*rayCaster));
+    pipeline->m_Transform = transformClone;
+
+    const auto inputGraft = InputImageType::New();
+    inputGraft->Graft(input);
+
+    /** The input image is set last, so that the threshold bounding box of the ray caster is computed only once. */
+    RayCastInterpolatorType & pipelineRayCaster = *(pipeline->m_RayCaster);
+    pipelineRayCaster.SetTransform(transformClone);
+    pipelineRayCaster.SetFocalPoint(focalPoint);
+    pipelineRayCaster.SetThreshold(rayCaster->GetThreshold());
+    pipelineRayCaster.SetEarlyExitOnThreshold(rayCaster->GetEarlyExitOnThreshold());
+    pipelineRayCaster.SetInputImage(inputGraft);
+
+    ProjectionFilterType & pipelineFilter = *(pipeline->m_Filter);
+    pipelineFilter.SetInput(inputGraft);
+    pipelineFilter.SetTransform(transformClone);
+    pipelineFilter.SetInterpolator(pipeline->m_RayCaster);
+    pipelineFilter.SetSize(filter.GetSize());
+    pipelineFilter.SetOutputOrigin(filter.GetOutputOrigin());
+    pipelineFilter.SetOutputSpacing(filter.GetOutputSpacing());
+    pipelineFilter.SetOutputDirection(filter.GetOutputDirection());
+
+    return pipeline;
+  }
+
+  /** Sets the parameters of the transform of the pipeline, and copies the focal point and the threshold settings of
+   * the original ray cast interpolator, which may have changed since the previous call. The projection is computed
+   * when the output is updated.
+   */
+  void
+  SetTransformParameters(const ParametersType & parameters)
+  {
+    m_RayCaster->SetFocalPoint(m_OriginalRayCaster.GetFocalPoint());
+    m_RayCaster->SetThreshold(m_OriginalRayCaster.GetThreshold());
+    m_RayCaster->SetEarlyExitOnThreshold(m_OriginalRayCaster.GetEarlyExitOnThreshold());
+    m_Transform->SetParameters(parameters);
+    m_Filter->Modified();
+  }
+
+  /** The output of the projection filter of the pipeline, to be connected to the filters that process it. */
+  OutputImageType *
+  GetOutput()
+  {
+    return m_Filter->GetOutput();
+  }
+
+private:
+  explicit RayCastProjectionPipeline(const RayCastInterpolatorType & originalRayCaster)
+    : m_OriginalRayCaster(originalRayCaster)
+  {}
+
+  const RayCastInterpolatorType &                 m_OriginalRayCaster;
+  typename TransformType::Pointer                 m_Transform{};
+  const typename RayCastInterpolatorType::Pointer m_RayCaster{ RayCastInterpolatorType::New() };
+  const typename ProjectionFilterType::Pointer    m_Filter{ ProjectionFilterType::New() };
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef elxRayCastProjectionPipeline_h
@@ -0,0 +1,404 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "elxWorkStealingThreadPool.h"
+#include "elxProfiler.h"
+#include "elxRandomGenerator.h"
+
+#include <algorithm> // For max and min.
+#include <chrono>
+#include <exception> // For exception_ptr.
+
+namespace elastix
+{
+
+/** The state that the work units of one ForkJoin call share. It lives on the stack of the calling thread. */
+struct WorkStealingThreadPool::ForkJoinState
+{
+  std::mutex              m_Mutex{};
+  std::condition_variable m_Condition{};
+  unsigned int            m_NumberOfRemainingTasks{ 0 };
+  std::exception_ptr      m_Exception{};
+
+  /** The current profiler of the calling thread, which the work units take over. */
+  Profiler * m_Profiler{ nullptr };
+
+  /** The current random generator of the calling thread, which the work units take over. */
+  RandomGenerator::GeneratorType * m_RandomGenerator{ nullptr };
+};
+
+
+/**
+ * ********************* GetInstance ****************************
+ */
+
+WorkStealingThreadPool &
+WorkStealingThreadPool::GetInstance()
+{
+  static WorkStealingThreadPool threadPool;
+  threadPool.EnsureNumberOfThreads(
+    std::max(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(), itk::ThreadIdType{ 1 }));
+  return threadPool;
+
+} // end GetInstance()
+
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+WorkStealingThreadPool::WorkStealingThreadPool()
+{
+  /** The calling thread of ForkJoin is the remaining thread. */
+  const unsigned int maximumNumberOfPoolThreads =
+    std::max(itk::MultiThreaderBase::GetGlobalMaximumNumberOfThreads(), itk::ThreadIdType{ 1 }) - 1;
+
+  m_Queues.reserve(maximumNumberOfPoolThreads);
+  for (unsigned int i = 0; i < maximumNumberOfPoolThreads; ++i)
+  {
+    m_Queues.push_back(std::make_unique<TaskQueue>());
+  }
+  m_Threads.reserve(maximumNumberOfPoolThreads);
+
+} // end Constructor
+
+
+/**
+ * ********************* Destructor ****************************
+ */
+
+WorkStealingThreadPool::~WorkStealingThreadPool()
+{
+  {
+    const std::lock_guard<std::mutex> lock(m_WakeMutex);
+    m_Stop = true;
+  }
+  m_WakeCondition.notify_all();
+
+  for (auto & thread : m_Threads)
+  {
+    thread.join();
+  }
+
+} // end Destructor
+
+
+/**
+ * ********************* EnsureNumberOfThreads ****************************
+ */
+
+void
+WorkStealingThreadPool::EnsureNumberOfThreads(const unsigned int numberOfThreads)
+{
+  const std::size_t numberOfPoolThreads = std::min<std::size_t>(std::max(numberOfThreads, 1U) - 1, m_Queues.size());
+  if (numberOfPoolThreads <= m_NumberOfPoolThreads)
+  {
+    return;
+  }
+
+  /** A new thread may immediately start stealing from the queues of the existing threads. Its own queue
+   * only receives tasks after m_NumberOfPoolThreads is increased, which happens after the thread is started.
+   */
+  const std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+  for (std::size_t i = m_Threads.size(); i < numberOfPoolThreads; ++i)
+  {
+    m_Threads.emplace_back([this, i] { this->WorkerLoop(i); });
+  }
+  m_NumberOfPoolThreads = m_Threads.size();
+
+} // end EnsureNumberOfThreads()
+
+
+/**
+ * ********************* ForkJoin ****************************
+ */
+
+void
+WorkStealingThreadPool::ForkJoin(const unsigned int numberOfWorkUnits, const WorkUnitFunctionType & workUnitFunction)
+{
+  const std::size_t numberOfQueues = m_NumberOfPoolThreads;
+
+  /** Without any thread to fork to, just execute the work units one after the other. */
+  if ((numberOfWorkUnits <= 1) || (numberOfQueues == 0))
+  {
+    for (unsigned int workUnit = 0; workUnit < numberOfWorkUnits; ++workUnit)
+    {
+      workUnitFunction(workUnit);
+    }
+    return;
+  }
+
+  ForkJoinState state;
+  state.m_NumberOfRemainingTasks = numberOfWorkUnits - 1;
+  state.m_Profiler = Profiler::GetCurrent();
+  state.m_RandomGenerator = RandomGenerator::GetCurrentOrNull();
+
+  /** Announce the tasks before queueing them, so that the count never drops below zero. */
+  {
+    const std::lock_guard<std::mutex> lock(m_WakeMutex);
+    m_NumberOfQueuedTasks += numberOfWorkUnits - 1;
+  }
+
+  /** Distribute the work units 1, 2, ... round-robin over the queues. Successive calls start at different
+   * queues, so that concurrent fork-join phases do not all start with the first thread of the pool.
+   */
+  const std::size_t firstQueueIndex = m_NextQueueIndex++ % numberOfQueues;
+  for (unsigned int workUnit = 1; workUnit < numberOfWorkUnits; ++workUnit)
+  {
+    TaskQueue &                       queue = *m_Queues[(firstQueueIndex + workUnit - 1) % numberOfQueues];
+    const std::lock_guard<std::mutex> lock(queue.m_Mutex);
+    queue.m_Tasks.push_back(Task{ &workUnitFunction, workUnit, &state });
+  }
+  m_WakeCondition.notify_all();
+
+  /** The calling thread executes work unit 0 itself. */
+  std::exception_ptr exception;
+  try
+  {
+    workUnitFunction(0);
+  }
+  catch (...)
+  {
+    exception = std::current_exception();
+  }
+
+  /** Help executing the queued tasks, until all work units of this call are finished. The state may only
+   * go out of scope once the last task has released its mutex.
+   */
+  while (true)
+  {
+    {
+      const std::lock_guard<std::mutex> lock(state.m_Mutex);
+      if (state.m_NumberOfRemainingTasks == 0)
+      {
+        break;
+      }
+    }
+    if (!this->TryExecuteQueuedTask(firstQueueIndex))
+    {
+      std::unique_lock<std::mutex> lock(state.m_Mutex);
+      state.m_Condition.wait_for(
+        lock, std::chrono::microseconds(100), [&state] { return state.m_NumberOfRemainingTasks == 0; });
+    }
+  }
+
+  if (exception == nullptr)
+  {
+    exception = state.m_Exception;
+  }
+  if (exception != nullptr)
+  {
+    std::rethrow_exception(exception);
+  }
+
+} // end ForkJoin()
+
+
+/**
+ * ********************* SingleMethodExecute ****************************
+ */
+
+void
+WorkStealingThreadPool::SingleMethodExecute(const unsigned int            numberOfWorkUnits,
+                                            const itk::ThreadFunctionType threadFunction,
+                                            void * const                  userData)
+{
+  this->ForkJoin(numberOfWorkUnits, [numberOfWorkUnits, threadFunction, userData](const unsigned int workUnit) {
+    itk::MultiThreaderBase::WorkUnitInfo workUnitInfo{};
+    workUnitInfo.WorkUnitID = workUnit;
+    workUnitInfo.NumberOfWorkUnits = numberOfWorkUnits;
+    workUnitInfo.UserData = userData;
+    workUnitInfo.ThreadFunction = threadFunction;
+    threadFunction(&workUnitInfo);
+  });
+
+} // end SingleMethodExecute()
+
+
+/**
+ * ********************* TryExecuteQueuedTask ****************************
+ */
+
+bool
+WorkStealingThreadPool::TryExecuteQueuedTask(const std::size_t firstQueueIndex)
+{
+  const std::size_t numberOfQueues = m_NumberOfPoolThreads;
+
+  for (std::size_t i = 0; i < numberOfQueues; ++i)
+  {
+    TaskQueue & queue = *m_Queues[(firstQueueIndex + i) % numberOfQueues];
+    Task        task;
+    {
+      const std::lock_guard<std::mutex> lock(queue.m_Mutex);
+      if (queue.m_Tasks.empty())
+      {
+        continue;
+      }
+
+      /** Take the oldest task from the first queue, and steal the newest one from any other queue. */
+      if (i == 0)
+      {
+        task = queue.m_Tasks.front();
+        queue.m_Tasks.pop_front();
+      }
+      else
+      {
+        task = queue.m_Tasks.back();
+        queue.m_Tasks.pop_back();
+      }
+    }
+    --m_NumberOfQueuedTasks;
+    ExecuteTask(task);
+    return true;
+  }
+  return false;
+
+} // end TryExecuteQueuedTask()
+
+
+/**
+ * ********************* ExecuteTask ****************************
+ */
+
+void
+WorkStealingThreadPool::ExecuteTask(const Task & task)
+{
+  ForkJoinState & state = *task.m_State;
+
+  std::exception_ptr exception;
+  try
+  {
+    const Profiler::Scope        profilerScope(state.m_Profiler);
+    const RandomGenerator::Scope randomGeneratorScope(state.m_RandomGenerator);
+    (*task.m_Function)(task.m_WorkUnit);
+  }
+  catch (...)
+  {
+    exception = std::current_exception();
+  }
+
+  /** Notify while holding the lock: the state may be destructed as soon as the lock is released. */
+  const std::lock_guard<std::mutex> lock(state.m_Mutex);
+  if ((exception != nullptr) && (state.m_Exception == nullptr))
+  {
+    state.m_Exception = exception;
+  }
+  if (--state.m_NumberOfRemainingTasks == 0)
+  {
+    state.m_Condition.notify_all();
+  }
+
+} // end ExecuteTask()
+
+
+/**
+ * ********************* WorkerLoop ****************************
+ */
+
+void
+WorkStealingThreadPool::WorkerLoop(const std::size_t queueIndex)
+{
+  while (true)
+  {
+    if (this->TryExecuteQueuedTask(queueIndex))
+    {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_WakeMutex);
+    m_WakeCondition.wait(lock, [this] { return m_Stop || (m_NumberOfQueuedTasks > 0); });
+    if (m_Stop && (m_NumberOfQueuedTasks == 0))
+    {
+      return;
+    }
+  }
+
+} // end WorkerLoop()
+
+
+/**
+ * ********************* GetChunkSize ****************************
+ */
+
+std::size_t
+ChunkedRange::GetChunkSize(const std::size_t rangeSize, const unsigned int numberOfWorkUnits)
+{
+  /** Aim at a number of chunks per work unit, for load balancing, while keeping the chunks large enough
+   * to amortize the overhead per chunk and to allow batched processing (e.g., of the transformed points).
+   */
+  constexpr std::size_t chunksPerWorkUnit{ 8 };
+  constexpr std::size_t minimumChunkSize{ 64 };
+
+  const std::size_t numberOfChunks = std::max<std::size_t>(numberOfWorkUnits, 1) * chunksPerWorkUnit;
+  return std::max((rangeSize + numberOfChunks - 1) / numberOfChunks, minimumChunkSize);
+
+} // end GetChunkSize()
+
+
+/**
+ * ********************* GetNextChunk ****************************
+ */
+
+bool
+ChunkedRange::GetNextChunk(const std::size_t  rangeSize,
+                           const unsigned int numberOfWorkUnits,
+                           std::size_t &      chunkBegin,
+                           std::size_t &      chunkEnd)
+{
+  const std::size_t chunkSize = GetChunkSize(rangeSize, numberOfWorkUnits);
+  const std::size_t chunkIndex = m_NextChunkIndex++;
+
+  if (chunkIndex >= (rangeSize + chunkSize - 1) / chunkSize)
+  {
+    return false;
+  }
+  chunkBegin = chunkIndex * chunkSize;
+  chunkEnd = std::min(chunkBegin + chunkSize, rangeSize);
+  return true;
+
+} // end GetNextChunk()
+
+
+/**
+ * ********************* GetNextChunkOfWorkUnit ****************************
+ */
+
+bool
+ChunkedRange::GetNextChunkOfWorkUnit(const std::size_t  rangeSize,
+                                     const unsigned int numberOfWorkUnits,
+                                     const unsigned int workUnit,
+                                     std::size_t &      chunkBegin,
+                                     std::size_t &      chunkEnd)
+{
+  const std::size_t chunkSize = GetChunkSize(rangeSize, numberOfWorkUnits);
+
+  /** A chunk is never empty, so a chunk end of zero indicates the first call. */
+  const std::size_t chunkIndex =
+    (chunkEnd == 0) ? workUnit : (chunkBegin / chunkSize + std::max<std::size_t>(numberOfWorkUnits, 1));
+
+  if (chunkIndex >= (rangeSize + chunkSize - 1) / chunkSize)
+  {
+    return false;
+  }
+  chunkBegin = chunkIndex * chunkSize;
+  chunkEnd = std::min(chunkBegin + chunkSize, rangeSize);
+  return true;
+
+} // end GetNextChunkOfWorkUnit()
+
+} // end namespace elastix
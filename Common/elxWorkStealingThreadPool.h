@@ -0,0 +1,196 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxWorkStealingThreadPool_h
+#define elxWorkStealingThreadPool_h
+
+#include <itkMacro.h>            // For ITK_DISALLOW_COPY_AND_MOVE.
+#include <itkMultiThreaderBase.h> // For ThreadFunctionType and WorkUnitInfo.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef> // For size_t.
+#include <deque>
+#include <functional>
+#include <memory> // For unique_ptr.
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace elastix
+{
+/**
+ * \class WorkStealingThreadPool
+ *
+ * \brief A process-wide pool of long-lived threads, which executes fork-join phases.
+ *
+ * ForkJoin calls a function for each of the specified number of work units, and returns when all
+ * of them are finished. The work units are distributed over the task queues of the threads. An idle
+ * thread takes work from its own queue first, and then steals work from the queues of the other
+ * threads. The calling thread executes work unit 0 itself, and helps executing queued work while it
+ * waits for the other work units, so that fork-join phases may be nested. When a work unit throws an
+ * exception, ForkJoin rethrows it, after all work units are finished. The work units record their
+ * measurements in the current Profiler of the thread that called ForkJoin, and draw their random numbers
+ * from its current RandomGenerator.
+ *
+ * Unlike itk::PlatformMultiThreader, which creates and joins its threads in every SingleMethodExecute
+ * call, the threads of this pool persist until the end of the process. GetInstance creates the pool at its
+ * first call, and adds threads whenever the global default number of ITK threads (as set by
+ * itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads, or by the "-threads" command-line argument) has
+ * become larger than the number of threads of the pool, up to the global maximum number of ITK threads.
+ * The pool does not remove threads when this global default decreases: the callers then just request
+ * fewer work units, and the remaining threads stay asleep.
+ */
+class WorkStealingThreadPool
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(WorkStealingThreadPool);
+
+  using WorkUnitFunctionType = std::function<void(unsigned int)>;
+
+  /** Returns the pool, creating it at the first call, and adding threads when the global default number of
+   * ITK threads has increased. */
+  static WorkStealingThreadPool &
+  GetInstance();
+
+  /** The number of threads that execute work units, including the calling thread. */
+  unsigned int
+  GetNumberOfThreads() const
+  {
+    return static_cast<unsigned int>(m_NumberOfPoolThreads) + 1;
+  }
+
+  /** Calls the function for each work unit in [0, numberOfWorkUnits), and waits until all calls are finished. */
+  void
+  ForkJoin(const unsigned int numberOfWorkUnits, const WorkUnitFunctionType & workUnitFunction);
+
+  /** Calls the ITK thread function for each work unit, passing a WorkUnitInfo, like the SetSingleMethod and
+   * SingleMethodExecute member functions of itk::PlatformMultiThreader do, and waits until all calls are finished.
+   */
+  void
+  SingleMethodExecute(const unsigned int            numberOfWorkUnits,
+                      const itk::ThreadFunctionType threadFunction,
+                      void * const                  userData);
+
+private:
+  struct ForkJoinState;
+
+  struct Task
+  {
+    const WorkUnitFunctionType * m_Function;
+    unsigned int                 m_WorkUnit;
+    ForkJoinState *              m_State;
+  };
+
+  struct TaskQueue
+  {
+    std::mutex       m_Mutex{};
+    std::deque<Task> m_Tasks{};
+  };
+
+  WorkStealingThreadPool();
+
+  ~WorkStealingThreadPool();
+
+  /** Starts additional threads, until the pool has at least the specified number of threads (including the
+   * calling thread), as far as the maximum number of threads allows. */
+  void
+  EnsureNumberOfThreads(const unsigned int numberOfThreads);
+
+  /** Executes one queued task, looking in the queue with the specified index first. Returns false when
+   * all queues are empty. */
+  bool
+  TryExecuteQueuedTask(const std::size_t firstQueueIndex);
+
+  static void
+  ExecuteTask(const Task & task);
+
+  void
+  WorkerLoop(const std::size_t queueIndex);
+
+  /** One task queue for each thread that the pool may have. The queues are all created by the constructor,
+   * so that the threads may access them while the pool grows. Only the first m_NumberOfPoolThreads queues are
+   * in use. */
+  std::vector<std::unique_ptr<TaskQueue>> m_Queues{};
+  std::vector<std::thread>                m_Threads{};
+  std::mutex                              m_ThreadsMutex{};
+  std::atomic<std::size_t>                m_NumberOfPoolThreads{ 0 };
+
+  /** The threads of the pool sleep on this condition while all queues are empty. */
+  std::mutex               m_WakeMutex{};
+  std::condition_variable  m_WakeCondition{};
+  std::atomic<std::size_t> m_NumberOfQueuedTasks{ 0 };
+  std::atomic<std::size_t> m_NextQueueIndex{ 0 };
+  bool                     m_Stop{ false };
+};
+
+
+/**
+ * \class ChunkedRange
+ *
+ * \brief Divides an index range into consecutive chunks, and hands them out to the work units of a
+ * fork-join phase.
+ *
+ * Instead of processing one fixed slice of the range, each work unit processes a number of chunks, which
+ * balances the load when some parts of the range are much cheaper than others (for example, because most
+ * of their samples are rejected by a mask). GetNextChunk hands out the chunks first come, first served. It
+ * is meant for phases whose results do not depend on which work unit processes an index. GetNextChunkOfWorkUnit
+ * assigns the chunks statically, round-robin, so that each work unit always processes the same chunks, in the
+ * same order. It is meant for phases that accumulate per-work-unit sums, to keep them reproducible.
+ */
+class ChunkedRange
+{
+public:
+  /** Makes the first chunk of the range the next one to be handed out by GetNextChunk. */
+  void
+  Reset()
+  {
+    m_NextChunkIndex = 0;
+  }
+
+  /** Retrieves the next chunk [chunkBegin, chunkEnd) of the range [0, rangeSize), first come, first served.
+   * Returns false when the range is exhausted. All work units of a fork-join phase must specify the same
+   * arguments.
+   */
+  bool
+  GetNextChunk(const std::size_t  rangeSize,
+               const unsigned int numberOfWorkUnits,
+               std::size_t &      chunkBegin,
+               std::size_t &      chunkEnd);
+
+  /** Retrieves the next chunk [chunkBegin, chunkEnd) of the range [0, rangeSize) that is assigned to the
+   * specified work unit: chunk workUnit, workUnit + numberOfWorkUnits, workUnit + 2 * numberOfWorkUnits, etc.
+   * Returns false when the work unit has no more chunks. Does not need any shared state: chunkBegin and
+   * chunkEnd must both be zero at the first call, and are then the chunk of the previous call.
+   */
+  static bool
+  GetNextChunkOfWorkUnit(const std::size_t  rangeSize,
+                         const unsigned int numberOfWorkUnits,
+                         const unsigned int workUnit,
+                         std::size_t &      chunkBegin,
+                         std::size_t &      chunkEnd);
+
+private:
+  static std::size_t
+  GetChunkSize(const std::size_t rangeSize, const unsigned int numberOfWorkUnits);
+
+  std::atomic<std::size_t> m_NextChunkIndex{ 0 };
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef elxWorkStealingThreadPool_h
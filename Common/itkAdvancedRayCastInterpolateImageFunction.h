@@ -35,6 +35,7 @@ PURPOSE.  See the above copyright notices for more information.
 #define itkAdvancedRayCastInterpolateImageFunction_h
 
 #include "itkInterpolateImageFunction.h"
+#include "itkFixedArray.h"
 #include "itkTransform.h"
 #include "itkVector.h"
 
@@ -48,6 +49,14 @@ namespace itk
  * image and uses bilinear interpolation to integrate each plane of
  * voxels traversed.
  *
+ * Each ray is traversed by IntegrateRay, which does not modify the interpolator, so that the rays of a
+ * projection image (a digitally reconstructed radiograph) can be cast concurrently, as is done by the
+ * AdvancedRayCastProjectionImageFilter. The ray is sampled at the centres of the planes of voxels along the
+ * axis in which it moves the most. The range of planes whose samples lie inside the volume is computed in
+ * advance, so that each sample only needs its four voxels. When EarlyExitOnThreshold is enabled, that range is
+ * further limited to the bounding box of the voxels above the threshold, as the samples outside of that box do
+ * not contribute to the integral.
+ *
  * \warning This interpolator works for 3-dimensional images only.
  *
  * \ingroup ImageFunctions
@@ -160,11 +169,32 @@ public:
   /** Get a pointer to the Interpolator.  */
   itkGetConstMacro(FocalPoint, InputPointType);
 
-  /** Connect the Transform. */
-  itkSetMacro(Threshold, double);
-  /** Get a pointer to the Transform.  */
+  /** Set the threshold above which voxels along the ray path are integrated. */
+  virtual void
+  SetThreshold(const double threshold);
+
+  /** Get the threshold above which voxels along the ray path are integrated. */
   itkGetConstMacro(Threshold, double);
 
+  /** Skip the parts of the rays that lie outside of the bounding box of the voxels above the threshold.
+   * Does not change the result, but requires a pass over the image whenever the input image or the threshold
+   * is set. Changes of the pixel values after setting the input image are not detected. Default: false. */
+  virtual void
+  SetEarlyExitOnThreshold(const bool earlyExitOnThreshold);
+
+  itkGetConstMacro(EarlyExitOnThreshold, bool);
+  itkBooleanMacro(EarlyExitOnThreshold);
+
+  /** Set the input image, and store its geometry, for the traversal of the rays. */
+  void
+  SetInputImage(const InputImageType * ptr) override;
+
+  /** Integrates the image along the ray from the specified point towards the specified (transformed) focal
+   * point, beyond both points, until the ray leaves the volume. Returns zero for a ray that does not intersect
+   * the volume. Thread-safe: it does not use the transform, and it does not modify the interpolator. */
+  double
+  IntegrateRay(const PointType & point, const OutputPointType & transformedFocalPoint) const;
+
   /** Check if a point is inside the image buffer.
    * \warning For efficiency, no validity checking of
    * the input image pointer is done. */
@@ -213,6 +243,20 @@ protected:
   InterpolatorPointer m_Interpolator{};
 
 private:
+  /** Computes m_ThresholdBoundingBox, when EarlyExitOnThreshold is enabled, and there is an input image. */
+  void
+  UpdateThresholdBoundingBox();
+
+  /** The buffer, size, spacing and offset table of the input image, as used by IntegrateRay. */
+  const PixelType *              m_Buffer{ nullptr };
+  FixedArray<OffsetValueType, 3> m_NumberOfVoxels{};
+  FixedArray<double, 3>          m_VoxelSpacing{};
+  FixedArray<OffsetValueType, 3> m_VoxelOffsets{};
+  bool                           m_EarlyExitOnThreshold{ false };
+  bool                           m_HasVoxelsAboveThreshold{ true };
+  FixedArray<OffsetValueType, 3> m_ThresholdBoundingBoxMinimum{};
+  FixedArray<OffsetValueType, 3> m_ThresholdBoundingBoxMaximum{};
+
   SizeType
   GetRadius() const override
   {
@@ -223,8 +267,6 @@ private:
     }
     return input->GetLargestPossibleRegion().GetSize();
   }
-
-  class RayCastHelper;
 };
 
 } // namespace itk
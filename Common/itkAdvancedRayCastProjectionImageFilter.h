@@ -0,0 +1,136 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkAdvancedRayCastProjectionImageFilter_h
+#define itkAdvancedRayCastProjectionImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkAdvancedRayCastInterpolateImageFunction.h"
+
+namespace itk
+{
+/** \class AdvancedRayCastProjectionImageFilter
+ * \brief Computes a projection image (a digitally reconstructed radiograph) of a 3-dimensional volume, by casting
+ * a ray through the volume for each output pixel.
+ *
+ * The filter replaces a ResampleImageFilter with an AdvancedRayCastInterpolateImageFunction as interpolator,
+ * and has the same interface. The position of each output pixel is mapped by the transform (when specified),
+ * and the volume is integrated along the ray from that position towards the focal point of the interpolator, as
+ * mapped by the transform of the interpolator. Rays that do not intersect the volume yield zero.
+ *
+ * The focal point is transformed only once, and each ray is cast by the thread-safe IntegrateRay of the
+ * interpolator, rather than by Evaluate. The rows of the output image are distributed over the threads of the
+ * elastix::WorkStealingThreadPool, in tiles of consecutive rows, which each thread takes on a first come, first
+ * served basis. Within a row, the position of each pixel is derived from the position of the first pixel.
+ *
+ * \sa AdvancedRayCastInterpolateImageFunction, ResampleImageFilter
+ *
+ * \ingroup GeometricTransform MultiThreaded
+ */
+template <class TInputImage, class TOutputImage, class TInterpolatorPrecisionType = double>
+class ITK_TEMPLATE_EXPORT AdvancedRayCastProjectionImageFilter : public ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(AdvancedRayCastProjectionImageFilter);
+
+  /** Standard class typedefs. */
+  using Self = AdvancedRayCastProjectionImageFilter;
+  using Superclass = ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(AdvancedRayCastProjectionImageFilter, ImageToImageFilter);
+
+  /** Dimensions of the images. */
+  itkStaticConstMacro(InputImageDimension, unsigned int, TInputImage::ImageDimension);
+  itkStaticConstMacro(OutputImageDimension, unsigned int, TOutputImage::ImageDimension);
+
+  /** Typedefs of the images. */
+  using InputImageType = TInputImage;
+  using OutputImageType = TOutputImage;
+  using OutputPixelType = typename OutputImageType::PixelType;
+  using RegionType = typename OutputImageType::RegionType;
+  using SizeType = typename OutputImageType::SizeType;
+  using IndexType = typename OutputImageType::IndexType;
+  using SpacingType = typename OutputImageType::SpacingType;
+  using OriginPointType = typename OutputImageType::PointType;
+  using DirectionType = typename OutputImageType::DirectionType;
+
+  /** Typedefs of the transform and the interpolator. */
+  using TransformType = Transform<TInterpolatorPrecisionType, OutputImageDimension, InputImageDimension>;
+  using InterpolatorType = InterpolateImageFunction<InputImageType, TInterpolatorPrecisionType>;
+  using RayCastInterpolatorType = AdvancedRayCastInterpolateImageFunction<InputImageType, TInterpolatorPrecisionType>;
+
+  /** Set/Get the transform that maps the positions of the output pixels. When it is not set, the positions
+   * are used as they are. */
+  itkSetConstObjectMacro(Transform, TransformType);
+  itkGetConstObjectMacro(Transform, TransformType);
+
+  /** Set/Get the interpolator, which must be an AdvancedRayCastInterpolateImageFunction. Its focal point,
+   * transform and threshold define the projection. */
+  itkSetObjectMacro(Interpolator, InterpolatorType);
+  itkGetModifiableObjectMacro(Interpolator, InterpolatorType);
+
+  /** Set/Get the geometry of the output image. */
+  itkSetMacro(Size, SizeType);
+  itkGetConstReferenceMacro(Size, SizeType);
+  itkSetMacro(OutputOrigin, OriginPointType);
+  itkGetConstReferenceMacro(OutputOrigin, OriginPointType);
+  itkSetMacro(OutputSpacing, SpacingType);
+  itkGetConstReferenceMacro(OutputSpacing, SpacingType);
+  itkSetMacro(OutputDirection, DirectionType);
+  itkGetConstReferenceMacro(OutputDirection, DirectionType);
+
+protected:
+  AdvancedRayCastProjectionImageFilter();
+  ~AdvancedRayCastProjectionImageFilter() override = default;
+
+  /** The output image has the specified size, origin, spacing and direction. */
+  void
+  GenerateOutputInformation() override;
+
+  /** The whole input volume is needed. */
+  void
+  GenerateInputRequestedRegion() override;
+
+  /** Casts the rays of the requested region of the output image. */
+  void
+  GenerateData() override;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  typename TransformType::ConstPointer m_Transform{};
+  typename InterpolatorType::Pointer   m_Interpolator{};
+  SizeType                             m_Size{};
+  OriginPointType                      m_OutputOrigin{};
+  SpacingType                          m_OutputSpacing{};
+  DirectionType                        m_OutputDirection{};
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkAdvancedRayCastProjectionImageFilter.hxx"
+#endif
+
+#endif // end #ifndef itkAdvancedRayCastProjectionImageFilter_h
@@ -0,0 +1,202 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkAdvancedRayCastProjectionImageFilter_hxx
+#define itkAdvancedRayCastProjectionImageFilter_hxx
+
+#include "itkAdvancedRayCastProjectionImageFilter.h"
+#include "elxWorkStealingThreadPool.h"
+
+#include <algorithm> // For min.
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template <class TInputImage, class TOutputImage, class TInterpolatorPrecisionType>
+AdvancedRayCastProjectionImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::
+  AdvancedRayCastProjectionImageFilter()
+{
+  m_OutputSpacing.Fill(1.0);
+  m_OutputDirection.SetIdentity();
+
+} // end Constructor
+
+
+/**
+ * ******************* GenerateOutputInformation ***********************
+ */
+
+template <class TInputImage, class TOutputImage, class TInterpolatorPrecisionType>
+void
+AdvancedRayCastProjectionImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::
+  GenerateOutputInformation()
+{
+  this->Superclass::GenerateOutputInformation();
+
+  OutputImageType * const output = this->GetOutput();
+  if (output == nullptr)
+  {
+    return;
+  }
+
+  output->SetLargestPossibleRegion(RegionType(m_Size));
+  output->SetOrigin(m_OutputOrigin);
+  output->SetSpacing(m_OutputSpacing);
+  output->SetDirection(m_OutputDirection);
+
+} // end GenerateOutputInformation()
+
+
+/**
+ * ******************* GenerateInputRequestedRegion ***********************
+ */
+
+template <class TInputImage, class TOutputImage, class TInterpolatorPrecisionType>
+void
+AdvancedRayCastProjectionImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::
+  GenerateInputRequestedRegion()
+{
+  this->Superclass::GenerateInputRequestedRegion();
+
+  const auto input = const_cast<InputImageType *>(this->GetInput());
+  if (input != nullptr)
+  {
+    input->SetRequestedRegionToLargestPossibleRegion();
+  }
+
+} // end GenerateInputRequestedRegion()
+
+
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template <class TInputImage, class TOutputImage, class TInterpolatorPrecisionType>
+void
+AdvancedRayCastProjectionImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::GenerateData()
+{
+  const InputImageType * const input = this->GetInput();
+  auto * const rayCaster = dynamic_cast<RayCastInterpolatorType *>(m_Interpolator.GetPointer());
+
+  if (rayCaster == nullptr)
+  {
+    itkExceptionMacro("The interpolator should be an AdvancedRayCastInterpolateImageFunction!");
+  }
+  if (rayCaster->GetTransform() == nullptr)
+  {
+    itkExceptionMacro("The transform of the ray cast interpolator is not set!");
+  }
+  if (rayCaster->GetInputImage() != input)
+  {
+    rayCaster->SetInputImage(input);
+  }
+
+  OutputImageType * const output = this->GetOutput();
+  output->SetBufferedRegion(output->GetRequestedRegion());
+  output->Allocate();
+
+  const RegionType region = output->GetBufferedRegion();
+  const SizeType   size = region.GetSize();
+  if (region.GetNumberOfPixels() == 0)
+  {
+    return;
+  }
+
+  using PointType = typename TransformType::InputPointType;
+  using VectorType = typename PointType::VectorType;
+
+  /** The focal point is the same for all rays. */
+  const auto transformedFocalPoint = rayCaster->GetTransform()->TransformPoint(rayCaster->GetFocalPoint());
+
+  /** The distance between successive pixels of a row, in physical space. */
+  VectorType pixelStep;
+  for (unsigned int i = 0; i < OutputImageDimension; ++i)
+  {
+    pixelStep[i] = output->GetDirection()[i][0] * output->GetSpacing()[0];
+  }
+
+  const TransformType * const transform = m_Transform.GetPointer();
+  const std::size_t           numberOfRows = region.GetNumberOfPixels() / size[0];
+
+  auto &             threadPool = elastix::WorkStealingThreadPool::GetInstance();
+  const unsigned int numberOfWorkUnits =
+    static_cast<unsigned int>(std::min<std::size_t>(threadPool.GetNumberOfThreads(), numberOfRows));
+  elastix::ChunkedRange rows;
+
+  threadPool.ForkJoin(numberOfWorkUnits, [&](unsigned int) {
+    std::size_t rowBegin{};
+    std::size_t rowEnd{};
+
+    while (rows.GetNextChunk(numberOfRows, numberOfWorkUnits, rowBegin, rowEnd))
+    {
+      for (std::size_t row = rowBegin; row < rowEnd; ++row)
+      {
+        /** The index of the first pixel of the row. */
+        IndexType   index = region.GetIndex();
+        std::size_t remainder = row;
+        for (unsigned int i = 1; i < OutputImageDimension; ++i)
+        {
+          index[i] += static_cast<IndexValueType>(remainder % size[i]);
+          remainder /= size[i];
+        }
+
+        PointType firstPoint;
+        output->TransformIndexToPhysicalPoint(index, firstPoint);
+        OutputPixelType * const pixels = output->GetBufferPointer() + output->ComputeOffset(index);
+
+        for (SizeValueType x = 0; x < size[0]; ++x)
+        {
+          const PointType point = firstPoint + pixelStep * static_cast<double>(x);
+          const double    integral = rayCaster->IntegrateRay(transform ? transform->TransformPoint(point) : point,
+                                                          transformedFocalPoint);
+          pixels[x] = static_cast<OutputPixelType>(integral);
+        }
+      }
+    }
+  });
+
+} // end GenerateData()
+
+
+/**
+ * ******************* PrintSelf ***********************
+ */
+
+template <class TInputImage, class TOutputImage, class TInterpolatorPrecisionType>
+void
+AdvancedRayCastProjectionImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::PrintSelf(
+  std::ostream & os,
+  Indent         indent) const
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "Transform: " << m_Transform.GetPointer() << std::endl;
+  os << indent << "Interpolator: " << m_Interpolator.GetPointer() << std::endl;
+  os << indent << "Size: " << m_Size << std::endl;
+  os << indent << "OutputOrigin: " << m_OutputOrigin << std::endl;
+  os << indent << "OutputSpacing: " << m_OutputSpacing << std::endl;
+  os << indent << "OutputDirection: " << m_OutputDirection << std::endl;
+
+} // end PrintSelf()
+
+} // end namespace itk
+
+#endif // end #ifndef itkAdvancedRayCastProjectionImageFilter_hxx
@@ -0,0 +1,102 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkCachedBSplineInterpolateImageFunction_h
+#define itkCachedBSplineInterpolateImageFunction_h
+
+#include "itkBSplineInterpolateImageFunction.h"
+#include "elxBSplineCoefficientCache.h"
+
+namespace itk
+{
+/** \class CachedBSplineInterpolateImageFunction
+ * \brief A BSplineInterpolateImageFunction that computes its coefficients multi-threaded, and avoids
+ * recomputing them.
+ *
+ * The coefficients are computed by the MultiOrderBSplineDecompositionImageFilter, which filters many lines of
+ * the image at once, on all threads of the elastix::WorkStealingThreadPool, instead of by the single-threaded
+ * BSplineDecompositionImageFilter of ITK. The coefficients are the same.
+ *
+ * When SetInputImage is called again, with the same (unmodified) image and spline order, the coefficients of the
+ * previous call are reused. When UseCoefficientCache is on, the coefficients are moreover shared with the other
+ * interpolators that have UseCoefficientCache on, via the process-wide elastix::BSplineCoefficientCache.
+ *
+ * \sa BSplineInterpolateImageFunction, elastix::BSplineCoefficientCache
+ *
+ * \ingroup ImageFunctions ImageInterpolators
+ */
+template <class TImageType, class TCoordRep = double, class TCoefficientType = double>
+class ITK_TEMPLATE_EXPORT CachedBSplineInterpolateImageFunction
+  : public BSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(CachedBSplineInterpolateImageFunction);
+
+  /** Standard class typedefs. */
+  using Self = CachedBSplineInterpolateImageFunction;
+  using Superclass = BSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(CachedBSplineInterpolateImageFunction, BSplineInterpolateImageFunction);
+
+  /** New macro for creation of through a Smart Pointer */
+  itkNewMacro(Self);
+
+  /** Dimension underlying input image. */
+  itkStaticConstMacro(ImageDimension, unsigned int, Superclass::ImageDimension);
+
+  /** Typedefs inherited from the superclass. */
+  using typename Superclass::CoefficientImageType;
+
+  /** The cache of coefficients. */
+  using CoefficientCacheType = elastix::BSplineCoefficientCache<TImageType, CoefficientImageType>;
+
+  /** Set the input image, and compute its coefficients, unless they are already available. */
+  void
+  SetInputImage(const TImageType * inputData) override;
+
+  /** Set/Get whether the coefficients are shared via the process-wide cache. Default: false. */
+  itkSetMacro(UseCoefficientCache, bool);
+  itkGetConstMacro(UseCoefficientCache, bool);
+  itkBooleanMacro(UseCoefficientCache);
+
+protected:
+  CachedBSplineInterpolateImageFunction() = default;
+  ~CachedBSplineInterpolateImageFunction() override;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  using CoefficientKeyType = typename CoefficientCacheType::CoefficientKey;
+  using InterpolateImageFunctionType = InterpolateImageFunction<TImageType, TCoordRep>;
+
+  bool m_UseCoefficientCache{ false };
+
+  /** Identifies the coefficients that were computed by the last SetInputImage call. */
+  CoefficientKeyType m_CoefficientKey{};
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkCachedBSplineInterpolateImageFunction.hxx"
+#endif
+
+#endif // end #ifndef itkCachedBSplineInterpolateImageFunction_h
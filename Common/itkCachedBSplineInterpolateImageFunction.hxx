@@ -0,0 +1,103 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkCachedBSplineInterpolateImageFunction_hxx
+#define itkCachedBSplineInterpolateImageFunction_hxx
+
+#include "itkCachedBSplineInterpolateImageFunction.h"
+
+namespace itk
+{
+
+/**
+ * ******************* Destructor ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+CachedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::
+  ~CachedBSplineInterpolateImageFunction()
+{
+  /** Let the cache release the coefficients, when no other interpolator uses them. */
+  if (m_UseCoefficientCache)
+  {
+    this->m_Coefficients = nullptr;
+    CoefficientCacheType::ReleaseUnusedCoefficients();
+  }
+
+} // end Destructor
+
+
+/**
+ * ******************* SetInputImage ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+void
+CachedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::SetInputImage(
+  const TImageType * inputData)
+{
+  if (inputData == nullptr)
+  {
+    m_CoefficientKey = CoefficientKeyType();
+    this->Superclass::SetInputImage(inputData);
+    return;
+  }
+
+  typename CoefficientCacheType::SplineOrderArrayType splineOrders;
+  splineOrders.Fill(this->GetSplineOrder());
+
+  if (this->m_Coefficients.IsNull() || !(CoefficientKeyType(*inputData, splineOrders) == m_CoefficientKey))
+  {
+    const bool releaseCachedCoefficients = m_UseCoefficientCache && this->m_Coefficients.IsNotNull();
+
+    this->m_Coefficients = m_UseCoefficientCache ? CoefficientCacheType::GetCoefficients(*inputData, splineOrders)
+                                                 : CoefficientCacheType::ComputeCoefficients(*inputData, splineOrders);
+
+    /** The key is determined afterwards, as the computation may have updated the input image. */
+    m_CoefficientKey = CoefficientKeyType(*inputData, splineOrders);
+
+    if (releaseCachedCoefficients)
+    {
+      CoefficientCacheType::ReleaseUnusedCoefficients();
+    }
+  }
+
+  /** Bypass the computation of the coefficients by the superclass. */
+  this->InterpolateImageFunctionType::SetInputImage(inputData);
+  this->m_DataLength = inputData->GetBufferedRegion().GetSize();
+
+} // end SetInputImage()
+
+
+/**
+ * ******************* PrintSelf ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+void
+CachedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::PrintSelf(std::ostream & os,
+                                                                                          Indent         indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "UseCoefficientCache: " << (m_UseCoefficientCache ? "true" : "false") << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef itkCachedBSplineInterpolateImageFunction_hxx
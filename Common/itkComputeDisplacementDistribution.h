@@ -25,6 +25,7 @@
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkImageFullSampler.h"
 #include "itkPlatformMultiThreader.h"
+#include "elxWorkStealingThreadPool.h"
 
 #include <vector>
 
@@ -285,11 +285,9 @@ template <class TFixedImage, class TTransform>
 void
 ComputeDisplacementDistribution<TFixedImage, TTransform>::LaunchComputeThreaderCallback() const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod(this->ComputeThreaderCallback, &m_ThreaderParameters);
-
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
+  /** Launch on the persistent thread pool. */
+  elastix::WorkStealingThreadPool::GetInstance().SingleMethodExecute(
+    this->m_Threader->GetNumberOfWorkUnits(), this->ComputeThreaderCallback, &m_ThreaderParameters);
 
 } // end LaunchComputeThreaderCallback()
 
@@ -334,13 +332,6 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::ThreadedCompute(Thread
   /** Get a handle to the scales vector */
   const ScalesType & scales = this->GetScales();
 
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(numberOfThreads)));
-
-  const auto pos_begin = std::min<size_t>(nrOfSamplesPerThreads * threadId, sampleContainerSize);
-  const auto pos_end = std::min<size_t>(nrOfSamplesPerThreads * (threadId + 1), sampleContainerSize);
-
   /** Variables for nonzerojacobian indices and the Jacobian. */
   const SizeValueType sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
   JacobianType        jacj(outdim, sizejacind);
@@ -366,53 +357,61 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::ThreadedCompute(Thread
 
   /** Create iterator over the sample container. */
   const auto beginOfSampleContainer = this->m_SampleContainer->cbegin();
-  const auto threader_fbegin = beginOfSampleContainer + pos_begin;
-  const auto threader_fend = beginOfSampleContainer + pos_end;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for (auto threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (elastix::ChunkedRange::GetNextChunkOfWorkUnit(
+    sampleContainerSize, numberOfThreads, threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = threader_fiter->m_ImageCoordinates;
-    this->m_Transform->GetJacobian(point, jacj, jacind);
+    const auto threader_fbegin = beginOfSampleContainer + pos_begin;
+    const auto threader_fend = beginOfSampleContainer + pos_end;
 
-    /** Apply scales, if necessary. */
-    if (this->GetUseScales())
+    /** Loop over the fixed image to calculate the mean squares. */
+    for (auto threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
     {
-      for (unsigned int pi = 0; pi < sizejacind; ++pi)
+      /** Read fixed coordinates and get Jacobian. */
+      const FixedImagePointType & point = threader_fiter->m_ImageCoordinates;
+      this->m_Transform->GetJacobian(point, jacj, jacind);
+
+      /** Apply scales, if necessary. */
+      if (this->GetUseScales())
       {
-        const unsigned int p = jacind[pi];
-        jacj.scale_column(pi, 1.0 / scales[p]);
+        for (unsigned int pi = 0; pi < sizejacind; ++pi)
+        {
+          const unsigned int p = jacind[pi];
+          jacj.scale_column(pi, 1.0 / scales[p]);
+        }
       }
-    }
 
-    /** Compute 1st part of JJ: ||J_j||_F^2. */
-    double JJ_j = vnl_math::sqr(jacj.frobenius_norm());
+      /** Compute 1st part of JJ: ||J_j||_F^2. */
+      double JJ_j = vnl_math::sqr(jacj.frobenius_norm());
 
-    /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
-    vnl_fastops::ABt(jacjjacj, jacj, jacj); // is this thread-safe?
-    JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
+      /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
+      vnl_fastops::ABt(jacjjacj, jacj, jacj); // is this thread-safe?
+      JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
 
-    /** Max_j [JJ_j]. */
-    maxJJ = std::max(maxJJ, JJ_j);
+      /** Max_j [JJ_j]. */
+      maxJJ = std::max(maxJJ, JJ_j);
 
-    /** Compute the displacement  jac * gradient. */
-    for (unsigned int i = 0; i < outdim; ++i)
-    {
-      double temp = 0.0;
-      for (unsigned int j = 0; j < sizejacind; ++j)
+      /** Compute the displacement  jac * gradient. */
+      for (unsigned int i = 0; i < outdim; ++i)
       {
-        int pj = jacind[j];
-        temp += jacj(i, j) * this->m_ExactGradient(pj);
+        double temp = 0.0;
+        for (unsigned int j = 0; j < sizejacind; ++j)
+        {
+          int pj = jacind[j];
+          temp += jacj(i, j) * this->m_ExactGradient(pj);
+        }
+        Jgg(i) = temp;
       }
-      Jgg(i) = temp;
-    }
 
-    /** Sum the Jgg displacement for later use. */
-    jggMagnitude = Jgg.magnitude();
-    displacement += jggMagnitude;
-    displacementSquared += vnl_math::sqr(jggMagnitude);
-    ++numberOfPixelsCounted;
+      /** Sum the Jgg displacement for later use. */
+      jggMagnitude = Jgg.magnitude();
+      displacement += jggMagnitude;
+      displacementSquared += vnl_math::sqr(jggMagnitude);
+      ++numberOfPixelsCounted;
+    }
   }
 
   /** Update the thread struct once. */
@@ -22,6 +22,14 @@
 #include "itkImageRandomSamplerBase.h"
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
+#include "itkMultiThreaderBase.h"
+#include "elxWorkStealingThreadPool.h"
+
+#include <vnl/vnl_diag_matrix.h>
+#include <vnl/vnl_sparse_matrix.h>
+
+#include <algorithm> // For max.
+#include <vector>
 
 namespace itk
 {
@@ -31,6 +39,13 @@ namespace itk
  * More specifically this class computes the Jacobian terms related to the automatic
  * parameter estimation for the adaptive stochastic gradient descent optimizer.
  * Details can be found in the paper.
+ *
+ * By default the computation is multi-threaded. Every work unit accumulates the covariance
+ * matrix of its own part of the samples, after which the per-thread accumulators are merged,
+ * every work unit taking care of a block of rows. Each per-thread accumulator contains a dense
+ * band matrix of NumberOfParameters x MaxBandCovSize elements, so the memory they occupy can
+ * be limited by SetMaximumThreadAccumulatorMemory(), which reduces the number of work units
+ * used for the accumulation, if necessary.
  */
 
 template <class TFixedImage, class TTransform>
@@ -88,6 +103,24 @@ public:
   itkSetMacro(NumberOfBandStructureSamples, unsigned int);
   itkSetMacro(NumberOfJacobianMeasurements, SizeValueType);
 
+  /** Select the multi-threaded (default) or the single-threaded implementation. */
+  itkSetMacro(UseMultiThread, bool);
+  itkGetConstMacro(UseMultiThread, bool);
+
+  /** Set/Get the maximum number of bytes that the per-thread covariance accumulators may occupy
+   * together. Default: 512 MB. When the limit only allows a single accumulator (for example, when
+   * it is zero), the single-threaded accumulation is used.
+   */
+  itkSetMacro(MaximumThreadAccumulatorMemory, SizeValueType);
+  itkGetConstMacro(MaximumThreadAccumulatorMemory, SizeValueType);
+
+  /** Set the number of work units. Default: the global default number of ITK threads. */
+  void
+  SetNumberOfWorkUnits(ThreadIdType numberOfWorkUnits)
+  {
+    this->m_NumberOfWorkUnits = std::max<ThreadIdType>(numberOfWorkUnits, 1);
+  }
+
   /** Set the region over which the metric will be computed. */
   void
   SetFixedImageRegion(const FixedImageRegionType & region)
@@ -121,6 +154,10 @@ protected:
   unsigned int  m_NumberOfBandStructureSamples{ 0 };
   SizeValueType m_NumberOfJacobianMeasurements{ 0 };
 
+  bool          m_UseMultiThread{ true };
+  SizeValueType m_MaximumThreadAccumulatorMemory{ SizeValueType{ 512 } * 1024 * 1024 };
+  ThreadIdType  m_NumberOfWorkUnits{ MultiThreaderBase::GetGlobalDefaultNumberOfThreads() };
+
   using FixedImageIndexType = typename FixedImageType::IndexType;
   using FixedImagePointType = typename FixedImageType::PointType;
   using JacobianType = typename TransformType::JacobianType;
@@ -147,6 +184,81 @@ protected:
   // in the future it would be better to refactoring this part of the code.
   virtual void
   SampleFixedImageForJacobianTerms(ImageSampleContainerPointer & sampleContainer);
+
+  /** Typedefs for the covariance matrix. */
+  using CovarianceValueType = double;
+  using CovarianceMatrixType = vnl_matrix<CovarianceValueType>;
+  using SparseCovarianceMatrixType = vnl_sparse_matrix<CovarianceValueType>;
+  using DiagCovarianceMatrixType = vnl_diag_matrix<CovarianceValueType>;
+
+  /** Returns a reference to the element (r, c) of the sparse covariance matrix, inserting it when necessary. */
+  static CovarianceValueType &
+  GetCovarianceElement(SparseCovarianceMatrixType & cov, const unsigned int r, const unsigned int c);
+
+  /** Accumulates the upper triangular part of J^T J / n, stored in jactjac, into the band matrix
+   * and the sparse matrix.
+   */
+  void
+  UpdateCovariance(const CovarianceMatrixType &       jactjac,
+                   const NonZeroJacobianIndicesType & jacind,
+                   CovarianceMatrixType &             bandcov,
+                   SparseCovarianceMatrixType &       cov) const;
+
+  /** Accumulates C = 1/n \sum_i J_i^T J_i over the samples [begin, end) of the sample container. */
+  void
+  AccumulateCovariance(const std::size_t            begin,
+                       const std::size_t            end,
+                       CovarianceMatrixType &       bandcov,
+                       SparseCovarianceMatrixType & cov) const;
+
+  /** Copies the rows [begin, end) of the band matrix into the sparse matrix. */
+  void
+  CopyBandCovarianceToSparseCovariance(const unsigned int           begin,
+                                       const unsigned int           end,
+                                       const CovarianceMatrixType & bandcov,
+                                       SparseCovarianceMatrixType & cov) const;
+
+  /** Computes the maximum of the terms 3 and 4 over the samples [begin, end) of the sample container. */
+  void
+  ComputeMaximumTerms(const std::size_t begin, const std::size_t end, double & maxJJ, double & maxJCJ) const;
+
+  /** The threaded parts of Compute(), each executed by the work units of a fork-join phase of the thread pool. */
+  virtual void
+  ThreadedAccumulateCovariance(ThreadIdType workUnit, ThreadIdType numberOfWorkUnits);
+
+  virtual void
+  ThreadedMergeCovariance(ThreadIdType workUnit, ThreadIdType numberOfWorkUnits);
+
+  virtual void
+  ThreadedComputeMaximumTerms(ThreadIdType workUnit, ThreadIdType numberOfWorkUnits);
+
+  /** The per-thread covariance accumulators. */
+  struct AccumulatorPerThreadStruct
+  {
+    CovarianceMatrixType       st_BandCovariance;
+    SparseCovarianceMatrixType st_Covariance;
+  };
+
+  struct ComputePerThreadStruct
+  {
+    double st_MaxJJ;
+    double st_MaxJCJ;
+  };
+  itkPadStruct(ITK_CACHE_LINE_ALIGNMENT, ComputePerThreadStruct, PaddedComputePerThreadStruct);
+  itkAlignedTypedef(ITK_CACHE_LINE_ALIGNMENT, PaddedComputePerThreadStruct, AlignedComputePerThreadStruct);
+
+private:
+  std::vector<AccumulatorPerThreadStruct>    m_AccumulatorPerThreadVariables{};
+  std::vector<AlignedComputePerThreadStruct> m_ComputePerThreadVariables{};
+
+  /** Variables shared by the threads during Compute(). */
+  ImageSampleContainerPointer m_SampleContainer{};
+  double                      m_NumberOfSamples{ 0.0 };
+  unsigned int                m_BandCovSize{ 0 };
+  std::vector<unsigned int>   m_BandCovMap{};
+  std::vector<unsigned int>   m_BandCovMap2{};
+  SparseCovarianceMatrixType  m_Covariance{};
+  DiagCovarianceMatrixType    m_DiagCovariance{};
 };
 
 } // end namespace itk
@@ -22,8 +22,6 @@
 
 #include <vnl/vnl_math.h>
 #include <vnl/vnl_fastops.h>
-#include <vnl/vnl_diag_matrix.h>
-#include <vnl/vnl_sparse_matrix.h>
 
 namespace itk
 {
@@ -56,17 +54,16 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
   TrC = TrCC = maxJJ = maxJCJ = 0.0;
 
   /** Get samples. */
-  ImageSampleContainerPointer sampleContainer; // default-constructed (null)
-  SampleFixedImageForJacobianTerms(sampleContainer);
-  const SizeValueType nrofsamples = sampleContainer->Size();
-  const double        n = static_cast<double>(nrofsamples);
+  this->SampleFixedImageForJacobianTerms(this->m_SampleContainer);
+  const ImageSampleContainerType & sampleContainer = *(this->m_SampleContainer);
+  const SizeValueType              nrofsamples = sampleContainer.Size();
+  this->m_NumberOfSamples = static_cast<double>(nrofsamples);
 
   /** Get the number of parameters. */
   const unsigned int numberOfParameters = static_cast<unsigned int>(this->m_Transform->GetNumberOfParameters());
 
   /** Get transform and set current position. */
-  typename TransformType::Pointer transform = this->m_Transform;
-  const unsigned int              outdim = this->m_Transform->GetOutputSpaceDimension();
+  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
 
   /** Get scales vector */
   const ScalesType & scales = this->m_Scales;
@@ -81,8 +78,6 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
   {
     jacind[1] = 0;
   }
-  NonZeroJacobianIndicesType prevjacind = jacind;
-
 
   using FreqPairType = std::pair<unsigned int, unsigned int>;
   using DifHist2Type = std::vector<FreqPairType>;
@@ -120,7 +115,7 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
       onezero = 1 - onezero; // introduces semi-randomness
 
       /** Read fixed coordinates and get Jacobian J_j. */
-      const FixedImagePointType & point = sampleContainer->GetElement(samplenr).m_ImageCoordinates;
+      const FixedImagePointType & point = sampleContainer.GetElement(samplenr).m_ImageCoordinates;
       this->m_Transform->GetJacobian(point, jacj, jacind);
 
       /** Skip invalid Jacobians in the beginning, if any. */
@@ -157,11 +152,12 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
 
   /** Compute the number of bands. */
   const unsigned int bandcovsize = std::min(this->m_MaxBandCovSize, static_cast<unsigned int>(difHist2.size()));
+  this->m_BandCovSize = bandcovsize;
 
   /** Maps parameterNrDifference (q-p) to colnr in bandcov. */
-  std::vector<unsigned int> bandcovMap(numberOfParameters, bandcovsize);
+  this->m_BandCovMap.assign(numberOfParameters, bandcovsize);
   /** Maps colnr in bandcov to parameterNrDifference (q-p). */
-  std::vector<unsigned int> bandcovMap2(bandcovsize, numberOfParameters);
+  this->m_BandCovMap2.assign(bandcovsize, numberOfParameters);
 
   /** Sort the difHist2 based on the frequencies. */
   std::sort(difHist2.begin(), difHist2.end());
@@ -171,80 +167,269 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
   for (unsigned int b = 0; b < bandcovsize; ++b)
   {
     --difHist2It;
-    bandcovMap[difHist2It->second] = b;
-    bandcovMap2[b] = difHist2It->second;
+    this->m_BandCovMap[difHist2It->second] = b;
+    this->m_BandCovMap2[b] = difHist2It->second;
   }
 
-  using CovarianceValueType = double;
-  using CovarianceMatrixType = vnl_matrix<CovarianceValueType>;
-  using DiagCovarianceMatrixType = vnl_diag_matrix<CovarianceValueType>;
+  /** Initialize covariance matrix. Sparse and diagonal form. */
+  this->m_Covariance = SparseCovarianceMatrixType(numberOfParameters, numberOfParameters);
+  this->m_DiagCovariance = DiagCovarianceMatrixType(numberOfParameters, 0.0);
+  SparseCovarianceMatrixType & cov = this->m_Covariance;
+  DiagCovarianceMatrixType &   diagcov = this->m_DiagCovariance;
 
-  /** Initialize covariance matrix. Sparse, diagonal, and band form. */
-  vnl_sparse_matrix<CovarianceValueType> cov(numberOfParameters, numberOfParameters);
+  /** Determine the number of work units that accumulate the covariance matrix.
+   * Each of them stores a band matrix of its own, so their number may be limited
+   * by the maximum amount of memory allowed for these accumulators.
+   */
+  const ThreadIdType numberOfWorkUnits = this->m_NumberOfWorkUnits;
+  auto &             threadPool = elastix::WorkStealingThreadPool::GetInstance();
+  ThreadIdType       numberOfAccumulators = 1;
+  if (this->m_UseMultiThread)
+  {
+    using SparseRowType = typename SparseCovarianceMatrixType::row;
+    const SizeValueType bytesPerRow = bandcovsize * sizeof(CovarianceValueType) + sizeof(SparseRowType);
+    const SizeValueType bytesPerAccumulator = std::max<SizeValueType>(numberOfParameters * bytesPerRow, 1);
+    const SizeValueType maximumNumberOfAccumulators =
+      std::max<SizeValueType>(this->m_MaximumThreadAccumulatorMemory / bytesPerAccumulator, 1);
+
+    numberOfAccumulators = std::min<SizeValueType>(
+      { numberOfWorkUnits, nrofsamples, maximumNumberOfAccumulators });
+  }
 
-  // getCovariance(r, c) is faster than cov(r, c), at least when using the vnl_sparse_matrix implementation included
-  // with ITK 5.3.0 (released on December 20, 2022). The speed improvement is especially large on Debug builds.
-  const auto getCovariance = [&cov](const unsigned int r, const unsigned int c) -> CovarianceValueType & {
-    auto & row = cov.get_row(r);
+  /**
+   *    TERM 1
+   *
+   * Loop over image and compute Jacobian.
+   * Compute C = 1/n \sum_i J_i^T J_i
+   * Possibly apply scaling afterwards.
+   */
+  if (numberOfAccumulators > 1)
+  {
+    /** Let every work unit accumulate its part of the samples. */
+    this->m_AccumulatorPerThreadVariables.resize(numberOfAccumulators);
+    threadPool.ForkJoin(numberOfAccumulators, [this, numberOfAccumulators](const ThreadIdType workUnit) {
+      this->ThreadedAccumulateCovariance(workUnit, numberOfAccumulators);
+    });
+
+    /** Merge the accumulators into the covariance matrix, by blocks of rows. */
+    threadPool.ForkJoin(numberOfWorkUnits, [this, numberOfWorkUnits](const ThreadIdType workUnit) {
+      this->ThreadedMergeCovariance(workUnit, numberOfWorkUnits);
+    });
+    this->m_AccumulatorPerThreadVariables.clear();
+  }
+  else
+  {
+    /** Initialize band matrix. */
+    CovarianceMatrixType bandcov(numberOfParameters, bandcovsize, 0.0);
 
-    if (row.empty())
+    this->AccumulateCovariance(0, nrofsamples, bandcov, cov);
+    this->CopyBandCovarianceToSparseCovariance(0, numberOfParameters, bandcov, cov);
+  }
+
+  /** Apply scales. the use of m_Scales maybe something wrong. */
+  if (this->m_UseScales)
+  {
+    for (unsigned int p = 0; p < numberOfParameters; ++p)
     {
-      row.push_back({ c, 0.0 });
-      return row.back().second;
+      cov.scale_row(p, 1.0 / this->m_Scales[p]);
     }
-
-    if (c < row.back().first)
+    /**  \todo: this might be faster with get_row instead of the iterator */
+    cov.reset();
+    bool notfinished = cov.next();
+    while (notfinished)
     {
-      // Because the last column number in the row is greater than `c`, the following iteration will stop before the end
-      // of the row.
-      auto it = row.begin();
+      const int col = cov.getcolumn();
+      GetCovarianceElement(cov, cov.getrow(), col) /= scales[col];
+      notfinished = cov.next();
+    }
+  }
 
-      while (it->first < c)
-      {
-        ++it;
-      }
-      return (it->first == c ? it : row.insert(it, { c, 0.0 }))->second;
+  /** Compute TrC = trace(C), and diagcov. */
+  for (unsigned int p = 0; p < numberOfParameters; ++p)
+  {
+    if (!cov.empty_row(p))
+    {
+      // avoid creation of element if the row is empty
+      CovarianceValueType & covpp = GetCovarianceElement(cov, p, p);
+      TrC += covpp;
+      diagcov[p] = covpp;
     }
+  }
 
-    // At this point, the row is non-empty and c <= row.back().first.
+  /**
+   *    TERM 2
+   *
+   * Compute TrCC = ||C||_F^2.
+   */
+  cov.reset();
+  bool notfinished2 = cov.next();
+  while (notfinished2)
+  {
+    TrCC += vnl_math::sqr(cov.value());
+    notfinished2 = cov.next();
+  }
 
-    if (c > row.back().first)
+  /** Symmetry: multiply by 2 and subtract sumsqr(diagcov). */
+  TrCC *= 2.0;
+  TrCC -= diagcov.diagonal().squared_magnitude();
+
+  /**
+   *    TERM 3 and 4
+   *
+   * Compute maxJJ and maxJCJ
+   * \li maxJJ = max_j [ ||J_j||_F^2 + 2\sqrt{2} || J_j J_j^T ||_F ]
+   * \li maxJCJ = max_j [ Tr( J_j C J_j^T ) + 2\sqrt{2} || J_j C J_j^T ||_F ]
+   */
+  if (this->m_UseMultiThread && numberOfWorkUnits > 1)
+  {
+    this->m_ComputePerThreadVariables.assign(numberOfWorkUnits, AlignedComputePerThreadStruct());
+    threadPool.ForkJoin(numberOfWorkUnits, [this, numberOfWorkUnits](const ThreadIdType workUnit) {
+      this->ThreadedComputeMaximumTerms(workUnit, numberOfWorkUnits);
+    });
+
+    for (const auto & computePerThreadStruct : this->m_ComputePerThreadVariables)
     {
-      row.push_back({ c, 0.0 });
+      maxJJ = std::max(maxJJ, computePerThreadStruct.st_MaxJJ);
+      maxJCJ = std::max(maxJCJ, computePerThreadStruct.st_MaxJCJ);
     }
+  }
+  else
+  {
+    this->ComputeMaximumTerms(0, nrofsamples, maxJJ, maxJCJ);
+  }
+
+  /** Release the memory of the covariance matrix and the samples. */
+  this->m_Covariance = SparseCovarianceMatrixType();
+  this->m_DiagCovariance = DiagCovarianceMatrixType();
+  this->m_SampleContainer = nullptr;
+
+} // end Compute()
+
+
+/**
+ * ************************* GetCovarianceElement ************************
+ */
+
+template <class TFixedImage, class TTransform>
+auto
+ComputeJacobianTerms<TFixedImage, TTransform>::GetCovarianceElement(SparseCovarianceMatrixType & cov,
+                                                                    const unsigned int           r,
+                                                                    const unsigned int           c)
+  -> CovarianceValueType &
+{
+  // GetCovarianceElement(cov, r, c) is faster than cov(r, c), at least when using the vnl_sparse_matrix implementation
+  // included with ITK 5.3.0 (released on December 20, 2022). The speed improvement is especially large on Debug builds.
+  auto & row = cov.get_row(r);
+
+  if (row.empty())
+  {
+    row.push_back({ c, 0.0 });
     return row.back().second;
-  };
+  }
 
-  DiagCovarianceMatrixType diagcov(numberOfParameters, 0.0);
+  if (c < row.back().first)
+  {
+    // Because the last column number in the row is greater than `c`, the following iteration will stop before the end
+    // of the row.
+    auto it = row.begin();
 
-  /** For temporary storage of J'J. */
-  CovarianceMatrixType jactjac(sizejacind, sizejacind, 0.0);
+    while (it->first < c)
+    {
+      ++it;
+    }
+    return (it->first == c ? it : row.insert(it, { c, 0.0 }))->second;
+  }
 
-  /** Initialize band matrix. */
-  CovarianceMatrixType bandcov(numberOfParameters, bandcovsize, 0.0);
+  // At this point, the row is non-empty and c <= row.back().first.
 
-  unsigned int samplenr = 0;
+  if (c > row.back().first)
+  {
+    row.push_back({ c, 0.0 });
+  }
+  return row.back().second;
 
-  /**
-   *    TERM 1
-   *
-   * Loop over image and compute Jacobian.
-   * Compute C = 1/n \sum_i J_i^T J_i
-   * Possibly apply scaling afterwards.
-   */
+} // end GetCovarianceElement()
+
+
+/**
+ * ************************* UpdateCovariance ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputeJacobianTerms<TFixedImage, TTransform>::UpdateCovariance(const CovarianceMatrixType &       jactjac,
+                                                                const NonZeroJacobianIndicesType & jacind,
+                                                                CovarianceMatrixType &             bandcov,
+                                                                SparseCovarianceMatrixType &       cov) const
+{
+  const auto         sizejacind = static_cast<unsigned int>(jacind.size());
+  const double       n = this->m_NumberOfSamples;
+  const unsigned int bandcovsize = this->m_BandCovSize;
+
+  for (unsigned int pi = 0; pi < sizejacind; ++pi)
+  {
+    const unsigned int p = jacind[pi];
+    for (unsigned int qi = 0; qi < sizejacind; ++qi)
+    {
+      const unsigned int q = jacind[qi];
+      if (q >= p)
+      {
+        const double tempval = jactjac(pi, qi) / n;
+        if (std::abs(tempval) > 1e-14)
+        {
+          const unsigned int bandindex = this->m_BandCovMap[q - p];
+          if (bandindex < bandcovsize)
+          {
+            bandcov(p, bandindex) += tempval;
+          }
+          else
+          {
+            GetCovarianceElement(cov, p, q) += tempval;
+          }
+        }
+      }
+    } // qi
+  }   // pi
+
+} // end UpdateCovariance()
+
+
+/**
+ * ************************* AccumulateCovariance ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputeJacobianTerms<TFixedImage, TTransform>::AccumulateCovariance(const std::size_t            begin,
+                                                                    const std::size_t            end,
+                                                                    CovarianceMatrixType &       bandcov,
+                                                                    SparseCovarianceMatrixType & cov) const
+{
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  const NumberOfParametersType sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+  const unsigned int           outdim = this->m_Transform->GetOutputSpaceDimension();
+  JacobianType                 jacj(outdim, sizejacind);
+  jacj.Fill(0.0);
+  NonZeroJacobianIndicesType jacind(sizejacind);
   jacind[0] = 0;
   if (sizejacind > 1)
   {
     jacind[1] = 0;
   }
-  for (const auto & sample : *sampleContainer)
-  {
-    /** Print progress 0-50%.
-     *progressObserver->UpdateAndPrintProgress( samplenr );*/
-    ++samplenr;
+  NonZeroJacobianIndicesType prevjacind = jacind;
 
+  /** For temporary storage of J'J. */
+  CovarianceMatrixType jactjac(sizejacind, sizejacind, 0.0);
+
+  /** Create iterator over the samples [begin, end) of the sample container. */
+  const auto beginOfSampleContainer = this->m_SampleContainer->cbegin();
+  const auto fbegin = beginOfSampleContainer + begin;
+  const auto fend = beginOfSampleContainer + end;
+
+  for (auto fiter = fbegin; fiter != fend; ++fiter)
+  {
     /** Read fixed coordinates and get Jacobian J_j. */
-    const FixedImagePointType & point = sample.m_ImageCoordinates;
+    const FixedImagePointType & point = fiter->m_ImageCoordinates;
     this->m_Transform->GetJacobian(point, jacj, jacind);
 
     /** Skip invalid Jacobians in the beginning, if any. */
@@ -264,34 +449,11 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
     else
     {
       /** The following should only be done after the first sample. */
-      if (&sample != &(sampleContainer->front()))
+      if (fiter != fbegin)
       {
         /** Update covariance matrix. */
-        for (unsigned int pi = 0; pi < sizejacind; ++pi)
-        {
-          const unsigned int p = prevjacind[pi];
-          for (unsigned int qi = 0; qi < sizejacind; ++qi)
-          {
-            const unsigned int q = prevjacind[qi];
-            if (q >= p)
-            {
-              const double tempval = jactjac(pi, qi) / n;
-              if (std::abs(tempval) > 1e-14)
-              {
-                const unsigned int bandindex = bandcovMap[q - p];
-                if (bandindex < bandcovsize)
-                {
-                  bandcov(p, bandindex) += tempval;
-                }
-                else
-                {
-                  getCovariance(p, q) += tempval;
-                }
-              }
-            }
-          } // qi
-        }   // pi
-      }     // end if
+        this->UpdateCovariance(jactjac, prevjacind, bandcov, cov);
+      }
 
       /** Initialize jactjac by J_j^T J_j. */
       vnl_fastops::AtA(jactjac, jacj);
@@ -302,105 +464,68 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
 
   } // end iter loop: end computation of covariance matrix
 
-  /** Update covariance matrix once again to include last jactjac updates
-   * \todo: a bit ugly that this loop is copied from above.
-   */
-  for (unsigned int pi = 0; pi < sizejacind; ++pi)
-  {
-    const unsigned int p = prevjacind[pi];
-    for (unsigned int qi = 0; qi < sizejacind; ++qi)
-    {
-      const unsigned int q = prevjacind[qi];
-      if (q >= p)
-      {
-        const double tempval = jactjac(pi, qi) / n;
-        if (std::abs(tempval) > 1e-14)
-        {
-          const unsigned int bandindex = bandcovMap[q - p];
-          if (bandindex < bandcovsize)
-          {
-            bandcov(p, bandindex) += tempval;
-          }
-          else
-          {
-            getCovariance(p, q) += tempval;
-          }
-        }
-      }
-    } // qi
-  }   // pi
+  /** Update covariance matrix once again to include last jactjac updates. */
+  this->UpdateCovariance(jactjac, prevjacind, bandcov, cov);
+
+} // end AccumulateCovariance()
+
+
+/**
+ * ************************* CopyBandCovarianceToSparseCovariance ************************
+ */
 
-  /** Copy the bandmatrix into the sparse matrix and empty the bandcov matrix.
+template <class TFixedImage, class TTransform>
+void
+ComputeJacobianTerms<TFixedImage, TTransform>::CopyBandCovarianceToSparseCovariance(
+  const unsigned int           begin,
+  const unsigned int           end,
+  const CovarianceMatrixType & bandcov,
+  SparseCovarianceMatrixType & cov) const
+{
+  /** Copy the bandmatrix into the sparse matrix.
    * \todo: perhaps work further with this bandmatrix instead.
    */
-  for (unsigned int p = 0; p < numberOfParameters; ++p)
+  for (unsigned int p = begin; p < end; ++p)
   {
-    for (unsigned int b = 0; b < bandcovsize; ++b)
+    for (unsigned int b = 0; b < this->m_BandCovSize; ++b)
     {
       const double tempval = bandcov(p, b);
       if (std::abs(tempval) > 1e-14)
       {
-        const unsigned int q = p + bandcovMap2[b];
-        getCovariance(p, q) = tempval;
+        const unsigned int q = p + this->m_BandCovMap2[b];
+        GetCovarianceElement(cov, p, q) = tempval;
       }
     }
   }
-  bandcov.set_size(0, 0);
 
-  /** Apply scales. the use of m_Scales maybe something wrong. */
-  if (this->m_UseScales)
-  {
-    for (unsigned int p = 0; p < numberOfParameters; ++p)
-    {
-      cov.scale_row(p, 1.0 / this->m_Scales[p]);
-    }
-    /**  \todo: this might be faster with get_row instead of the iterator */
-    cov.reset();
-    bool notfinished = cov.next();
-    while (notfinished)
-    {
-      const int col = cov.getcolumn();
-      getCovariance(cov.getrow(), col) /= scales[col];
-      notfinished = cov.next();
-    }
-  }
+} // end CopyBandCovarianceToSparseCovariance()
 
-  /** Compute TrC = trace(C), and diagcov. */
-  for (unsigned int p = 0; p < numberOfParameters; ++p)
-  {
-    if (!cov.empty_row(p))
-    {
-      // avoid creation of element if the row is empty
-      CovarianceValueType & covpp = getCovariance(p, p);
-      TrC += covpp;
-      diagcov[p] = covpp;
-    }
-  }
 
-  /**
-   *    TERM 2
-   *
-   * Compute TrCC = ||C||_F^2.
-   */
-  cov.reset();
-  bool notfinished2 = cov.next();
-  while (notfinished2)
-  {
-    TrCC += vnl_math::sqr(cov.value());
-    notfinished2 = cov.next();
-  }
+/**
+ * ************************* ComputeMaximumTerms ************************
+ */
 
-  /** Symmetry: multiply by 2 and subtract sumsqr(diagcov). */
-  TrCC *= 2.0;
-  TrCC -= diagcov.diagonal().squared_magnitude();
+template <class TFixedImage, class TTransform>
+void
+ComputeJacobianTerms<TFixedImage, TTransform>::ComputeMaximumTerms(const std::size_t begin,
+                                                                   const std::size_t end,
+                                                                   double &          maxJJ,
+                                                                   double &          maxJCJ)
+{
+  const unsigned int numberOfParameters = static_cast<unsigned int>(this->m_Transform->GetNumberOfParameters());
+  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
+  const ScalesType & scales = this->m_Scales;
+
+  /** The covariance matrix, computed before. */
+  SparseCovarianceMatrixType &     cov = this->m_Covariance;
+  const DiagCovarianceMatrixType & diagcov = this->m_DiagCovariance;
+
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  const NumberOfParametersType sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType                 jacj(outdim, sizejacind);
+  jacj.Fill(0.0);
+  NonZeroJacobianIndicesType jacind(sizejacind);
 
-  /**
-   *    TERM 3 and 4
-   *
-   * Compute maxJJ and maxJCJ
-   * \li maxJJ = max_j [ ||J_j||_F^2 + 2\sqrt{2} || J_j J_j^T ||_F ]
-   * \li maxJCJ = max_j [ Tr( J_j C J_j^T ) + 2\sqrt{2} || J_j C J_j^T ||_F ]
-   */
   maxJJ = 0.0;
   maxJCJ = 0.0;
   const double sqrt2 = std::sqrt(static_cast<double>(2.0));
@@ -413,11 +538,15 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
   JacobianType              jacjcovjacj(outdim, outdim);
   itk::Array<SizeValueType> jacindExpanded(numberOfParameters);
 
-  samplenr = 0;
-  for (const auto & sample : *sampleContainer)
+  /** Create iterator over the samples [begin, end) of the sample container. */
+  const auto beginOfSampleContainer = this->m_SampleContainer->cbegin();
+  const auto fbegin = beginOfSampleContainer + begin;
+  const auto fend = beginOfSampleContainer + end;
+
+  for (auto fiter = fbegin; fiter != fend; ++fiter)
   {
     /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = sample.m_ImageCoordinates;
+    const FixedImagePointType & point = fiter->m_ImageCoordinates;
     this->m_Transform->GetJacobian(point, jacj, jacind);
 
     /** Apply scales, if necessary. */
@@ -505,16 +634,118 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
     /** Max_j [JCJ_j]. */
     maxJCJ = std::max(maxJCJ, JCJ_j);
 
-    /** Show progress 50-100%. */
-    // progressObserver->UpdateAndPrintProgress( samplenr + nrofsamples );
-    ++samplenr;
-
   } // end loop over sample container
 
-  /** Finalize progress information. */
-  // progressObserver->PrintProgress( 1.0 );
+} // end ComputeMaximumTerms()
 
-} // end Compute()
+
+/**
+ * ************************* ThreadedAccumulateCovariance ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputeJacobianTerms<TFixedImage, TTransform>::ThreadedAccumulateCovariance(const ThreadIdType workUnit,
+                                                                            const ThreadIdType numberOfWorkUnits)
+{
+  /** Get sample container size and number of parameters. */
+  const SizeValueType sampleContainerSize = this->m_SampleContainer->Size();
+  const unsigned int  numberOfParameters = static_cast<unsigned int>(this->m_Transform->GetNumberOfParameters());
+
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
+    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(numberOfWorkUnits)));
+
+  const auto pos_begin = std::min<size_t>(nrOfSamplesPerThreads * workUnit, sampleContainerSize);
+  const auto pos_end = std::min<size_t>(nrOfSamplesPerThreads * (workUnit + 1), sampleContainerSize);
+
+  /** Allocate the accumulators of this thread, and fill them. */
+  AccumulatorPerThreadStruct & accumulator = this->m_AccumulatorPerThreadVariables[workUnit];
+  accumulator.st_BandCovariance.set_size(numberOfParameters, this->m_BandCovSize);
+  accumulator.st_BandCovariance.fill(0.0);
+  accumulator.st_Covariance = SparseCovarianceMatrixType(numberOfParameters, numberOfParameters);
+
+  this->AccumulateCovariance(pos_begin, pos_end, accumulator.st_BandCovariance, accumulator.st_Covariance);
+
+} // end ThreadedAccumulateCovariance()
+
+
+/**
+ * ************************* ThreadedMergeCovariance ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputeJacobianTerms<TFixedImage, TTransform>::ThreadedMergeCovariance(const ThreadIdType workUnit,
+                                                                       const ThreadIdType numberOfWorkUnits)
+{
+  /** Get the block of rows of this thread. */
+  const unsigned int numberOfParameters = this->m_Covariance.rows();
+  const unsigned int nrOfRowsPerThreads = static_cast<unsigned int>(
+    std::ceil(static_cast<double>(numberOfParameters) / static_cast<double>(numberOfWorkUnits)));
+
+  const unsigned int row_begin = std::min(nrOfRowsPerThreads * workUnit, numberOfParameters);
+  const unsigned int row_end = std::min(nrOfRowsPerThreads * (workUnit + 1), numberOfParameters);
+
+  /** The band matrices are summed into the one of the first accumulator. */
+  CovarianceMatrixType & bandcov = this->m_AccumulatorPerThreadVariables.front().st_BandCovariance;
+
+  for (unsigned int p = row_begin; p < row_end; ++p)
+  {
+    for (auto & accumulator : this->m_AccumulatorPerThreadVariables)
+    {
+      /** Sum the elements outside of the bands. */
+      for (const auto & covRowEntry : accumulator.st_Covariance.get_row(p))
+      {
+        GetCovarianceElement(this->m_Covariance, p, covRowEntry.first) += covRowEntry.second;
+      }
+
+      /** Sum the band elements. */
+      if (&accumulator.st_BandCovariance != &bandcov)
+      {
+        for (unsigned int b = 0; b < this->m_BandCovSize; ++b)
+        {
+          bandcov(p, b) += accumulator.st_BandCovariance(p, b);
+        }
+      }
+    }
+  }
+
+  this->CopyBandCovarianceToSparseCovariance(row_begin, row_end, bandcov, this->m_Covariance);
+
+} // end ThreadedMergeCovariance()
+
+
+/**
+ * ************************* ThreadedComputeMaximumTerms ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputeJacobianTerms<TFixedImage, TTransform>::ThreadedComputeMaximumTerms(const ThreadIdType workUnit,
+                                                                           const ThreadIdType numberOfWorkUnits)
+{
+  /** Get sample container size. */
+  const SizeValueType sampleContainerSize = this->m_SampleContainer->Size();
+
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
+    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(numberOfWorkUnits)));
+
+  const auto pos_begin = std::min<size_t>(nrOfSamplesPerThreads * workUnit, sampleContainerSize);
+  const auto pos_end = std::min<size_t>(nrOfSamplesPerThreads * (workUnit + 1), sampleContainerSize);
+
+  /** Compute the maxima over the samples of this thread. */
+  double maxJJ = 0.0;
+  double maxJCJ = 0.0;
+  this->ComputeMaximumTerms(pos_begin, pos_end, maxJJ, maxJCJ);
+
+  AlignedComputePerThreadStruct computePerThreadStruct;
+  computePerThreadStruct.st_MaxJJ = maxJJ;
+  computePerThreadStruct.st_MaxJCJ = maxJCJ;
+  this->m_ComputePerThreadVariables[workUnit] = computePerThreadStruct;
+
+} // end ThreadedComputeMaximumTerms()
 
 
 /**
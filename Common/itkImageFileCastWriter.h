@@ -105,6 +105,9 @@ private:
     localInputImage->Graft(static_cast<const ScalarInputImageType *>(inputImage));
 
     caster->SetInput(localInputImage);
+
+    /** Only cast the buffered region, which is the current piece when the writer is streaming. */
+    caster->GetOutput()->SetRequestedRegion(localInputImage->GetBufferedRegion());
     caster->Update();
 
     /** return the pixel buffer of the casted image */
@@ -117,19 +120,23 @@ private:
   std::string m_OutputComponentType{ Self::GetDefaultOutputComponentType() };
 };
 
-/** Convenience function for writing a casted image. */
+/** Convenience function for writing a casted image. When the image is the output of a pipeline, and the image
+ * file format supports streamed writing, a number of stream divisions larger than one lets the writer request,
+ * cast and write the image piece by piece. */
 template <typename TImage>
 void
 WriteCastedImage(const TImage &      image,
                  const std::string & filename,
                  const std::string & outputComponentType,
-                 bool                compress)
+                 bool                compress,
+                 unsigned int        numberOfStreamDivisions = 1)
 {
   elx::DefaultConstruct<ImageFileCastWriter<TImage>> writer;
   writer.SetInput(&image);
   writer.SetFileName(filename);
   writer.SetOutputComponentType(outputComponentType);
   writer.SetUseCompression(compress);
+  writer.SetNumberOfStreamDivisions(numberOfStreamDivisions);
   writer.Update();
 }
 
@@ -42,6 +42,7 @@
 #include <vnl/vnl_matrix.h>
 
 #include "itkImageToImageFilter.h"
+#include "elxWorkStealingThreadPool.h"
 
 namespace itk
 {
@@ -70,11 +71,16 @@ namespace itk
  *               Uses mirror boundary conditions.
  *               Can only process LargestPossibleRegion
  *
+ * The lines along a dimension are independent of each other. They are processed in bundles of
+ * NumberOfInterleavedLines lines, which are stored interleaved in a scratch buffer, so that the recursive
+ * filtering of all lines of a bundle is done by the same (vectorizable) inner loop. The bundles are distributed
+ * over the threads of the elastix::WorkStealingThreadPool.
+ *
  * \sa itkBSplineInterpolateImageFunction
  *
  *  ***TODO: Is this an ImageFilter?  or does it belong to another group?
  * \ingroup ImageFilters
- * \ingroup SingleThreaded
+ * \ingroup MultiThreaded
  * \ingroup CannotBeStreamed
  */
 template <class TInputImage, class TOutputImage>
@@ -111,6 +117,9 @@ public:
   /** Iterator typedef support */
   using OutputLinearIterator = ImageLinearIteratorWithIndex<TOutputImage>;
 
+  /** The number of lines that are filtered at once, by one thread. */
+  static constexpr unsigned int NumberOfInterleavedLines = 8;
+
   /** Get/Sets the Spline Order, supports 0th - 5th order splines. The default
    *  is a 3rd order spline. */
   void
@@ -153,49 +162,46 @@ protected:
   EnlargeOutputRequestedRegion(DataObject * output) override;
 
   /** These are needed by the smoothing spline routine. */
-  std::vector<CoeffType>         m_Scratch{};    // temp storage for processing of Coefficients
   typename TInputImage::SizeType m_DataLength{}; // Image size
 
   unsigned int
-               m_SplineOrder[ImageDimension]{}; // User specified spline order per dimension (3rd or cubic is the default)
-  double       m_SplinePoles[3]{};              // Poles calculated for a given spline order
-  int          m_NumberOfPoles{};               // number of poles
-  double       m_Tolerance{};                   // Tolerance used for determining initial causal coefficient
-  unsigned int m_IteratorDirection{};           // Direction for iterator incrementing
+         m_SplineOrder[ImageDimension]{}; // User specified spline order per dimension (3rd or cubic is the default)
+  double m_SplinePoles[3]{};              // Poles calculated for a given spline order
+  int    m_NumberOfPoles{};               // number of poles
+  double m_Tolerance{};                   // Tolerance used for determining initial causal coefficient
 
 private:
   /** Determines the poles for dimension given the Spline Order. */
   virtual void
   SetPoles(unsigned int dimension);
 
-  /** Converts a vector of data to a vector of Spline coefficients. */
-  virtual bool
-  DataToCoefficients1D();
+  /** Converts the interleaved lines of data in the scratch buffer to Spline coefficients, using the current poles.
+   * Element n of line l is stored at scratch[n * numberOfLines + l]. */
+  void
+  DataToCoefficientsInterleaved(CoeffType * scratch, unsigned int numberOfLines, SizeValueType lineLength) const;
 
   /** Converts an N-dimension image of data to an equivalent sized image
    *    of spline coefficients. */
   void
   DataToCoefficientsND();
 
-  /** Determines the first coefficient for the causal filtering of the data. */
-  virtual void
-  SetInitialCausalCoefficient(double z);
-
-  /** Determines the first coefficient for the anti-causal filtering of the data. */
-  virtual void
-  SetInitialAntiCausalCoefficient(double z);
-
-  /** Used to initialize the Coefficients image before calculation. */
+  /** Determines the first coefficient of each of the interleaved lines, for the causal filtering of the data. */
   void
-  CopyImageToImage();
+  SetInitialCausalCoefficients(CoeffType *   scratch,
+                               unsigned int  numberOfLines,
+                               SizeValueType lineLength,
+                               double        z) const;
 
-  /** Copies a vector of data from the Coefficients image to the m_Scratch vector. */
+  /** Determines the last coefficient of each of the interleaved lines, for the anti-causal filtering of the data. */
   void
-  CopyCoefficientsToScratch(OutputLinearIterator &);
+  SetInitialAntiCausalCoefficients(CoeffType *   scratch,
+                                   unsigned int  numberOfLines,
+                                   SizeValueType lineLength,
+                                   double        z) const;
 
-  /** Copies a vector of data from m_Scratch to the Coefficients image. */
+  /** Used to initialize the Coefficients image before calculation. */
   void
-  CopyScratchToCoefficients(OutputLinearIterator &);
+  CopyImageToImage();
 };
 
 } // namespace itk
@@ -42,6 +42,8 @@
 #include "itkProgressReporter.h"
 #include "itkVector.h"
 
+#include <algorithm> // For min.
+
 namespace itk
 {
 
@@ -53,7 +55,6 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::MultiOrder
 {
   int splineOrder = 3;
   m_Tolerance = 1e-10; // Need some guidance on this one...what is reasonable?
-  m_IteratorDirection = 0;
   this->SetSplineOrder(splineOrder);
 }
 
@@ -80,8 +81,11 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::PrintSelf(
 
 
 template <class TInputImage, class TOutputImage>
-bool
-MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::DataToCoefficients1D()
+void
+MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::DataToCoefficientsInterleaved(
+  CoeffType * const   scratch,
+  const unsigned int  numberOfLines,
+  const SizeValueType lineLength) const
 {
 
   // See Unser, 1993, Part II, Equation 2.5,
@@ -89,11 +93,6 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::DataToCoef
 
   double c0 = 1.0;
 
-  if (m_DataLength[m_IteratorDirection] == 1) // Required by mirror boundaries
-  {
-    return false;
-  }
-
   // Compute overall gain
   for (int k = 0; k < m_NumberOfPoles; ++k)
   {
@@ -102,31 +101,43 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::DataToCoef
   }
 
   // apply the gain
-  for (unsigned int n = 0; n < m_DataLength[m_IteratorDirection]; ++n)
+  const SizeValueType numberOfValues = lineLength * numberOfLines;
+  for (SizeValueType i = 0; i < numberOfValues; ++i)
   {
-    m_Scratch[n] *= c0;
+    scratch[i] *= c0;
   }
 
   // loop over all poles
   for (int k = 0; k < m_NumberOfPoles; ++k)
   {
+    const double z = m_SplinePoles[k];
+
     // causal initialization
-    this->SetInitialCausalCoefficient(m_SplinePoles[k]);
-    // causal recursion
-    for (unsigned int n = 1; n < m_DataLength[m_IteratorDirection]; ++n)
+    this->SetInitialCausalCoefficients(scratch, numberOfLines, lineLength, z);
+    // causal recursion, for all lines at once
+    for (SizeValueType n = 1; n < lineLength; ++n)
     {
-      m_Scratch[n] += m_SplinePoles[k] * m_Scratch[n - 1];
+      CoeffType * const       current = scratch + n * numberOfLines;
+      const CoeffType * const previous = current - numberOfLines;
+      for (unsigned int l = 0; l < numberOfLines; ++l)
+      {
+        current[l] += z * previous[l];
+      }
     }
 
     // anticausal initialization
-    this->SetInitialAntiCausalCoefficient(m_SplinePoles[k]);
-    // anticausal recursion
-    for (int n = m_DataLength[m_IteratorDirection] - 2; 0 <= n; n--)
+    this->SetInitialAntiCausalCoefficients(scratch, numberOfLines, lineLength, z);
+    // anticausal recursion, for all lines at once
+    for (SizeValueType n = lineLength - 1; n-- > 0;)
     {
-      m_Scratch[n] = m_SplinePoles[k] * (m_Scratch[n + 1] - m_Scratch[n]);
+      CoeffType * const       current = scratch + n * numberOfLines;
+      const CoeffType * const next = current + numberOfLines;
+      for (unsigned int l = 0; l < numberOfLines; ++l)
+      {
+        current[l] = z * (next[l] - current[l]);
+      }
     }
   }
-  return true;
 }
 
 
@@ -213,60 +224,87 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::SetPoles(u
 
 template <class TInputImage, class TOutputImage>
 void
-MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::SetInitialCausalCoefficient(double z)
+MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::SetInitialCausalCoefficients(
+  CoeffType * const   scratch,
+  const unsigned int  numberOfLines,
+  const SizeValueType lineLength,
+  const double        z) const
 {
   /* begining InitialCausalCoefficient */
   /* See Unser, 1999, Box 2 for explaination */
-  CoeffType     sum;
-  double        zn, z2n, iz;
-  unsigned long horizon;
+  /* The sums are accumulated in the first element of each line, which is not read otherwise. */
 
   /* this initialization corresponds to mirror boundaries */
-  horizon = m_DataLength[m_IteratorDirection];
-  zn = z;
+  SizeValueType horizon = lineLength;
+  double        zn = z;
   if (m_Tolerance > 0.0)
   {
-    horizon = (long)std::ceil(std::log(m_Tolerance) / std::log(std::fabs(z)));
+    horizon = static_cast<SizeValueType>(std::ceil(std::log(m_Tolerance) / std::log(std::fabs(z))));
   }
-  if (horizon < m_DataLength[m_IteratorDirection])
+  if (horizon < lineLength)
   {
     /* accelerated loop */
-    sum = m_Scratch[0]; // verify this
-    for (unsigned int n = 1; n < horizon; ++n)
+    for (SizeValueType n = 1; n < horizon; ++n)
     {
-      sum += zn * m_Scratch[n];
+      const CoeffType * const values = scratch + n * numberOfLines;
+      for (unsigned int l = 0; l < numberOfLines; ++l)
+      {
+        scratch[l] += zn * values[l];
+      }
       zn *= z;
     }
-    m_Scratch[0] = sum;
   }
   else
   {
     /* full loop */
-    iz = 1.0 / z;
-    z2n = std::pow(z, (double)(m_DataLength[m_IteratorDirection] - 1L));
-    sum = m_Scratch[0] + z2n * m_Scratch[m_DataLength[m_IteratorDirection] - 1L];
+    const double iz = 1.0 / z;
+    double       z2n = std::pow(z, static_cast<double>(lineLength - 1));
+    {
+      const CoeffType * const lastValues = scratch + (lineLength - 1) * numberOfLines;
+      for (unsigned int l = 0; l < numberOfLines; ++l)
+      {
+        scratch[l] += z2n * lastValues[l];
+      }
+    }
     z2n *= z2n * iz;
-    for (unsigned int n = 1; n <= (m_DataLength[m_IteratorDirection] - 2); ++n)
+    for (SizeValueType n = 1; n + 1 < lineLength; ++n)
     {
-      sum += (zn + z2n) * m_Scratch[n];
+      const CoeffType * const values = scratch + n * numberOfLines;
+      const double            weight = zn + z2n;
+      for (unsigned int l = 0; l < numberOfLines; ++l)
+      {
+        scratch[l] += weight * values[l];
+      }
       zn *= z;
       z2n *= iz;
     }
-    m_Scratch[0] = sum / (1.0 - zn * zn);
+    const double normalization = 1.0 / (1.0 - zn * zn);
+    for (unsigned int l = 0; l < numberOfLines; ++l)
+    {
+      scratch[l] *= normalization;
+    }
   }
 }
 
 
 template <class TInputImage, class TOutputImage>
 void
-MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::SetInitialAntiCausalCoefficient(double z)
+MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::SetInitialAntiCausalCoefficients(
+  CoeffType * const   scratch,
+  const unsigned int  numberOfLines,
+  const SizeValueType lineLength,
+  const double        z) const
 {
   // this initialization corresponds to mirror boundaries
   /* See Unser, 1999, Box 2 for explaination */
   //  Also see erratum at http://bigwww.epfl.ch/publications/unser9902.html
-  m_Scratch[m_DataLength[m_IteratorDirection] - 1] =
-    (z / (z * z - 1.0)) *
-    (z * m_Scratch[m_DataLength[m_IteratorDirection] - 2] + m_Scratch[m_DataLength[m_IteratorDirection] - 1]);
+  CoeffType * const       last = scratch + (lineLength - 1) * numberOfLines;
+  const CoeffType * const beforeLast = last - numberOfLines;
+  const double            factor = z / (z * z - 1.0);
+  for (unsigned int l = 0; l < numberOfLines; ++l)
+  {
+    last[l] = factor * (z * beforeLast[l] + last[l]);
+  }
 }
 
 
@@ -274,44 +312,94 @@ template <class TInputImage, class TOutputImage>
 void
 MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::DataToCoefficientsND()
 {
-  OutputImagePointer output = this->GetOutput();
+  using OutputPixelType = typename TOutputImage::PixelType;
 
-  Size<ImageDimension> size = output->GetBufferedRegion().GetSize();
+  OutputImagePointer output = this->GetOutput();
 
-  unsigned int count = output->GetBufferedRegion().GetNumberOfPixels() / size[0] * ImageDimension;
+  const Size<ImageDimension> size = output->GetBufferedRegion().GetSize();
+  const SizeValueType        numberOfPixels = output->GetBufferedRegion().GetNumberOfPixels();
+  OutputPixelType * const    buffer = output->GetBufferPointer();
 
-  ProgressReporter progress(this, 0, count, 10);
+  ProgressReporter progress(this, 0, ImageDimension);
 
   // Initialize coeffient array
   this->CopyImageToImage(); // Coefficients are initialized to the input data
 
+  auto & threadPool = elastix::WorkStealingThreadPool::GetInstance();
+
+  // The distance in the buffer between successive pixels of a line along the current dimension
+  SizeValueType pixelStride = 1;
+
   for (unsigned int n = 0; n < ImageDimension; ++n)
   {
-    m_IteratorDirection = n;
     // Loop through each dimension
 
     // Compute poles for this dimension
     this->SetPoles(n);
 
-    // Initialize iterators
-    OutputLinearIterator CIterator(output, output->GetBufferedRegion());
-    CIterator.SetDirection(m_IteratorDirection);
-    // For each data vector
-    while (!CIterator.IsAtEnd())
+    const SizeValueType lineLength = size[n];
+
+    // Lines of length 1 are left unchanged, as required by mirror boundaries
+    if (m_NumberOfPoles > 0 && lineLength > 1 && numberOfPixels > 0)
     {
-      // Copy coefficients to scratch
-      this->CopyCoefficientsToScratch(CIterator);
-
-      // Perform 1D BSpline calculations
-      this->DataToCoefficients1D();
-
-      // Copy scratch back to coefficients.
-      // Brings us back to the end of the line we were working on.
-      CIterator.GoToBeginOfLine();
-      this->CopyScratchToCoefficients(CIterator); // m_Scratch = m_Image;
-      CIterator.NextLine();
-      progress.CompletedPixel();
+      const SizeValueType numberOfLines = numberOfPixels / lineLength;
+      const SizeValueType numberOfBundles = (numberOfLines + NumberOfInterleavedLines - 1) / NumberOfInterleavedLines;
+      const auto          numberOfWorkUnits =
+        static_cast<unsigned int>(std::min<SizeValueType>(threadPool.GetNumberOfThreads(), numberOfBundles));
+
+      elastix::ChunkedRange bundles;
+
+      threadPool.ForkJoin(numberOfWorkUnits, [&](unsigned int) {
+        std::vector<CoeffType> scratch(NumberOfInterleavedLines * lineLength);
+        SizeValueType          lineOffsets[NumberOfInterleavedLines];
+
+        std::size_t bundleBegin{};
+        std::size_t bundleEnd{};
+        while (bundles.GetNextChunk(numberOfBundles, numberOfWorkUnits, bundleBegin, bundleEnd))
+        {
+          for (std::size_t bundle = bundleBegin; bundle < bundleEnd; ++bundle)
+          {
+            const SizeValueType firstLine = bundle * NumberOfInterleavedLines;
+            const auto          numberOfLinesOfBundle = static_cast<unsigned int>(
+              std::min<SizeValueType>(NumberOfInterleavedLines, numberOfLines - firstLine));
+
+            // Line j starts at the pixel whose index along this dimension is zero. The lower part of j is its offset
+            // within a slab of pixelStride * lineLength pixels, the upper part is the index of the slab.
+            for (unsigned int l = 0; l < numberOfLinesOfBundle; ++l)
+            {
+              const SizeValueType line = firstLine + l;
+              lineOffsets[l] = (line % pixelStride) + (line / pixelStride) * pixelStride * lineLength;
+            }
+
+            // Copy the coefficients of the lines to the scratch, interleaved
+            for (SizeValueType i = 0; i < lineLength; ++i)
+            {
+              CoeffType * const values = scratch.data() + i * numberOfLinesOfBundle;
+              for (unsigned int l = 0; l < numberOfLinesOfBundle; ++l)
+              {
+                values[l] = static_cast<CoeffType>(buffer[lineOffsets[l] + i * pixelStride]);
+              }
+            }
+
+            // Perform 1D BSpline calculations on all lines of the bundle
+            this->DataToCoefficientsInterleaved(scratch.data(), numberOfLinesOfBundle, lineLength);
+
+            // Copy scratch back to coefficients
+            for (SizeValueType i = 0; i < lineLength; ++i)
+            {
+              const CoeffType * const values = scratch.data() + i * numberOfLinesOfBundle;
+              for (unsigned int l = 0; l < numberOfLinesOfBundle; ++l)
+              {
+                buffer[lineOffsets[l] + i * pixelStride] = static_cast<OutputPixelType>(values[l]);
+              }
+            }
+          }
+        }
+      });
     }
+
+    pixelStride *= lineLength;
+    progress.CompletedPixel();
   }
 }
 
@@ -341,43 +429,6 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::CopyImageT
 }
 
 
-/**
- * Copy the scratch to one line of the output image
- */
-template <class TInputImage, class TOutputImage>
-void
-MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::CopyScratchToCoefficients(
-  OutputLinearIterator & Iter)
-{
-  using OutputPixelType = typename TOutputImage::PixelType;
-  unsigned long j = 0;
-  while (!Iter.IsAtEndOfLine())
-  {
-    Iter.Set(static_cast<OutputPixelType>(m_Scratch[j]));
-    ++Iter;
-    ++j;
-  }
-}
-
-
-/**
- * Copy one line of the output image to the scratch
- */
-template <class TInputImage, class TOutputImage>
-void
-MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::CopyCoefficientsToScratch(
-  OutputLinearIterator & Iter)
-{
-  unsigned long j = 0;
-  while (!Iter.IsAtEndOfLine())
-  {
-    m_Scratch[j] = static_cast<CoeffType>(Iter.Get());
-    ++Iter;
-    ++j;
-  }
-}
-
-
 /**
  * GenerateInputRequestedRegion method.
  */
@@ -422,20 +473,9 @@ void
 MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::GenerateData()
 {
 
-  // Allocate scratch memory
   InputImageConstPointer inputPtr = this->GetInput();
   m_DataLength = inputPtr->GetBufferedRegion().GetSize();
 
-  unsigned long maxLength = 0;
-  for (unsigned int n = 0; n < ImageDimension; ++n)
-  {
-    if (m_DataLength[n] > maxLength)
-    {
-      maxLength = m_DataLength[n];
-    }
-  }
-  m_Scratch.resize(maxLength);
-
   // Allocate memory for output image
   OutputImagePointer outputPtr = this->GetOutput();
   outputPtr->SetBufferedRegion(outputPtr->GetRequestedRegion());
@@ -443,9 +483,6 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::GenerateDa
 
   // Calculate actual output
   this->DataToCoefficientsND();
-
-  // Clean up
-  m_Scratch.clear();
 }
 
 
@@ -42,6 +42,7 @@
 #include <vnl/vnl_matrix.h>
 
 #include "itkMultiOrderBSplineDecompositionImageFilter.h"
+#include "elxBSplineCoefficientCache.h"
 #include "itkConceptChecking.h"
 #include "itkCovariantVector.h"
 
@@ -68,7 +69,9 @@ namespace itk
  *
  * The B spline coefficients are calculated through the
  * MultiOrderBSplineDecompositionImageFilter to enable a zero-th order
- * for the last dimension.
+ * for the last dimension. They are reused when SetInputImage is called again
+ * with the same (unmodified) image and spline order, and, when UseCoefficientCache
+ * is on, shared via the process-wide elastix::BSplineCoefficientCache.
  *
  * Limitations:  Spline order must be between 0 and 5.
  *               Spline order must be set before setting the image.
@@ -129,6 +132,9 @@ public:
 
   using CoefficientFilterPointer = typename CoefficientFilter::Pointer;
 
+  /** The cache of coefficients. */
+  using CoefficientCacheType = elastix::BSplineCoefficientCache<TImageType, CoefficientImageType>;
+
   /** Evaluate the function at a ContinuousIndex position.
    *
    * Returns the B-Spline interpolated image intensity at a
@@ -181,9 +187,14 @@ public:
   itkGetConstMacro(UseImageDirection, bool);
   itkBooleanMacro(UseImageDirection);
 
+  /** Set/Get whether the coefficients are shared via the process-wide cache. Default: false. */
+  itkSetMacro(UseCoefficientCache, bool);
+  itkGetConstMacro(UseCoefficientCache, bool);
+  itkBooleanMacro(UseCoefficientCache);
+
 protected:
   ReducedDimensionBSplineInterpolateImageFunction();
-  ~ReducedDimensionBSplineInterpolateImageFunction() override = default;
+  ~ReducedDimensionBSplineInterpolateImageFunction() override;
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
@@ -232,11 +243,14 @@ private:
 
   std::vector<IndexType> m_PointsToIndex{}; // Preallocation of interpolation neighborhood indicies
 
-  CoefficientFilterPointer m_CoefficientFilter{};
-
   // flag to take or not the image direction into account when computing the
   // derivatives.
   bool m_UseImageDirection{};
+
+  bool m_UseCoefficientCache{ false };
+
+  // Identifies the coefficients that were computed by the last SetInputImage call.
+  typename CoefficientCacheType::CoefficientKey m_CoefficientKey{};
 };
 
 } // namespace itk
@@ -57,7 +57,6 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
 {
   m_SplineOrder = 0;
   unsigned int SplineOrder = 1;
-  m_CoefficientFilter = CoefficientFilter::New();
   // ***TODO: Should we store coefficients in a variable or retrieve from filter?
   m_Coefficients = CoefficientImageType::New();
   this->SetSplineOrder(SplineOrder);
@@ -65,6 +64,22 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
 }
 
 
+/**
+ * Destructor
+ */
+template <class TImageType, class TCoordRep, class TCoefficientType>
+ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::
+  ~ReducedDimensionBSplineInterpolateImageFunction()
+{
+  // Let the cache release the coefficients, when no other interpolator uses them.
+  if (m_UseCoefficientCache)
+  {
+    m_Coefficients = nullptr;
+    CoefficientCacheType::ReleaseUnusedCoefficients();
+  }
+}
+
+
 /**
  * Standard "PrintSelf" method
  */
@@ -86,15 +101,28 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
 {
   if (inputData)
   {
-    m_CoefficientFilter->SetInput(inputData);
+    // Use nearest neighbour interpolation in the last dimension, by a spline order of zero.
+    typename CoefficientCacheType::SplineOrderArrayType splineOrders;
+    splineOrders.Fill(m_SplineOrder);
+    splineOrders[ImageDimension - 1] = 0;
+
+    // The coefficients of the previous call are reused, when the image and the spline order are the same.
+    using CoefficientKeyType = typename CoefficientCacheType::CoefficientKey;
+    if (m_Coefficients.IsNull() || !(CoefficientKeyType(*inputData, splineOrders) == m_CoefficientKey))
+    {
+      const bool releaseCachedCoefficients = m_UseCoefficientCache && m_Coefficients.IsNotNull();
 
-    // the Coefficient Filter requires that the spline order and the input data be set.
-    // TODO:  We need to ensure that this is only run once and only after both input and
-    //        spline order have been set. Should we force an update after the
-    //        splineOrder has been set also?
+      m_Coefficients = m_UseCoefficientCache ? CoefficientCacheType::GetCoefficients(*inputData, splineOrders)
+                                             : CoefficientCacheType::ComputeCoefficients(*inputData, splineOrders);
 
-    m_CoefficientFilter->Update();
-    m_Coefficients = m_CoefficientFilter->GetOutput();
+      // The key is determined afterwards, as the computation may have updated the input image.
+      m_CoefficientKey = CoefficientKeyType(*inputData, splineOrders);
+
+      if (releaseCachedCoefficients)
+      {
+        CoefficientCacheType::ReleaseUnusedCoefficients();
+      }
+    }
 
     // Call the Superclass implementation after, in case the filter
     // pulls in  more of the input image
@@ -105,6 +133,7 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
   else
   {
     m_Coefficients = nullptr;
+    m_CoefficientKey = {};
   }
 }
 
@@ -120,10 +149,8 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
   }
 
   m_SplineOrder = SplineOrder;
-  m_CoefficientFilter->SetSplineOrder(SplineOrder);
-  // Set spline order of coefficient filter for last dimension to zero,
+  // The spline order of the coefficients for the last dimension is zero (see SetInputImage),
   // to use nearest neighbour interpolation in the last dimension.
-  m_CoefficientFilter->SetSplineOrder(ImageDimension - 1, 0);
 
   // this->SetPoles();
   this->GeneratePointsToIndex();
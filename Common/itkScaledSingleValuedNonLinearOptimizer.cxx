@@ -126,6 +126,22 @@ ScaledSingleValuedNonLinearOptimizer::GetScaledValueAndDerivative(const Paramete
 } // end GetScaledValueAndDerivative()
 
 
+/**
+ * ********************* GetScaledValueAndDerivativeInBlocks ***********************
+ */
+
+bool
+ScaledSingleValuedNonLinearOptimizer::GetScaledValueAndDerivativeInBlocks(
+  const ParametersType &                                      parameters,
+  MeasureType &                                               value,
+  DerivativeType &                                            derivative,
+  const ScaledCostFunctionType::DerivativeBlockFunctionType & blockFunction) const
+{
+  return this->m_ScaledCostFunction->GetValueAndDerivativeInBlocks(parameters, value, derivative, blockFunction);
+
+} // end GetScaledValueAndDerivativeInBlocks()
+
+
 /**
  * ********************* GetCurrentPosition ***********************
  */
@@ -182,6 +182,16 @@ protected:
                               MeasureType &          value,
                               DerivativeType &       derivative) const;
 
+  /** Same procedure as in GetScaledValueAndDerivative, but passes each block of the scaled derivative
+   * to the block function, as soon as it is final, when the cost function supports it. Returns false
+   * when the block function is not called; the caller should then process the whole derivative itself.
+   */
+  virtual bool
+  GetScaledValueAndDerivativeInBlocks(const ParametersType &                                      parameters,
+                                      MeasureType &                                               value,
+                                      DerivativeType &                                            derivative,
+                                      const ScaledCostFunctionType::DerivativeBlockFunctionType & blockFunction) const;
+
 private:
   /** Variable to store the CurrentPosition, when the function
    * GetCurrentPosition is called. This method needs a member variable,
@@ -22,6 +22,7 @@
 #include "itkMeshFileReaderBase.h"
 
 #include <fstream>
+#include <vector>
 
 namespace itk
 {
@@ -64,6 +65,7 @@ public:
   using typename Superclass::DataObjectPointer;
   using typename Superclass::OutputMeshType;
   using typename Superclass::OutputMeshPointer;
+  using PointType = typename OutputMeshType::PointType;
 
   /** Get whether the read points are indices; actually we should store this as a kind
    * of meta data in the output, but i don't understand this concept yet...
@@ -89,6 +91,14 @@ public:
   void
   GenerateOutputInformation() override;
 
+  /** Reads the next points from the file, without storing them in the output, after the output information is
+   * generated (for example, by UpdateOutputInformation()). Reads at most the specified number of points, and resizes
+   * the vector to the number of points that are read. Returns false when all points are read already. This allows
+   * processing a large point file in chunks, instead of reading all of its points at once, by Update().
+   */
+  bool
+  ReadNextPoints(std::vector<PointType> & points, const std::size_t maximumNumberOfPoints);
+
 protected:
   TransformixInputPointFileReader() = default;
   ~TransformixInputPointFileReader() override = default;
@@ -98,7 +108,12 @@ protected:
   GenerateData() override;
 
 private:
+  /** Reads a single point from the file. */
+  void
+  ReadPoint(PointType & point);
+
   unsigned long m_NumberOfPoints{ 0 };
+  unsigned long m_NumberOfPointsRead{ 0 };
   bool          m_PointsAreIndices{ false };
 
   std::ifstream m_Reader{};
@@ -21,6 +21,8 @@
 
 #include "itkTransformixInputPointFileReader.h"
 
+#include <algorithm> // For min.
+
 namespace itk
 {
 
@@ -41,6 +43,7 @@ TransformixInputPointFileReader<TOutputMesh>::GenerateOutputInformation()
     this->m_Reader.close();
   }
   this->m_Reader.open(this->m_FileName);
+  this->m_NumberOfPointsRead = 0;
 
   /** Read the first entry */
   std::string indexOrPoint;
@@ -81,8 +84,6 @@ TransformixInputPointFileReader<TOutputMesh>::GenerateData()
 {
   using PointsContainerType = typename OutputMeshType::PointsContainer;
   using PointsContainerPointer = typename PointsContainerType::Pointer;
-  using PointType = typename OutputMeshType::PointType;
-  const unsigned int dimension = OutputMeshType::PointDimension;
 
   OutputMeshPointer      output = this->GetOutput();
   PointsContainerPointer points = PointsContainerType::New();
@@ -94,21 +95,7 @@ TransformixInputPointFileReader<TOutputMesh>::GenerateData()
     {
       // read point from textfile
       PointType point;
-      for (unsigned int j = 0; j < dimension; ++j)
-      {
-        if (!this->m_Reader.eof())
-        {
-          this->m_Reader >> point[j];
-        }
-        else
-        {
-          std::ostringstream msg;
-          msg << "The file is not large enough. \n"
-              << "Filename: " << this->m_FileName << '\n';
-          MeshFileReaderException e(__FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION);
-          throw e;
-        }
-      }
+      this->ReadPoint(point);
       points->push_back(point);
     }
   }
@@ -137,6 +124,72 @@ TransformixInputPointFileReader<TOutputMesh>::GenerateData()
 } // end GenerateData()
 
 
+/**
+ * ***************ReadNextPoints ***********
+ */
+
+template <class TOutputMesh>
+bool
+TransformixInputPointFileReader<TOutputMesh>::ReadNextPoints(std::vector<PointType> & points,
+                                                             const std::size_t        maximumNumberOfPoints)
+{
+  const std::size_t numberOfPoints =
+    std::min<std::size_t>(maximumNumberOfPoints, this->m_NumberOfPoints - this->m_NumberOfPointsRead);
+  points.resize(numberOfPoints);
+
+  if (numberOfPoints == 0)
+  {
+    /** Close the reader */
+    this->m_Reader.close();
+    return false;
+  }
+
+  if (!this->m_Reader.is_open())
+  {
+    std::ostringstream msg;
+    msg << "The file has unexpectedly been closed. \n"
+        << "Filename: " << this->m_FileName << '\n';
+    MeshFileReaderException e(__FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION);
+    throw e;
+  }
+
+  for (auto & point : points)
+  {
+    this->ReadPoint(point);
+  }
+  this->m_NumberOfPointsRead += numberOfPoints;
+  return true;
+
+} // end ReadNextPoints()
+
+
+/**
+ * ***************ReadPoint ***********
+ */
+
+template <class TOutputMesh>
+void
+TransformixInputPointFileReader<TOutputMesh>::ReadPoint(PointType & point)
+{
+  for (unsigned int j = 0; j < OutputMeshType::PointDimension; ++j)
+  {
+    if (!this->m_Reader.eof())
+    {
+      this->m_Reader >> point[j];
+    }
+    else
+    {
+      std::ostringstream msg;
+      msg << "The file is not large enough. \n"
+          << "Filename: " << this->m_FileName << '\n';
+      MeshFileReaderException e(__FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION);
+      throw e;
+    }
+  }
+
+} // end ReadPoint()
+
+
 } // end namespace itk
 
 #endif
@@ -128,6 +128,10 @@ protected:
   /** The destructor. */
   ~FixedGenericPyramid() override = default;
 
+  /** Generates the pyramid images, or takes them from the fixed image preprocessing cache. */
+  void
+  GenerateData() override;
+
 private:
   elxOverrideGetSelfMacro;
 };
@@ -57,6 +57,23 @@ FixedGenericPyramid<TElastix>::BeforeEachResolution()
 } // end BeforeEachResolution()
 
 
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template <class TElastix>
+void
+FixedGenericPyramid<TElastix>::GenerateData()
+{
+  /** When the images are computed per resolution, each resolution has its own result in the cache. */
+  const std::string resultName =
+    this->GetComputeOnlyForCurrentLevel() ? "OutputsAtLevel" + std::to_string(this->GetCurrentLevel()) : "Outputs";
+
+  this->GenerateDataUsingFixedImagePreprocessingCache(resultName, [this] { this->Superclass1::GenerateData(); });
+
+} // end GenerateData()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxFixedGenericPyramid_hxx
@@ -87,6 +87,13 @@ protected:
   /** The destructor. */
   ~FixedShrinkingPyramid() override = default;
 
+  /** Generates the pyramid images, or takes them from the fixed image preprocessing cache. */
+  void
+  GenerateData() override
+  {
+    this->GenerateDataUsingFixedImagePreprocessingCache("Outputs", [this] { this->Superclass1::GenerateData(); });
+  }
+
 private:
   elxOverrideGetSelfMacro;
 };
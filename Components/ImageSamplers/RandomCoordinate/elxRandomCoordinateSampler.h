@@ -70,6 +70,16 @@ namespace elastix
  *    With this option you can specify the order of interpolation.\n
  *    example: <tt>(FixedImageBSplineInterpolationOrder 0 0 1)</tt>\n
  *    Default value: 1. The parameter can be specified for each resolution.
+ * \parameter UseMaskSpans: When a mask is used, only draw candidate samples from the
+ *    voxels near the mask, which are computed once as run-length encoded spans. This
+ *    avoids most of the rejected candidates when the mask is sparse.\n
+ *    example: <tt>(UseMaskSpans "true")</tt>\n
+ *    Default: false. The parameter can be specified for each resolution.
+ * \parameter UseMultiThreadWithMask: When a mask is used, draw the samples multi-threadedly.
+ *    The samples are then still reproducible for a given RandomSeed, whatever the number of
+ *    threads, but they differ from the samples that are drawn single-threadedly.\n
+ *    example: <tt>(UseMultiThreadWithMask "true")</tt>\n
+ *    Default: false. The parameter can be specified for each resolution.
  *
  * \ingroup ImageSamplers
  */
@@ -138,6 +148,7 @@ public:
    * \li Set the number of samples.
    * \li Set the fixed image interpolation order
    * \li Set the UseRandomSampleRegion flag and the SampleRegionSize
+   * \li Set the UseMaskSpans flag
    */
   void
   BeforeEachResolution() override;
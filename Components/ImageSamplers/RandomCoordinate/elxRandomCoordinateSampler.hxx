@@ -63,6 +63,16 @@ RandomCoordinateSampler<TElastix>::BeforeEachResolution()
   configuration.ReadParameter(useRandomSampleRegion, "UseRandomSampleRegion", this->GetComponentLabel(), level, 0);
   this->SetUseRandomSampleRegion(useRandomSampleRegion);
 
+  /** Set the UseMaskSpans bool. */
+  bool useMaskSpans = false;
+  configuration.ReadParameter(useMaskSpans, "UseMaskSpans", this->GetComponentLabel(), level, 0);
+  this->SetUseMaskSpans(useMaskSpans);
+
+  /** Set the UseMultiThreadWithMask bool. */
+  bool useMultiThreadWithMask = false;
+  configuration.ReadParameter(useMultiThreadWithMask, "UseMultiThreadWithMask", this->GetComponentLabel(), level, 0);
+  this->SetUseMultiThreadWithMask(useMultiThreadWithMask);
+
   /** Set the SampleRegionSize. */
   if (useRandomSampleRegion)
   {
@@ -19,7 +19,7 @@
 #define elxBSplineInterpolator_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
 
 namespace elastix
 {
@@ -48,9 +48,9 @@ namespace elastix
 
 template <class TElastix>
 class ITK_TEMPLATE_EXPORT BSplineInterpolator
-  : public itk::BSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
-                                                typename InterpolatorBase<TElastix>::CoordRepType,
-                                                double>
+  : public itk::CachedBSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
+                                                      typename InterpolatorBase<TElastix>::CoordRepType,
+                                                      double>
   , // CoefficientType
     public InterpolatorBase<TElastix>
 {
@@ -59,9 +59,9 @@ public:
 
   /** Standard ITK-stuff. */
   using Self = BSplineInterpolator;
-  using Superclass1 = itk::BSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
-                                                           typename InterpolatorBase<TElastix>::CoordRepType,
-                                                           double>;
+  using Superclass1 = itk::CachedBSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
+                                                                 typename InterpolatorBase<TElastix>::CoordRepType,
+                                                                 double>;
   using Superclass2 = InterpolatorBase<TElastix>;
   using Pointer = itk::SmartPointer<Self>;
   using ConstPointer = itk::SmartPointer<const Self>;
@@ -36,6 +36,11 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Interpolator: Select this interpolator as follows:\n
  *    <tt>(Interpolator "RayCastInterpolator")</tt>
+ * \parameter EarlyExitOnThreshold: Skip the parts of the rays outside of the bounding box of the voxels above
+ *    the threshold. Does not change the result, but requires a pass over the moving image in each resolution.
+ *    Can be given for each resolution. \n
+ *    example: <tt>(EarlyExitOnThreshold "false" "true")</tt> \n
+ *    The default is "false".
  *
  * \ingroup Interpolators
  */
@@ -111,6 +111,11 @@ RayCastInterpolator<TElastix>::BeforeEachResolution()
   this->GetConfiguration()->ReadParameter(threshold, "Threshold", this->GetComponentLabel(), level, 0);
   this->SetThreshold(threshold);
 
+  bool earlyExitOnThreshold = false;
+  this->GetConfiguration()->ReadParameter(
+    earlyExitOnThreshold, "EarlyExitOnThreshold", this->GetComponentLabel(), level, 0);
+  this->SetEarlyExitOnThreshold(earlyExitOnThreshold);
+
 } // end BeforeEachResolution()
 
 
@@ -454,13 +454,6 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::ThreadedGet
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   const unsigned long         sampleContainerSize = sampleContainer->Size();
 
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  const auto pos_begin = std::min<size_t>(nrOfSamplesPerThreads * threadId, sampleContainerSize);
-  const auto pos_end = std::min<size_t>(nrOfSamplesPerThreads * (threadId + 1), sampleContainerSize);
-
   /** Some variables. */
   RealType      movingImageValue;
   std::size_t   fixedForegroundArea = 0; // or unsigned long
@@ -470,66 +463,73 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::ThreadedGet
 
   /** Create iterator over the sample container. */
   const auto beginOfSampleContainer = sampleContainer->cbegin();
-  const auto fbegin = beginOfSampleContainer + pos_begin;
-  const auto fend = beginOfSampleContainer + pos_end;
 
-  /** Loop over the fixed image to calculate the kappa statistic. */
-  for (auto fiter = fbegin; fiter != fend; ++fiter)
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates. */
-    const FixedImagePointType & fixedPoint = fiter->m_ImageCoordinates;
+    const auto fbegin = beginOfSampleContainer + pos_begin;
+    const auto fend = beginOfSampleContainer + pos_end;
 
-    /** Transform point. */
-    const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
+    /** Loop over the fixed image to calculate the kappa statistic. */
+    for (auto fiter = fbegin; fiter != fend; ++fiter)
+    {
+      /** Read fixed coordinates. */
+      const FixedImagePointType & fixedPoint = fiter->m_ImageCoordinates;
 
-    /** Check if the point is inside the moving mask. */
-    bool sampleOk = this->IsInsideMovingMask(mappedPoint);
+      /** Transform point. */
+      const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
 
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
-     */
-    MovingImageDerivativeType movingImageDerivative;
-    if (sampleOk)
-    {
-      sampleOk = this->FastEvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative, threadId);
-    }
+      /** Check if the point is inside the moving mask. */
+      bool sampleOk = this->IsInsideMovingMask(mappedPoint);
 
-    /** Do the actual calculation of the metric value. */
-    if (sampleOk)
-    {
-      ++numberOfPixelsCounted;
+      /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+       * the point is inside the moving image buffer.
+       */
+      MovingImageDerivativeType movingImageDerivative;
+      if (sampleOk)
+      {
+        sampleOk = this->FastEvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, &movingImageDerivative, threadId);
+      }
 
-      /** Get the fixed image value. */
-      const RealType fixedImageValue = static_cast<RealType>(fiter->m_ImageValue);
+      /** Do the actual calculation of the metric value. */
+      if (sampleOk)
+      {
+        ++numberOfPixelsCounted;
+
+        /** Get the fixed image value. */
+        const RealType fixedImageValue = static_cast<RealType>(fiter->m_ImageValue);
 
 #if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        /** Get the TransformJacobian dT/dmu. */
+        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+        /** Compute the inner products (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(
+          jacobian, movingImageDerivative, imageJacobian );
 #else
-      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      Superclass::m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji);
+        /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+        Superclass::m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+          fixedPoint, movingImageDerivative, imageJacobian, nzji);
 #endif
 
-      /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(fixedImageValue,
-                                          movingImageValue,
-                                          fixedForegroundArea,
-                                          movingForegroundArea,
-                                          intersection,
-                                          imageJacobian,
-                                          nzji,
-                                          vecSum1,
-                                          vecSum2);
+        /** Compute this pixel's contribution to the measure and derivatives. */
+        this->UpdateValueAndDerivativeTerms(fixedImageValue,
+                                            movingImageValue,
+                                            fixedForegroundArea,
+                                            movingForegroundArea,
+                                            intersection,
+                                            imageJacobian,
+                                            nzji,
+                                            vecSum1,
+                                            vecSum2);
 
-    } // end if sampleOk
+      } // end if sampleOk
 
-  } // end for loop over the image sample container
+    } // end for loop over the image sample container
+  }
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_KappaGetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -619,8 +619,7 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::AfterThread
     userData.st_Coefficient2 = tmp2;
     userData.st_DerivativePointer = derivative.begin();
 
-    this->m_Threader->SetSingleMethod(AccumulateDerivativesThreaderCallback, &userData);
-    this->m_Threader->SingleMethodExecute();
+    this->LaunchThreaderCallback(AccumulateDerivativesThreaderCallback, &userData);
   }
 
 } // end AfterThreadedGetValueAndDerivative()
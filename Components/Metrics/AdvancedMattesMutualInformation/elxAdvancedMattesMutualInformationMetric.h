@@ -91,6 +91,23 @@ namespace elastix
  *    B-spline grids.
  *    example: <tt>(UseFastAndLowMemoryVersion "false")</tt> \n
  *    The default is "true".
+ * \parameter UseSampleEvaluationCache: Only relevant for the fast and low
+ *    memory version, when the metric is multi-threaded. If "true", the
+ *    moving image values and derivatives that are computed for each sample
+ *    while constructing the joint histogram are stored, and reused
+ *    when computing the derivative. This saves a second transformation and
+ *    interpolation of each sample, at the cost of some memory per sample.
+ *    Can be given for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(UseSampleEvaluationCache "true")</tt> \n
+ *    The default is "false".
+ * \parameter MaximumThreadPDFDerivativesMemory: Only relevant when UseFastAndLowMemoryVersion
+ *    is "false", and the metric is multi-threaded. Each additional thread then accumulates
+ *    the joint histogram derivatives into a 3D matrix of its own. This parameter specifies
+ *    the maximum amount of memory, in megabytes, that these matrices may occupy together.
+ *    When they would need more, the joint histogram derivatives are computed by a single
+ *    thread. Can be given for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(MaximumThreadPDFDerivativesMemory 2048)</tt> \n
+ *    The default is 512.
  *
  * \sa ParzenWindowMutualInformationImageToImageMetric
  * \ingroup Metrics
@@ -121,6 +121,18 @@ AdvancedMattesMutualInformationMetric<TElastix>::BeforeEachResolution()
     useFastAndLowMemoryVersion, "UseFastAndLowMemoryVersion", this->GetComponentLabel(), level, 0);
   this->SetUseExplicitPDFDerivatives(!useFastAndLowMemoryVersion);
 
+  /** Set whether the sample evaluations of the histogram pass should be reused by the derivative pass. */
+  bool useSampleEvaluationCache = false;
+  this->GetConfiguration()->ReadParameter(
+    useSampleEvaluationCache, "UseSampleEvaluationCache", this->GetComponentLabel(), level, 0);
+  this->SetUseSampleEvaluationCache(useSampleEvaluationCache);
+
+  /** Set the memory limit of the per-thread joint histogram derivatives, in megabytes. */
+  itk::SizeValueType maximumThreadPDFDerivativesMemory = 512;
+  this->GetConfiguration()->ReadParameter(
+    maximumThreadPDFDerivativesMemory, "MaximumThreadPDFDerivativesMemory", this->GetComponentLabel(), level, 0);
+  this->SetMaximumThreadPDFDerivativesMemory(maximumThreadPDFDerivativesMemory * 1024 * 1024);
+
   /** Set whether to use Nick Tustison's preconditioning technique. */
   bool useJacobianPreconditioning = false;
   this->GetConfiguration()->ReadParameter(
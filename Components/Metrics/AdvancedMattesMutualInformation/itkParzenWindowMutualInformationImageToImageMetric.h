@@ -118,6 +118,8 @@ public:
   using typename Superclass::MeasureType;
   using typename Superclass::DerivativeType;
   using typename Superclass::DerivativeValueType;
+  using typename Superclass::PerThreadDerivativeType;
+  using typename Superclass::PerThreadDerivativeValueType;
   using typename Superclass::ParametersType;
   using typename Superclass::FixedImagePixelType;
   using typename Superclass::MovingImageRegionType;
@@ -154,6 +156,17 @@ protected:
   /** The destructor. */
   ~ParzenWindowMutualInformationImageToImageMetric() override = default;
 
+  /** Copies the Jacobian preconditioning setting to the clone. */
+  LightObject::Pointer
+  InternalClone() const override;
+
+  /** Evaluation contexts are supported by this metric. */
+  bool
+  EvaluationContextsSupported() const override
+  {
+    return true;
+  }
+
   /** Protected Typedefs ******************/
 
   /** Typedefs inherited from superclass */
@@ -180,6 +193,7 @@ protected:
   using typename Superclass::ParzenValueContainerType;
   using typename Superclass::KernelFunctionType;
   using typename Superclass::NonZeroJacobianIndicesType;
+  using typename Superclass::CachedSampleEvaluationType;
 
   /**  Get the value and analytic derivative.
    * Called by GetValueAndDerivative if UseFiniteDifferenceDerivative == false.
@@ -252,8 +266,9 @@ protected:
   LaunchComputeDerivativeLowMemoryThreaderCallback() const;
 
 private:
-  /** Helper array for storing the values of the JointPDF ratios. */
-  using PRatioType = double;
+  /** Helper array for storing the values of the JointPDF ratios. Read for each sample, by
+   * UpdateDerivativeLowMemory, so it has the precision of the per-thread derivatives. */
+  using PRatioType = PerThreadDerivativeValueType;
   using PRatioArrayType = vnl_matrix<PRatioType>;
   mutable PRatioArrayType m_PRatioArray{};
 
@@ -267,13 +282,15 @@ private:
   void
   ComputeDerivativeLowMemory(DerivativeType & derivative) const;
 
-  /** Helper function to update the derivative for the low memory variant. */
+  /** Helper function to update the derivative for the low memory variant. The derivative is either a
+   * DerivativeType or a PerThreadDerivativeType. */
+  template <typename TDerivative>
   void
   UpdateDerivativeLowMemory(const RealType                     fixedImageValue,
                             const RealType                     movingImageValue,
                             const DerivativeType &             imageJacobian,
                             const NonZeroJacobianIndicesType & nzji,
-                            DerivativeType &                   derivative) const;
+                            TDerivative &                      derivative) const;
 
   /** Helper function to compute m_PRatioArray in case of low memory consumption. */
   void
@@ -49,6 +49,21 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage,
 } // end constructor
 
 
+/**
+ * ********************* InternalClone ******************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+LightObject::Pointer
+ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::InternalClone() const
+{
+  LightObject::Pointer clonedObject = Superclass::InternalClone();
+  dynamic_cast<Self &>(*clonedObject).m_UseJacobianPreconditioning = this->m_UseJacobianPreconditioning;
+  return clonedObject;
+
+} // end InternalClone()
+
+
 /**
  * ********************* InitializeHistograms ******************************
  */
@@ -242,35 +257,50 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::GetV
   MeasureType &          value,
   DerivativeType &       derivative) const
 {
-  /** Construct the JointPDF and Alpha.
-   * This function contains a loop over the samples.
-   * It executes multi-threadedly when m_UseMultiThread == true.
+  /** The evaluation of each sample may be cached by the first loop over the samples, so that
+   * the second loop does not need to redo it. The flag is also reset when an exception is
+   * thrown, so that a later call (for example of GetValue) does not fill the cache anymore.
    */
-  this->ComputePDFs(parameters);
+  this->m_FillSampleEvaluationCache = this->GetUseSampleEvaluationCache() && Superclass::m_UseMultiThread;
 
-  /** Normalize the joint histogram by alpha. */
-  this->NormalizeJointPDF(this->m_JointPDF, this->m_Alpha);
+  try
+  {
+    /** Construct the JointPDF and Alpha.
+     * This function contains a loop over the samples.
+     * It executes multi-threadedly when m_UseMultiThread == true.
+     */
+    this->ComputePDFs(parameters);
 
-  /** Compute the fixed and moving marginal pdf by summing over the histogram. */
-  this->ComputeMarginalPDF(this->m_JointPDF, this->m_FixedImageMarginalPDF, 0);
-  this->ComputeMarginalPDF(this->m_JointPDF, this->m_MovingImageMarginalPDF, 1);
+    /** Normalize the joint histogram by alpha. */
+    this->NormalizeJointPDF(this->m_JointPDF, this->m_Alpha);
 
-  // \todo: the last three loops over the joint histogram can be done in
-  // one loop, maybe also include the next loop to generate m_PRatioArray.
-  // The effort is probably not worth the gain in performance.
+    /** Compute the fixed and moving marginal pdf by summing over the histogram. */
+    this->ComputeMarginalPDF(this->m_JointPDF, this->m_FixedImageMarginalPDF, 0);
+    this->ComputeMarginalPDF(this->m_JointPDF, this->m_MovingImageMarginalPDF, 1);
 
-  /** Compute the metric value and the intermediate m_PRatioArray
-   * by summation over the joint histogram.
-   */
-  double MI = 0.0;
-  this->ComputeValueAndPRatioArray(MI);
-  value = static_cast<MeasureType>(-1.0 * MI);
+    // \todo: the last three loops over the joint histogram can be done in
+    // one loop, maybe also include the next loop to generate m_PRatioArray.
+    // The effort is probably not worth the gain in performance.
 
-  /* Compute the derivative.
-   * This function contains a second loop over the samples.
-   * It executes multi-threadedly when m_UseMultiThread == true.
-   */
-  this->ComputeDerivativeLowMemory(derivative);
+    /** Compute the metric value and the intermediate m_PRatioArray
+     * by summation over the joint histogram.
+     */
+    double MI = 0.0;
+    this->ComputeValueAndPRatioArray(MI);
+    value = static_cast<MeasureType>(-1.0 * MI);
+
+    /* Compute the derivative.
+     * This function contains a second loop over the samples.
+     * It executes multi-threadedly when m_UseMultiThread == true.
+     */
+    this->ComputeDerivativeLowMemory(derivative);
+  }
+  catch (...)
+  {
+    this->m_FillSampleEvaluationCache = false;
+    throw;
+  }
+  this->m_FillSampleEvaluationCache = false;
 
 } // end GetValueAndAnalyticDerivativeLowMemory()
 
@@ -428,7 +458,7 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Thre
    * InitializeThreadingParameters(), and at the end of each iteration in
    * AfterThreadedGetValueAndDerivative() and the accumulate functions.
    */
-  DerivativeType & derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
+  PerThreadDerivativeType & derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
 
   /** Declare and allocate arrays for Jacobian preconditioning. */
   DerivativeType jacobianPreconditioner, preconditioningDivisor;
@@ -443,94 +473,123 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Thre
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   const unsigned long         sampleContainerSize = sampleContainer->Size();
 
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  const auto pos_begin = std::min<size_t>(nrOfSamplesPerThreads * threadId, sampleContainerSize);
-  const auto pos_end = std::min<size_t>(nrOfSamplesPerThreads * (threadId + 1), sampleContainerSize);
-
   /** Create iterator over the sample container. */
   const auto beginOfSampleContainer = sampleContainer->cbegin();
-  const auto fbegin = beginOfSampleContainer + pos_begin;
-  const auto fend = beginOfSampleContainer + pos_end;
 
-  /** Loop over sample container and compute contribution of each sample to pdfs. */
-  for (auto fiter = fbegin; fiter != fend; ++fiter)
+  /** When the PDF pass has cached the sample evaluations, replay them here. The cache is
+   * indexed by sample position, so the chunks need not match those of the PDF pass.
+   */
+  const bool useCache = this->m_FillSampleEvaluationCache;
+  assert(!useCache || this->GetCachedSampleEvaluations().size() == sampleContainerSize);
+
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates and create some variables. */
-    const FixedImagePointType & fixedPoint = fiter->m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImageDerivativeType   movingImageDerivative;
+    const auto fbegin = beginOfSampleContainer + pos_begin;
+    const auto fend = beginOfSampleContainer + pos_end;
+    auto       cacheIter = this->GetCachedSampleEvaluations().cbegin() + (useCache ? pos_begin : 0);
 
-    /** Transform point. */
-    const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
+    /** Loop over sample container and compute contribution of each sample to pdfs. */
+    for (auto fiter = fbegin; fiter != fend; ++fiter)
+    {
+      /** Read fixed coordinates and create some variables. */
+      const FixedImagePointType & fixedPoint = fiter->m_ImageCoordinates;
+      RealType                    fixedImageValue{};
+      RealType                    movingImageValue{};
+      MovingImageDerivativeType   movingImageDerivative;
+      bool                        sampleOk;
+
+      if (useCache)
+      {
+        /** Get the limited values and derivative from the cache. */
+        const CachedSampleEvaluationType & cachedSampleEvaluation = *cacheIter;
+        ++cacheIter;
 
-    /** Check if the point is inside the moving mask. */
-    bool sampleOk = this->IsInsideMovingMask(mappedPoint);
+        sampleOk = cachedSampleEvaluation.m_SampleOk;
+        if (sampleOk)
+        {
+          fixedImageValue = cachedSampleEvaluation.m_FixedImageValue;
+          movingImageValue = cachedSampleEvaluation.m_MovingImageValue;
+          movingImageDerivative = cachedSampleEvaluation.m_MovingImageDerivative;
+        }
+      }
+      else
+      {
+        /** Transform point. */
+        const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
 
-    /** Compute the moving image value, its derivative, and check
-     * if the point is inside the moving image buffer.
-     */
-    if (sampleOk)
-    {
-      sampleOk = this->FastEvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative, threadId);
-    }
+        /** Check if the point is inside the moving mask. */
+        sampleOk = this->IsInsideMovingMask(mappedPoint);
 
-    if (sampleOk)
-    {
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast<RealType>(fiter->m_ImageValue);
+        /** Compute the moving image value, its derivative, and check
+         * if the point is inside the moving image buffer.
+         */
+        if (sampleOk)
+        {
+          sampleOk = this->FastEvaluateMovingImageValueAndDerivative(
+            mappedPoint, movingImageValue, &movingImageDerivative, threadId);
+        }
 
-      /** Make sure the values fall within the histogram range. */
-      fixedImageValue = this->GetFixedImageLimiter()->Evaluate(fixedImageValue);
-      movingImageValue = this->GetMovingImageLimiter()->Evaluate(movingImageValue, movingImageDerivative);
+        if (sampleOk)
+        {
+          /** Get the fixed image value. */
+          fixedImageValue = static_cast<RealType>(fiter->m_ImageValue);
 
+          /** Make sure the values fall within the histogram range. */
+          fixedImageValue = this->GetFixedImageLimiter()->Evaluate(fixedImageValue);
+          movingImageValue = this->GetMovingImageLimiter()->Evaluate(movingImageValue, movingImageDerivative);
+        }
+      }
+
+      if (sampleOk)
+      {
 #if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        /** Get the TransformJacobian dT/dmu. */
+        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+        /** Compute the inner products (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(
+          jacobian, movingImageDerivative, imageJacobian );
 #else
-      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      Superclass::m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji);
+        /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+        Superclass::m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+          fixedPoint, movingImageDerivative, imageJacobian, nzji);
 #endif
 
-      /** If desired, apply the technique introduced by Tustison. */
-      TransformJacobianType jacobian;
-      if (this->GetUseJacobianPreconditioning())
-      {
-        this->EvaluateTransformJacobian(fixedPoint, jacobian, nzji);
-
-        this->ComputeJacobianPreconditioner(jacobian, nzji, jacobianPreconditioner, preconditioningDivisor);
-        DerivativeValueType * imjacit = imageJacobian.begin();
-        DerivativeValueType * jacprecit = jacobianPreconditioner.begin();
-        for (unsigned int i = 0; i < nzji.size(); ++i)
+        /** If desired, apply the technique introduced by Tustison. */
+        TransformJacobianType jacobian;
+        if (this->GetUseJacobianPreconditioning())
         {
-          while (imjacit != imageJacobian.end())
+          this->EvaluateTransformJacobian(fixedPoint, jacobian, nzji);
+
+          this->ComputeJacobianPreconditioner(jacobian, nzji, jacobianPreconditioner, preconditioningDivisor);
+          DerivativeValueType * imjacit = imageJacobian.begin();
+          DerivativeValueType * jacprecit = jacobianPreconditioner.begin();
+          for (unsigned int i = 0; i < nzji.size(); ++i)
           {
-            (*imjacit) *= (*jacprecit);
-            ++imjacit;
-            ++jacprecit;
+            while (imjacit != imageJacobian.end())
+            {
+              (*imjacit) *= (*jacprecit);
+              ++imjacit;
+              ++jacprecit;
+            }
           }
         }
-      }
 
-      /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateDerivativeLowMemory(fixedImageValue, movingImageValue, imageJacobian, nzji, derivative);
+        /** Compute this sample's contribution to the joint distributions. */
+        this->UpdateDerivativeLowMemory(fixedImageValue, movingImageValue, imageJacobian, nzji, derivative);
 
-    } // end sampleOk
-  }   // end loop over sample container
+      } // end sampleOk
+    }   // end loop over sample container
+  }
 
   /** If desired, apply the technique introduced by Tustison. */
   if (this->GetUseJacobianPreconditioning())
   {
-    DerivativeValueType * derivit = derivative.begin();
-    DerivativeValueType * divisit = preconditioningDivisor.begin();
+    PerThreadDerivativeValueType * derivit = derivative.begin();
+    DerivativeValueType *          divisit = preconditioningDivisor.begin();
 
     /** This normalization was not in the Tustison paper, but it helps,
      * especially for localized mutual information.
@@ -562,11 +621,7 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Afte
   // compute single-threadedly
   if (!Superclass::m_UseMultiThread && false) // force multi-threaded
   {
-    derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[0].st_Derivative;
-    for (ThreadIdType i = 1; i < numberOfThreads; ++i)
-    {
-      derivative += Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_Derivative;
-    }
+    this->SumPerThreadDerivatives(derivative, 1.0);
   }
 #ifdef ELASTIX_USE_OPENMP
   // compute multi-threadedly with openmp
@@ -592,9 +647,8 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Afte
     Superclass::m_ThreaderMetricParameters.st_DerivativePointer = derivative.begin();
     Superclass::m_ThreaderMetricParameters.st_NormalizationFactor = 1.0;
 
-    this->m_Threader->SetSingleMethod(this->AccumulateDerivativesThreaderCallback,
-                                      &(Superclass::m_ThreaderMetricParameters));
-    this->m_Threader->SingleMethodExecute();
+    this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                                 &(Superclass::m_ThreaderMetricParameters));
   }
 
 } // end AfterThreadedComputeDerivativeLowMemory()
@@ -632,14 +686,10 @@ void
 ParzenWindowMutualInformationImageToImageMetric<TFixedImage,
                                                 TMovingImage>::LaunchComputeDerivativeLowMemoryThreaderCallback() const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod(
+  this->LaunchThreaderCallback(
     this->ComputeDerivativeLowMemoryThreaderCallback,
     const_cast<void *>(static_cast<const void *>(&this->m_ParzenWindowMutualInformationThreaderParameters)));
 
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
-
 } // end LaunchComputeDerivativeLowMemoryThreaderCallback()
 
 
@@ -723,13 +773,14 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Comp
  */
 
 template <class TFixedImage, class TMovingImage>
+template <typename TDerivative>
 void
 ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::UpdateDerivativeLowMemory(
   const RealType                     fixedImageValue,
   const RealType                     movingImageValue,
   const DerivativeType &             imageJacobian,
   const NonZeroJacobianIndicesType & nzji,
-  DerivativeType &                   derivative) const
+  TDerivative &                      derivative) const
 {
   /** In this function we need to do (see eq. 24 of Thevenaz [3]):
    *      derivative -= constant * imageJacobian *
@@ -799,7 +850,7 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Upda
     /** Loop over all Jacobians. */
     for (unsigned int mu = 0; mu < numberOfParameters; ++mu)
     {
-      derivative[mu] += static_cast<DerivativeValueType>(imageJacobian[mu] * sum);
+      derivative[mu] += static_cast<typename TDerivative::ValueType>(imageJacobian[mu] * sum);
     }
   }
   else
@@ -808,7 +859,7 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Upda
     for (unsigned int i = 0; i < imageJacobian.GetSize(); ++i)
     {
       const unsigned int mu = nzji[i];
-      derivative[mu] += static_cast<DerivativeValueType>(imageJacobian[i] * sum);
+      derivative[mu] += static_cast<typename TDerivative::ValueType>(imageJacobian[i] * sum);
     }
   }
 
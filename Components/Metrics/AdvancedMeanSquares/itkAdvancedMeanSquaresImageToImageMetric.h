@@ -95,6 +95,7 @@ public:
   using typename Superclass::MeasureType;
   using typename Superclass::DerivativeType;
   using typename Superclass::DerivativeValueType;
+  using typename Superclass::PerThreadDerivativeType;
   using typename Superclass::ParametersType;
   using typename Superclass::FixedImagePixelType;
   using typename Superclass::MovingImageRegionType;
@@ -169,6 +170,17 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** Copies the normalization settings to the clone. */
+  LightObject::Pointer
+  InternalClone() const override;
+
+  /** Evaluation contexts are supported by this metric. */
+  bool
+  EvaluationContextsSupported() const override
+  {
+    return true;
+  }
+
   /** Protected Typedefs ******************/
 
   /** Typedefs inherited from superclass */
@@ -183,14 +195,15 @@ protected:
   using typename Superclass::NonZeroJacobianIndicesType;
 
   /** Compute a pixel's contribution to the measure and derivatives;
-   * Called by GetValueAndDerivative(). */
+   * Called by GetValueAndDerivative(). The derivative is either a DerivativeType or a PerThreadDerivativeType. */
+  template <typename TDerivative>
   void
   UpdateValueAndDerivativeTerms(const RealType                     fixedImageValue,
                                 const RealType                     movingImageValue,
                                 const DerivativeType &             imageJacobian,
                                 const NonZeroJacobianIndicesType & nzji,
                                 MeasureType &                      measure,
-                                DerivativeType &                   deriv) const;
+                                TDerivative &                      deriv) const;
 
   /** Get value for each thread. */
   void
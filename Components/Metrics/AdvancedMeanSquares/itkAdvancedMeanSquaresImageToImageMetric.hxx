@@ -108,6 +108,23 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::Initialize()
 } // end Initialize()
 
 
+/**
+ * ******************* InternalClone *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+LightObject::Pointer
+AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::InternalClone() const
+{
+  LightObject::Pointer clonedObject = Superclass::InternalClone();
+  Self &               clone = dynamic_cast<Self &>(*clonedObject);
+  clone.m_UseNormalization = this->m_UseNormalization;
+  clone.m_NormalizationFactor = this->m_NormalizationFactor;
+  return clonedObject;
+
+} // end InternalClone()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -260,57 +277,60 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::ThreadedGetVal
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   const unsigned long         sampleContainerSize = sampleContainer->Size();
 
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  const auto pos_begin = std::min<size_t>(nrOfSamplesPerThreads * threadId, sampleContainerSize);
-  const auto pos_end = std::min<size_t>(nrOfSamplesPerThreads * (threadId + 1), sampleContainerSize);
-
   /** Create iterator over the sample container. */
   const auto beginOfSampleContainer = sampleContainer->cbegin();
-  const auto threader_fbegin = beginOfSampleContainer + pos_begin;
-  const auto threader_fend = beginOfSampleContainer + pos_end;
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
   MeasureType   measure{};
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for (auto threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = threader_fiter->m_ImageCoordinates;
-    RealType                    movingImageValue;
+    const auto threader_fbegin = beginOfSampleContainer + pos_begin;
+    const auto threader_fend = beginOfSampleContainer + pos_end;
 
-    /** Transform point. */
-    const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
+    /** Transform all fixed image points of the chunk at once. */
+    const MovingImagePointType * const mappedPoints =
+      this->TransformPoints(*sampleContainer, pos_begin, pos_end, threadId);
 
-    /** Check if the point is inside the moving mask. */
-    bool sampleOk = this->IsInsideMovingMask(mappedPoint);
-
-    /** Compute the moving image value M(T(x)) and check if
-     * the point is inside the moving image buffer.
-     */
-    if (sampleOk)
+    /** Loop over the fixed image to calculate the mean squares. */
+    for (auto threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
     {
-      sampleOk = this->FastEvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr, threadId);
-    }
+      /** Initialize some variables. */
+      RealType movingImageValue;
 
-    if (sampleOk)
-    {
-      ++numberOfPixelsCounted;
+      /** Get the transformed point. */
+      const MovingImagePointType & mappedPoint = mappedPoints[threader_fiter - threader_fbegin];
 
-      /** Get the fixed image value. */
-      const RealType fixedImageValue = static_cast<RealType>(threader_fiter->m_ImageValue);
+      /** Check if the point is inside the moving mask. */
+      bool sampleOk = this->IsInsideMovingMask(mappedPoint);
 
-      /** The difference squared. */
-      const RealType diff = movingImageValue - fixedImageValue;
-      measure += diff * diff;
+      /** Compute the moving image value M(T(x)) and check if
+       * the point is inside the moving image buffer.
+       */
+      if (sampleOk)
+      {
+        sampleOk = this->FastEvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr, threadId);
+      }
 
-    } // end if sampleOk
+      if (sampleOk)
+      {
+        ++numberOfPixelsCounted;
 
-  } // end for loop over the image sample container
+        /** Get the fixed image value. */
+        const RealType fixedImageValue = static_cast<RealType>(threader_fiter->m_ImageValue);
+
+        /** The difference squared. */
+        const RealType diff = movingImageValue - fixedImageValue;
+        measure += diff * diff;
+
+      } // end if sampleOk
+
+    } // end for loop over the image sample container
+  }
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -551,77 +571,82 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::ThreadedGetVal
    * InitializeThreadingParameters(), and at the end of each iteration in
    * AfterThreadedGetValueAndDerivative() and the accumulate functions.
    */
-  DerivativeType & derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
+  PerThreadDerivativeType & derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   const unsigned long         sampleContainerSize = sampleContainer->Size();
 
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  const auto pos_begin = std::min<size_t>(nrOfSamplesPerThreads * threadId, sampleContainerSize);
-  const auto pos_end = std::min<size_t>(nrOfSamplesPerThreads * (threadId + 1), sampleContainerSize);
-
   /** Create iterator over the sample container. */
   const auto beginOfSampleContainer = sampleContainer->cbegin();
-  const auto threader_fbegin = beginOfSampleContainer + pos_begin;
-  const auto threader_fend = beginOfSampleContainer + pos_end;
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
   MeasureType   measure{};
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for (auto threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = threader_fiter->m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImageDerivativeType   movingImageDerivative;
+    const auto threader_fbegin = beginOfSampleContainer + pos_begin;
+    const auto threader_fend = beginOfSampleContainer + pos_end;
 
-    /** Transform point. */
-    const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
-
-    /** Check if the point is inside the moving mask. */
-    bool sampleOk = this->IsInsideMovingMask(mappedPoint);
+    /** Transform all fixed image points of the chunk at once. */
+    const MovingImagePointType * const mappedPoints =
+      this->TransformPoints(*sampleContainer, pos_begin, pos_end, threadId);
 
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
-     */
-    if (sampleOk)
+    /** Loop over the fixed image to calculate the mean squares. */
+    for (auto threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
     {
-      sampleOk = this->FastEvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative, threadId);
-    }
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = threader_fiter->m_ImageCoordinates;
+      RealType                    movingImageValue;
+      MovingImageDerivativeType   movingImageDerivative;
 
-    if (sampleOk)
-    {
-      ++numberOfPixelsCounted;
+      /** Get the transformed point. */
+      const MovingImagePointType & mappedPoint = mappedPoints[threader_fiter - threader_fbegin];
 
-      /** Get the fixed image value. */
-      const RealType fixedImageValue = static_cast<RealType>(threader_fiter->m_ImageValue);
+      /** Check if the point is inside the moving mask. */
+      bool sampleOk = this->IsInsideMovingMask(mappedPoint);
+
+      /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+       * the point is inside the moving image buffer.
+       */
+      if (sampleOk)
+      {
+        sampleOk = this->FastEvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, &movingImageDerivative, threadId);
+      }
+
+      if (sampleOk)
+      {
+        ++numberOfPixelsCounted;
+
+        /** Get the fixed image value. */
+        const RealType fixedImageValue = static_cast<RealType>(threader_fiter->m_ImageValue);
 
 #if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        /** Get the TransformJacobian dT/dmu. */
+        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+        /** Compute the inner products (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(
+          jacobian, movingImageDerivative, imageJacobian );
 #else
-      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      Superclass::m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji);
+        /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+        Superclass::m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+          fixedPoint, movingImageDerivative, imageJacobian, nzji);
 #endif
 
-      /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(fixedImageValue, movingImageValue, imageJacobian, nzji, measure, derivative);
+        /** Compute this pixel's contribution to the measure and derivatives. */
+        this->UpdateValueAndDerivativeTerms(
+          fixedImageValue, movingImageValue, imageJacobian, nzji, measure, derivative);
 
-    } // end if sampleOk
+      } // end if sampleOk
 
-  } // end for loop over the image sample container
+    } // end for loop over the image sample container
+  }
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -674,11 +699,7 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AfterThreadedG
   // compute single-threadedly
   if (!Superclass::m_UseMultiThread && false) // force multi-threaded
   {
-    derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[0].st_Derivative * normal_sum;
-    for (ThreadIdType i = 1; i < numberOfThreads; ++i)
-    {
-      derivative += Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_Derivative * normal_sum;
-    }
+    this->SumPerThreadDerivatives(derivative, normal_sum);
   }
   // compute multi-threadedly with itk threads
   else if (true) // force ITK threads !Superclass::m_UseOpenMP )
@@ -686,9 +707,8 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AfterThreadedG
     Superclass::m_ThreaderMetricParameters.st_DerivativePointer = derivative.begin();
     Superclass::m_ThreaderMetricParameters.st_NormalizationFactor = 1.0 / normal_sum;
 
-    this->m_Threader->SetSingleMethod(this->AccumulateDerivativesThreaderCallback,
-                                      &(Superclass::m_ThreaderMetricParameters));
-    this->m_Threader->SingleMethodExecute();
+    this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                                 &(Superclass::m_ThreaderMetricParameters));
   }
 #ifdef ELASTIX_USE_OPENMP
   // compute multi-threadedly with openmp
@@ -717,6 +737,7 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AfterThreadedG
  */
 
 template <class TFixedImage, class TMovingImage>
+template <typename TDerivative>
 void
 AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::UpdateValueAndDerivativeTerms(
   const RealType                     fixedImageValue,
@@ -724,7 +745,7 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::UpdateValueAnd
   const DerivativeType &             imageJacobian,
   const NonZeroJacobianIndicesType & nzji,
   MeasureType &                      measure,
-  DerivativeType &                   deriv) const
+  TDerivative &                      deriv) const
 {
   /** The difference squared. */
   const RealType diff = movingImageValue - fixedImageValue;
@@ -739,7 +760,7 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::UpdateValueAnd
   {
     /** Loop over all Jacobians. */
     typename DerivativeType::const_iterator imjacit = imageJacobian.begin();
-    typename DerivativeType::iterator       derivit = deriv.begin();
+    typename TDerivative::iterator          derivit = deriv.begin();
     for (unsigned int mu = 0; mu < numberOfParameters; ++mu)
     {
       (*derivit) += diff_2 * (*imjacit);
@@ -180,6 +180,13 @@ protected:
 
   using Superclass::PrintSelf;
 
+  /** Evaluation contexts are supported by this metric. */
+  bool
+  EvaluationContextsSupported() const override
+  {
+    return true;
+  }
+
   /** Protected Typedefs ******************/
 
   /** Typedefs inherited from superclass */
@@ -94,6 +94,7 @@ public:
   using typename Superclass::MeasureType;
   using typename Superclass::DerivativeType;
   using typename Superclass::DerivativeValueType;
+  using typename Superclass::PerThreadDerivativeType;
   using typename Superclass::ParametersType;
   using typename Superclass::FixedImagePixelType;
   using typename Superclass::ImageSampleContainerType;
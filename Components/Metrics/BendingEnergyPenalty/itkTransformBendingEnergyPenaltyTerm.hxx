@@ -399,132 +399,132 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::ThreadedGetValueAnd
    * InitializeThreadingParameters(), and at the end of each iteration in
    * AfterThreadedGetValueAndDerivative() and the accumulate functions.
    */
-  DerivativeType & derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
+  PerThreadDerivativeType & derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   const unsigned long         sampleContainerSize = sampleContainer->Size();
 
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  const auto pos_begin = std::min<size_t>(nrOfSamplesPerThreads * threadId, sampleContainerSize);
-  const auto pos_end = std::min<size_t>(nrOfSamplesPerThreads * (threadId + 1), sampleContainerSize);
-
   /** Create iterator over the sample container. */
   const auto beginOfSampleContainer = sampleContainer->cbegin();
-  const auto fbegin = beginOfSampleContainer + pos_begin;
-  const auto fend = beginOfSampleContainer + pos_end;
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
   MeasureType   measure{};
 
-  /** Loop over the fixed image to calculate the penalty term and its derivative. */
-  for (auto fiter = fbegin; fiter != fend; ++fiter)
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = fiter->m_ImageCoordinates;
-
-    /** Although the mapped point is not needed to compute the penalty term,
-     * we compute in order to check if it maps inside the support region of
-     * the B-spline and if it maps inside the moving image mask.
-     */
-
-    /** Transform point. */
-    const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
+    const auto fbegin = beginOfSampleContainer + pos_begin;
+    const auto fend = beginOfSampleContainer + pos_end;
 
-    /** Check if the point is inside the moving mask. */
-    bool sampleOk = this->IsInsideMovingMask(mappedPoint);
-
-    if (sampleOk)
+    /** Loop over the fixed image to calculate the penalty term and its derivative. */
+    for (auto fiter = fbegin; fiter != fend; ++fiter)
     {
-      ++numberOfPixelsCounted;
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = fiter->m_ImageCoordinates;
 
-      /** Get the spatial Hessian of the transformation at the current point.
-       * This is needed to compute the bending energy.
+      /** Although the mapped point is not needed to compute the penalty term,
+       * we compute in order to check if it maps inside the support region of
+       * the B-spline and if it maps inside the moving image mask.
        */
-      Superclass::m_AdvancedTransform->GetJacobianOfSpatialHessian(
-        fixedPoint, spatialHessian, jacobianOfSpatialHessian, nonZeroJacobianIndices);
 
-      /** Prepare some stuff for the computation of the metric (derivative). */
-      FixedArray<InternalMatrixType, FixedImageDimension> A;
-      for (unsigned int k = 0; k < FixedImageDimension; ++k)
-      {
-        A[k] = spatialHessian[k].GetVnlMatrix();
-      }
+      /** Transform point. */
+      const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
 
-      /** Compute the contribution to the metric value of this point. */
-      for (unsigned int k = 0; k < FixedImageDimension; ++k)
-      {
-        measure += vnl_math::sqr(A[k].frobenius_norm());
-      }
+      /** Check if the point is inside the moving mask. */
+      bool sampleOk = this->IsInsideMovingMask(mappedPoint);
 
-      /** Make a distinction between a B-spline transform and other transforms. */
-      if (!transformIsBSpline)
+      if (sampleOk)
       {
-        /** Compute the contribution to the metric derivative of this point. */
-        for (unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu)
-        {
-          for (unsigned int k = 0; k < FixedImageDimension; ++k)
-          {
-            /** This computes:
-             * \sum_i \sum_j A_ij B_ij = element_product(A,B).mean()*B.size()
-             */
-            const InternalMatrixType & B = jacobianOfSpatialHessian[mu][k].GetVnlMatrix();
+        ++numberOfPixelsCounted;
 
-            RealType                                    matrixElementProduct = 0.0;
-            typename InternalMatrixType::const_iterator itA = A[k].begin();
-            typename InternalMatrixType::const_iterator itB = B.begin();
-            typename InternalMatrixType::const_iterator itAend = A[k].end();
-            while (itA != itAend)
-            {
-              matrixElementProduct += (*itA) * (*itB);
-              ++itA;
-              ++itB;
-            }
+        /** Get the spatial Hessian of the transformation at the current point.
+         * This is needed to compute the bending energy.
+         */
+        Superclass::m_AdvancedTransform->GetJacobianOfSpatialHessian(
+          fixedPoint, spatialHessian, jacobianOfSpatialHessian, nonZeroJacobianIndices);
 
-            derivative[nonZeroJacobianIndices[mu]] += 2.0 * matrixElementProduct;
-          }
+        /** Prepare some stuff for the computation of the metric (derivative). */
+        FixedArray<InternalMatrixType, FixedImageDimension> A;
+        for (unsigned int k = 0; k < FixedImageDimension; ++k)
+        {
+          A[k] = spatialHessian[k].GetVnlMatrix();
         }
-      }
-      else
-      {
-        /** For the B-spline transform we know that only 1/FixedImageDimension
-         * part of the JacobianOfSpatialHessian is non-zero.
-         *
-         * In addition we know that jsh[ mu + numParPerDim * k ][ k ] is the same for all k.
-         */
 
-        /** Compute the contribution to the metric derivative of this point. */
-        const unsigned int numParPerDim = nonZeroJacobianIndices.size() / FixedImageDimension;
-        for (unsigned int mu = 0; mu < numParPerDim; ++mu)
+        /** Compute the contribution to the metric value of this point. */
+        for (unsigned int k = 0; k < FixedImageDimension; ++k)
         {
-          const InternalMatrixType & B = jacobianOfSpatialHessian[mu + numParPerDim * 0][0].GetVnlMatrix();
+          measure += vnl_math::sqr(A[k].frobenius_norm());
+        }
 
-          for (unsigned int k = 0; k < FixedImageDimension; ++k)
+        /** Make a distinction between a B-spline transform and other transforms. */
+        if (!transformIsBSpline)
+        {
+          /** Compute the contribution to the metric derivative of this point. */
+          for (unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu)
           {
-            /** This computes:
-             * \sum_i \sum_j A_ij B_ij = element_product(A,B).mean()*B.size()
-             */
-            RealType                                    matrixElementProduct = 0.0;
-            typename InternalMatrixType::const_iterator itA = A[k].begin();
-            typename InternalMatrixType::const_iterator itB = B.begin();
-            typename InternalMatrixType::const_iterator itAend = A[k].end();
-            while (itA != itAend)
+            for (unsigned int k = 0; k < FixedImageDimension; ++k)
             {
-              matrixElementProduct += (*itA) * (*itB);
-              ++itA;
-              ++itB;
+              /** This computes:
+               * \sum_i \sum_j A_ij B_ij = element_product(A,B).mean()*B.size()
+               */
+              const InternalMatrixType & B = jacobianOfSpatialHessian[mu][k].GetVnlMatrix();
+
+              RealType                                    matrixElementProduct = 0.0;
+              typename InternalMatrixType::const_iterator itA = A[k].begin();
+              typename InternalMatrixType::const_iterator itB = B.begin();
+              typename InternalMatrixType::const_iterator itAend = A[k].end();
+              while (itA != itAend)
+              {
+                matrixElementProduct += (*itA) * (*itB);
+                ++itA;
+                ++itB;
+              }
+
+              derivative[nonZeroJacobianIndices[mu]] += 2.0 * matrixElementProduct;
             }
-
-            derivative[nonZeroJacobianIndices[mu + numParPerDim * k]] += 2.0 * matrixElementProduct;
           }
         }
-      } // end if B-spline
-    }   // end if sampleOk
-  }     // end for loop over the image sample container
+        else
+        {
+          /** For the B-spline transform we know that only 1/FixedImageDimension
+           * part of the JacobianOfSpatialHessian is non-zero.
+           *
+           * In addition we know that jsh[ mu + numParPerDim * k ][ k ] is the same for all k.
+           */
+
+          /** Compute the contribution to the metric derivative of this point. */
+          const unsigned int numParPerDim = nonZeroJacobianIndices.size() / FixedImageDimension;
+          for (unsigned int mu = 0; mu < numParPerDim; ++mu)
+          {
+            const InternalMatrixType & B = jacobianOfSpatialHessian[mu + numParPerDim * 0][0].GetVnlMatrix();
+
+            for (unsigned int k = 0; k < FixedImageDimension; ++k)
+            {
+              /** This computes:
+               * \sum_i \sum_j A_ij B_ij = element_product(A,B).mean()*B.size()
+               */
+              RealType                                    matrixElementProduct = 0.0;
+              typename InternalMatrixType::const_iterator itA = A[k].begin();
+              typename InternalMatrixType::const_iterator itB = B.begin();
+              typename InternalMatrixType::const_iterator itAend = A[k].end();
+              while (itA != itAend)
+              {
+                matrixElementProduct += (*itA) * (*itB);
+                ++itA;
+                ++itB;
+              }
+
+              derivative[nonZeroJacobianIndices[mu + numParPerDim * k]] += 2.0 * matrixElementProduct;
+            }
+          }
+        } // end if B-spline
+      }   // end if sampleOk
+    }     // end for loop over the image sample container
+  }
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -573,12 +573,7 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::AfterThreadedGetVal
   // compute single-threadedly
   if (!Superclass::m_UseMultiThread)
   {
-    derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[0].st_Derivative;
-    for (ThreadIdType i = 1; i < numberOfThreads; ++i)
-    {
-      derivative += Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_Derivative;
-    }
-    derivative /= static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
+    this->SumPerThreadDerivatives(derivative, 1.0 / static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted));
   }
   // compute multi-threadedly with itk threads
   else if (!Superclass::m_UseOpenMP || true) // force
@@ -587,9 +582,8 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::AfterThreadedGetVal
     Superclass::m_ThreaderMetricParameters.st_NormalizationFactor =
       static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
 
-    this->m_Threader->SetSingleMethod(this->AccumulateDerivativesThreaderCallback,
-                                      &(Superclass::m_ThreaderMetricParameters));
-    this->m_Threader->SingleMethodExecute();
+    this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                                 &(Superclass::m_ThreaderMetricParameters));
   }
 #ifdef ELASTIX_USE_OPENMP
   // compute multi-threadedly with openmp
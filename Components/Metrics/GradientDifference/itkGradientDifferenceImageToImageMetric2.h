@@ -39,10 +39,14 @@
 #include "itkNeighborhoodOperatorImageFilter.h"
 #include "itkPoint.h"
 #include "itkCastImageFilter.h"
-#include "itkResampleImageFilter.h"
+#include "itkAdvancedRayCastProjectionImageFilter.h"
 #include "itkOptimizer.h"
 #include "itkAdvancedCombinationTransform.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "elxRayCastProjectionPipeline.h"
+
+#include <memory> // For unique_ptr.
+#include <vector>
 
 namespace itk
 {
@@ -63,6 +67,10 @@ namespace itk
  * on it. Values at these non-grid position of the Fixed image are
  * interpolated using a user-selected Interpolator.
  *
+ * The derivative is estimated by central differences. The values at the test points are computed concurrently,
+ * by the threads of the elastix::WorkStealingThreadPool, each with its own projection of the moving image and its
+ * own Sobel filters. The gradients of the fixed image are computed only once, by Initialize().
+ *
  * Implementation of this class is based on:
  * Hipwell, J. H., et. al. (2003), "Intensity-Based 2-D-3D Registration of
  * Cerebral Angiograms,", IEEE Transactions on Medical Imaging,
@@ -122,7 +130,8 @@ public:
   using CombinationTransformType = typename itk::AdvancedCombinationTransform<ScalarType, FixedImageDimension>;
   using CombinationTransformPointer = typename CombinationTransformType::Pointer;
   using TransformedMovingImageType = itk::Image<FixedImagePixelType, Self::FixedImageDimension>;
-  using TransformMovingImageFilterType = itk::ResampleImageFilter<MovingImageType, TransformedMovingImageType>;
+  using TransformMovingImageFilterType =
+    itk::AdvancedRayCastProjectionImageFilter<MovingImageType, TransformedMovingImageType>;
   using RayCastInterpolatorType = typename itk::AdvancedRayCastInterpolateImageFunction<MovingImageType, ScalarType>;
   using RayCastInterpolatorPointer = typename RayCastInterpolatorType::Pointer;
   using FixedGradientImageType = itk::Image<RealType, Self::FixedImageDimension>;
@@ -133,6 +142,7 @@ public:
   using CastMovedImageFilterType = itk::CastImageFilter<TransformedMovingImageType, MovedGradientImageType>;
   using CastMovedImageFilterPointer = typename CastMovedImageFilterType::Pointer;
   using MovedGradientPixelType = typename MovedGradientImageType::PixelType;
+  using MovedGradientImagesType = FixedArray<const MovedGradientImageType *, Self::MovedImageDimension>;
 
   /** Get the derivatives of the match measure. */
   void
@@ -170,30 +180,52 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
-  /** Compute the range of the moved image gradients. */
+  /** Compute the range of the specified moved image gradients. Thread-safe. */
   void
-  ComputeMovedGradientRange() const;
+  ComputeMovedGradientRange(const MovedGradientImagesType & movedGradientImages,
+                            MovedGradientPixelType *        minimum,
+                            MovedGradientPixelType *        maximum) const;
 
   /** Compute the variance and range of the moving image gradients. */
   void
   ComputeVariance() const;
 
-  /** Compute the similarity measure using a specified subtraction factor. */
+  /** Compute the similarity measure of the specified moved image gradients, using a specified subtraction factor.
+   * Thread-safe. */
+  MeasureType
+  ComputeMeasure(const MovedGradientImagesType & movedGradientImages, const double * subtractionFactor) const;
+
+  /** Compute the value of the metric from the specified moved image gradients. Thread-safe. */
   MeasureType
-  ComputeMeasure(const TransformParametersType & parameters, const double * subtractionFactor) const;
+  ComputeValue(const MovedGradientImagesType & movedGradientImages) const;
 
   using FixedSobelFilter = NeighborhoodOperatorImageFilter<FixedGradientImageType, FixedGradientImageType>;
 
   using MovedSobelFilter = NeighborhoodOperatorImageFilter<MovedGradientImageType, MovedGradientImageType>;
 
 private:
+  using ProjectionPipelineType = elastix::RayCastProjectionPipeline<TransformMovingImageFilterType>;
+
+  /** The projection of the moving image and the computation of its gradients, for one thread of GetDerivative(). */
+  struct EvaluationPipeline
+  {
+    std::unique_ptr<ProjectionPipelineType>                  m_Projection{};
+    CastMovedImageFilterPointer                              m_CastMovedImageFilter{};
+    ZeroFluxNeumannBoundaryCondition<MovedGradientImageType> m_MovedBoundCond{};
+    typename MovedSobelFilter::Pointer                       m_MovedSobelFilters[MovedImageDimension]{};
+  };
+
+  /** Creates an evaluation pipeline. Returns null when the transform cannot be cloned. */
+  std::unique_ptr<EvaluationPipeline>
+  CreateEvaluationPipeline() const;
+
+  /** Computes the value at the specified parameters, using the specified evaluation pipeline. */
+  MeasureType
+  EvaluatePipeline(EvaluationPipeline & pipeline, const TransformParametersType & parameters) const;
+
   /** The variance of the moving image gradients. */
   mutable MovedGradientPixelType m_Variance[FixedImageDimension]{};
 
-  /** The range of the moving image gradients. */
-  mutable MovedGradientPixelType m_MinMovedGradient[MovedImageDimension]{};
-  mutable MovedGradientPixelType m_MaxMovedGradient[MovedImageDimension]{};
-
   /** The range of the fixed image gradients. */
   mutable FixedGradientPixelType m_MinFixedGradient[FixedImageDimension]{};
   mutable FixedGradientPixelType m_MaxFixedGradient[FixedImageDimension]{};
@@ -224,6 +256,9 @@ private:
   double                      m_DerivativeDelta{ 0.001 };
   double                      m_Rescalingfactor{ 1.0 };
   CombinationTransformPointer m_CombinationTransform{ CombinationTransformType::New() };
+
+  /** The evaluation pipelines of GetDerivative(), created when they are needed, and removed by Initialize(). */
+  mutable std::vector<std::unique_ptr<EvaluationPipeline>> m_EvaluationPipelines{};
 };
 
 } // end namespace itk
@@ -38,7 +38,9 @@
 #include "itkNumericTraits.h"
 #include "itkRescaleIntensityImageFilter.h"
 #include "itkImageFileWriter.h"
+#include "elxWorkStealingThreadPool.h"
 
+#include <algorithm> // For min.
 #include <iostream>
 #include <iomanip>
 #include <stdio.h>
@@ -59,6 +61,9 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::Initialize()
   /** Initialise the base class */
   Superclass::Initialize();
 
+  /** The evaluation pipelines are recreated for the current images and interpolator, when they are needed. */
+  this->m_EvaluationPipelines.clear();
+
   unsigned int iFilter;
 
   /** Compute the gradient of the fixed images */
@@ -90,7 +95,6 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::Initialize()
   }
   this->m_TransformMovingImageFilter->SetInterpolator(this->m_Interpolator);
   this->m_TransformMovingImageFilter->SetInput(this->m_MovingImage);
-  this->m_TransformMovingImageFilter->SetDefaultPixelValue(0);
   this->m_TransformMovingImageFilter->SetSize(this->m_FixedImage->GetLargestPossibleRegion().GetSize());
   this->m_TransformMovingImageFilter->SetOutputOrigin(this->m_FixedImage->GetOrigin());
   this->m_TransformMovingImageFilter->SetOutputSpacing(this->m_FixedImage->GetSpacing());
@@ -143,33 +147,36 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::PrintSelf(std::
 
 template <class TFixedImage, class TMovingImage>
 void
-GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeMovedGradientRange() const
+GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeMovedGradientRange(
+  const MovedGradientImagesType & movedGradientImages,
+  MovedGradientPixelType *        minimum,
+  MovedGradientPixelType *        maximum) const
 {
   unsigned int           iDimension;
   MovedGradientPixelType gradient;
 
   for (iDimension = 0; iDimension < FixedImageDimension; ++iDimension)
   {
-    ImageRegionConstIteratorWithIndex<MovedGradientImageType> iterate(m_MovedSobelFilters[iDimension]->GetOutput(),
+    ImageRegionConstIteratorWithIndex<MovedGradientImageType> iterate(movedGradientImages[iDimension],
                                                                       this->GetFixedImageRegion());
 
     gradient = iterate.Get();
 
-    m_MinMovedGradient[iDimension] = gradient;
-    m_MaxMovedGradient[iDimension] = gradient;
+    minimum[iDimension] = gradient;
+    maximum[iDimension] = gradient;
 
     while (!iterate.IsAtEnd())
     {
       gradient = iterate.Get();
 
-      if (gradient > m_MaxMovedGradient[iDimension])
+      if (gradient > maximum[iDimension])
       {
-        m_MaxMovedGradient[iDimension] = gradient;
+        maximum[iDimension] = gradient;
       }
 
-      if (gradient < m_MinMovedGradient[iDimension])
+      if (gradient < minimum[iDimension])
       {
-        m_MinMovedGradient[iDimension] = gradient;
+        minimum[iDimension] = gradient;
       }
 
       ++iterate;
@@ -200,9 +207,6 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeVariance
     gradient = iterate.Get();
     mean[iDimension] = 0;
 
-    this->m_MinMovedGradient[iDimension] = gradient;
-    this->m_MaxMovedGradient[iDimension] = gradient;
-
     typename FixedImageType::IndexType currentIndex;
     typename FixedImageType::PointType point;
     bool                               sampleOK = false;
@@ -304,29 +308,14 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeVariance
 template <class TFixedImage, class TMovingImage>
 auto
 GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeMeasure(
-  const TransformParametersType & parameters,
+  const MovedGradientImagesType & movedGradientImages,
   const double *                  subtractionFactor) const -> MeasureType
 {
-  /** Call non-thread-safe stuff, such as:
-   *   this->SetTransformParameters( parameters );
-   *   this->GetImageSampler()->Update();
-   * Because of these calls GetValueAndDerivative itself is not thread-safe,
-   * so cannot be called multiple times simultaneously.
-   * This is however needed in the CombinationImageToImageMetric.
-   * In that case, you need to:
-   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
-   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
-   *   calling GetValueAndDerivative
-   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
-   * - Now you can call GetValueAndDerivative multi-threaded.
+  /** The images are up-to-date: the fixed image gradients are computed by Initialize(), and the moved image
+   * gradients by the caller. The images are only read, so that this function can be called concurrently.
    */
-  this->BeforeThreadedGetValueAndDerivative(parameters);
-  // this->SetTransformParameters( parameters );
-
   unsigned int iDimension;
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
-  MeasureType measure{};
+  MeasureType  measure{};
 
   typename FixedImageType::IndexType currentIndex;
   typename FixedImageType::PointType point;
@@ -353,10 +342,7 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeMeasure(
 
     using MovedIteratorType = itk::ImageRegionConstIteratorWithIndex<MovedGradientImageType>;
 
-    MovedIteratorType movedIterator(this->m_MovedSobelFilters[iDimension]->GetOutput(), this->GetFixedImageRegion());
-
-    this->m_FixedSobelFilters[iDimension]->UpdateLargestPossibleRegion();
-    this->m_MovedSobelFilters[iDimension]->UpdateLargestPossibleRegion();
+    MovedIteratorType movedIterator(movedGradientImages[iDimension], this->GetFixedImageRegion());
 
     bool sampleOK = false;
 
@@ -405,6 +391,32 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeMeasure(
 } // end ComputeMeasure()
 
 
+/**
+ * ******************** ComputeValue ******************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeValue(
+  const MovedGradientImagesType & movedGradientImages) const -> MeasureType
+{
+  /** Compute the range of the moved image gradients */
+  MovedGradientPixelType minMovedGradient[MovedImageDimension];
+  MovedGradientPixelType maxMovedGradient[MovedImageDimension];
+  this->ComputeMovedGradientRange(movedGradientImages, minMovedGradient, maxMovedGradient);
+
+  MovedGradientPixelType subtractionFactor[FixedImageDimension];
+
+  for (unsigned int iDimension = 0; iDimension < FixedImageDimension; ++iDimension)
+  {
+    subtractionFactor[iDimension] = this->m_MaxFixedGradient[iDimension] / maxMovedGradient[iDimension];
+  }
+
+  return this->ComputeMeasure(movedGradientImages, subtractionFactor);
+
+} // end ComputeValue()
+
+
 /**
  * ******************** GetValue ******************************
  */
@@ -414,34 +426,96 @@ auto
 GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
   const TransformParametersType & parameters) const -> MeasureType
 {
-  unsigned int iFilter;
-  unsigned int iDimension;
   this->SetTransformParameters(parameters);
   this->m_TransformMovingImageFilter->Modified();
   this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
 
   /** Update the gradient images */
-  for (iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
+  MovedGradientImagesType movedGradientImages;
+  for (unsigned int iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
   {
     this->m_MovedSobelFilters[iFilter]->UpdateLargestPossibleRegion();
+    movedGradientImages[iFilter] = this->m_MovedSobelFilters[iFilter]->GetOutput();
   }
 
-  /** Compute the range of the moved image gradients */
-  this->ComputeMovedGradientRange();
+  return this->ComputeValue(movedGradientImages);
 
-  MovedGradientPixelType subtractionFactor[FixedImageDimension];
-  MeasureType            currentMeasure;
+} // end GetValue()
 
-  for (iDimension = 0; iDimension < FixedImageDimension; ++iDimension)
+
+/**
+ * ******************** CreateEvaluationPipeline ******************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::CreateEvaluationPipeline() const
+  -> std::unique_ptr<EvaluationPipeline>
+{
+  /** The pipeline gets a clone of the transform of the ray caster, which combines the transform of the metric with
+   * the pre-transform of the interpolator.
+   */
+  using AdvancedTransformType = typename Superclass::AdvancedTransformType;
+  auto * const rayCaster = dynamic_cast<RayCastInterpolatorType *>(this->m_Interpolator.GetPointer());
+  auto * const transform =
+    (rayCaster == nullptr) ? nullptr : dynamic_cast<AdvancedTransformType *>(rayCaster->GetModifiableTransform());
+  if (transform == nullptr)
   {
-    subtractionFactor[iDimension] = this->m_MaxFixedGradient[iDimension] / this->m_MaxMovedGradient[iDimension];
+    return nullptr;
   }
 
-  currentMeasure = this->ComputeMeasure(parameters, subtractionFactor);
+  const auto transformClone = Superclass::CloneTransform(*transform);
 
-  return currentMeasure;
+  auto projection = ProjectionPipelineType::Create(*this->m_TransformMovingImageFilter, transformClone.GetPointer());
+  if (projection == nullptr)
+  {
+    return nullptr;
+  }
 
-} // end GetValue()
+  /** Each pipeline runs in a single thread, as the pipelines themselves run concurrently. */
+  auto pipeline = std::make_unique<EvaluationPipeline>();
+  pipeline->m_Projection = std::move(projection);
+  pipeline->m_CastMovedImageFilter = CastMovedImageFilterType::New();
+  pipeline->m_CastMovedImageFilter->SetNumberOfWorkUnits(1);
+  pipeline->m_CastMovedImageFilter->SetInput(pipeline->m_Projection->GetOutput());
+
+  for (unsigned int iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
+  {
+    auto & movedSobelFilter = pipeline->m_MovedSobelFilters[iFilter];
+    movedSobelFilter = MovedSobelFilter::New();
+    movedSobelFilter->SetNumberOfWorkUnits(1);
+    movedSobelFilter->OverrideBoundaryCondition(&pipeline->m_MovedBoundCond);
+    movedSobelFilter->SetOperator(this->m_MovedSobelOperators[iFilter]);
+    movedSobelFilter->SetInput(pipeline->m_CastMovedImageFilter->GetOutput());
+  }
+
+  return pipeline;
+
+} // end CreateEvaluationPipeline()
+
+
+/**
+ * ******************** EvaluatePipeline ******************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::EvaluatePipeline(
+  EvaluationPipeline &            pipeline,
+  const TransformParametersType & parameters) const -> MeasureType
+{
+  pipeline.m_Projection->SetTransformParameters(parameters);
+
+  MovedGradientImagesType movedGradientImages;
+  for (unsigned int iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
+  {
+    pipeline.m_MovedSobelFilters[iFilter]->UpdateLargestPossibleRegion();
+    movedGradientImages[iFilter] = pipeline.m_MovedSobelFilters[iFilter]->GetOutput();
+  }
+
+  return this->ComputeValue(movedGradientImages);
+
+} // end EvaluatePipeline()
 
 
 /**
@@ -454,19 +528,70 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::GetDerivative(
   const TransformParametersType & parameters,
   DerivativeType &                derivative) const
 {
-  TransformParametersType testPoint;
-  testPoint = parameters;
   const unsigned int numberOfParameters = this->GetNumberOfParameters();
   derivative = DerivativeType(numberOfParameters);
 
+  /** Test point 2i is parameter i minus its step, test point 2i+1 is parameter i plus its step. */
+  std::vector<double>      steps(numberOfParameters);
+  std::vector<MeasureType> values(2 * numberOfParameters);
+  for (unsigned int i = 0; i < numberOfParameters; ++i)
+  {
+    steps[i] = this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]);
+  }
+
+  auto &             threadPool = elastix::WorkStealingThreadPool::GetInstance();
+  const unsigned int numberOfWorkUnits =
+    static_cast<unsigned int>(std::min<std::size_t>(threadPool.GetNumberOfThreads(), values.size()));
+
+  /** Create an evaluation pipeline for each work unit, unless the transform cannot be cloned. */
+  while (numberOfWorkUnits > 1 && this->m_EvaluationPipelines.size() < numberOfWorkUnits)
+  {
+    auto pipeline = this->CreateEvaluationPipeline();
+    if (pipeline == nullptr)
+    {
+      break;
+    }
+    this->m_EvaluationPipelines.push_back(std::move(pipeline));
+  }
+
+  if (numberOfWorkUnits > 1 && this->m_EvaluationPipelines.size() >= numberOfWorkUnits)
+  {
+    elastix::ChunkedRange testPoints;
+
+    threadPool.ForkJoin(numberOfWorkUnits, [&](unsigned int workUnit) {
+      EvaluationPipeline &    pipeline = *(this->m_EvaluationPipelines[workUnit]);
+      TransformParametersType testPoint = parameters;
+      std::size_t             testPointBegin{};
+      std::size_t             testPointEnd{};
+
+      while (testPoints.GetNextChunk(values.size(), numberOfWorkUnits, testPointBegin, testPointEnd))
+      {
+        for (std::size_t j = testPointBegin; j < testPointEnd; ++j)
+        {
+          const std::size_t i = j / 2;
+          testPoint[i] = parameters[i] + ((j % 2 == 0) ? -steps[i] : steps[i]);
+          values[j] = this->EvaluatePipeline(pipeline, testPoint);
+          testPoint[i] = parameters[i];
+        }
+      }
+    });
+  }
+  else
+  {
+    TransformParametersType testPoint = parameters;
+
+    for (std::size_t j = 0; j < values.size(); ++j)
+    {
+      const std::size_t i = j / 2;
+      testPoint[i] = parameters[i] + ((j % 2 == 0) ? -steps[i] : steps[i]);
+      values[j] = this->GetValue(testPoint);
+      testPoint[i] = parameters[i];
+    }
+  }
+
   for (unsigned int i = 0; i < numberOfParameters; ++i)
   {
-    testPoint[i] -= this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]);
-    const MeasureType valuep0 = this->GetValue(testPoint);
-    testPoint[i] += 2 * this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]);
-    const MeasureType valuep1 = this->GetValue(testPoint);
-    derivative[i] = (valuep1 - valuep0) / (2 * this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]));
-    testPoint[i] = parameters[i];
+    derivative[i] = (values[2 * i + 1] - values[2 * i]) / (2 * steps[i]);
   }
 
 } // end GetDerivative()
@@ -23,6 +23,8 @@
 #include "itkObjectFactory.h"
 #include "ANN/ANN.h"
 
+#include <mutex>
+
 namespace itk
 {
 
@@ -66,6 +68,7 @@ public:
    * of any sort exist, we can call annClose(). This little
    * function is cause of going through the trouble of creating
    * this class with static creating functions.
+   * The functions may be called concurrently, for different trees.
    */
 
   /** Static function to create an ANN kDTree. */
@@ -106,8 +109,11 @@ protected:
   ~ANNBinaryTreeCreator() override = default;
 
 private:
-  /** Member variables. */
+  /** Member variables. The mutex guards the reference count, and makes the
+   * final decrease and the call to annClose() a single step.
+   */
   static unsigned int m_NumberOfANNBinaryTrees;
+  static std::mutex   m_ReferenceCountMutex;
 };
 
 } // end namespace itk
@@ -128,6 +128,32 @@ ANNPriorityTreeSearch<TBinaryTree>::Search(const MeasurementVectorType & qp,
 } // end Search
 
 
+/**
+ * ************************ SearchBatch *************************
+ */
+
+template <class TBinaryTree>
+void
+ANNPriorityTreeSearch<TBinaryTree>::SearchBatch(const ListSampleType * querySample,
+                                                InstanceIdentifier     first,
+                                                InstanceIdentifier     last,
+                                                IndexMatrixType &      ind,
+                                                DistanceMatrixType &   dists)
+{
+  /** Get k and eps. */
+  const int    k = static_cast<int>(this->m_KNearestNeighbors);
+  const double eps = this->m_ErrorBound;
+
+  /** The rows of the list sample are ANN points already. */
+  const auto queryPoints = querySample->GetInternalContainer();
+  for (InstanceIdentifier i = first; i < last; ++i)
+  {
+    this->m_BinaryTreeAskDTree->annkPriSearch(queryPoints[i], k, ind[i - first], dists[i - first], eps);
+  }
+
+} // end SearchBatch
+
+
 } // end namespace itk
 
 #endif // end #ifndef itkANNPriorityTreeSearch_hxx
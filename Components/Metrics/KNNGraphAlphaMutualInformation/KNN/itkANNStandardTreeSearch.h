@@ -56,6 +56,9 @@ public:
   using typename Superclass::MeasurementVectorType;
   using typename Superclass::IndexArrayType;
   using typename Superclass::DistanceArrayType;
+  using typename Superclass::InstanceIdentifier;
+  using typename Superclass::IndexMatrixType;
+  using typename Superclass::DistanceMatrixType;
 
   using typename Superclass::ANNPointType;         // double *
   using typename Superclass::ANNIndexType;         // int
@@ -73,6 +76,23 @@ public:
   void
   Search(const MeasurementVectorType & qp, IndexArrayType & ind, DistanceArrayType & dists) override;
 
+  /** Search the nearest neighbours of the query points [first, last) of a list sample.
+   * The query points are passed to ANN directly, without copying or allocating them.
+   */
+  void
+  SearchBatch(const ListSampleType * querySample,
+              InstanceIdentifier     first,
+              InstanceIdentifier     last,
+              IndexMatrixType &      ind,
+              DistanceMatrixType &   dists) override;
+
+  /** The ANN search state is thread-local, so batches may be searched concurrently. */
+  bool
+  GetSearchBatchIsThreadSafe() const override
+  {
+    return true;
+  }
+
 protected:
   ANNStandardTreeSearch();
   ~ANNStandardTreeSearch() override = default;
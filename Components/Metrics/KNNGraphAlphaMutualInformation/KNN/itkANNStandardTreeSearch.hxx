@@ -82,6 +82,32 @@ ANNStandardTreeSearch<TBinaryTree>::Search(const MeasurementVectorType & qp,
 } // end Search
 
 
+/**
+ * ************************ SearchBatch *************************
+ */
+
+template <class TBinaryTree>
+void
+ANNStandardTreeSearch<TBinaryTree>::SearchBatch(const ListSampleType * querySample,
+                                                InstanceIdentifier     first,
+                                                InstanceIdentifier     last,
+                                                IndexMatrixType &      ind,
+                                                DistanceMatrixType &   dists)
+{
+  /** Get k and eps. */
+  const int    k = static_cast<int>(this->m_KNearestNeighbors);
+  const double eps = this->m_ErrorBound;
+
+  /** The rows of the list sample are ANN points already. */
+  const auto queryPoints = querySample->GetInternalContainer();
+  for (InstanceIdentifier i = first; i < last; ++i)
+  {
+    this->m_BinaryTreeAsITKANNType->GetANNTree()->annkSearch(queryPoints[i], k, ind[i - first], dists[i - first], eps);
+  }
+
+} // end SearchBatch
+
+
 } // end namespace itk
 
 #endif // end #ifndef itkANNStandardTreeSearch_hxx
@@ -56,6 +56,9 @@ public:
   using typename Superclass::MeasurementVectorType;
   using typename Superclass::IndexArrayType;
   using typename Superclass::DistanceArrayType;
+  using typename Superclass::InstanceIdentifier;
+  using typename Superclass::IndexMatrixType;
+  using typename Superclass::DistanceMatrixType;
 
   /** Typedefs from ANN. */
   using ANNPointType = ANNpoint;             // double *
@@ -20,6 +20,7 @@
 
 #include "itkObject.h"
 #include "itkArray.h"
+#include "itkArray2D.h"
 
 #include "itkBinaryTreeBase.h"
 
@@ -57,6 +58,9 @@ public:
   using MeasurementVectorType = typename BinaryTreeType::MeasurementVectorType;
   using IndexArrayType = Array<int>;
   using DistanceArrayType = Array<double>;
+  using InstanceIdentifier = typename ListSampleType::InstanceIdentifier;
+  using IndexMatrixType = Array2D<int>;
+  using DistanceMatrixType = Array2D<double>;
 
   /** Set and get the binary tree. */
   virtual void
@@ -73,6 +77,25 @@ public:
   virtual void
   Search(const MeasurementVectorType & qp, IndexArrayType & ind, DistanceArrayType & dists) = 0;
 
+  /** Search the nearest neighbours of the query points [first, last) of a list sample.
+   * Row i - first of ind and dists receives the neighbours of query point i. Both matrices
+   * must have at least last - first rows and k columns; they are not resized. The default
+   * implementation calls Search() for each query point.
+   */
+  virtual void
+  SearchBatch(const ListSampleType * querySample,
+              InstanceIdentifier     first,
+              InstanceIdentifier     last,
+              IndexMatrixType &      ind,
+              DistanceMatrixType &   dists);
+
+  /** Returns whether SearchBatch() may be called concurrently, for disjoint rows of the matrices. */
+  virtual bool
+  GetSearchBatchIsThreadSafe() const
+  {
+    return false;
+  }
+
 protected:
   BinaryTreeSearchBase();
   ~BinaryTreeSearchBase() override = default;
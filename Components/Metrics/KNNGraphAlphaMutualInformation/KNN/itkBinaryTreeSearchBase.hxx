@@ -66,6 +66,33 @@ BinaryTreeSearchBase<TBinaryTree>::GetBinaryTree() const -> const BinaryTreeType
   return this->m_BinaryTree.GetPointer();
 } // end GetBinaryTree
 
+
+/**
+ * ************************ SearchBatch *************************
+ */
+
+template <class TBinaryTree>
+void
+BinaryTreeSearchBase<TBinaryTree>::SearchBatch(const ListSampleType * querySample,
+                                               InstanceIdentifier     first,
+                                               InstanceIdentifier     last,
+                                               IndexMatrixType &      ind,
+                                               DistanceMatrixType &   dists)
+{
+  IndexArrayType    indices;
+  DistanceArrayType distances;
+  for (InstanceIdentifier i = first; i < last; ++i)
+  {
+    this->Search(querySample->GetMeasurementVector(i), indices, distances);
+    for (unsigned int p = 0; p < this->m_KNearestNeighbors; ++p)
+    {
+      ind[i - first][p] = indices[p];
+      dists[i - first][p] = distances[p];
+    }
+  }
+
+} // end SearchBatch
+
 } // end namespace itk
 
 #endif // end #ifndef itkBinaryTreeSearchBase_hxx
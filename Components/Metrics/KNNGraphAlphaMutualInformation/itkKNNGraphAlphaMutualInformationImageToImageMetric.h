@@ -61,6 +61,10 @@ namespace itk
  * features, it would be better (but slower) to first apply the transform
  * on the image and then recalculate the feature.
  *
+ * When multi-threading is on (see SetUseMultiThread), the three trees are
+ * generated concurrently, and the query points are distributed over the
+ * threads, which search their neighbours in batches.
+ *
  * All the technical details can be found in:\n
  * M. Staring, U.A. van der Heide, S. Klein, M.A. Viergever and J.P.W. Pluim,
  * "Registration of Cervical MRI Using Multifeature Mutual Information,"
@@ -163,6 +167,8 @@ public:
 
   using IndexArrayType = typename BinaryKNNTreeSearchType::IndexArrayType;
   using DistanceArrayType = typename BinaryKNNTreeSearchType::DistanceArrayType;
+  using IndexMatrixType = typename BinaryKNNTreeSearchType::IndexMatrixType;
+  using DistanceMatrixType = typename BinaryKNNTreeSearchType::DistanceMatrixType;
 
   using typename Superclass::DerivativeValueType;
   using TransformJacobianValueType = typename TransformJacobianType::ValueType;
@@ -286,6 +292,10 @@ private:
   using TransformJacobianIndicesContainerType = std::vector<NonZeroJacobianIndicesType>;
   using SpatialDerivativeType = vnl_matrix<double>;
   using SpatialDerivativeContainerType = std::vector<SpatialDerivativeType>;
+  using AccumulateType = typename NumericTraits<MeasureType>::AccumulateType;
+
+  /** The number of query points whose neighbours are searched in one batch. */
+  static constexpr unsigned long SearchBatchSize{ 256 };
 
   /** This function takes the fixed image samples from the ImageSampler
    * and puts them in the listSampleFixed, together with the fixed feature
@@ -335,6 +345,45 @@ private:
                            const MeasureType &                distance_J,
                            DerivativeType &                   dGamma_M,
                            DerivativeType &                   dGamma_J) const;
+
+  /** Generates the three trees from the list samples, and connects them to
+   * the searchers. The three trees are generated concurrently.
+   */
+  void
+  GenerateTreesAndConnectSearchers() const;
+
+  /** Returns the number of work units over which the query points are distributed.
+   * This is one, when multi-threading is off, or when a searcher does not support
+   * concurrent searches.
+   */
+  unsigned int
+  GetNumberOfSearchWorkUnits() const;
+
+  /** Adds the contributions of the query points of one work unit to sumG,
+   * see GetValue().
+   */
+  void
+  ThreadedComputeValue(const unsigned int workUnit, const unsigned int numberOfWorkUnits, AccumulateType & sumG) const;
+
+  /** Adds the contributions of the query points of one work unit to sumG
+   * and to the derivative, see GetValueAndDerivative().
+   */
+  void
+  ThreadedComputeValueAndDerivative(const unsigned int workUnit,
+                                    const unsigned int numberOfWorkUnits,
+                                    AccumulateType &   sumG,
+                                    DerivativeType &   contribution) const;
+
+  /** The list samples, and the per sample ingredients of the derivative. They are
+   * kept across the iterations, so that their memory is only reallocated when the
+   * number of samples changes.
+   */
+  mutable ListSamplePointer                     m_ListSampleFixed{ ListSampleType::New() };
+  mutable ListSamplePointer                     m_ListSampleMoving{ ListSampleType::New() };
+  mutable ListSamplePointer                     m_ListSampleJoint{ ListSampleType::New() };
+  mutable TransformJacobianContainerType        m_JacobianContainer{};
+  mutable TransformJacobianIndicesContainerType m_JacobianIndicesContainer{};
+  mutable SpatialDerivativeContainerType        m_SpatialDerivativesContainer{};
 };
 
 } // end namespace itk
@@ -20,6 +20,11 @@
 
 #include "itkKNNGraphAlphaMutualInformationImageToImageMetric.h"
 
+#include <algorithm> // For min and max.
+#include <array>
+#include <utility> // For move.
+#include <vector>
+
 namespace itk
 {
 
@@ -285,25 +290,17 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
   this->SetTransformParameters(parameters);
 
   /**
-   * *************** Create the three list samples ******************
+   * *************** Compute the three list samples ******************
    */
 
-  /** Create list samples. */
-  ListSamplePointer listSampleFixed = ListSampleType::New();
-  ListSamplePointer listSampleMoving = ListSampleType::New();
-  ListSamplePointer listSampleJoint = ListSampleType::New();
-
-  /** Compute the three list samples. */
-  TransformJacobianContainerType        dummyJacobianContainer;
-  TransformJacobianIndicesContainerType dummyJacobianIndicesContainer;
-  SpatialDerivativeContainerType        dummySpatialDerivativesContainer;
-  this->ComputeListSampleValuesAndDerivativePlusJacobian(listSampleFixed,
-                                                         listSampleMoving,
-                                                         listSampleJoint,
+  /** Compute the three list samples, reusing their memory of the previous call. */
+  this->ComputeListSampleValuesAndDerivativePlusJacobian(this->m_ListSampleFixed,
+                                                         this->m_ListSampleMoving,
+                                                         this->m_ListSampleJoint,
                                                          false,
-                                                         dummyJacobianContainer,
-                                                         dummyJacobianIndicesContainer,
-                                                         dummySpatialDerivativesContainer);
+                                                         this->m_JacobianContainer,
+                                                         this->m_JacobianIndicesContainer,
+                                                         this->m_SpatialDerivativesContainer);
 
   /** Check if enough samples were valid. */
   unsigned long size = this->GetImageSampler()->GetOutput()->Size();
@@ -315,22 +312,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample(listSampleFixed);
-  this->m_BinaryKNNTreeFixed->GenerateTree();
-
-  /** Generate the tree for the moving image samples. */
-  this->m_BinaryKNNTreeMoving->SetSample(listSampleMoving);
-  this->m_BinaryKNNTreeMoving->GenerateTree();
-
-  /** Generate the tree for the joint image samples. */
-  this->m_BinaryKNNTreeJoint->SetSample(listSampleJoint);
-  this->m_BinaryKNNTreeJoint->GenerateTree();
-
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed->SetBinaryTree(this->m_BinaryKNNTreeFixed);
-  this->m_BinaryKNNTreeSearcherMoving->SetBinaryTree(this->m_BinaryKNNTreeMoving);
-  this->m_BinaryKNNTreeSearcherJoint->SetBinaryTree(this->m_BinaryKNNTreeJoint);
+  this->GenerateTreesAndConnectSearchers();
 
   /**
    * *************** Estimate the \alpha MI ******************
@@ -365,77 +347,20 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
-  /** Temporary variables. */
-  using AccumulateType = typename NumericTraits<MeasureType>::AccumulateType;
-  MeasurementVectorType z_F, z_M, z_J;
-  IndexArrayType        indices_F, indices_M, indices_J;
-  DistanceArrayType     distances_F, distances_M, distances_J;
+  /** Distribute the query points over the work units. Each work unit sums its own contributions. */
+  const unsigned int          numberOfWorkUnits = this->GetNumberOfSearchWorkUnits();
+  std::vector<AccumulateType> sumGPerWorkUnit(numberOfWorkUnits);
+  elastix::WorkStealingThreadPool::GetInstance().ForkJoin(
+    numberOfWorkUnits, [this, numberOfWorkUnits, &sumGPerWorkUnit](const unsigned int workUnit) {
+      this->ThreadedComputeValue(workUnit, numberOfWorkUnits, sumGPerWorkUnit[workUnit]);
+    });
 
-  MeasureType    H, G;
+  /** Add the contributions in the order of the work units, so that the sum does not depend on the scheduling. */
   AccumulateType sumG{};
-
-  /** Get the size of the feature vectors. */
-  unsigned int fixedSize = this->GetNumberOfFixedImages();
-  unsigned int movingSize = this->GetNumberOfMovingImages();
-  unsigned int jointSize = fixedSize + movingSize;
-
-  /** Get the number of neighbours and \gamma. */
-  unsigned int k = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
-  double       twoGamma = jointSize * (1.0 - this->m_Alpha);
-
-  /** Loop over all query points, i.e. all samples. */
-  for (unsigned long i = 0; i < this->m_NumberOfPixelsCounted; ++i)
+  for (const AccumulateType sumGOfWorkUnit : sumGPerWorkUnit)
   {
-    /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(i, z_F);
-    listSampleMoving->GetMeasurementVector(i, z_M);
-    listSampleJoint->GetMeasurementVector(i, z_J);
-
-    /** Search for the K nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(z_F, indices_F, distances_F);
-    this->m_BinaryKNNTreeSearcherMoving->Search(z_M, indices_M, distances_M);
-    this->m_BinaryKNNTreeSearcherJoint->Search(z_J, indices_J, distances_J);
-
-    /** Add the distances between the points to get the total graph length.
-     * The outcommented implementation calculates: sum J/sqrt(F*M)
-     *
-    for ( unsigned int j = 0; j < K; j++ )
-    {
-    enumerator = std::sqrt( distsJ[ j ] );
-    denominator = std::sqrt( std::sqrt( distsF[ j ] ) * std::sqrt( distsM[ j ] ) );
-    if ( denominator > 1e-14 )
-    {
-    contribution += std::pow( enumerator / denominator, twoGamma );
-    }
-    }*/
-
-    /** Add the distances of all neighbours of the query point,
-     * for the three graphs:
-     * sum M / sqrt( sum F * sum M)
-     */
-
-    /** Variables to compute the measure. */
-    AccumulateType Gamma_F{};
-    AccumulateType Gamma_M{};
-    AccumulateType Gamma_J{};
-
-    /** Loop over the neighbours. */
-    for (unsigned int p = 0; p < k; ++p)
-    {
-      Gamma_F += std::sqrt(distances_F[p]);
-      Gamma_M += std::sqrt(distances_M[p]);
-      Gamma_J += std::sqrt(distances_J[p]);
-    } // end loop over the k neighbours
-
-    /** Calculate the contribution of this query point. */
-    H = std::sqrt(Gamma_F * Gamma_M);
-    if (H > this->m_AvoidDivisionBy)
-    {
-      /** Compute some sums. */
-      G = Gamma_J / H;
-      sumG += std::pow(G, twoGamma);
-    }
-  } // end looping over all query points
+    sumG += sumGOfWorkUnit;
+  }
 
   /**
    * *************** Finally, calculate the metric value \alpha MI ******************
@@ -509,25 +434,17 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
   this->BeforeThreadedGetValueAndDerivative(parameters);
 
   /**
-   * *************** Create the three list samples ******************
+   * *************** Compute the three list samples ******************
    */
 
-  /** Create list samples. */
-  ListSamplePointer listSampleFixed = ListSampleType::New();
-  ListSamplePointer listSampleMoving = ListSampleType::New();
-  ListSamplePointer listSampleJoint = ListSampleType::New();
-
-  /** Compute the three list samples and the derivatives. */
-  TransformJacobianContainerType        jacobianContainer;
-  TransformJacobianIndicesContainerType jacobianIndicesContainer;
-  SpatialDerivativeContainerType        spatialDerivativesContainer;
-  this->ComputeListSampleValuesAndDerivativePlusJacobian(listSampleFixed,
-                                                         listSampleMoving,
-                                                         listSampleJoint,
+  /** Compute the three list samples and the derivatives, reusing their memory of the previous call. */
+  this->ComputeListSampleValuesAndDerivativePlusJacobian(this->m_ListSampleFixed,
+                                                         this->m_ListSampleMoving,
+                                                         this->m_ListSampleJoint,
                                                          true,
-                                                         jacobianContainer,
-                                                         jacobianIndicesContainer,
-                                                         spatialDerivativesContainer);
+                                                         this->m_JacobianContainer,
+                                                         this->m_JacobianIndicesContainer,
+                                                         this->m_SpatialDerivativesContainer);
 
   /** Check if enough samples were valid. */
   unsigned long size = this->GetImageSampler()->GetOutput()->Size();
@@ -539,22 +456,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample(listSampleFixed);
-  this->m_BinaryKNNTreeFixed->GenerateTree();
-
-  /** Generate the tree for the moving image samples. */
-  this->m_BinaryKNNTreeMoving->SetSample(listSampleMoving);
-  this->m_BinaryKNNTreeMoving->GenerateTree();
-
-  /** Generate the tree for the joint image samples. */
-  this->m_BinaryKNNTreeJoint->SetSample(listSampleJoint);
-  this->m_BinaryKNNTreeJoint->GenerateTree();
-
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed->SetBinaryTree(this->m_BinaryKNNTreeFixed);
-  this->m_BinaryKNNTreeSearcherMoving->SetBinaryTree(this->m_BinaryKNNTreeMoving);
-  this->m_BinaryKNNTreeSearcherJoint->SetBinaryTree(this->m_BinaryKNNTreeJoint);
+  this->GenerateTreesAndConnectSearchers();
 
   /**
    * *************** Estimate the \alpha MI and its derivatives ******************
@@ -589,109 +491,28 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
-  /** Temporary variables. */
-  using AccumulateType = typename NumericTraits<MeasureType>::AccumulateType;
-  MeasurementVectorType z_F, z_M, z_J, z_M_ip, z_J_ip, diff_M, diff_J;
-  IndexArrayType        indices_F, indices_M, indices_J;
-  DistanceArrayType     distances_F, distances_M, distances_J;
-  MeasureType           distance_F, distance_M, distance_J;
-
-  MeasureType    H, G, Gpow;
-  AccumulateType sumG{};
-
-  DerivativeType contribution(this->GetNumberOfParameters());
-  contribution.Fill(DerivativeValueType{});
-  DerivativeType dGamma_M(this->GetNumberOfParameters());
-  DerivativeType dGamma_J(this->GetNumberOfParameters());
-
-  /** Get the size of the feature vectors. */
-  unsigned int fixedSize = this->GetNumberOfFixedImages();
-  unsigned int movingSize = this->GetNumberOfMovingImages();
-  unsigned int jointSize = fixedSize + movingSize;
-
-  /** Get the number of neighbours and \gamma. */
-  unsigned int k = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
-  double       twoGamma = jointSize * (1.0 - this->m_Alpha);
-
-  /** Loop over all query points, i.e. all samples. */
-  for (unsigned long i = 0; i < this->m_NumberOfPixelsCounted; ++i)
+  /** Distribute the query points over the work units. Each work unit sums its own contributions. */
+  const unsigned int          numberOfWorkUnits = this->GetNumberOfSearchWorkUnits();
+  std::vector<AccumulateType> sumGPerWorkUnit(numberOfWorkUnits);
+  std::vector<DerivativeType> contributionPerWorkUnit(numberOfWorkUnits);
+  elastix::WorkStealingThreadPool::GetInstance().ForkJoin(
+    numberOfWorkUnits,
+    [this, numberOfWorkUnits, &sumGPerWorkUnit, &contributionPerWorkUnit](const unsigned int workUnit) {
+      this->ThreadedComputeValueAndDerivative(
+        workUnit, numberOfWorkUnits, sumGPerWorkUnit[workUnit], contributionPerWorkUnit[workUnit]);
+    });
+
+  /** Add the contributions in the order of the work units, so that the sums do not depend on the scheduling. */
+  AccumulateType sumG = sumGPerWorkUnit[0];
+  DerivativeType contribution = std::move(contributionPerWorkUnit[0]);
+  for (unsigned int workUnit = 1; workUnit < numberOfWorkUnits; ++workUnit)
   {
-    /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(i, z_F);
-    listSampleMoving->GetMeasurementVector(i, z_M);
-    listSampleJoint->GetMeasurementVector(i, z_J);
-
-    /** Search for the k nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(z_F, indices_F, distances_F);
-    this->m_BinaryKNNTreeSearcherMoving->Search(z_M, indices_M, distances_M);
-    this->m_BinaryKNNTreeSearcherJoint->Search(z_J, indices_J, distances_J);
-
-    /** Variables to compute the measure and its derivative. */
-    AccumulateType Gamma_F{};
-    AccumulateType Gamma_M{};
-    AccumulateType Gamma_J{};
-
-    SpatialDerivativeType D1sparse, D2sparse_M, D2sparse_J;
-    D1sparse = spatialDerivativesContainer[i] * jacobianContainer[i];
-
-    dGamma_M.Fill(DerivativeValueType{});
-    dGamma_J.Fill(DerivativeValueType{});
-
-    /** Loop over the neighbours. */
-    for (unsigned int p = 0; p < k; ++p)
-    {
-      /** Get the neighbour point z_ip^M. */
-      listSampleMoving->GetMeasurementVector(indices_M[p], z_M_ip);
-      listSampleMoving->GetMeasurementVector(indices_J[p], z_J_ip);
-
-      /** Get the distances. */
-      distance_F = std::sqrt(distances_F[p]);
-      distance_M = std::sqrt(distances_M[p]);
-      distance_J = std::sqrt(distances_J[p]);
-
-      /** Compute Gamma's. */
-      Gamma_F += distance_F;
-      Gamma_M += distance_M;
-      Gamma_J += distance_J;
-
-      /** Get the difference of z_ip^M with z_i^M. */
-      diff_M = z_M - z_M_ip;
-      diff_J = z_M - z_J_ip;
-
-      /** Compute derivatives. */
-      D2sparse_M = spatialDerivativesContainer[indices_M[p]] * jacobianContainer[indices_M[p]];
-      D2sparse_J = spatialDerivativesContainer[indices_J[p]] * jacobianContainer[indices_J[p]];
-
-      /** Update the dGamma's. */
-      this->UpdateDerivativeOfGammas(D1sparse,
-                                     D2sparse_M,
-                                     D2sparse_J,
-                                     jacobianIndicesContainer[i],
-                                     jacobianIndicesContainer[indices_M[p]],
-                                     jacobianIndicesContainer[indices_J[p]],
-                                     diff_M,
-                                     diff_J,
-                                     distance_M,
-                                     distance_J,
-                                     dGamma_M,
-                                     dGamma_J);
-
-    } // end loop over the k neighbours
-
-    /** Compute contributions. */
-    H = std::sqrt(Gamma_F * Gamma_M);
-    if (H > this->m_AvoidDivisionBy)
-    {
-      /** Compute some sums. */
-      G = Gamma_J / H;
-      sumG += std::pow(G, twoGamma);
-
-      /** Compute the contribution to the derivative. */
-      Gpow = std::pow(G, twoGamma - 1.0);
-      contribution += (Gpow / H) * (dGamma_J - (0.5 * Gamma_J / Gamma_M) * dGamma_M);
-    }
+    sumG += sumGPerWorkUnit[workUnit];
+    contribution += contributionPerWorkUnit[workUnit];
+  }
 
-  } // end looping over all query points
+  /** Get the size of the feature vectors. */
+  const unsigned int jointSize = this->GetNumberOfFixedImages() + this->GetNumberOfMovingImages();
 
   /**
    * *************** Finally, calculate the metric value and derivative ******************
@@ -714,6 +535,289 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
 } // end GetValueAndDerivative()
 
 
+/**
+ * ************************ GenerateTreesAndConnectSearchers *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::GenerateTreesAndConnectSearchers() const
+{
+  /** Set the samples of the three trees. */
+  this->m_BinaryKNNTreeFixed->SetSample(this->m_ListSampleFixed);
+  this->m_BinaryKNNTreeMoving->SetSample(this->m_ListSampleMoving);
+  this->m_BinaryKNNTreeJoint->SetSample(this->m_ListSampleJoint);
+
+  /** Generate the three trees. The trees are independent, so they are
+   * generated concurrently, when multi-threading is on.
+   */
+  const std::array<BinaryKNNTreeType *, 3> trees{ { this->m_BinaryKNNTreeFixed.GetPointer(),
+                                                    this->m_BinaryKNNTreeMoving.GetPointer(),
+                                                    this->m_BinaryKNNTreeJoint.GetPointer() } };
+  if (this->m_UseMultiThread)
+  {
+    elastix::WorkStealingThreadPool::GetInstance().ForkJoin(
+      static_cast<unsigned int>(trees.size()),
+      [&trees](const unsigned int treeIndex) { trees[treeIndex]->GenerateTree(); });
+  }
+  else
+  {
+    for (BinaryKNNTreeType * const tree : trees)
+    {
+      tree->GenerateTree();
+    }
+  }
+
+  /** Initialize tree searchers. */
+  this->m_BinaryKNNTreeSearcherFixed->SetBinaryTree(this->m_BinaryKNNTreeFixed);
+  this->m_BinaryKNNTreeSearcherMoving->SetBinaryTree(this->m_BinaryKNNTreeMoving);
+  this->m_BinaryKNNTreeSearcherJoint->SetBinaryTree(this->m_BinaryKNNTreeJoint);
+
+} // end GenerateTreesAndConnectSearchers()
+
+
+/**
+ * ************************ GetNumberOfSearchWorkUnits *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+unsigned int
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::GetNumberOfSearchWorkUnits() const
+{
+  if (!this->m_UseMultiThread || !this->m_BinaryKNNTreeSearcherFixed->GetSearchBatchIsThreadSafe() ||
+      !this->m_BinaryKNNTreeSearcherMoving->GetSearchBatchIsThreadSafe() ||
+      !this->m_BinaryKNNTreeSearcherJoint->GetSearchBatchIsThreadSafe())
+  {
+    return 1;
+  }
+  return std::max(static_cast<unsigned int>(Self::GetNumberOfWorkUnits()), 1U);
+
+} // end GetNumberOfSearchWorkUnits()
+
+
+/**
+ * ************************ ThreadedComputeValue *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::ThreadedComputeValue(
+  const unsigned int workUnit,
+  const unsigned int numberOfWorkUnits,
+  AccumulateType &   sumG) const
+{
+  /** Get the size of the feature vectors. */
+  const unsigned int jointSize = this->GetNumberOfFixedImages() + this->GetNumberOfMovingImages();
+
+  /** Get the number of neighbours and \gamma. */
+  const unsigned int k = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
+  const double       twoGamma = jointSize * (1.0 - this->m_Alpha);
+
+  /** Get the consecutive range of query points of this work unit. */
+  const unsigned long numberOfQueryPoints = this->m_NumberOfPixelsCounted;
+  const unsigned long subSize = (numberOfQueryPoints + numberOfWorkUnits - 1) / numberOfWorkUnits;
+  const unsigned long pos_begin = std::min(workUnit * subSize, numberOfQueryPoints);
+  const unsigned long pos_end = std::min(pos_begin + subSize, numberOfQueryPoints);
+
+  /** The neighbours of the query points of one batch. */
+  IndexMatrixType    indices_F(SearchBatchSize, k), indices_M(SearchBatchSize, k), indices_J(SearchBatchSize, k);
+  DistanceMatrixType distances_F(SearchBatchSize, k), distances_M(SearchBatchSize, k), distances_J(SearchBatchSize, k);
+
+  sumG = AccumulateType{};
+
+  /** Loop over the batches of query points. */
+  for (unsigned long batchBegin = pos_begin; batchBegin < pos_end; batchBegin += SearchBatchSize)
+  {
+    const unsigned long batchEnd = std::min(batchBegin + SearchBatchSize, pos_end);
+
+    /** Search for the K nearest neighbours of the query points of this batch. */
+    this->m_BinaryKNNTreeSearcherFixed->SearchBatch(
+      this->m_ListSampleFixed, batchBegin, batchEnd, indices_F, distances_F);
+    this->m_BinaryKNNTreeSearcherMoving->SearchBatch(
+      this->m_ListSampleMoving, batchBegin, batchEnd, indices_M, distances_M);
+    this->m_BinaryKNNTreeSearcherJoint->SearchBatch(
+      this->m_ListSampleJoint, batchBegin, batchEnd, indices_J, distances_J);
+
+    /** Loop over the query points of this batch. */
+    for (unsigned long i = batchBegin; i < batchEnd; ++i)
+    {
+      const unsigned long row = i - batchBegin;
+
+      /** Add the distances of all neighbours of the query point,
+       * for the three graphs:
+       * sum M / sqrt( sum F * sum M)
+       */
+
+      /** Variables to compute the measure. */
+      AccumulateType Gamma_F{};
+      AccumulateType Gamma_M{};
+      AccumulateType Gamma_J{};
+
+      /** Loop over the neighbours. */
+      for (unsigned int p = 0; p < k; ++p)
+      {
+        Gamma_F += std::sqrt(distances_F[row][p]);
+        Gamma_M += std::sqrt(distances_M[row][p]);
+        Gamma_J += std::sqrt(distances_J[row][p]);
+      } // end loop over the k neighbours
+
+      /** Calculate the contribution of this query point. */
+      const MeasureType H = std::sqrt(Gamma_F * Gamma_M);
+      if (H > this->m_AvoidDivisionBy)
+      {
+        /** Compute some sums. */
+        const MeasureType G = Gamma_J / H;
+        sumG += std::pow(G, twoGamma);
+      }
+    } // end loop over the query points of this batch
+  }   // end loop over the batches
+
+} // end ThreadedComputeValue()
+
+
+/**
+ * ************************ ThreadedComputeValueAndDerivative *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::ThreadedComputeValueAndDerivative(
+  const unsigned int workUnit,
+  const unsigned int numberOfWorkUnits,
+  AccumulateType &   sumG,
+  DerivativeType &   contribution) const
+{
+  /** Temporary variables. */
+  MeasurementVectorType z_M, z_M_ip, z_J_ip, diff_M, diff_J;
+  MeasureType           distance_F, distance_M, distance_J;
+  MeasureType           H, G, Gpow;
+
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  contribution.SetSize(numberOfParameters);
+  contribution.Fill(DerivativeValueType{});
+  DerivativeType dGamma_M(numberOfParameters);
+  DerivativeType dGamma_J(numberOfParameters);
+
+  /** Get the size of the feature vectors. */
+  const unsigned int jointSize = this->GetNumberOfFixedImages() + this->GetNumberOfMovingImages();
+
+  /** Get the number of neighbours and \gamma. */
+  const unsigned int k = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
+  const double       twoGamma = jointSize * (1.0 - this->m_Alpha);
+
+  /** Get the consecutive range of query points of this work unit. */
+  const unsigned long numberOfQueryPoints = this->m_NumberOfPixelsCounted;
+  const unsigned long subSize = (numberOfQueryPoints + numberOfWorkUnits - 1) / numberOfWorkUnits;
+  const unsigned long pos_begin = std::min(workUnit * subSize, numberOfQueryPoints);
+  const unsigned long pos_end = std::min(pos_begin + subSize, numberOfQueryPoints);
+
+  /** The neighbours of the query points of one batch. */
+  IndexMatrixType    indices_F(SearchBatchSize, k), indices_M(SearchBatchSize, k), indices_J(SearchBatchSize, k);
+  DistanceMatrixType distances_F(SearchBatchSize, k), distances_M(SearchBatchSize, k), distances_J(SearchBatchSize, k);
+
+  /** Get handles to the list samples and the derivative ingredients of the samples. */
+  const ListSampleType &                        listSampleMoving = *this->m_ListSampleMoving;
+  const TransformJacobianContainerType &        jacobianContainer = this->m_JacobianContainer;
+  const TransformJacobianIndicesContainerType & jacobianIndicesContainer = this->m_JacobianIndicesContainer;
+  const SpatialDerivativeContainerType &        spatialDerivativesContainer = this->m_SpatialDerivativesContainer;
+
+  sumG = AccumulateType{};
+
+  /** Loop over the batches of query points. */
+  for (unsigned long batchBegin = pos_begin; batchBegin < pos_end; batchBegin += SearchBatchSize)
+  {
+    const unsigned long batchEnd = std::min(batchBegin + SearchBatchSize, pos_end);
+
+    /** Search for the k nearest neighbours of the query points of this batch. */
+    this->m_BinaryKNNTreeSearcherFixed->SearchBatch(
+      this->m_ListSampleFixed, batchBegin, batchEnd, indices_F, distances_F);
+    this->m_BinaryKNNTreeSearcherMoving->SearchBatch(
+      this->m_ListSampleMoving, batchBegin, batchEnd, indices_M, distances_M);
+    this->m_BinaryKNNTreeSearcherJoint->SearchBatch(
+      this->m_ListSampleJoint, batchBegin, batchEnd, indices_J, distances_J);
+
+    /** Loop over the query points of this batch. */
+    for (unsigned long i = batchBegin; i < batchEnd; ++i)
+    {
+      const unsigned long row = i - batchBegin;
+
+      /** Get the i-th query point. */
+      listSampleMoving.GetMeasurementVector(i, z_M);
+
+      /** Variables to compute the measure and its derivative. */
+      AccumulateType Gamma_F{};
+      AccumulateType Gamma_M{};
+      AccumulateType Gamma_J{};
+
+      SpatialDerivativeType D1sparse, D2sparse_M, D2sparse_J;
+      D1sparse = spatialDerivativesContainer[i] * jacobianContainer[i];
+
+      dGamma_M.Fill(DerivativeValueType{});
+      dGamma_J.Fill(DerivativeValueType{});
+
+      /** Loop over the neighbours. */
+      for (unsigned int p = 0; p < k; ++p)
+      {
+        const int index_M = indices_M[row][p];
+        const int index_J = indices_J[row][p];
+
+        /** Get the neighbour point z_ip^M. */
+        listSampleMoving.GetMeasurementVector(index_M, z_M_ip);
+        listSampleMoving.GetMeasurementVector(index_J, z_J_ip);
+
+        /** Get the distances. */
+        distance_F = std::sqrt(distances_F[row][p]);
+        distance_M = std::sqrt(distances_M[row][p]);
+        distance_J = std::sqrt(distances_J[row][p]);
+
+        /** Compute Gamma's. */
+        Gamma_F += distance_F;
+        Gamma_M += distance_M;
+        Gamma_J += distance_J;
+
+        /** Get the difference of z_ip^M with z_i^M. */
+        diff_M = z_M - z_M_ip;
+        diff_J = z_M - z_J_ip;
+
+        /** Compute derivatives. */
+        D2sparse_M = spatialDerivativesContainer[index_M] * jacobianContainer[index_M];
+        D2sparse_J = spatialDerivativesContainer[index_J] * jacobianContainer[index_J];
+
+        /** Update the dGamma's. */
+        this->UpdateDerivativeOfGammas(D1sparse,
+                                       D2sparse_M,
+                                       D2sparse_J,
+                                       jacobianIndicesContainer[i],
+                                       jacobianIndicesContainer[index_M],
+                                       jacobianIndicesContainer[index_J],
+                                       diff_M,
+                                       diff_J,
+                                       distance_M,
+                                       distance_J,
+                                       dGamma_M,
+                                       dGamma_J);
+
+      } // end loop over the k neighbours
+
+      /** Compute contributions. */
+      H = std::sqrt(Gamma_F * Gamma_M);
+      if (H > this->m_AvoidDivisionBy)
+      {
+        /** Compute some sums. */
+        G = Gamma_J / H;
+        sumG += std::pow(G, twoGamma);
+
+        /** Compute the contribution to the derivative. */
+        Gpow = std::pow(G, twoGamma - 1.0);
+        contribution += (Gpow / H) * (dGamma_J - (0.5 * Gamma_J / Gamma_M) * dGamma_M);
+      }
+
+    } // end loop over the query points of this batch
+  }   // end loop over the batches
+
+} // end ThreadedComputeValueAndDerivative()
+
+
 /**
  * ************************ ComputeListSampleValuesAndDerivativePlusJacobian *************************
  */
@@ -731,9 +835,6 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::
 {
   /** Initialize. */
   this->m_NumberOfPixelsCounted = 0;
-  jacobianContainer.clear();
-  jacobianIndicesContainer.clear();
-  spatialDerivativesContainer.clear();
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
@@ -744,27 +845,38 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::
   const unsigned int movingSize = this->GetNumberOfMovingImages();
   const unsigned int jointSize = fixedSize + movingSize;
 
-  /** Resize the list samples so that enough memory is allocated. */
-  listSampleFixed->SetMeasurementVectorSize(fixedSize);
-  listSampleFixed->Resize(nrOfRequestedSamples);
-  listSampleMoving->SetMeasurementVectorSize(movingSize);
-  listSampleMoving->Resize(nrOfRequestedSamples);
-  listSampleJoint->SetMeasurementVectorSize(jointSize);
-  listSampleJoint->Resize(nrOfRequestedSamples);
-
-  /** Potential speedup: it avoids re-allocations. I noticed performance
-   * gains when nrOfRequestedSamples is about 10000 or higher.
+  /** Resize the list samples so that enough memory is allocated. Resizing
+   * reallocates, so it is only done when the size has changed.
    */
-  jacobianContainer.reserve(nrOfRequestedSamples);
-  jacobianIndicesContainer.reserve(nrOfRequestedSamples);
-  spatialDerivativesContainer.reserve(nrOfRequestedSamples);
+  const auto resizeListSample = [nrOfRequestedSamples](ListSampleType & listSample, const unsigned int dimension) {
+    if ((listSample.Size() != nrOfRequestedSamples) || (listSample.GetMeasurementVectorSize() != dimension))
+    {
+      listSample.Clear();
+      listSample.SetMeasurementVectorSize(dimension);
+      listSample.Resize(nrOfRequestedSamples);
+    }
+  };
+  resizeListSample(*listSampleFixed, fixedSize);
+  resizeListSample(*listSampleMoving, movingSize);
+  resizeListSample(*listSampleJoint, jointSize);
+
+  /** The Jacobians and spatial derivatives of the valid samples are stored in
+   * the first elements of the containers. The elements keep their memory from
+   * the previous call, so that they are not reallocated for each sample.
+   */
+  const unsigned long numberOfNonZeroJacobianIndices =
+    Superclass::m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  if (doDerivative)
+  {
+    jacobianContainer.resize(nrOfRequestedSamples);
+    jacobianIndicesContainer.resize(nrOfRequestedSamples);
+    spatialDerivativesContainer.resize(nrOfRequestedSamples);
+  }
 
   /** Create variables to store intermediate results. */
-  RealType                   movingImageValue;
-  double                     fixedFeatureValue = 0.0;
-  double                     movingFeatureValue = 0.0;
-  NonZeroJacobianIndicesType nzji(Superclass::m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices());
-  TransformJacobianType      jacobian;
+  RealType movingImageValue;
+  double   fixedFeatureValue = 0.0;
+  double   movingFeatureValue = 0.0;
 
   /** Loop over the fixed image samples to calculate the list samples. */
   unsigned int ii = 0;
@@ -835,12 +947,13 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::
       if (doDerivative)
       {
         /** Get the TransformJacobian dT/dmu. */
-        this->EvaluateTransformJacobian(fixedPoint, jacobian, nzji);
-        jacobianContainer.push_back(jacobian);
-        jacobianIndicesContainer.push_back(nzji);
+        NonZeroJacobianIndicesType & nzji = jacobianIndicesContainer[this->m_NumberOfPixelsCounted];
+        nzji.resize(numberOfNonZeroJacobianIndices);
+        this->EvaluateTransformJacobian(fixedPoint, jacobianContainer[this->m_NumberOfPixelsCounted], nzji);
 
         /** Get the spatial derivative of the moving image. */
-        SpatialDerivativeType spatialDerivatives(this->GetNumberOfMovingImages(), this->FixedImageDimension);
+        SpatialDerivativeType & spatialDerivatives = spatialDerivativesContainer[this->m_NumberOfPixelsCounted];
+        spatialDerivatives.set_size(this->GetNumberOfMovingImages(), this->FixedImageDimension);
         spatialDerivatives.set_row(0, movingImageDerivative.GetDataPointer());
 
         /** Get the spatial derivatives of the moving feature images. */
@@ -849,9 +962,6 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::
         this->EvaluateMovingFeatureImageDerivatives(mappedPoint, movingFeatureImageDerivatives);
         spatialDerivatives.update(movingFeatureImageDerivatives, 1, 0);
 
-        /** Put the spatial derivatives of this sample into the container. */
-        spatialDerivativesContainer.push_back(spatialDerivatives);
-
       } // end if doDerivative
 
       /** Update the NumberOfPixelsCounted. */
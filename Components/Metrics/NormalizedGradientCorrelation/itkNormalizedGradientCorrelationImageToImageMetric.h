@@ -23,10 +23,14 @@
 #include "itkNeighborhoodOperatorImageFilter.h"
 #include "itkPoint.h"
 #include "itkCastImageFilter.h"
-#include "itkResampleImageFilter.h"
+#include "itkAdvancedRayCastProjectionImageFilter.h"
 #include "itkOptimizer.h"
 #include "itkAdvancedCombinationTransform.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "elxRayCastProjectionPipeline.h"
+
+#include <memory> // For unique_ptr.
+#include <vector>
 
 namespace itk
 {
@@ -35,6 +39,9 @@ namespace itk
  * \class NormalizedGradientCorrelationImageToImageMetric
  * \brief An metric based on the itk::NormalizedGradientCorrelationImageToImageMetric.
  *
+ * The derivative is estimated by central differences. The values at the test points are computed concurrently,
+ * by the threads of the elastix::WorkStealingThreadPool, each with its own projection of the moving image and its
+ * own Sobel filters. The gradients of the fixed image are computed only once, by Initialize().
  *
  * \ingroup Metrics
  *
@@ -96,7 +103,8 @@ public:
   using TransformedMovingImageType = itk::Image<FixedImagePixelType, Self::FixedImageDimension>;
   using MaskImageType = itk::Image<unsigned char, Self::FixedImageDimension>;
   using MaskImageTypePointer = typename MaskImageType::Pointer;
-  using TransformMovingImageFilterType = itk::ResampleImageFilter<MovingImageType, TransformedMovingImageType>;
+  using TransformMovingImageFilterType =
+    itk::AdvancedRayCastProjectionImageFilter<MovingImageType, TransformedMovingImageType>;
   using TransformMovingImageFilterPointer = typename TransformMovingImageFilterType::Pointer;
   using RayCastInterpolatorType = typename itk::AdvancedRayCastInterpolateImageFunction<MovingImageType, ScalarType>;
   using RayCastInterpolatorPointer = typename RayCastInterpolatorType::Pointer;
@@ -113,6 +121,7 @@ public:
   using CastMovedImageFilterType = itk::CastImageFilter<TransformedMovingImageType, MovedGradientImageType>;
   using CastMovedImageFilterPointer = typename CastMovedImageFilterType::Pointer;
   using MovedGradientPixelType = typename MovedGradientImageType::PixelType;
+  using MovedGradientImagesType = FixedArray<const MovedGradientImageType *, Self::MovedImageDimension>;
 
   /** Get the derivatives of the match measure. */
   void
@@ -158,28 +167,51 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
-  /** Compute the mean of the fixed and moved image gradients. */
+  /** Compute the mean of the specified moved image gradients. Thread-safe. */
   void
-  ComputeMeanMovedGradient() const;
+  ComputeMeanMovedGradient(const MovedGradientImagesType & movedGradientImages,
+                           MovedGradientPixelType *        meanMovedGradient) const;
 
+  /** Compute the mean of the fixed image gradients. */
   void
   ComputeMeanFixedGradient() const;
 
-  /** Compute the similarity measure  */
+  /** Compute the similarity measure of the specified moved image gradients, given their mean. Thread-safe. */
+  MeasureType
+  ComputeMeasure(const MovedGradientImagesType & movedGradientImages,
+                 const MovedGradientPixelType *  meanMovedGradient) const;
+
+  /** Compute the value of the metric from the specified moved image gradients. Thread-safe. */
   MeasureType
-  ComputeMeasure(const TransformParametersType & parameters) const;
+  ComputeValue(const MovedGradientImagesType & movedGradientImages) const;
 
   using FixedSobelFilter = NeighborhoodOperatorImageFilter<FixedGradientImageType, FixedGradientImageType>;
   using MovedSobelFilter = NeighborhoodOperatorImageFilter<MovedGradientImageType, MovedGradientImageType>;
 
 private:
+  using ProjectionPipelineType = elastix::RayCastProjectionPipeline<TransformMovingImageFilterType>;
+
+  /** The projection of the moving image and the computation of its gradients, for one thread of GetDerivative(). */
+  struct EvaluationPipeline
+  {
+    std::unique_ptr<ProjectionPipelineType>                  m_Projection{};
+    CastMovedImageFilterPointer                              m_CastMovedImageFilter{};
+    ZeroFluxNeumannBoundaryCondition<MovedGradientImageType> m_MovedBoundCond{};
+    typename MovedSobelFilter::Pointer                       m_MovedSobelFilters[MovedImageDimension]{};
+  };
+
+  /** Creates an evaluation pipeline. Returns null when the transform cannot be cloned. */
+  std::unique_ptr<EvaluationPipeline>
+  CreateEvaluationPipeline() const;
+
+  /** Computes the value at the specified parameters, using the specified evaluation pipeline. */
+  MeasureType
+  EvaluatePipeline(EvaluationPipeline & pipeline, const TransformParametersType & parameters) const;
+
   ScalesType                  m_Scales{};
   double                      m_DerivativeDelta{ 0.001 };
   CombinationTransformPointer m_CombinationTransform{ CombinationTransformType::New() };
 
-  /** The mean of the moving image gradients. */
-  mutable MovedGradientPixelType m_MeanMovedGradient[MovedImageDimension]{};
-
   /** The mean of the fixed image gradients. */
   mutable FixedGradientPixelType m_MeanFixedGradient[FixedImageDimension]{};
 
@@ -201,6 +233,9 @@ private:
   SobelOperator<MovedGradientPixelType, Self::MovedImageDimension> m_MovedSobelOperators[MovedImageDimension]{};
 
   typename MovedSobelFilter::Pointer m_MovedSobelFilters[Self::MovedImageDimension]{};
+
+  /** The evaluation pipelines of GetDerivative(), created when they are needed, and removed by Initialize(). */
+  mutable std::vector<std::unique_ptr<EvaluationPipeline>> m_EvaluationPipelines{};
 };
 
 } // end namespace itk
@@ -22,7 +22,9 @@
 #include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkNumericTraits.h"
 #include "itkSimpleFilterWatcher.h"
+#include "elxWorkStealingThreadPool.h"
 
+#include <algorithm> // For min.
 #include <iostream>
 #include <iomanip>
 #include <stdio.h>
@@ -41,6 +43,9 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Init
   /** Initialize the base class */
   Superclass::Initialize();
 
+  /** The evaluation pipelines are recreated for the current images and interpolator, when they are needed. */
+  this->m_EvaluationPipelines.clear();
+
   unsigned int iFilter;
 
   /** Compute the gradient of the fixed images */
@@ -74,7 +79,6 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Init
   }
   this->m_TransformMovingImageFilter->SetInterpolator(this->m_Interpolator);
   this->m_TransformMovingImageFilter->SetInput(this->m_MovingImage);
-  this->m_TransformMovingImageFilter->SetDefaultPixelValue(0);
   this->m_TransformMovingImageFilter->SetSize(this->m_FixedImage->GetLargestPossibleRegion().GetSize());
   this->m_TransformMovingImageFilter->SetOutputOrigin(this->m_FixedImage->GetOrigin());
   this->m_TransformMovingImageFilter->SetOutputSpacing(this->m_FixedImage->GetSpacing());
@@ -190,20 +194,17 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Comp
 
 template <class TFixedImage, class TMovingImage>
 void
-NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::ComputeMeanMovedGradient() const
+NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::ComputeMeanMovedGradient(
+  const MovedGradientImagesType & movedGradientImages,
+  MovedGradientPixelType *        meanMovedGradient) const
 {
   typename MovedGradientImageType::IndexType currentIndex;
   typename MovedGradientImageType::PointType point;
 
-  for (int iDimension = 0; iDimension < MovedImageDimension; ++iDimension)
-  {
-    this->m_MovedSobelFilters[iDimension]->UpdateLargestPossibleRegion();
-  }
-
   using MovedIteratorType = itk::ImageRegionConstIteratorWithIndex<MovedGradientImageType>;
 
-  MovedIteratorType movedIteratorx(this->m_MovedSobelFilters[0]->GetOutput(), this->GetFixedImageRegion());
-  MovedIteratorType movedIteratory(this->m_MovedSobelFilters[1]->GetOutput(), this->GetFixedImageRegion());
+  MovedIteratorType movedIteratorx(movedGradientImages[0], this->GetFixedImageRegion());
+  MovedIteratorType movedIteratory(movedGradientImages[1], this->GetFixedImageRegion());
 
   movedIteratorx.GoToBegin();
   movedIteratory.GoToBegin();
@@ -254,8 +255,8 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Comp
     ++movedIteratory;
   } // end while
 
-  this->m_MeanMovedGradient[0] = movedGradient[0] / nPixels;
-  this->m_MeanMovedGradient[1] = movedGradient[1] / nPixels;
+  meanMovedGradient[0] = movedGradient[0] / nPixels;
+  meanMovedGradient[1] = movedGradient[1] / nPixels;
 
 } // end ComputeMeanMovedGradient()
 
@@ -267,12 +268,12 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Comp
 template <class TFixedImage, class TMovingImage>
 auto
 NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::ComputeMeasure(
-  const TransformParametersType & parameters) const -> MeasureType
+  const MovedGradientImagesType & movedGradientImages,
+  const MovedGradientPixelType *  meanMovedGradient) const -> MeasureType
 {
-  this->SetTransformParameters(parameters);
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
-
+  /** The images are up-to-date: the fixed image gradients are computed by Initialize(), and the moved image
+   * gradients by the caller. The images are only read, so that this function can be called concurrently.
+   */
   typename FixedImageType::IndexType currentIndex;
   typename FixedImageType::PointType point;
 
@@ -285,13 +286,6 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Comp
   MeasureType NGautocorrelationfixed{};
   MeasureType NGautocorrelationmoving{};
 
-  /** Make sure all is updated */
-  for (int iDimension = 0; iDimension < FixedImageDimension; ++iDimension)
-  {
-    this->m_FixedSobelFilters[iDimension]->UpdateLargestPossibleRegion();
-    this->m_MovedSobelFilters[iDimension]->UpdateLargestPossibleRegion();
-  }
-
   using FixedIteratorType = itk::ImageRegionConstIteratorWithIndex<FixedGradientImageType>;
 
   FixedIteratorType fixedIteratorx(this->m_FixedSobelFilters[0]->GetOutput(), this->GetFixedImageRegion());
@@ -302,13 +296,12 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Comp
 
   using MovedIteratorType = itk::ImageRegionConstIteratorWithIndex<MovedGradientImageType>;
 
-  MovedIteratorType movedIteratorx(this->m_MovedSobelFilters[0]->GetOutput(), this->GetFixedImageRegion());
-  MovedIteratorType movedIteratory(this->m_MovedSobelFilters[1]->GetOutput(), this->GetFixedImageRegion());
+  MovedIteratorType movedIteratorx(movedGradientImages[0], this->GetFixedImageRegion());
+  MovedIteratorType movedIteratory(movedGradientImages[1], this->GetFixedImageRegion());
 
   movedIteratorx.GoToBegin();
   movedIteratory.GoToBegin();
 
-  this->m_NumberOfPixelsCounted = 0;
   bool sampleOK = false;
 
   if (!this->GetFixedImageMask())
@@ -336,9 +329,9 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Comp
 
     if (sampleOK)
     {
-      NmovedGradient[0] = movedIteratorx.Get() - this->m_MeanMovedGradient[0];
+      NmovedGradient[0] = movedIteratorx.Get() - meanMovedGradient[0];
       NfixedGradient[0] = fixedIteratorx.Get() - this->m_MeanFixedGradient[0];
-      NmovedGradient[1] = movedIteratory.Get() - this->m_MeanMovedGradient[1];
+      NmovedGradient[1] = movedIteratory.Get() - meanMovedGradient[1];
       NfixedGradient[1] = fixedIteratory.Get() - this->m_MeanFixedGradient[1];
       NGcrosscorrelation += NmovedGradient[0] * NfixedGradient[0] + NmovedGradient[1] * NfixedGradient[1];
       NGautocorrelationmoving += NmovedGradient[0] * NmovedGradient[0] + NmovedGradient[1] * NmovedGradient[1];
@@ -359,6 +352,22 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Comp
 } // end ComputeMeasure()
 
 
+/**
+ * ***************** ComputeValue *****************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::ComputeValue(
+  const MovedGradientImagesType & movedGradientImages) const -> MeasureType
+{
+  MovedGradientPixelType meanMovedGradient[MovedImageDimension];
+  this->ComputeMeanMovedGradient(movedGradientImages, meanMovedGradient);
+  return this->ComputeMeasure(movedGradientImages, meanMovedGradient);
+
+} // end ComputeValue()
+
+
 /**
  * ***************** GetValue *****************
  */
@@ -382,21 +391,20 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::GetV
    * - Now you can call GetValueAndDerivative multi-threaded.
    */
   this->BeforeThreadedGetValueAndDerivative(parameters);
-  // this->SetTransformParameters( parameters );
+  this->SetTransformParameters(parameters);
 
-  unsigned int iFilter;
+  this->m_NumberOfPixelsCounted = 0;
   this->m_TransformMovingImageFilter->Modified();
   this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
 
-  for (iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
+  MovedGradientImagesType movedGradientImages;
+  for (unsigned int iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
   {
     this->m_MovedSobelFilters[iFilter]->UpdateLargestPossibleRegion();
+    movedGradientImages[iFilter] = this->m_MovedSobelFilters[iFilter]->GetOutput();
   }
 
-  this->ComputeMeanMovedGradient();
-  MeasureType currentMeasure = this->ComputeMeasure(parameters);
-
-  return currentMeasure;
+  return this->ComputeValue(movedGradientImages);
 
 } // end GetValue()
 
@@ -419,6 +427,81 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::SetT
 } // end SetTransformParameters()
 
 
+/**
+ * ***************** CreateEvaluationPipeline *****************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::CreateEvaluationPipeline() const
+  -> std::unique_ptr<EvaluationPipeline>
+{
+  /** The pipeline gets a clone of the transform of the ray caster, which combines the transform of the metric with
+   * the pre-transform of the interpolator.
+   */
+  using AdvancedTransformType = typename Superclass::AdvancedTransformType;
+  auto * const rayCaster = dynamic_cast<RayCastInterpolatorType *>(this->m_Interpolator.GetPointer());
+  auto * const transform =
+    (rayCaster == nullptr) ? nullptr : dynamic_cast<AdvancedTransformType *>(rayCaster->GetModifiableTransform());
+  if (transform == nullptr)
+  {
+    return nullptr;
+  }
+
+  const auto transformClone = Superclass::CloneTransform(*transform);
+
+  auto projection = ProjectionPipelineType::Create(*this->m_TransformMovingImageFilter, transformClone.GetPointer());
+  if (projection == nullptr)
+  {
+    return nullptr;
+  }
+
+  /** Each pipeline runs in a single thread, as the pipelines themselves run concurrently. */
+  auto pipeline = std::make_unique<EvaluationPipeline>();
+  pipeline->m_Projection = std::move(projection);
+  pipeline->m_CastMovedImageFilter = CastMovedImageFilterType::New();
+  pipeline->m_CastMovedImageFilter->SetNumberOfWorkUnits(1);
+  pipeline->m_CastMovedImageFilter->SetInput(pipeline->m_Projection->GetOutput());
+
+  for (unsigned int iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
+  {
+    auto & movedSobelFilter = pipeline->m_MovedSobelFilters[iFilter];
+    movedSobelFilter = MovedSobelFilter::New();
+    movedSobelFilter->SetNumberOfWorkUnits(1);
+    movedSobelFilter->OverrideBoundaryCondition(&pipeline->m_MovedBoundCond);
+    movedSobelFilter->SetOperator(this->m_MovedSobelOperators[iFilter]);
+    movedSobelFilter->SetInput(pipeline->m_CastMovedImageFilter->GetOutput());
+  }
+
+  return pipeline;
+
+} // end CreateEvaluationPipeline()
+
+
+/**
+ * ***************** EvaluatePipeline *****************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::EvaluatePipeline(
+  EvaluationPipeline &            pipeline,
+  const TransformParametersType & parameters) const -> MeasureType
+{
+  pipeline.m_Projection->SetTransformParameters(parameters);
+
+  MovedGradientImagesType movedGradientImages;
+  for (unsigned int iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
+  {
+    pipeline.m_MovedSobelFilters[iFilter]->UpdateLargestPossibleRegion();
+    movedGradientImages[iFilter] = pipeline.m_MovedSobelFilters[iFilter]->GetOutput();
+  }
+
+  return this->ComputeValue(movedGradientImages);
+
+} // end EvaluatePipeline()
+
+
 /**
  * ***************** GetDerivative *****************
  */
@@ -429,19 +512,70 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::GetD
   const TransformParametersType & parameters,
   DerivativeType &                derivative) const
 {
-  TransformParametersType testPoint;
-  testPoint = parameters;
   const unsigned int numberOfParameters = this->GetNumberOfParameters();
   derivative = DerivativeType(numberOfParameters);
 
+  /** Test point 2i is parameter i minus its step, test point 2i+1 is parameter i plus its step. */
+  std::vector<double>      steps(numberOfParameters);
+  std::vector<MeasureType> values(2 * numberOfParameters);
+  for (unsigned int i = 0; i < numberOfParameters; ++i)
+  {
+    steps[i] = this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]);
+  }
+
+  auto &             threadPool = elastix::WorkStealingThreadPool::GetInstance();
+  const unsigned int numberOfWorkUnits =
+    static_cast<unsigned int>(std::min<std::size_t>(threadPool.GetNumberOfThreads(), values.size()));
+
+  /** Create an evaluation pipeline for each work unit, unless the transform cannot be cloned. */
+  while (numberOfWorkUnits > 1 && this->m_EvaluationPipelines.size() < numberOfWorkUnits)
+  {
+    auto pipeline = this->CreateEvaluationPipeline();
+    if (pipeline == nullptr)
+    {
+      break;
+    }
+    this->m_EvaluationPipelines.push_back(std::move(pipeline));
+  }
+
+  if (numberOfWorkUnits > 1 && this->m_EvaluationPipelines.size() >= numberOfWorkUnits)
+  {
+    elastix::ChunkedRange testPoints;
+
+    threadPool.ForkJoin(numberOfWorkUnits, [&](unsigned int workUnit) {
+      EvaluationPipeline &    pipeline = *(this->m_EvaluationPipelines[workUnit]);
+      TransformParametersType testPoint = parameters;
+      std::size_t             testPointBegin{};
+      std::size_t             testPointEnd{};
+
+      while (testPoints.GetNextChunk(values.size(), numberOfWorkUnits, testPointBegin, testPointEnd))
+      {
+        for (std::size_t j = testPointBegin; j < testPointEnd; ++j)
+        {
+          const std::size_t i = j / 2;
+          testPoint[i] = parameters[i] + ((j % 2 == 0) ? -steps[i] : steps[i]);
+          values[j] = this->EvaluatePipeline(pipeline, testPoint);
+          testPoint[i] = parameters[i];
+        }
+      }
+    });
+  }
+  else
+  {
+    TransformParametersType testPoint = parameters;
+
+    for (std::size_t j = 0; j < values.size(); ++j)
+    {
+      const std::size_t i = j / 2;
+      testPoint[i] = parameters[i] + ((j % 2 == 0) ? -steps[i] : steps[i]);
+      values[j] = this->GetValue(testPoint);
+      testPoint[i] = parameters[i];
+    }
+  }
+
   for (unsigned int i = 0; i < numberOfParameters; ++i)
   {
-    testPoint[i] -= this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]);
-    const MeasureType valuep0 = this->GetValue(testPoint);
-    testPoint[i] += 2 * this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]);
-    const MeasureType valuep1 = this->GetValue(testPoint);
-    derivative[i] = (valuep1 - valuep0) / (2 * this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]));
-    testPoint[i] = parameters[i];
+    derivative[i] = (values[2 * i + 1] - values[2 * i]) / (2 * steps[i]);
   }
 
 } // end GetDerivative()
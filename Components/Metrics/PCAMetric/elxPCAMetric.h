@@ -54,6 +54,13 @@ namespace elastix
  *    image, without using a fixed image. Possible values are "true" or "false".
  * \parameter NumEigenValues: number of eigenvalues used in the metric: sum(e) - e, where sum(e)
  *  is the sum of all eigenvalues and e is the sum of the first highest NumEigenValues eigenvalues.
+ * \parameter ComputeLeadingEigenPairsOnly: compute only the NumEigenValues highest eigenvalues
+ *    and their eigenvectors, by subspace iteration that starts from the eigenvectors of the previous
+ *    iteration, instead of the full eigensystem of the correlation matrix. This is faster for a large
+ *    number of images. When the iteration does not converge, the full eigensystem is computed after all.
+ *    Possible values are "true" or "false". Can be specified for each resolution. \n
+ *    example: <tt>(ComputeLeadingEigenPairsOnly "true")</tt> \n
+ *    Default is "false".
  *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
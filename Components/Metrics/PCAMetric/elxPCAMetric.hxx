@@ -57,6 +57,12 @@ PCAMetric<TElastix>::BeforeEachResolution()
   this->GetConfiguration()->ReadParameter(NumEigenValues, "NumEigenValues", this->GetComponentLabel(), level, 0);
   this->SetNumEigenValues(NumEigenValues);
 
+  /** Get and set if only the leading eigenpairs are computed. */
+  bool computeLeadingEigenPairsOnly = false;
+  this->GetConfiguration()->ReadParameter(
+    computeLeadingEigenPairsOnly, "ComputeLeadingEigenPairsOnly", this->GetComponentLabel(), level, 0);
+  this->SetComputeLeadingEigenPairsOnly(computeLeadingEigenPairsOnly);
+
   /** Get and set if we want to subtract the mean from the derivative. */
   bool subtractMean = false;
   this->GetConfiguration()->ReadParameter(subtractMean, "SubtractMean", this->GetComponentLabel(), 0, 0);
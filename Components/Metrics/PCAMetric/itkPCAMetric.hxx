@@ -21,6 +21,7 @@
 #include "itkPCAMetric.h"
 
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "elxRandomGenerator.h"
 #include <vnl/algo/vnl_matrix_update.h>
 #include "itkImage.h"
 #include <vnl/algo/vnl_svd.h>
@@ -103,8 +104,8 @@ PCAMetric<TFixedImage, TMovingImage>::SampleRandom(const int n, const int m, std
   numbers.clear();
 
   /** Initialize random number generator. */
-  Statistics::MersenneTwisterRandomVariateGenerator::Pointer randomGenerator =
-    Statistics::MersenneTwisterRandomVariateGenerator::GetInstance();
+  const Statistics::MersenneTwisterRandomVariateGenerator::Pointer randomGenerator =
+    elastix::RandomGenerator::GetCurrent();
 
   /** Sample additional at fixed timepoint. */
   for (unsigned int i = 0; i < m_NumAdditionalSamplesFixed; ++i)
@@ -55,6 +55,14 @@ public:
   itkSetMacro(TransformIsStackTransform, bool);
   itkSetMacro(NumEigenValues, unsigned int);
 
+  /** Compute only the NumEigenValues leading eigenpairs of the correlation matrix, by subspace iteration
+   * that is warm-started with the eigenvectors of the previous call, instead of the full eigensystem.
+   * Falls back to the full eigensystem when there are no previous eigenvectors, or when the iteration
+   * does not converge. Default is false.
+   */
+  itkSetMacro(ComputeLeadingEigenPairsOnly, bool);
+  itkGetConstMacro(ComputeLeadingEigenPairsOnly, bool);
+
   /** Typedefs from the superclass. */
   using typename Superclass::CoordinateRepresentationType;
   using typename Superclass::MovingImageType;
@@ -174,6 +182,22 @@ protected:
   void
   AfterThreadedGetSamples(MeasureType & value) const;
 
+  /** Computes the NumEigenValues highest eigenvalues of the correlation matrix K, in descending order,
+   * and the corresponding normalized eigenvectors (as columns). */
+  void
+  ComputeEigenPairs(const MatrixType & K, vnl_vector<RealType> & eigenValues, MatrixType & eigenVectors) const;
+
+  /** Subspace iteration with Rayleigh-Ritz projection, starting from m_WarmStartEigenVectors. Returns false
+   * when there is no suitable start, or when the iteration does not converge. */
+  bool
+  ComputeLeadingEigenPairsBySubspaceIteration(const MatrixType &     K,
+                                              vnl_vector<RealType> & eigenValues,
+                                              MatrixType &           eigenVectors) const;
+
+  /** Orthonormalizes the columns of the matrix by modified Gram-Schmidt. */
+  static void
+  OrthonormalizeColumns(MatrixType & matrix);
+
   void
   AfterThreadedComputeDerivative(DerivativeType & derivative) const;
 
@@ -207,6 +231,8 @@ private:
   {
     SizeValueType                    st_NumberOfPixelsCounted;
     MatrixType                       st_DataBlock;
+    vnl_vector<RealType>             st_Mean;
+    MatrixType                       st_CenteredGram;
     std::vector<FixedImagePointType> st_ApprovedSamples;
     DerivativeType                   st_Derivative;
   };
@@ -234,13 +260,16 @@ private:
   /** Integer to indicate how many eigenvalues you want to use in the metric */
   unsigned int m_NumEigenValues{ 6 };
 
+  bool m_ComputeLeadingEigenPairsOnly{ false };
+
+  /** The Ritz vectors of the last subspace iteration, or the leading eigenvectors of the last full eigensystem. */
+  mutable MatrixType m_WarmStartEigenVectors{};
+
   /** Matrices, needed for derivative calculation */
-  mutable std::vector<unsigned int> m_PixelStartIndex{};
-  mutable MatrixType                m_Atmm{};
-  mutable DerivativeMatrixType      m_vSAtmm{};
-  mutable DerivativeMatrixType      m_CSv{};
-  mutable DerivativeMatrixType      m_Sv{};
-  mutable DerivativeMatrixType      m_vdSdmu_part1{};
+  mutable vnl_vector<RealType> m_Mean{};
+  mutable DerivativeMatrixType m_CSv{};
+  mutable DerivativeMatrixType m_Sv{};
+  mutable DerivativeMatrixType m_vdSdmu_part1{};
 };
 
 } // end namespace itk
@@ -26,7 +26,9 @@
 #include <vnl/algo/vnl_svd.h>
 #include <vnl/vnl_trace.h>
 #include <vnl/algo/vnl_symmetric_eigensystem.h>
+#include <algorithm> // For min and max.
 #include <cassert>
+#include <cmath> // For abs.
 #include <numeric>
 #include <fstream>
 
@@ -72,6 +74,9 @@ PCAMetric<TFixedImage, TMovingImage>::Initialize()
     std::cerr << "ERROR: Number of eigenvalues is larger than number of images. Maximum number of eigenvalues equals: "
               << this->m_G << std::endl;
   }
+
+  /** Eigenvectors of a previous resolution are no start for the subspace iteration. */
+  this->m_WarmStartEigenVectors.clear();
 } // end Initializes
 
 
@@ -115,8 +120,6 @@ PCAMetric<TFixedImage, TMovingImage>::InitializeThreadingParameters() const
     perThreadVariable.st_Derivative.SetSize(this->GetNumberOfParameters());
   }
 
-  this->m_PixelStartIndex.resize(numberOfThreads);
-
 } // end InitializeThreadingParameters()
 
 
@@ -159,6 +162,17 @@ PCAMetric<TFixedImage, TMovingImage>::GetValue(const TransformParametersType & p
    */
   this->BeforeThreadedGetValueAndDerivative(parameters);
 
+  /** Assemble the data matrix and its covariance matrix multi-threaded, like GetValueAndDerivative. */
+  if (Superclass::m_UseMultiThread)
+  {
+    this->InitializeThreadingParameters();
+    this->LaunchGetSamplesThreaderCallback();
+
+    MeasureType value{};
+    this->AfterThreadedGetSamples(value);
+    return value;
+  }
+
   /** Initialize some variables */
   this->m_NumberOfPixelsCounted = 0;
   MeasureType measure{};
@@ -268,16 +282,12 @@ PCAMetric<TFixedImage, TMovingImage>::GetValue(const TransformParametersType & p
   /** Compute correlation matrix K */
   MatrixType K(S * C * S);
 
-  /** Compute first eigenvalue and eigenvector of K */
-  vnl_symmetric_eigensystem<RealType> eig(K);
-
-  RealType sumEigenValuesUsed{};
-  for (unsigned int i = 1; i < this->m_NumEigenValues + 1; ++i)
-  {
-    sumEigenValuesUsed += eig.get_eigenvalue(this->m_G - i);
-  }
+  /** Compute the highest eigenvalues of K */
+  vnl_vector<RealType> eigenValues;
+  MatrixType           eigenVectorMatrix;
+  this->ComputeEigenPairs(K, eigenValues, eigenVectorMatrix);
 
-  measure = this->m_G - sumEigenValuesUsed;
+  measure = this->m_G - eigenValues.sum();
 
   /** Return the measure value. */
   return measure;
@@ -447,20 +457,11 @@ PCAMetric<TFixedImage, TMovingImage>::GetValueAndDerivativeSingleThreaded(const
 
   MatrixType K(S * C * S);
 
-  /** Compute first eigenvalue and eigenvector of K */
-  vnl_symmetric_eigensystem<RealType> eig(K);
-
-  RealType sumEigenValuesUsed{};
-  for (unsigned int i = 1; i < this->m_NumEigenValues + 1; ++i)
-  {
-    sumEigenValuesUsed += eig.get_eigenvalue(this->m_G - i);
-  }
-
-  MatrixType eigenVectorMatrix(this->m_G, this->m_NumEigenValues);
-  for (unsigned int i = 1; i < this->m_NumEigenValues + 1; ++i)
-  {
-    eigenVectorMatrix.set_column(i - 1, (eig.get_eigenvector(this->m_G - i)).normalize());
-  }
+  /** Compute the highest eigenvalues and eigenvectors of K */
+  vnl_vector<RealType> eigenValues;
+  MatrixType           eigenVectorMatrix;
+  this->ComputeEigenPairs(K, eigenValues, eigenVectorMatrix);
+  const RealType sumEigenValuesUsed = eigenValues.sum();
 
   MatrixType eigenVectorMatrixTranspose(eigenVectorMatrix.transpose());
 
@@ -740,9 +741,51 @@ PCAMetric<TFixedImage, TMovingImage>::ThreadedGetSamples(ThreadIdType threadId)
 
   } /** end first loop over image sample container */
 
+  /** Compute the mean of the columns of the samples of this thread. */
+  vnl_vector<RealType> mean(this->m_G, RealType{});
+  for (unsigned int i = 0; i < pixelIndex; ++i)
+  {
+    for (unsigned int j = 0; j < this->m_G; ++j)
+    {
+      mean(j) += datablock(i, j);
+    }
+  }
+  if (pixelIndex > 0)
+  {
+    mean /= RealType(pixelIndex);
+  }
+
+  /** Accumulate the partial Gram matrix of the centered samples of this thread. It is symmetric, so only
+   * its upper triangle is computed. */
+  MatrixType           centeredGram(this->m_G, this->m_G, RealType{});
+  vnl_vector<RealType> centeredSample(this->m_G);
+  for (unsigned int i = 0; i < pixelIndex; ++i)
+  {
+    for (unsigned int j = 0; j < this->m_G; ++j)
+    {
+      centeredSample(j) = datablock(i, j) - mean(j);
+    }
+    for (unsigned int j = 0; j < this->m_G; ++j)
+    {
+      for (unsigned int k = j; k < this->m_G; ++k)
+      {
+        centeredGram(j, k) += centeredSample(j) * centeredSample(k);
+      }
+    }
+  }
+  for (unsigned int j = 0; j < this->m_G; ++j)
+  {
+    for (unsigned int k = 0; k < j; ++k)
+    {
+      centeredGram(j, k) = centeredGram(k, j);
+    }
+  }
+
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_NumberOfPixelsCounted = pixelIndex;
   this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_DataBlock = datablock.extract(pixelIndex, this->m_G);
+  this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_Mean = mean;
+  this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_CenteredGram = centeredGram;
   this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_ApprovedSamples = SamplesOK;
 
 } // end ThreadedGetSamples()
@@ -769,43 +812,30 @@ PCAMetric<TFixedImage, TMovingImage>::AfterThreadedGetSamples(MeasureType & valu
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   this->CheckNumberOfSamples(sampleContainer->Size(), this->m_NumberOfPixelsCounted);
 
-  MatrixType   A(this->m_NumberOfPixelsCounted, this->m_G);
-  unsigned int row_start = 0;
+  /** Calculate the mean of the columns from the means of the threads. */
+  this->m_Mean.set_size(this->m_G);
+  this->m_Mean.fill(RealType{});
   for (ThreadIdType i = 0; i < numberOfThreads; ++i)
   {
-    A.update(this->m_PCAMetricGetSamplesPerThreadVariables[i].st_DataBlock, row_start, 0);
-    this->m_PixelStartIndex[i] = row_start;
-    row_start += this->m_PCAMetricGetSamplesPerThreadVariables[i].st_DataBlock.rows();
+    const auto & perThreadVariables = this->m_PCAMetricGetSamplesPerThreadVariables[i];
+    this->m_Mean += RealType(perThreadVariables.st_NumberOfPixelsCounted) * perThreadVariables.st_Mean;
   }
+  this->m_Mean /= RealType(this->m_NumberOfPixelsCounted);
 
-  /** Calculate standard deviation from columns */
-  MatrixType Amm(this->m_NumberOfPixelsCounted, this->m_G);
-  Amm.fill(RealType{});
+  /** Compute covariance matrix C, by combining the centered Gram matrices of the threads, corrected for the
+   * difference between the mean of each thread and the overall mean (Chan et al.). Unlike the sum of the
+   * uncentered products, this does not suffer from cancellation. */
+  MatrixType C(this->m_G, this->m_G, RealType{});
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
   {
-    /** Calculate mean of from columns */
-    vnl_vector<RealType> mean(this->m_G);
-    mean.fill(RealType{});
-    for (unsigned int i = 0; i < this->m_NumberOfPixelsCounted; ++i)
+    const auto & perThreadVariables = this->m_PCAMetricGetSamplesPerThreadVariables[i];
+    if (perThreadVariables.st_NumberOfPixelsCounted > 0)
     {
-      for (unsigned int j = 0; j < this->m_G; ++j)
-      {
-        mean(j) += A(i, j);
-      }
-    }
-    mean /= RealType(this->m_NumberOfPixelsCounted);
-
-    for (unsigned int i = 0; i < this->m_NumberOfPixelsCounted; ++i)
-    {
-      for (unsigned int j = 0; j < this->m_G; ++j)
-      {
-        Amm(i, j) = A(i, j) - mean(j);
-      }
+      const vnl_vector<RealType> meanDifference = perThreadVariables.st_Mean - this->m_Mean;
+      C += perThreadVariables.st_CenteredGram;
+      C += RealType(perThreadVariables.st_NumberOfPixelsCounted) * outer_product(meanDifference, meanDifference);
     }
   }
-
-  /** Compute covariancematrix C */
-  this->m_Atmm = Amm.transpose();
-  MatrixType C(this->m_Atmm * Amm);
   C /= static_cast<RealType>(RealType(this->m_NumberOfPixelsCounted) - 1.0);
 
   vnl_diag_matrix<RealType> S(this->m_G);
@@ -817,16 +847,11 @@ PCAMetric<TFixedImage, TMovingImage>::AfterThreadedGetSamples(MeasureType & valu
 
   MatrixType K(S * C * S);
 
-  /** Compute first eigenvalue and eigenvector of K */
-  vnl_symmetric_eigensystem<RealType> eig(K);
-
-  RealType   sumEigenValuesUsed{};
-  MatrixType eigenVectorMatrix(this->m_G, this->m_NumEigenValues);
-  for (unsigned int i = 1; i < this->m_NumEigenValues + 1; ++i)
-  {
-    sumEigenValuesUsed += eig.get_eigenvalue(this->m_G - i);
-    eigenVectorMatrix.set_column(i - 1, (eig.get_eigenvector(this->m_G - i)).normalize());
-  }
+  /** Compute the highest eigenvalues and eigenvectors of K */
+  vnl_vector<RealType> eigenValues;
+  MatrixType           eigenVectorMatrix;
+  this->ComputeEigenPairs(K, eigenValues, eigenVectorMatrix);
+  const RealType sumEigenValuesUsed = eigenValues.sum();
 
   value = this->m_G - sumEigenValuesUsed;
 
@@ -842,7 +867,6 @@ PCAMetric<TFixedImage, TMovingImage>::AfterThreadedGetSamples(MeasureType & valu
     dSdmu_part1(d, d) = -S_qub;
   }
 
-  this->m_vSAtmm = eigenVectorMatrixTranspose * S * this->m_Atmm;
   this->m_CSv = C * S * eigenVectorMatrix;
   this->m_Sv = S * eigenVectorMatrix;
   this->m_vdSdmu_part1 = eigenVectorMatrixTranspose * dSdmu_part1;
@@ -850,6 +874,164 @@ PCAMetric<TFixedImage, TMovingImage>::AfterThreadedGetSamples(MeasureType & valu
 } // end AfterThreadedGetSamples()
 
 
+/**
+ * ******************* ComputeEigenPairs *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+PCAMetric<TFixedImage, TMovingImage>::ComputeEigenPairs(const MatrixType &     K,
+                                                        vnl_vector<RealType> & eigenValues,
+                                                        MatrixType &           eigenVectors) const
+{
+  if (this->m_ComputeLeadingEigenPairsOnly &&
+      this->ComputeLeadingEigenPairsBySubspaceIteration(K, eigenValues, eigenVectors))
+  {
+    return;
+  }
+
+  /** Compute the full eigensystem. Its eigenvalues are in ascending order. */
+  vnl_symmetric_eigensystem<RealType> eig(K);
+
+  eigenValues.set_size(this->m_NumEigenValues);
+  eigenVectors.set_size(this->m_G, this->m_NumEigenValues);
+  for (unsigned int i = 1; i < this->m_NumEigenValues + 1; ++i)
+  {
+    eigenValues(i - 1) = eig.get_eigenvalue(this->m_G - i);
+    eigenVectors.set_column(i - 1, (eig.get_eigenvector(this->m_G - i)).normalize());
+  }
+
+  /** Start the subspace iteration of the next call from the leading eigenvectors. The subspace is twice
+   * as large as the number of requested eigenpairs, to speed up the convergence. */
+  if (this->m_ComputeLeadingEigenPairsOnly)
+  {
+    const unsigned int subspaceSize = std::min(2 * this->m_NumEigenValues, this->m_G);
+    this->m_WarmStartEigenVectors.set_size(this->m_G, subspaceSize);
+    for (unsigned int i = 1; i < subspaceSize + 1; ++i)
+    {
+      this->m_WarmStartEigenVectors.set_column(i - 1, (eig.get_eigenvector(this->m_G - i)).normalize());
+    }
+  }
+
+} // end ComputeEigenPairs()
+
+
+/**
+ * ******************* ComputeLeadingEigenPairsBySubspaceIteration *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+bool
+PCAMetric<TFixedImage, TMovingImage>::ComputeLeadingEigenPairsBySubspaceIteration(
+  const MatrixType &     K,
+  vnl_vector<RealType> & eigenValues,
+  MatrixType &           eigenVectors) const
+{
+  /** A maximum of iterations, after which the full eigensystem is cheaper, and a tolerance for the
+   * residual norm || K x - lambda x ||, relative to the highest eigenvalue. */
+  constexpr unsigned int maximumNumberOfIterations{ 50 };
+  constexpr double       relativeTolerance{ 1e-8 };
+
+  const unsigned int numberOfEigenPairs = this->m_NumEigenValues;
+  const unsigned int subspaceSize = std::min(2 * numberOfEigenPairs, this->m_G);
+
+  /** When the subspace spans all dimensions, the iteration is no cheaper than the full eigensystem. */
+  if (subspaceSize >= this->m_G || this->m_WarmStartEigenVectors.rows() != this->m_G ||
+      this->m_WarmStartEigenVectors.cols() != subspaceSize)
+  {
+    return false;
+  }
+
+  MatrixType Q(this->m_WarmStartEigenVectors);
+  MatrixType ritzVectors(this->m_G, subspaceSize);
+  MatrixType ritzCoefficients(subspaceSize, subspaceSize);
+
+  for (unsigned int iteration = 0; iteration < maximumNumberOfIterations; ++iteration)
+  {
+    OrthonormalizeColumns(Q);
+
+    /** Rayleigh-Ritz: solve the eigenproblem of K, projected on the subspace spanned by Q. */
+    const MatrixType                          KQ(K * Q);
+    const vnl_symmetric_eigensystem<RealType> eig(Q.transpose() * KQ);
+    for (unsigned int i = 0; i < subspaceSize; ++i)
+    {
+      ritzCoefficients.set_column(i, eig.get_eigenvector(subspaceSize - 1 - i));
+    }
+    ritzVectors = Q * ritzCoefficients;
+    const MatrixType KRitzVectors(KQ * ritzCoefficients);
+
+    /** Check the residuals of the requested (highest) Ritz pairs. */
+    const RealType tolerance = relativeTolerance * std::max(std::abs(eig.get_eigenvalue(subspaceSize - 1)), 1.0);
+    bool           converged = true;
+    for (unsigned int i = 0; converged && i < numberOfEigenPairs; ++i)
+    {
+      const RealType ritzValue = eig.get_eigenvalue(subspaceSize - 1 - i);
+      converged = (KRitzVectors.get_column(i) - ritzValue * ritzVectors.get_column(i)).two_norm() <= tolerance;
+    }
+
+    if (converged)
+    {
+      eigenValues.set_size(numberOfEigenPairs);
+      for (unsigned int i = 0; i < numberOfEigenPairs; ++i)
+      {
+        eigenValues(i) = eig.get_eigenvalue(subspaceSize - 1 - i);
+      }
+      eigenVectors = ritzVectors.extract(this->m_G, numberOfEigenPairs);
+      this->m_WarmStartEigenVectors = ritzVectors;
+      return true;
+    }
+
+    /** Power step on the Ritz vectors. */
+    Q = KRitzVectors;
+  }
+
+  return false;
+
+} // end ComputeLeadingEigenPairsBySubspaceIteration()
+
+
+/**
+ * ******************* OrthonormalizeColumns *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+PCAMetric<TFixedImage, TMovingImage>::OrthonormalizeColumns(MatrixType & matrix)
+{
+  const unsigned int numberOfRows = matrix.rows();
+
+  /** Removes the components along the previous columns. The second pass restores the orthogonality that
+   * the first one loses by cancellation. */
+  const auto orthogonalize = [&matrix](vnl_vector<RealType> & column, const unsigned int columnIndex) {
+    for (unsigned int pass = 0; pass < 2; ++pass)
+    {
+      for (unsigned int i = 0; i < columnIndex; ++i)
+      {
+        const vnl_vector<RealType> previousColumn = matrix.get_column(i);
+        column -= dot_product(previousColumn, column) * previousColumn;
+      }
+    }
+    return column.two_norm();
+  };
+
+  for (unsigned int j = 0; j < matrix.cols(); ++j)
+  {
+    vnl_vector<RealType> column = matrix.get_column(j);
+    RealType             norm = orthogonalize(column, j);
+
+    /** A column in the span of the previous ones (K is rank deficient) is replaced by a unit vector. */
+    for (unsigned int e = 0; norm < 1e-12 && e < numberOfRows; ++e)
+    {
+      column.fill(RealType{});
+      column(e) = 1.0;
+      norm = orthogonalize(column, j);
+    }
+    matrix.set_column(j, column / norm);
+  }
+
+} // end OrthonormalizeColumns()
+
+
 /**
  * **************** GetSamplesThreaderCallback *******
  */
@@ -880,15 +1062,11 @@ template <class TFixedImage, class TMovingImage>
 void
 PCAMetric<TFixedImage, TMovingImage>::LaunchGetSamplesThreaderCallback() const
 {
-  /** Setup local threader. */
-  // \todo: is a global threader better performance-wise? check
-  auto local_threader = ThreaderType::New();
-  local_threader->SetNumberOfWorkUnits(Self::GetNumberOfWorkUnits());
-  local_threader->SetSingleMethod(this->GetSamplesThreaderCallback,
-                                  const_cast<void *>(static_cast<const void *>(&this->m_PCAMetricThreaderParameters)));
-
-  /** Launch. */
-  local_threader->SingleMethodExecute();
+  /** Launch on the thread pool. */
+  elastix::WorkStealingThreadPool::GetInstance().SingleMethodExecute(
+    Self::GetNumberOfWorkUnits(),
+    this->GetSamplesThreaderCallback,
+    const_cast<void *>(static_cast<const void *>(&this->m_PCAMetricThreaderParameters)));
 
 } // end LaunchGetSamplesThreaderCallback()
 
@@ -913,16 +1091,32 @@ PCAMetric<TFixedImage, TMovingImage>::ThreadedComputeDerivative(ThreadIdType thr
   DerivativeType             imageJacobian(Superclass::m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices());
   NonZeroJacobianIndicesType nzjis(Superclass::m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices());
 
-  unsigned int dummyindex = 0;
+  const auto & perThreadVariables = this->m_PCAMetricGetSamplesPerThreadVariables[threadId];
+  const auto & approvedSamples = perThreadVariables.st_ApprovedSamples;
+
+  /** The centered sample a, and its projection v^T S a on the eigenvectors. Together, they replace the
+   * columns of the centered data matrix Atmm and of vSAtmm. */
+  vnl_vector<RealType>            centeredSample(this->m_G);
+  vnl_vector<DerivativeValueType> vSa(this->m_NumEigenValues);
+
   /** Second loop over fixed image samples. */
-  for (unsigned int pixelIndex = this->m_PixelStartIndex[threadId];
-       pixelIndex < (this->m_PixelStartIndex[threadId] +
-                     this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_ApprovedSamples.size());
-       ++pixelIndex)
+  for (unsigned int sampleIndex = 0; sampleIndex < approvedSamples.size(); ++sampleIndex)
   {
     /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint =
-      this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_ApprovedSamples[dummyindex];
+    FixedImagePointType fixedPoint = approvedSamples[sampleIndex];
+
+    for (unsigned int d = 0; d < this->m_G; ++d)
+    {
+      centeredSample(d) = perThreadVariables.st_DataBlock(sampleIndex, d) - this->m_Mean(d);
+    }
+    for (unsigned int z = 0; z < this->m_NumEigenValues; ++z)
+    {
+      vSa(z) = DerivativeValueType{};
+      for (unsigned int d = 0; d < this->m_G; ++d)
+      {
+        vSa(z) += this->m_Sv[d][z] * centeredSample(d);
+      }
+    }
 
     /** Transform sampled point to voxel coordinates. */
     auto voxelCoord =
@@ -945,20 +1139,20 @@ PCAMetric<TFixedImage, TMovingImage>::ThreadedComputeDerivative(ThreadIdType thr
       /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
       this->EvaluateTransformJacobianInnerProduct(jacobian, movingImageDerivative, imageJacobian);
 
+      /** The sum over the eigenvalues does not depend on the parameter, so compute it only once. */
+      DerivativeValueType weight = 0.0;
+      for (unsigned int z = 0; z < this->m_NumEigenValues; ++z)
+      {
+        weight += vSa(z) * this->m_Sv[d][z] + this->m_vdSdmu_part1[z][d] * centeredSample(d) * this->m_CSv[d][z];
+      } // end loop over eigenvalues
+
       /** build metric derivative components */
       for (unsigned int p = 0; p < nzjis.size(); ++p)
       {
-        DerivativeValueType sum = 0.0;
-        for (unsigned int z = 0; z < this->m_NumEigenValues; ++z)
-        {
-          sum += this->m_vSAtmm[z][pixelIndex] * imageJacobian[p] * this->m_Sv[d][z] +
-                 this->m_vdSdmu_part1[z][d] * this->m_Atmm[d][pixelIndex] * imageJacobian[p] * this->m_CSv[d][z];
-        } // end loop over eigenvalues
-        derivative[nzjis[p]] += sum;
+        derivative[nzjis[p]] += weight * imageJacobian[p];
       } // end loop over non-zero jacobian indices
 
     } // end loop over last dimension
-    ++dummyindex;
 
   } // end second for loop over sample container
 
@@ -1084,15 +1278,11 @@ template <class TFixedImage, class TMovingImage>
 void
 PCAMetric<TFixedImage, TMovingImage>::LaunchComputeDerivativeThreaderCallback() const
 {
-  /** Setup local threader. */
-  // \todo: is a global threader better performance-wise? check
-  auto local_threader = ThreaderType::New();
-  local_threader->SetNumberOfWorkUnits(Self::GetNumberOfWorkUnits());
-  local_threader->SetSingleMethod(this->ComputeDerivativeThreaderCallback,
-                                  const_cast<void *>(static_cast<const void *>(&this->m_PCAMetricThreaderParameters)));
-
-  /** Launch. */
-  local_threader->SingleMethodExecute();
+  /** Launch on the thread pool. */
+  elastix::WorkStealingThreadPool::GetInstance().SingleMethodExecute(
+    Self::GetNumberOfWorkUnits(),
+    this->ComputeDerivativeThreaderCallback,
+    const_cast<void *>(static_cast<const void *>(&this->m_PCAMetricThreaderParameters)));
 
 } // end LaunchComputeDerivativeThreaderCallback()
 
@@ -24,6 +24,7 @@
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkNearestNeighborInterpolateImageFunction.h"
 #include "itkExtractImageFilter.h"
+#include <vector>
 
 namespace itk
 {
@@ -94,6 +95,8 @@ public:
   using typename Superclass::MovingImageDerivativeScalesType;
   using typename Superclass::DerivativeValueType;
 
+  using MatrixType = vnl_matrix<RealType>;
+
   /** The fixed image dimension. */
   itkStaticConstMacro(FixedImageDimension, unsigned int, FixedImageType::ImageDimension);
 
@@ -156,6 +159,38 @@ private:
   void
   SampleRandom(const int n, const int m, std::vector<int> & numbers) const;
 
+  /** Evaluates the moving images at the samples, and computes the centered data matrix of the samples that
+   * are valid in all images, together with the mean of its columns and its covariance matrix. When
+   * UseMultiThread is on, the work units each evaluate a part of the samples, and compute its mean and
+   * centered Gram matrix, which are combined afterwards.
+   */
+  void
+  ComputeDataMatrixAndCovariance(MatrixType &                       centeredDataMatrix,
+                                 std::vector<FixedImagePointType> & approvedSamples,
+                                 MatrixType &                       covariance) const;
+
+  /** Evaluates the samples [begin, end) of the sample container, for ComputeDataMatrixAndCovariance. */
+  void
+  ThreadedGetSamples(const ThreadIdType workUnit, const SizeValueType begin, const SizeValueType end) const;
+
+  struct PCAMetric2GetSamplesPerThreadStruct
+  {
+    MatrixType                       st_DataBlock;
+    vnl_vector<RealType>             st_Mean;
+    MatrixType                       st_CenteredGram;
+    std::vector<FixedImagePointType> st_ApprovedSamples;
+  };
+
+  itkPadStruct(ITK_CACHE_LINE_ALIGNMENT,
+               PCAMetric2GetSamplesPerThreadStruct,
+               PaddedPCAMetric2GetSamplesPerThreadStruct);
+
+  itkAlignedTypedef(ITK_CACHE_LINE_ALIGNMENT,
+                    PaddedPCAMetric2GetSamplesPerThreadStruct,
+                    AlignedPCAMetric2GetSamplesPerThreadStruct);
+
+  mutable std::vector<AlignedPCAMetric2GetSamplesPerThreadStruct> m_PCAMetric2GetSamplesPerThreadVariables{};
+
   /** Variables to control random sampling in last dimension. */
   unsigned int m_NumAdditionalSamplesFixed{};
   unsigned int m_ReducedDimensionIndex{};
@@ -21,13 +21,16 @@
 #include "itkPCAMetric2.h"
 
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "elxRandomGenerator.h"
 #include <vnl/algo/vnl_matrix_update.h>
 #include "itkImage.h"
 #include <vnl/algo/vnl_svd.h>
 #include <vnl/vnl_trace.h>
 #include <vnl/algo/vnl_symmetric_eigensystem.h>
+#include <algorithm> // For min.
 #include <numeric>
 #include <fstream>
+#include <utility> // For move.
 
 namespace itk
 {
@@ -86,8 +89,8 @@ PCAMetric2<TFixedImage, TMovingImage>::SampleRandom(const int n, const int m, st
   numbers.clear();
 
   /** Initialize random number generator. */
-  Statistics::MersenneTwisterRandomVariateGenerator::Pointer randomGenerator =
-    Statistics::MersenneTwisterRandomVariateGenerator::GetInstance();
+  const Statistics::MersenneTwisterRandomVariateGenerator::Pointer randomGenerator =
+    elastix::RandomGenerator::GetCurrent();
 
   /** Sample additional at fixed timepoint. */
   for (unsigned int i = 0; i < m_NumAdditionalSamplesFixed; ++i)
@@ -124,67 +127,30 @@ PCAMetric2<TFixedImage, TMovingImage>::EvaluateTransformJacobianInnerProduct(
 
 
 /**
- * ******************* GetValue *******************
+ * ******************* ThreadedGetSamples *******************
  */
 
 template <class TFixedImage, class TMovingImage>
-auto
-PCAMetric2<TFixedImage, TMovingImage>::GetValue(const TransformParametersType & parameters) const -> MeasureType
+void
+PCAMetric2<TFixedImage, TMovingImage>::ThreadedGetSamples(const ThreadIdType  workUnit,
+                                                          const SizeValueType begin,
+                                                          const SizeValueType end) const
 {
-  itkDebugMacro("GetValue( " << parameters << " ) ");
-  bool UseGetValueAndDerivative = false;
-
-  if (UseGetValueAndDerivative)
-  {
-    const unsigned int numberOfParameters = this->GetNumberOfParameters();
-    MeasureType        dummymeasure{};
-    DerivativeType     dummyderivative = DerivativeType(numberOfParameters);
-    dummyderivative.Fill(DerivativeValueType{});
-
-    this->GetValueAndDerivative(parameters, dummymeasure, dummyderivative);
-    return dummymeasure;
-  }
-
-  /** Make sure the transform parameters are up to date. */
-  this->SetTransformParameters(parameters);
-
-  /** Initialize some variables */
-  this->m_NumberOfPixelsCounted = 0;
-  MeasureType measure{};
-
-  /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-
   /** Retrieve slowest varying dimension and its size. */
   const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
   const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
 
-  using MatrixType = vnl_matrix<RealType>;
-
-  /** The rows of the ImageSampleMatrix contain the samples of the images of the stack */
-  const unsigned int numberOfSamples = sampleContainer->Size();
-  MatrixType         datablock(numberOfSamples, G);
-
-  /** Vector containing last dimension positions to use: initialize on all positions when random sampling turned off. */
-  std::vector<int> lastDimPositions;
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
-  /** Determine random last dimension positions if needed. */
-  for (unsigned int i = 0; i < G; ++i)
-  {
-    lastDimPositions.push_back(i);
-  }
+  std::vector<FixedImagePointType> SamplesOK;
+  MatrixType                       datablock(end - begin, G);
 
-  /** Initialize dummy loop variable */
   unsigned int pixelIndex = 0;
-
-  /** Initialize image sample matrix . */
-  datablock.fill(RealType{});
-
-  for (const auto & fixedImageSample : *sampleContainer)
+  for (auto fiter = sampleContainer->cbegin() + begin; fiter != sampleContainer->cbegin() + end; ++fiter)
   {
     /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = fixedImageSample.m_ImageCoordinates;
+    FixedImagePointType fixedPoint = fiter->m_ImageCoordinates;
 
     /** Transform sampled point to voxel coordinates. */
     auto voxelCoord =
@@ -199,7 +165,7 @@ PCAMetric2<TFixedImage, TMovingImage>::GetValue(const TransformParametersType &
       RealType movingImageValue;
 
       /** Set fixed point's last dimension to lastDimPosition. */
-      voxelCoord[lastDim] = lastDimPositions[d];
+      voxelCoord[lastDim] = d;
 
       /** Transform sampled point back to world coordinates. */
       this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint(voxelCoord, fixedPoint);
@@ -212,7 +178,9 @@ PCAMetric2<TFixedImage, TMovingImage>::GetValue(const TransformParametersType &
 
       if (sampleOk)
       {
-        sampleOk = this->Superclass::EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr);
+        sampleOk = Superclass::m_UseMultiThread
+                     ? this->FastEvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr, workUnit)
+                     : this->Superclass::EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr);
       }
 
       if (sampleOk)
@@ -225,44 +193,190 @@ PCAMetric2<TFixedImage, TMovingImage>::GetValue(const TransformParametersType &
 
     if (numSamplesOk == G)
     {
+      SamplesOK.push_back(fixedPoint);
       ++pixelIndex;
-      this->m_NumberOfPixelsCounted++;
     }
 
-  } /** end first loop over image sample container */
+  } /** end loop over image sample container */
 
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(numberOfSamples, this->m_NumberOfPixelsCounted);
-  const unsigned int N = this->m_NumberOfPixelsCounted;
-  MatrixType         A(datablock.extract(N, G));
+  /** Compute the mean of the columns of the samples of this work unit. */
+  vnl_vector<RealType> mean(G, RealType{});
+  for (unsigned int i = 0; i < pixelIndex; ++i)
+  {
+    for (unsigned int j = 0; j < G; ++j)
+    {
+      mean(j) += datablock(i, j);
+    }
+  }
+  if (pixelIndex > 0)
+  {
+    mean /= RealType(pixelIndex);
+  }
 
-  MatrixType Amm(N, G);
-  Amm.fill(RealType{});
+  /** Accumulate the partial Gram matrix of the centered samples of this work unit. It is symmetric, so
+   * only its upper triangle is computed. */
+  MatrixType           centeredGram(G, G, RealType{});
+  vnl_vector<RealType> centeredSample(G);
+  for (unsigned int i = 0; i < pixelIndex; ++i)
   {
-    /** Calculate mean of from columns */
-    vnl_vector<RealType> mean(G);
-    mean.fill(RealType{});
-    for (unsigned int i = 0; i < N; ++i)
+    for (unsigned int j = 0; j < G; ++j)
     {
-      for (unsigned int j = 0; j < G; ++j)
+      centeredSample(j) = datablock(i, j) - mean(j);
+    }
+    for (unsigned int j = 0; j < G; ++j)
+    {
+      for (unsigned int k = j; k < G; ++k)
       {
-        mean(j) += A(i, j);
+        centeredGram(j, k) += centeredSample(j) * centeredSample(k);
       }
     }
-    mean /= RealType(N);
+  }
+  for (unsigned int j = 0; j < G; ++j)
+  {
+    for (unsigned int k = 0; k < j; ++k)
+    {
+      centeredGram(j, k) = centeredGram(k, j);
+    }
+  }
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  auto & perThreadVariables = this->m_PCAMetric2GetSamplesPerThreadVariables[workUnit];
+  perThreadVariables.st_DataBlock = datablock.extract(pixelIndex, G);
+  perThreadVariables.st_Mean = mean;
+  perThreadVariables.st_CenteredGram = centeredGram;
+  perThreadVariables.st_ApprovedSamples = std::move(SamplesOK);
+
+} // end ThreadedGetSamples()
+
+
+/**
+ * ******************* ComputeDataMatrixAndCovariance *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+PCAMetric2<TFixedImage, TMovingImage>::ComputeDataMatrixAndCovariance(
+  MatrixType &                       centeredDataMatrix,
+  std::vector<FixedImagePointType> & approvedSamples,
+  MatrixType &                       covariance) const
+{
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  const SizeValueType         numberOfSamples = sampleContainer->Size();
+
+  /** Each work unit evaluates a contiguous part of the samples, so that the order of the samples in the data
+   * matrix does not depend on the number of work units. */
+  const ThreadIdType numberOfWorkUnits = Superclass::m_UseMultiThread ? Self::GetNumberOfWorkUnits() : 1;
+  this->m_PCAMetric2GetSamplesPerThreadVariables.resize(numberOfWorkUnits);
+
+  const SizeValueType samplesPerWorkUnit = (numberOfSamples + numberOfWorkUnits - 1) / numberOfWorkUnits;
+  elastix::WorkStealingThreadPool::GetInstance().ForkJoin(
+    numberOfWorkUnits, [this, numberOfSamples, samplesPerWorkUnit](const unsigned int workUnit) {
+      this->ThreadedGetSamples(workUnit,
+                               std::min(samplesPerWorkUnit * workUnit, numberOfSamples),
+                               std::min(samplesPerWorkUnit * (workUnit + 1), numberOfSamples));
+    });
+
+  /** Accumulate the number of pixels. */
+  this->m_NumberOfPixelsCounted = 0;
+  for (const auto & perThreadVariables : this->m_PCAMetric2GetSamplesPerThreadVariables)
+  {
+    this->m_NumberOfPixelsCounted += perThreadVariables.st_ApprovedSamples.size();
+  }
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(numberOfSamples, this->m_NumberOfPixelsCounted);
+  const unsigned int N = this->m_NumberOfPixelsCounted;
 
-    for (unsigned int i = 0; i < N; ++i)
+  /** Calculate the mean of the columns from the means of the work units. */
+  vnl_vector<RealType> mean(G, RealType{});
+  for (const auto & perThreadVariables : this->m_PCAMetric2GetSamplesPerThreadVariables)
+  {
+    mean += RealType(perThreadVariables.st_ApprovedSamples.size()) * perThreadVariables.st_Mean;
+  }
+  mean /= RealType(N);
+
+  /** Compute the covariance matrix by combining the centered Gram matrices of the work units, corrected for
+   * the difference between the mean of each work unit and the overall mean (Chan et al.). */
+  covariance.set_size(G, G);
+  covariance.fill(RealType{});
+  for (const auto & perThreadVariables : this->m_PCAMetric2GetSamplesPerThreadVariables)
+  {
+    if (!perThreadVariables.st_ApprovedSamples.empty())
+    {
+      const vnl_vector<RealType> meanDifference = perThreadVariables.st_Mean - mean;
+      covariance += perThreadVariables.st_CenteredGram;
+      covariance +=
+        RealType(perThreadVariables.st_ApprovedSamples.size()) * outer_product(meanDifference, meanDifference);
+    }
+  }
+  covariance /= static_cast<RealType>(RealType(N) - 1.0);
+
+  /** Concatenate the centered data blocks and the approved samples of the work units, in order. */
+  centeredDataMatrix.set_size(N, G);
+  approvedSamples.clear();
+  approvedSamples.reserve(N);
+  unsigned int row = 0;
+  for (const auto & perThreadVariables : this->m_PCAMetric2GetSamplesPerThreadVariables)
+  {
+    const MatrixType & datablock = perThreadVariables.st_DataBlock;
+    for (unsigned int i = 0; i < datablock.rows(); ++i, ++row)
     {
       for (unsigned int j = 0; j < G; ++j)
       {
-        Amm(i, j) = A(i, j) - mean(j);
+        centeredDataMatrix(row, j) = datablock(i, j) - mean(j);
       }
     }
+    const auto & approvedSamplesOfWorkUnit = perThreadVariables.st_ApprovedSamples;
+    approvedSamples.insert(approvedSamples.end(), approvedSamplesOfWorkUnit.cbegin(), approvedSamplesOfWorkUnit.cend());
+  }
+
+} // end ComputeDataMatrixAndCovariance()
+
+
+/**
+ * ******************* GetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+PCAMetric2<TFixedImage, TMovingImage>::GetValue(const TransformParametersType & parameters) const -> MeasureType
+{
+  itkDebugMacro("GetValue( " << parameters << " ) ");
+  bool UseGetValueAndDerivative = false;
+
+  if (UseGetValueAndDerivative)
+  {
+    const unsigned int numberOfParameters = this->GetNumberOfParameters();
+    MeasureType        dummymeasure{};
+    DerivativeType     dummyderivative = DerivativeType(numberOfParameters);
+    dummyderivative.Fill(DerivativeValueType{});
+
+    this->GetValueAndDerivative(parameters, dummymeasure, dummyderivative);
+    return dummymeasure;
   }
 
+  /** Make sure the transform parameters are up to date. */
+  this->SetTransformParameters(parameters);
+
+  /** Initialize some variables */
+  MeasureType measure{};
+
+  /** Update the imageSampler. */
+  this->GetImageSampler()->Update();
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
   /** Compute covariancematrix C */
-  MatrixType C(Amm.transpose() * Amm);
-  C /= static_cast<RealType>(RealType(N) - 1.0);
+  MatrixType                       Amm;
+  std::vector<FixedImagePointType> SamplesOK;
+  MatrixType                       C;
+  this->ComputeDataMatrixAndCovariance(Amm, SamplesOK, C);
 
   MatrixType S(G, G);
   S.fill(RealType{});
@@ -338,40 +452,24 @@ PCAMetric2<TFixedImage, TMovingImage>::GetValueAndDerivative(const TransformPara
 
   /** Initialize some variables */
   const unsigned int numberOfParameters = this->GetNumberOfParameters();
-  this->m_NumberOfPixelsCounted = 0;
-  MeasureType measure{};
+  MeasureType        measure{};
   derivative = DerivativeType(numberOfParameters);
   derivative.Fill(DerivativeValueType{});
 
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters(parameters);
 
-  /** Update the imageSampler and get a handle to the sample container. */
+  /** Update the imageSampler. */
   this->GetImageSampler()->Update();
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Retrieve slowest varying dimension and its size. */
   const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
   const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
 
-  using MatrixType = vnl_matrix<RealType>;
   using DerivativeMatrixType = vnl_matrix<DerivativeValueType>;
 
-  std::vector<FixedImagePointType> SamplesOK;
-
-  /** The rows of the ImageSampleMatrix contain the samples of the images of the stack */
-  const unsigned int numberOfSamples = sampleContainer->Size();
-  MatrixType         datablock(numberOfSamples, G);
-
-  /** Initialize dummy loop variables */
-  unsigned int pixelIndex = 0;
-
-  /** Initialize image sample matrix . */
-  datablock.fill(RealType{});
-
   /** Determine random last dimension positions if needed. */
   /** Vector containing last dimension positions to use: initialize on all positions when random sampling turned off. */
-  /** Vector containing last dimension positions to use: initialize on all positions when random sampling turned off. */
   std::vector<int> lastDimPositions;
 
   for (unsigned int i = 0; i < G; ++i)
@@ -379,90 +477,16 @@ PCAMetric2<TFixedImage, TMovingImage>::GetValueAndDerivative(const TransformPara
     lastDimPositions.push_back(i);
   }
 
-  for (const auto & fixedImageSample : *sampleContainer)
-  {
-    /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = fixedImageSample.m_ImageCoordinates;
-
-    /** Transform sampled point to voxel coordinates. */
-    auto voxelCoord =
-      this->GetFixedImage()->template TransformPhysicalPointToContinuousIndex<CoordinateRepresentationType>(fixedPoint);
-
-    unsigned int numSamplesOk = 0;
-
-    /** Loop over t */
-    for (unsigned int d = 0; d < G; ++d)
-    {
-      /** Initialize some variables. */
-      RealType movingImageValue;
-
-      /** Set fixed point's last dimension to lastDimPosition. */
-      voxelCoord[lastDim] = lastDimPositions[d];
-
-      /** Transform sampled point back to world coordinates. */
-      this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint(voxelCoord, fixedPoint);
-
-      /** Transform point. */
-      const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
-
-      /** Check if the point is inside the moving mask. */
-      bool sampleOk = this->IsInsideMovingMask(mappedPoint);
-
-      if (sampleOk)
-      {
-        sampleOk = this->Superclass::EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr);
-      }
-
-      if (sampleOk)
-      {
-        ++numSamplesOk;
-        datablock(pixelIndex, d) = movingImageValue;
-      } // end if sampleOk
-
-    } // end loop over gradient images
-    if (numSamplesOk == G)
-    {
-      SamplesOK.push_back(fixedPoint);
-      ++pixelIndex;
-      this->m_NumberOfPixelsCounted++;
-    }
-  }
-
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(sampleContainer->Size(), this->m_NumberOfPixelsCounted);
-  unsigned int N = this->m_NumberOfPixelsCounted;
-
-  MatrixType A(datablock.extract(N, G));
-
-  /** Calculate standard deviation of columns */
-  MatrixType Amm(N, G);
-  Amm.fill(RealType{});
-  {
-    /** Calculate mean of columns */
-    vnl_vector<RealType> mean(G);
-    mean.fill(RealType{});
-    for (unsigned int i = 0; i < N; ++i)
-    {
-      for (unsigned int j = 0; j < G; ++j)
-      {
-        mean(j) += A(i, j);
-      }
-    }
-    mean /= RealType(N);
-
-    for (unsigned int i = 0; i < N; ++i)
-    {
-      for (unsigned int j = 0; j < G; ++j)
-      {
-        Amm(i, j) = A(i, j) - mean(j);
-      }
-    }
-  }
+  /** Compute the centered data matrix and the covariance matrix C */
+  MatrixType                       Amm;
+  std::vector<FixedImagePointType> SamplesOK;
+  MatrixType                       C;
+  this->ComputeDataMatrixAndCovariance(Amm, SamplesOK, C);
+  const unsigned int N = this->m_NumberOfPixelsCounted;
+  const MatrixType   Atmm = Amm.transpose();
 
-  /** Compute covariance matrix C */
-  MatrixType Atmm = Amm.transpose();
-  MatrixType C(Atmm * Amm);
-  C /= static_cast<RealType>(RealType(N) - 1.0);
+  /** Initialize dummy loop variables */
+  unsigned int pixelIndex = 0;
 
   vnl_diag_matrix<RealType> S(G);
   S.fill(RealType{});
@@ -22,13 +22,17 @@
 
 #include "itkPoint.h"
 #include "itkCastImageFilter.h"
-#include "itkResampleImageFilter.h"
+#include "itkAdvancedRayCastProjectionImageFilter.h"
 #include "itkMultiplyImageFilter.h"
 #include "itkSubtractImageFilter.h"
 #include "itkOptimizer.h"
 #include "itkRescaleIntensityImageFilter.h"
 #include "itkAdvancedCombinationTransform.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "elxRayCastProjectionPipeline.h"
+
+#include <memory> // For unique_ptr.
+#include <vector>
 
 namespace itk
 {
@@ -36,7 +40,9 @@ namespace itk
 /** \class PatternIntensityImageToImageMetric
  * \brief Computes similarity between two objects to be registered
  *
- *
+ * The derivative is estimated by central differences. The values at the test points are computed concurrently,
+ * by the threads of the elastix::WorkStealingThreadPool, each with its own projection of the moving image and its
+ * own difference image.
  *
  * \ingroup RegistrationMetrics
  */
@@ -110,7 +116,8 @@ public:
   using CombinationTransformPointer = typename CombinationTransformType::Pointer;
   using RayCastInterpolatorType = typename itk::AdvancedRayCastInterpolateImageFunction<MovingImageType, ScalarType>;
   using RayCastInterpolatorPointer = typename RayCastInterpolatorType::Pointer;
-  using TransformMovingImageFilterType = itk::ResampleImageFilter<MovingImageType, TransformedMovingImageType>;
+  using TransformMovingImageFilterType =
+    itk::AdvancedRayCastProjectionImageFilter<MovingImageType, TransformedMovingImageType>;
   using TransformMovingImageFilterPointer = typename TransformMovingImageFilterType::Pointer;
   using RescaleIntensityImageFilterType =
     itk::RescaleIntensityImageFilter<TransformedMovingImageType, TransformedMovingImageType>;
@@ -170,11 +177,39 @@ protected:
   MeasureType
   ComputePIFixed() const;
 
-  /** Compute the pattern intensity difference image. */
+  /** Compute the pattern intensity of the difference image of the specified filters, which compute the difference
+   * between the fixed image and the scaled projection of the moving image. Thread-safe when the filters are not
+   * shared with another thread. */
+  MeasureType
+  ComputePIDiff(MultiplyImageFilterType &   multiplyFilter,
+                DifferenceImageFilterType & differenceFilter,
+                float                       scalingfactor) const;
+
+  /** Compute the value of the metric, using the specified filters. Thread-safe when the filters are not shared with
+   * another thread. */
   MeasureType
-  ComputePIDiff(const TransformParametersType & parameters, float scalingfactor) const;
+  ComputeValue(MultiplyImageFilterType & multiplyFilter, DifferenceImageFilterType & differenceFilter) const;
 
 private:
+  using ProjectionPipelineType = elastix::RayCastProjectionPipeline<TransformMovingImageFilterType>;
+
+  /** The projection of the moving image and the computation of the difference image, for one thread of
+   * GetDerivative(). */
+  struct EvaluationPipeline
+  {
+    std::unique_ptr<ProjectionPipelineType> m_Projection{};
+    MultiplyImageFilterPointer              m_MultiplyImageFilter{};
+    DifferenceImageFilterPointer            m_DifferenceImageFilter{};
+  };
+
+  /** Creates an evaluation pipeline. Returns null when the transform cannot be cloned. */
+  std::unique_ptr<EvaluationPipeline>
+  CreateEvaluationPipeline() const;
+
+  /** Computes the value at the specified parameters, using the specified evaluation pipeline. */
+  MeasureType
+  EvaluatePipeline(EvaluationPipeline & pipeline, const TransformParametersType & parameters) const;
+
   TransformMovingImageFilterPointer  m_TransformMovingImageFilter{ TransformMovingImageFilterType::New() };
   DifferenceImageFilterPointer       m_DifferenceImageFilter{ DifferenceImageFilterType::New() };
   RescaleIntensityImageFilterPointer m_RescaleImageFilter{ RescaleIntensityImageFilterType::New() };
@@ -188,6 +223,9 @@ private:
   ScalesType                         m_Scales{};
   MeasureType                        m_FixedMeasure{ 0 };
   CombinationTransformPointer        m_CombinationTransform{ CombinationTransformType::New() };
+
+  /** The evaluation pipelines of GetDerivative(), created when they are needed, and removed by Initialize(). */
+  mutable std::vector<std::unique_ptr<EvaluationPipeline>> m_EvaluationPipelines{};
 };
 
 } // end namespace itk
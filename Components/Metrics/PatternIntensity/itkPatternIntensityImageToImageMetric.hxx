@@ -21,7 +21,9 @@
 #include "itkPatternIntensityImageToImageMetric.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkNumericTraits.h"
+#include "elxWorkStealingThreadPool.h"
 
+#include <algorithm> // For min.
 #include <cmath>
 #include <iostream>
 #include <iomanip>
@@ -41,6 +43,9 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::Initialize()
 {
   Superclass::Initialize();
 
+  /** The evaluation pipelines are recreated for the current images and interpolator, when they are needed. */
+  this->m_EvaluationPipelines.clear();
+
   /** Resampling for 3D->2D */
   RayCastInterpolatorType * rayCaster = dynamic_cast<RayCastInterpolatorType *>(this->GetInterpolator());
   if (rayCaster != nullptr)
@@ -55,7 +60,6 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::Initialize()
   }
   this->m_TransformMovingImageFilter->SetInterpolator(this->m_Interpolator);
   this->m_TransformMovingImageFilter->SetInput(this->m_MovingImage);
-  this->m_TransformMovingImageFilter->SetDefaultPixelValue(0);
 
   this->m_TransformMovingImageFilter->SetSize(this->m_FixedImage->GetLargestPossibleRegion().GetSize());
   this->m_TransformMovingImageFilter->SetOutputOrigin(this->m_FixedImage->GetOrigin());
@@ -197,28 +201,14 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::ComputePIFixed()
 
 template <class TFixedImage, class TMovingImage>
 auto
-PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::ComputePIDiff(const TransformParametersType & parameters,
-                                                                             float scalingfactor) const -> MeasureType
+PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::ComputePIDiff(
+  MultiplyImageFilterType &   multiplyFilter,
+  DifferenceImageFilterType & differenceFilter,
+  float                       scalingfactor) const -> MeasureType
 {
-  /** Call non-thread-safe stuff, such as:
-   *   this->SetTransformParameters( parameters );
-   *   this->GetImageSampler()->Update();
-   * Because of these calls GetValueAndDerivative itself is not thread-safe,
-   * so cannot be called multiple times simultaneously.
-   * This is however needed in the CombinationImageToImageMetric.
-   * In that case, you need to:
-   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
-   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
-   *   calling GetValueAndDerivative
-   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
-   * - Now you can call GetValueAndDerivative multi-threaded.
-   */
-  this->BeforeThreadedGetValueAndDerivative(parameters);
-  // this->SetTransformParameters( parameters );
-
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_MultiplyImageFilter->SetConstant(scalingfactor);
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
+  /** Only the scaling of the projection changes, so the projection itself is not recomputed. */
+  multiplyFilter.SetConstant(scalingfactor);
+  differenceFilter.UpdateLargestPossibleRegion();
   MeasureType measure{};
   MeasureType diff{};
 
@@ -242,7 +232,7 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::ComputePIDiff(con
   iterationRegion.SetSize(iterationSize);
 
   using DifferenceImageIteratorType = itk::ImageRegionConstIteratorWithIndex<TransformedMovingImageType>;
-  DifferenceImageIteratorType differenceImageIt(this->m_DifferenceImageFilter->GetOutput(), iterationRegion);
+  DifferenceImageIteratorType differenceImageIt(differenceFilter.GetOutput(), iterationRegion);
   differenceImageIt.GoToBegin();
 
   neighboriterationRegion.SetSize(neighborIterationSize);
@@ -282,7 +272,7 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::ComputePIDiff(con
       }
 
       neighboriterationRegion.SetIndex(neighborIndex);
-      DifferenceImageIteratorType neighborIt(this->m_DifferenceImageFilter->GetOutput(), neighboriterationRegion);
+      DifferenceImageIteratorType neighborIt(differenceFilter.GetOutput(), neighboriterationRegion);
       neighborIt.GoToBegin();
 
       while (!neighborIt.IsAtEnd())
@@ -328,7 +318,21 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
   // this->SetTransformParameters( parameters );
 
   this->m_TransformMovingImageFilter->Modified();
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
+  return this->ComputeValue(*this->m_MultiplyImageFilter, *this->m_DifferenceImageFilter);
+
+} // end GetValue()
+
+
+/**
+ * ********************* ComputeValue ******************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::ComputeValue(
+  MultiplyImageFilterType &   multiplyFilter,
+  DifferenceImageFilterType & differenceFilter) const -> MeasureType
+{
   MeasureType measure = 1e10;
   MeasureType currentMeasure = 1e10;
 
@@ -341,7 +345,7 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
 
     while (tmpfactor <= this->m_NormalizationFactor * 1.0)
     {
-      measure = this->ComputePIDiff(parameters, tmpfactor);
+      measure = this->ComputePIDiff(multiplyFilter, differenceFilter, tmpfactor);
       tmpMeasure = (measure - this->m_FixedMeasure) / -this->m_Rescalingfactor;
 
       if (tmpMeasure < currentMeasure)
@@ -355,13 +359,80 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
   }
   else
   {
-    measure = this->ComputePIDiff(parameters, this->m_NormalizationFactor);
+    measure = this->ComputePIDiff(multiplyFilter, differenceFilter, this->m_NormalizationFactor);
     currentMeasure = -(measure - this->m_FixedMeasure) / this->m_Rescalingfactor;
   }
 
   return currentMeasure;
 
-} // end GetValue()
+} // end ComputeValue()
+
+
+/**
+ * ********************* CreateEvaluationPipeline ******************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::CreateEvaluationPipeline() const
+  -> std::unique_ptr<EvaluationPipeline>
+{
+  /** The pipeline gets a clone of the transform of the ray caster, which combines the transform of the metric with
+   * the pre-transform of the interpolator.
+   */
+  using AdvancedTransformType = typename Superclass::AdvancedTransformType;
+  auto * const rayCaster = dynamic_cast<RayCastInterpolatorType *>(this->m_Interpolator.GetPointer());
+  auto * const transform =
+    (rayCaster == nullptr) ? nullptr : dynamic_cast<AdvancedTransformType *>(rayCaster->GetModifiableTransform());
+  if (transform == nullptr)
+  {
+    return nullptr;
+  }
+
+  const auto transformClone = Superclass::CloneTransform(*transform);
+
+  auto projection = ProjectionPipelineType::Create(*this->m_TransformMovingImageFilter, transformClone.GetPointer());
+  if (projection == nullptr)
+  {
+    return nullptr;
+  }
+
+  /** The difference filter gets a graft of the fixed image, which, unlike the fixed image itself, has no source, so
+   * that updating the difference filter does not visit the upstream pipeline of the fixed image. Each pipeline runs
+   * in a single thread, as the pipelines themselves run concurrently.
+   */
+  const auto fixedImage = FixedImageType::New();
+  fixedImage->Graft(this->m_FixedImage);
+
+  auto pipeline = std::make_unique<EvaluationPipeline>();
+  pipeline->m_Projection = std::move(projection);
+  pipeline->m_MultiplyImageFilter = MultiplyImageFilterType::New();
+  pipeline->m_MultiplyImageFilter->SetNumberOfWorkUnits(1);
+  pipeline->m_MultiplyImageFilter->SetInput(pipeline->m_Projection->GetOutput());
+  pipeline->m_DifferenceImageFilter = DifferenceImageFilterType::New();
+  pipeline->m_DifferenceImageFilter->SetNumberOfWorkUnits(1);
+  pipeline->m_DifferenceImageFilter->SetInput1(fixedImage);
+  pipeline->m_DifferenceImageFilter->SetInput2(pipeline->m_MultiplyImageFilter->GetOutput());
+
+  return pipeline;
+
+} // end CreateEvaluationPipeline()
+
+
+/**
+ * ********************* EvaluatePipeline ******************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::EvaluatePipeline(
+  EvaluationPipeline &            pipeline,
+  const TransformParametersType & parameters) const -> MeasureType
+{
+  pipeline.m_Projection->SetTransformParameters(parameters);
+  return this->ComputeValue(*pipeline.m_MultiplyImageFilter, *pipeline.m_DifferenceImageFilter);
+
+} // end EvaluatePipeline()
 
 
 /**
@@ -373,19 +444,70 @@ void
 PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::GetDerivative(const TransformParametersType & parameters,
                                                                              DerivativeType & derivative) const
 {
-  TransformParametersType testPoint;
-  testPoint = parameters;
   const unsigned int numberOfParameters = this->GetNumberOfParameters();
   derivative = DerivativeType(numberOfParameters);
 
+  /** Test point 2i is parameter i minus its step, test point 2i+1 is parameter i plus its step. */
+  std::vector<double>      steps(numberOfParameters);
+  std::vector<MeasureType> values(2 * numberOfParameters);
+  for (unsigned int i = 0; i < numberOfParameters; ++i)
+  {
+    steps[i] = this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]);
+  }
+
+  auto &             threadPool = elastix::WorkStealingThreadPool::GetInstance();
+  const unsigned int numberOfWorkUnits =
+    static_cast<unsigned int>(std::min<std::size_t>(threadPool.GetNumberOfThreads(), values.size()));
+
+  /** Create an evaluation pipeline for each work unit, unless the transform cannot be cloned. */
+  while (numberOfWorkUnits > 1 && this->m_EvaluationPipelines.size() < numberOfWorkUnits)
+  {
+    auto pipeline = this->CreateEvaluationPipeline();
+    if (pipeline == nullptr)
+    {
+      break;
+    }
+    this->m_EvaluationPipelines.push_back(std::move(pipeline));
+  }
+
+  if (numberOfWorkUnits > 1 && this->m_EvaluationPipelines.size() >= numberOfWorkUnits)
+  {
+    elastix::ChunkedRange testPoints;
+
+    threadPool.ForkJoin(numberOfWorkUnits, [&](unsigned int workUnit) {
+      EvaluationPipeline &    pipeline = *(this->m_EvaluationPipelines[workUnit]);
+      TransformParametersType testPoint = parameters;
+      std::size_t             testPointBegin{};
+      std::size_t             testPointEnd{};
+
+      while (testPoints.GetNextChunk(values.size(), numberOfWorkUnits, testPointBegin, testPointEnd))
+      {
+        for (std::size_t j = testPointBegin; j < testPointEnd; ++j)
+        {
+          const std::size_t i = j / 2;
+          testPoint[i] = parameters[i] + ((j % 2 == 0) ? -steps[i] : steps[i]);
+          values[j] = this->EvaluatePipeline(pipeline, testPoint);
+          testPoint[i] = parameters[i];
+        }
+      }
+    });
+  }
+  else
+  {
+    TransformParametersType testPoint = parameters;
+
+    for (std::size_t j = 0; j < values.size(); ++j)
+    {
+      const std::size_t i = j / 2;
+      testPoint[i] = parameters[i] + ((j % 2 == 0) ? -steps[i] : steps[i]);
+      values[j] = this->GetValue(testPoint);
+      testPoint[i] = parameters[i];
+    }
+  }
+
   for (unsigned int i = 0; i < numberOfParameters; ++i)
   {
-    testPoint[i] -= this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]);
-    const MeasureType valuep0 = this->GetValue(testPoint);
-    testPoint[i] += 2 * this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]);
-    const MeasureType valuep1 = this->GetValue(testPoint);
-    derivative[i] = (valuep1 - valuep0) / (2 * this->m_DerivativeDelta / std::sqrt(this->m_Scales[i]));
-    testPoint[i] = parameters[i];
+    derivative[i] = (values[2 * i + 1] - values[2 * i]) / (2 * steps[i]);
   }
 
 } // end GetDerivative()
@@ -19,6 +19,7 @@
 #define itkTransformRigidityPenaltyTerm_h
 
 #include "itkTransformPenaltyTerm.h"
+#include "elxWorkStealingThreadPool.h"
 
 /** Needed for the check of a B-spline transform. */
 #include "itkAdvancedBSplineDeformableTransform.h"
@@ -29,12 +30,16 @@
 #include "itkImageRegionIterator.h"
 #include "itkNeighborhoodOperatorImageFilter.h"
 #include "itkNeighborhoodIterator.h"
+#include "itkImageRegionSplitterSlowDimension.h"
 
 /** Include stuff needed for the construction of the rigidity coefficient image. */
 #include "itkGrayscaleDilateImageFilter.h"
 #include "itkBinaryBallStructuringElement.h"
 #include "itkImageRegionIterator.h"
 
+#include <algorithm> // For min.
+#include <vector>
+
 namespace itk
 {
 /**
@@ -57,6 +62,12 @@ namespace itk
  *
  * This metric only works with B-splines as a transformation model.
  *
+ * When multi-threading is used, the separable filters of the B-spline coefficient
+ * images are executed concurrently, and the conditions, their derivatives, and the
+ * rigidity coefficient image are computed in parallel, over parts of the B-spline
+ * grid. The filters and intermediate images are created once per resolution (in
+ * Initialize), and reused in all iterations.
+ *
  * References:\n
  * [1] M. Staring, S. Klein and J.P.W. Pluim,
  *    "A Rigidity Penalty Term for Nonrigid Registration,"
@@ -152,6 +163,7 @@ public:
   using CoefficientImageType = typename BSplineTransformType::ImageType;
   using CoefficientImagePointer = typename CoefficientImageType::Pointer;
   using CoefficientImageSpacingType = typename CoefficientImageType::SpacingType;
+  using CoefficientPixelType = typename CoefficientImageType::PixelType;
 
   /** Typedef support for neighborhoods, filters, etc. */
   using NeighborhoodType = Neighborhood<ScalarType, Self::FixedImageDimension>;
@@ -312,9 +324,89 @@ private:
   void
   CreateNDOperator(NeighborhoodType & F, const std::string & whichF, const CoefficientImageSpacingType & spacing) const;
 
-  /** Private function used for the filtering. It performs 1D separable filtering. */
-  CoefficientImagePointer
-  FilterSeparable(const CoefficientImageType *, const std::vector<NeighborhoodType> & Operators) const;
+  /** Sums over (a range of) the B-spline coefficients, one for each condition. */
+  struct ConditionSumsType
+  {
+    MeasureType m_Linearity{};
+    MeasureType m_Orthonormality{};
+    MeasureType m_Properness{};
+  };
+
+  /** The number of operators F_A, F_B, ..., F_I. */
+  static constexpr unsigned int NumberOfOperators = 9;
+
+  /** Private function used for the filtering. It creates the separable filters of all operators and
+   * coefficient images, their ND counterparts, and all intermediate images of GetValueAndDerivative.
+   * These are kept for all iterations of the current resolution, so that their buffers are reused.
+   */
+  void
+  InitializeFiltersAndIntermediateImages();
+
+  /** Private function used for the filtering. It performs the 1D separable filtering of the B-spline
+   * coefficient images, for the operators of the calculated conditions. The filter chains are executed
+   * concurrently.
+   */
+  void
+  FilterCoefficientImages() const;
+
+  /** Computes the values of the conditions and, if computeParts is true, the subparts of their derivatives,
+   * over all B-spline coefficients, in parallel.
+   */
+  ConditionSumsType
+  ComputeConditionValuesAndParts(const bool computeParts) const;
+
+  /** Computes the values of the conditions and, if computeParts is true, the subparts of their derivatives,
+   * over the B-spline coefficients [begin, end).
+   */
+  ConditionSumsType
+  ThreadedComputeConditionValuesAndParts(const SizeValueType begin,
+                                         const SizeValueType end,
+                                         const bool          computeParts) const;
+
+  /** Filters the subparts of the derivatives with the ND operators, over the specified part of the B-spline grid. */
+  void
+  ThreadedFilterParts(const RigidityImageRegionType & regionPart) const;
+
+  /** The number of work units of the parallel loops over the B-spline coefficients. */
+  ThreadIdType
+  GetNumberOfCoefficientWorkUnits() const
+  {
+    return Superclass::m_UseMultiThread ? Self::GetNumberOfWorkUnits() : 1;
+  }
+
+  /** Calls the function for each work unit, passing the work unit and its range [begin, end) of B-spline
+   * coefficients. */
+  template <class TFunction>
+  void
+  ForEachCoefficientRange(const SizeValueType numberOfCoefficients, const TFunction & function) const
+  {
+    const ThreadIdType  numberOfWorkUnits = this->GetNumberOfCoefficientWorkUnits();
+    const SizeValueType coefficientsPerWorkUnit = (numberOfCoefficients + numberOfWorkUnits - 1) / numberOfWorkUnits;
+
+    elastix::WorkStealingThreadPool::GetInstance().ForkJoin(
+      numberOfWorkUnits, [numberOfCoefficients, coefficientsPerWorkUnit, &function](const unsigned int workUnit) {
+        const SizeValueType begin = std::min(workUnit * coefficientsPerWorkUnit, numberOfCoefficients);
+        const SizeValueType end = std::min(begin + coefficientsPerWorkUnit, numberOfCoefficients);
+        function(workUnit, begin, end);
+      });
+  }
+
+  /** Calls the function for each part of the region, one part per work unit. */
+  template <class TFunction>
+  void
+  ForEachRegionPart(const RigidityImageRegionType & region, const TFunction & function) const
+  {
+    const ThreadIdType numberOfWorkUnits = this->GetNumberOfCoefficientWorkUnits();
+    const auto         splitter = ImageRegionSplitterSlowDimension::New();
+    const unsigned int numberOfParts = splitter->GetNumberOfSplits(region, numberOfWorkUnits);
+
+    elastix::WorkStealingThreadPool::GetInstance().ForkJoin(
+      numberOfParts, [&region, &function, &splitter, numberOfParts](const unsigned int workUnit) {
+        RigidityImageRegionType regionPart = region;
+        splitter->GetSplit(workUnit, numberOfParts, regionPart);
+        function(regionPart);
+      });
+  }
 
   /** Member variables. */
   BSplineTransformPointer m_BSplineTransform{};
@@ -350,6 +442,22 @@ private:
   RigidityImagePointer             m_MovingRigidityImageDilated{};
   bool                             m_UseFixedRigidityImage{};
   bool                             m_UseMovingRigidityImage{};
+
+  /** The separable filter chains and their inputs, for operator f and coefficient image d at index
+   * f * ImageDimension + d. The inputs wrap the buffers of the B-spline coefficient images. The chains of
+   * the operators F_C, F_F, F_H and F_I are empty in 2D.
+   */
+  std::vector<std::vector<typename NOIFType::Pointer>> m_SeparableFilters{};
+  std::vector<CoefficientImagePointer>                 m_SeparableFilterInputs{};
+  std::vector<NeighborhoodType>                        m_NDOperators{};
+
+  /** The subparts of the derivatives of the conditions, and their filtered versions. */
+  std::vector<std::vector<CoefficientImagePointer>> m_OrthonormalityParts{};
+  std::vector<std::vector<CoefficientImagePointer>> m_PropernessParts{};
+  std::vector<std::vector<CoefficientImagePointer>> m_LinearityParts{};
+  std::vector<CoefficientImagePointer>              m_OrthonormalityPartsFiltered{};
+  std::vector<CoefficientImagePointer>              m_PropernessPartsFiltered{};
+  std::vector<CoefficientImagePointer>              m_LinearityPartsFiltered{};
 };
 
 } // end namespace itk
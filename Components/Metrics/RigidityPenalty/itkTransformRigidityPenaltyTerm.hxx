@@ -22,6 +22,9 @@
 
 #include "itkZeroFluxNeumannBoundaryCondition.h"
 
+#include <array>
+#include <cmath> // For pow and sqrt.
+
 namespace itk
 {
 
@@ -151,6 +154,9 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::Initialize()
   this->m_RigidityCoefficientImage->SetDirection(localBSplineTransform->GetGridDirection());
   this->m_RigidityCoefficientImage->Allocate();
 
+  /** Create the filters and the intermediate images, for all iterations of this resolution. */
+  this->InitializeFiltersAndIntermediateImages();
+
   if (!this->m_UseFixedRigidityImage && !this->m_UseMovingRigidityImage)
   {
     /** Fill the rigidity coefficient image with ones. */
@@ -338,115 +344,115 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::FillRigidityCoefficientI
   /** Make sure that the transform is up to date. */
   this->m_Transform->SetParameters(parameters);
 
-  /** Create and reset an iterator over m_RigidityCoefficientImage. */
-  RigidityImageIteratorType it(this->m_RigidityCoefficientImage,
-                               this->m_RigidityCoefficientImage->GetLargestPossibleRegion());
-  it.GoToBegin();
-
-  /** Fill m_RigidityCoefficientImage. */
-  RigidityPixelType      fixedValue, movingValue, in;
-  RigidityImagePointType point{};
-  RigidityImageIndexType index1, index2;
-  index1.Fill(0);
-  index2.Fill(0);
-  fixedValue = RigidityPixelType{};
-  movingValue = RigidityPixelType{};
-  in = RigidityPixelType{};
-  bool isInFixedImage = false;
-  bool isInMovingImage = false;
-  while (!it.IsAtEnd())
-  {
-    /** Get current pixel in world coordinates. */
-    this->m_RigidityCoefficientImage->TransformIndexToPhysicalPoint(it.GetIndex(), point);
-
-    /** Get the corresponding indices in the fixed and moving RigidityImage's.
-     * NOTE: Floating point index results are truncated to integers.
-     */
-    if (this->m_UseFixedRigidityImage)
-    {
-      isInFixedImage = this->m_FixedRigidityImageDilated->TransformPhysicalPointToIndex(point, index1);
-      // \todo: Note that we should actually use the inverted initial transform
-      // here, a little bit like:
-      // isInFixedImage = this->m_FixedRigidityImageDilated
-      //   ->TransformPhysicalPointToIndex( this->Transform->GetInitialTransform()
-      //   ->GetInverse()->TransformPoint( point ), index1 );
-      // This is needed to compensate for the B-spline grid shift that has been
-      // performed earlier, which causes the B-spline grid region and thus the
-      // m_RigidityCoefficientImage region to be different from the fixed (coefffient)
-      // image region.
-      //
-      // Since in general the inverse does not exist, alternative strategies may be:
-      // 1) Approximate the inverse of the initial transform using inverse deformation
-      //    field approximation filters available in the ITK
-      // 2) Instead op looping over m_RigidityCoefficientImage, we can loop over
-      //    m_FixedRigidityImageDilated, employ the normal forward initial transform,
-      //    and fill m_RigidityCoefficientImage this way. A downside is that holes may
-      //    be created in the m_RigidityCoefficientImage, although this has low
-      //    likelihood, since the resolution of m_RigidityCoefficientImage is much
-      //    lower than the fixed (rigidity) image. And we could check for these holes
-      //    afterwards.
-      // WARNING: So, currently the rigidity penalty term does not correctly support
-      // initial transforms, in case a fixed coefficient image is provided. It works
-      // correctly if only a moving coefficient image is provided.
-      // Perhaps we should remove the option to supply the fixed coefficient image,
-      // since the moving one should really be used.
-    }
-    if (this->m_UseMovingRigidityImage)
-    {
-      isInMovingImage = this->m_MovingRigidityImageDilated->TransformPhysicalPointToIndex(
-        // this->m_Transform->TransformPoint( point ), index2 );
-        this->m_BSplineTransform->TransformPoint(point),
-        index2);
-    }
-
-    /** Get the values at those positions. */
-    if (this->m_UseFixedRigidityImage)
-    {
-      if (isInFixedImage)
-      {
-        fixedValue = this->m_FixedRigidityImageDilated->GetPixel(index1);
-      }
-      else
+  /** Fill m_RigidityCoefficientImage, in parallel over parts of the B-spline grid. */
+  this->ForEachRegionPart(
+    this->m_RigidityCoefficientImage->GetLargestPossibleRegion(), [this](const RigidityImageRegionType & regionPart) {
+      /** Create and reset an iterator over the part of m_RigidityCoefficientImage. */
+      RigidityImageIteratorType it(this->m_RigidityCoefficientImage, regionPart);
+      it.GoToBegin();
+
+      RigidityPixelType      fixedValue{};
+      RigidityPixelType      movingValue{};
+      RigidityPixelType      in{};
+      RigidityImagePointType point{};
+      RigidityImageIndexType index1{};
+      RigidityImageIndexType index2{};
+      bool                   isInFixedImage = false;
+      bool                   isInMovingImage = false;
+      while (!it.IsAtEnd())
       {
-        fixedValue = 0.0;
-      }
-    }
+        /** Get current pixel in world coordinates. */
+        this->m_RigidityCoefficientImage->TransformIndexToPhysicalPoint(it.GetIndex(), point);
 
-    if (this->m_UseMovingRigidityImage)
-    {
-      if (isInMovingImage)
-      {
-        movingValue = this->m_MovingRigidityImageDilated->GetPixel(index2);
-      }
-      else
-      {
-        movingValue = 0.0;
-      }
-    }
+        /** Get the corresponding indices in the fixed and moving RigidityImage's.
+         * NOTE: Floating point index results are truncated to integers.
+         */
+        if (this->m_UseFixedRigidityImage)
+        {
+          isInFixedImage = this->m_FixedRigidityImageDilated->TransformPhysicalPointToIndex(point, index1);
+          // \todo: Note that we should actually use the inverted initial transform
+          // here, a little bit like:
+          // isInFixedImage = this->m_FixedRigidityImageDilated
+          //   ->TransformPhysicalPointToIndex( this->Transform->GetInitialTransform()
+          //   ->GetInverse()->TransformPoint( point ), index1 );
+          // This is needed to compensate for the B-spline grid shift that has been
+          // performed earlier, which causes the B-spline grid region and thus the
+          // m_RigidityCoefficientImage region to be different from the fixed (coefffient)
+          // image region.
+          //
+          // Since in general the inverse does not exist, alternative strategies may be:
+          // 1) Approximate the inverse of the initial transform using inverse deformation
+          //    field approximation filters available in the ITK
+          // 2) Instead op looping over m_RigidityCoefficientImage, we can loop over
+          //    m_FixedRigidityImageDilated, employ the normal forward initial transform,
+          //    and fill m_RigidityCoefficientImage this way. A downside is that holes may
+          //    be created in the m_RigidityCoefficientImage, although this has low
+          //    likelihood, since the resolution of m_RigidityCoefficientImage is much
+          //    lower than the fixed (rigidity) image. And we could check for these holes
+          //    afterwards.
+          // WARNING: So, currently the rigidity penalty term does not correctly support
+          // initial transforms, in case a fixed coefficient image is provided. It works
+          // correctly if only a moving coefficient image is provided.
+          // Perhaps we should remove the option to supply the fixed coefficient image,
+          // since the moving one should really be used.
+        }
+        if (this->m_UseMovingRigidityImage)
+        {
+          isInMovingImage = this->m_MovingRigidityImageDilated->TransformPhysicalPointToIndex(
+            // this->m_Transform->TransformPoint( point ), index2 );
+            this->m_BSplineTransform->TransformPoint(point),
+            index2);
+        }
 
-    /** Determine the maximum. */
-    if (this->m_UseFixedRigidityImage && this->m_UseMovingRigidityImage)
-    {
-      in = (fixedValue > movingValue ? fixedValue : movingValue);
-    }
-    else if (this->m_UseFixedRigidityImage && !this->m_UseMovingRigidityImage)
-    {
-      in = fixedValue;
-    }
-    else if (!this->m_UseFixedRigidityImage && this->m_UseMovingRigidityImage)
-    {
-      in = movingValue;
-    }
-    /** else{} is not happening here, because we assume that one of them is true.
-     * In our case we checked that in the derived class: elxMattesMIWRR.
-     */
+        /** Get the values at those positions. */
+        if (this->m_UseFixedRigidityImage)
+        {
+          if (isInFixedImage)
+          {
+            fixedValue = this->m_FixedRigidityImageDilated->GetPixel(index1);
+          }
+          else
+          {
+            fixedValue = 0.0;
+          }
+        }
 
-    /** Set it. */
-    it.Set(in);
+        if (this->m_UseMovingRigidityImage)
+        {
+          if (isInMovingImage)
+          {
+            movingValue = this->m_MovingRigidityImageDilated->GetPixel(index2);
+          }
+          else
+          {
+            movingValue = 0.0;
+          }
+        }
 
-    /** Increase iterator. */
-    ++it;
-  } // end while loop over rigidity coefficient image
+        /** Determine the maximum. */
+        if (this->m_UseFixedRigidityImage && this->m_UseMovingRigidityImage)
+        {
+          in = (fixedValue > movingValue ? fixedValue : movingValue);
+        }
+        else if (this->m_UseFixedRigidityImage && !this->m_UseMovingRigidityImage)
+        {
+          in = fixedValue;
+        }
+        else if (!this->m_UseFixedRigidityImage && this->m_UseMovingRigidityImage)
+        {
+          in = movingValue;
+        }
+        /** else{} is not happening here, because we assume that one of them is true.
+         * In our case we checked that in the derived class: elxMattesMIWRR.
+         */
+
+        /** Set it. */
+        it.Set(in);
+
+        /** Increase iterator. */
+        ++it;
+      } // end while loop over rigidity coefficient image
+    });
 
   /** Remember that the rigidity coefficient image is filled. */
   this->m_RigidityCoefficientImageIsFilled = true;
@@ -482,16 +488,6 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValue(const Parameter
     itkExceptionMacro("ERROR: This filter is only implemented for dimension 2 and 3.");
   }
 
-  /** Get a handle to the B-spline coefficient images. */
-  std::vector<CoefficientImagePointer> inputImages(ImageDimension);
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    inputImages[i] = this->m_BSplineTransform->GetCoefficientImages()[i];
-  }
-
-  /** Get the B-spline coefficient image spacing. */
-  CoefficientImageSpacingType spacing = inputImages[0]->GetSpacing();
-
   /** TASK 0:
    * Compute the rigidityCoefficientSum and check on it.
    *
@@ -518,291 +514,24 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValue(const Parameter
   }
 
   /** TASK 1:
-   * Prepare for the calculation of the rigidity penalty term.
-   *
-   ************************************************************************* */
-
-  /** Create 1D neighbourhood operators. */
-  std::vector<NeighborhoodType> Operators_A(ImageDimension), Operators_B(ImageDimension), Operators_C(ImageDimension),
-    Operators_D(ImageDimension), Operators_E(ImageDimension), Operators_F(ImageDimension), Operators_G(ImageDimension),
-    Operators_H(ImageDimension), Operators_I(ImageDimension);
-
-  /** Create B-spline coefficient images that are filtered once. */
-  std::vector<CoefficientImagePointer> ui_FA(ImageDimension), ui_FB(ImageDimension), ui_FC(ImageDimension),
-    ui_FD(ImageDimension), ui_FE(ImageDimension), ui_FF(ImageDimension), ui_FG(ImageDimension), ui_FH(ImageDimension),
-    ui_FI(ImageDimension);
-
-  /** For all dimensions ... */
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    /** ... create the filtered images ... */
-    ui_FA[i] = CoefficientImageType::New();
-    ui_FB[i] = CoefficientImageType::New();
-    ui_FD[i] = CoefficientImageType::New();
-    ui_FE[i] = CoefficientImageType::New();
-    ui_FG[i] = CoefficientImageType::New();
-    if (ImageDimension == 3)
-    {
-      ui_FC[i] = CoefficientImageType::New();
-      ui_FF[i] = CoefficientImageType::New();
-      ui_FH[i] = CoefficientImageType::New();
-      ui_FI[i] = CoefficientImageType::New();
-    }
-    /** ... and the apropiate operators.
-     * The operators C, D and E from the paper are here created
-     * by Create1DOperator D, E and G, because of the 3D case and history.
-     */
-    this->Create1DOperator(Operators_A[i], "FA_xi", i + 1, spacing);
-    this->Create1DOperator(Operators_B[i], "FB_xi", i + 1, spacing);
-    this->Create1DOperator(Operators_D[i], "FD_xi", i + 1, spacing);
-    this->Create1DOperator(Operators_E[i], "FE_xi", i + 1, spacing);
-    this->Create1DOperator(Operators_G[i], "FG_xi", i + 1, spacing);
-    if (ImageDimension == 3)
-    {
-      this->Create1DOperator(Operators_C[i], "FC_xi", i + 1, spacing);
-      this->Create1DOperator(Operators_F[i], "FF_xi", i + 1, spacing);
-      this->Create1DOperator(Operators_H[i], "FH_xi", i + 1, spacing);
-      this->Create1DOperator(Operators_I[i], "FI_xi", i + 1, spacing);
-    }
-  } // end for loop
-
-  /** TASK 2:
    * Filter the B-spline coefficient images.
    *
    ************************************************************************* */
 
-  /** Filter the inputImages. */
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    ui_FA[i] = this->FilterSeparable(inputImages[i], Operators_A);
-    ui_FB[i] = this->FilterSeparable(inputImages[i], Operators_B);
-    ui_FD[i] = this->FilterSeparable(inputImages[i], Operators_D);
-    ui_FE[i] = this->FilterSeparable(inputImages[i], Operators_E);
-    ui_FG[i] = this->FilterSeparable(inputImages[i], Operators_G);
-    if (ImageDimension == 3)
-    {
-      ui_FC[i] = this->FilterSeparable(inputImages[i], Operators_C);
-      ui_FF[i] = this->FilterSeparable(inputImages[i], Operators_F);
-      ui_FH[i] = this->FilterSeparable(inputImages[i], Operators_H);
-      ui_FI[i] = this->FilterSeparable(inputImages[i], Operators_I);
-    }
-  }
-
-  /** TASK 3:
-   * Create iterators.
-   *
-   ************************************************************************* */
-
-  /** Create iterators over ui_F?. */
-  std::vector<CoefficientImageIteratorType> itA(ImageDimension), itB(ImageDimension), itC(ImageDimension),
-    itD(ImageDimension), itE(ImageDimension), itF(ImageDimension), itG(ImageDimension), itH(ImageDimension),
-    itI(ImageDimension);
-
-  /** Create iterators. */
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    /** Create iterators. */
-    itA[i] = CoefficientImageIteratorType(ui_FA[i], ui_FA[i]->GetLargestPossibleRegion());
-    itB[i] = CoefficientImageIteratorType(ui_FB[i], ui_FB[i]->GetLargestPossibleRegion());
-    itD[i] = CoefficientImageIteratorType(ui_FD[i], ui_FD[i]->GetLargestPossibleRegion());
-    itE[i] = CoefficientImageIteratorType(ui_FE[i], ui_FE[i]->GetLargestPossibleRegion());
-    itG[i] = CoefficientImageIteratorType(ui_FG[i], ui_FG[i]->GetLargestPossibleRegion());
-    if (ImageDimension == 3)
-    {
-      itC[i] = CoefficientImageIteratorType(ui_FC[i], ui_FC[i]->GetLargestPossibleRegion());
-      itF[i] = CoefficientImageIteratorType(ui_FF[i], ui_FF[i]->GetLargestPossibleRegion());
-      itH[i] = CoefficientImageIteratorType(ui_FH[i], ui_FH[i]->GetLargestPossibleRegion());
-      itI[i] = CoefficientImageIteratorType(ui_FI[i], ui_FI[i]->GetLargestPossibleRegion());
-    }
-    /** Reset iterators. */
-    itA[i].GoToBegin();
-    itB[i].GoToBegin();
-    itD[i].GoToBegin();
-    itE[i].GoToBegin();
-    itG[i].GoToBegin();
-    if (ImageDimension == 3)
-    {
-      itC[i].GoToBegin();
-      itF[i].GoToBegin();
-      itH[i].GoToBegin();
-      itI[i].GoToBegin();
-    }
-  }
-
-  /** TASK 4A:
-   * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the orthonormality term.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if (this->m_CalculateOrthonormalityCondition)
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    while (!itA[0].IsAtEnd())
-    {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[0].Get();
-      mu2_A = itA[1].Get();
-      mu1_B = itB[0].Get();
-      mu2_B = itB[1].Get();
-      if (ImageDimension == 3)
-      {
-        mu3_A = itA[2].Get();
-        mu3_B = itB[2].Get();
-        mu1_C = itC[0].Get();
-        mu2_C = itC[1].Get();
-        mu3_C = itC[2].Get();
-      }
-
-      if (ImageDimension == 2)
-      {
-        this->m_OrthonormalityConditionValue +=
-          it_RCI.Get() * (std::pow(+(1.0 + mu1_A) * (1.0 + mu1_A) + mu2_A * mu2_A - 1.0, 2.0) +
-                          std::pow(+mu1_B * mu1_B + (1.0 + mu2_B) * (1.0 + mu2_B) - 1.0, 2.0) +
-                          std::pow(+(1.0 + mu1_A) * mu1_B + mu2_A * (1.0 + mu2_B), 2.0));
-      }
-      else if (ImageDimension == 3)
-      {
-        this->m_OrthonormalityConditionValue +=
-          it_RCI.Get() * (std::pow(+(1.0 + mu1_A) * (1.0 + mu1_A) + mu2_A * mu2_A + mu3_A * mu3_A - 1.0, 2.0) +
-                          std::pow(+(1.0 + mu1_A) * mu1_B + mu2_A * (1.0 + mu2_B) + mu3_A * mu3_B, 2.0) +
-                          std::pow(+(1.0 + mu1_A) * mu1_C + mu2_A * mu2_C + mu3_A * (1.0 + mu3_C), 2.0) +
-                          std::pow(+mu1_B * mu1_B + (1.0 + mu2_B) * (1.0 + mu2_B) + mu3_B * mu3_B - 1.0, 2.0) +
-                          std::pow(+mu1_B * mu1_C + (1.0 + mu2_B) * mu2_C + mu3_B * (1.0 + mu3_C), 2.0) +
-                          std::pow(+mu1_C * mu1_C + mu2_C * mu2_C + (1.0 + mu3_C) * (1.0 + mu3_C) - 1.0, 2.0));
-      }
-
-      /** Increase all iterators. */
-      for (unsigned int i = 0; i < ImageDimension; ++i)
-      {
-        ++itA[i];
-        ++itB[i];
-        if (ImageDimension == 3)
-        {
-          ++itC[i];
-        }
-      }
-      ++it_RCI;
-    } // end while
-  }   // end if do orthonormality
-
-  /** TASK 4B:
-   * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the properness term.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    itA[i].GoToBegin();
-    itB[i].GoToBegin();
-    if (ImageDimension == 3)
-    {
-      itC[i].GoToBegin();
-    }
-  }
-  it_RCI.GoToBegin();
-
-  if (this->m_CalculatePropernessCondition)
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    while (!itA[0].IsAtEnd())
-    {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[0].Get();
-      mu2_A = itA[1].Get();
-      mu1_B = itB[0].Get();
-      mu2_B = itB[1].Get();
-      if (ImageDimension == 3)
-      {
-        mu3_A = itA[2].Get();
-        mu3_B = itB[2].Get();
-        mu1_C = itC[0].Get();
-        mu2_C = itC[1].Get();
-        mu3_C = itC[2].Get();
-      }
-
-      if (ImageDimension == 2)
-      {
-        this->m_PropernessConditionValue +=
-          it_RCI.Get() * (std::pow(+(1.0 + mu1_A) * (1.0 + mu2_B) - mu2_A * mu1_B - 1.0, 2.0));
-      }
-      else if (ImageDimension == 3)
-      {
-        this->m_PropernessConditionValue +=
-          it_RCI.Get() * (std::pow(-mu1_C * (1.0 + mu2_B) * mu3_A + mu1_B * mu2_C * mu3_A + mu1_C * mu2_A * mu3_B -
-                                     (1.0 + mu1_A) * mu2_C * mu3_B - mu1_B * mu2_A * (1.0 + mu3_C) +
-                                     (1.0 + mu1_A) * (1.0 + mu2_B) * (1.0 + mu3_C) - 1.0,
-                                   2.0));
-      }
+  this->FilterCoefficientImages();
 
-      /** Increase all iterators. */
-      for (unsigned int i = 0; i < ImageDimension; ++i)
-      {
-        ++itA[i];
-        ++itB[i];
-        if (ImageDimension == 3)
-        {
-          ++itC[i];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
-  }   // end if do properness
-
-  /** TASK 4C:
+  /** TASK 2:
    * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the linearity term.
+   * Calculate the orthonormality, properness and linearity terms.
    *
    ************************************************************************* */
 
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if (this->m_CalculateLinearityCondition)
-  {
-    while (!itD[0].IsAtEnd())
-    {
-      /** Linearity condition part. */
-      for (unsigned int i = 0; i < ImageDimension; ++i)
-      {
-        this->m_LinearityConditionValue +=
-          it_RCI.Get() * (+itD[i].Get() * itD[i].Get() + itE[i].Get() * itE[i].Get() + itG[i].Get() * itG[i].Get());
-        if (ImageDimension == 3)
-        {
-          this->m_LinearityConditionValue +=
-            it_RCI.Get() * (+itF[i].Get() * itF[i].Get() + itH[i].Get() * itH[i].Get() + itI[i].Get() * itI[i].Get());
-        }
-      } // end loop over i
-
-      /** Increase all iterators. */
-      for (unsigned int i = 0; i < ImageDimension; ++i)
-      {
-        ++itD[i];
-        ++itE[i];
-        ++itG[i];
-        if (ImageDimension == 3)
-        {
-          ++itF[i];
-          ++itH[i];
-          ++itI[i];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
-  }   // end if do properness
+  const ConditionSumsType conditionValues = this->ComputeConditionValuesAndParts(false);
+  this->m_LinearityConditionValue = conditionValues.m_Linearity;
+  this->m_OrthonormalityConditionValue = conditionValues.m_Orthonormality;
+  this->m_PropernessConditionValue = conditionValues.m_Properness;
 
-  /** TASK 5:
+  /** TASK 3:
    * Do the actual calculation of the rigidity penalty term value.
    *
    ************************************************************************* */
@@ -925,16 +654,6 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
     itkExceptionMacro("ERROR: This filter is only implemented for dimension 2 and 3.");
   }
 
-  /** Get a handle to the B-spline coefficient images. */
-  std::vector<CoefficientImagePointer> inputImages(ImageDimension);
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    inputImages[i] = this->m_BSplineTransform->GetCoefficientImages()[i];
-  }
-
-  /** Get the B-spline coefficient image spacing. */
-  CoefficientImageSpacingType spacing = inputImages[0]->GetSpacing();
-
   /** TASK 0:
    * Compute the rigidityCoefficientSum and check on it.
    *
@@ -961,379 +680,427 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
   }
 
   /** TASK 1:
-   * Prepare for the calculation of the rigidity penalty term.
+   * Filter the B-spline coefficient images.
    *
    ************************************************************************* */
 
-  /** Create 1D neighbourhood operators. */
-  std::vector<NeighborhoodType> Operators_A(ImageDimension), Operators_B(ImageDimension), Operators_C(ImageDimension),
-    Operators_D(ImageDimension), Operators_E(ImageDimension), Operators_F(ImageDimension), Operators_G(ImageDimension),
-    Operators_H(ImageDimension), Operators_I(ImageDimension);
+  this->FilterCoefficientImages();
 
-  /** Create B-spline coefficient images that are filtered once. */
-  std::vector<CoefficientImagePointer> ui_FA(ImageDimension), ui_FB(ImageDimension), ui_FC(ImageDimension),
-    ui_FD(ImageDimension), ui_FE(ImageDimension), ui_FF(ImageDimension), ui_FG(ImageDimension), ui_FH(ImageDimension),
-    ui_FI(ImageDimension);
+  /** TASK 2:
+   * Calculate the values of the conditions, and the subparts of their derivatives.
+   *
+   ************************************************************************* */
 
-  /** For all dimensions ... */
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    /** ... create the filtered images ... */
-    ui_FA[i] = CoefficientImageType::New();
-    ui_FB[i] = CoefficientImageType::New();
-    ui_FD[i] = CoefficientImageType::New();
-    ui_FE[i] = CoefficientImageType::New();
-    ui_FG[i] = CoefficientImageType::New();
-    if (ImageDimension == 3)
-    {
-      ui_FC[i] = CoefficientImageType::New();
-      ui_FF[i] = CoefficientImageType::New();
-      ui_FH[i] = CoefficientImageType::New();
-      ui_FI[i] = CoefficientImageType::New();
-    }
-    /** ... and the apropiate operators.
-     * The operators C, D and E from the paper are here created
-     * by Create1DOperator D, E and G, because of the 3D case and history.
-     */
-    this->Create1DOperator(Operators_A[i], "FA_xi", i + 1, spacing);
-    this->Create1DOperator(Operators_B[i], "FB_xi", i + 1, spacing);
-    this->Create1DOperator(Operators_D[i], "FD_xi", i + 1, spacing);
-    this->Create1DOperator(Operators_E[i], "FE_xi", i + 1, spacing);
-    this->Create1DOperator(Operators_G[i], "FG_xi", i + 1, spacing);
-    if (ImageDimension == 3)
-    {
-      this->Create1DOperator(Operators_C[i], "FC_xi", i + 1, spacing);
-      this->Create1DOperator(Operators_F[i], "FF_xi", i + 1, spacing);
-      this->Create1DOperator(Operators_H[i], "FH_xi", i + 1, spacing);
-      this->Create1DOperator(Operators_I[i], "FI_xi", i + 1, spacing);
-    }
-  } // end for loop
+  const ConditionSumsType conditionValues = this->ComputeConditionValuesAndParts(true);
+  this->m_LinearityConditionValue = conditionValues.m_Linearity;
+  this->m_OrthonormalityConditionValue = conditionValues.m_Orthonormality;
+  this->m_PropernessConditionValue = conditionValues.m_Properness;
 
-  /** TASK 2:
-   * Filter the B-spline coefficient images.
+  /** TASK 3:
+   * Do the actual calculation of the rigidity penalty term value.
    *
    ************************************************************************* */
 
-  /** Filter the inputImages. */
-  for (unsigned int i = 0; i < ImageDimension; ++i)
+  /** Calculate the rigidity penalty term value. */
+  if (this->m_CalculateLinearityCondition)
   {
-    ui_FA[i] = this->FilterSeparable(inputImages[i], Operators_A);
-    ui_FB[i] = this->FilterSeparable(inputImages[i], Operators_B);
-    ui_FD[i] = this->FilterSeparable(inputImages[i], Operators_D);
-    ui_FE[i] = this->FilterSeparable(inputImages[i], Operators_E);
-    ui_FG[i] = this->FilterSeparable(inputImages[i], Operators_G);
-    if (ImageDimension == 3)
-    {
-      ui_FC[i] = this->FilterSeparable(inputImages[i], Operators_C);
-      ui_FF[i] = this->FilterSeparable(inputImages[i], Operators_F);
-      ui_FH[i] = this->FilterSeparable(inputImages[i], Operators_H);
-      ui_FI[i] = this->FilterSeparable(inputImages[i], Operators_I);
-    }
+    this->m_LinearityConditionValue /= rigidityCoefficientSum;
+  }
+  if (this->m_CalculateOrthonormalityCondition)
+  {
+    this->m_OrthonormalityConditionValue /= rigidityCoefficientSum;
+  }
+  if (this->m_CalculatePropernessCondition)
+  {
+    this->m_PropernessConditionValue /= rigidityCoefficientSum;
   }
 
-  /** TASK 3:
-   * Create subparts and iterators.
-   *
+  if (this->m_UseLinearityCondition)
+  {
+    this->m_RigidityPenaltyTermValue += this->m_LinearityConditionWeight * this->m_LinearityConditionValue;
+  }
+  if (this->m_UseOrthonormalityCondition)
+  {
+    this->m_RigidityPenaltyTermValue += this->m_OrthonormalityConditionWeight * this->m_OrthonormalityConditionValue;
+  }
+  if (this->m_UsePropernessCondition)
+  {
+    this->m_RigidityPenaltyTermValue += this->m_PropernessConditionWeight * this->m_PropernessConditionValue;
+  }
+  value = this->m_RigidityPenaltyTermValue;
+
+  /** TASK 4:
+   * Calculate the filtered versions of the subparts, in parallel over parts of the B-spline grid.
    ************************************************************************* */
 
-  /** Create iterators over ui_F?. */
-  std::vector<CoefficientImageIteratorType> itA(ImageDimension), itB(ImageDimension), itC(ImageDimension),
-    itD(ImageDimension), itE(ImageDimension), itF(ImageDimension), itG(ImageDimension), itH(ImageDimension),
-    itI(ImageDimension);
+  this->ForEachRegionPart(
+    this->m_RigidityCoefficientImage->GetLargestPossibleRegion(),
+    [this](const RigidityImageRegionType & regionPart) { this->ThreadedFilterParts(regionPart); });
+
+  /** TASK 5:
+   * Add it all to create the final derivative.
+   ************************************************************************* */
+
+  // NOTE: unlike the values, for the derivatives weight * derivative is returned.
+  const SizeValueType numberOfCoefficients =
+    this->m_RigidityCoefficientImage->GetLargestPossibleRegion().GetNumberOfPixels();
+  const double                   rigidityCoefficientSumSqr = rigidityCoefficientSum * rigidityCoefficientSum;
+  std::vector<ConditionSumsType> squaredGradientMagnitudes(this->GetNumberOfCoefficientWorkUnits());
+
+  this->ForEachCoefficientRange(
+    numberOfCoefficients,
+    [&](const unsigned int workUnit, const SizeValueType begin, const SizeValueType end) {
+      ConditionSumsType & gradMag = squaredGradientMagnitudes[workUnit];
+      for (unsigned int i = 0; i < ImageDimension; ++i)
+      {
+        const CoefficientPixelType * const LCpf = this->m_LinearityPartsFiltered[i]->GetBufferPointer();
+        const CoefficientPixelType * const OCpf = this->m_OrthonormalityPartsFiltered[i]->GetBufferPointer();
+        const CoefficientPixelType * const PCpf = this->m_PropernessPartsFiltered[i]->GetBufferPointer();
+
+        for (SizeValueType k = begin; k < end; ++k)
+        {
+          ScalarType tmpDIs{};
+
+          /** Compute gradient magnitude and derivative contribution of LC. */
+          if (this->m_CalculateLinearityCondition)
+          {
+            const ScalarType tmpLC = this->m_LinearityConditionWeight * LCpf[k];
+            gradMag.m_Linearity += tmpLC * tmpLC / rigidityCoefficientSumSqr;
+            if (this->m_UseLinearityCondition)
+            {
+              tmpDIs += tmpLC;
+            }
+          }
+
+          /** Compute gradient magnitude and derivative contribution of OC. */
+          if (this->m_CalculateOrthonormalityCondition)
+          {
+            const ScalarType tmpOC = this->m_OrthonormalityConditionWeight * OCpf[k];
+            gradMag.m_Orthonormality += tmpOC * tmpOC / rigidityCoefficientSumSqr;
+            if (this->m_UseOrthonormalityCondition)
+            {
+              tmpDIs += tmpOC;
+            }
+          }
+
+          /** Compute gradient magnitude and derivative contribution of PC. */
+          if (this->m_CalculatePropernessCondition)
+          {
+            const ScalarType tmpPC = this->m_PropernessConditionWeight * PCpf[k];
+            gradMag.m_Properness += tmpPC * tmpPC / rigidityCoefficientSumSqr;
+            if (this->m_UsePropernessCondition)
+            {
+              tmpDIs += tmpPC;
+            }
+          }
+
+          /** The derivative consists of the coefficients of dimension 0, followed by those of dimension 1, etc. */
+          derivative[i * numberOfCoefficients + k] = tmpDIs / rigidityCoefficientSum;
+        }
+      }
+    });
+
+  /** Set the gradient magnitudes of the several terms. */
+  ConditionSumsType gradMag;
+  for (const ConditionSumsType & squaredGradientMagnitude : squaredGradientMagnitudes)
+  {
+    gradMag.m_Linearity += squaredGradientMagnitude.m_Linearity;
+    gradMag.m_Orthonormality += squaredGradientMagnitude.m_Orthonormality;
+    gradMag.m_Properness += squaredGradientMagnitude.m_Properness;
+  }
+  this->m_LinearityConditionGradientMagnitude = std::sqrt(gradMag.m_Linearity);
+  this->m_OrthonormalityConditionGradientMagnitude = std::sqrt(gradMag.m_Orthonormality);
+  this->m_PropernessConditionGradientMagnitude = std::sqrt(gradMag.m_Properness);
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * *********************** ComputeConditionValuesAndParts ****************
+ */
+
+template <class TFixedImage, class TScalarType>
+auto
+TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::ComputeConditionValuesAndParts(const bool computeParts) const
+  -> ConditionSumsType
+{
+  const SizeValueType numberOfCoefficients =
+    this->m_RigidityCoefficientImage->GetLargestPossibleRegion().GetNumberOfPixels();
+
+  /** Compute the values of the work units, and add them, in the order of the work units. */
+  std::vector<ConditionSumsType> valuesPerWorkUnit(this->GetNumberOfCoefficientWorkUnits());
+  this->ForEachCoefficientRange(
+    numberOfCoefficients,
+    [this, computeParts, &valuesPerWorkUnit](
+      const unsigned int workUnit, const SizeValueType begin, const SizeValueType end) {
+      valuesPerWorkUnit[workUnit] = this->ThreadedComputeConditionValuesAndParts(begin, end, computeParts);
+    });
 
-  /** Create iterators. */
-  for (unsigned int i = 0; i < ImageDimension; ++i)
+  ConditionSumsType values;
+  for (const ConditionSumsType & valuesOfWorkUnit : valuesPerWorkUnit)
   {
-    /** Create iterators. */
-    itA[i] = CoefficientImageIteratorType(ui_FA[i], ui_FA[i]->GetLargestPossibleRegion());
-    itB[i] = CoefficientImageIteratorType(ui_FB[i], ui_FB[i]->GetLargestPossibleRegion());
-    itD[i] = CoefficientImageIteratorType(ui_FD[i], ui_FD[i]->GetLargestPossibleRegion());
-    itE[i] = CoefficientImageIteratorType(ui_FE[i], ui_FE[i]->GetLargestPossibleRegion());
-    itG[i] = CoefficientImageIteratorType(ui_FG[i], ui_FG[i]->GetLargestPossibleRegion());
-    if (ImageDimension == 3)
-    {
-      itC[i] = CoefficientImageIteratorType(ui_FC[i], ui_FC[i]->GetLargestPossibleRegion());
-      itF[i] = CoefficientImageIteratorType(ui_FF[i], ui_FF[i]->GetLargestPossibleRegion());
-      itH[i] = CoefficientImageIteratorType(ui_FH[i], ui_FH[i]->GetLargestPossibleRegion());
-      itI[i] = CoefficientImageIteratorType(ui_FI[i], ui_FI[i]->GetLargestPossibleRegion());
-    }
-    /** Reset iterators. */
-    itA[i].GoToBegin();
-    itB[i].GoToBegin();
-    itD[i].GoToBegin();
-    itE[i].GoToBegin();
-    itG[i].GoToBegin();
-    if (ImageDimension == 3)
-    {
-      itC[i].GoToBegin();
-      itF[i].GoToBegin();
-      itH[i].GoToBegin();
-      itI[i].GoToBegin();
-    }
+    values.m_Linearity += valuesOfWorkUnit.m_Linearity;
+    values.m_Orthonormality += valuesOfWorkUnit.m_Orthonormality;
+    values.m_Properness += valuesOfWorkUnit.m_Properness;
   }
+  return values;
 
-  /** Create orthonormality and properness parts. */
-  std::vector<std::vector<CoefficientImagePointer>> OCparts(ImageDimension);
-  std::vector<std::vector<CoefficientImagePointer>> PCparts(ImageDimension);
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    OCparts[i].resize(ImageDimension);
-    PCparts[i].resize(ImageDimension);
-    for (unsigned int j = 0; j < ImageDimension; ++j)
-    {
-      OCparts[i][j] = CoefficientImageType::New();
-      OCparts[i][j]->SetRegions(inputImages[0]->GetLargestPossibleRegion());
-      OCparts[i][j]->Allocate();
-      PCparts[i][j] = CoefficientImageType::New();
-      PCparts[i][j]->SetRegions(inputImages[0]->GetLargestPossibleRegion());
-      PCparts[i][j]->Allocate();
-    }
-  }
+} // end ComputeConditionValuesAndParts()
 
-  /** Create linearity parts. */
-  unsigned int                                      NofLParts = 3 * ImageDimension - 3;
-  std::vector<std::vector<CoefficientImagePointer>> LCparts(ImageDimension);
-  for (unsigned int i = 0; i < ImageDimension; ++i)
+
+/**
+ * *********************** ThreadedComputeConditionValuesAndParts ****************
+ */
+
+template <class TFixedImage, class TScalarType>
+auto
+TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::ThreadedComputeConditionValuesAndParts(
+  const SizeValueType begin,
+  const SizeValueType end,
+  const bool          computeParts) const -> ConditionSumsType
+{
+  /** Get the buffers of the filtered B-spline coefficient images: A[ i ] is coefficient image i,
+   * filtered by F_A, etc. All images share the region of the B-spline grid, so they are indexed alike.
+   */
+  std::vector<std::vector<const CoefficientPixelType *>> filtered(
+    NumberOfOperators, std::vector<const CoefficientPixelType *>(ImageDimension, nullptr));
+  for (unsigned int f = 0; f < NumberOfOperators; ++f)
   {
-    LCparts[i].resize(NofLParts);
-    for (unsigned int j = 0; j < NofLParts; ++j)
+    for (unsigned int i = 0; i < ImageDimension; ++i)
     {
-      LCparts[i][j] = CoefficientImageType::New();
-      LCparts[i][j]->SetRegions(inputImages[0]->GetLargestPossibleRegion());
-      LCparts[i][j]->Allocate();
+      const auto & filters = this->m_SeparableFilters[f * ImageDimension + i];
+      if (!filters.empty())
+      {
+        filtered[f][i] = filters.back()->GetOutput()->GetBufferPointer();
+      }
     }
   }
+  const auto & A = filtered[0];
+  const auto & B = filtered[1];
+  const auto & C = filtered[2];
+  const auto & D = filtered[3];
+  const auto & E = filtered[4];
+  const auto & F = filtered[5];
+  const auto & G = filtered[6];
+  const auto & H = filtered[7];
+  const auto & I = filtered[8];
 
-  /** Create iterators over all parts. */
-  std::vector<std::vector<CoefficientImageIteratorType>> itOCp(ImageDimension);
-  std::vector<std::vector<CoefficientImageIteratorType>> itPCp(ImageDimension);
-  std::vector<std::vector<CoefficientImageIteratorType>> itLCp(ImageDimension);
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    itOCp[i].resize(ImageDimension);
-    itPCp[i].resize(ImageDimension);
-    itLCp[i].resize(NofLParts);
-    for (unsigned int j = 0; j < ImageDimension; ++j)
-    {
-      itOCp[i][j] = CoefficientImageIteratorType(OCparts[i][j], OCparts[i][j]->GetLargestPossibleRegion());
-      itOCp[i][j].GoToBegin();
-      itPCp[i][j] = CoefficientImageIteratorType(PCparts[i][j], PCparts[i][j]->GetLargestPossibleRegion());
-      itPCp[i][j].GoToBegin();
-    }
-    for (unsigned int j = 0; j < NofLParts; ++j)
+  /** Get the buffers of the rigidity coefficient image and the subparts. */
+  const CoefficientPixelType * const RCI = this->m_RigidityCoefficientImage->GetBufferPointer();
+
+  const auto getBuffers = [](const std::vector<std::vector<CoefficientImagePointer>> & parts) {
+    std::vector<std::vector<CoefficientPixelType *>> buffers(parts.size());
+    for (unsigned int i = 0; i < parts.size(); ++i)
     {
-      itLCp[i][j] = CoefficientImageIteratorType(LCparts[i][j], LCparts[i][j]->GetLargestPossibleRegion());
-      itLCp[i][j].GoToBegin();
+      for (const auto & part : parts[i])
+      {
+        buffers[i].push_back(part->GetBufferPointer());
+      }
     }
-  }
+    return buffers;
+  };
+  const auto OCp = getBuffers(this->m_OrthonormalityParts);
+  const auto PCp = getBuffers(this->m_PropernessParts);
+  const auto LCp = getBuffers(this->m_LinearityParts);
+
+  ConditionSumsType values;
 
-  /** TASK 4A:
-   * Do the calculation of the orthonormality subparts.
+  /** TASK 1A:
+   * Calculate the orthonormality condition, and its subparts.
    *
    ************************************************************************* */
 
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
   if (this->m_CalculateOrthonormalityCondition)
   {
     ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
     ScalarType valueOC;
-    while (!itOCp[0][0].IsAtEnd())
+    for (SizeValueType k = begin; k < end; ++k)
     {
       /** Copy values: this way we avoid calling Get() so many times.
        * It also improves code readability.
        */
-      mu1_A = itA[0].Get();
-      mu2_A = itA[1].Get();
-      mu1_B = itB[0].Get();
-      mu2_B = itB[1].Get();
+      mu1_A = A[0][k];
+      mu2_A = A[1][k];
+      mu1_B = B[0][k];
+      mu2_B = B[1][k];
       if (ImageDimension == 3)
       {
-        mu3_A = itA[2].Get();
-        mu3_B = itB[2].Get();
-        mu1_C = itC[0].Get();
-        mu2_C = itC[1].Get();
-        mu3_C = itC[2].Get();
+        mu3_A = A[2][k];
+        mu3_B = B[2][k];
+        mu1_C = C[0][k];
+        mu2_C = C[1][k];
+        mu3_C = C[2][k];
       }
       if (ImageDimension == 2)
       {
         /** Calculate the value of the orthonormality condition. */
-        this->m_OrthonormalityConditionValue +=
-          it_RCI.Get() * (std::pow(+(1.0 + mu1_A) * (1.0 + mu1_A) + mu2_A * mu2_A - 1.0, 2.0) +
-                          std::pow(+mu1_B * mu1_B + (1.0 + mu2_B) * (1.0 + mu2_B) - 1.0, 2.0) +
-                          std::pow(+(1.0 + mu1_A) * mu1_B + mu2_A * (1.0 + mu2_B), 2.0));
-        /** Calculate the derivative of the orthonormality condition. */
+        values.m_Orthonormality +=
+          RCI[k] * (std::pow(+(1.0 + mu1_A) * (1.0 + mu1_A) + mu2_A * mu2_A - 1.0, 2.0) +
+                    std::pow(+mu1_B * mu1_B + (1.0 + mu2_B) * (1.0 + mu2_B) - 1.0, 2.0) +
+                    std::pow(+(1.0 + mu1_A) * mu1_B + mu2_A * (1.0 + mu2_B), 2.0));
+      }
+      else if (ImageDimension == 3)
+      {
+        /** Calculate the value of the orthonormality condition. */
+        values.m_Orthonormality +=
+          RCI[k] * (std::pow(+(1.0 + mu1_A) * (1.0 + mu1_A) + mu2_A * mu2_A + mu3_A * mu3_A - 1.0, 2.0) +
+                    std::pow(+(1.0 + mu1_A) * mu1_B + mu2_A * (1.0 + mu2_B) + mu3_A * mu3_B, 2.0) +
+                    std::pow(+(1.0 + mu1_A) * mu1_C + mu2_A * mu2_C + mu3_A * (1.0 + mu3_C), 2.0) +
+                    std::pow(+mu1_B * mu1_B + (1.0 + mu2_B) * (1.0 + mu2_B) + mu3_B * mu3_B - 1.0, 2.0) +
+                    std::pow(+mu1_B * mu1_C + (1.0 + mu2_B) * mu2_C + mu3_B * (1.0 + mu3_C), 2.0) +
+                    std::pow(+mu1_C * mu1_C + mu2_C * mu2_C + (1.0 + mu3_C) * (1.0 + mu3_C) - 1.0, 2.0));
+      }
+
+      if (!computeParts)
+      {
+        continue;
+      }
+
+      /** Calculate the derivative of the orthonormality condition. */
+      if (ImageDimension == 2)
+      {
         /** mu1, part 1 */
         valueOC = +2.0 * (1.0 + mu1_A) * (1.0 + mu1_A) * (1.0 + mu1_A) + 2.0 * mu2_A * mu2_A * (1.0 + mu1_A) -
                   2.0 * (1.0 + mu1_A) + mu1_B * mu1_B * (1.0 + mu1_A) + mu2_A * (1.0 + mu2_B) * mu1_B;
-        itOCp[0][0].Set(2.0 * valueOC);
+        OCp[0][0][k] = 2.0 * valueOC;
         /** mu1, part2*/
         valueOC = +mu1_B * (1.0 + mu1_A) * (1.0 + mu1_A) + mu2_A * (1.0 + mu2_B) * (1.0 + mu1_A) +
                   2.0 * mu1_B * mu1_B * mu1_B + 2.0 * mu1_B * (1.0 + mu2_B) * (1.0 + mu2_B) - 2.0 * mu1_B;
-        itOCp[0][1].Set(2.0 * valueOC);
+        OCp[0][1][k] = 2.0 * valueOC;
         /** mu2, part 1 */
         valueOC = +2.0 * mu2_A * mu2_A * mu2_A + 2.0 * mu2_A * (1.0 + mu1_A) * (1.0 + mu1_A) - 2.0 * mu2_A +
                   mu2_A * (1.0 + mu2_B) * (1.0 + mu2_B) + mu1_B * (1.0 + mu1_A) * (1.0 + mu2_B);
-        itOCp[1][0].Set(2.0 * valueOC);
+        OCp[1][0][k] = 2.0 * valueOC;
         /** mu2, part2*/
         valueOC = +mu2_A * mu2_A * (1.0 + mu2_B) + mu1_B * (1.0 + mu1_A) * mu2_A +
                   2.0 * (1.0 + mu2_B) * (1.0 + mu2_B) * (1.0 + mu2_B) + 2.0 * mu1_B * mu1_B * (1.0 + mu2_B) -
                   2.0 * (1.0 + mu2_B);
-        itOCp[1][1].Set(2.0 * valueOC);
+        OCp[1][1][k] = 2.0 * valueOC;
       } // end if dim == 2
       else if (ImageDimension == 3)
       {
-        /** Calculate the value of the orthonormality condition. */
-        this->m_OrthonormalityConditionValue +=
-          it_RCI.Get() * (std::pow(+(1.0 + mu1_A) * (1.0 + mu1_A) + mu2_A * mu2_A + mu3_A * mu3_A - 1.0, 2.0) +
-                          std::pow(+(1.0 + mu1_A) * mu1_B + mu2_A * (1.0 + mu2_B) + mu3_A * mu3_B, 2.0) +
-                          std::pow(+(1.0 + mu1_A) * mu1_C + mu2_A * mu2_C + mu3_A * (1.0 + mu3_C), 2.0) +
-                          std::pow(+mu1_B * mu1_B + (1.0 + mu2_B) * (1.0 + mu2_B) + mu3_B * mu3_B - 1.0, 2.0) +
-                          std::pow(+mu1_B * mu1_C + (1.0 + mu2_B) * mu2_C + mu3_B * (1.0 + mu3_C), 2.0) +
-                          std::pow(+mu1_C * mu1_C + mu2_C * mu2_C + (1.0 + mu3_C) * (1.0 + mu3_C) - 1.0, 2.0));
-        /** Calculate the derivative of the orthonormality condition. */
         /** mu1, part 1 */
         valueOC = +2.0 * (1.0 + mu1_A) * (1.0 + mu1_A) * (1.0 + mu1_A) + 2.0 * mu2_A * mu2_A * (1.0 + mu1_A) +
                   2.0 * (1.0 + mu1_A) * mu3_A * mu3_A - 2.0 * (1.0 + mu1_A) + mu1_B * mu1_B * (1.0 + mu1_A) +
                   mu2_A * (1.0 + mu2_B) * mu1_B + mu1_B * mu3_A * mu3_B + (1.0 + mu1_A) * mu1_C * mu1_C +
                   mu1_C * mu2_A * mu2_C + mu1_C * mu3_A * (1.0 + mu3_C);
-        itOCp[0][0].Set(2.0 * valueOC);
+        OCp[0][0][k] = 2.0 * valueOC;
         /** mu1, part2 */
         valueOC = +(1.0 + mu1_A) * (1.0 + mu1_A) * mu1_B + (1.0 + mu1_A) * mu2_A * mu3_B +
                   (1.0 + mu1_A) * mu3_A * mu3_B + mu1_B * mu1_B * mu1_B + mu1_B * (1.0 + mu2_B) * (1.0 + mu2_B) +
                   mu1_B * mu3_B * mu3_B - mu1_B + mu1_B * mu1_C * mu1_C + mu1_C * (1.0 + mu2_B) * mu2_C +
                   mu1_C * mu3_B * (1.0 + mu3_C);
-        itOCp[0][1].Set(2.0 * valueOC);
+        OCp[0][1][k] = 2.0 * valueOC;
         /** mu1, part3 */
         valueOC = +(1.0 + mu1_A) * (1.0 + mu1_A) * mu1_C + (1.0 + mu1_A) * mu2_A * mu2_C +
                   (1.0 + mu1_A) * mu3_A * (1.0 + mu3_C) + mu1_B * mu1_B * mu1_C + mu1_B * (1.0 + mu2_B) * mu2_C +
                   mu1_B * mu3_B * (1.0 + mu3_C) + 2.0 * mu1_C * mu1_C * mu1_C + 2.0 * mu1_C * mu2_C * mu2_C +
                   2.0 * mu1_C * (1.0 + mu3_C) * (1.0 + mu3_C) - 2.0 * mu1_C;
-        itOCp[0][2].Set(2.0 * valueOC);
+        OCp[0][2][k] = 2.0 * valueOC;
         /** mu2, part 1 */
         valueOC = +2.0 * mu2_A * mu2_A * mu2_A + 2.0 * mu2_A * (1.0 + mu1_A) * (1.0 + mu1_A) - 2.0 * mu2_A +
                   2.0 * mu2_A * mu3_A * mu3_A + mu2_A * (1.0 + mu2_B) * (1.0 + mu2_B) +
                   mu1_B * (1.0 + mu1_A) * (1.0 + mu2_B) + (1.0 + mu2_B) * mu3_A * mu3_B + mu2_A * mu2_C * mu2_C +
                   (1.0 + mu1_A) * mu1_C * mu2_C + mu2_C * mu3_A * (1.0 + mu3_C);
-        itOCp[1][0].Set(2.0 * valueOC);
+        OCp[1][0][k] = 2.0 * valueOC;
         /** mu2, part2 */
         valueOC = +mu2_A * mu2_A * (1.0 + mu2_B) + mu1_B * (1.0 + mu1_A) * mu2_A + mu2_A * mu3_A * mu3_B +
                   2.0 * (1.0 + mu2_B) * (1.0 + mu2_B) * (1.0 + mu2_B) + 2.0 * mu1_B * mu1_B * (1.0 + mu2_B) -
                   2.0 * (1.0 + mu2_B) + 2.0 * (1.0 + mu2_B) * mu3_B * mu3_B + (1.0 + mu2_B) * mu2_C * mu2_C +
                   mu1_B * mu1_C * mu2_C + mu2_C * mu3_B * (1.0 + mu3_C);
-        itOCp[1][1].Set(2.0 * valueOC);
+        OCp[1][1][k] = 2.0 * valueOC;
         /** mu2, part 3 */
         valueOC = +mu2_A * mu2_A * mu2_C + (1.0 + mu1_A) * mu1_C * mu2_A + mu2_A * mu3_A * (1.0 + mu3_C) +
                   (1.0 + mu2_B) * (1.0 + mu2_B) * mu2_C + mu1_B * mu1_C * mu2_B +
                   (1.0 + mu2_B) * mu3_B * (1.0 + mu3_C) + 2.0 * mu2_C * mu2_C * mu2_C + 2.0 * mu1_C * mu1_C * mu2_C +
                   2.0 * mu2_C * (1.0 + mu3_C) * (1.0 + mu3_C) - 2.0 * mu2_C;
-        itOCp[1][2].Set(2.0 * valueOC);
+        OCp[1][2][k] = 2.0 * valueOC;
         /** mu3, part 1 */
         valueOC = +2.0 * mu3_A * mu3_A * mu3_A + 2.0 * mu3_A * (1.0 + mu1_A) * (1.0 + mu1_A) - 2.0 * mu3_A +
                   2.0 * mu2_A * mu2_A * mu3_A + mu3_A * mu3_B * mu3_B + mu1_B * (1.0 + mu1_A) * mu3_B +
                   (1.0 + mu2_B) * mu2_A * mu3_B + mu3_A * (1.0 + mu3_C) * (1.0 + mu3_C) +
                   (1.0 + mu1_A) * mu1_C * (1.0 + mu3_C) + mu2_C * mu2_A * (1.0 + mu3_C);
-        itOCp[2][0].Set(2.0 * valueOC);
+        OCp[2][0][k] = 2.0 * valueOC;
         /** mu3, part2 */
         valueOC = +mu3_A * mu3_A * mu3_B + mu1_B * (1.0 + mu1_A) * mu3_A + mu2_A * mu3_A * (1.0 + mu2_B) +
                   2.0 * mu3_B * mu3_B * mu3_B + 2.0 * mu1_B * mu1_B * mu3_B - 2.0 * mu3_B +
                   2.0 * (1.0 + mu2_B) * (1.0 + mu2_B) * mu3_B + mu3_B * (1.0 + mu3_C) * (1.0 + mu3_C) +
                   mu1_B * mu1_C * (1.0 + mu3_C) + mu2_C * (1.0 + mu2_B) * (1.0 + mu3_C);
-        itOCp[2][1].Set(2.0 * valueOC);
+        OCp[2][1][k] = 2.0 * valueOC;
         /** mu3, part 3 */
         valueOC = +mu3_A * mu3_A * (1.0 + mu3_C) + (1.0 + mu1_A) * mu1_C * mu3_A + mu2_A * mu3_A * mu2_C +
                   mu3_B * mu3_B * (1.0 + mu3_C) + mu1_B * mu1_C * mu3_B + (1.0 + mu2_B) * mu3_B * mu2_C +
                   2.0 * (1.0 + mu3_C) * (1.0 + mu3_C) * (1.0 + mu3_C) + 2.0 * mu1_C * mu1_C * (1.0 + mu3_C) +
                   2.0 * mu2_C * mu2_C * (1.0 + mu3_C) - 2.0 * (1.0 + mu3_C);
-        itOCp[2][2].Set(2.0 * valueOC);
+        OCp[2][2][k] = 2.0 * valueOC;
       } // end if dim == 3
-
-      /** Increase all iterators. */
-      for (unsigned int i = 0; i < ImageDimension; ++i)
-      {
-        ++itA[i];
-        ++itB[i];
-        if (ImageDimension == 3)
-        {
-          ++itC[i];
-        }
-        for (unsigned int j = 0; j < ImageDimension; ++j)
-        {
-          ++itOCp[i][j];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
+    } // end for
   }   // end if do orthonormality
 
-  /** TASK 4B:
-   * Do the calculation of the properness parts.
+  /** TASK 1B:
+   * Calculate the properness condition, and its subparts.
    *
    ************************************************************************* */
 
-  /** Reset all iterators. */
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    itA[i].GoToBegin();
-    itB[i].GoToBegin();
-    if (ImageDimension == 3)
-    {
-      itC[i].GoToBegin();
-    }
-  }
-  it_RCI.GoToBegin();
-
   if (this->m_CalculatePropernessCondition)
   {
     ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
     ScalarType valuePC;
-    while (!itPCp[0][0].IsAtEnd())
+    for (SizeValueType k = begin; k < end; ++k)
     {
       /** Copy values: this way we avoid calling Get() so many times.
        * It also improves code readability.
        */
-      mu1_A = itA[0].Get();
-      mu2_A = itA[1].Get();
-      mu1_B = itB[0].Get();
-      mu2_B = itB[1].Get();
+      mu1_A = A[0][k];
+      mu2_A = A[1][k];
+      mu1_B = B[0][k];
+      mu2_B = B[1][k];
       if (ImageDimension == 3)
       {
-        mu3_A = itA[2].Get();
-        mu3_B = itB[2].Get();
-        mu1_C = itC[0].Get();
-        mu2_C = itC[1].Get();
-        mu3_C = itC[2].Get();
+        mu3_A = A[2][k];
+        mu3_B = B[2][k];
+        mu1_C = C[0][k];
+        mu2_C = C[1][k];
+        mu3_C = C[2][k];
       }
       if (ImageDimension == 2)
       {
         /** Calculate the value of the properness condition. */
-        this->m_PropernessConditionValue +=
-          it_RCI.Get() * (std::pow(+(1.0 + mu1_A) * (1.0 + mu2_B) - mu2_A * mu1_B - 1.0, 2.0));
-        /** Calculate the derivative of the properness condition. */
+        values.m_Properness += RCI[k] * (std::pow(+(1.0 + mu1_A) * (1.0 + mu2_B) - mu2_A * mu1_B - 1.0, 2.0));
+      }
+      else if (ImageDimension == 3)
+      {
+        /** Calculate the value of the properness condition. */
+        values.m_Properness +=
+          RCI[k] * (std::pow(-mu1_C * (1.0 + mu2_B) * mu3_A + mu1_B * mu2_C * mu3_A + mu1_C * mu2_A * mu3_B -
+                               (1.0 + mu1_A) * mu2_C * mu3_B - mu1_B * mu2_A * (1.0 + mu3_C) +
+                               (1.0 + mu1_A) * (1.0 + mu2_B) * (1.0 + mu3_C) - 1.0,
+                             2.0));
+      }
+
+      if (!computeParts)
+      {
+        continue;
+      }
+
+      /** Calculate the derivative of the properness condition. */
+      if (ImageDimension == 2)
+      {
         /** mu1, part 1 */
         valuePC = +(1.0 + mu2_B) * (1.0 + mu2_B) * (1.0 + mu1_A) - mu2_A * (1.0 + mu2_B) * mu1_B - (1.0 + mu2_B);
-        itPCp[0][0].Set(2.0 * valuePC);
+        PCp[0][0][k] = 2.0 * valuePC;
         /** mu1, part 2 */
         valuePC = +mu2_A + mu2_A * mu2_A * mu1_B - mu2_A * (1.0 + mu2_B) * (1.0 + mu1_A);
-        itPCp[0][1].Set(2.0 * valuePC);
+        PCp[0][1][k] = 2.0 * valuePC;
         /** mu2, part 1 */
         valuePC = +mu1_B * mu1_B * mu2_A - mu1_B * (1.0 + mu1_A) * (1.0 + mu2_B) + mu1_B;
-        itPCp[1][0].Set(2.0 * valuePC);
+        PCp[1][0][k] = 2.0 * valuePC;
         /** mu2, part 2 */
         valuePC = -(1.0 + mu1_A) + (1.0 + mu1_A) * (1.0 + mu1_A) * (1.0 + mu2_B) - mu1_B * (1.0 + mu1_A) * mu2_A;
-        itPCp[1][1].Set(2.0 * valuePC);
+        PCp[1][1][k] = 2.0 * valuePC;
       } // end if dim == 2
       else if (ImageDimension == 3)
       {
-        /** Calculate the value of the properness condition. */
-        this->m_PropernessConditionValue +=
-          it_RCI.Get() * (std::pow(-mu1_C * (1.0 + mu2_B) * mu3_A + mu1_B * mu2_C * mu3_A + mu1_C * mu2_A * mu3_B -
-                                     (1.0 + mu1_A) * mu2_C * mu3_B - mu1_B * mu2_A * (1.0 + mu3_C) +
-                                     (1.0 + mu1_A) * (1.0 + mu2_B) * (1.0 + mu3_C) - 1.0,
-                                   2.0));
-        /** Calculate the derivative of the properness condition. */
         /** mu1, part 1 */
         valuePC = +(1.0 + mu1_A) * mu2_C * mu2_C * mu3_B * mu3_B +
                   (1.0 + mu1_A) * (1.0 + mu2_B) * (1.0 + mu2_B) * (1.0 + mu3_C) * (1.0 + mu3_C) +
@@ -1344,7 +1111,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
                   mu1_B * mu2_A * mu2_C * mu3_B * (1.0 + mu3_C) -
                   2.0 * (1.0 + mu1_A) * (1.0 + mu2_B) * mu2_C * mu3_B * (1.0 + mu3_C) + mu2_C * mu3_B -
                   mu1_B * mu2_A * (1.0 + mu2_B) * (1.0 + mu3_C) * (1.0 + mu3_C) - (1.0 + mu2_B) * (1.0 + mu3_C);
-        itPCp[0][0].Set(2.0 * valuePC);
+        PCp[0][0][k] = 2.0 * valuePC;
         /** mu1, part 2 */
         valuePC = +mu1_B * mu2_C * mu2_C * mu3_A * mu3_A + mu1_B * mu2_A * mu2_A * (1.0 + mu3_C) * (1.0 + mu3_C) -
                   mu1_C * (1.0 + mu2_B) * mu2_C * mu3_A * mu3_A +
@@ -1354,7 +1121,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
                   mu1_C * mu2_A * mu2_A * mu3_B * (1.0 + mu3_C) +
                   (1.0 + mu1_A) * mu2_A * mu2_C * mu3_B * (1.0 + mu3_C) -
                   (1.0 + mu1_A) * mu2_A * (1.0 + mu2_B) * (1.0 + mu3_C) * (1.0 + mu3_C) + mu2_A * (1.0 + mu3_C);
-        itPCp[0][1].Set(2.0 * valuePC);
+        PCp[0][1][k] = 2.0 * valuePC;
         /** mu1, part 3 */
         valuePC = +mu1_C * (1.0 + mu2_B) * (1.0 + mu2_B) * mu3_A * mu3_A + mu1_C * mu2_A * mu2_A * mu3_B * mu3_B -
                   mu1_B * (1.0 + mu2_B) * mu2_C * mu3_A * mu3_A - 2.0 * mu1_C * mu2_A * (1.0 + mu2_B) * mu3_A * mu3_B +
@@ -1364,7 +1131,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
                   mu1_B * mu2_A * mu2_C * mu3_A * mu3_B - (1.0 + mu1_A) * mu2_A * mu2_C * mu3_B * mu3_B -
                   mu1_B * mu2_A * mu2_A * mu3_B * (1.0 + mu3_C) +
                   (1.0 + mu1_A) * mu2_A * (1.0 + mu2_B) * mu3_B * (1.0 + mu3_C) - mu2_A * mu3_B;
-        itPCp[0][2].Set(2.0 * valuePC);
+        PCp[0][2][k] = 2.0 * valuePC;
         /** mu2, part 1 */
         valuePC = +mu1_C * mu1_C * mu2_A * mu3_B * mu3_B + mu1_B * mu1_B * mu2_A * (1.0 + mu3_C) * (1.0 + mu3_C) -
                   mu1_C * mu1_C * (1.0 + mu2_B) * mu3_A * mu3_B +
@@ -1374,7 +1141,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
                   (1.0 + mu1_A) * mu1_C * (1.0 + mu2_B) * mu3_B * (1.0 + mu3_C) - mu1_C * mu3_B +
                   (1.0 + mu1_A) * mu1_B * mu2_C * mu3_B * (1.0 + mu3_C) -
                   (1.0 + mu1_A) * mu1_B * (1.0 + mu2_B) * (1.0 + mu3_C) * (1.0 + mu3_C) + mu1_B * (1.0 + mu3_C);
-        itPCp[1][0].Set(2.0 * valuePC);
+        PCp[1][0][k] = 2.0 * valuePC;
         /** mu2, part 2 */
         valuePC = +mu1_C * mu1_C * (1.0 + mu2_B) * mu3_A * mu3_A +
                   (1.0 + mu1_A) * (1.0 + mu1_A) * (1.0 + mu2_B) * (1.0 + mu3_C) * (1.0 + mu3_C) -
@@ -1385,7 +1152,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
                   (1.0 + mu1_A) * mu1_C * mu2_A * mu3_B * (1.0 + mu3_C) -
                   (1.0 + mu1_A) * (1.0 + mu1_A) * mu2_C * mu3_B * (1.0 + mu3_C) -
                   (1.0 + mu1_A) * mu1_B * mu2_A * (1.0 + mu3_C) * (1.0 + mu3_C) - (1.0 + mu1_A) * (1.0 + mu3_C);
-        itPCp[1][1].Set(2.0 * valuePC);
+        PCp[1][1][k] = 2.0 * valuePC;
         /** mu2, part 3 */
         valuePC = +mu1_B * mu1_B * mu2_C * mu3_A * mu3_A + (1.0 + mu1_A) * (1.0 + mu1_A) * mu2_C * mu3_B * mu3_B -
                   mu1_B * mu1_C * (1.0 + mu2_B) * mu3_A * mu3_A +
@@ -1395,7 +1162,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
                   (1.0 + mu1_A) * mu1_C * mu2_A * mu3_B * mu3_B +
                   (1.0 + mu1_A) * mu1_B * mu2_A * mu3_B * (1.0 + mu3_C) -
                   (1.0 + mu1_A) * (1.0 + mu1_A) * (1.0 + mu2_B) * mu3_B * (1.0 + mu3_C) + (1.0 + mu1_A) * mu3_B;
-        itPCp[1][2].Set(2.0 * valuePC);
+        PCp[1][2][k] = 2.0 * valuePC;
         /** mu3, part 1 */
         valuePC = +mu1_C * mu1_C * (1.0 + mu2_B) * (1.0 + mu2_B) * mu3_A + mu1_B * mu1_B * mu2_C * mu2_C * mu3_A -
                   2.0 * mu1_B * mu1_C * (1.0 + mu2_B) * mu2_C * mu3_A - mu1_C * mu1_C * mu2_A * (1.0 + mu2_B) * mu3_B +
@@ -1405,7 +1172,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
                   mu1_B * mu1_C * mu2_A * mu2_C * mu3_B - (1.0 + mu1_A) * mu1_B * mu2_C * mu2_C * mu3_B -
                   mu1_B * mu1_B * mu2_A * mu2_C * (1.0 + mu3_C) +
                   (1.0 + mu1_A) * mu1_B * (1.0 + mu2_B) * mu2_C * (1.0 + mu3_C) + mu1_B * mu2_C;
-        itPCp[2][0].Set(2.0 * valuePC);
+        PCp[2][0][k] = 2.0 * valuePC;
         /** mu3, part 2 */
         valuePC = +mu1_C * mu1_C * mu2_A * mu2_A * mu3_B + (1.0 + mu1_A) * (1.0 + mu1_A) * mu2_C * mu2_C * mu3_B -
                   mu1_C * mu1_C * mu2_A * (1.0 + mu2_B) * mu3_A +
@@ -1415,7 +1182,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
                   (1.0 + mu1_A) * mu1_C * mu2_A * (1.0 + mu2_B) * (1.0 + mu3_C) - mu1_C * mu2_A +
                   (1.0 + mu1_A) * mu1_B * mu2_A * mu2_C * (1.0 + mu3_C) -
                   (1.0 + mu1_A) * (1.0 + mu1_A) * (1.0 + mu2_B) * mu2_C * (1.0 + mu3_C) + (1.0 + mu1_A) * mu2_C;
-        itPCp[2][1].Set(2.0 * valuePC);
+        PCp[2][1][k] = 2.0 * valuePC;
         /** mu3, part 3 */
         valuePC = +mu1_B * mu1_B * mu2_A * mu2_A * (1.0 + mu3_C) +
                   (1.0 + mu1_A) * (1.0 + mu1_A) * (1.0 + mu2_B) * (1.0 + mu2_B) * (1.0 + mu3_C) +
@@ -1427,163 +1194,87 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
                   (1.0 + mu1_A) * (1.0 + mu1_A) * (1.0 + mu2_B) * mu2_C * mu3_B -
                   2.0 * (1.0 + mu1_A) * mu1_B * mu2_A * (1.0 + mu2_B) * (1.0 + mu3_C) + mu1_B * mu2_A -
                   (1.0 + mu1_A) * (1.0 + mu2_B);
-        itPCp[2][2].Set(2.0 * valuePC);
+        PCp[2][2][k] = 2.0 * valuePC;
       } // end if dim == 3
-
-      /** Increase all iterators. */
-      for (unsigned int i = 0; i < ImageDimension; ++i)
-      {
-        ++itA[i];
-        ++itB[i];
-        if (ImageDimension == 3)
-        {
-          ++itC[i];
-        }
-        for (unsigned int j = 0; j < ImageDimension; ++j)
-        {
-          ++itPCp[i][j];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
+    } // end for
   }   // end if do properness
 
-  /** TASK 4C:
-   * Do the calculation of the linearity parts.
+  /** TASK 1C:
+   * Calculate the linearity condition, and its subparts.
    *
    ************************************************************************* */
 
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
   if (this->m_CalculateLinearityCondition)
   {
-    while (!itLCp[0][0].IsAtEnd())
+    for (SizeValueType k = begin; k < end; ++k)
     {
       /** Linearity condition part. */
       for (unsigned int i = 0; i < ImageDimension; ++i)
       {
         /** Calculate the value of the linearity condition. */
-        this->m_LinearityConditionValue +=
-          it_RCI.Get() * (+itD[i].Get() * itD[i].Get() + itE[i].Get() * itE[i].Get() + itG[i].Get() * itG[i].Get());
+        values.m_Linearity += RCI[k] * (+D[i][k] * D[i][k] + E[i][k] * E[i][k] + G[i][k] * G[i][k]);
         if (ImageDimension == 3)
         {
-          this->m_LinearityConditionValue +=
-            it_RCI.Get() * (+itF[i].Get() * itF[i].Get() + itH[i].Get() * itH[i].Get() + itI[i].Get() * itI[i].Get());
+          values.m_Linearity += RCI[k] * (+F[i][k] * F[i][k] + H[i][k] * H[i][k] + I[i][k] * I[i][k]);
         }
       } // end loop over i
 
+      if (!computeParts)
+      {
+        continue;
+      }
+
       /** Calculate the derivative of the linearity condition. */
       if (ImageDimension == 2)
       {
-        itLCp[0][0].Set(2.0 * itD[0].Get());
-        itLCp[0][1].Set(2.0 * itE[0].Get());
-        itLCp[0][2].Set(2.0 * itG[0].Get());
-        itLCp[1][0].Set(2.0 * itD[1].Get());
-        itLCp[1][1].Set(2.0 * itE[1].Get());
-        itLCp[1][2].Set(2.0 * itG[1].Get());
+        LCp[0][0][k] = 2.0 * D[0][k];
+        LCp[0][1][k] = 2.0 * E[0][k];
+        LCp[0][2][k] = 2.0 * G[0][k];
+        LCp[1][0][k] = 2.0 * D[1][k];
+        LCp[1][1][k] = 2.0 * E[1][k];
+        LCp[1][2][k] = 2.0 * G[1][k];
       } // end if dim == 2
       else if (ImageDimension == 3)
       {
-        itLCp[0][0].Set(2.0 * itD[0].Get());
-        itLCp[0][1].Set(2.0 * itE[0].Get());
-        itLCp[0][2].Set(2.0 * itG[0].Get());
-        itLCp[0][3].Set(2.0 * itF[0].Get());
-        itLCp[0][4].Set(2.0 * itH[0].Get());
-        itLCp[0][5].Set(2.0 * itI[0].Get());
-        itLCp[1][0].Set(2.0 * itD[1].Get());
-        itLCp[1][1].Set(2.0 * itE[1].Get());
-        itLCp[1][2].Set(2.0 * itG[1].Get());
-        itLCp[1][3].Set(2.0 * itF[1].Get());
-        itLCp[1][4].Set(2.0 * itH[1].Get());
-        itLCp[1][5].Set(2.0 * itI[1].Get());
-        itLCp[2][0].Set(2.0 * itD[2].Get());
-        itLCp[2][1].Set(2.0 * itE[2].Get());
-        itLCp[2][2].Set(2.0 * itG[2].Get());
-        itLCp[2][3].Set(2.0 * itF[2].Get());
-        itLCp[2][4].Set(2.0 * itH[2].Get());
-        itLCp[2][5].Set(2.0 * itI[2].Get());
+        LCp[0][0][k] = 2.0 * D[0][k];
+        LCp[0][1][k] = 2.0 * E[0][k];
+        LCp[0][2][k] = 2.0 * G[0][k];
+        LCp[0][3][k] = 2.0 * F[0][k];
+        LCp[0][4][k] = 2.0 * H[0][k];
+        LCp[0][5][k] = 2.0 * I[0][k];
+        LCp[1][0][k] = 2.0 * D[1][k];
+        LCp[1][1][k] = 2.0 * E[1][k];
+        LCp[1][2][k] = 2.0 * G[1][k];
+        LCp[1][3][k] = 2.0 * F[1][k];
+        LCp[1][4][k] = 2.0 * H[1][k];
+        LCp[1][5][k] = 2.0 * I[1][k];
+        LCp[2][0][k] = 2.0 * D[2][k];
+        LCp[2][1][k] = 2.0 * E[2][k];
+        LCp[2][2][k] = 2.0 * G[2][k];
+        LCp[2][3][k] = 2.0 * F[2][k];
+        LCp[2][4][k] = 2.0 * H[2][k];
+        LCp[2][5][k] = 2.0 * I[2][k];
       } // end if dim == 3
-
-      /** Increase all iterators. */
-      for (unsigned int i = 0; i < ImageDimension; ++i)
-      {
-        ++itD[i];
-        ++itE[i];
-        ++itG[i];
-        if (ImageDimension == 3)
-        {
-          ++itF[i];
-          ++itH[i];
-          ++itI[i];
-        }
-        for (unsigned int j = 0; j < NofLParts; ++j)
-        {
-          ++itLCp[i][j];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
+    } // end for
   }   // end if do linearity
 
-  /** TASK 5:
-   * Do the actual calculation of the rigidity penalty term value.
-   *
-   ************************************************************************* */
+  return values;
 
-  /** Calculate the rigidity penalty term value. */
-  if (this->m_CalculateLinearityCondition)
-  {
-    this->m_LinearityConditionValue /= rigidityCoefficientSum;
-  }
-  if (this->m_CalculateOrthonormalityCondition)
-  {
-    this->m_OrthonormalityConditionValue /= rigidityCoefficientSum;
-  }
-  if (this->m_CalculatePropernessCondition)
-  {
-    this->m_PropernessConditionValue /= rigidityCoefficientSum;
-  }
+} // end ThreadedComputeConditionValuesAndParts()
 
-  if (this->m_UseLinearityCondition)
-  {
-    this->m_RigidityPenaltyTermValue += this->m_LinearityConditionWeight * this->m_LinearityConditionValue;
-  }
-  if (this->m_UseOrthonormalityCondition)
-  {
-    this->m_RigidityPenaltyTermValue += this->m_OrthonormalityConditionWeight * this->m_OrthonormalityConditionValue;
-  }
-  if (this->m_UsePropernessCondition)
-  {
-    this->m_RigidityPenaltyTermValue += this->m_PropernessConditionWeight * this->m_PropernessConditionValue;
-  }
-  value = this->m_RigidityPenaltyTermValue;
 
-  /** TASK 6:
-   * Create filtered versions of the subparts.
-   * Create all necessary iterators and operators.
-   ************************************************************************* */
+/**
+ * *********************** ThreadedFilterParts ****************
+ */
 
-  /** Create filtered orthonormality, properness and linearity parts. */
-  std::vector<CoefficientImagePointer> OCpartsF(ImageDimension);
-  std::vector<CoefficientImagePointer> PCpartsF(ImageDimension);
-  std::vector<CoefficientImagePointer> LCpartsF(ImageDimension);
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    OCpartsF[i] = CoefficientImageType::New();
-    OCpartsF[i]->SetRegions(inputImages[0]->GetLargestPossibleRegion());
-    OCpartsF[i]->Allocate();
-    PCpartsF[i] = CoefficientImageType::New();
-    PCpartsF[i]->SetRegions(inputImages[0]->GetLargestPossibleRegion());
-    PCpartsF[i]->Allocate();
-    LCpartsF[i] = CoefficientImageType::New();
-    LCpartsF[i]->SetRegions(inputImages[0]->GetLargestPossibleRegion());
-    LCpartsF[i]->Allocate();
-  }
+template <class TFixedImage, class TScalarType>
+void
+TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::ThreadedFilterParts(
+  const RigidityImageRegionType & regionPart) const
+{
+  const unsigned int NofLParts = 3 * ImageDimension - 3;
 
-  /** Create neighborhood iterators over the subparts. */
+  /** Create neighborhood iterators over the part of the subparts. */
   std::vector<std::vector<NeighborhoodIteratorType>> nitOCp(ImageDimension);
   std::vector<std::vector<NeighborhoodIteratorType>> nitPCp(ImageDimension);
   std::vector<std::vector<NeighborhoodIteratorType>> nitLCp(ImageDimension);
@@ -1596,62 +1287,49 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
     nitLCp[i].resize(NofLParts);
     for (unsigned int j = 0; j < ImageDimension; ++j)
     {
-      nitOCp[i][j] = NeighborhoodIteratorType(radius, OCparts[i][j], OCparts[i][j]->GetLargestPossibleRegion());
+      nitOCp[i][j] = NeighborhoodIteratorType(radius, this->m_OrthonormalityParts[i][j], regionPart);
       nitOCp[i][j].GoToBegin();
-      nitPCp[i][j] = NeighborhoodIteratorType(radius, PCparts[i][j], PCparts[i][j]->GetLargestPossibleRegion());
+      nitPCp[i][j] = NeighborhoodIteratorType(radius, this->m_PropernessParts[i][j], regionPart);
       nitPCp[i][j].GoToBegin();
     }
     for (unsigned int j = 0; j < NofLParts; ++j)
     {
-      nitLCp[i][j] = NeighborhoodIteratorType(radius, LCparts[i][j], LCparts[i][j]->GetLargestPossibleRegion());
+      nitLCp[i][j] = NeighborhoodIteratorType(radius, this->m_LinearityParts[i][j], regionPart);
       nitLCp[i][j].GoToBegin();
     }
   }
 
-  /** Create iterators over the filtered parts. */
+  /** Create iterators over the part of the filtered parts. */
   std::vector<CoefficientImageIteratorType> itOCpf(ImageDimension);
   std::vector<CoefficientImageIteratorType> itPCpf(ImageDimension);
   std::vector<CoefficientImageIteratorType> itLCpf(ImageDimension);
   for (unsigned int i = 0; i < ImageDimension; ++i)
   {
-    itOCpf[i] = CoefficientImageIteratorType(OCpartsF[i], OCpartsF[i]->GetLargestPossibleRegion());
+    itOCpf[i] = CoefficientImageIteratorType(this->m_OrthonormalityPartsFiltered[i], regionPart);
     itOCpf[i].GoToBegin();
-    itPCpf[i] = CoefficientImageIteratorType(PCpartsF[i], PCpartsF[i]->GetLargestPossibleRegion());
+    itPCpf[i] = CoefficientImageIteratorType(this->m_PropernessPartsFiltered[i], regionPart);
     itPCpf[i].GoToBegin();
-    itLCpf[i] = CoefficientImageIteratorType(LCpartsF[i], LCpartsF[i]->GetLargestPossibleRegion());
+    itLCpf[i] = CoefficientImageIteratorType(this->m_LinearityPartsFiltered[i], regionPart);
     itLCpf[i].GoToBegin();
   }
 
-  /** Create a neigborhood iterator over the rigidity image. */
-  NeighborhoodIteratorType nit_RCI(
-    radius, this->m_RigidityCoefficientImage, this->m_RigidityCoefficientImage->GetLargestPossibleRegion());
+  /** Create a neigborhood iterator over the part of the rigidity image. */
+  NeighborhoodIteratorType nit_RCI(radius, this->m_RigidityCoefficientImage, regionPart);
   nit_RCI.GoToBegin();
-  unsigned int neighborhoodSize = nit_RCI.Size();
-
-  /** Create ND operators. */
-  NeighborhoodType Operator_A, Operator_B, Operator_C, Operator_D, Operator_E, Operator_F, Operator_G, Operator_H,
-    Operator_I;
-  this->CreateNDOperator(Operator_A, "FA", spacing);
-  this->CreateNDOperator(Operator_B, "FB", spacing);
-  if (ImageDimension == 3)
-  {
-    this->CreateNDOperator(Operator_C, "FC", spacing);
-  }
-
-  if (this->m_CalculateLinearityCondition)
-  {
-    this->CreateNDOperator(Operator_D, "FD", spacing);
-    this->CreateNDOperator(Operator_E, "FE", spacing);
-    this->CreateNDOperator(Operator_G, "FG", spacing);
-    if (ImageDimension == 3)
-    {
-      this->CreateNDOperator(Operator_F, "FF", spacing);
-      this->CreateNDOperator(Operator_H, "FH", spacing);
-      this->CreateNDOperator(Operator_I, "FI", spacing);
-    }
-  }
-
-  /** TASK 7A:
+  const unsigned int neighborhoodSize = nit_RCI.Size();
+
+  /** Get the ND operators. */
+  const NeighborhoodType & Operator_A = this->m_NDOperators[0];
+  const NeighborhoodType & Operator_B = this->m_NDOperators[1];
+  const NeighborhoodType & Operator_C = this->m_NDOperators[2];
+  const NeighborhoodType & Operator_D = this->m_NDOperators[3];
+  const NeighborhoodType & Operator_E = this->m_NDOperators[4];
+  const NeighborhoodType & Operator_F = this->m_NDOperators[5];
+  const NeighborhoodType & Operator_G = this->m_NDOperators[6];
+  const NeighborhoodType & Operator_H = this->m_NDOperators[7];
+  const NeighborhoodType & Operator_I = this->m_NDOperators[8];
+
+  /** TASK 2A:
    * Calculate the filtered versions of the orthonormality subparts.
    * These are F_A * {subpart_0} + F_B * {subpart_1},
    * and (for 3D) + F_C * {subpart_2}, for all dimensions.
@@ -1662,7 +1340,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
     while (!itOCpf[0].IsAtEnd())
     {
       /** Create and reset tmp with zeros. */
-      std::vector<double> tmp(ImageDimension, 0.0);
+      std::array<double, ImageDimension> tmp{};
 
       /** Loop over all dimensions. */
       for (unsigned int i = 0; i < ImageDimension; ++i)
@@ -1703,7 +1381,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
     } // end while
   }   // end if do orthonormality
 
-  /** TASK 7B:
+  /** TASK 2B:
    * Calculate the filtered versions of the properness subparts.
    * These are F_A * {subpart_0} + F_B * {subpart_1},
    * and (for 3D) + F_C * {subpart_2}, for all dimensions.
@@ -1715,7 +1393,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
     while (!itPCpf[0].IsAtEnd())
     {
       /** Create and reset tmp with zeros. */
-      std::vector<double> tmp(ImageDimension, 0.0);
+      std::array<double, ImageDimension> tmp{};
 
       /** Loop over all dimensions. */
       for (unsigned int i = 0; i < ImageDimension; ++i)
@@ -1756,7 +1434,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
     } // end while
   }   // end if do properness
 
-  /** TASK 7C:
+  /** TASK 2C:
    * Calculate the filtered versions of the linearity subparts.
    * These are sum_{i=1}^{NofLParts} F_{D,E,G,F,H,I} * {subpart_i}.
    ************************************************************************* */
@@ -1767,7 +1445,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
     while (!itLCpf[0].IsAtEnd())
     {
       /** Create and reset tmp with zeros. */
-      std::vector<double> tmp(ImageDimension, 0.0);
+      std::array<double, ImageDimension> tmp{};
 
       /** Loop over all dimensions. */
       for (unsigned int i = 0; i < ImageDimension; ++i)
@@ -1817,96 +1495,7 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivative(co
     } // end while
   }   // end if do linearity
 
-  /** TASK 8:
-   * Add it all to create the final derivative images.
-   ************************************************************************* */
-
-  /** Create derivative images, each holding a component of the vector field. */
-  std::vector<CoefficientImagePointer> derivativeImages(ImageDimension);
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    derivativeImages[i] = CoefficientImageType::New();
-    derivativeImages[i]->SetRegions(inputImages[i]->GetLargestPossibleRegion());
-    derivativeImages[i]->Allocate();
-  }
-
-  /** Create iterators over the derivative images. */
-  std::vector<CoefficientImageIteratorType> itDIs(ImageDimension);
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    itDIs[i] = CoefficientImageIteratorType(derivativeImages[i], derivativeImages[i]->GetLargestPossibleRegion());
-    itDIs[i].GoToBegin();
-    itOCpf[i].GoToBegin();
-    itPCpf[i].GoToBegin();
-    itLCpf[i].GoToBegin();
-  }
-
-  /** Do the addition. */
-  // NOTE: unlike the values, for the derivatives weight * derivative is returned.
-  MeasureType gradMagLC{};
-  MeasureType gradMagOC{};
-  MeasureType gradMagPC{};
-  double      rigidityCoefficientSumSqr = rigidityCoefficientSum * rigidityCoefficientSum;
-  while (!itDIs[0].IsAtEnd())
-  {
-    for (unsigned int i = 0; i < ImageDimension; ++i)
-    {
-      ScalarType tmpDIs{};
-
-      /** Compute gradient magnitude of LC. */
-      ScalarType tmpLC = this->m_LinearityConditionWeight * itLCpf[i].Get();
-      gradMagLC += tmpLC * tmpLC / rigidityCoefficientSumSqr;
-
-      /** Compute gradient magnitude of OC. */
-      ScalarType tmpOC = this->m_OrthonormalityConditionWeight * itOCpf[i].Get();
-      gradMagOC += tmpOC * tmpOC / rigidityCoefficientSumSqr;
-
-      /** Compute gradient magnitude of PC. */
-      ScalarType tmpPC = this->m_PropernessConditionWeight * itPCpf[i].Get();
-      gradMagPC += tmpPC * tmpPC / rigidityCoefficientSumSqr;
-
-      /** Compute derivative contribution. */
-      if (this->m_UseLinearityCondition)
-      {
-        tmpDIs += tmpLC;
-      }
-      if (this->m_UseOrthonormalityCondition)
-      {
-        tmpDIs += tmpOC;
-      }
-      if (this->m_UsePropernessCondition)
-      {
-        tmpDIs += tmpPC;
-      }
-      itDIs[i].Set(tmpDIs);
-
-      /** Update iterators. */
-      ++itDIs[i];
-      ++itOCpf[i];
-      ++itPCpf[i];
-      ++itLCpf[i];
-    }
-  } // end while
-
-  /** Set the gradient magnitudes of the several terms. */
-  this->m_LinearityConditionGradientMagnitude = std::sqrt(gradMagLC);
-  this->m_OrthonormalityConditionGradientMagnitude = std::sqrt(gradMagOC);
-  this->m_PropernessConditionGradientMagnitude = std::sqrt(gradMagPC);
-
-  /** Rearrange to create a derivative. */
-  unsigned int j = 0;
-  for (unsigned int i = 0; i < ImageDimension; ++i)
-  {
-    itDIs[i].GoToBegin();
-    while (!itDIs[i].IsAtEnd())
-    {
-      derivative[j] = itDIs[i].Get() / rigidityCoefficientSum;
-      ++itDIs[i];
-      ++j;
-    } // end while
-  }   // end for
-
-} // end GetValueAndDerivative()
+} // end ThreadedFilterParts()
 
 
 /**
@@ -2157,37 +1746,164 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::Create1DOperator(
 
 
 /**
- * ************************** FilterSeparable ********************
+ * ************************** InitializeFiltersAndIntermediateImages ********************
  */
 
 template <class TFixedImage, class TScalarType>
-auto
-TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::FilterSeparable(
-  const CoefficientImageType *          image,
-  const std::vector<NeighborhoodType> & Operators) const -> CoefficientImagePointer
+void
+TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::InitializeFiltersAndIntermediateImages()
 {
-  /** Create filters, supply them with boundary conditions and operators. */
-  std::vector<typename NOIFType::Pointer> filters(ImageDimension);
-  for (unsigned int i = 0; i < ImageDimension; ++i)
+  const RigidityImageRegionType     region = this->m_RigidityCoefficientImage->GetLargestPossibleRegion();
+  const CoefficientImageSpacingType spacing = this->m_RigidityCoefficientImage->GetSpacing();
+
+  /** Create the separable filter chains, for each operator and each B-spline coefficient image, and the ND
+   * operators. The operators C, D and E from the paper are here created by Create1DOperator D, E and G,
+   * because of the 3D case and history.
+   */
+  this->m_SeparableFilters.assign(NumberOfOperators * ImageDimension, {});
+  this->m_SeparableFilterInputs.assign(NumberOfOperators * ImageDimension, nullptr);
+  this->m_NDOperators.assign(NumberOfOperators, NeighborhoodType());
+  for (unsigned int f = 0; f < NumberOfOperators; ++f)
   {
-    filters[i] = NOIFType::New();
-    filters[i]->SetOperator(Operators[i]);
+    /** The operators F_C, F_F, F_H and F_I only exist in 3D. */
+    const std::string whichF = std::string("F") + static_cast<char>('A' + f);
+    if (ImageDimension == 2 && (whichF == "FC" || whichF == "FF" || whichF == "FH" || whichF == "FI"))
+    {
+      continue;
+    }
+
+    std::vector<NeighborhoodType> operators(ImageDimension);
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      this->Create1DOperator(operators[i], whichF + "_xi", i + 1, spacing);
+    }
+    this->CreateNDOperator(this->m_NDOperators[f], whichF, spacing);
+
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      /** The input of the chain wraps the buffer of a B-spline coefficient image, see FilterCoefficientImages. */
+      const auto input = CoefficientImageType::New();
+      input->SetRegions(region);
+      input->SetSpacing(spacing);
+      input->SetOrigin(this->m_RigidityCoefficientImage->GetOrigin());
+      input->SetDirection(this->m_RigidityCoefficientImage->GetDirection());
+      this->m_SeparableFilterInputs[f * ImageDimension + d] = input;
+
+      /** Create filters, supply them with operators, and set up the mini-pipeline. When multi-threading, the
+       * chains are executed concurrently, so each filter itself runs single-threaded.
+       */
+      std::vector<typename NOIFType::Pointer> & filters = this->m_SeparableFilters[f * ImageDimension + d];
+      filters.resize(ImageDimension);
+      for (unsigned int i = 0; i < ImageDimension; ++i)
+      {
+        filters[i] = NOIFType::New();
+        filters[i]->SetOperator(operators[i]);
+        if (Superclass::m_UseMultiThread)
+        {
+          filters[i]->SetNumberOfWorkUnits(1);
+        }
+      }
+      filters[0]->SetInput(input);
+      for (unsigned int i = 1; i < ImageDimension; ++i)
+      {
+        filters[i]->SetInput(filters[i - 1]->GetOutput());
+      }
+    }
   }
 
-  /** Set up the mini-pipline. */
-  filters[0]->SetInput(image);
-  for (unsigned int i = 1; i < ImageDimension; ++i)
+  /** Allocate the subparts of the derivatives and their filtered versions. */
+  const auto createImage = [&region] {
+    const auto image = CoefficientImageType::New();
+    image->SetRegions(region);
+    image->Allocate();
+    return image;
+  };
+  const unsigned int NofLParts = 3 * ImageDimension - 3;
+  this->m_OrthonormalityParts.assign(ImageDimension, {});
+  this->m_PropernessParts.assign(ImageDimension, {});
+  this->m_LinearityParts.assign(ImageDimension, {});
+  this->m_OrthonormalityPartsFiltered.clear();
+  this->m_PropernessPartsFiltered.clear();
+  this->m_LinearityPartsFiltered.clear();
+  for (unsigned int i = 0; i < ImageDimension; ++i)
   {
-    filters[i]->SetInput(filters[i - 1]->GetOutput());
+    for (unsigned int j = 0; j < ImageDimension; ++j)
+    {
+      this->m_OrthonormalityParts[i].push_back(createImage());
+      this->m_PropernessParts[i].push_back(createImage());
+    }
+    for (unsigned int j = 0; j < NofLParts; ++j)
+    {
+      this->m_LinearityParts[i].push_back(createImage());
+    }
+    this->m_OrthonormalityPartsFiltered.push_back(createImage());
+    this->m_PropernessPartsFiltered.push_back(createImage());
+    this->m_LinearityPartsFiltered.push_back(createImage());
   }
 
-  /** Execute the mini-pipeline. */
-  filters[ImageDimension - 1]->Update();
+} // end InitializeFiltersAndIntermediateImages()
+
+
+/**
+ * ************************** FilterCoefficientImages ********************
+ */
+
+template <class TFixedImage, class TScalarType>
+void
+TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::FilterCoefficientImages() const
+{
+  /** The operators F_A, F_B and F_C are needed by the orthonormality and properness conditions,
+   * the others by the linearity condition.
+   */
+  const bool calculateOCorPC = this->m_CalculateOrthonormalityCondition || this->m_CalculatePropernessCondition;
+  const bool calculateLC = this->m_CalculateLinearityCondition;
+
+  /** Let the inputs of the needed chains wrap the current B-spline coefficient images. The coefficient images
+   * themselves are not used as inputs, as the chains that share an input would then concurrently update it.
+   * The inputs are marked as modified, because the coefficients may have changed in-place.
+   */
+  const auto &              coefficientImages = this->m_BSplineTransform->GetCoefficientImages();
+  const SizeValueType       numberOfCoefficients = coefficientImages[0]->GetLargestPossibleRegion().GetNumberOfPixels();
+  std::vector<unsigned int> chainIndices;
+  for (unsigned int f = 0; f < NumberOfOperators; ++f)
+  {
+    if (!(f < 3 ? calculateOCorPC : calculateLC))
+    {
+      continue;
+    }
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      const unsigned int chainIndex = f * ImageDimension + d;
+      if (this->m_SeparableFilters[chainIndex].empty())
+      {
+        continue;
+      }
+      const CoefficientImagePointer & input = this->m_SeparableFilterInputs[chainIndex];
+      input->GetPixelContainer()->SetImportPointer(
+        coefficientImages[d]->GetBufferPointer(), numberOfCoefficients, false);
+      input->Modified();
+      chainIndices.push_back(chainIndex);
+    }
+  }
 
-  /** Return the filtered image. */
-  return filters[ImageDimension - 1]->GetOutput();
+  /** Execute the mini-pipelines. */
+  const auto updateChain = [this, &chainIndices](const unsigned int j) {
+    this->m_SeparableFilters[chainIndices[j]].back()->Update();
+  };
+  if (Superclass::m_UseMultiThread)
+  {
+    elastix::WorkStealingThreadPool::GetInstance().ForkJoin(static_cast<unsigned int>(chainIndices.size()),
+                                                            updateChain);
+  }
+  else
+  {
+    for (unsigned int j = 0; j < chainIndices.size(); ++j)
+    {
+      updateChain(j);
+    }
+  }
 
-} // end FilterSeparable()
+} // end FilterCoefficientImages()
 
 
 /**
@@ -94,6 +94,9 @@ public:
   using typename Superclass::FixedImageLimiterOutputType;
   using typename Superclass::MovingImageLimiterOutputType;
   using typename Superclass::MovingImageDerivativeScalesType;
+  using typename Superclass::NumberOfParametersType;
+  using typename Superclass::PerThreadDerivativeType;
+  using typename Superclass::PerThreadDerivativeValueType;
 
   /** The fixed image dimension. */
   itkStaticConstMacro(FixedImageDimension, unsigned int, FixedImageType::ImageDimension);
@@ -102,6 +105,9 @@ public:
   itkStaticConstMacro(MovingImageDimension, unsigned int, MovingImageType::ImageDimension);
 
   /** Get the value for single valued optimizers. */
+  virtual MeasureType
+  GetValueSingleThreaded(const TransformParametersType & parameters) const;
+
   MeasureType
   GetValue(const TransformParametersType & parameters) const override;
 
@@ -110,6 +116,11 @@ public:
   GetDerivative(const TransformParametersType & parameters, DerivativeType & derivative) const override;
 
   /** Get value and derivatives for multiple valued optimizers. */
+  void
+  GetValueAndDerivativeSingleThreaded(const TransformParametersType & parameters,
+                                      MeasureType &                   value,
+                                      DerivativeType &                derivative) const;
+
   void
   GetValueAndDerivative(const TransformParametersType & parameters,
                         MeasureType &                   Value,
@@ -151,11 +162,46 @@ protected:
                                         const MovingImageDerivativeType & movingImageDerivative,
                                         DerivativeType &                  imageJacobian) const override;
 
+  /** Get the moving image values of the samples for each thread. */
+  void
+  ThreadedGetValue(ThreadIdType threadID) const override;
+
+  /** Compute the value from the moving image values of the samples of all threads. */
+  void
+  AfterThreadedGetValue(MeasureType & value) const override;
+
+  /** Get the derivatives of the valid samples for each thread. */
+  void
+  ThreadedGetValueAndDerivative(ThreadIdType threadID) const override;
+
+  /** Gather the derivatives from all threads. The value is already computed, before the derivatives. */
+  void
+  AfterThreadedGetValueAndDerivative(MeasureType & value, DerivativeType & derivative) const override;
+
 private:
+  using MatrixType = vnl_matrix<RealType>;
+  using DerivativeMatrixType = vnl_matrix<DerivativeValueType>;
+
   /** Sample n random numbers from 0..m and add them to the vector. */
   void
   SampleRandom(const int n, const int m, std::vector<int> & numbers) const;
 
+  /** Computes the fixed image points of all last dimension positions of the specified point, and transforms them by
+   * a single call to the transform. */
+  void
+  TransformPointsOfLastDimPositions(const FixedImagePointType &         fixedPoint,
+                                    std::vector<FixedImagePointType> &  fixedPoints,
+                                    std::vector<MovingImagePointType> & mappedPoints) const;
+
+  /** Gathers the valid samples of ThreadedGetValue, and computes the measure from their moving image values. When
+   * computeDerivativeWeights is true, it also computes the derivative weights for ThreadedGetValueAndDerivative. */
+  MeasureType
+  ComputeMeasureOfValidSamples(const bool computeDerivativeWeights) const;
+
+  /** Subtracts the mean over the last dimension from the derivative elements. */
+  void
+  SubtractMeanFromDerivative(DerivativeType & derivative) const;
+
   /** Variables to control random sampling in last dimension. */
   unsigned int m_NumAdditionalSamplesFixed{};
   unsigned int m_ReducedDimensionIndex{};
@@ -168,6 +214,16 @@ private:
 
   /** Bool to indicate if the transform used is a stacktransform. Set by elx files. */
   bool m_TransformIsStackTransform{ true };
+
+  /** Variables for the multi-threaded computation. The moving image values of all last dimension positions of the
+   * samples, with a row for each sample, and whether all these values of a sample are valid. */
+  mutable MatrixType                 m_SampleValues{};
+  mutable std::vector<unsigned char> m_SampleIsValid{};
+
+  /** The indices of the valid samples, and the weights of the derivatives of their moving image values, with a row for
+   * each valid sample and a column for each last dimension position. */
+  mutable std::vector<size_t>  m_ValidSampleIndices{};
+  mutable DerivativeMatrixType m_DerivativeWeights{};
 };
 
 } // end namespace itk
@@ -21,6 +21,7 @@
 #include "itkSumOfPairwiseCorrelationCoefficientsMetric.h"
 
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "elxRandomGenerator.h"
 #include <vnl/algo/vnl_matrix_update.h>
 #include "itkImage.h"
 #include <numeric>
@@ -79,8 +80,8 @@ SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::SampleRan
   numbers.clear();
 
   /** Initialize random number generator. */
-  Statistics::MersenneTwisterRandomVariateGenerator::Pointer randomGenerator =
-    Statistics::MersenneTwisterRandomVariateGenerator::GetInstance();
+  const Statistics::MersenneTwisterRandomVariateGenerator::Pointer randomGenerator =
+    elastix::RandomGenerator::GetCurrent();
 
   /** Sample additional at fixed timepoint. */
   for (unsigned int i = 0; i < m_NumAdditionalSamplesFixed; ++i)
@@ -102,6 +103,121 @@ SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::SampleRan
 } // end SampleRandom()
 
 
+/**
+ * ******************* TransformPointsOfLastDimPositions *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::TransformPointsOfLastDimPositions(
+  const FixedImagePointType &         fixedPoint,
+  std::vector<FixedImagePointType> &  fixedPoints,
+  std::vector<MovingImagePointType> & mappedPoints) const
+{
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
+  /** Transform sampled point to voxel coordinates. */
+  auto voxelCoord =
+    this->GetFixedImage()->template TransformPhysicalPointToContinuousIndex<CoordinateRepresentationType>(fixedPoint);
+
+  /** Set the last dimension of the fixed point to each of the last dimension positions. */
+  fixedPoints.resize(G);
+  for (unsigned int d = 0; d < G; ++d)
+  {
+    voxelCoord[lastDim] = d;
+    this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint(voxelCoord, fixedPoints[d]);
+  }
+
+  /** Transform the points of all positions by a single call to the transform, instead of a call per position. */
+  mappedPoints.resize(G);
+  Superclass::m_AdvancedTransform->TransformPoints(fixedPoints.data(), mappedPoints.data(), G);
+
+} // end TransformPointsOfLastDimPositions()
+
+
+/**
+ * ******************* SubtractMeanFromDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::SubtractMeanFromDerivative(
+  DerivativeType & derivative) const
+{
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
+  if (!this->m_TransformIsStackTransform)
+  {
+    /** Update derivative per dimension.
+     * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
+     * per dimension xyz.
+     */
+    const unsigned int lastDimGridSize = this->m_GridSize[lastDim];
+    const unsigned int numParametersPerDimension =
+      this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
+    const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
+    DerivativeType     mean(numControlPointsPerDimension);
+    for (unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d)
+    {
+      /** Compute mean per dimension. */
+      mean.Fill(0.0);
+      const unsigned int starti = numParametersPerDimension * d;
+      for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        mean[index] += derivative[i];
+      }
+      mean /= static_cast<double>(lastDimGridSize);
+
+      /** Update derivative for every control point per dimension. */
+      for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        derivative[i] -= mean[index];
+      }
+    }
+  }
+  else
+  {
+    /** Update derivative per dimension.
+     * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
+     * the number the time point index.
+     */
+    const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / G;
+    DerivativeType     mean(numParametersPerLastDimension);
+    mean.Fill(0.0);
+
+    /** Compute mean per control point. */
+    for (unsigned int t = 0; t < G; ++t)
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        mean[index] += derivative[c];
+      }
+    }
+    mean /= static_cast<double>(G);
+
+    /** Update derivative per control point. */
+    for (unsigned int t = 0; t < G; ++t)
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        derivative[c] -= mean[index];
+      }
+    }
+  }
+
+} // end SubtractMeanFromDerivative()
+
+
 /**
  * *************** EvaluateTransformJacobianInnerProduct ****************
  */
@@ -117,12 +233,12 @@ SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::EvaluateT
 }
 
 /**
- * ******************* GetValue *******************
+ * ******************* GetValueSingleThreaded *******************
  */
 
 template <class TFixedImage, class TMovingImage>
 auto
-SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValue(
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValueSingleThreaded(
   const TransformParametersType & parameters) const -> MeasureType
 {
   itkDebugMacro("GetValue( " << parameters << " ) ");
@@ -253,9 +369,248 @@ SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValue(
   /** Return the measure value. */
   return measure;
 
+} // end GetValueSingleThreaded()
+
+
+/**
+ * ******************* GetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValue(
+  const TransformParametersType & parameters) const -> MeasureType
+{
+  /** Option for now to still use the single threaded code. */
+  if (!Superclass::m_UseMultiThread)
+  {
+    return this->GetValueSingleThreaded(parameters);
+  }
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * Because of these calls GetValue itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   * This is however needed in the CombinationImageToImageMetric.
+   * In that case, you need to:
+   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before calling GetValue
+   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
+   * - Now you can call GetValue multi-threaded.
+   */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Allocate the moving image values of the samples, which are filled by the threads. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+  const unsigned int numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+  m_SampleValues.set_size(numberOfSamples, G);
+  m_SampleIsValid.resize(numberOfSamples);
+
+  /** Launch multi-threading metric */
+  this->LaunchGetValueThreaderCallback();
+
+  /** Compute the metric value from the moving image values of all threads. */
+  MeasureType value{};
+  this->AfterThreadedGetValue(value);
+
+  return value;
+
 } // end GetValue()
 
 
+/**
+ * ******************* ThreadedGetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::ThreadedGetValue(ThreadIdType threadId) const
+{
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** Create iterator over the sample container. */
+  const auto beginOfSampleContainer = sampleContainer->cbegin();
+
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+
+  /** The fixed and the transformed points of the last dimension positions of the current sample, stored in the
+   * buffers of this thread, which keep their capacity between calls. */
+  auto & perThreadVariables = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId];
+  auto & fixedPoints = perThreadVariables.st_FixedPoints;
+  auto & mappedPoints = perThreadVariables.st_MappedPoints;
+
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
+  {
+    for (size_t sampleIndex = pos_begin; sampleIndex < pos_end; ++sampleIndex)
+    {
+      /** Transform the points of all last dimension positions of the sample at once. */
+      const FixedImagePointType & fixedPoint = beginOfSampleContainer[sampleIndex].m_ImageCoordinates;
+      this->TransformPointsOfLastDimPositions(fixedPoint, fixedPoints, mappedPoints);
+
+      /** The row of the sample in the matrix of moving image values. */
+      RealType * const sampleValues = m_SampleValues[sampleIndex];
+
+      /** Loop over t */
+      unsigned int numSamplesOk = 0;
+      for (unsigned int d = 0; d < mappedPoints.size(); ++d)
+      {
+        /** Initialize some variables. */
+        RealType movingImageValue;
+
+        /** Check if the point is inside the moving mask. */
+        bool sampleOk = this->IsInsideMovingMask(mappedPoints[d]);
+
+        if (sampleOk)
+        {
+          sampleOk =
+            this->FastEvaluateMovingImageValueAndDerivative(mappedPoints[d], movingImageValue, nullptr, threadId);
+        }
+
+        if (sampleOk)
+        {
+          ++numSamplesOk;
+          sampleValues[d] = movingImageValue;
+        }
+
+      } // end loop over t
+
+      /** Only the samples of which the values of all positions are valid are used. */
+      const bool sampleIsValid = (numSamplesOk == mappedPoints.size());
+      m_SampleIsValid[sampleIndex] = sampleIsValid;
+      if (sampleIsValid)
+      {
+        ++numberOfPixelsCounted;
+      }
+
+    } // end for loop over the image sample container
+  }
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ******************* AfterThreadedGetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::AfterThreadedGetValue(MeasureType & value) const
+{
+  value = this->ComputeMeasureOfValidSamples(false);
+
+} // end AfterThreadedGetValue()
+
+
+/**
+ * ******************* ComputeMeasureOfValidSamples *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::ComputeMeasureOfValidSamples(
+  const bool computeDerivativeWeights) const -> MeasureType
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Accumulate the number of pixels. */
+  Superclass::m_NumberOfPixelsCounted =
+    Superclass::m_GetValueAndDerivativePerThreadVariables[0].st_NumberOfPixelsCounted;
+  for (ThreadIdType i = 1; i < numberOfThreads; ++i)
+  {
+    Superclass::m_NumberOfPixelsCounted +=
+      Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted;
+  }
+
+  /** Check if enough samples were valid. */
+  const unsigned int NumberOfSamples = m_SampleValues.rows();
+  this->CheckNumberOfSamples(NumberOfSamples, Superclass::m_NumberOfPixelsCounted);
+  const unsigned int N = Superclass::m_NumberOfPixelsCounted;
+  const unsigned int G = m_SampleValues.cols();
+
+  /** The rows of the valid samples, in the order of the samples, like in GetValueSingleThreaded. */
+  MatrixType A(N, G);
+  m_ValidSampleIndices.clear();
+  for (unsigned int sampleIndex = 0; sampleIndex < NumberOfSamples; ++sampleIndex)
+  {
+    if (m_SampleIsValid[sampleIndex])
+    {
+      A.set_row(m_ValidSampleIndices.size(), m_SampleValues[sampleIndex]);
+      m_ValidSampleIndices.push_back(sampleIndex);
+    }
+  }
+
+  MatrixType Amm(N, G);
+  {
+    /** Calculate mean of from columns */
+    vnl_vector<RealType> mean(G);
+    mean.fill(RealType{});
+    for (unsigned int i = 0; i < N; ++i)
+    {
+      for (unsigned int j = 0; j < G; ++j)
+      {
+        mean(j) += A(i, j);
+      }
+    }
+    mean /= RealType(N);
+
+    for (unsigned int i = 0; i < N; ++i)
+    {
+      for (unsigned int j = 0; j < G; ++j)
+      {
+        Amm(i, j) = A(i, j) - mean(j);
+      }
+    }
+  }
+
+  MatrixType C(Amm.transpose() * Amm);
+  C /= static_cast<RealType>(RealType(N) - 1.0);
+
+  vnl_diag_matrix<RealType> S(G);
+  S.fill(RealType{});
+  for (unsigned int j = 0; j < G; ++j)
+  {
+    S(j, j) = 1.0 / sqrt(C(j, j));
+  }
+
+  const MatrixType K(S * C * S);
+  const RealType   KFroNorm = K.fro_norm();
+
+  if (computeDerivativeWeights)
+  {
+    /** The weight of the derivative of the moving image value of each position of each valid sample, as the sum of
+     * the terms of GetValueAndDerivativeSingleThreaded, including the normalization of the derivative. */
+    const MatrixType          KAtZscore(K * (Amm * S).transpose());
+    const MatrixType          KAtZscoreAmm(KAtZscore * Amm);
+    const DerivativeValueType normalization = -2.0 / ((DerivativeValueType(N) - 1.0) * (KFroNorm * RealType(G)));
+
+    m_DerivativeWeights.set_size(N, G);
+    for (unsigned int d = 0; d < G; ++d)
+    {
+      const DerivativeValueType dSdmu_part1 = -S(d, d) * S(d, d) * S(d, d) / (DerivativeValueType(N) - 1.0);
+      for (unsigned int pixelIndex = 0; pixelIndex < N; ++pixelIndex)
+      {
+        m_DerivativeWeights(pixelIndex, d) =
+          normalization * (KAtZscore(d, pixelIndex) * S(d, d) + dSdmu_part1 * Amm(pixelIndex, d) * KAtZscoreAmm(d, d));
+      }
+    }
+  }
+
+  return 1.0 - (KFroNorm / RealType(G));
+
+} // end ComputeMeasureOfValidSamples()
+
+
 /**
  * ******************* GetDerivative *******************
  */
@@ -279,12 +634,12 @@ SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetDeriva
 
 
 /**
- * ******************* GetValueAndDerivative *******************
+ * ******************* GetValueAndDerivativeSingleThreaded *******************
  */
 
 template <class TFixedImage, class TMovingImage>
 void
-SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValueAndDerivativeSingleThreaded(
   const TransformParametersType & parameters,
   MeasureType &                   value,
   DerivativeType &                derivative) const
@@ -498,76 +853,179 @@ SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValueA
   /** Subtract mean from derivative elements. */
   if (this->m_SubtractMean)
   {
-    if (!this->m_TransformIsStackTransform)
-    {
-      /** Update derivative per dimension.
-       * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
-       * per dimension xyz.
-       */
-      const unsigned int lastDimGridSize = this->m_GridSize[lastDim];
-      const unsigned int numParametersPerDimension =
-        this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
-      const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
-      DerivativeType     mean(numControlPointsPerDimension);
-      for (unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d)
-      {
-        /** Compute mean per dimension. */
-        mean.Fill(0.0);
-        const unsigned int starti = numParametersPerDimension * d;
-        for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
-        {
-          const unsigned int index = i % numControlPointsPerDimension;
-          mean[index] += derivative[i];
-        }
-        mean /= static_cast<double>(lastDimGridSize);
+    this->SubtractMeanFromDerivative(derivative);
+  }
 
-        /** Update derivative for every control point per dimension. */
-        for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
-        {
-          const unsigned int index = i % numControlPointsPerDimension;
-          derivative[i] -= mean[index];
-        }
-      }
-    }
-    else
+  /** Return the measure value. */
+  value = measure;
+
+} // end GetValueAndDerivativeSingleThreaded()
+
+
+/**
+ * ******************* GetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
+  const TransformParametersType & parameters,
+  MeasureType &                   value,
+  DerivativeType &                derivative) const
+{
+  /** Option for now to still use the single threaded code. */
+  if (!Superclass::m_UseMultiThread)
+  {
+    return this->GetValueAndDerivativeSingleThreaded(parameters, value, derivative);
+  }
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * Because of these calls GetValueAndDerivative itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   * This is however needed in the CombinationImageToImageMetric.
+   * In that case, you need to:
+   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
+   *   calling GetValueAndDerivative
+   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
+   * - Now you can call GetValueAndDerivative multi-threaded.
+   */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Allocate the moving image values of the samples, which are filled by the threads. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+  const unsigned int numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+  m_SampleValues.set_size(numberOfSamples, G);
+  m_SampleIsValid.resize(numberOfSamples);
+
+  /** The derivative of a sample depends on the correlations of all samples. So first compute the moving image values
+   * of all samples, and from these the value and the derivative weights, before the threads compute the derivatives.
+   */
+  this->LaunchGetValueThreaderCallback();
+  value = this->ComputeMeasureOfValidSamples(true);
+
+  /** Launch multi-threading metric */
+  this->LaunchGetValueAndDerivativeThreaderCallback();
+
+  /** Gather the derivatives from all threads. */
+  this->AfterThreadedGetValueAndDerivative(value, derivative);
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::ThreadedGetValueAndDerivative(
+  ThreadIdType threadId) const
+{
+  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
+  const NumberOfParametersType nnzji = Superclass::m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType   nzji(nnzji);
+  DerivativeType               imageJacobian(nnzji);
+
+  /** Get a handle to the pre-allocated derivative for the current thread.
+   * The initialization is performed at the beginning of each resolution in
+   * InitializeThreadingParameters(), and at the end of each iteration in
+   * AfterThreadedGetValueAndDerivative() and the accumulate functions.
+   */
+  PerThreadDerivativeType & derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
+
+  /** Create iterator over the sample container. */
+  const auto beginOfSampleContainer = this->GetImageSampler()->GetOutput()->cbegin();
+
+  /** The fixed and the transformed points of the last dimension positions of the current sample, stored in the
+   * buffers of this thread, which keep their capacity between calls. */
+  auto & perThreadVariables = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId];
+  auto & fixedPoints = perThreadVariables.st_FixedPoints;
+  auto & mappedPoints = perThreadVariables.st_MappedPoints;
+
+  /** Loop over the chunks of valid samples that are assigned to this thread. */
+  const size_t numberOfValidSamples = m_ValidSampleIndices.size();
+  size_t       pos_begin{};
+  size_t       pos_end{};
+  while (this->GetNextSampleChunk(numberOfValidSamples, threadId, pos_begin, pos_end))
+  {
+    for (size_t pixelIndex = pos_begin; pixelIndex < pos_end; ++pixelIndex)
     {
-      /** Update derivative per dimension.
-       * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
-       * the number the time point index.
-       */
-      const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / G;
-      DerivativeType     mean(numParametersPerLastDimension);
-      mean.Fill(0.0);
+      /** Transform the points of all last dimension positions of the sample at once. */
+      const size_t                sampleIndex = m_ValidSampleIndices[pixelIndex];
+      const FixedImagePointType & fixedPoint = beginOfSampleContainer[sampleIndex].m_ImageCoordinates;
+      this->TransformPointsOfLastDimPositions(fixedPoint, fixedPoints, mappedPoints);
 
-      /** Compute mean per control point. */
-      for (unsigned int t = 0; t < G; ++t)
+      for (unsigned int d = 0; d < mappedPoints.size(); ++d)
       {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
-        {
-          const unsigned int index = c % numParametersPerLastDimension;
-          mean[index] += derivative[c];
-        }
-      }
-      mean /= static_cast<double>(G);
+        /** Initialize some variables. */
+        RealType                  movingImageValue;
+        MovingImageDerivativeType movingImageDerivative;
 
-      /** Update derivative per control point. */
-      for (unsigned int t = 0; t < G; ++t)
-      {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+        /** All positions of a valid sample are inside the moving image. */
+        this->FastEvaluateMovingImageValueAndDerivative(
+          mappedPoints[d], movingImageValue, &movingImageDerivative, threadId);
+
+        /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+        Superclass::m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+          fixedPoints[d], movingImageDerivative, imageJacobian, nzji);
+
+        /** build metric derivative components */
+        const DerivativeValueType weight = m_DerivativeWeights(pixelIndex, d);
+        for (unsigned int p = 0; p < nzji.size(); ++p)
         {
-          const unsigned int index = c % numParametersPerLastDimension;
-          derivative[c] -= mean[index];
-        }
-      }
-    }
+          derivative[nzji[p]] += weight * imageJacobian[p];
+        } // end loop over non-zero jacobian indices
+
+      } // end loop over t
+
+    } // end for loop over the valid samples
   }
 
-  /** Return the measure value. */
-  value = measure;
+} // end ThreadedGetValueAndDerivative()
 
-} // end GetValueAndDerivative()
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::AfterThreadedGetValueAndDerivative(
+  MeasureType &    itkNotUsed(value),
+  DerivativeType & derivative) const
+{
+  /** Accumulate derivatives. The derivative weights already include the normalization. The accumulate threader
+   * callback hands out the derivative in blocks, so it is only used when the derivative is not processed afterwards.
+   */
+  derivative.SetSize(this->GetNumberOfParameters());
+  if (!this->m_SubtractMean)
+  {
+    Superclass::m_ThreaderMetricParameters.st_DerivativePointer = derivative.begin();
+    Superclass::m_ThreaderMetricParameters.st_NormalizationFactor = 1.0;
+
+    this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                                 &(Superclass::m_ThreaderMetricParameters));
+  }
+  else
+  {
+    this->SumPerThreadDerivatives(derivative, 1.0);
+
+    /** Reset the derivatives of the threads for the next iteration. */
+    const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+    for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+    {
+      Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_Derivative.Fill(PerThreadDerivativeValueType{});
+    }
+
+    /** Subtract mean from derivative elements. */
+    this->SubtractMeanFromDerivative(derivative);
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
 
 
 } // end namespace itk
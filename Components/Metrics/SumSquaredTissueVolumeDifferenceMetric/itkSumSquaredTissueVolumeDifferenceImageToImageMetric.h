@@ -101,6 +101,7 @@ public:
   using typename Superclass::MeasureType;
   using typename Superclass::DerivativeType;
   using typename Superclass::DerivativeValueType;
+  using typename Superclass::PerThreadDerivativeType;
   using typename Superclass::ParametersType;
   using typename Superclass::FixedImagePixelType;
   using typename Superclass::MovingImageRegionType;
@@ -188,7 +189,8 @@ protected:
                                         DerivativeType &                  imageJacobian) const override;
 
   /** Compute a pixel's contribution to the measure and derivatives;
-   * Called by GetValueAndDerivative(). */
+   * Called by GetValueAndDerivative(). The derivative is either a DerivativeType or a PerThreadDerivativeType. */
+  template <typename TDerivative>
   void
   UpdateValueAndDerivativeTerms(const RealType                     fixedImageValue,
                                 const RealType                     movingImageValue,
@@ -197,7 +199,7 @@ protected:
                                 const RealType                     spatialJacobianDeterminant,
                                 const DerivativeType &             jacobianOfSpatialJacobianDeterminant,
                                 MeasureType &                      measure,
-                                DerivativeType &                   deriv) const;
+                                TDerivative &                      deriv) const;
 
   /** Compute the inverse SpatialJacobian to support calculation of the metric gradient.
    * Note that this function does not calculate the true inverse, but instead calculates
@@ -206,60 +206,60 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::T
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   const unsigned long         sampleContainerSize = sampleContainer->Size();
 
-  /** Get the samples for this thread. */
-  const unsigned long nSamplesPerThread = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  const auto pos_begin = std::min<size_t>(nSamplesPerThread * threadId, sampleContainerSize);
-  const auto pos_end = std::min<size_t>(nSamplesPerThread * (threadId + 1), sampleContainerSize);
-
   /** Create iterator over the sample container. */
   const auto beginOfSampleContainer = sampleContainer->cbegin();
-  const auto threader_fbegin = beginOfSampleContainer + pos_begin;
-  const auto threader_fend = beginOfSampleContainer + pos_end;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for (auto threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = threader_fiter->m_ImageCoordinates;
-    RealType                    movingImageValue;
+    const auto threader_fbegin = beginOfSampleContainer + pos_begin;
+    const auto threader_fend = beginOfSampleContainer + pos_end;
 
-    /** Transform point. */
-    const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
+    /** Loop over the fixed image to calculate the mean squares. */
+    for (auto threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
+    {
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = threader_fiter->m_ImageCoordinates;
+      RealType                    movingImageValue;
 
-    /** Check if the point is inside the moving mask. */
-    bool sampleOk = this->IsInsideMovingMask(mappedPoint);
+      /** Transform point. */
+      const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
 
-    /** Compute the moving image value M(T(x)) and check if
-     * the point is inside the moving image buffer.
-     */
-    if (sampleOk)
-    {
-      sampleOk = this->FastEvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr, threadId);
-    }
+      /** Check if the point is inside the moving mask. */
+      bool sampleOk = this->IsInsideMovingMask(mappedPoint);
 
-    if (sampleOk)
-    {
-      ++numberOfPixelsCounted;
+      /** Compute the moving image value M(T(x)) and check if
+       * the point is inside the moving image buffer.
+       */
+      if (sampleOk)
+      {
+        sampleOk = this->FastEvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr, threadId);
+      }
 
-      /** Get the fixed image value. */
-      const RealType fixedImageValue = static_cast<RealType>(threader_fiter->m_ImageValue);
+      if (sampleOk)
+      {
+        ++numberOfPixelsCounted;
 
-      /** Get the SpatialJacobian dT/dx. */
-      Superclass::m_AdvancedTransform->GetSpatialJacobian(fixedPoint, spatialJac);
+        /** Get the fixed image value. */
+        const RealType fixedImageValue = static_cast<RealType>(threader_fiter->m_ImageValue);
 
-      /** Compute the determinant of the Transform Jacobian |dT/dx|. */
-      const RealType detjac = static_cast<RealType>(vnl_det(spatialJac.GetVnlMatrix()));
+        /** Get the SpatialJacobian dT/dx. */
+        Superclass::m_AdvancedTransform->GetSpatialJacobian(fixedPoint, spatialJac);
 
-      /** The difference squared. */
-      const RealType diff = ((fixedImageValue - this->m_AirValue) - detjac * (movingImageValue - this->m_AirValue)) /
-                            (this->m_TissueValue - this->m_AirValue);
-      measure += diff * diff;
+        /** Compute the determinant of the Transform Jacobian |dT/dx|. */
+        const RealType detjac = static_cast<RealType>(vnl_det(spatialJac.GetVnlMatrix()));
 
-    } // end if sampleOk
+        /** The difference squared. */
+        const RealType diff = ((fixedImageValue - this->m_AirValue) - detjac * (movingImageValue - this->m_AirValue)) /
+                              (this->m_TissueValue - this->m_AirValue);
+        measure += diff * diff;
 
-  } // end for loop over the image sample container
+      } // end if sampleOk
+
+    } // end for loop over the image sample container
+  }
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -490,7 +490,7 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::T
   /*Create variables to store intermediate results. Circumvent false sharing*/
   unsigned long    numberOfPixelsCounted = 0;
   MeasureType      measure{};
-  DerivativeType & derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
+  PerThreadDerivativeType & derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
 
   /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
   NonZeroJacobianIndicesType nzji(Superclass::m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices());
@@ -512,83 +512,83 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::T
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   const unsigned long         sampleContainerSize = sampleContainer->Size();
 
-  /** Get the samples for this thread. */
-  const unsigned long nSamplesPerThread = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  const auto pos_begin = std::min<size_t>(nSamplesPerThread * threadId, sampleContainerSize);
-  const auto pos_end = std::min<size_t>(nSamplesPerThread * (threadId + 1), sampleContainerSize);
-
   /** Create iterator over the sample container. */
   const auto beginOfSampleContainer = sampleContainer->cbegin();
-  const auto threader_fbegin = beginOfSampleContainer + pos_begin;
-  const auto threader_fend = beginOfSampleContainer + pos_end;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for (auto threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = threader_fiter->m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImageDerivativeType   movingImageDerivative;
+    const auto threader_fbegin = beginOfSampleContainer + pos_begin;
+    const auto threader_fend = beginOfSampleContainer + pos_end;
 
-    /** Transform point. */
-    const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
+    /** Loop over the fixed image to calculate the mean squares. */
+    for (auto threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
+    {
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = threader_fiter->m_ImageCoordinates;
+      RealType                    movingImageValue;
+      MovingImageDerivativeType   movingImageDerivative;
 
-    /** Check if the point is inside the moving mask. */
-    bool sampleOk = this->IsInsideMovingMask(mappedPoint);
+      /** Transform point. */
+      const MovingImagePointType mappedPoint = this->TransformPoint(fixedPoint);
 
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
-     */
-    if (sampleOk)
-    {
-      sampleOk = this->FastEvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative, threadId);
-    }
+      /** Check if the point is inside the moving mask. */
+      bool sampleOk = this->IsInsideMovingMask(mappedPoint);
 
-    if (sampleOk)
-    {
-      ++numberOfPixelsCounted;
+      /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+       * the point is inside the moving image buffer.
+       */
+      if (sampleOk)
+      {
+        sampleOk = this->FastEvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, &movingImageDerivative, threadId);
+      }
 
-      /** Get the fixed image value. */
-      const RealType fixedImageValue = static_cast<RealType>(threader_fiter->m_ImageValue);
+      if (sampleOk)
+      {
+        ++numberOfPixelsCounted;
 
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian(fixedPoint, jacobian, nzji);
+        /** Get the fixed image value. */
+        const RealType fixedImageValue = static_cast<RealType>(threader_fiter->m_ImageValue);
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(jacobian, movingImageDerivative, imageJacobian);
+        /** Get the TransformJacobian dT/dmu. */
+        this->EvaluateTransformJacobian(fixedPoint, jacobian, nzji);
 
-      /** Get the SpatialJacobian dT/dx. */
-      Superclass::m_AdvancedTransform->GetSpatialJacobian(fixedPoint, spatialJac);
+        /** Compute the inner products (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(jacobian, movingImageDerivative, imageJacobian);
 
-      /** Compute the determinant of the Transform Jacobian |dT/dx|. */
-      const RealType detjac = static_cast<RealType>(vnl_det(spatialJac.GetVnlMatrix()));
+        /** Get the SpatialJacobian dT/dx. */
+        Superclass::m_AdvancedTransform->GetSpatialJacobian(fixedPoint, spatialJac);
 
-      /** Compute the inverse spatialJacobian. */
-      inverseSpatialJacobian = spatialJac.GetInverse();
+        /** Compute the determinant of the Transform Jacobian |dT/dx|. */
+        const RealType detjac = static_cast<RealType>(vnl_det(spatialJac.GetVnlMatrix()));
 
-      /** Compute the JacobianOfSpatialJacobian. */
-      Superclass::m_AdvancedTransform->GetJacobianOfSpatialJacobian(fixedPoint, jacobianOfSpatialJacobian, nzji);
+        /** Compute the inverse spatialJacobian. */
+        inverseSpatialJacobian = spatialJac.GetInverse();
 
-      /** Compute the dot product of the inverse spatialJacobian and JacobianOfSpatialJacobian
-       * to support calculation of the JacobianOfSpatialJacobianDeterminant.
-       */
-      this->EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
-        jacobianOfSpatialJacobian, inverseSpatialJacobian, jacobianOfSpatialJacobianDeterminant);
+        /** Compute the JacobianOfSpatialJacobian. */
+        Superclass::m_AdvancedTransform->GetJacobianOfSpatialJacobian(fixedPoint, jacobianOfSpatialJacobian, nzji);
 
-      /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(fixedImageValue,
-                                          movingImageValue,
-                                          imageJacobian,
-                                          nzji,
-                                          detjac,
-                                          jacobianOfSpatialJacobianDeterminant,
-                                          measure,
-                                          derivative);
+        /** Compute the dot product of the inverse spatialJacobian and JacobianOfSpatialJacobian
+         * to support calculation of the JacobianOfSpatialJacobianDeterminant.
+         */
+        this->EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
+          jacobianOfSpatialJacobian, inverseSpatialJacobian, jacobianOfSpatialJacobianDeterminant);
 
-    } // end if sampleOk
+        /** Compute this pixel's contribution to the measure and derivatives. */
+        this->UpdateValueAndDerivativeTerms(fixedImageValue,
+                                            movingImageValue,
+                                            imageJacobian,
+                                            nzji,
+                                            detjac,
+                                            jacobianOfSpatialJacobianDeterminant,
+                                            measure,
+                                            derivative);
+
+      } // end if sampleOk
+    }
   }
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
@@ -636,13 +636,7 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::A
   /** compute single-threadedly */
   if (!Superclass::m_UseMultiThread && false) // force multi-threaded as in AdvancedMeanSquares
   {
-    derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[0].st_Derivative;
-    for (ThreadIdType i = 1; i < numberOfThreads; ++i)
-    {
-      derivative += Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_Derivative;
-    }
-
-    derivative /= static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
+    this->SumPerThreadDerivatives(derivative, 1.0 / static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted));
   }
   // compute multi-threadedly with itk threads
   else if (true) // force ITK threads !Superclass::m_UseOpenMP )
@@ -651,9 +645,8 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::A
     Superclass::m_ThreaderMetricParameters.st_NormalizationFactor =
       static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
 
-    this->m_Threader->SetSingleMethod(this->AccumulateDerivativesThreaderCallback,
-                                      &(Superclass::m_ThreaderMetricParameters));
-    this->m_Threader->SingleMethodExecute();
+    this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                                 &(Superclass::m_ThreaderMetricParameters));
   }
 
 #ifdef ELASTIX_USE_OPENMP
@@ -711,6 +704,7 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::E
  */
 
 template <class TFixedImage, class TMovingImage>
+template <typename TDerivative>
 void
 SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::UpdateValueAndDerivativeTerms(
   const RealType                     fixedImageValue,
@@ -720,7 +714,7 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::U
   const RealType                     spatialJacobianDeterminant,
   const DerivativeType &             jacobianOfSpatialJacobianDeterminant,
   MeasureType &                      measure,
-  DerivativeType &                   deriv) const
+  TDerivative &                      deriv) const
 {
   /** The difference squared. */
   const RealType diff =
@@ -738,7 +732,7 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::U
     /** Loop over all Jacobians. */
     typename DerivativeType::const_iterator imjacit = imageJacobian.begin();
     typename DerivativeType::const_iterator jsjdit = jacobianOfSpatialJacobianDeterminant.begin();
-    typename DerivativeType::iterator       derivit = deriv.begin();
+    typename TDerivative::iterator          derivit = deriv.begin();
     for (unsigned int mu = 0; mu < numberOfParameters; ++mu)
     {
       (*derivit) +=
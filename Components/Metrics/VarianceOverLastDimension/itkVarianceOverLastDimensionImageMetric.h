@@ -121,6 +121,9 @@ public:
   using typename Superclass::FixedImageLimiterOutputType;
   using typename Superclass::MovingImageLimiterOutputType;
   using typename Superclass::MovingImageDerivativeScalesType;
+  using typename Superclass::NumberOfParametersType;
+  using typename Superclass::PerThreadDerivativeType;
+  using typename Superclass::PerThreadDerivativeValueType;
 
   /** The fixed image dimension. */
   itkStaticConstMacro(FixedImageDimension, unsigned int, FixedImageType::ImageDimension);
@@ -129,6 +132,9 @@ public:
   itkStaticConstMacro(MovingImageDimension, unsigned int, MovingImageType::ImageDimension);
 
   /** Get the value for single valued optimizers. */
+  virtual MeasureType
+  GetValueSingleThreaded(const TransformParametersType & parameters) const;
+
   MeasureType
   GetValue(const TransformParametersType & parameters) const override;
 
@@ -137,6 +143,11 @@ public:
   GetDerivative(const TransformParametersType & parameters, DerivativeType & derivative) const override;
 
   /** Get value and derivatives for multiple valued optimizers. */
+  void
+  GetValueAndDerivativeSingleThreaded(const TransformParametersType & parameters,
+                                      MeasureType &                   value,
+                                      DerivativeType &                derivative) const;
+
   void
   GetValueAndDerivative(const TransformParametersType & parameters,
                         MeasureType &                   Value,
@@ -177,11 +188,44 @@ protected:
                                         const MovingImageDerivativeType & movingImageDerivative,
                                         DerivativeType &                  imageJacobian) const override;
 
+  /** Get value for each thread. */
+  void
+  ThreadedGetValue(ThreadIdType threadID) const override;
+
+  /** Gather the values from all threads. */
+  void
+  AfterThreadedGetValue(MeasureType & value) const override;
+
+  /** Get value and derivatives for each thread. */
+  void
+  ThreadedGetValueAndDerivative(ThreadIdType threadID) const override;
+
+  /** Gather the values and derivatives from all threads. */
+  void
+  AfterThreadedGetValueAndDerivative(MeasureType & value, DerivativeType & derivative) const override;
+
 private:
   /** Sample n random numbers from 0..m and add them to the vector. */
   void
   SampleRandom(const int n, const int m, std::vector<int> & numbers) const;
 
+  /** Determines the last dimension positions of each of the current samples, before the threads start, because
+   * SampleRandom uses the global random generator, which is not thread-safe. */
+  void
+  InitializeLastDimPositions(const size_t numberOfSamples) const;
+
+  /** Computes the fixed image points of all last dimension positions of the specified sample, and transforms them by
+   * a single call to the transform. */
+  void
+  TransformPointsOfLastDimPositions(const size_t                        sampleIndex,
+                                    const FixedImagePointType &         fixedPoint,
+                                    std::vector<FixedImagePointType> &  fixedPoints,
+                                    std::vector<MovingImagePointType> & mappedPoints) const;
+
+  /** Subtracts the mean over the last dimension from the derivative elements. */
+  void
+  SubtractMeanFromDerivative(DerivativeType & derivative) const;
+
   /** Variables to control random sampling in last dimension. */
   bool         m_SampleLastDimensionRandomly{ false };
   unsigned int m_NumSamplesLastDimension{ 10 };
@@ -199,6 +243,12 @@ private:
 
   /** Bool to indicate if the transform used is a stacktransform. Set by elx files. */
   bool m_TransformIsStackTransform{ false };
+
+  /** The last dimension positions of the samples, for the multi-threaded computation. When the positions are sampled
+   * randomly, these are the positions of each of the samples, one after the other. Otherwise, the positions are the
+   * same for all samples, and stored only once. */
+  mutable std::vector<int> m_LastDimPositions{};
+  mutable unsigned int     m_NumberOfLastDimPositions{};
 };
 
 } // end namespace itk
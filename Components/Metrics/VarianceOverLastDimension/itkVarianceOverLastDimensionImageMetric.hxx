@@ -20,7 +20,9 @@
 
 #include "itkVarianceOverLastDimensionImageMetric.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "elxRandomGenerator.h"
 #include <vnl/algo/vnl_matrix_update.h>
+#include <algorithm> // For copy.
 #include <numeric>
 
 namespace itk
@@ -131,8 +133,8 @@ VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::SampleRandom(co
   numbers.clear();
 
   /** Initialize random number generator. */
-  Statistics::MersenneTwisterRandomVariateGenerator::Pointer randomGenerator =
-    Statistics::MersenneTwisterRandomVariateGenerator::GetInstance();
+  const Statistics::MersenneTwisterRandomVariateGenerator::Pointer randomGenerator =
+    elastix::RandomGenerator::GetCurrent();
 
   /** Sample additional at fixed timepoint. */
   for (unsigned int i = 0; i < m_NumAdditionalSamplesFixed; ++i)
@@ -153,6 +155,162 @@ VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::SampleRandom(co
 } // end SampleRandom()
 
 
+/**
+ * ******************* InitializeLastDimPositions *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::InitializeLastDimPositions(
+  const size_t numberOfSamples) const
+{
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int lastDimSize = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
+  /** Use all positions when random sampling is turned off. */
+  if (!m_SampleLastDimensionRandomly)
+  {
+    m_NumberOfLastDimPositions = lastDimSize;
+    m_LastDimPositions.resize(lastDimSize);
+    std::iota(m_LastDimPositions.begin(), m_LastDimPositions.end(), 0);
+    return;
+  }
+
+  /** Sample the positions of the samples in the same order as GetValueSingleThreaded, so that the same random
+   * positions are used for each sample. */
+  m_NumberOfLastDimPositions = m_NumSamplesLastDimension + m_NumAdditionalSamplesFixed;
+  m_LastDimPositions.resize(numberOfSamples * m_NumberOfLastDimPositions);
+
+  std::vector<int> lastDimPositionsOfSample;
+  for (size_t sampleIndex = 0; sampleIndex < numberOfSamples; ++sampleIndex)
+  {
+    this->SampleRandom(m_NumSamplesLastDimension, lastDimSize, lastDimPositionsOfSample);
+    std::copy(lastDimPositionsOfSample.cbegin(),
+              lastDimPositionsOfSample.cend(),
+              m_LastDimPositions.begin() + sampleIndex * m_NumberOfLastDimPositions);
+  }
+
+} // end InitializeLastDimPositions()
+
+
+/**
+ * ******************* TransformPointsOfLastDimPositions *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::TransformPointsOfLastDimPositions(
+  const size_t                        sampleIndex,
+  const FixedImagePointType &         fixedPoint,
+  std::vector<FixedImagePointType> &  fixedPoints,
+  std::vector<MovingImagePointType> & mappedPoints) const
+{
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int numberOfPositions = m_NumberOfLastDimPositions;
+  const int * const  lastDimPositions =
+    m_LastDimPositions.data() + (m_SampleLastDimensionRandomly ? sampleIndex * numberOfPositions : 0);
+
+  /** Transform sampled point to voxel coordinates. */
+  auto voxelCoord =
+    this->GetFixedImage()->template TransformPhysicalPointToContinuousIndex<CoordinateRepresentationType>(fixedPoint);
+
+  /** Set the last dimension of the fixed point to each of the last dimension positions. */
+  fixedPoints.resize(numberOfPositions);
+  for (unsigned int d = 0; d < numberOfPositions; ++d)
+  {
+    voxelCoord[lastDim] = lastDimPositions[d];
+    this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint(voxelCoord, fixedPoints[d]);
+  }
+
+  /** Transform the points of all positions by a single call to the transform, instead of a call per position. */
+  mappedPoints.resize(numberOfPositions);
+  Superclass::m_AdvancedTransform->TransformPoints(fixedPoints.data(), mappedPoints.data(), numberOfPositions);
+
+} // end TransformPointsOfLastDimPositions()
+
+
+/**
+ * ******************* SubtractMeanFromDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::SubtractMeanFromDerivative(
+  DerivativeType & derivative) const
+{
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int lastDimSize = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
+  if (!m_TransformIsStackTransform)
+  {
+    /** Update derivative per dimension.
+     * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
+     * per dimension xyz.
+     */
+    const unsigned int lastDimGridSize = m_GridSize[lastDim];
+    const unsigned int numParametersPerDimension =
+      this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
+    const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
+    DerivativeType     mean(numControlPointsPerDimension);
+    for (unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d)
+    {
+      /** Compute mean per dimension. */
+      mean.Fill(0.0);
+      const unsigned int starti = numParametersPerDimension * d;
+      for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        mean[index] += derivative[i];
+      }
+      mean /= static_cast<double>(lastDimGridSize);
+
+      /** Update derivative for every control point per dimension. */
+      for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        derivative[i] -= mean[index];
+      }
+    }
+  }
+  else
+  {
+    /** Update derivative per dimension.
+     * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
+     * the number the time point index.
+     */
+    const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / lastDimSize;
+    DerivativeType     mean(numParametersPerLastDimension);
+    mean.Fill(0.0);
+
+    /** Compute mean per control point. */
+    for (unsigned int t = 0; t < lastDimSize; ++t)
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        mean[index] += derivative[c];
+      }
+    }
+    mean /= static_cast<double>(lastDimSize);
+
+    /** Update derivative per control point. */
+    for (unsigned int t = 0; t < lastDimSize; ++t)
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        derivative[c] -= mean[index];
+      }
+    }
+  }
+
+} // end SubtractMeanFromDerivative()
+
+
 /**
  * *************** EvaluateTransformJacobianInnerProduct ****************
  */
@@ -170,12 +328,12 @@ VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::EvaluateTransfo
 
 
 /**
- * ******************* GetValue *******************
+ * ******************* GetValueSingleThreaded *******************
  */
 
 template <class TFixedImage, class TMovingImage>
 auto
-VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValue(
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValueSingleThreaded(
   const TransformParametersType & parameters) const -> MeasureType
 {
   itkDebugMacro("GetValue( " << parameters << " ) ");
@@ -296,9 +454,177 @@ VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValue(
   /** Return the mean squares measure value. */
   return measure;
 
+} // end GetValueSingleThreaded()
+
+
+/**
+ * ******************* GetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+auto
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValue(
+  const TransformParametersType & parameters) const -> MeasureType
+{
+  /** Option for now to still use the single threaded code. */
+  if (!Superclass::m_UseMultiThread)
+  {
+    return this->GetValueSingleThreaded(parameters);
+  }
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * Because of these calls GetValue itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   * This is however needed in the CombinationImageToImageMetric.
+   * In that case, you need to:
+   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before calling GetValue
+   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
+   * - Now you can call GetValue multi-threaded.
+   */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Determine the last dimension positions of the samples, before the threads start. */
+  this->InitializeLastDimPositions(this->GetImageSampler()->GetOutput()->Size());
+
+  /** Launch multi-threading metric */
+  this->LaunchGetValueThreaderCallback();
+
+  /** Gather the metric values from all threads. */
+  MeasureType value{};
+  this->AfterThreadedGetValue(value);
+
+  return value;
+
 } // end GetValue()
 
 
+/**
+ * ******************* ThreadedGetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::ThreadedGetValue(ThreadIdType threadId) const
+{
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** Create iterator over the sample container. */
+  const auto beginOfSampleContainer = sampleContainer->cbegin();
+
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+  MeasureType   measure{};
+
+  /** The fixed and the transformed points of the last dimension positions of the current sample, stored in the
+   * buffers of this thread, which keep their capacity between calls. */
+  auto & perThreadVariables = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId];
+  auto & fixedPoints = perThreadVariables.st_FixedPoints;
+  auto & mappedPoints = perThreadVariables.st_MappedPoints;
+
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
+  {
+    /** Loop over the fixed image samples to calculate the variance over time for every sample position. */
+    for (size_t sampleIndex = pos_begin; sampleIndex < pos_end; ++sampleIndex)
+    {
+      /** Transform the points of all last dimension positions of the sample at once. */
+      const FixedImagePointType & fixedPoint = beginOfSampleContainer[sampleIndex].m_ImageCoordinates;
+      this->TransformPointsOfLastDimPositions(sampleIndex, fixedPoint, fixedPoints, mappedPoints);
+
+      /** Loop over the slowest varying dimension. */
+      float        sumValues = 0.0;
+      float        sumValuesSquared = 0.0;
+      unsigned int numSamplesOk = 0;
+      for (const MovingImagePointType & mappedPoint : mappedPoints)
+      {
+        /** Initialize some variables. */
+        RealType movingImageValue;
+
+        /** Check if the point is inside the moving mask. */
+        bool sampleOk = this->IsInsideMovingMask(mappedPoint);
+
+        /** Compute the moving image value and check if the point is
+         * inside the moving image buffer.
+         */
+        if (sampleOk)
+        {
+          sampleOk = this->FastEvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr, threadId);
+        }
+
+        if (sampleOk)
+        {
+          ++numSamplesOk;
+          sumValues += movingImageValue;
+          sumValuesSquared += movingImageValue * movingImageValue;
+        } // end if sampleOk
+      }   // end for loop over last dimension
+
+      if (numSamplesOk > 0)
+      {
+        ++numberOfPixelsCounted;
+
+        /** Add this variance to the variance sum. */
+        const float expectedValue = sumValues / static_cast<float>(numSamplesOk);
+        const float expectedSquaredValue = sumValuesSquared / static_cast<float>(numSamplesOk);
+        measure += expectedSquaredValue - expectedValue * expectedValue;
+      }
+
+    } // end for loop over the image sample container
+  }
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Value = measure;
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ******************* AfterThreadedGetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::AfterThreadedGetValue(MeasureType & value) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Accumulate the number of pixels. */
+  Superclass::m_NumberOfPixelsCounted =
+    Superclass::m_GetValueAndDerivativePerThreadVariables[0].st_NumberOfPixelsCounted;
+  for (ThreadIdType i = 1; i < numberOfThreads; ++i)
+  {
+    Superclass::m_NumberOfPixelsCounted +=
+      Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted;
+  }
+
+  /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->CheckNumberOfSamples(sampleContainer->Size(), Superclass::m_NumberOfPixelsCounted);
+
+  /** Accumulate values. */
+  value = MeasureType{};
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+  {
+    value += Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_Value;
+
+    /** Reset this variable for the next iteration. */
+    Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_Value = MeasureType{};
+  }
+
+  /** Compute average over variances and normalize with initial variance. */
+  value /= static_cast<float>(Superclass::m_NumberOfPixelsCounted * m_InitialVariance);
+
+} // end AfterThreadedGetValue()
+
+
 /**
  * ******************* GetDerivative *******************
  */
@@ -321,12 +647,12 @@ VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetDerivative(
 
 
 /**
- * ******************* GetValueAndDerivative *******************
+ * ******************* GetValueAndDerivativeSingleThreaded *******************
  */
 
 template <class TFixedImage, class TMovingImage>
 void
-VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivativeSingleThreaded(
   const TransformParametersType & parameters,
   MeasureType &                   value,
   DerivativeType &                derivative) const
@@ -492,76 +818,245 @@ VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValueAndDeri
   /** Subtract mean from derivative elements. */
   if (m_SubtractMean)
   {
-    if (!m_TransformIsStackTransform)
+    this->SubtractMeanFromDerivative(derivative);
+  }
+
+  /** Return the measure value. */
+  value = measure;
+
+} // end GetValueAndDerivativeSingleThreaded()
+
+
+/**
+ * ******************* GetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
+  const TransformParametersType & parameters,
+  MeasureType &                   value,
+  DerivativeType &                derivative) const
+{
+  /** Option for now to still use the single threaded code. */
+  if (!Superclass::m_UseMultiThread)
+  {
+    return this->GetValueAndDerivativeSingleThreaded(parameters, value, derivative);
+  }
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * Because of these calls GetValueAndDerivative itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   * This is however needed in the CombinationImageToImageMetric.
+   * In that case, you need to:
+   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
+   *   calling GetValueAndDerivative
+   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
+   * - Now you can call GetValueAndDerivative multi-threaded.
+   */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Determine the last dimension positions of the samples, before the threads start. */
+  this->InitializeLastDimPositions(this->GetImageSampler()->GetOutput()->Size());
+
+  /** Launch multi-threading metric */
+  this->LaunchGetValueAndDerivativeThreaderCallback();
+
+  /** Gather the metric values and derivatives from all threads. */
+  this->AfterThreadedGetValueAndDerivative(value, derivative);
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::ThreadedGetValueAndDerivative(
+  ThreadIdType threadId) const
+{
+  /** Get a handle to the pre-allocated derivative for the current thread.
+   * The initialization is performed at the beginning of each resolution in
+   * InitializeThreadingParameters(), and at the end of each iteration in
+   * AfterThreadedGetValueAndDerivative() and the accumulate functions.
+   */
+  PerThreadDerivativeType & derivative = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
+
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** Create iterator over the sample container. */
+  const auto beginOfSampleContainer = sampleContainer->cbegin();
+
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+  MeasureType   measure{};
+
+  /** The fixed and the transformed points of the last dimension positions of the current sample, stored in the
+   * buffers of this thread, which keep their capacity between calls. */
+  auto & perThreadVariables = Superclass::m_GetValueAndDerivativePerThreadVariables[threadId];
+  auto & fixedPoints = perThreadVariables.st_FixedPoints;
+  auto & mappedPoints = perThreadVariables.st_MappedPoints;
+
+  /** Variables to store M(T(x,t)), dM(T(x,t))/dmu and the nzji of the positions that are inside the moving image. */
+  const unsigned int                      numberOfPositions = m_NumberOfLastDimPositions;
+  const NumberOfParametersType            nnzji = Superclass::m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  std::vector<RealType>                   MT(numberOfPositions);
+  std::vector<DerivativeType>             dMTdmu(numberOfPositions, DerivativeType(nnzji));
+  std::vector<NonZeroJacobianIndicesType> nzjis(numberOfPositions, NonZeroJacobianIndicesType(nnzji));
+
+  /** Loop over the chunks of samples that are assigned to this thread. */
+  size_t pos_begin{};
+  size_t pos_end{};
+  while (this->GetNextSampleChunk(sampleContainerSize, threadId, pos_begin, pos_end))
+  {
+    /** Loop over the fixed image samples to calculate the variance over time for every sample position. */
+    for (size_t sampleIndex = pos_begin; sampleIndex < pos_end; ++sampleIndex)
     {
-      /** Update derivative per dimension.
-       * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
-       * per dimension xyz.
-       */
-      const unsigned int lastDimGridSize = m_GridSize[lastDim];
-      const unsigned int numParametersPerDimension =
-        this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
-      const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
-      DerivativeType     mean(numControlPointsPerDimension);
-      for (unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d)
+      /** Transform the points of all last dimension positions of the sample at once. */
+      const FixedImagePointType & fixedPoint = beginOfSampleContainer[sampleIndex].m_ImageCoordinates;
+      this->TransformPointsOfLastDimPositions(sampleIndex, fixedPoint, fixedPoints, mappedPoints);
+
+      /** Loop over the slowest varying dimension. */
+      float        sumValues = 0.0;
+      float        sumValuesSquared = 0.0;
+      unsigned int numSamplesOk = 0;
+
+      /** First loop over t: compute M(T(x,t)), dM(T(x,t))/dmu, nzji and store. */
+      for (unsigned int d = 0; d < numberOfPositions; ++d)
       {
-        /** Compute mean per dimension. */
-        mean.Fill(0.0);
-        const unsigned int starti = numParametersPerDimension * d;
-        for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
-        {
-          const unsigned int index = i % numControlPointsPerDimension;
-          mean[index] += derivative[i];
-        }
-        mean /= static_cast<double>(lastDimGridSize);
+        /** Initialize some variables. */
+        RealType                  movingImageValue;
+        MovingImageDerivativeType movingImageDerivative;
 
-        /** Update derivative for every control point per dimension. */
-        for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
+        /** Check if the point is inside the moving mask. */
+        bool sampleOk = this->IsInsideMovingMask(mappedPoints[d]);
+
+        /** Compute the moving image value and check if the point is
+         * inside the moving image buffer. */
+        if (sampleOk)
         {
-          const unsigned int index = i % numControlPointsPerDimension;
-          derivative[i] -= mean[index];
+          sampleOk = this->FastEvaluateMovingImageValueAndDerivative(
+            mappedPoints[d], movingImageValue, &movingImageDerivative, threadId);
         }
-      }
-    }
-    else
-    {
-      /** Update derivative per dimension.
-       * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
-       * the number the time point index.
-       */
-      const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / lastDimSize;
-      DerivativeType     mean(numParametersPerLastDimension);
-      mean.Fill(0.0);
 
-      /** Compute mean per control point. */
-      for (unsigned int t = 0; t < lastDimSize; ++t)
-      {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+        if (sampleOk)
         {
-          const unsigned int index = c % numParametersPerLastDimension;
-          mean[index] += derivative[c];
+          /** Update value terms **/
+          sumValues += movingImageValue;
+          sumValuesSquared += movingImageValue * movingImageValue;
+
+          /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx.
+           * The positions that are inside are stored at the front. */
+          Superclass::m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+            fixedPoints[d], movingImageDerivative, dMTdmu[numSamplesOk], nzjis[numSamplesOk]);
+          MT[numSamplesOk] = movingImageValue;
+          ++numSamplesOk;
         }
       }
-      mean /= static_cast<double>(lastDimSize);
 
-      /** Update derivative per control point. */
-      for (unsigned int t = 0; t < lastDimSize; ++t)
+      if (numSamplesOk > 0)
       {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+        ++numberOfPixelsCounted;
+
+        /** Compute average intensity value. */
+        const float expectedValue = sumValues / static_cast<float>(numSamplesOk);
+        /** Add this variance to the variance sum. */
+        const float expectedSquaredValue = sumValuesSquared / static_cast<float>(numSamplesOk);
+        measure += expectedSquaredValue - expectedValue * expectedValue;
+
+        /** Second loop over t: update derivative. */
+        for (unsigned int d = 0; d < numSamplesOk; ++d)
         {
-          const unsigned int index = c % numParametersPerLastDimension;
-          derivative[c] -= mean[index];
+          const DerivativeValueType weight = 2.0 * (MT[d] - expectedValue) / static_cast<float>(numSamplesOk);
+          for (unsigned int j = 0; j < nzjis[d].size(); ++j)
+          {
+            derivative[nzjis[d][j]] += weight * dMTdmu[d][j];
+          }
         }
       }
-    }
+    } // end for loop over the image sample container
   }
 
-  /** Return the measure value. */
-  value = measure;
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  Superclass::m_GetValueAndDerivativePerThreadVariables[threadId].st_Value = measure;
 
-} // end GetValueAndDerivative()
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::AfterThreadedGetValueAndDerivative(
+  MeasureType &    value,
+  DerivativeType & derivative) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Accumulate the number of pixels. */
+  Superclass::m_NumberOfPixelsCounted =
+    Superclass::m_GetValueAndDerivativePerThreadVariables[0].st_NumberOfPixelsCounted;
+  for (ThreadIdType i = 1; i < numberOfThreads; ++i)
+  {
+    Superclass::m_NumberOfPixelsCounted +=
+      Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted;
+  }
+
+  /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->CheckNumberOfSamples(sampleContainer->Size(), Superclass::m_NumberOfPixelsCounted);
+
+  /** Compute average over variances and normalize with initial variance. */
+  const DerivativeValueType normal_sum =
+    1.0 / static_cast<float>(Superclass::m_NumberOfPixelsCounted * m_InitialVariance);
+
+  /** Accumulate values. */
+  value = MeasureType{};
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+  {
+    value += Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_Value;
+
+    /** Reset this variable for the next iteration. */
+    Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_Value = MeasureType{};
+  }
+  value *= normal_sum;
+
+  /** Accumulate derivatives. The accumulate threader callback hands out the derivative in blocks, so it is only used
+   * when the derivative is not processed afterwards. */
+  derivative.SetSize(this->GetNumberOfParameters());
+  if (!m_SubtractMean)
+  {
+    Superclass::m_ThreaderMetricParameters.st_DerivativePointer = derivative.begin();
+    Superclass::m_ThreaderMetricParameters.st_NormalizationFactor = 1.0 / normal_sum;
+
+    this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                                 &(Superclass::m_ThreaderMetricParameters));
+  }
+  else
+  {
+    this->SumPerThreadDerivatives(derivative, normal_sum);
+
+    /** Reset the derivatives of the threads for the next iteration. */
+    for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+    {
+      Superclass::m_GetValueAndDerivativePerThreadVariables[i].st_Derivative.Fill(PerThreadDerivativeValueType{});
+    }
+
+    /** Subtract mean from derivative elements. */
+    this->SubtractMeanFromDerivative(derivative);
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
 
 
 } // end namespace itk
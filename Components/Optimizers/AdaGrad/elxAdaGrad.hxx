@@ -20,6 +20,7 @@
 
 #include "elxAdaGrad.h"
 #include "elxDeref.h"
+#include "elxRandomGenerator.h"
 
 #include <cmath> // For abs.
 #include <iomanip>
@@ -65,7 +66,7 @@ AdaGrad<TElastix>::AdaGrad()
   this->m_SigmoidScaleFactor = 0.1;
   this->m_GlobalStepSize = 0;
 
-  this->m_RandomGenerator = RandomGeneratorType::GetInstance();
+  this->m_RandomGenerator = RandomGenerator::GetCurrent();
   this->m_AdvancedTransform = nullptr;
 
   this->m_UseNoiseCompensation = true;
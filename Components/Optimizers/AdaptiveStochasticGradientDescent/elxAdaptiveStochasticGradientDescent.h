@@ -159,6 +159,14 @@ namespace elastix
  *   number of transform parameters. This is a rather crude rule of thumb,
  *   which seems to work in practice. In principle, the more the better, but the slower.
  *   The parameter has only influence when AutomaticParameterEstimation is used.
+ * \parameter JacobianTermsMaximumThreadMemory: The maximum amount of memory, in megabytes, that the
+ *   per-thread covariance accumulators may occupy together, while estimating the Jacobian terms.
+ *   When the limit is reached, fewer threads are used for the accumulation. Zero means that the
+ *   accumulation is single-threaded.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(JacobianTermsMaximumThreadMemory 1024)</tt>\n
+ *   Default value: 512.
+ *   The parameter has only influence when AutomaticParameterEstimation is used.
  * \parameter NumberOfSamplesForExactGradient: The number of image samples used to compute
  *   the 'exact' gradient. The samples are chosen on a uniform grid.
  *   The parameter can be specified for each resolution, or for all resolutions at once.\n
@@ -182,6 +190,11 @@ namespace elastix
  *   The parameter can be specified for each resolution, or for all resolutions at once.\n
  *   example: <tt>(NoiseCompensation "true")</tt>\n
  *   Default/recommended: true.
+ * \parameter UseFusedStep: Whether the step for each block of parameters is taken right after the metric has
+ *   accumulated the derivative of that block, instead of in separate sweeps over all parameters afterwards.
+ *   The result is the same either way; the fused step just saves memory bandwidth for large transforms.\n
+ *   example: <tt>(UseFusedStep "false")</tt>\n
+ *   Default: true.
  *
  * \todo: this class contains a lot of functional code, which actually does not belong here.
  *
@@ -408,6 +421,9 @@ private:
   SizeValueType m_MaxBandCovSize;
   SizeValueType m_NumberOfBandStructureSamples;
 
+  /** Private variable for the memory limit of the Jacobian terms computation, in megabytes. */
+  SizeValueType m_JacobianTermsMaximumThreadMemory;
+
   /** The flag of using noise compensation. */
   bool m_UseNoiseCompensation;
   bool m_OriginalButSigmoidToDefault;
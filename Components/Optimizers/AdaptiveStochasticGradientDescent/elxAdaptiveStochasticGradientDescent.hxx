@@ -20,6 +20,7 @@
 
 #include "elxAdaptiveStochasticGradientDescent.h"
 #include "elxDeref.h"
+#include "elxRandomGenerator.h"
 
 #include <iomanip>
 #include <string>
@@ -54,12 +55,15 @@ AdaptiveStochasticGradientDescent<TElastix>::AdaptiveStochasticGradientDescent()
   this->m_NumberOfSamplesForExactGradient = 100000;
   this->m_SigmoidScaleFactor = 0.1;
 
-  this->m_RandomGenerator = RandomGeneratorType::GetInstance();
+  this->m_RandomGenerator = RandomGenerator::GetCurrent();
   this->m_AdvancedTransform = nullptr;
 
   this->m_UseNoiseCompensation = true;
   this->m_OriginalButSigmoidToDefault = false;
 
+  /** Take the step while the metric accumulates its derivative. */
+  this->SetUseFusedStep(true);
+
 } // Constructor
 
 
@@ -85,6 +89,11 @@ AdaptiveStochasticGradientDescent<TElastix>::BeforeRegistration()
 
   this->m_SettingsVector.clear();
 
+  /** Take the step while the metric accumulates its derivative, unless specified otherwise. */
+  bool useFusedStep = true;
+  this->GetConfiguration()->ReadParameter(useFusedStep, "UseFusedStep", this->GetComponentLabel(), 0, 0);
+  this->SetUseFusedStep(useFusedStep);
+
 } // end BeforeRegistration()
 
 
@@ -144,6 +153,15 @@ AdaptiveStochasticGradientDescent<TElastix>::BeforeEachResolution()
   configuration.ReadParameter(
     this->m_NumberOfBandStructureSamples, "NumberOfBandStructureSamples", this->GetComponentLabel(), level, 0);
 
+  /** Set the memory limit of the per-thread accumulators of the Jacobian terms, in megabytes. */
+  this->m_JacobianTermsMaximumThreadMemory = 512;
+  configuration.ReadParameter(this->m_JacobianTermsMaximumThreadMemory,
+                              "JacobianTermsMaximumThreadMemory",
+                              this->GetComponentLabel(),
+                              level,
+                              0,
+                              false);
+
   /** Set/Get whether the adaptive step size mechanism is desired. Default: true
    * NB: the setting is turned of in case of UseRandomSampleRegion=true.
    * Deprecated alias UseCruzAcceleration is also still supported.
@@ -540,6 +558,7 @@ AdaptiveStochasticGradientDescent<TElastix>::AutomaticParameterEstimationOrigina
   computeJacobianTerms->SetMaxBandCovSize(this->m_MaxBandCovSize);
   computeJacobianTerms->SetNumberOfBandStructureSamples(this->m_NumberOfBandStructureSamples);
   computeJacobianTerms->SetNumberOfJacobianMeasurements(this->m_NumberOfJacobianMeasurements);
+  computeJacobianTerms->SetMaximumThreadAccumulatorMemory(this->m_JacobianTermsMaximumThreadMemory * 1024 * 1024);
 
   /** Check if use scales. */
   bool useScales = this->GetUseScales();
@@ -20,6 +20,7 @@
 
 #include "elxAdaptiveStochasticLBFGS.h"
 #include "elxDeref.h"
+#include "elxRandomGenerator.h"
 
 #include <iomanip>
 #include <string>
@@ -78,7 +79,7 @@ AdaptiveStochasticLBFGS<TElastix>::AdaptiveStochasticLBFGS()
   this->m_Bound = 0;
   this->m_WindowScale = 5;
 
-  this->m_RandomGenerator = RandomGeneratorType::GetInstance();
+  this->m_RandomGenerator = RandomGenerator::GetCurrent();
   this->m_AdvancedTransform = nullptr;
 
   this->m_UseNoiseCompensation = true;
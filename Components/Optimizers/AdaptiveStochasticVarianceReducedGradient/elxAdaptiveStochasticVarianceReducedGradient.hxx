@@ -20,6 +20,7 @@
 
 #include "elxAdaptiveStochasticVarianceReducedGradient.h"
 #include "elxDeref.h"
+#include "elxRandomGenerator.h"
 
 #include <iomanip>
 #include <string>
@@ -74,7 +75,7 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::AdaptiveStochasticVarianceR
   this->m_NumberOfInnerIterations = 50;
   this->m_OutsideIterations = 10;
 
-  this->m_RandomGenerator = RandomGeneratorType::GetInstance();
+  this->m_RandomGenerator = RandomGenerator::GetCurrent();
   this->m_AdvancedTransform = nullptr;
 
   this->m_UseNoiseCompensation = true;
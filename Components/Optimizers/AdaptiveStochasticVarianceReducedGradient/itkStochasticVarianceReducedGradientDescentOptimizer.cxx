@@ -18,6 +18,7 @@
 
 #include "itkStochasticVarianceReducedGradientDescentOptimizer.h"
 
+#include "elxWorkStealingThreadPool.h"
 #include "itkCommand.h"
 #include "itkEventObject.h"
 #include "itkMacro.h"
@@ -288,11 +289,9 @@ StochasticVarianceReducedGradientDescentOptimizer::AdvanceOneStep()
     temp.t_NewPosition = &newPosition;
     temp.t_Optimizer = this;
 
-    /** Call multi-threaded AdvanceOneStep(). */
-    auto local_threader = ThreaderType::New();
-    local_threader->SetNumberOfWorkUnits(this->m_Threader->GetNumberOfWorkUnits());
-    local_threader->SetSingleMethod(AdvanceOneStepThreaderCallback, &temp);
-    local_threader->SingleMethodExecute();
+    /** Call multi-threaded AdvanceOneStep(), on the persistent thread pool. */
+    elastix::WorkStealingThreadPool::GetInstance().SingleMethodExecute(
+      this->m_Threader->GetNumberOfWorkUnits(), AdvanceOneStepThreaderCallback, &temp);
   }
 
   this->InvokeEvent(IterationEvent());
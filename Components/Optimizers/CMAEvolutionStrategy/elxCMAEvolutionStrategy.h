@@ -106,7 +106,13 @@ namespace elastix
  *    covariance matrix is updated. If 0, the optimizer estimates a value. The actual value used is
  *    reported back in the elastix.log file. This parameter can be specified for each resolution. \n
  *    example: <tt>(UpdateBDPeriod 0 0 50)</tt> \n
- *    Default: 0 (so, automatically determined).
+ *    Default: 0 (so, automatically determined).\n
+ * \parameter EvaluatePopulationConcurrently: whether to evaluate the parameter vectors of each
+ *    iteration concurrently, by evaluation contexts of the metric. Only supported by the metrics
+ *    AdvancedMeanSquares, AdvancedNormalizedCorrelation, and AdvancedMattesMutualInformation, with the
+ *    MultiResolutionRegistration. Otherwise, the population is evaluated one by one.\n
+ *    example: <tt>(EvaluatePopulationConcurrently "true")</tt> \n
+ *    Default: "false". This parameter can be specified for each resolution.
  *
  * \ingroup Optimizers
  */
@@ -20,6 +20,9 @@
 #define elxCMAEvolutionStrategy_hxx
 
 #include "elxCMAEvolutionStrategy.h"
+#include "itkEvaluationContextCostFunctionInterface.h"
+#include <itkMultiThreaderBase.h>
+#include <algorithm> // For min.
 #include <iomanip>
 #include <string>
 #include <vnl/vnl_math.h>
@@ -49,6 +52,34 @@ CMAEvolutionStrategy<TElastix>::StartOptimization()
     }
   }
 
+  /** Create an evaluation context of the metric for each additional worker, now that the metric is initialized. */
+  this->RemovePopulationCostFunctions();
+  if (this->GetEvaluatePopulationConcurrently())
+  {
+    unsigned int numberOfWorkers = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+    if (this->GetPopulationSize() > 0)
+    {
+      numberOfWorkers = std::min(numberOfWorkers, this->GetPopulationSize());
+    }
+
+    const auto costFunction = dynamic_cast<const itk::EvaluationContextCostFunctionInterface *>(
+      this->GetScaledCostFunction()->GetUnscaledCostFunction());
+    for (unsigned int i = 1; i < numberOfWorkers; ++i)
+    {
+      const itk::SingleValuedCostFunction::Pointer evaluationContext =
+        (costFunction == nullptr) ? itk::SingleValuedCostFunction::Pointer() : costFunction->CreateEvaluationContext();
+      if (evaluationContext.IsNull())
+      {
+        log::warn("WARNING: The metric does not support concurrent evaluation. The population is evaluated one by "
+                  "one, instead.");
+        this->RemovePopulationCostFunctions();
+        this->SetEvaluatePopulationConcurrently(false);
+        break;
+      }
+      this->AddPopulationCostFunction(evaluationContext);
+    }
+  }
+
   /** Call the superclass */
   this->Superclass1::StartOptimization();
 
@@ -194,6 +225,12 @@ CMAEvolutionStrategy<TElastix>::BeforeEachResolution()
   this->m_Configuration->ReadParameter(minimumDeviation, "MinimumDeviation", this->GetComponentLabel(), level, 0);
   this->SetMinimumDeviation(minimumDeviation);
 
+  /** Set EvaluatePopulationConcurrently */
+  bool evaluatePopulationConcurrently = false;
+  this->m_Configuration->ReadParameter(
+    evaluatePopulationConcurrently, "EvaluatePopulationConcurrently", this->GetComponentLabel(), level, 0);
+  this->SetEvaluatePopulationConcurrently(evaluatePopulationConcurrently);
+
 } // end BeforeEachResolution
 
 
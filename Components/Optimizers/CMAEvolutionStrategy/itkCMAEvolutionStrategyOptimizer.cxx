@@ -17,10 +17,13 @@
  *=========================================================================*/
 
 #include "itkCMAEvolutionStrategyOptimizer.h"
+#include "itkEvaluationContextCostFunctionInterface.h"
 #include "itkSymmetricEigenAnalysis.h"
+#include "elxWorkStealingThreadPool.h"
 #include <vnl/vnl_math.h>
 #include <algorithm>
 #include <cmath>
+#include <numeric> // For iota.
 #include "itkCommand.h"
 #include "itkEventObject.h"
 #include "itkMacro.h"
@@ -84,6 +87,9 @@ CMAEvolutionStrategyOptimizer::PrintSelf(std::ostream & os, Indent indent) const
   os << indent << "m_PositionToleranceMin: " << this->m_PositionToleranceMin << std::endl;
   os << indent << "m_PositionToleranceMax: " << this->m_PositionToleranceMax << std::endl;
   os << indent << "m_ValueTolerance: " << this->m_ValueTolerance << std::endl;
+  os << indent << "m_EvaluatePopulationConcurrently: " << this->m_EvaluatePopulationConcurrently << std::endl;
+  os << indent << "m_PopulationScaledCostFunctions.size(): " << this->m_PopulationScaledCostFunctions.size()
+     << std::endl;
 
   os << indent << "m_RecombinationWeights: " << this->m_RecombinationWeights << std::endl;
   os << indent << "m_C: " << this->m_C << std::endl;
@@ -118,6 +124,14 @@ CMAEvolutionStrategyOptimizer::StartOptimization()
   /** Initialize the scaledCostFunction with the currently set scales */
   this->InitializeScales();
 
+  /** Let the scaled versions of the population cost functions use the same scales */
+  for (const auto & populationScaledCostFunction : this->m_PopulationScaledCostFunctions)
+  {
+    populationScaledCostFunction->SetSquaredScales(this->GetScales());
+    populationScaledCostFunction->SetUseScales(this->GetUseScales());
+    populationScaledCostFunction->SetNegateCostFunction(this->GetMaximize());
+  }
+
   /** Set the current position as the scaled initial position */
   this->SetCurrentPosition(this->GetInitialPosition());
 
@@ -442,6 +456,72 @@ CMAEvolutionStrategyOptimizer::InitializeBCD()
 } // end InitializeBCD
 
 
+/**
+ * ****************** AddPopulationCostFunction *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::AddPopulationCostFunction(CostFunctionType * costFunction)
+{
+  if (costFunction == nullptr)
+  {
+    itkExceptionMacro("The population cost function should not be null.");
+  }
+
+  const auto scaledCostFunction = ScaledCostFunctionType::New();
+  scaledCostFunction->SetUnscaledCostFunction(costFunction);
+  this->m_PopulationScaledCostFunctions.push_back(scaledCostFunction);
+  this->Modified();
+
+} // end AddPopulationCostFunction
+
+
+/**
+ * ****************** RemovePopulationCostFunctions *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::RemovePopulationCostFunctions()
+{
+  if (!this->m_PopulationScaledCostFunctions.empty())
+  {
+    this->m_PopulationScaledCostFunctions.clear();
+    this->Modified();
+  }
+
+} // end RemovePopulationCostFunctions
+
+
+/**
+ * ****************** DrawSearchDirection *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::DrawSearchDirection(const unsigned int lam)
+{
+  /** Get the number of parameters from the cost function */
+  const unsigned int N = this->GetScaledCostFunction()->GetNumberOfParameters();
+
+  /** draw from distribution N(0,I) */
+  for (unsigned int par = 0; par < N; ++par)
+  {
+    this->m_NormalizedSearchDirs[lam][par] = this->m_RandomGenerator->GetNormalVariate();
+  }
+  /** Make like it was drawn from N(0,C) */
+  if (this->GetUseCovarianceMatrixAdaptation())
+  {
+    this->m_SearchDirs[lam] = this->m_B * (this->m_D * this->m_NormalizedSearchDirs[lam]);
+  }
+  else
+  {
+    this->m_SearchDirs[lam] = this->m_NormalizedSearchDirs[lam];
+  }
+  /** Make like it was drawn from N( 0, sigma^2 C ) */
+  this->m_SearchDirs[lam] *= this->m_CurrentSigma;
+
+} // end DrawSearchDirection
+
+
 /**
  * ****************** GenerateOffspring *********************
  */
@@ -451,11 +531,13 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring()
 {
   itkDebugMacro("GenerateOffspring");
 
-  /** Get the number of parameters from the cost function */
-  const unsigned int numberOfParameters = this->GetScaledCostFunction()->GetNumberOfParameters();
+  if (this->m_EvaluatePopulationConcurrently)
+  {
+    this->GenerateOffspringConcurrently();
+    return;
+  }
 
   /** Some casts/aliases: */
-  const unsigned int N = numberOfParameters;
   const unsigned int lambda = this->m_PopulationSize;
 
   /** Clear the old values */
@@ -466,22 +548,7 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring()
   unsigned int nrOfFails = 0;
   while (lam < lambda)
   {
-    /** draw from distribution N(0,I) */
-    for (unsigned int par = 0; par < N; ++par)
-    {
-      this->m_NormalizedSearchDirs[lam][par] = this->m_RandomGenerator->GetNormalVariate();
-    }
-    /** Make like it was drawn from N(0,C) */
-    if (this->GetUseCovarianceMatrixAdaptation())
-    {
-      this->m_SearchDirs[lam] = this->m_B * (this->m_D * this->m_NormalizedSearchDirs[lam]);
-    }
-    else
-    {
-      this->m_SearchDirs[lam] = this->m_NormalizedSearchDirs[lam];
-    }
-    /** Make like it was drawn from N( 0, sigma^2 C ) */
-    this->m_SearchDirs[lam] *= this->m_CurrentSigma;
+    this->DrawSearchDirection(lam);
 
     /** Compute the cost function */
     MeasureType costFunctionValue = 0.0;
@@ -520,6 +587,123 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring()
 } // end GenerateOffspring
 
 
+/**
+ * ****************** GenerateOffspringConcurrently *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::GenerateOffspringConcurrently()
+{
+  itkDebugMacro("GenerateOffspringConcurrently");
+
+  /** Some casts/aliases: */
+  const unsigned int lambda = this->m_PopulationSize;
+
+  /** Clear the old values */
+  this->m_CostFunctionValues.clear();
+
+  /** Initially all offspring members are pending */
+  this->m_PendingOffspring.resize(lambda);
+  std::iota(this->m_PendingOffspring.begin(), this->m_PendingOffspring.end(), 0u);
+  this->m_OffspringValues.assign(lambda, MeasureType{});
+  this->m_OffspringExceptions.assign(lambda, nullptr);
+  std::vector<unsigned int> nrOfFails(lambda, 0);
+
+  /** One worker for the cost function, and one for each population cost function */
+  const unsigned int numberOfWorkUnits = 1 + this->GetNumberOfPopulationCostFunctions();
+
+  /** Population cost functions that are evaluation contexts of the cost function are updated to its current state,
+   * for example its current samples, before the generation is evaluated */
+  if (const auto costFunction = dynamic_cast<const EvaluationContextCostFunctionInterface *>(
+        this->m_ScaledCostFunction->GetUnscaledCostFunction()))
+  {
+    for (const auto & populationScaledCostFunction : this->m_PopulationScaledCostFunctions)
+    {
+      costFunction->UpdateEvaluationContext(*(populationScaledCostFunction->GetModifiableUnscaledCostFunction()));
+    }
+  }
+
+  while (!this->m_PendingOffspring.empty())
+  {
+    /** Draw the pending offspring in a fixed order, before evaluating any of them,
+     * so that the random sequence does not depend on the number of workers */
+    for (const unsigned int lam : this->m_PendingOffspring)
+    {
+      this->DrawSearchDirection(lam);
+    }
+
+    /** Evaluate the pending offspring concurrently, by the threads of the pool */
+    elastix::WorkStealingThreadPool::GetInstance().ForkJoin(
+      numberOfWorkUnits, [this, numberOfWorkUnits](unsigned int workUnit) {
+        this->ThreadedEvaluateOffspring(workUnit, numberOfWorkUnits);
+      });
+
+    /** Offspring members whose evaluation failed are drawn again,
+     * if we haven't tried that for 10 times already */
+    std::vector<unsigned int> failedOffspring;
+    for (const unsigned int lam : this->m_PendingOffspring)
+    {
+      if (this->m_OffspringExceptions[lam] != nullptr)
+      {
+        ++nrOfFails[lam];
+        if (nrOfFails[lam] > 10)
+        {
+          this->m_StopCondition = MetricError;
+          this->StopOptimization();
+          std::rethrow_exception(this->m_OffspringExceptions[lam]);
+        }
+        this->m_OffspringExceptions[lam] = nullptr;
+        failedOffspring.push_back(lam);
+      }
+    }
+    this->m_PendingOffspring.swap(failedOffspring);
+  }
+
+  /** Successfull cost function evaluations */
+  for (unsigned int lam = 0; lam < lambda; ++lam)
+  {
+    this->m_CostFunctionValues.push_back(MeasureIndexPairType(this->m_OffspringValues[lam], lam));
+  }
+
+} // end GenerateOffspringConcurrently
+
+
+/**
+ * ****************** ThreadedEvaluateOffspring *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::ThreadedEvaluateOffspring(const unsigned int workUnit,
+                                                         const unsigned int numberOfWorkUnits)
+{
+  /** Worker 0 uses the cost function, the others use their own population cost function */
+  const ScaledCostFunctionType & scaledCostFunction =
+    (workUnit == 0) ? *(this->m_ScaledCostFunction) : *(this->m_PopulationScaledCostFunctions[workUnit - 1]);
+
+  const std::size_t numberOfPendingOffspring = this->m_PendingOffspring.size();
+
+  for (std::size_t i = workUnit; i < numberOfPendingOffspring; i += numberOfWorkUnits)
+  {
+    const unsigned int lam = this->m_PendingOffspring[i];
+
+    /** x_lam = m + d_lam */
+    ParametersType x_lam = this->GetScaledCurrentPosition();
+    x_lam += this->m_SearchDirs[lam];
+
+    /** Any exception is passed to GenerateOffspringConcurrently(), which runs in the main thread */
+    try
+    {
+      this->m_OffspringValues[lam] = scaledCostFunction.GetValue(x_lam);
+    }
+    catch (...)
+    {
+      this->m_OffspringExceptions[lam] = std::current_exception();
+    }
+  }
+
+} // end ThreadedEvaluateOffspring
+
+
 /**
  * ****************** SortCostFunctionValues *********************
  */
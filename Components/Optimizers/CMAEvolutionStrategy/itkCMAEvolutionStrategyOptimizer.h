@@ -27,7 +27,9 @@
 #include "itkArray.h"
 #include "itkArray2D.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "elxRandomGenerator.h"
 #include <vnl/vnl_diag_matrix.h>
+#include <exception>
 
 namespace itk
 {
@@ -43,6 +45,16 @@ namespace itk
  *   - See also the Matlab code, cmaes.m, which you can download from the
  *     website mentioned above.
  *
+ * When EvaluatePopulationConcurrently is set, all offspring of a generation are drawn
+ * before any of them is evaluated, after which they are evaluated concurrently: one worker
+ * uses the cost function, and one additional worker is started for each cost function added
+ * by AddPopulationCostFunction(). Such a cost function must be an independent copy of the
+ * cost function (with its own metric, transform and interpolator), so that the workers do not
+ * share any mutable state. Because every offspring member is evaluated on its own, the results
+ * do not depend on the number of workers. When the cost function implements the
+ * EvaluationContextCostFunctionInterface, the population cost functions may be evaluation contexts
+ * created by the cost function, which are updated at the start of each generation.
+ *
  * \ingroup Numerics Optimizers
  */
 
@@ -224,6 +236,28 @@ public:
   itkSetMacro(ValueTolerance, double);
   itkGetConstMacro(ValueTolerance, double);
 
+  /** Setting: whether the offspring of a generation are drawn first, and then evaluated
+   * concurrently, by one worker per cost function.
+   * Default: false */
+  itkSetMacro(EvaluatePopulationConcurrently, bool);
+  itkGetConstMacro(EvaluatePopulationConcurrently, bool);
+
+  /** Add an independent copy of the cost function, used by an additional worker
+   * when EvaluatePopulationConcurrently is true. */
+  virtual void
+  AddPopulationCostFunction(CostFunctionType * costFunction);
+
+  /** Remove all cost functions added by AddPopulationCostFunction(). */
+  virtual void
+  RemovePopulationCostFunctions();
+
+  /** Get the number of cost functions added by AddPopulationCostFunction(). */
+  unsigned int
+  GetNumberOfPopulationCostFunctions() const
+  {
+    return static_cast<unsigned int>(this->m_PopulationScaledCostFunctions.size());
+  }
+
 protected:
   using RecombinationWeightsType = Array<double>;
   using EigenValueMatrixType = vnl_diag_matrix<double>;
@@ -237,7 +271,7 @@ protected:
   using RandomGeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
 
   /** The random number generator used to generate the offspring. */
-  RandomGeneratorType::Pointer m_RandomGenerator{ RandomGeneratorType::GetInstance() };
+  RandomGeneratorType::Pointer m_RandomGenerator{ elastix::RandomGenerator::GetCurrent() };
 
   /** The value of the cost function at the current position */
   MeasureType m_CurrentValue{ 0.0 };
@@ -366,6 +400,19 @@ protected:
   virtual void
   GenerateOffspring();
 
+  /** Draw the search direction of offspring member lam: fill m_SearchDirs[lam]
+   * and m_NormalizedSearchDirs[lam] */
+  virtual void
+  DrawSearchDirection(unsigned int lam);
+
+  /** GenerateOffspring, when EvaluatePopulationConcurrently is true */
+  virtual void
+  GenerateOffspringConcurrently();
+
+  /** Evaluate the cost function of the pending offspring members assigned to the specified worker */
+  virtual void
+  ThreadedEvaluateOffspring(unsigned int workUnit, unsigned int numberOfWorkUnits);
+
   /** Sort the m_CostFunctionValues vector and update m_MeasureHistory */
   virtual void
   SortCostFunctionValues();
@@ -436,6 +483,15 @@ private:
   double        m_PositionToleranceMax{ 1e8 };
   double        m_PositionToleranceMin{ 1e-12 };
   double        m_ValueTolerance{ 1e-12 };
+  bool          m_EvaluatePopulationConcurrently{ false };
+
+  /** The scaled versions of the cost functions added by AddPopulationCostFunction(). */
+  std::vector<ScaledCostFunctionPointer> m_PopulationScaledCostFunctions{};
+
+  /** Variables shared by the workers that evaluate the offspring concurrently. */
+  std::vector<unsigned int>       m_PendingOffspring{};
+  std::vector<MeasureType>        m_OffspringValues{};
+  std::vector<std::exception_ptr> m_OffspringExceptions{};
 };
 
 } // end namespace itk
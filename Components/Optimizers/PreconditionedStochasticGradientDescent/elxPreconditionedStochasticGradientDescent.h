@@ -167,6 +167,11 @@ namespace elastix
  * \parameter RegularizationKappa: Selects for the preconditioner regularization.
  *   The parameter can be specified for each resolution, or for all resolutions at once.\n
  *   example: <tt>(RegularizationKappa 0.9)</tt>\n
+ * \parameter UseFusedStep: Whether the step for each block of parameters is taken right after the metric has
+ *   accumulated the derivative of that block, instead of in separate sweeps over all parameters afterwards.
+ *   The result is the same either way; the fused step just saves memory bandwidth for large transforms.\n
+ *   example: <tt>(UseFusedStep "false")</tt>\n
+ *   Default: true.
  *
  * \todo: this class contains a lot of functional code, which actually does not belong here.
  *
@@ -282,6 +287,14 @@ protected:
   PreconditionedStochasticGradientDescent();
   ~PreconditionedStochasticGradientDescent() override = default;
 
+  /** Sets the learning rate to a / (1 + k / A), with k the current time. */
+  void
+  UpdateLearningRate() override;
+
+  /** Takes the preconditioned step for the parameters [begin, end), and stores their search direction. */
+  void
+  AdvanceOneStepOfParameters(const unsigned int begin, const unsigned int end) override;
+
   /** Protected typedefs */
   using FixedImageType = typename RegistrationType::FixedImageType;
   using MovingImageType = typename RegistrationType::MovingImageType;
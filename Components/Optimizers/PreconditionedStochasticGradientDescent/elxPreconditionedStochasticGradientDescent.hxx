@@ -20,6 +20,7 @@
 
 #include "elxPreconditionedStochasticGradientDescent.h"
 #include "elxDeref.h"
+#include "elxRandomGenerator.h"
 
 #include <cmath> // For abs.
 #include <iomanip>
@@ -65,11 +66,14 @@ PreconditionedStochasticGradientDescent<TElastix>::PreconditionedStochasticGradi
   this->m_SigmoidScaleFactor = 0.1;
   this->m_GlobalStepSize = 0;
 
-  this->m_RandomGenerator = RandomGeneratorType::GetInstance();
+  this->m_RandomGenerator = RandomGenerator::GetCurrent();
   this->m_AdvancedTransform = nullptr;
 
   this->m_UseNoiseCompensation = true;
 
+  /** Take the step while the metric accumulates its derivative. */
+  this->SetUseFusedStep(true);
+
 } // Constructor
 
 
@@ -97,6 +101,11 @@ PreconditionedStochasticGradientDescent<TElastix>::BeforeRegistration()
 
   this->m_SettingsVector.clear();
 
+  /** Take the step while the metric accumulates its derivative, unless specified otherwise. */
+  bool useFusedStep = true;
+  this->GetConfiguration()->ReadParameter(useFusedStep, "UseFusedStep", this->GetComponentLabel(), 0, 0);
+  this->SetUseFusedStep(useFusedStep);
+
 } // end BeforeRegistration()
 
 
@@ -424,9 +433,43 @@ PreconditionedStochasticGradientDescent<TElastix>::AdvanceOneStep()
   const unsigned int spaceDimension = this->GetScaledCostFunction()->GetNumberOfParameters();
 
   /** Compute and set the learning rate. */
+  this->UpdateLearningRate();
+
+  /** Update the new position, unless the step was already fused with the derivative computation. */
+  if (!this->m_StepIsTakenWithDerivative)
+  {
+    this->AdvanceOneStepOfParameters(0, spaceDimension);
+  }
+
+  this->Superclass1::UpdateCurrentTime();
+  this->InvokeEvent(itk::IterationEvent());
+
+} // end AdvanceOneStep()
+
+
+/**
+ * ********************** UpdateLearningRate **********************
+ */
+
+template <class TElastix>
+void
+PreconditionedStochasticGradientDescent<TElastix>::UpdateLearningRate()
+{
   const double lamda = this->GetParam_a() / (1.0 + this->Superclass1::GetCurrentTime() / this->GetParam_A());
   this->SetLearningRate(lamda);
 
+} // end UpdateLearningRate()
+
+
+/**
+ * ********************** AdvanceOneStepOfParameters **********************
+ */
+
+template <class TElastix>
+void
+PreconditionedStochasticGradientDescent<TElastix>::AdvanceOneStepOfParameters(const unsigned int begin,
+                                                                              const unsigned int end)
+{
   DerivativeType & searchDirection = this->m_SearchDirection;
 
   /** Get a reference to the previously allocated newPosition. */
@@ -436,17 +479,14 @@ PreconditionedStochasticGradientDescent<TElastix>::AdvanceOneStep()
   const ParametersType & currentPosition = this->GetScaledCurrentPosition();
 
   /** Update the new position. */
-  const double lamda2 = lamda * this->m_NoiseFactor;
-  for (unsigned int j = 0; j < spaceDimension; ++j)
+  const double lamda2 = this->GetLearningRate() * this->m_NoiseFactor;
+  for (unsigned int j = begin; j < end; ++j)
   {
     searchDirection[j] = this->m_PreconditionVector[j] * this->m_Gradient[j];
     newPosition[j] = currentPosition[j] - lamda2 * searchDirection[j];
   }
 
-  this->Superclass1::UpdateCurrentTime();
-  this->InvokeEvent(itk::IterationEvent());
-
-} // end AdvanceOneStep()
+} // end AdvanceOneStepOfParameters()
 
 
 /**
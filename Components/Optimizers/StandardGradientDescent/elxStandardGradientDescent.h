@@ -59,6 +59,11 @@ namespace elastix
  *   SP_alpha can be defined for each resolution. \n
  *   example: <tt>(SP_alpha 0.602 0.602 0.602)</tt> \n
  *   The default/recommended value is 0.602.
+ * \parameter UseFusedStep: Whether the step for each block of parameters is taken right after the metric has
+ *   accumulated the derivative of that block, instead of in separate sweeps over all parameters afterwards.
+ *   The result is the same either way; the fused step just saves memory bandwidth for large transforms.\n
+ *   example: <tt>(UseFusedStep "false")</tt>\n
+ *   Default: true.
  *
  * \sa StandardGradientDescentOptimizer
  * \ingroup Optimizers
@@ -37,6 +37,9 @@ StandardGradientDescent<TElastix>::StandardGradientDescent()
   this->m_CurrentNumberOfSamplingAttempts = 0;
   this->m_PreviousErrorAtIteration = 0;
 
+  /** Take the step while the metric accumulates its derivative. */
+  this->SetUseFusedStep(true);
+
 } // end Constructor()
 
 
@@ -58,6 +61,11 @@ StandardGradientDescent<TElastix>::BeforeRegistration()
   this->GetIterationInfoAt("3:StepSize") << std::showpoint << std::fixed;
   this->GetIterationInfoAt("4:||Gradient||") << std::showpoint << std::fixed;
 
+  /** Take the step while the metric accumulates its derivative, unless specified otherwise. */
+  bool useFusedStep = true;
+  this->GetConfiguration()->ReadParameter(useFusedStep, "UseFusedStep", this->GetComponentLabel(), 0, 0);
+  this->SetUseFusedStep(useFusedStep);
+
 } // end BeforeRegistration()
 
 
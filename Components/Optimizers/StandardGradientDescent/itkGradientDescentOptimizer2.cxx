@@ -17,6 +17,7 @@
  *=========================================================================*/
 
 #include "itkGradientDescentOptimizer2.h"
+#include "elxProfiler.h"
 
 #include "itkCommand.h"
 #include "itkEventObject.h"
@@ -117,9 +118,23 @@ GradientDescentOptimizer2 ::ResumeOptimization()
       break;
     }
 
+    this->m_StepIsTakenWithDerivative = false;
     try
     {
-      this->GetScaledValueAndDerivative(this->GetScaledCurrentPosition(), m_Value, m_Gradient);
+      if (this->m_UseFusedStep)
+      {
+        /** Take the step block by block, while the derivative is accumulated. */
+        this->UpdateLearningRate();
+        this->m_StepIsTakenWithDerivative = this->GetScaledValueAndDerivativeInBlocks(
+          this->GetScaledCurrentPosition(),
+          m_Value,
+          m_Gradient,
+          [this](const unsigned int begin, const unsigned int end) { this->AdvanceOneStepOfParameters(begin, end); });
+      }
+      else
+      {
+        this->GetScaledValueAndDerivative(this->GetScaledCurrentPosition(), m_Value, m_Gradient);
+      }
     }
     catch (ExceptionObject & err)
     {
@@ -190,21 +205,19 @@ GradientDescentOptimizer2 ::AdvanceOneStep()
   /** Get space dimension. */
   const unsigned int spaceDimension = this->GetScaledCostFunction()->GetNumberOfParameters();
 
-  /** Get a reference to the previously allocated newPosition. */
-  ParametersType & newPosition = this->m_ScaledCurrentPosition;
-
   /** Advance one step. */
 #if 1 // force single-threaded since it is fastest most of the times
       //#ifndef ELASTIX_USE_OPENMP // If no OpenMP detected then use single-threaded code
-  /** Get a reference to the current position. */
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-
-  /** Update the new position. */
-  for (unsigned int j = 0; j < spaceDimension; ++j)
+  /** Update the new position, unless the step was already fused with the derivative computation. */
+  if (!this->m_StepIsTakenWithDerivative)
   {
-    newPosition[j] = currentPosition[j] - this->m_LearningRate * this->m_Gradient[j];
+    const elastix::Profiler::ScopedTimer profilerTimer("Optimizer::AdvanceOneStep");
+    this->AdvanceOneStepOfParameters(0, spaceDimension);
   }
 #else // Otherwise use OpenMP
+  /** Get a reference to the previously allocated newPosition. */
+  ParametersType & newPosition = this->m_ScaledCurrentPosition;
+
   /** Get a reference to the current position. */
   const ParametersType & currentPosition = this->GetScaledCurrentPosition();
 
@@ -223,4 +236,26 @@ GradientDescentOptimizer2 ::AdvanceOneStep()
 } // end AdvanceOneStep()
 
 
+/**
+ * ************ AdvanceOneStepOfParameters ****************************
+ */
+
+void
+GradientDescentOptimizer2 ::AdvanceOneStepOfParameters(const unsigned int begin, const unsigned int end)
+{
+  /** Get a reference to the previously allocated newPosition. */
+  ParametersType & newPosition = this->m_ScaledCurrentPosition;
+
+  /** Get a reference to the current position. */
+  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
+
+  /** Update the new position. */
+  for (unsigned int j = begin; j < end; ++j)
+  {
+    newPosition[j] = currentPosition[j] - this->m_LearningRate * this->m_Gradient[j];
+  }
+
+} // end AdvanceOneStepOfParameters()
+
+
 } // end namespace itk
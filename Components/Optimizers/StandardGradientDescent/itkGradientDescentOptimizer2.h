@@ -139,17 +139,42 @@ public:
   /** Set use OpenMP or not. */
   itkSetMacro(UseOpenMP, bool);
 
+  /** Set/Get whether the step is fused with the accumulation of the derivative. When the cost function
+   * supports it, the step for each block of parameters is then taken right after the threads of the
+   * metric have accumulated the derivative of that block, instead of in separate sweeps over all
+   * parameters afterwards. Subclasses that enable it must set their learning rate in UpdateLearningRate,
+   * and take their step in AdvanceOneStepOfParameters.
+   */
+  itkSetMacro(UseFusedStep, bool);
+  itkGetConstMacro(UseFusedStep, bool);
+
 protected:
   GradientDescentOptimizer2();
   ~GradientDescentOptimizer2() override = default;
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** Sets the learning rate of the coming step. With a fused step, it is called before the cost function is
+   * evaluated. By default, it does nothing: the learning rate is fixed.
+   */
+  virtual void
+  UpdateLearningRate()
+  {}
+
+  /** Updates the parameters [begin, end) of the current position, from the gradient of these parameters.
+   * With a fused step, it may be called concurrently, for disjoint ranges.
+   */
+  virtual void
+  AdvanceOneStepOfParameters(const unsigned int begin, const unsigned int end);
+
   // made protected so subclass can access
   DerivativeType    m_Gradient{};
   DerivativeType    m_SearchDirection{};
   StopConditionType m_StopCondition{ MaximumNumberOfIterations };
 
+  /** Whether the step of the current iteration was already taken while the derivative was computed. */
+  bool m_StepIsTakenWithDerivative{ false };
+
 private:
   double        m_Value{ 0.0 };
   double        m_LearningRate{ 1.0 };
@@ -158,6 +183,7 @@ private:
   unsigned long m_CurrentIteration{ 0 };
 
   bool m_UseOpenMP{};
+  bool m_UseFusedStep{ false };
 };
 
 } // end namespace itk
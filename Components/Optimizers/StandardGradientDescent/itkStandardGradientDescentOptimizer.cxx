@@ -47,6 +47,22 @@ StandardGradientDescentOptimizer::StartOptimization()
 
 void
 StandardGradientDescentOptimizer::AdvanceOneStep()
+{
+  this->UpdateLearningRate();
+
+  this->Superclass::AdvanceOneStep();
+
+  this->UpdateCurrentTime();
+
+} // end AdvanceOneStep()
+
+
+/**
+ * ******************** UpdateLearningRate **************************
+ */
+
+void
+StandardGradientDescentOptimizer::UpdateLearningRate()
 {
   /** Decide which type of step size is chosen. */
   if (this->m_UseConstantStep)
@@ -58,11 +74,7 @@ StandardGradientDescentOptimizer::AdvanceOneStep()
     this->SetLearningRate(this->Compute_a(this->m_CurrentTime));
   }
 
-  this->Superclass::AdvanceOneStep();
-
-  this->UpdateCurrentTime();
-
-} // end AdvanceOneStep()
+} // end UpdateLearningRate()
 
 
 /**
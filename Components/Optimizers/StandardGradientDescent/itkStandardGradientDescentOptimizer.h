@@ -141,6 +141,10 @@ protected:
   virtual double
   Compute_a(double k) const;
 
+  /** Sets the learning rate to a(k), with k the current time, or to a(0) for a constant step. */
+  void
+  UpdateLearningRate() override;
+
   /** Function to update the current time
    * This function just increments the CurrentTime by 1.
    * Inheriting functions may implement something smarter,
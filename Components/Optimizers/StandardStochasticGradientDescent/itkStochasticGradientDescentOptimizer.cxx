@@ -17,6 +17,7 @@
  *=========================================================================*/
 
 #include "itkStochasticGradientDescentOptimizer.h"
+#include "elxWorkStealingThreadPool.h"
 #include "itkCommand.h"
 #include "itkEventObject.h"
 #include "itkMacro.h"
@@ -287,11 +288,9 @@ StochasticGradientDescentOptimizer::AdvanceOneStep()
     temp.t_NewPosition = &newPosition;
     temp.t_Optimizer = this;
 
-    /** Call multi-threaded AdvanceOneStep(). */
-    auto local_threader = ThreaderType::New();
-    local_threader->SetNumberOfWorkUnits(this->m_Threader->GetNumberOfWorkUnits());
-    local_threader->SetSingleMethod(AdvanceOneStepThreaderCallback, &temp);
-    local_threader->SingleMethodExecute();
+    /** Call multi-threaded AdvanceOneStep(), on the persistent thread pool. */
+    elastix::WorkStealingThreadPool::GetInstance().SingleMethodExecute(
+      this->m_Threader->GetNumberOfWorkUnits(), AdvanceOneStepThreaderCallback, &temp);
   }
 
   this->InvokeEvent(IterationEvent());
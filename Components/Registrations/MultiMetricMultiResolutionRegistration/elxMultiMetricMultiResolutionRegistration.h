@@ -87,6 +87,15 @@ namespace elastix
  *    example: <tt>(Metric0Use "false" "true")</tt> \n
  *    example: <tt>(Metric1Use "true" "false")</tt> \n
  *    The default is "true".
+ * \parameter EvaluateMetricsConcurrently: Whether the metrics that are multi-threaded
+ *    image metrics are evaluated concurrently, instead of one after another, in each resolution. \n
+ *    example: <tt>(EvaluateMetricsConcurrently "true")</tt> \n
+ *    The default is "false".
+ * \parameter ShareMappedPointsBetweenMetrics: Whether image metrics that have equivalent
+ *    samples (for example because they share an image sampler, or use the same full or grid
+ *    sampler settings) transform these samples only once per iteration, in each resolution. \n
+ *    example: <tt>(ShareMappedPointsBetweenMetrics "true")</tt> \n
+ *    The default is "false".
  *
  * \ingroup Registrations
  */
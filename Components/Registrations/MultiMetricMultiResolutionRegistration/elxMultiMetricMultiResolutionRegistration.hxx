@@ -236,6 +236,17 @@ MultiMetricMultiResolutionRegistration<TElastix>::BeforeEachResolution()
     this->GetCombinationMetric()->SetUseMetric(use, metricnr);
   }
 
+  /** Set whether the metrics are evaluated concurrently. */
+  bool evaluateMetricsConcurrently = false;
+  this->GetConfiguration()->ReadParameter(
+    evaluateMetricsConcurrently, "EvaluateMetricsConcurrently", "", level, 0, false);
+  this->GetCombinationMetric()->SetEvaluateMetricsConcurrently(evaluateMetricsConcurrently);
+
+  /** Set whether metrics with equivalent samples share their mapped points. */
+  bool shareMappedPoints = false;
+  this->GetConfiguration()->ReadParameter(shareMappedPoints, "ShareMappedPointsBetweenMetrics", "", level, 0, false);
+  this->GetCombinationMetric()->SetShareMappedPoints(shareMappedPoints);
+
   /** Check if the exact metric value, computed on all pixels, should be shown.
    * If at least one of the metrics has it enabled, show also the weighted sum of all
    * exact metric values. */
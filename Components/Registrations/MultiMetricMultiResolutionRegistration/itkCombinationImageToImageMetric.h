@@ -21,6 +21,9 @@
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkSingleValuedPointSetToPointSetMetric.h"
 
+#include <exception> // For exception_ptr.
+#include <vector>
+
 namespace itk
 {
 
@@ -154,6 +157,10 @@ public:
   using typename Superclass::ThreaderType;
   using typename Superclass::ThreadInfoType;
 
+  /** Typedefs for the samples. */
+  using ImageSampleContainerType = typename Superclass::ImageSampleContainerType;
+  using MappedPointsType = std::vector<OutputPointType>;
+
   /**
    * Get and set the metrics and their weights.
    **/
@@ -196,6 +203,20 @@ public:
   itkSetMacro(UseRelativeWeights, bool);
   itkGetConstMacro(UseRelativeWeights, bool);
 
+  /** Set and Get whether the sub metrics that are multi-threaded image metrics are evaluated concurrently, in
+   * GetValueAndDerivative, instead of one after another. The other sub metrics are still evaluated one after
+   * another, before the concurrent ones, as they may modify the shared transform. Default: false.
+   */
+  itkSetMacro(EvaluateMetricsConcurrently, bool);
+  itkGetConstMacro(EvaluateMetricsConcurrently, bool);
+
+  /** Set and Get whether image sub metrics that have the same transform and equivalent samples share their mapped
+   * points, in GetValueAndDerivative. The mapped points are then computed only once for such a group of sub metrics,
+   * instead of once per sub metric. Default: false.
+   */
+  itkSetMacro(ShareMappedPoints, bool);
+  itkGetConstMacro(ShareMappedPoints, bool);
+
   /** Select which metrics are used.
    * This is useful in case you want to compute a certain measure, but not
    * actually use it during the registration.
@@ -451,7 +472,55 @@ protected:
   FixedImageRegionType m_NullFixedImageRegion{};
   DerivativeType       m_NullDerivative{};
 
+  /** Variables for the concurrent evaluation of the sub metrics, and the sharing of mapped points. */
+  bool                                  m_EvaluateMetricsConcurrently{ false };
+  bool                                  m_ShareMappedPoints{ false };
+  mutable std::vector<MappedPointsType> m_SharedMappedPoints{};
+
 private:
+  /** The image sub metric, its transform and its samples, by which the sub metrics are grouped for sharing their
+   * mapped points. The samples are only compared point by point when their container or its MTime has changed. */
+  struct SharedMappedPointsKeyType
+  {
+    const ImageMetricType *          metric{ nullptr };
+    const TransformType *            transform{ nullptr };
+    const ImageSampleContainerType * samples{ nullptr };
+    ModifiedTimeType                 samplesMTime{ 0 };
+
+    bool
+    operator==(const SharedMappedPointsKeyType & other) const
+    {
+      return (metric == other.metric) && (transform == other.transform) && (samples == other.samples) &&
+             (samplesMTime == other.samplesMTime);
+    }
+  };
+
+  /** The keys of the sub metrics (one per sub metric) for which m_SharedMappedPointsGroups is computed, and the
+   * groups of image sub metrics that share their mapped points. */
+  mutable std::vector<SharedMappedPointsKeyType>      m_SharedMappedPointsKeys{};
+  mutable std::vector<std::vector<ImageMetricType *>> m_SharedMappedPointsGroups{};
+
+  /** Computes the mapped points once for each group of image sub metrics that have the same transform and equivalent
+   * samples, and lets the sub metrics of such a group share them. */
+  void
+  UpdateSharedMappedPoints() const;
+
+  /** Stops sharing mapped points with the sub metrics. */
+  void
+  ResetSharedMappedPoints() const;
+
+  /** Computes the value and derivative of the sub metric at the specified index, and its computation time. */
+  void
+  ComputeMetricValueAndDerivative(const ParametersType & parameters, const unsigned int metricIndex) const;
+
+  /** Computes the mapped points of the samples of the specified work unit, for the sharing of mapped points. */
+  static void
+  ComputeSharedMappedPoints(const TransformType &            transform,
+                            const ImageSampleContainerType & sampleContainer,
+                            const unsigned int               workUnit,
+                            const unsigned int               numberOfWorkUnits,
+                            MappedPointsType &               mappedPoints);
+
   /** Initialize some multi-threading related parameters.
    * Overrides function in AdvancedImageToImageMetric, because
    * here we use other parameters.
@@ -21,6 +21,9 @@
 #include "itkCombinationImageToImageMetric.h"
 #include "itkTimeProbe.h"
 #include "itkMath.h"
+#include "elxWorkStealingThreadPool.h"
+
+#include <algorithm> // For equal, min and remove_if.
 
 /** Macros to reduce some copy-paste work.
  * These macros provide the implementation of
@@ -780,9 +783,6 @@ CombinationImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
                                                                                 MeasureType &          value,
                                                                                 DerivativeType &       derivative) const
 {
-  /** Declare timer. */
-  itk::TimeProbe timer;
-
   /** This function must be called before the multi-threaded code.
    * It calls all the non thread-safe stuff.
    */
@@ -807,19 +807,80 @@ CombinationImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
   /** Initialize some threading related parameters. */
   this->InitializeThreadingParameters();
 
+  /** Let the sub metrics with equivalent samples share their mapped points. */
+  if (m_ShareMappedPoints)
+  {
+    this->UpdateSharedMappedPoints();
+  }
+
   /** Compute all metric values and derivatives. */
-  for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+  try
   {
-    /** Compute ... */
-    timer.Reset();
-    timer.Start();
-    this->m_Metrics[i]->GetValueAndDerivative(parameters, this->m_MetricValues[i], this->m_MetricDerivatives[i]);
-    timer.Stop();
+    if (m_EvaluateMetricsConcurrently)
+    {
+      /** Only multi-threaded image metrics are evaluated concurrently. The other ones may set the transform
+       * parameters during their evaluation, so they are evaluated first, one after another. */
+      std::vector<unsigned int> concurrentMetricIndices;
 
-    /** Store computation time. */
-    this->m_MetricComputationTime[i] = timer.GetMean() * 1000.0;
+      for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+      {
+        const auto * const imageMetric = dynamic_cast<const ImageMetricType *>(this->GetMetric(i));
+
+        if ((imageMetric != nullptr) && imageMetric->GetUseMultiThread())
+        {
+          concurrentMetricIndices.push_back(i);
+        }
+        else
+        {
+          this->ComputeMetricValueAndDerivative(parameters, i);
+        }
+      }
+
+      const auto numberOfConcurrentMetrics = static_cast<unsigned int>(concurrentMetricIndices.size());
+      if (numberOfConcurrentMetrics > 0)
+      {
+        /** Each sub metric is a work unit of the thread pool. The sub metrics may run their own fork-join phases
+         * within their work unit. An exception is stored per sub metric, so that the exception of the first failing
+         * sub metric is passed to a higher level, regardless of the scheduling. */
+        std::vector<std::exception_ptr> exceptions(numberOfConcurrentMetrics);
+
+        elastix::WorkStealingThreadPool::GetInstance().ForkJoin(
+          numberOfConcurrentMetrics, [this, &parameters, &concurrentMetricIndices, &exceptions](unsigned int workUnit) {
+            try
+            {
+              this->ComputeMetricValueAndDerivative(parameters, concurrentMetricIndices[workUnit]);
+            }
+            catch (...)
+            {
+              exceptions[workUnit] = std::current_exception();
+            }
+          });
+
+        for (const auto & exception : exceptions)
+        {
+          if (exception)
+          {
+            std::rethrow_exception(exception);
+          }
+        }
+      }
+    }
+    else
+    {
+      for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+      {
+        this->ComputeMetricValueAndDerivative(parameters, i);
+      }
+    }
+  }
+  catch (...)
+  {
+    this->ResetSharedMappedPoints();
+    throw;
   }
 
+  this->ResetSharedMappedPoints();
+
   /** Compute the derivative magnitude. */
   for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
   {
@@ -861,6 +922,194 @@ CombinationImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
 } // end GetValueAndDerivative()
 
 
+/**
+ * ***************** ComputeMetricValueAndDerivative *****************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage, TMovingImage>::ComputeMetricValueAndDerivative(
+  const ParametersType & parameters,
+  const unsigned int     metricIndex) const
+{
+  /** Compute ... */
+  itk::TimeProbe timer;
+  timer.Start();
+  this->m_Metrics[metricIndex]->GetValueAndDerivative(
+    parameters, this->m_MetricValues[metricIndex], this->m_MetricDerivatives[metricIndex]);
+  timer.Stop();
+
+  /** Store computation time. */
+  this->m_MetricComputationTime[metricIndex] = timer.GetMean() * 1000.0;
+
+} // end ComputeMetricValueAndDerivative()
+
+
+/**
+ * ***************** UpdateSharedMappedPoints *****************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage, TMovingImage>::UpdateSharedMappedPoints() const
+{
+  /** Determine the key of each sub metric. Sub metrics that do not sample the fixed image are left out. */
+  std::vector<SharedMappedPointsKeyType> keys(this->m_NumberOfMetrics);
+
+  for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+  {
+    const auto * const imageMetric = dynamic_cast<const ImageMetricType *>(this->GetMetric(i));
+
+    if ((imageMetric != nullptr) && imageMetric->GetUseImageSampler() && (imageMetric->GetImageSampler() != nullptr) &&
+        (imageMetric->GetTransform() != nullptr))
+    {
+      const ImageSampleContainerType * const samples = imageMetric->GetImageSampler()->GetOutput();
+      keys[i] = { imageMetric, imageMetric->GetTransform(), samples, samples->GetMTime() };
+    }
+  }
+
+  /** Only regroup the sub metrics when their keys have changed since the last grouping. Typically, that is only the
+   * case when a sampler has drawn new samples, so that comparing all the samples is avoided in most iterations. */
+  if (keys != m_SharedMappedPointsKeys)
+  {
+    /** Two sample containers are equivalent when they have the very same fixed image points. */
+    const auto haveEquivalentSamples = [](const ImageSampleContainerType & samples1,
+                                          const ImageSampleContainerType & samples2) {
+      return (&samples1 == &samples2) ||
+             std::equal(samples1.cbegin(),
+                        samples1.cend(),
+                        samples2.cbegin(),
+                        samples2.cend(),
+                        [](const auto & sample1, const auto & sample2) {
+                          return sample1.m_ImageCoordinates == sample2.m_ImageCoordinates;
+                        });
+    };
+
+    /** Group the image sub metrics by transform and equivalent samples. */
+    std::vector<std::vector<ImageMetricType *>> groups;
+    std::vector<unsigned int>                   firstMetricIndices;
+
+    for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+    {
+      if (keys[i].samples == nullptr)
+      {
+        continue;
+      }
+
+      auto * const imageMetric = dynamic_cast<ImageMetricType *>(this->GetMetric(i));
+
+      bool isAddedToGroup = false;
+      for (std::size_t g = 0; g < groups.size(); ++g)
+      {
+        const SharedMappedPointsKeyType & firstKey = keys[firstMetricIndices[g]];
+
+        if ((firstKey.transform == keys[i].transform) && haveEquivalentSamples(*(firstKey.samples), *(keys[i].samples)))
+        {
+          groups[g].push_back(imageMetric);
+          isAddedToGroup = true;
+          break;
+        }
+      }
+
+      if (!isAddedToGroup)
+      {
+        groups.push_back({ imageMetric });
+        firstMetricIndices.push_back(i);
+      }
+    }
+
+    /** Only groups of at least two sub metrics benefit from sharing. */
+    groups.erase(std::remove_if(groups.begin(),
+                                groups.end(),
+                                [](const std::vector<ImageMetricType *> & group) { return group.size() < 2; }),
+                 groups.end());
+
+    m_SharedMappedPointsGroups = std::move(groups);
+    m_SharedMappedPointsKeys = std::move(keys);
+  }
+
+  const auto & groups = m_SharedMappedPointsGroups;
+
+  /** Resize before taking the addresses of the elements, as the sub metrics keep pointers to them. */
+  m_SharedMappedPoints.resize(groups.size());
+
+  const unsigned int numberOfWorkUnits = this->GetNumberOfWorkUnits();
+  auto &             threadPool = elastix::WorkStealingThreadPool::GetInstance();
+
+  for (std::size_t g = 0; g < groups.size(); ++g)
+  {
+    const ImageMetricType &          firstMetric = *(groups[g].front());
+    const TransformType &            transform = *(firstMetric.GetTransform());
+    const ImageSampleContainerType & sampleContainer = *(firstMetric.GetImageSampler()->GetOutput());
+    MappedPointsType &               mappedPoints = m_SharedMappedPoints[g];
+    mappedPoints.resize(sampleContainer.size());
+
+    /** Compute the mapped points of this group, multi-threaded. */
+    threadPool.ForkJoin(numberOfWorkUnits, [numberOfWorkUnits, &transform, &sampleContainer, &mappedPoints](
+                                             unsigned int workUnit) {
+      ComputeSharedMappedPoints(transform, sampleContainer, workUnit, numberOfWorkUnits, mappedPoints);
+    });
+
+    for (ImageMetricType * const imageMetric : groups[g])
+    {
+      imageMetric->SetSharedMappedPoints(&mappedPoints);
+    }
+  }
+
+} // end UpdateSharedMappedPoints()
+
+
+/**
+ * ***************** ComputeSharedMappedPoints *****************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage, TMovingImage>::ComputeSharedMappedPoints(
+  const TransformType &            transform,
+  const ImageSampleContainerType & sampleContainer,
+  const unsigned int               workUnit,
+  const unsigned int               numberOfWorkUnits,
+  MappedPointsType &               mappedPoints)
+{
+  /** Get the range of samples of this work unit. */
+  const std::size_t sampleContainerSize = sampleContainer.size();
+  const std::size_t numberOfSamplesPerWorkUnit = (sampleContainerSize + numberOfWorkUnits - 1) / numberOfWorkUnits;
+  const std::size_t pos_begin = std::min<std::size_t>(numberOfSamplesPerWorkUnit * workUnit, sampleContainerSize);
+  const std::size_t pos_end = std::min<std::size_t>(pos_begin + numberOfSamplesPerWorkUnit, sampleContainerSize);
+
+  /** Gather the fixed image points, and transform them by a single call to the transform. */
+  std::vector<InputPointType> fixedPoints(pos_end - pos_begin);
+  const auto                  beginOfSamples = sampleContainer.cbegin() + pos_begin;
+  for (std::size_t i = 0; i < fixedPoints.size(); ++i)
+  {
+    fixedPoints[i] = beginOfSamples[i].m_ImageCoordinates;
+  }
+
+  transform.TransformPoints(fixedPoints.data(), mappedPoints.data() + pos_begin, fixedPoints.size());
+
+} // end ComputeSharedMappedPoints()
+
+
+/**
+ * ***************** ResetSharedMappedPoints *****************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage, TMovingImage>::ResetSharedMappedPoints() const
+{
+  for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+  {
+    if (auto * const imageMetric = dynamic_cast<ImageMetricType *>(this->GetMetric(i)))
+    {
+      imageMetric->SetSharedMappedPoints(nullptr);
+    }
+  }
+
+} // end ResetSharedMappedPoints()
+
+
 /**
  * ********************* GetMTime ****************************
  */
@@ -19,7 +19,7 @@
 #define elxBSplineResampleInterpolator_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
 
 namespace elastix
 {
@@ -52,9 +52,9 @@ namespace elastix
 
 template <class TElastix>
 class ITK_TEMPLATE_EXPORT BSplineResampleInterpolator
-  : public itk::BSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
-                                                typename ResampleInterpolatorBase<TElastix>::CoordRepType,
-                                                double>
+  : public itk::CachedBSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
+                                                      typename ResampleInterpolatorBase<TElastix>::CoordRepType,
+                                                      double>
   , // CoefficientType
     public ResampleInterpolatorBase<TElastix>
 {
@@ -63,9 +63,10 @@ public:
 
   /** Standard ITK-stuff. */
   using Self = BSplineResampleInterpolator;
-  using Superclass1 = itk::BSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
-                                                           typename ResampleInterpolatorBase<TElastix>::CoordRepType,
-                                                           double>;
+  using Superclass1 =
+    itk::CachedBSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
+                                               typename ResampleInterpolatorBase<TElastix>::CoordRepType,
+                                               double>;
   using Superclass2 = ResampleInterpolatorBase<TElastix>;
   using Pointer = itk::SmartPointer<Self>;
   using ConstPointer = itk::SmartPointer<const Self>;
@@ -117,8 +118,9 @@ public:
   ReadFromFile() override;
 
 protected:
-  /** The constructor. */
-  BSplineResampleInterpolator() = default;
+  /** The constructor. The coefficients are shared with the other resample interpolators that are set to the same
+   * image, with the same spline order, via the process-wide B-spline coefficient cache. */
+  BSplineResampleInterpolator() { this->SetUseCoefficientCache(true); }
   /** The destructor. */
   ~BSplineResampleInterpolator() override = default;
 
@@ -19,7 +19,7 @@
 #define elxBSplineResampleInterpolatorFloat_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
 
 namespace elastix
 {
@@ -52,9 +52,9 @@ namespace elastix
 
 template <class TElastix>
 class ITK_TEMPLATE_EXPORT BSplineResampleInterpolatorFloat
-  : public itk::BSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
-                                                typename ResampleInterpolatorBase<TElastix>::CoordRepType,
-                                                float>
+  : public itk::CachedBSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
+                                                      typename ResampleInterpolatorBase<TElastix>::CoordRepType,
+                                                      float>
   , // CoefficientType
     public ResampleInterpolatorBase<TElastix>
 {
@@ -63,9 +63,10 @@ public:
 
   /** Standard ITK-stuff. */
   using Self = BSplineResampleInterpolatorFloat;
-  using Superclass1 = itk::BSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
-                                                           typename ResampleInterpolatorBase<TElastix>::CoordRepType,
-                                                           float>;
+  using Superclass1 =
+    itk::CachedBSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
+                                               typename ResampleInterpolatorBase<TElastix>::CoordRepType,
+                                               float>;
   using Superclass2 = ResampleInterpolatorBase<TElastix>;
   using Pointer = itk::SmartPointer<Self>;
   using ConstPointer = itk::SmartPointer<const Self>;
@@ -115,8 +116,9 @@ public:
   ReadFromFile() override;
 
 protected:
-  /** The constructor. */
-  BSplineResampleInterpolatorFloat() = default;
+  /** The constructor. The coefficients are shared with the other resample interpolators that are set to the same
+   * image, with the same spline order, via the process-wide B-spline coefficient cache. */
+  BSplineResampleInterpolatorFloat() { this->SetUseCoefficientCache(true); }
   /** The destructor. */
   ~BSplineResampleInterpolatorFloat() override = default;
 
@@ -116,8 +116,9 @@ public:
   ReadFromFile() override;
 
 protected:
-  /** The constructor. */
-  ReducedDimensionBSplineResampleInterpolator() = default;
+  /** The constructor. The coefficients are shared with the other resample interpolators that are set to the same
+   * image, with the same spline order, via the process-wide B-spline coefficient cache. */
+  ReducedDimensionBSplineResampleInterpolator() { this->SetUseCoefficientCache(true); }
   /** The destructor. */
   ~ReducedDimensionBSplineResampleInterpolator() override = default;
 
@@ -31,6 +31,12 @@ namespace elastix
  * \class RayCastResampleInterpolator
  * \brief An interpolator based on ...
  *
+ * The parameters used in this class are:
+ * \parameter EarlyExitOnThreshold: Skip the parts of the rays outside of the bounding box of the voxels above
+ *    the threshold. Does not change the result. \n
+ *    example: <tt>(EarlyExitOnThreshold "true")</tt> \n
+ *    The default is "false".
+ *
  * \ingroup Interpolators
  */
 
@@ -85,6 +85,10 @@ RayCastResampleInterpolator<TElastix>::InitializeRayCastInterpolator()
   this->GetConfiguration()->ReadParameter(threshold, "Threshold", 0);
   this->SetThreshold(threshold);
 
+  bool earlyExitOnThreshold = false;
+  this->GetConfiguration()->ReadParameter(earlyExitOnThreshold, "EarlyExitOnThreshold", 0);
+  this->SetEarlyExitOnThreshold(earlyExitOnThreshold);
+
 } // end InitializeRayCastInterpolator()
 
 
@@ -154,7 +158,8 @@ RayCastResampleInterpolator<TElastix>::CreateDerivedTransformParameterMap() cons
 {
   return { { "FocalPoint", Conversion::ToVectorOfStrings(this->GetFocalPoint()) },
            { "PreParameters", Conversion::ToVectorOfStrings(this->m_PreTransform->GetParameters()) },
-           { "Threshold", { Conversion::ToString(this->GetThreshold()) } } };
+           { "Threshold", { Conversion::ToString(this->GetThreshold()) } },
+           { "EarlyExitOnThreshold", { Conversion::ToString(this->GetEarlyExitOnThreshold()) } } };
 
 } // end CreateDerivedTransformParameterMap()
 
@@ -111,6 +111,14 @@ public:
   OutputPointType
   TransformPoint(const InputPointType & inputPoint) const override;
 
+  /** Method to transform a range of points. Calls TransformPoint for each point, so that
+   * the deformation field is not bypassed by the Superclass implementation.
+   */
+  void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  SizeValueType          numberOfPoints) const override;
+
 protected:
   /** The constructor. */
   DeformationFieldRegulizer();
@@ -112,6 +112,24 @@ DeformationFieldRegulizer<TAnyITKTransform>::TransformPoint(const InputPointType
 } // end TransformPoint()
 
 
+/**
+ * *********************** TransformPoints ***********************
+ */
+
+template <class TAnyITKTransform>
+void
+DeformationFieldRegulizer<TAnyITKTransform>::TransformPoints(const InputPointType * inputPoints,
+                                                             OutputPointType *      outputPoints,
+                                                             SizeValueType          numberOfPoints) const
+{
+  for (SizeValueType i = 0; i < numberOfPoints; ++i)
+  {
+    outputPoints[i] = this->TransformPoint(inputPoints[i]);
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ******** UpdateIntermediaryDeformationFieldTransform *********
  */
@@ -25,6 +25,9 @@
 #include "itkObject.h"
 #include "itkMultiResolutionPyramidImageFilter.h"
 
+#include <functional>
+#include <string>
+
 namespace elastix
 {
 
@@ -124,6 +127,14 @@ protected:
   /** The destructor. */
   ~FixedImagePyramidBase() override = default;
 
+  /** Generates the pyramid images by the specified function, or, when another registration has generated them
+   * already, grafts them from the fixed image preprocessing cache. Meant to be called by the GenerateData()
+   * override of the pyramid. The result name distinguishes the different results of the pyramid, if any.
+   */
+  void
+  GenerateDataUsingFixedImagePreprocessingCache(const std::string &           resultName,
+                                                const std::function<void()> & generateData);
+
 private:
   elxDeclarePureVirtualGetSelfMacro(ITKBaseType);
 };
@@ -21,6 +21,7 @@
 #include "elxFixedImagePyramidBase.h"
 #include "elxDeref.h"
 #include "itkImageFileCastWriter.h"
+#include <itkVectorContainer.h>
 
 namespace elastix
 {
@@ -194,6 +195,59 @@ FixedImagePyramidBase<TElastix>::WritePyramidImage(const std::string & filename,
 } // end WritePyramidImage()
 
 
+/**
+ * ******************* GenerateDataUsingFixedImagePreprocessingCache *******************
+ */
+
+template <class TElastix>
+void
+FixedImagePyramidBase<TElastix>::GenerateDataUsingFixedImagePreprocessingCache(
+  const std::string &           resultName,
+  const std::function<void()> & generateData)
+{
+  FixedImagePreprocessingCache * const cache = this->GetFixedImagePreprocessingCache();
+
+  if (cache == nullptr)
+  {
+    generateData();
+    return;
+  }
+
+  using OutputImageContainerType = itk::VectorContainer<unsigned int, typename OutputImageType::ConstPointer>;
+
+  ITKBaseType &      pyramid = *(this->GetAsITKBaseType());
+  const unsigned int numberOfLevels = pyramid.GetNumberOfLevels();
+  bool               isGeneratedHere = false;
+
+  const auto outputImages = cache->GetOrCreate<OutputImageContainerType>(
+    this->GetFixedImagePreprocessingCacheKey(resultName), [&pyramid, &generateData, numberOfLevels, &isGeneratedHere] {
+      generateData();
+      isGeneratedHere = true;
+
+      /** Store images that share the buffers of the outputs, rather than the outputs themselves, as this pyramid
+       * may still release or regenerate its outputs.
+       */
+      const auto imageContainer = OutputImageContainerType::New();
+      for (unsigned int level = 0; level < numberOfLevels; ++level)
+      {
+        const auto image = OutputImageType::New();
+        image->Graft(pyramid.GetOutput(level));
+        imageContainer->push_back(image);
+      }
+      return imageContainer;
+    });
+
+  if (!isGeneratedHere)
+  {
+    for (unsigned int level = 0; level < numberOfLevels; ++level)
+    {
+      pyramid.GetOutput(level)->Graft(outputImages->ElementAt(level));
+    }
+  }
+
+} // end GenerateDataUsingFixedImagePreprocessingCache()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxFixedImagePyramidBase_hxx
@@ -66,6 +66,12 @@ ImageSamplerBase<TElastix>::BeforeEachResolutionBase()
                                      << "but the selected ImageSampler is not suited for that.");
     }
   }
+
+  /** Share the samples of this resolution with other registrations, if any. Only deterministic samplers use it. */
+  this->GetAsITKBaseType()->SetFixedImagePreprocessingCache(
+    this->GetFixedImagePreprocessingCache(),
+    this->GetFixedImagePreprocessingCacheKey("Resolution" + std::to_string(level) + '/'));
+
 } // end BeforeEachResolutionBase()
 
 
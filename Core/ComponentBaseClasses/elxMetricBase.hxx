@@ -149,6 +149,11 @@ MetricBase<TElastix>::BeforeEachResolutionBase()
       }
     }
 
+    /** Share the fixed image preprocessing results of this resolution with other registrations, if any. */
+    thisAsAdvanced->SetFixedImagePreprocessingCache(
+      this->GetFixedImagePreprocessingCache(),
+      this->GetFixedImagePreprocessingCacheKey("Resolution" + std::to_string(level) + '/'));
+
   } // end advanced metric
 
 } // end BeforeEachResolutionBase()
@@ -24,6 +24,8 @@
 #include "elxBaseComponentSE.h"
 #include "itkResampleImageFilter.h"
 #include "itkCastImageFilter.h"
+#include "itkImageAlgorithm.h"
+#include "itkImageRegionSplitterSlowDimension.h"
 #include "elxProgressCommand.h"
 
 namespace elastix
@@ -68,6 +70,17 @@ namespace elastix
  *    of the written image is desired.\n
  *    example: <tt>(CompressResultImage "true")</tt> \n
  *    The default is "false".
+ * \parameter NumberOfStreamDivisions: the number of slabs in which the
+ *    result image is resampled. Each slab is resampled, cast to the ResultImagePixelType
+ *    and passed on to the writer (or to the result image of the library interface) before
+ *    the next one, so that the peak memory usage is bounded by the slab size instead of
+ *    the size of the whole image. Only image formats that support streamed writing (like
+ *    uncompressed mhd and nrrd) are written slab by slab; other formats are still written
+ *    at once. The B-spline coefficients of the interpolator are computed only once, before
+ *    the first slab. The same parameter specifies the number of pieces of the spatial
+ *    Jacobian images of transformix (see TransformBase).\n
+ *    example: <tt>(NumberOfStreamDivisions 16)</tt> \n
+ *    The default is 1, which resamples the whole image at once.
  *
  * \ingroup Resamplers
  * \ingroup ComponentBaseClasses
@@ -215,16 +228,68 @@ private:
   void
   ReleaseMemory();
 
-  /** Casts the specified input image to the image type with the specified pixel type. */
+  /** Reads the number of stream divisions for the result image from the configuration. */
+  unsigned int
+  GetNumberOfStreamDivisions() const;
+
+  /** Sets the input image of the resampler as input image of its interpolator, before the result image is streamed.
+   * The resampler sets it again for each slab, but then the interpolator reuses the coefficients that it computed
+   * here, as the image is not modified in between. */
+  void
+  SetInputImageOfInterpolator();
+
+  /** Casts the specified input image to the image type with the specified pixel type. When the number of stream
+   * divisions is larger than one, the input image must be the output of a pipeline, which is then updated slab by
+   * slab, each slab being cast directly into the result image. */
   template <typename TResultPixel>
   itk::SmartPointer<itk::ImageBase<ImageDimension>>
-  CastImage(const InputImageType * const inputImage) const
+  CastImage(InputImageType * const inputImage, const unsigned int numberOfStreamDivisions) const
   {
-    const auto castFilter =
-      itk::CastImageFilter<InputImageType, itk::Image<TResultPixel, InputImageType::ImageDimension>>::New();
-    castFilter->SetInput(inputImage);
-    castFilter->Update();
-    return castFilter->GetOutput();
+    using ResultImageType = itk::Image<TResultPixel, InputImageType::ImageDimension>;
+
+    if (numberOfStreamDivisions <= 1)
+    {
+      const auto castFilter = itk::CastImageFilter<InputImageType, ResultImageType>::New();
+      castFilter->SetInput(inputImage);
+      castFilter->Update();
+      return castFilter->GetOutput();
+    }
+
+    inputImage->UpdateOutputInformation();
+    const auto largestRegion = inputImage->GetLargestPossibleRegion();
+
+    const auto resultImage = ResultImageType::New();
+    resultImage->CopyInformation(inputImage);
+    resultImage->SetRegions(largestRegion);
+    resultImage->Allocate();
+
+    const auto         splitter = itk::ImageRegionSplitterSlowDimension::New();
+    const unsigned int numberOfPieces = splitter->GetNumberOfSplits(largestRegion, numberOfStreamDivisions);
+
+    for (unsigned int piece = 0; piece < numberOfPieces; ++piece)
+    {
+      auto streamRegion = largestRegion;
+      splitter->GetSplit(piece, numberOfPieces, streamRegion);
+
+      inputImage->SetRequestedRegion(streamRegion);
+      try
+      {
+        inputImage->Update();
+      }
+      catch (itk::ExceptionObject & excp)
+      {
+        /** Add information to the exception. */
+        excp.SetLocation("ResamplerBase - CreateItkResultImage()");
+        std::string err_str = excp.GetDescription();
+        err_str += "\nError occurred while resampling the image.\n";
+        excp.SetDescription(err_str);
+
+        /** Pass the exception to an higher level. */
+        throw;
+      }
+      itk::ImageAlgorithm::Copy(inputImage, resultImage.GetPointer(), streamRegion, streamRegion);
+    }
+    return resultImage;
   }
 };
 
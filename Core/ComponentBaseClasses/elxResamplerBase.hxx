@@ -21,12 +21,14 @@
 #include "elxResamplerBase.h"
 #include "elxConversion.h"
 #include "elxDeref.h"
+#include "elxProfiler.h"
 
 #include "itkImageFileCastWriter.h"
 #include "itkChangeInformationImageFilter.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
 #include "itkTimeProbe.h"
 
+#include <algorithm> // For max.
 #include <cassert>
 
 namespace elastix
@@ -313,10 +315,21 @@ ResamplerBase<TElastix>::ResampleAndWriteResultImage(const std::string & filenam
   const auto progressObserver =
     (showProgress && showProgressPercentage) ? ProgressCommand::CreateAndConnect(resampleImageFilter) : nullptr;
 
-  /** Do the resampling. */
+  /** Do the resampling. When the result image is streamed, the writer updates the resampler slab by slab, so then
+   * the resampling is done while writing. */
+  const bool isStreamed = this->GetNumberOfStreamDivisions() > 1;
   try
   {
-    resampleImageFilter.Update();
+    if (isStreamed)
+    {
+      this->SetInputImageOfInterpolator();
+      this->WriteResultImage(resampleImageFilter.GetOutput(), filename, showProgress);
+    }
+    else
+    {
+      const Profiler::ScopedTimer profilerTimer("Resampler::Update");
+      resampleImageFilter.Update();
+    }
   }
   catch (itk::ExceptionObject & excp)
   {
@@ -331,7 +344,13 @@ ResamplerBase<TElastix>::ResampleAndWriteResultImage(const std::string & filenam
   }
 
   /** Perform the writing. */
-  this->WriteResultImage(resampleImageFilter.GetOutput(), filename, showProgress);
+  if (!isStreamed)
+  {
+    this->WriteResultImage(resampleImageFilter.GetOutput(), filename, showProgress);
+  }
+
+  /** Do not let a next update of the resampler be restricted to the last streamed slab. */
+  resampleImageFilter.GetOutput()->SetRequestedRegionToLargestPossibleRegion();
 
   /** Disconnect from the resampler. */
   if (showProgress && (progressObserver != nullptr))
@@ -400,7 +419,12 @@ ResamplerBase<TElastix>::WriteResultImage(OutputImageType *   image,
   }
   try
   {
-    itk::WriteCastedImage(*(infoChanger->GetOutput()), filename, resultImagePixelType, doCompression);
+    const Profiler::ScopedTimer profilerTimer("ImageIO::WriteResultImage");
+    itk::WriteCastedImage(*(infoChanger->GetOutput()),
+                          filename,
+                          resultImagePixelType,
+                          doCompression,
+                          this->GetNumberOfStreamDivisions());
   }
   catch (itk::ExceptionObject & excp)
   {
@@ -437,21 +461,29 @@ ResamplerBase<TElastix>::CreateItkResultImage()
   const auto progressObserver =
     showProgressPercentage ? ProgressCommand::CreateAndConnect(*(this->GetAsITKBaseType())) : nullptr;
 
-  /** Do the resampling. */
-  try
+  /** Do the resampling. When the result image is streamed, CastImage updates the resampler slab by slab. */
+  const unsigned int numberOfStreamDivisions = this->GetNumberOfStreamDivisions();
+  if (numberOfStreamDivisions > 1)
   {
-    resampleImageFilter.Update();
+    this->SetInputImageOfInterpolator();
   }
-  catch (itk::ExceptionObject & excp)
+  else
   {
-    /** Add information to the exception. */
-    excp.SetLocation("ResamplerBase - WriteResultImage()");
-    std::string err_str = excp.GetDescription();
-    err_str += "\nError occurred while resampling the image.\n";
-    excp.SetDescription(err_str);
-
-    /** Pass the exception to an higher level. */
-    throw;
+    try
+    {
+      resampleImageFilter.Update();
+    }
+    catch (itk::ExceptionObject & excp)
+    {
+      /** Add information to the exception. */
+      excp.SetLocation("ResamplerBase - WriteResultImage()");
+      std::string err_str = excp.GetDescription();
+      err_str += "\nError occurred while resampling the image.\n";
+      excp.SetDescription(err_str);
+
+      /** Pass the exception to an higher level. */
+      throw;
+    }
   }
 
   /** Check if ResampleInterpolator is the RayCastResampleInterpolator */
@@ -484,44 +516,44 @@ ResamplerBase<TElastix>::CreateItkResultImage()
   /** cast the image to the correct output image Type */
   if (resultImagePixelType == "char")
   {
-    resultImage = CastImage<char>(infoChanger->GetOutput());
+    resultImage = CastImage<char>(infoChanger->GetOutput(), numberOfStreamDivisions);
   }
   if (resultImagePixelType == "unsigned char")
   {
-    resultImage = CastImage<unsigned char>(infoChanger->GetOutput());
+    resultImage = CastImage<unsigned char>(infoChanger->GetOutput(), numberOfStreamDivisions);
   }
   else if (resultImagePixelType == "short")
   {
-    resultImage = CastImage<short>(infoChanger->GetOutput());
+    resultImage = CastImage<short>(infoChanger->GetOutput(), numberOfStreamDivisions);
   }
   else if (resultImagePixelType == "ushort" ||
            resultImagePixelType == "unsigned short") // <-- ushort for backwards compatibility
   {
-    resultImage = CastImage<unsigned short>(infoChanger->GetOutput());
+    resultImage = CastImage<unsigned short>(infoChanger->GetOutput(), numberOfStreamDivisions);
   }
   else if (resultImagePixelType == "int")
   {
-    resultImage = CastImage<int>(infoChanger->GetOutput());
+    resultImage = CastImage<int>(infoChanger->GetOutput(), numberOfStreamDivisions);
   }
   else if (resultImagePixelType == "unsigned int")
   {
-    resultImage = CastImage<unsigned int>(infoChanger->GetOutput());
+    resultImage = CastImage<unsigned int>(infoChanger->GetOutput(), numberOfStreamDivisions);
   }
   else if (resultImagePixelType == "long")
   {
-    resultImage = CastImage<long>(infoChanger->GetOutput());
+    resultImage = CastImage<long>(infoChanger->GetOutput(), numberOfStreamDivisions);
   }
   else if (resultImagePixelType == "unsigned long")
   {
-    resultImage = CastImage<unsigned long>(infoChanger->GetOutput());
+    resultImage = CastImage<unsigned long>(infoChanger->GetOutput(), numberOfStreamDivisions);
   }
   else if (resultImagePixelType == "float")
   {
-    resultImage = CastImage<float>(infoChanger->GetOutput());
+    resultImage = CastImage<float>(infoChanger->GetOutput(), numberOfStreamDivisions);
   }
   else if (resultImagePixelType == "double")
   {
-    resultImage = CastImage<double>(infoChanger->GetOutput());
+    resultImage = CastImage<double>(infoChanger->GetOutput(), numberOfStreamDivisions);
   }
 
   if (resultImage.IsNull())
@@ -532,6 +564,9 @@ ResamplerBase<TElastix>::CreateItkResultImage()
                       << resultImagePixelType << "\".");
   }
 
+  /** Do not let a next update of the resampler be restricted to the last streamed slab. */
+  resampleImageFilter.GetOutput()->SetRequestedRegionToLargestPossibleRegion();
+
   // put image in container
   this->m_Elastix->SetResultImage(resultImage);
 
@@ -543,6 +578,43 @@ ResamplerBase<TElastix>::CreateItkResultImage()
 } // end CreateItkResultImage()
 
 
+/**
+ * ************** GetNumberOfStreamDivisions ***************
+ */
+
+template <class TElastix>
+unsigned int
+ResamplerBase<TElastix>::GetNumberOfStreamDivisions() const
+{
+  const Configuration & configuration = Deref(Superclass::GetConfiguration());
+
+  return std::max(configuration.RetrieveParameterValue(1U, "NumberOfStreamDivisions", 0, false), 1U);
+
+} // end GetNumberOfStreamDivisions()
+
+
+/**
+ * ************** SetInputImageOfInterpolator ***************
+ */
+
+template <class TElastix>
+void
+ResamplerBase<TElastix>::SetInputImageOfInterpolator()
+{
+  ITKBaseType & resampleImageFilter = this->GetSelf();
+
+  const InputImageType * const inputImage = resampleImageFilter.GetInput();
+  auto * const                 interpolator = resampleImageFilter.GetModifiableInterpolator();
+
+  if ((inputImage != nullptr) && (interpolator != nullptr))
+  {
+    const Profiler::ScopedTimer profilerTimer("Resampler::SetInputImageOfInterpolator");
+    interpolator->SetInputImage(inputImage);
+  }
+
+} // end SetInputImageOfInterpolator()
+
+
 /*
  * ************************* ReadFromFile ***********************
  */
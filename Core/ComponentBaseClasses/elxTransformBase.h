@@ -29,11 +29,19 @@
 #include "itkAdvancedCombinationTransform.h"
 #include "elxComponentDatabase.h"
 #include "elxProgressCommand.h"
+#include "elxMemoryMappedFile.h"
+#include "elxWorkStealingThreadPool.h"
+#include "elxImageValueStatistics.h"
 
 // ITK header files:
+#include <itkChangeInformationImageFilter.h>
 #include <itkImage.h>
 #include <itkOptimizerParameters.h>
-#include <itkTransformMeshFilter.h>
+
+#include <algorithm> // For min and max.
+#include <cstdint>   // For uint64_t.
+#include <memory>    // For unique_ptr.
+#include <vector>
 
 
 namespace elastix
@@ -57,6 +65,43 @@ namespace elastix
  *   "Compose" by composition: \f$T(x) = T_1 ( T_0(x) )\f$.\n
  *   example: <tt>(HowToCombineTransforms "Add")</tt>\n
  *   Default: "Add".
+ * \parameter WriteTransformParametersToBinaryFile: Write the TransformParameters to a binary
+ *   file next to the transform parameter file, instead of writing them as text inside it. The
+ *   transform parameter file then refers to the binary file by TransformParametersFileName.
+ *   Recommended for transforms that have a very large number of parameters, like dense
+ *   B-spline grids, as reading such a file is much faster than parsing the text.\n
+ *   example: <tt>(WriteTransformParametersToBinaryFile "true")</tt>\n
+ *   Default: "false".
+ * \parameter ResultPointsFormat: The format of the file with the points that are transformed by transformix, when
+ *   they are specified in a text file by the command line argument -def: "txt" for the text file "outputpoints.txt",
+ *   or "bin" for the binary file "outputpoints.bin". The binary file consists of a 32 byte header (the 8 characters
+ *   "ELXOPBIN", the number of points as 64-bit unsigned integer, followed by the fixed and the moving image
+ *   dimension, whether the OutputIndexMoving column is present, and whether the input points were indices, as
+ *   32-bit unsigned integers), followed by the columns InputIndex, InputPoint, OutputIndexFixed, OutputPoint,
+ *   Deformation, and (if present) OutputIndexMoving. Each column stores the values of all points, one point
+ *   after the other; indices as 64-bit signed integers, and coordinates as 64-bit floating point numbers, all in
+ *   the native byte order.\n
+ *   example: <tt>(ResultPointsFormat "bin")</tt>\n
+ *   Default: "txt".
+ * \parameter NumberOfStreamDivisions: The number of pieces in which transformix computes and writes the images
+ *   of the spatial Jacobian (determinant) that are requested by the command line arguments -jac and -jacmat. Each
+ *   piece is computed by multiple threads, and written to disk before the next one is computed, so that the full
+ *   image is not kept in memory, when the image file format supports streamed writing (like "mhd" and "nii").
+ *   The same parameter specifies the number of slabs in which the result image is resampled (see ResamplerBase).\n
+ *   example: <tt>(NumberOfStreamDivisions 16)</tt>\n
+ *   Default: 1.
+ * \parameter SpatialJacobianDeterminantHistogramMinimum: The lower bound of the histogram of the spatial Jacobian
+ *   determinant, computed by "-jac stats".\n
+ *   example: <tt>(SpatialJacobianDeterminantHistogramMinimum 0.5)</tt>\n
+ *   Default: 0.
+ * \parameter SpatialJacobianDeterminantHistogramMaximum: The upper bound of the histogram of the spatial Jacobian
+ *   determinant, computed by "-jac stats".\n
+ *   example: <tt>(SpatialJacobianDeterminantHistogramMaximum 1.5)</tt>\n
+ *   Default: 2.
+ * \parameter SpatialJacobianDeterminantHistogramNumberOfBins: The number of bins of the histogram of the spatial
+ *   Jacobian determinant, computed by "-jac stats".\n
+ *   example: <tt>(SpatialJacobianDeterminantHistogramNumberOfBins 50)</tt>\n
+ *   Default: 20.
  *
  * \transformparameter UseDirectionCosines: Controls whether to use or ignore the
  * direction cosines (world matrix, transform matrix) set in the images.
@@ -103,6 +148,13 @@ namespace elastix
  * The number of entries is stored the NumberOfParameters entry.
  * \transformparameter NumberOfParameters: the length of the transform parameter vector.\n
  * example <tt>(NumberOfParameters 722)</tt>\n
+ * \transformparameter TransformParametersFileName: the name of a binary file that contains the
+ * transform parameter vector, instead of the TransformParameters entry. A relative name is relative to the
+ * directory of the transform parameter file. The file consists of a 24 byte header (the 8 characters
+ * "ELXTPBIN", the byte order mark 0x0102030405060708 and the number of parameters, both as 64-bit unsigned
+ * integer), followed by the parameters as 64-bit floating point numbers. It is written in the native byte order,
+ * and memory mapped when it is read. A file of the opposite byte order is copied and byte swapped instead.\n
+ * example <tt>(TransformParametersFileName "TransformParameters.0.bin")</tt>\n
  * \transformparameter InitialTransformParameterFileName: The location/name of an initial
  * transform that will be loaded when loading the current transform parameter file. Note
  * that transform parameter file can also contain an initial transform. Recursively all
@@ -128,6 +180,15 @@ namespace elastix
  *    It is also possible to deform all points, thereby generating a deformation field
  *    image. This is done by:\n
  *    example: <tt>-def all</tt> \n
+ * \commandlinearg -jac: optional argument for transformix for computing the spatial Jacobian determinant.
+ *    "-jac all" writes the image "spatialJacobian.<ResultImageFormat>", whereas "-jac stats" only writes
+ *    a summary to "spatialJacobianStatistics.txt": the minimum, maximum and mean, the fraction of
+ *    non-positive (folding) voxels, and a histogram. The summary is accumulated piece by piece, without
+ *    keeping the full image in memory.\n
+ *    example: <tt>-jac stats</tt> \n
+ * \commandlinearg -jacmat: optional argument for transformix for computing the spatial Jacobian matrix,
+ *    written as a vector image to "fullSpatialJacobian.<ResultImageFormat>".\n
+ *    example: <tt>-jacmat all</tt> \n
  *
  * \ingroup Transforms
  * \ingroup ComponentBaseClasses
@@ -261,7 +322,12 @@ public:
   typename SpatialJacobianMatrixImageType::Pointer
   ComputeSpatialJacobianMatrixImage() const;
 
-  /** Computes the determinant of the spatial Jacobian and writes it to file. */
+  /** Computes the statistics of the spatial Jacobian determinant, piece by piece, as specified by the
+   * NumberOfStreamDivisions and SpatialJacobianDeterminantHistogram parameters. The pieces are not stored. */
+  ImageValueStatistics
+  ComputeSpatialJacobianDeterminantStatistics() const;
+
+  /** Computes the determinant of the spatial Jacobian and writes it (or its statistics) to file. */
   void
   ComputeAndWriteSpatialJacobianDeterminantImage() const;
 
@@ -275,17 +341,45 @@ public:
   void
   SetFinalParameters();
 
-  /** Transforms the specified mesh.
+  /** Transforms the specified mesh. The points are transformed concurrently. The output mesh shares the cells and
+   * the point and cell data of the input mesh, like the output of itk::TransformMeshFilter.
    */
   template <typename TMesh>
   typename TMesh::Pointer
   TransformMesh(const TMesh & mesh) const
   {
-    DefaultConstruct<itk::TransformMeshFilter<TMesh, TMesh, CombinationTransformType>> transformMeshFilter;
-    transformMeshFilter.SetTransform(&const_cast<CombinationTransformType &>(this->GetSelf()));
-    transformMeshFilter.SetInput(&mesh);
-    transformMeshFilter.Update();
-    return transformMeshFilter.GetOutput();
+    const auto & inputPoints = Deref(mesh.GetPoints());
+
+    /** Copy the points to an array, which can be accessed concurrently, whatever the type of points container. */
+    std::vector<typename TMesh::PointType> points;
+    points.reserve(inputPoints.Size());
+    for (auto it = inputPoints.Begin(); it != inputPoints.End(); ++it)
+    {
+      points.push_back(it.Value());
+    }
+
+    const ITKBaseType & transform = this->GetSelf();
+    const auto transformPoints = [&points, &transform](unsigned int, const std::size_t begin, const std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        InputPointType inputPoint;
+        inputPoint.CastFrom(points[i]);
+        points[i].CastFrom(transform.TransformPoint(inputPoint));
+      }
+    };
+    ForEachPointRange(points.size(), transformPoints);
+
+    const auto outputPoints = TMesh::PointsContainer::New();
+    std::size_t i = 0;
+    for (auto it = inputPoints.Begin(); it != inputPoints.End(); ++it, ++i)
+    {
+      outputPoints->InsertElement(it.Index(), points[i]);
+    }
+
+    const auto outputMesh = TMesh::New();
+    outputMesh->Graft(&mesh);
+    outputMesh->SetPoints(outputPoints);
+    return outputMesh;
   }
 
 protected:
@@ -324,6 +418,25 @@ protected:
 private:
   elxDeclarePureVirtualGetSelfMacro(ITKBaseType);
 
+  /** Calls the function for each work unit, with the index of the work unit and a contiguous range [begin, end) of
+   * the point indices [0, numberOfPoints). The work units are executed concurrently, on the thread pool. Their ranges
+   * are in the order of the work units. */
+  template <typename TFunction>
+  static void
+  ForEachPointRange(const std::size_t numberOfPoints, const TFunction & function)
+  {
+    const unsigned int numberOfWorkUnits =
+      std::max(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(), itk::ThreadIdType{ 1 });
+    const std::size_t pointsPerWorkUnit = (numberOfPoints + numberOfWorkUnits - 1) / numberOfWorkUnits;
+
+    WorkStealingThreadPool::GetInstance().ForkJoin(
+      numberOfWorkUnits, [numberOfPoints, pointsPerWorkUnit, &function](const unsigned int workUnit) {
+        const std::size_t begin = std::min(workUnit * pointsPerWorkUnit, numberOfPoints);
+        const std::size_t end = std::min(begin + pointsPerWorkUnit, numberOfPoints);
+        function(workUnit, begin, end);
+      });
+  }
+
   /** Supports either TransformToDeterminantOfSpatialJacobianSource or TransformToSpatialJacobianSource as TSource. */
   template <template <typename, typename> class TSource, typename TOutputImage>
   auto
@@ -444,11 +557,37 @@ private:
   WriteDerivedTransformDataToFile() const
   {}
 
+  /** The signature at the start of a binary transform parameters file, the byte order mark that follows it (as
+   * written in the native byte order), and the size of the header. */
+  static constexpr char          BinaryFileSignature[] = "ELXTPBIN";
+  static constexpr std::uint64_t BinaryFileByteOrderMark{ 0x0102030405060708 };
+  static constexpr std::size_t   BinaryFileHeaderSize{ 24 };
+
+  /** The signature at the start of a binary output points file, and the size of its header. */
+  static constexpr char        OutputPointsBinaryFileSignature[] = "ELXOPBIN";
+  static constexpr std::size_t OutputPointsBinaryFileHeaderSize{ 32 };
+
+  /** The maximum number of points that TransformPointsSomePoints reads, transforms, and writes at a time. */
+  static constexpr std::size_t PointsChunkSize{ 65536 };
+
+  /** Writes the specified parameters to a binary transform parameters file. */
+  static void
+  WriteTransformParametersBinaryFile(const ParametersType & param, const std::string & fileName);
+
+  /** Maps the specified binary transform parameters file into memory, and lets m_TransformParameters refer to the
+   * mapped data, without copying. */
+  void
+  ReadTransformParametersBinaryFile(const std::string & fileName, const unsigned int numberOfParameters);
+
   /** Member variables. */
   std::string    m_TransformParameterFileName;
   ParametersType m_TransformParameters;
   ParametersType m_FinalParameters;
 
+  /** Keeps the memory mapped binary transform parameters file (if any) alive, as long as m_TransformParameters may
+   * refer to its data. */
+  std::unique_ptr<MemoryMappedFile> m_TransformParametersMappedFile;
+
   /** Boolean to decide whether or not the transform parameters are written. */
   bool m_ReadWriteTransformParameters{ true };
 };
@@ -37,14 +37,23 @@
 #include "itkImageGridSampler.h"
 #include "itkContinuousIndex.h"
 #include "itkChangeInformationImageFilter.h"
+#include "itkImageRegionSplitterSlowDimension.h"
+#include "itkUnaryGeneratorImageFilter.h"
 #include "itkMesh.h"
 #include "itkMeshFileReader.h"
 #include "itkMeshFileWriter.h"
 #include "itkCommonEnums.h"
 
+#include <algorithm> // For reverse.
 #include <cassert>
+#include <cstdint> // For uint64_t.
+#include <cstring> // For memcmp and memcpy.
 #include <fstream>
 #include <iomanip> // For setprecision.
+#include <sstream>
+#include <string>
+#include <type_traits> // For conditional_t and is_integral_v.
+#include <vector>
 
 
 namespace elastix
@@ -302,31 +311,63 @@ TransformBase<TElastix>::ReadFromFile()
       unsigned int numberOfParameters = 0;
       configuration.ReadParameter(numberOfParameters, "NumberOfParameters", 0);
 
-      /** Read the TransformParameters. */
-      std::vector<ValueType> vecPar(numberOfParameters);
-      configuration.ReadParameter(vecPar, "TransformParameters", 0, numberOfParameters - 1, true);
+      const auto binaryFileName =
+        configuration.RetrieveParameterStringValue({}, "TransformParametersFileName", 0, false);
 
-      /** Do not rely on vecPar.size(), since it is unchanged by ReadParameter(). */
-      const std::size_t numberOfParametersFound = configuration.CountNumberOfParameterEntries("TransformParameters");
-
-      /** Sanity check. Are the number of found parameters the same as
-       * the number of specified parameters?
-       */
-      if (numberOfParametersFound != numberOfParameters)
+      if (binaryFileName.empty())
       {
-        itkExceptionMacro("\nERROR: Invalid transform parameter file!\n"
-                          << "The number of parameters in \"TransformParameters\" is " << numberOfParametersFound
-                          << ", which does not match the number specified in \"NumberOfParameters\" ("
-                          << numberOfParameters << ").\n"
-                          << "The transform parameters should be specified as:\n"
-                          << "  (TransformParameters num num ... num)\n"
-                          << "with " << numberOfParameters << " parameters.\n");
+        /** Read the TransformParameters. */
+        std::vector<ValueType> vecPar(numberOfParameters);
+        configuration.ReadParameter(vecPar, "TransformParameters", 0, numberOfParameters - 1, true);
+
+        /** Do not rely on vecPar.size(), since it is unchanged by ReadParameter(). */
+        const std::size_t numberOfParametersFound = configuration.CountNumberOfParameterEntries("TransformParameters");
+
+        /** Sanity check. Are the number of found parameters the same as
+         * the number of specified parameters?
+         */
+        if (numberOfParametersFound != numberOfParameters)
+        {
+          itkExceptionMacro("\nERROR: Invalid transform parameter file!\n"
+                            << "The number of parameters in \"TransformParameters\" is " << numberOfParametersFound
+                            << ", which does not match the number specified in \"NumberOfParameters\" ("
+                            << numberOfParameters << ").\n"
+                            << "The transform parameters should be specified as:\n"
+                            << "  (TransformParameters num num ... num)\n"
+                            << "with " << numberOfParameters << " parameters.\n");
+        }
+
+        /** Copy to m_TransformParameters. */
+        // NOTE: we could avoid this by directly reading into the transform parameters,
+        // e.g. by overloading ReadParameter(), or use swap (?).
+        m_TransformParameters = Conversion::ToOptimizerParameters(vecPar);
+      }
+      else
+      {
+        /** A relative file name is relative to the directory of the transform parameter file. A parameter map that
+         * is not read from file has no such directory, so then the file name must be a full path. (When a transform
+         * parameter file is read by ParameterObject, it already makes the file name a full path.) */
+        const std::string configurationParameterFileName = configuration.GetParameterFileName();
+
+        if (itksys::SystemTools::FileIsFullPath(binaryFileName))
+        {
+          this->ReadTransformParametersBinaryFile(binaryFileName, numberOfParameters);
+        }
+        else if (configurationParameterFileName.empty())
+        {
+          itkExceptionMacro("ERROR: The TransformParametersFileName ""
+                            << binaryFileName
+                            << "" is a relative path, while the transform parameters are not read from file. Please "
+                               "specify its full path instead.");
+        }
+        else
+        {
+          this->ReadTransformParametersBinaryFile(
+            itksys::SystemTools::CollapseFullPath(binaryFileName,
+                                                  itksys::SystemTools::GetFilenamePath(configurationParameterFileName)),
+            numberOfParameters);
+        }
       }
-
-      /** Copy to m_TransformParameters. */
-      // NOTE: we could avoid this by directly reading into the transform parameters,
-      // e.g. by overloading ReadParameter(), or use swap (?).
-      m_TransformParameters = Conversion::ToOptimizerParameters(vecPar);
     }
     else
     {
@@ -446,6 +487,116 @@ TransformBase<TElastix>::ReadFromFile()
 } // end ReadFromFile()
 
 
+/**
+ * ************** WriteTransformParametersBinaryFile ************
+ */
+
+template <class TElastix>
+void
+TransformBase<TElastix>::WriteTransformParametersBinaryFile(const ParametersType & param, const std::string & fileName)
+{
+  std::ofstream binaryFile(fileName, std::ios::binary);
+
+  if (!binaryFile.is_open())
+  {
+    itkGenericExceptionMacro("ERROR: File \"" << fileName << "\" could not be opened!");
+  }
+
+  /** Write the header: the signature, the byte order mark, and the number of parameters. */
+  const std::uint64_t numberOfParameters{ param.GetSize() };
+  binaryFile.write(BinaryFileSignature, sizeof(std::uint64_t));
+  binaryFile.write(reinterpret_cast<const char *>(&BinaryFileByteOrderMark), sizeof(BinaryFileByteOrderMark));
+  binaryFile.write(reinterpret_cast<const char *>(&numberOfParameters), sizeof(numberOfParameters));
+
+  /** Write the parameters themselves. */
+  binaryFile.write(reinterpret_cast<const char *>(param.data_block()), numberOfParameters * sizeof(ValueType));
+
+  if (!binaryFile)
+  {
+    itkGenericExceptionMacro("ERROR: Failed to write the transform parameters to \"" << fileName << "\"!");
+  }
+
+} // end WriteTransformParametersBinaryFile()
+
+
+/**
+ * ************** ReadTransformParametersBinaryFile *************
+ */
+
+template <class TElastix>
+void
+TransformBase<TElastix>::ReadTransformParametersBinaryFile(const std::string & fileName,
+                                                           const unsigned int  numberOfParameters)
+{
+  auto         mappedFile = std::make_unique<MemoryMappedFile>(fileName);
+  char * const data = static_cast<char *>(mappedFile->GetData());
+
+  /** Check the signature and the byte order mark of the header. */
+  if ((mappedFile->GetSize() < BinaryFileHeaderSize) ||
+      (std::memcmp(data, BinaryFileSignature, sizeof(std::uint64_t)) != 0))
+  {
+    itkExceptionMacro("ERROR: \"" << fileName << "\" is not a valid binary transform parameters file!");
+  }
+
+  std::uint64_t byteOrderMark{};
+  std::memcpy(&byteOrderMark, data + sizeof(std::uint64_t), sizeof(byteOrderMark));
+
+  /** Reverses the bytes of each of the specified number of 8-byte values, in place. */
+  const auto swapBytes = [](char * const values, const std::size_t numberOfValues) {
+    for (std::size_t i{}; i < numberOfValues; ++i)
+    {
+      std::reverse(values + i * sizeof(std::uint64_t), values + (i + 1) * sizeof(std::uint64_t));
+    }
+  };
+
+  bool isSwapped{ false };
+  if (byteOrderMark != BinaryFileByteOrderMark)
+  {
+    swapBytes(reinterpret_cast<char *>(&byteOrderMark), 1);
+    isSwapped = (byteOrderMark == BinaryFileByteOrderMark);
+
+    if (!isSwapped)
+    {
+      itkExceptionMacro("ERROR: \"" << fileName << "\" has an unknown byte order!");
+    }
+  }
+
+  /** Check the number of parameters, and the file size. */
+  std::uint64_t numberOfParametersInFile{};
+  std::memcpy(&numberOfParametersInFile, data + 2 * sizeof(std::uint64_t), sizeof(numberOfParametersInFile));
+  if (isSwapped)
+  {
+    swapBytes(reinterpret_cast<char *>(&numberOfParametersInFile), 1);
+  }
+
+  if ((numberOfParametersInFile != numberOfParameters) ||
+      (mappedFile->GetSize() != BinaryFileHeaderSize + numberOfParameters * sizeof(ValueType)))
+  {
+    itkExceptionMacro("ERROR: The number of parameters in \""
+                      << fileName << "\" is " << numberOfParametersInFile
+                      << ", which does not match the number specified in \"NumberOfParameters\" ("
+                      << numberOfParameters << "), or the file size is not as expected.");
+  }
+
+  if (isSwapped)
+  {
+    /** The file has the opposite byte order, so its data cannot be used directly. Copy and swap it instead. */
+    m_TransformParameters.SetSize(numberOfParameters);
+    char * const parameterData = reinterpret_cast<char *>(m_TransformParameters.data_block());
+    std::memcpy(parameterData, data + BinaryFileHeaderSize, numberOfParameters * sizeof(ValueType));
+    swapBytes(parameterData, numberOfParameters);
+    m_TransformParametersMappedFile.reset();
+    return;
+  }
+
+  /** Let the parameters refer to the mapped data, without copying. The mapping is copy-on-write, so the file is not
+   * affected when the parameters are modified afterwards. */
+  m_TransformParameters.SetData(reinterpret_cast<ValueType *>(data + BinaryFileHeaderSize), numberOfParameters, false);
+  m_TransformParametersMappedFile = std::move(mappedFile);
+
+} // end ReadTransformParametersBinaryFile()
+
+
 /**
  * ******************* ReadInitialTransformFromFile *************
  */
@@ -548,6 +699,19 @@ TransformBase<TElastix>::WriteToFile(std::ostream & transformationParameterInfo,
     }
   }
 
+  /** Possibly write the transform parameters to a binary file, next to the transform parameter file. */
+  if ((parameterMap.count("TransformParameters") > 0) && !m_TransformParameterFileName.empty() &&
+      configuration.RetrieveParameterValue(false, "WriteTransformParametersToBinaryFile", 0, false))
+  {
+    const std::string binaryFileName =
+      std::string(m_TransformParameterFileName, 0, m_TransformParameterFileName.rfind('.')) + ".bin";
+
+    WriteTransformParametersBinaryFile(param, binaryFileName);
+
+    parameterMap.erase("TransformParameters");
+    parameterMap["TransformParametersFileName"] = { itksys::SystemTools::GetFilenameName(binaryFileName) };
+  }
+
   const auto writeCompositeTransform = configuration.RetrieveValuesOfParameter<bool>("WriteITKCompositeTransform");
 
   if ((writeCompositeTransform != nullptr) && (*writeCompositeTransform == std::vector<bool>{ true }) &&
@@ -717,6 +881,9 @@ TransformBase<TElastix>::TransformPoints() const
  * Computes the transformed points, converts them back to an index and compute
  * the deformation vector as the difference between the outputpoint and
  * the input point. Save the results.
+ *
+ * The points are read, transformed, and written in chunks of PointsChunkSize
+ * points. Each chunk is transformed and formatted by multiple threads.
  */
 
 template <class TElastix>
@@ -740,11 +907,11 @@ TransformBase<TElastix>::TransformPointsSomePoints(const std::string & filename)
   const auto ippReader = itk::TransformixInputPointFileReader<PointSetType>::New();
   ippReader->SetFileName(filename);
 
-  /** Read the input points. */
+  /** Read the header of the input point file. The points themselves are read in chunks, below. */
   log::info(std::ostringstream{} << "  Reading input point file: " << filename);
   try
   {
-    ippReader->Update();
+    ippReader->UpdateOutputInformation();
   }
   catch (const itk::ExceptionObject & err)
   {
@@ -752,7 +919,8 @@ TransformBase<TElastix>::TransformPointsSomePoints(const std::string & filename)
   }
 
   /** Some user-feedback. */
-  if (ippReader->GetPointsAreIndices())
+  const bool pointsAreIndices = ippReader->GetPointsAreIndices();
+  if (pointsAreIndices)
   {
     log::info("  Input points are specified as image indices.");
   }
@@ -760,20 +928,9 @@ TransformBase<TElastix>::TransformPointsSomePoints(const std::string & filename)
   {
     log::info("  Input points are specified in world coordinates.");
   }
-  const unsigned int nrofpoints = ippReader->GetNumberOfPoints();
+  const unsigned long nrofpoints = ippReader->GetNumberOfPoints();
   log::info(std::ostringstream{} << "  Number of specified input points: " << nrofpoints);
 
-  /** Get the set of input points. */
-  typename PointSetType::Pointer inputPointSet = ippReader->GetOutput();
-
-  /** Create the storage classes. */
-  std::vector<FixedImageIndexType>   inputindexvec(nrofpoints);
-  std::vector<InputPointType>        inputpointvec(nrofpoints);
-  std::vector<OutputPointType>       outputpointvec(nrofpoints);
-  std::vector<FixedImageIndexType>   outputindexfixedvec(nrofpoints);
-  std::vector<MovingImageIndexType>  outputindexmovingvec(nrofpoints);
-  std::vector<DeformationVectorType> deformationvec(nrofpoints);
-
   const auto & resampleImageFilter = *(this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType());
 
   /** Make a temporary image with the right region info,
@@ -791,119 +948,233 @@ TransformBase<TElastix>::TransformPointsSomePoints(const std::string & filename)
   const typename MovingImageType::Pointer movingImage = this->GetElastix()->GetMovingImage();
   const bool                              alsoMovingIndices = movingImage.IsNotNull();
 
-  /** Read the input points, as index or as point. */
-  if (ippReader->GetPointsAreIndices())
+  const Configuration & configuration = Deref(Superclass::GetConfiguration());
+  const std::string     outputDirectoryPath = configuration.GetCommandLineArgument("-out");
+  const std::string     resultPointsFormat =
+    configuration.RetrieveParameterValue(std::string{ "txt" }, "ResultPointsFormat", 0, false);
+  const bool writeBinaryFile = (resultPointsFormat == "bin");
+
+  if (!writeBinaryFile && (resultPointsFormat != "txt"))
   {
-    for (unsigned int j = 0; j < nrofpoints; ++j)
-    {
-      /** The read point from the inutPointSet is actually an index
-       * Cast to the proper type.
-       */
-      InputPointType point{};
-      inputPointSet->GetPoint(j, &point);
-      for (unsigned int i = 0; i < FixedImageDimension; ++i)
-      {
-        inputindexvec[j][i] = static_cast<FixedImageIndexValueType>(itk::Math::Round<int64_t>(point[i]));
-      }
-      /** Compute the input point in physical coordinates. */
-      dummyImage->TransformIndexToPhysicalPoint(inputindexvec[j], inputpointvec[j]);
-    }
+    itkExceptionMacro("ERROR: ResultPointsFormat \"" << resultPointsFormat
+                                                     << "\" is not supported. Use \"txt\" or \"bin\".");
   }
-  else
+
+  /** Create the output file, if an output directory is specified. */
+  std::ofstream outputPointsFile;
+  if (!outputDirectoryPath.empty())
   {
-    for (unsigned int j = 0; j < nrofpoints; ++j)
+    const std::string outputPointsFileName =
+      outputDirectoryPath + (writeBinaryFile ? "outputpoints.bin" : "outputpoints.txt");
+    log::info(std::ostringstream{} << "  The transformed points are saved in: " << outputPointsFileName);
+
+    if (writeBinaryFile)
     {
-      /** Compute index of nearest voxel in fixed image. */
-      InputPointType point{};
-      inputPointSet->GetPoint(j, &point);
-      inputpointvec[j] = point;
-      const auto fixedcindex = dummyImage->template TransformPhysicalPointToContinuousIndex<double>(point);
-      for (unsigned int i = 0; i < FixedImageDimension; ++i)
-      {
-        inputindexvec[j][i] = static_cast<FixedImageIndexValueType>(itk::Math::Round<int64_t>(fixedcindex[i]));
-      }
+      outputPointsFile.open(outputPointsFileName, std::ios::binary);
+
+      /** Write the header. */
+      const std::uint64_t numberOfPoints{ nrofpoints };
+      const std::uint32_t headerValues[] = { FixedImageDimension,
+                                             MovingImageDimension,
+                                             static_cast<std::uint32_t>(alsoMovingIndices),
+                                             static_cast<std::uint32_t>(pointsAreIndices) };
+      outputPointsFile.write(OutputPointsBinaryFileSignature, sizeof(std::uint64_t));
+      outputPointsFile.write(reinterpret_cast<const char *>(&numberOfPoints), sizeof(numberOfPoints));
+      outputPointsFile.write(reinterpret_cast<const char *>(headerValues), sizeof(headerValues));
+    }
+    else
+    {
+      outputPointsFile.open(outputPointsFileName);
     }
-  }
-
-  /** Apply the transform. */
-  log::info("  The input points are transformed.");
-  for (unsigned int j = 0; j < nrofpoints; ++j)
-  {
-    /** Call TransformPoint. */
-    outputpointvec[j] = this->GetAsITKBaseType()->TransformPoint(inputpointvec[j]);
 
-    /** Transform back to index in fixed image domain. */
-    const auto fixedcindex = dummyImage->template TransformPhysicalPointToContinuousIndex<double>(outputpointvec[j]);
-    for (unsigned int i = 0; i < FixedImageDimension; ++i)
+    if (!outputPointsFile.is_open())
     {
-      outputindexfixedvec[j][i] = static_cast<FixedImageIndexValueType>(itk::Math::Round<int64_t>(fixedcindex[i]));
+      itkExceptionMacro("ERROR: File \"" << outputPointsFileName << "\" could not be opened!");
     }
+  }
 
-    if (alsoMovingIndices)
+  /** The storage for one chunk of points. It is allocated once, and reused for each chunk. */
+  const std::size_t                  chunkCapacity = std::min<std::size_t>(nrofpoints, PointsChunkSize);
+  std::vector<InputPointType>        inputpointvec;
+  std::vector<FixedImageIndexType>   inputindexvec(chunkCapacity);
+  std::vector<OutputPointType>       outputpointvec(chunkCapacity);
+  std::vector<FixedImageIndexType>   outputindexfixedvec(chunkCapacity);
+  std::vector<MovingImageIndexType>  outputindexmovingvec(alsoMovingIndices ? chunkCapacity : 0);
+  std::vector<DeformationVectorType> deformationvec(chunkCapacity);
+  std::vector<std::string>           textPerWorkUnit;
+
+  /** Transforms the points of the chunk [begin, end), and formats the text of their results. */
+  const auto transformPoints = [&](const std::size_t begin, const std::size_t end) {
+    for (std::size_t j = begin; j < end; ++j)
     {
-      /** Transform back to index in moving image domain. */
-      const auto movingcindex =
-        movingImage->template TransformPhysicalPointToContinuousIndex<double>(outputpointvec[j]);
-      for (unsigned int i = 0; i < MovingImageDimension; ++i)
+      if (pointsAreIndices)
       {
-        outputindexmovingvec[j][i] = static_cast<MovingImageIndexValueType>(itk::Math::Round<int64_t>(movingcindex[i]));
+        /** The read point from the input file is actually an index. Cast to the proper type. */
+        for (unsigned int i = 0; i < FixedImageDimension; ++i)
+        {
+          inputindexvec[j][i] =
+            static_cast<FixedImageIndexValueType>(itk::Math::Round<int64_t>(inputpointvec[j][i]));
+        }
+        /** Compute the input point in physical coordinates. */
+        dummyImage->TransformIndexToPhysicalPoint(inputindexvec[j], inputpointvec[j]);
+      }
+      else
+      {
+        /** Compute index of nearest voxel in fixed image. */
+        const auto fixedcindex = dummyImage->template TransformPhysicalPointToContinuousIndex<double>(inputpointvec[j]);
+        for (unsigned int i = 0; i < FixedImageDimension; ++i)
+        {
+          inputindexvec[j][i] = static_cast<FixedImageIndexValueType>(itk::Math::Round<int64_t>(fixedcindex[i]));
+        }
       }
-    }
 
-    /** Compute displacement. */
-    deformationvec[j].CastFrom(outputpointvec[j] - inputpointvec[j]);
-  }
+      /** Call TransformPoint. */
+      outputpointvec[j] = this->GetAsITKBaseType()->TransformPoint(inputpointvec[j]);
 
-  const Configuration & configuration = Deref(Superclass::GetConfiguration());
+      /** Transform back to index in fixed image domain. */
+      const auto fixedcindex = dummyImage->template TransformPhysicalPointToContinuousIndex<double>(outputpointvec[j]);
+      for (unsigned int i = 0; i < FixedImageDimension; ++i)
+      {
+        outputindexfixedvec[j][i] = static_cast<FixedImageIndexValueType>(itk::Math::Round<int64_t>(fixedcindex[i]));
+      }
 
-  if (const std::string outputDirectoryPath = configuration.GetCommandLineArgument("-out");
-      !outputDirectoryPath.empty())
-  {
-    /** Create filename and file stream. */
-    const std::string outputPointsFileName = outputDirectoryPath + "outputpoints.txt";
-    std::ofstream     outputPointsFile(outputPointsFileName);
-    outputPointsFile << std::showpoint << std::fixed;
-    log::info(std::ostringstream{} << "  The transformed points are saved in: " << outputPointsFileName);
+      if (alsoMovingIndices)
+      {
+        /** Transform back to index in moving image domain. */
+        const auto movingcindex =
+          movingImage->template TransformPhysicalPointToContinuousIndex<double>(outputpointvec[j]);
+        for (unsigned int i = 0; i < MovingImageDimension; ++i)
+        {
+          outputindexmovingvec[j][i] =
+            static_cast<MovingImageIndexValueType>(itk::Math::Round<int64_t>(movingcindex[i]));
+        }
+      }
 
-    const auto writeToFile = [&outputPointsFile](const auto & rangeOfElements) {
+      /** Compute displacement. */
+      deformationvec[j].CastFrom(outputpointvec[j] - inputpointvec[j]);
+    }
+  };
+
+  /** Formats the results of the points [begin, end) of the chunk as text, for the points with the number
+   * firstPointNumber + begin, and further. */
+  const auto formatPoints = [&](const unsigned long firstPointNumber,
+                                std::ostream &      outputStream,
+                                const std::size_t   begin,
+                                const std::size_t   end) {
+    const auto writeToFile = [&outputStream](const auto & rangeOfElements) {
       for (const auto element : rangeOfElements)
       {
-        outputPointsFile << element << ' ';
+        outputStream << element << ' ';
       }
     };
 
-    /** Print the results. */
-    for (unsigned int j = 0; j < nrofpoints; ++j)
+    for (std::size_t j = begin; j < end; ++j)
     {
       /** The input index. */
-      outputPointsFile << "Point\t" << j << "\t; InputIndex = [ ";
+      outputStream << "Point\t" << firstPointNumber + j << "\t; InputIndex = [ ";
       writeToFile(inputindexvec[j]);
 
       /** The input point. */
-      outputPointsFile << "]\t; InputPoint = [ ";
+      outputStream << "]\t; InputPoint = [ ";
       writeToFile(inputpointvec[j]);
 
       /** The output index in fixed image. */
-      outputPointsFile << "]\t; OutputIndexFixed = [ ";
+      outputStream << "]\t; OutputIndexFixed = [ ";
       writeToFile(outputindexfixedvec[j]);
 
       /** The output point. */
-      outputPointsFile << "]\t; OutputPoint = [ ";
+      outputStream << "]\t; OutputPoint = [ ";
       writeToFile(outputpointvec[j]);
 
       /** The output point minus the input point. */
-      outputPointsFile << "]\t; Deformation = [ ";
+      outputStream << "]\t; Deformation = [ ";
       writeToFile(deformationvec[j]);
 
       if (alsoMovingIndices)
       {
         /** The output index in moving image. */
-        outputPointsFile << "]\t; OutputIndexMoving = [ ";
+        outputStream << "]\t; OutputIndexMoving = [ ";
         writeToFile(outputindexmovingvec[j]);
       }
 
-      outputPointsFile << "]" << std::endl;
-    } // end for nrofpoints
+      outputStream << "]\n";
+    }
+  };
+
+  /** Writes the values of the first chunkSize elements to their position in the binary file. The columns of the
+   * file are stored one after the other, each having the specified dimension for each point. */
+  std::uint64_t columnOffset{};
+  const auto    writeColumn = [&](const auto &        elements,
+                               const unsigned int  dimension,
+                               const unsigned long chunkBegin,
+                               const std::size_t   chunkSize) {
+    using ElementValueType = std::remove_const_t<std::remove_reference_t<decltype(elements[0][0])>>;
+    using FileValueType = std::conditional_t<std::is_integral_v<ElementValueType>, std::int64_t, double>;
+
+    std::vector<FileValueType> values;
+    values.reserve(chunkSize * dimension);
+    for (std::size_t j = 0; j < chunkSize; ++j)
+    {
+      for (unsigned int i = 0; i < dimension; ++i)
+      {
+        values.push_back(static_cast<FileValueType>(elements[j][i]));
+      }
+    }
+    outputPointsFile.seekp(OutputPointsBinaryFileHeaderSize + columnOffset +
+                           std::uint64_t{ chunkBegin } * dimension * sizeof(FileValueType));
+    outputPointsFile.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(FileValueType));
+    columnOffset += std::uint64_t{ nrofpoints } * dimension * sizeof(FileValueType);
+  };
+
+  /** Read, transform, and write the points, chunk by chunk. */
+  log::info("  The input points are transformed.");
+  unsigned long chunkBegin = 0;
+  while (ippReader->ReadNextPoints(inputpointvec, chunkCapacity))
+  {
+    const std::size_t chunkSize = inputpointvec.size();
+    const bool        formatText = outputPointsFile.is_open() && !writeBinaryFile;
+
+    textPerWorkUnit.resize(std::max(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(), itk::ThreadIdType{ 1 }));
+    ForEachPointRange(chunkSize, [&](const unsigned int workUnit, const std::size_t begin, const std::size_t end) {
+      transformPoints(begin, end);
+      if (formatText)
+      {
+        std::ostringstream outputStream;
+        outputStream << std::showpoint << std::fixed;
+        formatPoints(chunkBegin, outputStream, begin, end);
+        textPerWorkUnit[workUnit] = outputStream.str();
+      }
+    });
+
+    if (formatText)
+    {
+      /** Write the text of the work units, in the order of their ranges. */
+      for (std::string & text : textPerWorkUnit)
+      {
+        outputPointsFile << text;
+        text.clear();
+      }
+    }
+    else if (writeBinaryFile && outputPointsFile.is_open())
+    {
+      /** The last chunk is not necessarily completely filled, so only the first chunkSize elements are written. */
+      columnOffset = 0;
+      writeColumn(inputindexvec, FixedImageDimension, chunkBegin, chunkSize);
+      writeColumn(inputpointvec, FixedImageDimension, chunkBegin, chunkSize);
+      writeColumn(outputindexfixedvec, FixedImageDimension, chunkBegin, chunkSize);
+      writeColumn(outputpointvec, FixedImageDimension, chunkBegin, chunkSize);
+      writeColumn(deformationvec, FixedImageDimension, chunkBegin, chunkSize);
+      if (alsoMovingIndices)
+      {
+        writeColumn(outputindexmovingvec, MovingImageDimension, chunkBegin, chunkSize);
+      }
+    }
+    chunkBegin += chunkSize;
+  }
+
+  if (outputPointsFile.is_open() && !outputPointsFile)
+  {
+    itkExceptionMacro("ERROR: Failed to write the transformed points!");
   }
 
 } // end TransformPointsSomePoints()
@@ -917,7 +1188,7 @@ TransformBase<TElastix>::TransformPointsSomePoints(const std::string & filename)
  * coordinates.
  *
  * Reads the inputmesh from a vtk file, assuming world coordinates.
- * Computes the transformed points, save as outputpoints.vtk.
+ * Computes the transformed points in parallel (by TransformMesh), save as outputpoints.vtk.
  */
 
 template <class TElastix>
@@ -1140,6 +1411,76 @@ TransformBase<TElastix>::ComputeSpatialJacobianMatrixImage() const -> typename S
   return infoChanger->GetOutput();
 }
 
+/**
+ * ************** ComputeSpatialJacobianDeterminantStatistics **********************
+ */
+
+template <class TElastix>
+ImageValueStatistics
+TransformBase<TElastix>::ComputeSpatialJacobianDeterminantStatistics() const
+{
+  const Configuration & configuration = Deref(Superclass::GetConfiguration());
+
+  const auto histogramMinimum =
+    configuration.RetrieveParameterValue(0.0, "SpatialJacobianDeterminantHistogramMinimum", 0, false);
+  const auto histogramMaximum =
+    configuration.RetrieveParameterValue(2.0, "SpatialJacobianDeterminantHistogramMaximum", 0, false);
+  const auto numberOfBins =
+    configuration.RetrieveParameterValue(20U, "SpatialJacobianDeterminantHistogramNumberOfBins", 0, false);
+  const auto numberOfStreamDivisions =
+    std::max(configuration.RetrieveParameterValue(1U, "NumberOfStreamDivisions", 0, false), 1U);
+
+  ImageValueStatistics statistics(histogramMinimum, histogramMaximum, numberOfBins);
+
+  /** No info changer, as the direction cosines do not affect the values of the determinant. */
+  const auto jacGenerator =
+    CreateJacobianSource<itk::TransformToDeterminantOfSpatialJacobianSource, SpatialJacobianDeterminantImageType>();
+  SpatialJacobianDeterminantImageType & jacImage = *(jacGenerator->GetOutput());
+  jacImage.UpdateOutputInformation();
+
+  /** Split the image into pieces along its slowest dimension, so that each piece is contiguous in memory. */
+  const auto largestRegion = jacImage.GetLargestPossibleRegion();
+  const auto splitter = itk::ImageRegionSplitterSlowDimension::New();
+  const auto numberOfPieces = splitter->GetNumberOfSplits(largestRegion, numberOfStreamDivisions);
+
+  /** Each work unit accumulates its own statistics, which are merged at the end. */
+  auto &                            threadPool = WorkStealingThreadPool::GetInstance();
+  const unsigned int                numberOfWorkUnits = threadPool.GetNumberOfThreads();
+  std::vector<ImageValueStatistics> workUnitStatistics(numberOfWorkUnits, statistics);
+
+  for (unsigned int piece = 0; piece < numberOfPieces; ++piece)
+  {
+    auto region = largestRegion;
+    splitter->GetSplit(piece, numberOfPieces, region);
+
+    /** Let the (multi-threaded) source generate only the values of this piece. */
+    jacImage.SetRequestedRegion(region);
+    jacImage.PropagateRequestedRegion();
+    jacImage.UpdateOutputData();
+
+    const float * const      values = jacImage.GetBufferPointer() + jacImage.ComputeOffset(region.GetIndex());
+    const itk::SizeValueType numberOfValues = region.GetNumberOfPixels();
+    const itk::SizeValueType valuesPerWorkUnit = (numberOfValues + numberOfWorkUnits - 1) / numberOfWorkUnits;
+
+    threadPool.ForkJoin(numberOfWorkUnits, [&](const unsigned int workUnit) {
+      const itk::SizeValueType begin = std::min(workUnit * valuesPerWorkUnit, numberOfValues);
+      const itk::SizeValueType end = std::min(begin + valuesPerWorkUnit, numberOfValues);
+      for (itk::SizeValueType i = begin; i < end; ++i)
+      {
+        workUnitStatistics[workUnit].Add(values[i]);
+      }
+    });
+  }
+
+  for (const auto & statisticsOfWorkUnit : workUnitStatistics)
+  {
+    statistics.Merge(statisticsOfWorkUnit);
+  }
+  return statistics;
+
+} // end ComputeSpatialJacobianDeterminantStatistics()
+
+
 /**
  * ************** ComputeAndWriteSpatialJacobianDeterminantImage **********************
  */
@@ -1159,14 +1500,38 @@ TransformBase<TElastix>::ComputeAndWriteSpatialJacobianDeterminantImage() const
     log::info(std::ostringstream{} << "  The command-line option \"-jac\" is not used, so no det(dT/dx) computed.");
     return;
   }
-  else if (jac != "all")
+  else if (jac != "all" && jac != "stats")
   {
-    log::info(std::ostringstream{} << "  WARNING: The command-line option \"-jac\" should be used as \"-jac all\",\n"
-                                   << "    but is specified as \"-jac " << jac << "\"\n"
+    log::info(std::ostringstream{} << "  WARNING: The command-line option \"-jac\" should be used as \"-jac all\"\n"
+                                   << "    or \"-jac stats\", but is specified as \"-jac " << jac << "\"\n"
                                    << "    Therefore det(dT/dx) is not computed.");
     return;
   }
 
+  const std::string outputDirectoryPath = configuration.GetCommandLineArgument("-out");
+
+  if (jac == "stats")
+  {
+    log::info("  Computing the statistics of the spatial Jacobian determinant...");
+    const auto statistics = this->ComputeSpatialJacobianDeterminantStatistics();
+
+    std::ostringstream summary;
+    statistics.Print(summary);
+    log::info(summary.str());
+
+    if (!outputDirectoryPath.empty())
+    {
+      const std::string fileName = outputDirectoryPath + "spatialJacobianStatistics.txt";
+      std::ofstream     outputFile(fileName);
+      if (!outputFile)
+      {
+        itkExceptionMacro("Could not open \"" << fileName << "\" for writing.");
+      }
+      outputFile << summary.str();
+    }
+    return;
+  }
+
   const auto jacGenerator =
     CreateJacobianSource<itk::TransformToDeterminantOfSpatialJacobianSource, SpatialJacobianDeterminantImageType>();
   const auto infoChanger = CreateChangeInformationImageFilter(jacGenerator->GetOutput());
@@ -1178,17 +1543,22 @@ TransformBase<TElastix>::ComputeAndWriteSpatialJacobianDeterminantImage() const
   std::string resultImageFormat = "mhd";
   configuration.ReadParameter(resultImageFormat, "ResultImageFormat", 0, false);
 
-  if (const std::string outputDirectoryPath = configuration.GetCommandLineArgument("-out");
-      !outputDirectoryPath.empty())
+  if (!outputDirectoryPath.empty())
   {
     std::ostringstream makeFileName;
     makeFileName << outputDirectoryPath << "spatialJacobian." << resultImageFormat;
 
-    /** Write outputImage to disk. */
+    /** Write outputImage to disk, piece by piece. */
+    const auto jacWriter = itk::ImageFileWriter<SpatialJacobianDeterminantImageType>::New();
+    jacWriter->SetInput(infoChanger->GetOutput());
+    jacWriter->SetFileName(makeFileName.str());
+    jacWriter->SetNumberOfStreamDivisions(
+      std::max(configuration.RetrieveParameterValue(1U, "NumberOfStreamDivisions", 0, false), 1U));
+
     log::info("  Computing and writing the spatial Jacobian determinant...");
     try
     {
-      itk::WriteImage(infoChanger->GetOutput(), makeFileName.str());
+      jacWriter->Update();
     }
     catch (itk::ExceptionObject & excp)
     {
@@ -1243,56 +1613,27 @@ TransformBase<TElastix>::ComputeAndWriteSpatialJacobianMatrixImage() const
     std::ostringstream makeFileName;
     makeFileName << outputDirectoryPath << "fullSpatialJacobian." << resultImageFormat;
 
-    /** Write outputImage to disk. */
-    const auto jacWriter = itk::ImageFileWriter<SpatialJacobianMatrixImageType>::New();
-    jacWriter->SetInput(infoChanger->GetOutput());
+    /** Convert each matrix to a vector of its elements (row by row, as they are stored in the matrix), because most
+     * IO classes understand vector images, but not matrix images. The file contents are the same as before. */
+    constexpr unsigned int numberOfElements = MovingImageDimension * FixedImageDimension;
+    using MatrixType = typename SpatialJacobianMatrixImageType::PixelType;
+    using VectorImageType = itk::Image<itk::Vector<float, numberOfElements>, FixedImageDimension>;
+
+    const auto matrixToVectorFilter =
+      itk::UnaryGeneratorImageFilter<SpatialJacobianMatrixImageType, VectorImageType>::New();
+    matrixToVectorFilter->SetFunctor([](const MatrixType & matrix) {
+      typename VectorImageType::PixelType vector;
+      std::copy_n(matrix.GetVnlMatrix().data_block(), numberOfElements, vector.begin());
+      return vector;
+    });
+    matrixToVectorFilter->SetInput(infoChanger->GetOutput());
+
+    /** Write outputImage to disk, piece by piece. */
+    const auto jacWriter = itk::ImageFileWriter<VectorImageType>::New();
+    jacWriter->SetInput(matrixToVectorFilter->GetOutput());
     jacWriter->SetFileName(makeFileName.str());
-
-    // This class is used for writing the fullSpatialJacobian image. It is a hack to ensure that a matrix image is seen
-    // as a vector image, which most IO classes understand.
-    class PixelTypeChangeCommand : public itk::Command
-    {
-    public:
-      ITK_DISALLOW_COPY_AND_MOVE(PixelTypeChangeCommand);
-
-      /** Standard class typedefs. */
-      using Self = PixelTypeChangeCommand;
-      using Pointer = itk::SmartPointer<Self>;
-
-      /** Run-time type information (and related methods). */
-      itkTypeMacro(PixelTypeChangeCommand, Command);
-
-      /** Method for creation through the object factory. */
-      itkNewMacro(Self);
-
-    private:
-      using PrivateJacobianImageType = SpatialJacobianMatrixImageType;
-
-      /** Set the pixel type to VECTOR */
-      void
-      Execute(itk::Object * caller, const itk::EventObject &) override
-      {
-        const auto castcaller = dynamic_cast<itk::ImageFileWriter<PrivateJacobianImageType> *>(caller);
-        castcaller->GetModifiableImageIO()->SetPixelType(itk::CommonEnums::IOPixel::VECTOR);
-      }
-
-      void
-      Execute(const itk::Object * caller, const itk::EventObject & eventObject) override
-      {
-        // Call the non-const overload.
-        Self::Execute(const_cast<itk::Object *>(caller), eventObject);
-      }
-
-      PixelTypeChangeCommand() = default;
-      ~PixelTypeChangeCommand() override = default;
-    };
-
-    /** Hack to change the pixel type to vector. Not necessary for mhd. */
-    const auto jacStartWriteCommand = PixelTypeChangeCommand::New();
-    if (resultImageFormat != "mhd")
-    {
-      jacWriter->AddObserver(itk::StartEvent(), jacStartWriteCommand);
-    }
+    jacWriter->SetNumberOfStreamDivisions(
+      std::max(configuration.RetrieveParameterValue(1U, "NumberOfStreamDivisions", 0, false), 1U));
 
     /** Do the writing. */
     log::info("  Computing and writing the spatial Jacobian...");
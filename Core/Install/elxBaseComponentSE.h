@@ -20,6 +20,7 @@
 
 #include "elxBaseComponent.h"
 #include "elxConfiguration.h"
+#include "elxFixedImagePreprocessingCache.h"
 
 // ITK header files:
 #include <itkMacro.h> // For ITK_DISALLOW_COPY_AND_MOVE.
@@ -129,6 +130,18 @@ public:
     return this->m_Registration;
   }
 
+  /** Get the cache of fixed image preprocessing results, which is shared with other registrations to the same
+   * fixed image. Returns null when there is no such cache.
+   */
+  FixedImagePreprocessingCache *
+  GetFixedImagePreprocessingCache() const;
+
+  /** Returns the key under which this component stores the specified preprocessing result in the cache. The key
+   * identifies the elastix level (the index of the parameter map), the component, and the result.
+   */
+  std::string
+  GetFixedImagePreprocessingCacheKey(const std::string & resultName) const;
+
 
 protected:
   BaseComponentSE() = default;
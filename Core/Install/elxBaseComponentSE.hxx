@@ -69,6 +69,33 @@ BaseComponentSE<TElastix>::SetConfiguration(const Configuration * const _arg)
 } // end SetConfiguration
 
 
+/**
+ * *********************** GetFixedImagePreprocessingCache ***************************
+ */
+
+template <class TElastix>
+FixedImagePreprocessingCache *
+BaseComponentSE<TElastix>::GetFixedImagePreprocessingCache() const
+{
+  return (this->m_Elastix == nullptr) ? nullptr : this->m_Elastix->GetFixedImagePreprocessingCache();
+
+} // end GetFixedImagePreprocessingCache()
+
+
+/**
+ * *********************** GetFixedImagePreprocessingCacheKey ***************************
+ */
+
+template <class TElastix>
+std::string
+BaseComponentSE<TElastix>::GetFixedImagePreprocessingCacheKey(const std::string & resultName) const
+{
+  return std::to_string(this->m_Configuration->GetElastixLevel()) + '/' + this->GetComponentLabel() + '/' +
+         resultName;
+
+} // end GetFixedImagePreprocessingCacheKey()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxBaseComponentSE_hxx
@@ -0,0 +1,126 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "elxMemoryMappedFile.h"
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace elastix
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+MemoryMappedFile::MemoryMappedFile(const std::string & fileName)
+{
+#ifdef _WIN32
+  const HANDLE fileHandle = ::CreateFileA(
+    fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+  if (fileHandle == INVALID_HANDLE_VALUE)
+  {
+    itkGenericExceptionMacro("Failed to open \"" << fileName << "\" for memory mapping.");
+  }
+
+  LARGE_INTEGER fileSize;
+  if (::GetFileSizeEx(fileHandle, &fileSize) == 0)
+  {
+    ::CloseHandle(fileHandle);
+    itkGenericExceptionMacro("Failed to retrieve the size of \"" << fileName << "\".");
+  }
+  m_Size = static_cast<std::size_t>(fileSize.QuadPart);
+
+  if (m_Size > 0)
+  {
+    /** The mapping object and the file handle may be closed once the view is mapped. */
+    const HANDLE mappingHandle = ::CreateFileMappingA(fileHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    ::CloseHandle(fileHandle);
+
+    if (mappingHandle == nullptr)
+    {
+      itkGenericExceptionMacro("Failed to create a file mapping of \"" << fileName << "\".");
+    }
+    m_Data = ::MapViewOfFile(mappingHandle, FILE_MAP_COPY, 0, 0, 0);
+    ::CloseHandle(mappingHandle);
+  }
+  else
+  {
+    ::CloseHandle(fileHandle);
+  }
+#else
+  const int fileDescriptor = ::open(fileName.c_str(), O_RDONLY);
+
+  if (fileDescriptor < 0)
+  {
+    itkGenericExceptionMacro("Failed to open \"" << fileName << "\" for memory mapping.");
+  }
+
+  struct stat fileStatus;
+  if (::fstat(fileDescriptor, &fileStatus) != 0)
+  {
+    ::close(fileDescriptor);
+    itkGenericExceptionMacro("Failed to retrieve the size of \"" << fileName << "\".");
+  }
+  m_Size = static_cast<std::size_t>(fileStatus.st_size);
+
+  if (m_Size > 0)
+  {
+    /** A private mapping is copy-on-write, so the file itself is never modified. */
+    void * const data = ::mmap(nullptr, m_Size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0);
+    m_Data = (data == MAP_FAILED) ? nullptr : data;
+  }
+  ::close(fileDescriptor);
+#endif
+
+  if ((m_Size > 0) && (m_Data == nullptr))
+  {
+    itkGenericExceptionMacro("Failed to memory map \"" << fileName << "\".");
+  }
+
+} // end Constructor
+
+
+/**
+ * ********************* Destructor ****************************
+ */
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+  if (m_Data != nullptr)
+  {
+#ifdef _WIN32
+    ::UnmapViewOfFile(m_Data);
+#else
+    ::munmap(m_Data, m_Size);
+#endif
+  }
+
+} // end Destructor
+
+} // end namespace elastix
@@ -0,0 +1,69 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxMemoryMappedFile_h
+#define elxMemoryMappedFile_h
+
+#include <itkMacro.h> // For ITK_DISALLOW_COPY_AND_MOVE.
+
+#include <cstddef> // For size_t.
+#include <string>
+
+namespace elastix
+{
+/**
+ * \class MemoryMappedFile
+ *
+ * \brief Maps the contents of a file into memory, for as long as the object exists.
+ *
+ * The file is opened read-only, and mapped copy-on-write: the mapped data may be modified
+ * in memory, but such modifications are private to the process, and never written back to
+ * the file. The constructor throws an itk::ExceptionObject when the file cannot be mapped.
+ */
+class MemoryMappedFile
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(MemoryMappedFile);
+
+  /** Maps the file with the specified name. */
+  explicit MemoryMappedFile(const std::string & fileName);
+
+  /** Unmaps the file. */
+  ~MemoryMappedFile();
+
+  /** The address of the first byte of the mapped file. */
+  void *
+  GetData() const
+  {
+    return m_Data;
+  }
+
+  /** The number of bytes of the mapped file. */
+  std::size_t
+  GetSize() const
+  {
+    return m_Size;
+  }
+
+private:
+  void *      m_Data{ nullptr };
+  std::size_t m_Size{ 0 };
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef elxMemoryMappedFile_h
@@ -18,8 +18,11 @@
 #include "elxElastixBase.h"
 #include <Core/elxVersionMacros.h>
 #include "elxConversion.h"
+#include "elxWorkStealingThreadPool.h"
+#include <algorithm> // For min and max.
+#include <atomic>
+#include <exception>
 #include <sstream>
-#include "itkMersenneTwisterRandomVariateGenerator.h"
 
 namespace elastix
 {
@@ -149,6 +152,48 @@ ElastixBase::GenerateDataObjectContainer(DataObjectPointer dataObject)
 }
 
 
+/**
+ * ********************* ExecuteImageReadTasks ***********************
+ */
+
+void
+ElastixBase::ExecuteImageReadTasks(const std::vector<ImageReadTaskType> & tasks,
+                                   const unsigned int                     maximumNumberOfConcurrentReads)
+{
+  const std::size_t  numberOfTasks = tasks.size();
+  const unsigned int numberOfWorkUnits =
+    static_cast<unsigned int>(std::min<std::size_t>(numberOfTasks, std::max(maximumNumberOfConcurrentReads, 1U)));
+
+  /** Each work unit executes the next task that is not yet started, until all tasks are started. */
+  std::vector<std::exception_ptr> exceptions(numberOfTasks);
+  std::atomic<std::size_t>        nextTaskIndex{ 0 };
+
+  WorkStealingThreadPool::GetInstance().ForkJoin(numberOfWorkUnits, [&](unsigned int) {
+    for (std::size_t taskIndex = nextTaskIndex++; taskIndex < numberOfTasks; taskIndex = nextTaskIndex++)
+    {
+      try
+      {
+        tasks[taskIndex]();
+      }
+      catch (...)
+      {
+        exceptions[taskIndex] = std::current_exception();
+      }
+    }
+  });
+
+  /** Rethrow the exception of the first task that failed, like a serial loop over the tasks would. */
+  for (const auto & exception : exceptions)
+  {
+    if (exception != nullptr)
+    {
+      std::rethrow_exception(exception);
+    }
+  }
+
+} // end ExecuteImageReadTasks()
+
+
 /**
  * ********************* SetDBIndex ***********************
  */
@@ -281,16 +326,14 @@ ElastixBase::BeforeAllBase()
                            << "This may change the behavior of your registrations considerably.\n");
   }
 
-  /** Set the random seed. Use 121212 as a default, which is the same as
-   * the default in the MersenneTwister code.
+  /** Set the random seed of the random generator of this registration. Use 121212 as a default, which is
+   * the same as the default in the MersenneTwister code.
    * Use silent parameter file readout, to avoid annoying warning when
    * starting elastix */
-  using RandomGeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
-  using SeedType = RandomGeneratorType::IntegerType;
+  using SeedType = RandomGenerator::GeneratorType::IntegerType;
   unsigned int randomSeed = 121212;
   m_Configuration->ReadParameter(randomSeed, "RandomSeed", 0, false);
-  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
-  randomGenerator->SetSeed(static_cast<SeedType>(randomSeed));
+  m_RandomGenerator->SetSeed(static_cast<SeedType>(randomSeed));
 
   /** Return a value. */
   return returndummy;
@@ -31,12 +31,14 @@
 #include "elxBaseComponent.h"
 #include "elxComponentDatabase.h"
 #include "elxConfiguration.h"
+#include "elxFixedImagePreprocessingCache.h"
 #include "elxIterationInfo.h"
 #include "elxMacro.h"
+#include "elxProfiler.h"
+#include "elxRandomGenerator.h"
 #include "elxlog.h"
 
 // ITK header files:
-#include <itkChangeInformationImageFilter.h>
 #include <itkDataObject.h>
 #include <itkImageFileReader.h>
 #include <itkObject.h>
@@ -44,6 +46,7 @@
 #include <itkVectorContainer.h>
 
 #include <fstream>
+#include <functional>
 #include <iomanip>
 
 /** Like itkGet/SetObjectMacro, but in these macros the itkDebugMacro is
@@ -293,6 +296,12 @@ public:
   elxSetObjectMacro(FinalTransform, itk::Object);
   elxGetObjectMacro(FinalTransform, itk::Object);
 
+  /** Set/Get the cache of fixed image preprocessing results, which is shared with other registrations to the
+   * same fixed image. Null by default, in which case the components do their preprocessing themselves.
+   */
+  elxSetObjectMacro(FixedImagePreprocessingCache, FixedImagePreprocessingCache);
+  elxGetObjectMacro(FixedImagePreprocessingCache, FixedImagePreprocessingCache);
+
   /** Empty Run()-function to be overridden. */
   virtual int
   Run() = 0;
@@ -371,6 +380,23 @@ public:
     return m_IterationInfo;
   }
 
+  /** Returns the profiler of this registration. Its measurements are only recorded while it is the current
+   * profiler of the registration thread, see Profiler::Scope. */
+  Profiler &
+  GetProfiler()
+  {
+    return m_Profiler;
+  }
+
+  /** Returns the random generator of this registration, which is seeded by its RandomSeed parameter. The
+   * components draw their random numbers from it while it is the current random generator of the
+   * registration thread, see RandomGenerator::Scope. */
+  RandomGenerator::GeneratorType &
+  GetRandomGenerator()
+  {
+    return *m_RandomGenerator;
+  }
+
   std::ostream &
   GetIterationInfoAt(const char * const name)
   {
@@ -407,6 +433,9 @@ protected:
 
   std::ofstream m_IterationInfoFile;
 
+  /** A function that reads one image, and stores it in an image container. */
+  using ImageReadTaskType = std::function<void()>;
+
   /** Convenient mini class to load the files specified by a filename container
    * The function GenerateImageContainer can be used without instantiating an
    * object of this class, since it is static. It has 2 arguments: the
@@ -418,6 +447,10 @@ protected:
    * The useDirection option is built in as a means to ignore the direction
    * cosines. Set it to false to force the direction cosines to identity.
    * The original direction cosines are returned separately.
+   *
+   * The function PrepareImageContainer does not load the images itself, but
+   * appends a read task for each image, so that the images of different
+   * containers can be loaded concurrently, by ExecuteImageReadTasks.
    */
   template <class TImage>
   class ITK_TEMPLATE_EXPORT MultipleImageLoader
@@ -425,6 +458,43 @@ protected:
   public:
     using DirectionType = typename TImage::DirectionType;
 
+    /** Reads the specified image. Sets its direction cosines to identity in place, when useDirectionCosines is
+     * false, without an extra copy of the image. */
+    static itk::SmartPointer<TImage>
+    ReadImage(const std::string & fileName,
+              const std::string & imageDescription,
+              bool                useDirectionCosines,
+              DirectionType *     originalDirectionCosines = nullptr)
+    {
+      try
+      {
+        const auto image = itk::ReadImage<TImage>(fileName);
+
+        /** Store the original direction cosines */
+        if (originalDirectionCosines != nullptr)
+        {
+          *originalDirectionCosines = image->GetDirection();
+        }
+        if (!useDirectionCosines)
+        {
+          image->SetDirection(DirectionType::GetIdentity());
+        }
+        return image;
+      }
+      catch (itk::ExceptionObject & excp)
+      {
+        /** Add information to the exception. */
+        std::string err_str = excp.GetDescription();
+        err_str += "\nError occurred while reading the image described as " + imageDescription + ", with file name " +
+                   fileName + "\n";
+        excp.SetDescription(err_str);
+        /** Pass the exception to the caller of this function. */
+        throw;
+      }
+
+    } // end static method ReadImage
+
+
     static DataObjectContainerPointer
     GenerateImageContainer(const FileNameContainerType * const fileNameContainer,
                            const std::string &                 imageDescription,
@@ -436,36 +506,8 @@ protected:
       /** Loop over all image filenames. */
       for (const auto & fileName : *fileNameContainer)
       {
-        const auto infoChanger = itk::ChangeInformationImageFilter<TImage>::New();
-        infoChanger->SetChangeDirection(!useDirectionCosines);
-
-        /** Do the reading. */
-        try
-        {
-          const auto image = itk::ReadImage<TImage>(fileName);
-          infoChanger->SetInput(image);
-          infoChanger->Update();
-
-          /** Store the original direction cosines */
-          if (originalDirectionCosines != nullptr)
-          {
-            *originalDirectionCosines = image->GetDirection();
-          }
-        }
-        catch (itk::ExceptionObject & excp)
-        {
-          /** Add information to the exception. */
-          std::string err_str = excp.GetDescription();
-          err_str += "\nError occurred while reading the image described as " + imageDescription + ", with file name " +
-                     fileName + "\n";
-          excp.SetDescription(err_str);
-          /** Pass the exception to the caller of this function. */
-          throw;
-        }
-
         /** Store loaded image in the image container, as a DataObjectPointer. */
-        imageContainer->push_back(infoChanger->GetOutput());
-
+        imageContainer->push_back(ReadImage(fileName, imageDescription, useDirectionCosines, originalDirectionCosines));
 
       } // end for
 
@@ -474,6 +516,39 @@ protected:
     } // end static method GenerateImageContainer
 
 
+    /** Returns an image container with an empty element for each file name, and appends a task to the specified
+     * tasks for each file name, which loads the image into its element of the container. Like for
+     * GenerateImageContainer, the original direction cosines are those of the last image.
+     */
+    static DataObjectContainerPointer
+    PrepareImageContainer(const FileNameContainerType * const fileNameContainer,
+                          const std::string &                 imageDescription,
+                          bool                                useDirectionCosines,
+                          std::vector<ImageReadTaskType> &    tasks,
+                          DirectionType *                     originalDirectionCosines = nullptr)
+    {
+      const auto imageContainer = DataObjectContainerType::New();
+      const auto numberOfImages = static_cast<unsigned int>(fileNameContainer->size());
+      imageContainer->CastToSTLContainer().resize(numberOfImages);
+
+      for (unsigned int i = 0; i < numberOfImages; ++i)
+      {
+        /** Each task only writes its own element of the container. */
+        tasks.push_back([imageContainer,
+                         i,
+                         fileName = fileNameContainer->ElementAt(i),
+                         imageDescription,
+                         useDirectionCosines,
+                         direction = (i + 1 == numberOfImages) ? originalDirectionCosines : nullptr] {
+          imageContainer->CastToSTLContainer()[i] =
+            ReadImage(fileName, imageDescription, useDirectionCosines, direction);
+        });
+      }
+      return imageContainer;
+
+    } // end static method PrepareImageContainer
+
+
     MultipleImageLoader() = default;
     ~MultipleImageLoader() = default;
   };
@@ -482,6 +557,12 @@ protected:
   static DataObjectContainerPointer
   GenerateDataObjectContainer(DataObjectPointer dataObject);
 
+  /** Executes the specified image read tasks, with at most the specified number of concurrent reads. Rethrows the
+   * exception of the first task that failed, after all tasks are finished. */
+  static void
+  ExecuteImageReadTasks(const std::vector<ImageReadTaskType> & tasks,
+                        const unsigned int                     maximumNumberOfConcurrentReads);
+
 private:
   Configuration::Pointer m_Configuration{ nullptr };
 
@@ -490,6 +571,12 @@ private:
 
   IterationInfo m_IterationInfo;
 
+  /** The profiler of this registration, used when WriteProfile is "true". */
+  Profiler m_Profiler{};
+
+  /** The random generator of this registration. */
+  const RandomGenerator::GeneratorType::Pointer m_RandomGenerator{ RandomGenerator::GeneratorType::New() };
+
   /** The component containers. These containers contain
    * SmartPointer's to itk::Object.
    */
@@ -526,6 +613,9 @@ private:
   ObjectPointer m_InitialTransform{ nullptr };
   ObjectPointer m_FinalTransform{ nullptr };
 
+  /** The cache of fixed image preprocessing results, shared with other registrations. */
+  FixedImagePreprocessingCache::Pointer m_FixedImagePreprocessingCache{ nullptr };
+
   /** Use or ignore direction cosines.
    * From Elastix 4.3 to 4.7: Ignore direction cosines by default, for
    * backward compatability. From Elastix 4.8: set it to true by default. */
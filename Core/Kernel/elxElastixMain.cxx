@@ -104,6 +104,9 @@ ElastixMain::Run()
 #endif
   auto & elastixBase = this->GetElastixBase();
 
+  /** Let the components of this registration use its own random generator, from their construction on. */
+  const RandomGenerator::Scope randomGeneratorScope(&elastixBase.GetRandomGenerator());
+
   /** Set some information in the ElastixBase. */
   elastixBase.SetConfiguration(MainBase::GetConfiguration());
   elastixBase.SetTransformConfigurations(this->m_TransformConfigurations);
@@ -156,6 +159,9 @@ ElastixMain::Run()
   /** Set the initial transform, if it happens to be there. */
   elastixBase.SetInitialTransform(this->GetModifiableInitialTransform());
 
+  /** Share the fixed image preprocessing results with other registrations, if there is a cache. */
+  elastixBase.SetFixedImagePreprocessingCache(this->GetModifiableFixedImagePreprocessingCache());
+
   /** Set the original fixed image direction cosines (relevant in case the
    * UseDirectionCosines parameter was set to false.
    */
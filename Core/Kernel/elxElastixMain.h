@@ -112,6 +112,12 @@ public:
   itkSetObjectMacro(InitialTransform, itk::Object);
   itkGetModifiableObjectMacro(InitialTransform, itk::Object);
 
+  /** Set/Get the cache of fixed image preprocessing results, which is shared with other registrations to the
+   * same fixed image, with the same parameters. Null by default.
+   */
+  itkSetObjectMacro(FixedImagePreprocessingCache, FixedImagePreprocessingCache);
+  itkGetModifiableObjectMacro(FixedImagePreprocessingCache, FixedImagePreprocessingCache);
+
   /** Set/Get the original fixed image direction as a flat array
    * (d11 d21 d31 d21 d22 etc ) */
   virtual void
@@ -169,6 +175,9 @@ protected:
   /** The initial transform. */
   ObjectPointer m_InitialTransform{ nullptr };
 
+  /** The cache of fixed image preprocessing results, shared with other registrations. */
+  FixedImagePreprocessingCache::Pointer m_FixedImagePreprocessingCache{ nullptr };
+
   /** Transformation parameters map containing parameters that is the
    *  result of registration.
    */
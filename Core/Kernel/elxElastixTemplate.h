@@ -83,6 +83,19 @@ namespace elastix
  *    example: <tt>(WriteTransformParametersEachResolution "true")</tt>\n
  *    This parameter can not be specified for each resolution separately.
  *    Default value: "false".
+ * \parameter WriteProfile: Controls whether to measure the time spent in the hot paths of
+ *    the registration (image reading, sampler updates, threaded metric evaluation, optimizer
+ *    steps, iterations, resolutions), and save these measurements as JSON to the file
+ *    "elastix_profile.<ElastixLevel>.json" (like "elastix_profile.0.json") in the output directory.\n
+ *    example: <tt>(WriteProfile "true")</tt>\n
+ *    This parameter can not be specified for each resolution separately.
+ *    Default value: "false".
+ * \parameter MaximumNumberOfConcurrentImageReads: The maximum number of images and masks that are
+ *    read (and decompressed) at the same time, at the start of the registration. Specify 1 to read
+ *    them one after another, for example to limit the memory usage of the readers.\n
+ *    example: <tt>(MaximumNumberOfConcurrentImageReads 4)</tt>\n
+ *    This parameter can not be specified for each resolution separately.
+ *    Default value: the number of threads of elastix.
  * \parameter UseDirectionCosines: Controls whether to use or ignore the
  * direction cosines (world matrix, transform matrix) set in the images.
  * Voxel spacing and image origin are always taken into account, regardless
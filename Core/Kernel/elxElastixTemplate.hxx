@@ -20,6 +20,8 @@
 
 #  include "elxElastixTemplate.h"
 #  include "elxDeref.h"
+#  include "elxProfiler.h"
+#  include "elxWorkStealingThreadPool.h"
 
 #  define elxCheckAndSetComponentMacro(_name)                                                                          \
     _name##BaseType * base = this->GetElx##_name##Base(i);                                                             \
@@ -149,18 +151,34 @@ ElastixTemplate<TFixedImage, TMovingImage>::Run()
                                                                this->m_AfterEachIterationCommand);
   this->GetElxOptimizerBase()->GetAsITKBaseType()->AddObserver(itk::EndEvent(), this->m_AfterEachResolutionCommand);
 
+  /** Record the measurements of this registration in its own profiler, when requested. Otherwise, make sure that
+   * they are not recorded in the profiler of any enclosing registration. */
+  bool writeProfile = false;
+  Deref(ElastixBase::GetConfiguration()).ReadParameter(writeProfile, "WriteProfile", 0, false);
+  if (writeProfile)
+  {
+    ElastixBase::GetProfiler().Reset();
+  }
+  const Profiler::Scope profilerScope(writeProfile ? &ElastixBase::GetProfiler() : nullptr);
+
   /** Start the timer for reading images. */
   this->m_Timer0.Start();
   log::info("\nReading images...");
 
-  /** Read images and masks, if not set already. */
-  const bool              useDirCos = this->GetUseDirectionCosines();
-  FixedImageDirectionType fixDirCos;
-  if (this->GetFixedImage() == nullptr)
+  /** Read images and masks, if not set already. All of them are read concurrently, by at most
+   * MaximumNumberOfConcurrentImageReads threads. */
+  unsigned int maximumNumberOfConcurrentImageReads = WorkStealingThreadPool::GetInstance().GetNumberOfThreads();
+  Deref(ElastixBase::GetConfiguration())
+    .ReadParameter(maximumNumberOfConcurrentImageReads, "MaximumNumberOfConcurrentImageReads", 0, false);
+
+  std::vector<ImageReadTaskType> imageReadTasks;
+  const bool                     useDirCos = this->GetUseDirectionCosines();
+  FixedImageDirectionType        fixDirCos;
+  const bool                     readFixedImages = this->GetFixedImage() == nullptr;
+  if (readFixedImages)
   {
-    this->SetFixedImageContainer(MultipleImageLoader<FixedImageType>::GenerateImageContainer(
-      this->GetFixedImageFileNameContainer(), "Fixed Image", useDirCos, &fixDirCos));
-    this->SetOriginalFixedImageDirection(fixDirCos);
+    this->SetFixedImageContainer(MultipleImageLoader<FixedImageType>::PrepareImageContainer(
+      this->GetFixedImageFileNameContainer(), "Fixed Image", useDirCos, imageReadTasks, &fixDirCos));
   }
   else
   {
@@ -177,22 +195,30 @@ ElastixTemplate<TFixedImage, TMovingImage>::Run()
 
   if (this->GetMovingImage() == nullptr)
   {
-    this->SetMovingImageContainer(MultipleImageLoader<MovingImageType>::GenerateImageContainer(
-      this->GetMovingImageFileNameContainer(), "Moving Image", useDirCos));
+    this->SetMovingImageContainer(MultipleImageLoader<MovingImageType>::PrepareImageContainer(
+      this->GetMovingImageFileNameContainer(), "Moving Image", useDirCos, imageReadTasks));
   }
   if (this->GetFixedMask() == nullptr)
   {
-    this->SetFixedMaskContainer(MultipleImageLoader<FixedMaskType>::GenerateImageContainer(
-      this->GetFixedMaskFileNameContainer(), "Fixed Mask", useDirCos));
+    this->SetFixedMaskContainer(MultipleImageLoader<FixedMaskType>::PrepareImageContainer(
+      this->GetFixedMaskFileNameContainer(), "Fixed Mask", useDirCos, imageReadTasks));
   }
   if (this->GetMovingMask() == nullptr)
   {
-    this->SetMovingMaskContainer(MultipleImageLoader<MovingMaskType>::GenerateImageContainer(
-      this->GetMovingMaskFileNameContainer(), "Moving Mask", useDirCos));
+    this->SetMovingMaskContainer(MultipleImageLoader<MovingMaskType>::PrepareImageContainer(
+      this->GetMovingMaskFileNameContainer(), "Moving Mask", useDirCos, imageReadTasks));
+  }
+
+  ExecuteImageReadTasks(imageReadTasks, maximumNumberOfConcurrentImageReads);
+
+  if (readFixedImages)
+  {
+    this->SetOriginalFixedImageDirection(fixDirCos);
   }
 
   /** Print the time spent on reading images. */
   this->m_Timer0.Stop();
+  Profiler::AddTime("ImageIO::ReadImages", this->m_Timer0.GetMean());
   log::info(std::ostringstream{} << "Reading images took "
                                  << static_cast<unsigned long>(this->m_Timer0.GetMean() * 1000) << " ms.\n");
 
@@ -539,6 +565,9 @@ ElastixTemplate<TFixedImage, TMovingImage>::BeforeEachResolution()
   /** Reset the this->m_IterationCounter. */
   this->m_IterationCounter = 0;
 
+  /** Assign the subsequent measurements of the profiler to this resolution. */
+  Profiler::SetCurrentResolution(level);
+
   /** Print the current resolution. */
   log::info(std::ostringstream{} << "\nResolution: " << level);
 
@@ -590,6 +619,7 @@ ElastixTemplate<TFixedImage, TMovingImage>::AfterEachResolution()
   this->m_ResolutionTimer.Stop();
   log::info(std::ostringstream{} << std::setprecision(3) << "Time spent in resolution " << (level)
                                  << " (ITK initialization and iterating): " << this->m_ResolutionTimer.GetMean());
+  Profiler::AddTime("Registration::Resolution", this->m_ResolutionTimer.GetMean());
 
   /** Call all the AfterEachResolution() functions. */
   this->AfterEachResolutionBase();
@@ -652,6 +682,7 @@ ElastixTemplate<TFixedImage, TMovingImage>::AfterEachIteration()
   /** Time in this iteration. */
   this->m_IterationTimer.Stop();
   this->GetIterationInfoAt("Time[ms]") << this->m_IterationTimer.GetMean() * 1000.0;
+  Profiler::AddTime("Registration::Iteration", this->m_IterationTimer.GetMean());
 
   /** Write the iteration info of this iteration. */
   this->GetIterationInfo().WriteBufferedData();
@@ -760,6 +791,26 @@ ElastixTemplate<TFixedImage, TMovingImage>::AfterRegistration()
   this->m_Timer0.Stop();
   log::info(std::ostringstream{} << "Time spent on saving the results, applying the final transform etc.: "
                                  << static_cast<unsigned long>(this->m_Timer0.GetMean() * 1000) << " ms.");
+  Profiler::SetCurrentResolution(Profiler::NoResolution);
+  Profiler::AddTime("Registration::AfterRegistration", this->m_Timer0.GetMean());
+
+  /** Write the profile, when the profiler was enabled for this registration. */
+  if (Profiler::GetCurrent() == &ElastixBase::GetProfiler())
+  {
+    if (!outputDirectoryPath.empty())
+    {
+      const std::string profileFileName =
+        outputDirectoryPath + "elastix_profile." + std::to_string(configuration.GetElastixLevel()) + ".json";
+      if (ElastixBase::GetProfiler().WriteJson(profileFileName))
+      {
+        log::info(std::ostringstream{} << "The profile is written to \"" << profileFileName << "\".");
+      }
+      else
+      {
+        log::warn(std::ostringstream{} << "WARNING: Failed to write the profile to \"" << profileFileName << "\".");
+      }
+    }
+  }
 
 } // end AfterRegistration()
 
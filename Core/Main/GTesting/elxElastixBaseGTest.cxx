@@ -0,0 +1,193 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "elxElastixBase.h"
+
+#include "elxCoreMainGTestUtilities.h"
+
+// ITK header files:
+#include <itkFileTools.h>
+#include <itkImage.h>
+#include <itkImageBufferRange.h>
+#include <itkImageFileWriter.h>
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+#include <algorithm> // For equal.
+#include <string>
+#include <vector>
+
+
+// Using-declarations:
+using elx::CoreMainGTestUtilities::CreateImageFilledWithSequenceOfNaturalNumbers;
+using elx::CoreMainGTestUtilities::GetCurrentBinaryDirectoryPath;
+using elx::CoreMainGTestUtilities::GetNameOfTest;
+using elx::CoreMainGTestUtilities::ImageDomain;
+
+
+namespace
+{
+constexpr auto ImageDimension = 2U;
+using ImageType = itk::Image<float, ImageDimension>;
+using DirectionType = ImageType::DirectionType;
+
+
+// Exposes the protected image loading of ElastixBase to the tests.
+class ElastixBaseWithPublicImageLoading : public elx::ElastixBase
+{
+public:
+  using ElastixBase::ExecuteImageReadTasks;
+  using ElastixBase::ImageReadTaskType;
+  using ElastixBase::MultipleImageLoader;
+};
+
+using ImageLoaderType = ElastixBaseWithPublicImageLoading::MultipleImageLoader<ImageType>;
+
+
+auto
+CreateFileNameContainer(const std::vector<std::string> & fileNames)
+{
+  const auto fileNameContainer = elx::ElastixBase::FileNameContainerType::New();
+  fileNameContainer->CastToSTLContainer() = fileNames;
+  return fileNameContainer;
+}
+
+
+// Expects the image to have the specified domain, and the same pixel values as the expected image.
+void
+ExpectImage(const itk::DataObject * const       dataObject,
+            const ImageDomain<ImageDimension> & expectedImageDomain,
+            const ImageType &                   expectedImage)
+{
+  const auto * const image = dynamic_cast<const ImageType *>(dataObject);
+  ASSERT_NE(image, nullptr);
+  EXPECT_EQ(ImageDomain<ImageDimension>(*image), expectedImageDomain);
+
+  const itk::ImageBufferRange<const ImageType> actualPixels(*image);
+  const itk::ImageBufferRange<const ImageType> expectedPixels(expectedImage);
+  EXPECT_TRUE(std::equal(actualPixels.cbegin(), actualPixels.cend(), expectedPixels.cbegin(), expectedPixels.cend()));
+}
+
+} // namespace
+
+
+// Tests that when one of the files cannot be read, the exception of the first failing file is rethrown, after all
+// the other files are read, both when the files are read one after another, and when they are read concurrently.
+GTEST_TEST(ElastixBase, ExecuteImageReadTasksRethrowsExceptionOfFirstUnreadableFile)
+{
+  const std::string outputDirectoryPath = GetCurrentBinaryDirectoryPath() + '/' + GetNameOfTest(*this);
+  itk::FileTools::CreateDirectory(outputDirectoryPath);
+
+  const ImageDomain<ImageDimension> imageDomain(itk::Size<ImageDimension>{ { 5, 6 } });
+  const auto                        image = CreateImageFilledWithSequenceOfNaturalNumbers<float>(imageDomain);
+
+  const std::vector<std::string> fileNames{ outputDirectoryPath + "/image0.mha",
+                                            outputDirectoryPath + "/missing1.mha",
+                                            outputDirectoryPath + "/image2.mha",
+                                            outputDirectoryPath + "/missing3.mha" };
+  itk::WriteImage(image, fileNames[0]);
+  itk::WriteImage(image, fileNames[2]);
+
+  for (const unsigned int maximumNumberOfConcurrentReads : { 1U, 4U })
+  {
+    std::vector<ElastixBaseWithPublicImageLoading::ImageReadTaskType> tasks;
+
+    const auto imageContainer =
+      ImageLoaderType::PrepareImageContainer(CreateFileNameContainer(fileNames), "Fixed Image", true, tasks);
+
+    ASSERT_EQ(tasks.size(), fileNames.size());
+    ASSERT_EQ(imageContainer->Size(), fileNames.size());
+
+    try
+    {
+      ElastixBaseWithPublicImageLoading::ExecuteImageReadTasks(tasks, maximumNumberOfConcurrentReads);
+      ADD_FAILURE() << "ExecuteImageReadTasks should have thrown an exception!";
+    }
+    catch (const itk::ExceptionObject & exceptionObject)
+    {
+      const std::string description = exceptionObject.GetDescription();
+      EXPECT_NE(description.find("Fixed Image, with file name " + fileNames[1]), std::string::npos);
+      EXPECT_EQ(description.find(fileNames[3]), std::string::npos);
+    }
+
+    // The readable images are loaded, even though other files of the same container failed.
+    ExpectImage(imageContainer->ElementAt(0), imageDomain, *image);
+    ExpectImage(imageContainer->ElementAt(2), imageDomain, *image);
+    EXPECT_EQ(imageContainer->ElementAt(1), nullptr);
+    EXPECT_EQ(imageContainer->ElementAt(3), nullptr);
+  }
+}
+
+
+// Tests that with UseDirectionCosines "false", each image that is read gets identity direction cosines, while its
+// origin, spacing, and pixel values are kept, and the original direction cosines of the last image are returned.
+GTEST_TEST(ElastixBase, PrepareImageContainerIgnoresDirectionCosines)
+{
+  const std::string outputDirectoryPath = GetCurrentBinaryDirectoryPath() + '/' + GetNameOfTest(*this);
+  itk::FileTools::CreateDirectory(outputDirectoryPath);
+
+  // Two different directions, both exactly representable in an image file: a rotation by 90 degrees, and a flip.
+  DirectionType rotation = DirectionType::GetIdentity();
+  rotation[0][0] = 0.0;
+  rotation[0][1] = -1.0;
+  rotation[1][0] = 1.0;
+  rotation[1][1] = 0.0;
+  DirectionType flip = DirectionType::GetIdentity();
+  flip[0][0] = -1.0;
+
+  const itk::Size<ImageDimension>           imageSize{ { 5, 6 } };
+  const itk::Vector<double, ImageDimension> spacing{ itk::MakeVector(2.0, 3.0) };
+  const itk::Point<double, ImageDimension>  origin{ itk::MakePoint(-4.0, 5.0) };
+
+  const std::vector<ImageDomain<ImageDimension>> imageDomains{ { rotation, {}, imageSize, spacing, origin },
+                                                               { flip, {}, imageSize, spacing, origin } };
+  std::vector<itk::SmartPointer<ImageType>> images;
+  std::vector<std::string>                  fileNames;
+
+  for (const auto & imageDomain : imageDomains)
+  {
+    images.push_back(CreateImageFilledWithSequenceOfNaturalNumbers<float>(imageDomain));
+    fileNames.push_back(outputDirectoryPath + "/image" + std::to_string(fileNames.size()) + ".mha");
+    itk::WriteImage(images.back(), fileNames.back());
+  }
+
+  for (const bool useDirectionCosines : { false, true })
+  {
+    std::vector<ElastixBaseWithPublicImageLoading::ImageReadTaskType> tasks;
+    DirectionType                                                     originalDirection{};
+
+    const auto imageContainer = ImageLoaderType::PrepareImageContainer(
+      CreateFileNameContainer(fileNames), "Moving Image", useDirectionCosines, tasks, &originalDirection);
+    ElastixBaseWithPublicImageLoading::ExecuteImageReadTasks(tasks, 2);
+
+    EXPECT_EQ(originalDirection, flip);
+    ASSERT_EQ(imageContainer->Size(), images.size());
+
+    for (unsigned int i = 0; i < images.size(); ++i)
+    {
+      auto expectedImageDomain = imageDomains[i];
+      if (!useDirectionCosines)
+      {
+        expectedImageDomain.direction = DirectionType::GetIdentity();
+      }
+      ExpectImage(imageContainer->ElementAt(i), expectedImageDomain, *images[i]);
+    }
+  }
+}
@@ -18,6 +18,7 @@
 
 // First include the header file to be tested:
 #include <itkElastixRegistrationMethod.h>
+#include <itkElastixBatchRegistrationMethod.h>
 
 #include <itkTransformixFilter.h>
 
@@ -26,6 +27,7 @@
 #include "elxCoreMainGTestUtilities.h"
 #include "elxDefaultConstruct.h"
 #include "elxForEachSupportedImageType.h"
+#include "elxProfiler.h"
 #include "elxTransformIO.h"
 
 // ITK header file:
@@ -40,12 +42,17 @@
 #include <itkSimilarity2DTransform.h>
 #include <itkTranslationTransform.h>
 #include <itkTransformFileReader.h>
+#include <itksys/SystemTools.hxx>
 
 // GoogleTest header file:
 #include <gtest/gtest.h>
 
-#include <algorithm> // For transform
+#include <algorithm> // For reverse and transform
 #include <cmath>     // For M_PI
+#include <cstdint>   // For uint64_t
+#include <cstring>   // For memcmp and memcpy
+#include <fstream>
+#include <iterator> // For istreambuf_iterator
 #include <map>
 #include <random>
 #include <string>
@@ -75,6 +82,7 @@ using elx::CoreMainGTestUtilities::GetCurrentBinaryDirectoryPath;
 using elx::CoreMainGTestUtilities::GetDataDirectoryPath;
 using elx::CoreMainGTestUtilities::GetNameOfTest;
 using elx::CoreMainGTestUtilities::GetTransformParametersFromFilter;
+using elx::CoreMainGTestUtilities::GetTransformParametersFromMaps;
 using elx::CoreMainGTestUtilities::ImageDomain;
 using elx::CoreMainGTestUtilities::TypeHolder;
 using elx::CoreMainGTestUtilities::minimumImageSizeValue;
@@ -645,6 +653,191 @@ GTEST_TEST(itkElastixRegistrationMethod, Translation)
 }
 
 
+// Tests registering a batch of translated moving images to the same fixed image, concurrently.
+GTEST_TEST(itkElastixBatchRegistrationMethod, Translation)
+{
+  static constexpr auto ImageDimension = 2U;
+  using PixelType = float;
+  using ImageType = itk::Image<PixelType, ImageDimension>;
+  using SizeType = itk::Size<ImageDimension>;
+  using IndexType = itk::Index<ImageDimension>;
+  using OffsetType = itk::Offset<ImageDimension>;
+
+  const std::vector<OffsetType> translationOffsets{ { { 1, -2 } }, { { 0, 1 } }, { { -1, 0 } }, { { 1, 1 } } };
+  const auto                    regionSize = SizeType::Filled(2);
+  const SizeType                imageSize{ { 5, 6 } };
+  const IndexType               fixedImageRegionIndex{ { 1, 3 } };
+
+  const auto fixedImage = CreateImage<PixelType>(imageSize);
+  FillImageRegion(*fixedImage, fixedImageRegionIndex, regionSize);
+
+  elx::DefaultConstruct<itk::ElastixBatchRegistrationMethod<ImageType, ImageType>> batchRegistration{};
+
+  batchRegistration.SetFixedImage(fixedImage);
+  batchRegistration.SetParameterObject(CreateParameterObject({ // Parameters in alphabetic order:
+                                                               { "ImageSampler", "Full" },
+                                                               { "MaximumNumberOfIterations", "2" },
+                                                               { "Metric", "AdvancedNormalizedCorrelation" },
+                                                               { "Optimizer", "AdaptiveStochasticGradientDescent" },
+                                                               { "Transform", "TranslationTransform" } }));
+  for (const auto & translationOffset : translationOffsets)
+  {
+    const auto movingImage = CreateImage<PixelType>(imageSize);
+    FillImageRegion(*movingImage, fixedImageRegionIndex + translationOffset, regionSize);
+    batchRegistration.AddMovingImage(movingImage);
+  }
+  batchRegistration.SetNumberOfConcurrentRegistrations(2);
+  batchRegistration.Update();
+
+  ASSERT_EQ(batchRegistration.GetNumberOfRegistrations(), translationOffsets.size());
+
+  for (unsigned int i = 0; i < translationOffsets.size(); ++i)
+  {
+    const auto & transformParameterObject = DerefRawPointer(batchRegistration.GetTransformParameterObject(i));
+    const auto   transformParameters = GetTransformParametersFromMaps(transformParameterObject.GetParameterMaps());
+    EXPECT_EQ(ConvertToOffset<ImageDimension>(transformParameters), translationOffsets[i]);
+  }
+
+  // The fixed image preprocessing results are stored once, and shared by all registrations.
+  EXPECT_GT(DerefRawPointer(batchRegistration.GetFixedImagePreprocessingCache()).GetNumberOfObjects(), 0U);
+}
+
+
+// Tests that concurrent registrations with a random image sampler yield the same transform parameters as registering
+// each of the moving images on its own, as each registration draws from its own random generator.
+GTEST_TEST(itkElastixBatchRegistrationMethod, ConcurrentRandomCoordinateEqualsSerial)
+{
+  static constexpr auto ImageDimension = 2U;
+  using PixelType = float;
+  using ImageType = itk::Image<PixelType, ImageDimension>;
+  using SizeType = itk::Size<ImageDimension>;
+  using IndexType = itk::Index<ImageDimension>;
+  using OffsetType = itk::Offset<ImageDimension>;
+
+  const std::vector<OffsetType> translationOffsets{ { { 1, -2 } }, { { 0, 1 } }, { { -1, 0 } }, { { 2, 1 } } };
+  const auto                    regionSize = SizeType::Filled(4);
+  const SizeType                imageSize{ { 16, 18 } };
+  const IndexType               fixedImageRegionIndex{ { 5, 6 } };
+
+  const auto fixedImage = CreateImage<PixelType>(imageSize);
+  FillImageRegion(*fixedImage, fixedImageRegionIndex, regionSize);
+
+  const auto parameterObject = CreateParameterObject({ // Parameters in alphabetic order:
+                                                       { "ImageSampler", "RandomCoordinate" },
+                                                       { "MaximumNumberOfIterations", "8" },
+                                                       { "Metric", "AdvancedNormalizedCorrelation" },
+                                                       { "NewSamplesEveryIteration", "true" },
+                                                       { "NumberOfSpatialSamples", "64" },
+                                                       { "Optimizer", "AdaptiveStochasticGradientDescent" },
+                                                       { "Transform", "TranslationTransform" } });
+
+  std::vector<itk::SmartPointer<ImageType>> movingImages;
+
+  for (const auto & translationOffset : translationOffsets)
+  {
+    movingImages.push_back(CreateImage<PixelType>(imageSize));
+    FillImageRegion(*movingImages.back(), fixedImageRegionIndex + translationOffset, regionSize);
+  }
+
+  // The expected transform parameters, from registering each moving image on its own.
+  std::vector<std::vector<double>> expectedTransformParameters;
+
+  for (const auto & movingImage : movingImages)
+  {
+    elx::DefaultConstruct<ElastixRegistrationMethodType<ImageType>> registration{};
+    registration.SetFixedImage(fixedImage);
+    registration.SetMovingImage(movingImage);
+    registration.SetParameterObject(parameterObject);
+    registration.Update();
+    expectedTransformParameters.push_back(GetTransformParametersFromFilter(registration));
+  }
+
+  for (const unsigned int numberOfConcurrentRegistrations : { 1U, 2U })
+  {
+    elx::DefaultConstruct<itk::ElastixBatchRegistrationMethod<ImageType, ImageType>> batchRegistration{};
+
+    batchRegistration.SetFixedImage(fixedImage);
+    batchRegistration.SetParameterObject(parameterObject);
+    for (const auto & movingImage : movingImages)
+    {
+      batchRegistration.AddMovingImage(movingImage);
+    }
+    batchRegistration.SetNumberOfConcurrentRegistrations(numberOfConcurrentRegistrations);
+    batchRegistration.Update();
+
+    ASSERT_EQ(batchRegistration.GetNumberOfRegistrations(), movingImages.size());
+
+    for (unsigned int i = 0; i < movingImages.size(); ++i)
+    {
+      const auto & transformParameterObject = DerefRawPointer(batchRegistration.GetTransformParameterObject(i));
+      EXPECT_EQ(GetTransformParametersFromMaps(transformParameterObject.GetParameterMaps()),
+                expectedTransformParameters[i]);
+    }
+  }
+}
+
+
+// Tests that each of the gradient descent optimizers yields exactly the same transform parameters with the fused step
+// ("UseFusedStep" "true", the default) as with the separate step, both for a B-spline transform, whose derivative is
+// handed out in blocks, and for a combination of metrics, which falls back to the separate step.
+GTEST_TEST(itkElastixRegistrationMethod, FusedStepEqualsSeparateStep)
+{
+  static constexpr auto ImageDimension = 2U;
+  using PixelType = float;
+  using ImageType = itk::Image<PixelType, ImageDimension>;
+  using SizeType = itk::Size<ImageDimension>;
+  using IndexType = itk::Index<ImageDimension>;
+
+  const auto      regionSize = SizeType::Filled(6);
+  const SizeType  imageSize{ { 24, 26 } };
+  const IndexType fixedImageRegionIndex{ { 8, 9 } };
+  const IndexType movingImageRegionIndex{ { 9, 7 } };
+
+  const auto fixedImage = CreateImage<PixelType>(imageSize);
+  FillImageRegion(*fixedImage, fixedImageRegionIndex, regionSize);
+  const auto movingImage = CreateImage<PixelType>(imageSize);
+  FillImageRegion(*movingImage, movingImageRegionIndex, regionSize);
+
+  for (const std::string optimizer :
+       { "StandardGradientDescent", "AdaptiveStochasticGradientDescent", "PreconditionedStochasticGradientDescent" })
+  {
+    for (const bool useCombinationMetric : { false, true })
+    {
+      const auto getTransformParameters = [&](const std::string & useFusedStep) {
+        auto parameterMap = CreateParameterMap<ImageDimension>({ // Parameters in alphabetic order:
+                                                                 { "FinalGridSpacingInVoxels", "4" },
+                                                                 { "ImageSampler", "Full" },
+                                                                 { "MaximumNumberOfIterations", "4" },
+                                                                 { "Optimizer", optimizer },
+                                                                 { "Transform", "BSplineTransform" },
+                                                                 { "UseFusedStep", useFusedStep } });
+        if (useCombinationMetric)
+        {
+          parameterMap["Registration"] = { "MultiMetricMultiResolutionRegistration" };
+          parameterMap["Metric"] = { "AdvancedMeanSquares", "AdvancedNormalizedCorrelation" };
+          parameterMap["Metric1Weight"] = { "0.5" };
+        }
+        else
+        {
+          parameterMap["Metric"] = { "AdvancedMeanSquares" };
+        }
+
+        elx::DefaultConstruct<ElastixRegistrationMethodType<ImageType>> registration{};
+        registration.SetFixedImage(fixedImage);
+        registration.SetMovingImage(movingImage);
+        registration.SetParameterObject(CreateParameterObject(parameterMap));
+        registration.Update();
+        return GetTransformParametersFromFilter(registration);
+      };
+
+      const auto expectedTransformParameters = getTransformParameters("false");
+      EXPECT_NE(expectedTransformParameters, std::vector<double>(expectedTransformParameters.size()));
+      EXPECT_EQ(getTransformParameters("true"), expectedTransformParameters);
+    }
+  }
+}
+
+
 // Tests "MaximumNumberOfIterations" value "0"
 GTEST_TEST(itkElastixRegistrationMethod, MaximumNumberOfIterationsZero)
 {
@@ -873,6 +1066,230 @@ GTEST_TEST(itkElastixRegistrationMethod, ResultImageName)
 }
 
 
+// Tests that streaming the resampling of the result image, by "NumberOfStreamDivisions", does not change
+// the result image, neither the one written to disk nor the output of the registration.
+GTEST_TEST(itkElastixRegistrationMethod, StreamedResultImageEqualsUnstreamedResultImage)
+{
+  static constexpr auto ImageDimension = 2U;
+  using PixelType = float;
+  using ImageType = itk::Image<PixelType, ImageDimension>;
+  using SizeType = itk::Size<ImageDimension>;
+
+  const SizeType imageSize{ { 17, 19 } };
+  const auto     fixedImage = CreateImageFilledWithSequenceOfNaturalNumbers<PixelType>(imageSize);
+  const auto     movingImage = CreateImageFilledWithSequenceOfNaturalNumbers<PixelType>(imageSize);
+
+  const std::string rootOutputDirectoryPath = GetCurrentBinaryDirectoryPath() + '/' + GetNameOfTest(*this);
+  itk::FileTools::CreateDirectory(rootOutputDirectoryPath);
+
+  const auto getOutputSubdirectoryPath = [rootOutputDirectoryPath](const unsigned int numberOfStreamDivisions) {
+    return rootOutputDirectoryPath + "/NumberOfStreamDivisions" + std::to_string(numberOfStreamDivisions);
+  };
+
+  const auto registerAndGetOutput = [&fixedImage, &movingImage, getOutputSubdirectoryPath](
+                                      const unsigned int numberOfStreamDivisions) {
+    elx::DefaultConstruct<ElastixRegistrationMethodType<ImageType>> registration{};
+
+    const std::string outputSubdirectoryPath = getOutputSubdirectoryPath(numberOfStreamDivisions);
+    itk::FileTools::CreateDirectory(outputSubdirectoryPath);
+    registration.SetOutputDirectory(outputSubdirectoryPath);
+    registration.SetFixedImage(fixedImage);
+    registration.SetMovingImage(movingImage);
+    registration.SetParameterObject(
+      CreateParameterObject({ // Parameters in alphabetic order:
+                              { "FinalBSplineInterpolationOrder", "3" },
+                              { "ImageSampler", "Full" },
+                              { "MaximumNumberOfIterations", "2" },
+                              { "Metric", "AdvancedNormalizedCorrelation" },
+                              { "NumberOfStreamDivisions", std::to_string(numberOfStreamDivisions) },
+                              { "Optimizer", "AdaptiveStochasticGradientDescent" },
+                              { "ResampleInterpolator", "FinalBSplineInterpolator" },
+                              { "ResultImagePixelType", "float" },
+                              { "Transform", "TranslationTransform" } }));
+    registration.Update();
+    return ImageType::Pointer(&DerefRawPointer(registration.GetOutput()));
+  };
+
+  const auto unstreamedOutput = registerAndGetOutput(1);
+  const auto unstreamedImage = itk::ReadImage<ImageType>(getOutputSubdirectoryPath(1) + "/result.0.mhd");
+
+  for (const unsigned int numberOfStreamDivisions : { 2U, 4U, 100U })
+  {
+    SCOPED_TRACE(numberOfStreamDivisions);
+
+    const auto streamedOutput = registerAndGetOutput(numberOfStreamDivisions);
+    const auto streamedImage =
+      itk::ReadImage<ImageType>(getOutputSubdirectoryPath(numberOfStreamDivisions) + "/result.0.mhd");
+
+    EXPECT_EQ(*streamedOutput, *unstreamedOutput);
+    EXPECT_EQ(*streamedImage, *unstreamedImage);
+  }
+}
+
+
+// Tests that "WriteProfile" writes a profile for each parameter map, to "elastix_profile.<ElastixLevel>.json", and that
+// the profiler is disabled again after the registration.
+GTEST_TEST(itkElastixRegistrationMethod, WriteProfileForEachParameterMap)
+{
+  static constexpr auto ImageDimension = 2U;
+  using PixelType = float;
+  using ImageType = itk::Image<PixelType, ImageDimension>;
+  using SizeType = itk::Size<ImageDimension>;
+
+  const SizeType imageSize{ { 17, 19 } };
+  const auto     fixedImage = CreateImageFilledWithSequenceOfNaturalNumbers<PixelType>(imageSize);
+  const auto     movingImage = CreateImageFilledWithSequenceOfNaturalNumbers<PixelType>(imageSize);
+
+  const std::string outputDirectoryPath = GetCurrentBinaryDirectoryPath() + '/' + GetNameOfTest(*this);
+  itk::FileTools::CreateDirectory(outputDirectoryPath);
+
+  for (const unsigned int elastixLevel : { 0U, 1U })
+  {
+    itksys::SystemTools::RemoveFile(outputDirectoryPath + "/elastix_profile." + std::to_string(elastixLevel) + ".json");
+  }
+
+  const ParameterMapType parameterMap = CreateParameterMap({ // Parameters in alphabetic order:
+                                                             { "ImageSampler", "Full" },
+                                                             { "MaximumNumberOfIterations", "2" },
+                                                             { "Metric", "AdvancedNormalizedCorrelation" },
+                                                             { "Optimizer", "AdaptiveStochasticGradientDescent" },
+                                                             { "Transform", "TranslationTransform" },
+                                                             { "WriteProfile", "true" } });
+
+  elx::DefaultConstruct<elx::ParameterObject> parameterObject{};
+  parameterObject.SetParameterMaps(ParameterMapVectorType(2, parameterMap));
+
+  elx::DefaultConstruct<ElastixRegistrationMethodType<ImageType>> registration{};
+  registration.SetOutputDirectory(outputDirectoryPath);
+  registration.SetFixedImage(fixedImage);
+  registration.SetMovingImage(movingImage);
+  registration.SetParameterObject(&parameterObject);
+  registration.Update();
+
+  EXPECT_FALSE(elx::Profiler::IsEnabled());
+
+  for (const unsigned int elastixLevel : { 0U, 1U })
+  {
+    SCOPED_TRACE(elastixLevel);
+
+    std::ifstream inputFileStream(outputDirectoryPath + "/elastix_profile." + std::to_string(elastixLevel) + ".json");
+    ASSERT_TRUE(inputFileStream.is_open());
+
+    const std::string json{ std::istreambuf_iterator<char>(inputFileStream), std::istreambuf_iterator<char>() };
+    EXPECT_NE(json.find("\"name\": \"Registration::Iteration\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\": \"Registration::Resolution\""), std::string::npos);
+  }
+}
+
+
+// Tests writing the transform parameters to a binary file, by "WriteTransformParametersToBinaryFile", and reading
+// them back by transformix: from the transform parameter file, from a parameter map read by ParameterObject, and from a
+// binary file of the opposite byte order.
+GTEST_TEST(itkElastixRegistrationMethod, TransformParametersBinaryFileRoundTrip)
+{
+  static constexpr auto ImageDimension = 2U;
+  using PixelType = float;
+  using ImageType = itk::Image<PixelType, ImageDimension>;
+  using SizeType = itk::Size<ImageDimension>;
+
+  const SizeType imageSize{ { 12, 11 } };
+  const auto     fixedImage = CreateImageFilledWithSequenceOfNaturalNumbers<PixelType>(imageSize);
+  const auto     movingImage = CreateImageFilledWithSequenceOfNaturalNumbers<PixelType>(imageSize);
+  FillImageRegion(*movingImage, itk::Index<ImageDimension>{ { 3, 4 } }, SizeType::Filled(4));
+
+  const std::string outputDirectoryPath = GetCurrentBinaryDirectoryPath() + '/' + GetNameOfTest(*this);
+  itk::FileTools::CreateDirectory(outputDirectoryPath);
+
+  elx::DefaultConstruct<ElastixRegistrationMethodType<ImageType>> registration{};
+  registration.SetOutputDirectory(outputDirectoryPath);
+  registration.SetFixedImage(fixedImage);
+  registration.SetMovingImage(movingImage);
+  registration.SetParameterObject(CreateParameterObject({ // Parameters in alphabetic order:
+                                                          { "FinalGridSpacingInVoxels", "4" },
+                                                          { "ImageSampler", "Full" },
+                                                          { "MaximumNumberOfIterations", "4" },
+                                                          { "Metric", "AdvancedNormalizedCorrelation" },
+                                                          { "NumberOfResolutions", "1" },
+                                                          { "Optimizer", "AdaptiveStochasticGradientDescent" },
+                                                          { "Transform", "BSplineTransform" },
+                                                          { "WriteTransformParametersToBinaryFile", "true" } }));
+  registration.Update();
+
+  const auto & registrationOutput = DerefRawPointer(registration.GetOutput());
+
+  // The transform parameter file refers to the binary file, instead of having the parameters as text.
+  const std::string transformParameterFileName = outputDirectoryPath + "/TransformParameters.0.txt";
+  const auto        transformParameterMap = itk::ParameterFileParser::ReadParameterMap(transformParameterFileName);
+  EXPECT_EQ(transformParameterMap.count("TransformParameters"), 0);
+  ASSERT_EQ(transformParameterMap.count("TransformParametersFileName"), 1);
+  EXPECT_EQ(transformParameterMap.at("TransformParametersFileName"),
+            ParameterValuesType{ "TransformParameters.0.bin" });
+
+  const auto numberOfParameters = std::stoull(transformParameterMap.at("NumberOfParameters").front());
+  ASSERT_GT(numberOfParameters, 0);
+
+  // Check the header and the size of the binary file.
+  const std::string binaryFileName = outputDirectoryPath + "/TransformParameters.0.bin";
+  std::vector<char> binaryFileContents;
+  {
+    std::ifstream binaryFile(binaryFileName, std::ios::binary);
+    ASSERT_TRUE(binaryFile.is_open());
+    binaryFileContents.assign(std::istreambuf_iterator<char>(binaryFile), std::istreambuf_iterator<char>());
+  }
+  constexpr std::size_t headerSize{ 24 };
+  ASSERT_EQ(binaryFileContents.size(), headerSize + numberOfParameters * sizeof(double));
+  EXPECT_EQ(std::memcmp(binaryFileContents.data(), "ELXTPBIN", 8), 0);
+
+  std::uint64_t byteOrderMark{};
+  std::uint64_t numberOfParametersInFile{};
+  std::memcpy(&byteOrderMark, binaryFileContents.data() + 8, sizeof(byteOrderMark));
+  std::memcpy(&numberOfParametersInFile, binaryFileContents.data() + 16, sizeof(numberOfParametersInFile));
+  EXPECT_EQ(byteOrderMark, std::uint64_t{ 0x0102030405060708 });
+  EXPECT_EQ(numberOfParametersInFile, numberOfParameters);
+
+  const auto expectTransformixOutputEqualsRegistrationOutput = [&movingImage, &registrationOutput](
+                                                                 elx::ParameterObject * const parameterObject,
+                                                                 const std::string &          parameterFileName) {
+    elx::DefaultConstruct<itk::TransformixFilter<ImageType>> transformix{};
+    transformix.SetMovingImage(movingImage);
+
+    if (parameterObject == nullptr)
+    {
+      transformix.SetTransformParameterFileName(parameterFileName);
+    }
+    else
+    {
+      transformix.SetTransformParameterObject(parameterObject);
+    }
+    transformix.Update();
+    EXPECT_EQ(DerefRawPointer(transformix.GetOutput()), registrationOutput);
+  };
+
+  // Read by transformix from the transform parameter file.
+  expectTransformixOutputEqualsRegistrationOutput(nullptr, transformParameterFileName);
+
+  // Read from a parameter map in memory, read by ParameterObject, which resolves the relative binary file name.
+  elx::DefaultConstruct<elx::ParameterObject> parameterObject{};
+  parameterObject.ReadParameterFile(transformParameterFileName);
+  expectTransformixOutputEqualsRegistrationOutput(&parameterObject, {});
+
+  // Read from a copy of the files, having the binary file in the opposite byte order.
+  const std::string swappedDirectoryPath = outputDirectoryPath + "/Swapped";
+  itk::FileTools::CreateDirectory(swappedDirectoryPath);
+  ASSERT_TRUE(itksys::SystemTools::CopyFileAlways(transformParameterFileName, swappedDirectoryPath));
+
+  for (std::size_t offset{ 8 }; offset < binaryFileContents.size(); offset += 8)
+  {
+    std::reverse(binaryFileContents.data() + offset, binaryFileContents.data() + offset + 8);
+  }
+  {
+    std::ofstream swappedBinaryFile(swappedDirectoryPath + "/TransformParameters.0.bin", std::ios::binary);
+    swappedBinaryFile.write(binaryFileContents.data(), binaryFileContents.size());
+  }
+  expectTransformixOutputEqualsRegistrationOutput(nullptr, swappedDirectoryPath + "/TransformParameters.0.txt");
+}
+
+
 // Tests that the origin of the output image is equal to the origin of the fixed image (by default).
 GTEST_TEST(itkElastixRegistrationMethod, OutputHasSameOriginAsFixedImage)
 {
@@ -24,6 +24,7 @@
 #include "elxCoreMainGTestUtilities.h"
 #include "elxDefaultConstruct.h"
 #include "elxTransformIO.h"
+#include "elxTransformixMain.h"
 #include "GTesting/elxGTestUtilities.h"
 #include "elxForEachSupportedImageType.h"
 
@@ -40,6 +41,7 @@
 #include <itkFileTools.h>
 #include <itkImage.h>
 #include <itkImageBufferRange.h>
+#include <itkImageFileReader.h>
 #include <itkNumberToString.h>
 #include <itkResampleImageFilter.h>
 #include <itkSimilarity2DTransform.h>
@@ -52,9 +54,15 @@
 
 #include <algorithm> // For equal and transform.
 #include <cmath>
+#include <cstdint>
+#include <cstring> // For memcmp and memcpy.
+#include <fstream>
+#include <iterator>
 #include <map>
 #include <random>
+#include <sstream>
 #include <string>
+#include <vector>
 
 
 // Type aliases:
@@ -416,6 +424,62 @@ Test_BSplineViaExternalTransformFile(const std::string & rootOutputDirectoryPath
 }
 
 
+// Returns the input point with the specified number, for the tests of the output points file. None of the coordinates
+// of these points, translated by (1, -2), or divided by two, is halfway between two integers, so that their rounding
+// to an index is unambiguous.
+itk::Point<double, 2>
+GetInputPoint(const std::size_t pointNumber)
+{
+  return itk::MakePoint(0.5 * static_cast<double>(pointNumber % 1000) + 0.125,
+                        0.25 * static_cast<double>(pointNumber / 1000) - 10.125);
+}
+
+
+// Writes an input point file for transformix, having the specified number of points, in world coordinates.
+void
+WriteInputPointFile(const std::string & fileName, const std::size_t numberOfPoints)
+{
+  std::ofstream inputPointFile(fileName);
+  inputPointFile << "point\n" << numberOfPoints << '\n';
+  for (std::size_t pointNumber{}; pointNumber < numberOfPoints; ++pointNumber)
+  {
+    const auto point = GetInputPoint(pointNumber);
+    inputPointFile << point[0] << ' ' << point[1] << '\n';
+  }
+}
+
+
+// Transforms the points of the specified input point file by a translation of (1, -2), using itk::TransformixFilter,
+// writing the output points file to the specified directory. The moving image is optional (it may be null).
+void
+TransformInputPointFile(const std::string &          inputPointFileName,
+                        const std::string &          outputDirectoryPath,
+                        const std::string &          resultPointsFormat,
+                        itk::Image<float, 2> * const movingImage)
+{
+  static constexpr auto ImageDimension = 2U;
+
+  const ImageDomain<ImageDimension> imageDomain(itk::Size<ImageDimension>{ { 5, 6 } });
+
+  elx::DefaultConstruct<itk::TransformixFilter<itk::Image<float, ImageDimension>>> transformixFilter{};
+  transformixFilter.SetFixedPointSetFileName(inputPointFileName);
+  transformixFilter.SetOutputDirectory(outputDirectoryPath);
+  if (movingImage != nullptr)
+  {
+    transformixFilter.SetMovingImage(movingImage);
+  }
+  transformixFilter.SetTransformParameterObject(
+    CreateParameterObject(MakeMergedMap({ // Parameters in alphabetic order:
+                                          { "NumberOfParameters", { std::to_string(ImageDimension) } },
+                                          { "ResampleInterpolator", { "FinalLinearInterpolator" } },
+                                          { "ResultPointsFormat", { resultPointsFormat } },
+                                          { "Transform", ParameterValuesType{ "TranslationTransform" } },
+                                          { "TransformParameters", { "1", "-2" } } },
+                                        imageDomain.AsParameterMap())));
+  transformixFilter.Update();
+}
+
+
 } // namespace
 
 
@@ -1322,6 +1386,99 @@ GTEST_TEST(itkTransformixFilter, ComputeSpatialJacobianDeterminantImage)
 }
 
 
+// Tests that streaming the spatial Jacobian output, by "NumberOfStreamDivisions", does not change the output files of
+// "-jac all" (spatialJacobian), "-jacmat all" (fullSpatialJacobian), and "-jac stats" (spatialJacobianStatistics.txt).
+// TransformixMain is called directly, as TransformixFilter does not support "-jac stats". The determinants are
+// floats, so their sum (in double precision) is exact, and the mean does not depend on the order of summation.
+GTEST_TEST(itkTransformixFilter, StreamedSpatialJacobianEqualsUnstreamedSpatialJacobian)
+{
+  static constexpr unsigned int ImageDimension{ 2 };
+  using DeterminantImageType = itk::Image<float, ImageDimension>;
+  using MatrixElementsImageType = itk::Image<itk::Vector<float, ImageDimension * ImageDimension>, ImageDimension>;
+
+  const std::string rootOutputDirectoryPath = GetCurrentBinaryDirectoryPath() + '/' + GetNameOfTest(*this);
+  itk::FileTools::CreateDirectory(rootOutputDirectoryPath);
+
+  const auto imageSize = itk::MakeSize(7, 9);
+
+  // A B-spline transform, so that the spatial Jacobian varies over the image.
+  elx::DefaultConstruct<itk::BSplineTransform<double, ImageDimension>> bsplineTransform;
+  bsplineTransform.SetTransformDomainPhysicalDimensions(ConvertToItkVector(imageSize));
+  bsplineTransform.SetParameters(GeneratePseudoRandomParameters(bsplineTransform.GetParameters().size(), -1.0));
+
+  const std::string transformFilePathName = rootOutputDirectoryPath + "/BSplineTransform.tfm";
+  elx::TransformIO::Write(bsplineTransform, transformFilePathName);
+
+  const auto getOutputSubdirectoryPath = [rootOutputDirectoryPath](const unsigned int numberOfStreamDivisions) {
+    return rootOutputDirectoryPath + "/NumberOfStreamDivisions" + std::to_string(numberOfStreamDivisions) + '/';
+  };
+
+  const auto runTransformix = [imageSize, transformFilePathName, getOutputSubdirectoryPath](
+                                const unsigned int numberOfStreamDivisions, const std::string & jacArgument) {
+    const std::string outputSubdirectoryPath = getOutputSubdirectoryPath(numberOfStreamDivisions);
+    itk::FileTools::CreateDirectory(outputSubdirectoryPath);
+
+    const ParameterMapType transformParameterMap{
+      // Parameters in alphabetic order:
+      { "Direction", CreateDefaultDirectionParameterValues<ImageDimension>() },
+      { "FixedImageDimension", { std::to_string(ImageDimension) } },
+      { "Index", ParameterValuesType(ImageDimension, "0") },
+      { "MovingImageDimension", { std::to_string(ImageDimension) } },
+      { "NumberOfStreamDivisions", { std::to_string(numberOfStreamDivisions) } },
+      { "Origin", ParameterValuesType(ImageDimension, "0") },
+      { "Size", ConvertToParameterValues(imageSize) },
+      { "Spacing", ParameterValuesType(ImageDimension, "1") },
+      { "Transform", { "File" } },
+      { "TransformFileName", { transformFilePathName } }
+    };
+    const elx::TransformixMain::ArgumentMapType argumentMap{ { "-jac", jacArgument },
+                                                             { "-jacmat", "all" },
+                                                             { "-out", outputSubdirectoryPath } };
+
+    EXPECT_EQ(elx::TransformixMain::New()->Run(argumentMap, { transformParameterMap }), 0);
+  };
+
+  const auto readStatisticsFile = [getOutputSubdirectoryPath](const unsigned int numberOfStreamDivisions) {
+    std::ifstream inputFile(getOutputSubdirectoryPath(numberOfStreamDivisions) + "spatialJacobianStatistics.txt");
+    EXPECT_TRUE(inputFile);
+    std::ostringstream outputStream;
+    outputStream << inputFile.rdbuf();
+    return outputStream.str();
+  };
+
+  // Each run writes the fullSpatialJacobian image, the first one with the statistics, the second one with the
+  // determinant image.
+  const auto runTransformixTwice = [runTransformix](const unsigned int numberOfStreamDivisions) {
+    runTransformix(numberOfStreamDivisions, "stats");
+    runTransformix(numberOfStreamDivisions, "all");
+  };
+
+  runTransformixTwice(1);
+  const auto unstreamedStatistics = readStatisticsFile(1);
+  const auto unstreamedDeterminantImage =
+    itk::ReadImage<DeterminantImageType>(getOutputSubdirectoryPath(1) + "spatialJacobian.mhd");
+  const auto unstreamedMatrixImage =
+    itk::ReadImage<MatrixElementsImageType>(getOutputSubdirectoryPath(1) + "fullSpatialJacobian.mhd");
+
+  EXPECT_FALSE(unstreamedStatistics.empty());
+
+  for (const unsigned int numberOfStreamDivisions : { 2U, 3U, 100U })
+  {
+    SCOPED_TRACE(numberOfStreamDivisions);
+
+    runTransformixTwice(numberOfStreamDivisions);
+
+    EXPECT_EQ(readStatisticsFile(numberOfStreamDivisions), unstreamedStatistics);
+    EXPECT_EQ(*itk::ReadImage<DeterminantImageType>(getOutputSubdirectoryPath(numberOfStreamDivisions) +
+                                                    "spatialJacobian.mhd"),
+              *unstreamedDeterminantImage);
+    EXPECT_EQ(*itk::ReadImage<MatrixElementsImageType>(getOutputSubdirectoryPath(numberOfStreamDivisions) +
+                                                       "fullSpatialJacobian.mhd"),
+              *unstreamedMatrixImage);
+  }
+}
+
+
 // Checks a minimum size moving image having the same pixel type as any of the supported internal pixel types.
 GTEST_TEST(itkTransformixFilter, CheckMinimumMovingImageHavingInternalPixelType)
 {
@@ -1567,3 +1724,136 @@ GTEST_TEST(itkTransformixFilter, SetExternalTransform)
 
   EXPECT_EQ(DerefRawPointer(transformixFilter.GetOutput()), DerefRawPointer(resampleImageFilter->GetOutput()));
 }
+
+
+// Tests that the output points text file is identical to the one that is written by transforming all points in one go,
+// when there are more input points than a single chunk of TransformBase::TransformPointsSomePoints (65536 points).
+GTEST_TEST(itkTransformixFilter, OutputPointsTextFileOfMoreThanOneChunkOfPoints)
+{
+  // Two full chunks, and a partially filled one.
+  constexpr std::size_t numberOfPoints{ 2 * 65536 + 3 };
+
+  const std::string outputDirectoryPath = GetCurrentBinaryDirectoryPath() + '/' + GetNameOfTest(*this);
+  itk::FileTools::CreateDirectory(outputDirectoryPath);
+
+  const std::string inputPointFileName = outputDirectoryPath + "/inputpoints.txt";
+  WriteInputPointFile(inputPointFileName, numberOfPoints);
+  TransformInputPointFile(inputPointFileName, outputDirectoryPath, "txt", nullptr);
+
+  // Format the expected results of all points sequentially, the way transformix formats a single point.
+  std::ostringstream expectedOutputStream;
+  expectedOutputStream << std::showpoint << std::fixed;
+
+  const auto writeElements = [&expectedOutputStream](const auto & rangeOfElements) {
+    for (const auto element : rangeOfElements)
+    {
+      expectedOutputStream << element << ' ';
+    }
+  };
+
+  for (std::size_t pointNumber{}; pointNumber < numberOfPoints; ++pointNumber)
+  {
+    const auto inputPoint = GetInputPoint(pointNumber);
+    const auto outputPoint = inputPoint + itk::MakeVector(1.0, -2.0);
+
+    expectedOutputStream << "Point\t" << pointNumber << "\t; InputIndex = [ ";
+    writeElements(itk::MakeIndex(itk::Math::Round<itk::IndexValueType>(inputPoint[0]),
+                                 itk::Math::Round<itk::IndexValueType>(inputPoint[1])));
+    expectedOutputStream << "]\t; InputPoint = [ ";
+    writeElements(inputPoint);
+    expectedOutputStream << "]\t; OutputIndexFixed = [ ";
+    writeElements(itk::MakeIndex(itk::Math::Round<itk::IndexValueType>(outputPoint[0]),
+                                 itk::Math::Round<itk::IndexValueType>(outputPoint[1])));
+    expectedOutputStream << "]\t; OutputPoint = [ ";
+    writeElements(outputPoint);
+    expectedOutputStream << "]\t; Deformation = [ ";
+    writeElements(itk::MakeVector(1.0f, -2.0f));
+    expectedOutputStream << "]\n";
+  }
+
+  std::ifstream outputPointsFile(outputDirectoryPath + "/outputpoints.txt", std::ios::binary);
+  ASSERT_TRUE(outputPointsFile.is_open());
+
+  const std::string actualOutput{ std::istreambuf_iterator<char>(outputPointsFile), std::istreambuf_iterator<char>() };
+  const std::string expectedOutput = expectedOutputStream.str();
+
+  // Compare the sizes first, to avoid printing two huge strings when they are not equal.
+  ASSERT_EQ(actualOutput.size(), expectedOutput.size());
+  EXPECT_TRUE(actualOutput == expectedOutput);
+}
+
+
+// Tests the header and the columns of the binary output points file ("outputpoints.bin"), for more input points than a
+// single chunk of TransformBase::TransformPointsSomePoints (65536 points), and with a moving image, so that the file
+// also has the OutputIndexMoving column.
+GTEST_TEST(itkTransformixFilter, OutputPointsBinaryFile)
+{
+  static constexpr auto ImageDimension = 2U;
+
+  // A full chunk, and a partially filled one.
+  constexpr std::size_t numberOfPoints{ 65536 + 5 };
+
+  const std::string outputDirectoryPath = GetCurrentBinaryDirectoryPath() + '/' + GetNameOfTest(*this);
+  itk::FileTools::CreateDirectory(outputDirectoryPath);
+
+  const std::string inputPointFileName = outputDirectoryPath + "/inputpoints.txt";
+  WriteInputPointFile(inputPointFileName, numberOfPoints);
+
+  // The spacing of the moving image differs from the one of the fixed image domain, to distinguish the moving indices
+  // from the fixed ones.
+  const auto movingImage = CreateImage<float>(itk::Size<ImageDimension>{ { 3, 4 } });
+  movingImage->SetSpacing(itk::MakeFilled<itk::Vector<double, ImageDimension>>(2.0));
+
+  TransformInputPointFile(inputPointFileName, outputDirectoryPath, "bin", movingImage);
+
+  std::ifstream outputPointsFile(outputDirectoryPath + "/outputpoints.bin", std::ios::binary);
+  ASSERT_TRUE(outputPointsFile.is_open());
+
+  const std::vector<char> fileContents{ std::istreambuf_iterator<char>(outputPointsFile),
+                                        std::istreambuf_iterator<char>() };
+
+  // The file has a 32 byte header, followed by five columns of two values per point (InputIndex, InputPoint,
+  // OutputIndexFixed, OutputPoint, and Deformation), and the OutputIndexMoving column, all of 8 byte values.
+  constexpr std::size_t headerSize{ 32 };
+  constexpr std::size_t numberOfColumns{ 6 };
+  ASSERT_EQ(fileContents.size(), headerSize + numberOfColumns * numberOfPoints * ImageDimension * 8);
+
+  // Reads the value of the specified type at the specified byte offset in the file.
+  const auto readValue = [&fileContents](const auto valueTypeHolder, const std::size_t byteOffset) {
+    typename decltype(valueTypeHolder)::Type value{};
+    std::memcpy(&value, fileContents.data() + byteOffset, sizeof(value));
+    return value;
+  };
+
+  EXPECT_EQ(std::memcmp(fileContents.data(), "ELXOPBIN", 8), 0);
+  EXPECT_EQ(readValue(TypeHolder<std::uint64_t>{}, 8), numberOfPoints);
+  EXPECT_EQ(readValue(TypeHolder<std::uint32_t>{}, 16), ImageDimension); // Fixed image dimension
+  EXPECT_EQ(readValue(TypeHolder<std::uint32_t>{}, 20), ImageDimension); // Moving image dimension
+  EXPECT_EQ(readValue(TypeHolder<std::uint32_t>{}, 24), 1U);             // Has OutputIndexMoving
+  EXPECT_EQ(readValue(TypeHolder<std::uint32_t>{}, 28), 0U);             // Points are indices
+
+  // Returns the offset of the specified value in the file, for the specified column.
+  const auto getByteOffset = [](const std::size_t column, const std::size_t pointNumber, const unsigned int i) {
+    return headerSize + ((column * numberOfPoints + pointNumber) * ImageDimension + i) * 8;
+  };
+
+  for (std::size_t pointNumber{}; pointNumber < numberOfPoints; ++pointNumber)
+  {
+    const auto inputPoint = GetInputPoint(pointNumber);
+    const auto outputPoint = inputPoint + itk::MakeVector(1.0, -2.0);
+    const auto deformation = itk::MakeVector(1.0, -2.0);
+
+    for (unsigned int i{}; i < ImageDimension; ++i)
+    {
+      EXPECT_EQ(readValue(TypeHolder<std::int64_t>{}, getByteOffset(0, pointNumber, i)),
+                itk::Math::Round<std::int64_t>(inputPoint[i]));
+      EXPECT_EQ(readValue(TypeHolder<double>{}, getByteOffset(1, pointNumber, i)), inputPoint[i]);
+      EXPECT_EQ(readValue(TypeHolder<std::int64_t>{}, getByteOffset(2, pointNumber, i)),
+                itk::Math::Round<std::int64_t>(outputPoint[i]));
+      EXPECT_EQ(readValue(TypeHolder<double>{}, getByteOffset(3, pointNumber, i)), outputPoint[i]);
+      EXPECT_EQ(readValue(TypeHolder<double>{}, getByteOffset(4, pointNumber, i)), deformation[i]);
+      EXPECT_EQ(readValue(TypeHolder<std::int64_t>{}, getByteOffset(5, pointNumber, i)),
+                itk::Math::Round<std::int64_t>(outputPoint[i] / 2.0));
+    }
+  }
+}
@@ -22,12 +22,35 @@
 #include "itkParameterFileParser.h"
 
 #include "itkFileTools.h"
+#include <itksys/SystemTools.hxx>
 #include <fstream>
 #include <iostream>
 #include <cmath>
 
 namespace elastix
 {
+namespace
+{
+/** Reads the parameter map from the specified file. A relative TransformParametersFileName (the name of a binary
+ * transform parameters file) is relative to the directory of the parameter file, so it is made a full path, as the
+ * map no longer knows where it was read from. */
+ParameterObject::ParameterMapType
+ReadParameterMapWithFullBinaryFileName(const ParameterObject::ParameterFileNameType & parameterFileName)
+{
+  auto parameterMap = itk::ParameterFileParser::ReadParameterMap(parameterFileName);
+
+  if (const auto found = parameterMap.find("TransformParametersFileName");
+      (found != parameterMap.end()) && (found->second.size() == 1) &&
+      !itksys::SystemTools::FileIsFullPath(found->second.front()))
+  {
+    const std::string directoryPath =
+      itksys::SystemTools::GetFilenamePath(itksys::SystemTools::CollapseFullPath(parameterFileName));
+    found->second.front() = itksys::SystemTools::CollapseFullPath(found->second.front(), directoryPath);
+  }
+  return parameterMap;
+}
+} // namespace
+
 
 /**
  * ********************* SetParameterMap *********************
@@ -199,7 +222,7 @@ ParameterObject::RemoveParameter(const ParameterKeyType & key)
 void
 ParameterObject::ReadParameterFile(const ParameterFileNameType & parameterFileName)
 {
-  this->SetParameterMaps({ itk::ParameterFileParser::ReadParameterMap(parameterFileName) });
+  this->SetParameterMaps({ ReadParameterMapWithFullBinaryFileName(parameterFileName) });
 }
 
 
@@ -244,7 +267,7 @@ ParameterObject::ReadParameterFiles(const ParameterFileNameVectorType & paramete
 void
 ParameterObject::AddParameterFile(const ParameterFileNameType & parameterFileName)
 {
-  m_ParameterMaps.push_back(itk::ParameterFileParser::ReadParameterMap(parameterFileName));
+  m_ParameterMaps.push_back(ReadParameterMapWithFullBinaryFileName(parameterFileName));
 }
 
 
@@ -0,0 +1,237 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkElastixBatchRegistrationMethod_h
+#define itkElastixBatchRegistrationMethod_h
+
+#include "itkElastixRegistrationMethod.h"
+#include "elxFixedImagePreprocessingCache.h"
+
+#include <itkObject.h>
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class ElastixBatchRegistrationMethod
+ *
+ * \brief Registers a number of moving images to one fixed image, with the same parameter object.
+ *
+ * Each moving image is registered by its own ElastixRegistrationMethod. All of these registrations share one
+ * FixedImagePreprocessingCache, so that the fixed image pyramid, the fixed image extrema, and the samples of the
+ * deterministic image samplers are only computed once, instead of once for each moving image.
+ *
+ * The moving images may be specified beforehand, by AddMovingImage, or be produced on demand, by a moving image
+ * queue: a function that returns the next moving image, or null when there are no more. Up to
+ * NumberOfConcurrentRegistrations registrations run at the same time.
+ *
+ * \note The logging system of elastix is process-wide. The batch sets up the logging once, for all of its
+ * registrations, so concurrent registrations write to the same log. Each registration has its own random generator,
+ * seeded by its RandomSeed parameter, so that the result of a registration does not depend on the number of
+ * concurrent registrations, see elastix::RandomGenerator.
+ *
+ * \sa ElastixRegistrationMethod, elastix::FixedImagePreprocessingCache
+ */
+template <typename TFixedImage, typename TMovingImage>
+class ITK_TEMPLATE_EXPORT ElastixBatchRegistrationMethod : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(ElastixBatchRegistrationMethod);
+
+  /** Standard ITK typedefs. */
+  using Self = ElastixBatchRegistrationMethod;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ElastixBatchRegistrationMethod, Object);
+
+  /** Typedefs. */
+  using RegistrationMethodType = ElastixRegistrationMethod<TFixedImage, TMovingImage>;
+  using RegistrationMethodPointer = typename RegistrationMethodType::Pointer;
+  using FixedImageType = TFixedImage;
+  using MovingImageType = TMovingImage;
+  using FixedMaskType = typename RegistrationMethodType::FixedMaskType;
+  using ResultImageType = typename RegistrationMethodType::ResultImageType;
+  using ParameterObjectType = typename RegistrationMethodType::ParameterObjectType;
+  using FixedImagePreprocessingCacheType = elx::FixedImagePreprocessingCache;
+
+  /** A function that returns the next moving image to be registered, or null when there are no more. */
+  using MovingImageQueueType = std::function<SmartPointer<MovingImageType>()>;
+
+  /** A function that is called when the registration of the moving image at the specified index is finished. It may
+   * be called concurrently, by different registrations. */
+  using RegistrationFinishedCallbackType = std::function<void(unsigned int, const RegistrationMethodType &)>;
+
+  /** Set/Get the fixed image. */
+  itkSetObjectMacro(FixedImage, FixedImageType);
+  itkGetModifiableObjectMacro(FixedImage, FixedImageType);
+
+  /** Set/Get the (optional) fixed mask. */
+  itkSetObjectMacro(FixedMask, FixedMaskType);
+  itkGetModifiableObjectMacro(FixedMask, FixedMaskType);
+
+  /** Set/Get the parameter object, used by each of the registrations. */
+  itkSetObjectMacro(ParameterObject, ParameterObjectType);
+  itkGetModifiableObjectMacro(ParameterObject, ParameterObjectType);
+
+  /** Adds a moving image to the batch. */
+  void
+  AddMovingImage(MovingImageType * movingImage)
+  {
+    m_MovingImages.push_back(movingImage);
+    this->Modified();
+  }
+
+  /** Removes all moving images that were added to the batch. */
+  void
+  RemoveMovingImages()
+  {
+    m_MovingImages.clear();
+    this->Modified();
+  }
+
+  /** Set the moving image queue. When it is set, the moving images are retrieved from the queue, after those that were
+   * added by AddMovingImage. The queue is never called concurrently. */
+  void
+  SetMovingImageQueue(MovingImageQueueType movingImageQueue)
+  {
+    m_MovingImageQueue = std::move(movingImageQueue);
+    this->Modified();
+  }
+
+  /** Set the function that is called when a registration is finished. */
+  void
+  SetRegistrationFinishedCallback(RegistrationFinishedCallbackType registrationFinishedCallback)
+  {
+    m_RegistrationFinishedCallback = std::move(registrationFinishedCallback);
+  }
+
+  /** Set/Get the maximum number of registrations that run at the same time. Default: 1. */
+  itkSetClampMacro(NumberOfConcurrentRegistrations, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(NumberOfConcurrentRegistrations, unsigned int);
+
+  /** Set/Get the maximum number of threads of ITK, which is shared by all registrations of the batch. When it is
+   * greater than zero, Update sets the global maximum number of threads of ITK to this number, once, before any
+   * registration starts, like the "-threads" argument of a single registration. Zero (the default) leaves the global
+   * maximum as it is. */
+  itkSetMacro(MaximumNumberOfThreads, int);
+  itkGetConstMacro(MaximumNumberOfThreads, int);
+
+  /** Set/Get the output directory. When specified, the output of each registration is written to a subdirectory,
+   * named by the index of its moving image. */
+  itkSetMacro(OutputDirectory, std::string);
+  itkGetConstMacro(OutputDirectory, std::string);
+
+  /** Log to std::cout on/off. */
+  itkSetMacro(LogToConsole, bool);
+  itkGetConstReferenceMacro(LogToConsole, bool);
+  itkBooleanMacro(LogToConsole);
+
+  itkSetMacro(LogLevel, ElastixLogLevel);
+  itkGetConstMacro(LogLevel, ElastixLogLevel);
+
+  /** Returns the cache that is shared by the registrations of the last update. */
+  const FixedImagePreprocessingCacheType *
+  GetFixedImagePreprocessingCache() const
+  {
+    return m_FixedImagePreprocessingCache;
+  }
+
+  /** Runs all registrations of the batch. Throws the first exception thrown by any of the registrations, after all
+   * registrations that were already started have finished. */
+  void
+  Update();
+
+  /** The number of registrations performed by the last update. */
+  unsigned int
+  GetNumberOfRegistrations() const
+  {
+    return static_cast<unsigned int>(m_Registrations.size());
+  }
+
+  /** Returns the registration of the moving image at the specified index, as performed by the last update. */
+  const RegistrationMethodType *
+  GetRegistration(const unsigned int index) const;
+
+  /** Returns the transform parameter object of the registration at the specified index. */
+  const ParameterObjectType *
+  GetTransformParameterObject(const unsigned int index) const
+  {
+    return this->GetRegistration(index)->GetTransformParameterObject();
+  }
+
+  /** Returns the result image of the registration at the specified index. */
+  const ResultImageType *
+  GetResultImage(const unsigned int index) const
+  {
+    return this->GetRegistration(index)->GetOutput();
+  }
+
+protected:
+  ElastixBatchRegistrationMethod() = default;
+  ~ElastixBatchRegistrationMethod() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Retrieves the next moving image, and its index. Returns null when there are no more. Thread-safe. */
+  SmartPointer<MovingImageType>
+  GetNextMovingImage(unsigned int & index);
+
+  /** Creates the registration of the specified moving image, and stores it at the specified index. Thread-safe. */
+  RegistrationMethodPointer
+  CreateRegistration(MovingImageType & movingImage, const unsigned int index);
+
+  SmartPointer<FixedImageType>      m_FixedImage{};
+  SmartPointer<FixedMaskType>       m_FixedMask{};
+  SmartPointer<ParameterObjectType> m_ParameterObject{};
+
+  std::vector<SmartPointer<MovingImageType>> m_MovingImages{};
+  MovingImageQueueType                       m_MovingImageQueue{};
+  RegistrationFinishedCallbackType           m_RegistrationFinishedCallback{};
+
+  unsigned int    m_NumberOfConcurrentRegistrations{ 1 };
+  int             m_MaximumNumberOfThreads{ 0 };
+  std::string     m_OutputDirectory{};
+  bool            m_LogToConsole{ false };
+  ElastixLogLevel m_LogLevel{};
+
+  /** The state of the last update. The mutex protects the index of the next moving image and the registrations. */
+  std::mutex                                     m_Mutex{};
+  unsigned int                                   m_NextMovingImageIndex{ 0 };
+  std::vector<RegistrationMethodPointer>         m_Registrations{};
+  SmartPointer<FixedImagePreprocessingCacheType> m_FixedImagePreprocessingCache{};
+};
+
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkElastixBatchRegistrationMethod.hxx"
+#endif
+
+#endif // itkElastixBatchRegistrationMethod_h
@@ -0,0 +1,246 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkElastixBatchRegistrationMethod_hxx
+#define itkElastixBatchRegistrationMethod_hxx
+
+#include "itkElastixBatchRegistrationMethod.h"
+#include "elxlog.h"
+
+#include <itkMultiThreaderBase.h>
+#include <itksys/SystemTools.hxx>
+
+#include <algorithm> // For min.
+#include <exception> // For exception_ptr.
+#include <thread>
+
+namespace itk
+{
+
+/**
+ * ********************* Update ****************************
+ */
+
+template <typename TFixedImage, typename TMovingImage>
+void
+ElastixBatchRegistrationMethod<TFixedImage, TMovingImage>::Update()
+{
+  if (m_FixedImage.IsNull())
+  {
+    itkExceptionMacro("No fixed image specified.");
+  }
+  if (m_ParameterObject.IsNull())
+  {
+    itkExceptionMacro("No parameter object specified.");
+  }
+  if (!m_OutputDirectory.empty() && !itksys::SystemTools::FileExists(m_OutputDirectory))
+  {
+    itkExceptionMacro("Output directory \"" << m_OutputDirectory << "\" does not exist.");
+  }
+
+  m_NextMovingImageIndex = 0;
+  m_Registrations.clear();
+
+  /** A new cache for each update, as the fixed image or the parameters may have been modified since the last one. */
+  m_FixedImagePreprocessingCache = FixedImagePreprocessingCacheType::New();
+
+  /** Set the number of threads once, for all registrations, as it is process-wide. */
+  if (m_MaximumNumberOfThreads > 0)
+  {
+    MultiThreaderBase::SetGlobalMaximumNumberOfThreads(m_MaximumNumberOfThreads);
+  }
+
+  /** Setup the logging once, for all registrations, as the logging system is process-wide. */
+  const elx::log::guard logGuard({}, false, m_LogToConsole, static_cast<elx::log::level>(m_LogLevel));
+
+  std::exception_ptr firstException{};
+  bool               isStopRequested{ false };
+
+  const auto runRegistrations = [this, &firstException, &isStopRequested] {
+    unsigned int movingImageIndex{};
+
+    while (const auto movingImage = this->GetNextMovingImage(movingImageIndex))
+    {
+      try
+      {
+        const auto registration = this->CreateRegistration(*movingImage, movingImageIndex);
+        registration->Update();
+
+        if (m_RegistrationFinishedCallback)
+        {
+          m_RegistrationFinishedCallback(movingImageIndex, *registration);
+        }
+      }
+      catch (...)
+      {
+        const std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!firstException)
+        {
+          firstException = std::current_exception();
+        }
+        isStopRequested = true;
+      }
+
+      const std::lock_guard<std::mutex> lock(m_Mutex);
+      if (isStopRequested)
+      {
+        return;
+      }
+    }
+  };
+
+  /** The calling thread runs registrations as well, next to the additional threads. */
+  const unsigned int numberOfMovingImagesAdded = static_cast<unsigned int>(m_MovingImages.size());
+  const unsigned int numberOfThreads =
+    m_MovingImageQueue ? m_NumberOfConcurrentRegistrations
+                       : std::max(std::min(m_NumberOfConcurrentRegistrations, numberOfMovingImagesAdded), 1U);
+
+  std::vector<std::thread> additionalThreads;
+  additionalThreads.reserve(numberOfThreads - 1);
+  for (unsigned int i = 1; i < numberOfThreads; ++i)
+  {
+    additionalThreads.emplace_back(runRegistrations);
+  }
+  runRegistrations();
+
+  for (auto & thread : additionalThreads)
+  {
+    thread.join();
+  }
+
+  if (firstException)
+  {
+    std::rethrow_exception(firstException);
+  }
+
+} // end Update()
+
+
+/**
+ * ********************* GetRegistration ****************************
+ */
+
+template <typename TFixedImage, typename TMovingImage>
+auto
+ElastixBatchRegistrationMethod<TFixedImage, TMovingImage>::GetRegistration(const unsigned int index) const
+  -> const RegistrationMethodType *
+{
+  if (index >= m_Registrations.size())
+  {
+    itkExceptionMacro("Index " << index << " exceeds the number of registrations (" << m_Registrations.size() << ").");
+  }
+  return m_Registrations[index];
+
+} // end GetRegistration()
+
+
+/**
+ * ********************* GetNextMovingImage ****************************
+ */
+
+template <typename TFixedImage, typename TMovingImage>
+auto
+ElastixBatchRegistrationMethod<TFixedImage, TMovingImage>::GetNextMovingImage(unsigned int & index)
+  -> SmartPointer<MovingImageType>
+{
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+
+  SmartPointer<MovingImageType> movingImage{};
+
+  if (m_NextMovingImageIndex < m_MovingImages.size())
+  {
+    movingImage = m_MovingImages[m_NextMovingImageIndex];
+  }
+  else if (m_MovingImageQueue)
+  {
+    movingImage = m_MovingImageQueue();
+  }
+
+  if (movingImage)
+  {
+    index = m_NextMovingImageIndex;
+    ++m_NextMovingImageIndex;
+  }
+  return movingImage;
+
+} // end GetNextMovingImage()
+
+
+/**
+ * ********************* CreateRegistration ****************************
+ */
+
+template <typename TFixedImage, typename TMovingImage>
+auto
+ElastixBatchRegistrationMethod<TFixedImage, TMovingImage>::CreateRegistration(MovingImageType &  movingImage,
+                                                                               const unsigned int index)
+  -> RegistrationMethodPointer
+{
+  const auto registration = RegistrationMethodType::New();
+  registration->SetFixedImage(m_FixedImage);
+  registration->SetMovingImage(&movingImage);
+  registration->SetParameterObject(m_ParameterObject);
+  registration->SetFixedImagePreprocessingCache(m_FixedImagePreprocessingCache);
+  registration->m_KeepLogSetup = true;
+
+  if (m_FixedMask)
+  {
+    registration->SetFixedMask(m_FixedMask);
+  }
+
+  if (!m_OutputDirectory.empty())
+  {
+    const std::string outputDirectory = m_OutputDirectory + '/' + std::to_string(index);
+    if (!itksys::SystemTools::MakeDirectory(outputDirectory))
+    {
+      itkExceptionMacro("Failed to create output directory \"" << outputDirectory << "\".");
+    }
+    registration->SetOutputDirectory(outputDirectory);
+  }
+
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+  if (index >= m_Registrations.size())
+  {
+    m_Registrations.resize(index + 1);
+  }
+  m_Registrations[index] = registration;
+  return registration;
+
+} // end CreateRegistration()
+
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+template <typename TFixedImage, typename TMovingImage>
+void
+ElastixBatchRegistrationMethod<TFixedImage, TMovingImage>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfMovingImages: " << m_MovingImages.size() << '\n'
+     << indent << "NumberOfConcurrentRegistrations: " << m_NumberOfConcurrentRegistrations << '\n'
+     << indent << "MaximumNumberOfThreads: " << m_MaximumNumberOfThreads << '\n'
+     << indent << "OutputDirectory: " << m_OutputDirectory << '\n'
+     << indent << "NumberOfRegistrations: " << m_Registrations.size() << std::endl;
+
+} // end PrintSelf()
+
+} // namespace itk
+
+#endif // itkElastixBatchRegistrationMethod_hxx
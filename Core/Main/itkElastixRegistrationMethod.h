@@ -44,6 +44,7 @@
 #include "elxElastixBase.h"
 #include "elxTransformBase.h"
 #include "elxParameterObject.h"
+#include "elxFixedImagePreprocessingCache.h"
 
 /**
  * \class ElastixRegistrationMethod
@@ -290,6 +291,13 @@ public:
   itkSetMacro(NumberOfThreads, int);
   itkGetConstMacro(NumberOfThreads, int);
 
+  /** Set/Get the cache of fixed image preprocessing results, which is shared with other registrations to the same
+   * fixed image (and fixed mask), with the same parameter object. Null by default. See also
+   * ElastixBatchRegistrationMethod, which uses the cache for a number of moving images.
+   */
+  itkSetObjectMacro(FixedImagePreprocessingCache, elx::FixedImagePreprocessingCache);
+  itkGetModifiableObjectMacro(FixedImagePreprocessingCache, elx::FixedImagePreprocessingCache);
+
   /** Returns the number of transformations, produced during the last Update(). */
   unsigned int
   GetNumberOfTransforms() const;
@@ -319,6 +327,10 @@ protected:
   MakeOutput(DataObjectPointerArraySizeType idx) override;
 
 private:
+  /** The batch registration method sets up the logging for all of its registrations. */
+  template <typename, typename>
+  friend class ElastixBatchRegistrationMethod;
+
   /** MakeUniqueName. */
   std::string
   MakeUniqueName(const DataObjectIdentifierType & key);
@@ -402,6 +414,11 @@ private:
 
   int m_NumberOfThreads{ 0 };
 
+  SmartPointer<elx::FixedImagePreprocessingCache> m_FixedImagePreprocessingCache{};
+
+  /** When true, GenerateData leaves the logging system as it is set up by the caller. */
+  bool m_KeepLogSetup{ false };
+
   unsigned int m_InputUID{ 0 };
 };
 
@@ -44,7 +44,8 @@
 
 #include <algorithm> // For find.
 #include <cassert>
-#include <memory> // For unique_ptr.
+#include <memory>   // For unique_ptr.
+#include <optional> // For optional.
 
 namespace itk
 {
@@ -177,11 +178,15 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::GenerateData()
     argumentMap.insert(ArgumentMapEntryType("-threads", std::to_string(m_NumberOfThreads)));
   }
 
-  // Setup logging.
-  const elx::log::guard logGuard(logFileName,
-                                 m_EnableOutput && m_LogToFile,
-                                 m_EnableOutput && m_LogToConsole,
-                                 static_cast<elastix::log::level>(m_LogLevel));
+  // Setup logging, unless the caller has set it up already, for a batch of registrations.
+  std::optional<elx::log::guard> logGuard;
+  if (!m_KeepLogSetup)
+  {
+    logGuard.emplace(logFileName,
+                     m_EnableOutput && m_LogToFile,
+                     m_EnableOutput && m_LogToConsole,
+                     static_cast<elastix::log::level>(m_LogLevel));
+  }
 
   const auto getInitialTransformParameterMaps = [this]() -> ParameterMapVectorType {
     if (m_InitialTransformParameterObject)
@@ -365,6 +370,7 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::GenerateData()
     elastixMain->SetMovingMaskContainer(registrationData.movingMaskContainer);
     elastixMain->SetResultImageContainer(registrationData.resultImageContainer);
     elastixMain->SetOriginalFixedImageDirectionFlat(registrationData.fixedImageOriginalDirection);
+    elastixMain->SetFixedImagePreprocessingCache(m_FixedImagePreprocessingCache);
 
     // Start registration
     unsigned int isError = 0;
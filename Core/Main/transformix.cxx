@@ -56,7 +56,7 @@ constexpr const char * transformixHelpText =
   "            use \"-def all\" to transform all points from the input-image, which\n"
   "            effectively generates a deformation field.\n"
   "  -jac      use \"-jac all\" to generate an image with the determinant of the\n"
-  "            spatial Jacobian\n"
+  "            spatial Jacobian, or \"-jac stats\" to only compute its statistics\n"
   "  -jacmat   use \"-jacmat all\" to generate an image with the spatial Jacobian\n"
   "            matrix at each voxel\n"
   "  -loglevel set the log level to \"off\", \"error\", \"warning\", or \"info\" (default),\n"